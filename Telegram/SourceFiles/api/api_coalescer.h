@@ -0,0 +1,88 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/timer.h"
+#include "base/flat_set.h"
+
+namespace Api {
+
+struct CoalescerStats {
+	int batches = 0;
+	int keys = 0;
+	int duplicates = 0;
+	int maxBatch = 0;
+};
+
+struct CoalescerPolicy {
+	crl::time maxDelay = 0;
+	int maxBatchSize = 0;
+};
+
+// Collects keys that are requested one by one and passes them to
+// the sender in batches, at most maxDelay after the first key was added
+// or right away when maxBatchSize keys are waiting.
+template <typename Key>
+class Coalescer final {
+public:
+	using Sender = Fn<void(std::vector<Key> &&batch)>;
+
+	Coalescer(CoalescerPolicy policy, Sender sender)
+	: _policy(policy)
+	, _sender(std::move(sender))
+	, _timer([=] { flush(); }) {
+		Expects(_policy.maxBatchSize > 0);
+	}
+
+	// Returns false if the key is already waiting to be sent.
+	bool add(Key key) {
+		if (!_pending.emplace(std::move(key)).second) {
+			++_stats.duplicates;
+			return false;
+		} else if (int(_pending.size()) >= _policy.maxBatchSize) {
+			flush();
+		} else if (!_timer.isActive()) {
+			_timer.callOnce(_policy.maxDelay);
+		}
+		return true;
+	}
+	[[nodiscard]] bool contains(const Key &key) const {
+		return _pending.contains(key);
+	}
+	void flush() {
+		_timer.cancel();
+		auto pending = base::take(_pending);
+		auto from = begin(pending);
+		const auto till = end(pending);
+		while (from != till) {
+			const auto count = std::min(
+				int(till - from),
+				_policy.maxBatchSize);
+			auto batch = std::vector<Key>(from, from + count);
+			from += count;
+
+			++_stats.batches;
+			_stats.keys += count;
+			accumulate_max(_stats.maxBatch, count);
+			_sender(std::move(batch));
+		}
+	}
+	[[nodiscard]] const CoalescerStats &stats() const {
+		return _stats;
+	}
+
+private:
+	CoalescerPolicy _policy;
+	Sender _sender;
+	base::flat_set<Key> _pending;
+	base::Timer _timer;
+	CoalescerStats _stats;
+
+};
+
+} // namespace Api
@@ -126,6 +126,7 @@ void SendExistingMedia(
 		}).fail([=](const RPCError &error) {
 			(*failHandler)(error, usedFileReference);
 		}).afterRequest(history->sendRequestId
+		).withPriority(MTP::RequestPriority::Interactive
 		).send();
 	};
 	*failHandler = [=](const RPCError &error, QByteArray usedFileReference) {
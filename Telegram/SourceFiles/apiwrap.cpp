@@ -23,6 +23,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_chat.h"
 #include "data/data_user.h"
 #include "data/data_cloud_themes.h"
+#include "data/data_cached_histories.h"
+#include "data/data_cached_participants.h"
 #include "dialogs/dialogs_key.h"
 #include "core/core_cloud_password.h"
 #include "core/application.h"
@@ -84,6 +86,8 @@ constexpr auto kForwardMessagesOnAdd = 100;
 constexpr auto kProxyPromotionInterval = TimeId(60 * 60);
 constexpr auto kProxyPromotionMinDelay = TimeId(10);
 constexpr auto kSmallDelayMs = 5;
+constexpr auto kPeerRequestsDelay = crl::time(20);
+constexpr auto kPeerRequestsBatchSize = 100;
 constexpr auto kUnreadMentionsPreloadIfLess = 5;
 constexpr auto kUnreadMentionsFirstRequestLimit = 10;
 constexpr auto kUnreadMentionsNextRequestLimit = 100;
@@ -98,6 +102,11 @@ constexpr auto kDialogsFirstLoad = 20;
 constexpr auto kDialogsPerPage = 500;
 constexpr auto kBlockedFirstSlice = 16;
 
+// Read requests while scrolling are sent not more often than that.
+constexpr auto kReadRequestsDelay = crl::time(300);
+constexpr auto kPollReloadDelay = crl::time(200);
+constexpr auto kPollReloadRequestsMax = 5;
+
 using PhotoFileLocationId = Data::PhotoFileLocationId;
 using DocumentFileLocationId = Data::DocumentFileLocationId;
 using UpdatedFileReferences = Data::UpdatedFileReferences;
@@ -223,14 +232,26 @@ bool ApiWrap::BlockedUsersSlice::operator!=(const BlockedUsersSlice &other) cons
 ApiWrap::ApiWrap(not_null<Main::Session*> session)
 : _session(session)
 , _messageDataResolveDelayed([=] { resolveMessageDatas(); })
+, _usersRequests(
+	{ kPeerRequestsDelay, kPeerRequestsBatchSize },
+	[=](auto &&users) { sendPeersRequest(std::move(users)); })
+, _chatsRequests(
+	{ kPeerRequestsDelay, kPeerRequestsBatchSize },
+	[=](auto &&chats) { sendPeersRequest(std::move(chats)); })
+, _channelsRequests(
+	{ kPeerRequestsDelay, kPeerRequestsBatchSize },
+	[=](auto &&channels) { sendPeersRequest(std::move(channels)); })
+, _cachedParticipants(session)
 , _webPagesTimer([=] { resolveWebPages(); })
 , _draftsSaveTimer([=] { saveDraftsToCloud(); })
 , _featuredSetsReadTimer([=] { readFeaturedSets(); })
 , _dialogsLoadState(std::make_unique<DialogsLoadState>())
+, _readRequestsTimer([=] { sendPendingReadRequests(); })
 , _fileLoader(std::make_unique<TaskQueue>(kFileLoaderQueueStopTimeout))
 //, _feedReadTimer([=] { readFeeds(); }) // #feed
 , _proxyPromotionTimer([=] { refreshProxyPromotion(); })
-, _updateNotifySettingsTimer([=] { sendNotifySettingsUpdates(); }) {
+, _updateNotifySettingsTimer([=] { sendNotifySettingsUpdates(); })
+, _pollReloadTimer([=] { sendPollReloadRequests(); }) {
 	crl::on_main([=] {
 		// You can't use _session->lifetime() in the constructor,
 		// only queued, because it is not constructed yet.
@@ -786,10 +807,15 @@ void ApiWrap::requestMoreDialogs(Data::Folder *folder) {
 		return;
 	} else if (state->requestId) {
 		return;
-	} else if (_dialogsLoadBlockedByDate.current()) {
+	} else if (!folder && _dialogsLoadBlockedByDate.current()) {
 		return;
 	}
 
+	// Pinned chats go first in the list, ask for them before the page.
+	if (!state->pinnedReceived) {
+		requestPinnedDialogs(folder);
+	}
+
 	const auto firstLoad = !state->offsetDate;
 	const auto loadCount = firstLoad ? kDialogsFirstLoad : kDialogsPerPage;
 	const auto flags = MTPmessages_GetDialogs::Flag::f_exclude_pinned
@@ -837,20 +863,23 @@ void ApiWrap::requestMoreDialogs(Data::Folder *folder) {
 		});
 
 		if (!folder) {
+			if (firstLoad) {
+				_session->data().cachedHistories().preload();
+			}
 			if (!_dialogsLoadState || !_dialogsLoadState->listReceived) {
 				refreshDialogsLoadBlocked();
 			}
-			requestDialogs(folder);
 			requestContacts();
 		}
+
+		// Folders are paged in parallel with the main list, so that
+		// their chats and unread counters are complete as soon as it is.
+		requestMoreDialogs(folder);
 		_session->data().chatsListChanged(folder);
 	}).fail([=](const RPCError &error) {
 		dialogsLoadState(folder)->requestId = 0;
 	}).send();
 
-	if (!state->pinnedReceived) {
-		requestPinnedDialogs(folder);
-	}
 	if (!folder) {
 		refreshDialogsLoadBlocked();
 	}
@@ -1304,37 +1333,98 @@ void ApiWrap::requestPeer(not_null<PeerData*> peer) {
 		return;
 	}
 
-	const auto requestId = [&] {
-		const auto failHandler = [=](const RPCError &error) {
-			_peerRequests.remove(peer);
-		};
-		const auto chatHandler = [=](const MTPmessages_Chats &result) {
-			_peerRequests.remove(peer);
-			const auto &chats = result.match([](const auto &data) {
-				return data.vchats();
-			});
-			_session->data().applyMaximumChatVersions(chats);
-			_session->data().processChats(chats);
-		};
-		if (const auto user = peer->asUser()) {
-			return request(MTPusers_GetUsers(
-				MTP_vector<MTPInputUser>(1, user->inputUser)
-			)).done([=](const MTPVector<MTPUser> &result) {
-				_peerRequests.remove(user);
-				_session->data().processUsers(result);
-			}).fail(failHandler).send();
-		} else if (const auto chat = peer->asChat()) {
-			return request(MTPmessages_GetChats(
-				MTP_vector<MTPint>(1, chat->inputChat)
-			)).done(chatHandler).fail(failHandler).send();
-		} else if (const auto channel = peer->asChannel()) {
-			return request(MTPchannels_GetChannels(
-				MTP_vector<MTPInputChannel>(1, channel->inputChannel)
-			)).done(chatHandler).fail(failHandler).send();
-		}
+	if (const auto user = peer->asUser()) {
+		_usersRequests.add(user);
+	} else if (const auto chat = peer->asChat()) {
+		_chatsRequests.add(chat);
+	} else if (const auto channel = peer->asChannel()) {
+		_channelsRequests.add(channel);
+	} else {
 		Unexpected("Peer type in requestPeer.");
-	}();
-	_peerRequests.insert(peer, requestId);
+	}
+	// Request id is assigned when the batch is sent.
+	_peerRequests.insert(peer, 0);
+}
+
+void ApiWrap::sendPeersRequest(std::vector<not_null<UserData*>> &&users) {
+	auto inputs = QVector<MTPInputUser>();
+	inputs.reserve(users.size());
+	for (const auto user : users) {
+		inputs.push_back(user->inputUser);
+	}
+	const auto finish = [=] {
+		for (const auto user : users) {
+			_peerRequests.remove(user);
+		}
+	};
+	const auto requestId = request(MTPusers_GetUsers(
+		MTP_vector<MTPInputUser>(inputs)
+	)).done([=](const MTPVector<MTPUser> &result) {
+		finish();
+		_session->data().processUsers(result);
+	}).fail([=](const RPCError &error) {
+		finish();
+	}).send();
+	for (const auto user : users) {
+		_peerRequests[user] = requestId;
+	}
+}
+
+void ApiWrap::sendPeersRequest(std::vector<not_null<ChatData*>> &&chats) {
+	auto inputs = QVector<MTPint>();
+	inputs.reserve(chats.size());
+	for (const auto chat : chats) {
+		inputs.push_back(chat->inputChat);
+	}
+	const auto finish = [=] {
+		for (const auto chat : chats) {
+			_peerRequests.remove(chat);
+		}
+	};
+	const auto requestId = request(MTPmessages_GetChats(
+		MTP_vector<MTPint>(inputs)
+	)).done([=](const MTPmessages_Chats &result) {
+		finish();
+		const auto &list = result.match([](const auto &data) {
+			return data.vchats();
+		});
+		_session->data().applyMaximumChatVersions(list);
+		_session->data().processChats(list);
+	}).fail([=](const RPCError &error) {
+		finish();
+	}).send();
+	for (const auto chat : chats) {
+		_peerRequests[chat] = requestId;
+	}
+}
+
+void ApiWrap::sendPeersRequest(
+		std::vector<not_null<ChannelData*>> &&channels) {
+	auto inputs = QVector<MTPInputChannel>();
+	inputs.reserve(channels.size());
+	for (const auto channel : channels) {
+		inputs.push_back(channel->inputChannel);
+	}
+	const auto finish = [=] {
+		for (const auto channel : channels) {
+			_peerRequests.remove(channel);
+		}
+	};
+	const auto requestId = request(MTPchannels_GetChannels(
+		MTP_vector<MTPInputChannel>(inputs)
+	)).done([=](const MTPmessages_Chats &result) {
+		finish();
+		const auto &list = result.match([](const auto &data) {
+			return data.vchats();
+		});
+		_session->data().applyMaximumChatVersions(list);
+		_session->data().processChats(list);
+	}).fail([=](const RPCError &error) {
+		finish();
+	}).send();
+	for (const auto channel : channels) {
+		_peerRequests[channel] = requestId;
+	}
 }
 
 void ApiWrap::requestPeerSettings(not_null<PeerData*> peer) {
@@ -1443,38 +1533,8 @@ void ApiWrap::migrateFail(not_null<PeerData*> peer, const RPCError &error) {
 
 void ApiWrap::markMediaRead(
 		const base::flat_set<not_null<HistoryItem*>> &items) {
-	auto markedIds = QVector<MTPint>();
-	auto channelMarkedIds = base::flat_map<
-		not_null<ChannelData*>,
-		QVector<MTPint>>();
-	markedIds.reserve(items.size());
 	for (const auto item : items) {
-		if ((!item->isUnreadMedia() || item->out())
-			&& !item->isUnreadMention()) {
-			continue;
-		}
-		item->markMediaRead();
-		if (!IsServerMsgId(item->id)) {
-			continue;
-		}
-		if (const auto channel = item->history()->peer->asChannel()) {
-			channelMarkedIds[channel].push_back(MTP_int(item->id));
-		} else {
-			markedIds.push_back(MTP_int(item->id));
-		}
-	}
-	if (!markedIds.isEmpty()) {
-		request(MTPmessages_ReadMessageContents(
-			MTP_vector<MTPint>(markedIds)
-		)).done([=](const MTPmessages_AffectedMessages &result) {
-			applyAffectedMessages(result);
-		}).send();
-	}
-	for (const auto &channelIds : channelMarkedIds) {
-		request(MTPchannels_ReadMessageContents(
-			channelIds.first->inputChannel,
-			MTP_vector<MTPint>(channelIds.second)
-		)).send();
+		markMediaRead(item);
 	}
 }
 
@@ -1487,152 +1547,161 @@ void ApiWrap::markMediaRead(not_null<HistoryItem*> item) {
 	if (!IsServerMsgId(item->id)) {
 		return;
 	}
-	const auto ids = MTP_vector<MTPint>(1, MTP_int(item->id));
 	if (const auto channel = item->history()->peer->asChannel()) {
-		request(MTPchannels_ReadMessageContents(
-			channel->inputChannel,
-			ids
-		)).send();
+		_channelMediaReadPending[channel].push_back(MTP_int(item->id));
 	} else {
+		_mediaReadPending.push_back(MTP_int(item->id));
+	}
+	if (!_readRequestsTimer.isActive()) {
+		_readRequestsTimer.callOnce(kReadRequestsDelay);
+	}
+}
+
+void ApiWrap::sendMediaReadRequests() {
+	if (!_mediaReadPending.isEmpty()) {
 		request(MTPmessages_ReadMessageContents(
-			ids
+			MTP_vector<MTPint>(base::take(_mediaReadPending))
 		)).done([=](const MTPmessages_AffectedMessages &result) {
 			applyAffectedMessages(result);
 		}).send();
 	}
+	for (const auto &[channel, ids] : base::take(_channelMediaReadPending)) {
+		request(MTPchannels_ReadMessageContents(
+			channel->inputChannel,
+			MTP_vector<MTPint>(ids)
+		)).send();
+	}
 }
 
 void ApiWrap::requestPeers(const QList<PeerData*> &peers) {
-	QVector<MTPint> chats;
-	QVector<MTPInputChannel> channels;
-	QVector<MTPInputUser> users;
-	chats.reserve(peers.size());
-	channels.reserve(peers.size());
-	users.reserve(peers.size());
 	for (const auto peer : peers) {
-		if (!peer
-			|| _fullPeerRequests.contains(peer)
-			|| _peerRequests.contains(peer)) {
-			continue;
-		}
-		if (const auto user = peer->asUser()) {
-			users.push_back(user->inputUser);
-		} else if (const auto chat = peer->asChat()) {
-			chats.push_back(chat->inputChat);
-		} else if (const auto channel = peer->asChannel()) {
-			channels.push_back(channel->inputChannel);
+		if (peer) {
+			requestPeer(peer);
 		}
 	}
-	const auto handleChats = [=](const MTPmessages_Chats &result) {
-		_session->data().processChats(result.match([](const auto &data) {
-			return data.vchats();
-		}));
-	};
-	if (!chats.isEmpty()) {
-		request(MTPmessages_GetChats(
-			MTP_vector<MTPint>(chats)
-		)).done(handleChats).send();
-	}
-	if (!channels.isEmpty()) {
-		request(MTPchannels_GetChannels(
-			MTP_vector<MTPInputChannel>(channels)
-		)).done(handleChats).send();
-	}
-	if (!users.isEmpty()) {
-		request(MTPusers_GetUsers(
-			MTP_vector<MTPInputUser>(users)
-		)).done([=](const MTPVector<MTPUser> &result) {
-			_session->data().processUsers(result);
-		}).send();
-	}
 }
 
 void ApiWrap::requestLastParticipants(not_null<ChannelData*> channel) {
-	if (!channel->isMegagroup()
-		|| _participantsRequests.contains(channel)) {
+	requestParticipantsList(channel, Data::ParticipantsList::Recent);
+}
+
+void ApiWrap::requestBots(not_null<ChannelData*> channel) {
+	requestParticipantsList(channel, Data::ParticipantsList::Bots);
+}
+
+void ApiWrap::requestAdmins(not_null<ChannelData*> channel) {
+	requestParticipantsList(channel, Data::ParticipantsList::Admins);
+}
+
+ApiWrap::PeerRequests &ApiWrap::participantsRequests(
+		Data::ParticipantsList list) {
+	switch (list) {
+	case Data::ParticipantsList::Recent: return _participantsRequests;
+	case Data::ParticipantsList::Bots: return _botsRequests;
+	case Data::ParticipantsList::Admins: return _adminsRequests;
+	}
+	Unexpected("List in ApiWrap::participantsRequests.");
+}
+
+// The list cached from the last request is shown right away and its hash
+// lets the server answer with channelParticipantsNotModified.
+void ApiWrap::requestParticipantsList(
+		not_null<ChannelData*> channel,
+		Data::ParticipantsList list) {
+	auto &requests = participantsRequests(list);
+	if (!channel->isMegagroup() || requests.contains(channel)) {
+		return;
+	}
+	if (!_cachedParticipants.loaded(channel, list)) {
+		requests.insert(channel, 0);
+		_cachedParticipants.load(channel, list, [=] {
+			participantsRequests(list).remove(channel);
+			if (const auto cached = _cachedParticipants.lookup(
+					channel,
+					list)) {
+				applyParticipantsList(channel, list, *cached);
+			}
+			requestParticipantsList(channel, list);
+		});
 		return;
 	}
 
+	const auto filter = [&] {
+		switch (list) {
+		case Data::ParticipantsList::Recent:
+			return MTP_channelParticipantsRecent();
+		case Data::ParticipantsList::Bots:
+			return MTP_channelParticipantsBots();
+		case Data::ParticipantsList::Admins:
+			return MTP_channelParticipantsAdmins();
+		}
+		Unexpected("List in ApiWrap::requestParticipantsList.");
+	}();
 	const auto offset = 0;
-	const auto participantsHash = 0;
+	const auto participantsHash = _cachedParticipants.hash(channel, list);
 	const auto requestId = request(MTPchannels_GetParticipants(
 		channel->inputChannel,
-		MTP_channelParticipantsRecent(),
+		filter,
 		MTP_int(offset),
 		MTP_int(Global::ChatSizeMax()),
 		MTP_int(participantsHash)
 	)).done([=](const MTPchannels_ChannelParticipants &result) {
-		_participantsRequests.remove(channel);
-		parseChannelParticipants(channel, result, [&](
-				int availableCount,
-				const QVector<MTPChannelParticipant> &list) {
-			applyLastParticipantsList(
-				channel,
-				availableCount,
-				list);
+		participantsRequests(list).remove(channel);
+		result.match([&](const MTPDchannels_channelParticipants &data) {
+			_cachedParticipants.store(channel, list, data);
+			applyParticipantsList(channel, list, result);
+		}, [&](const MTPDchannels_channelParticipantsNotModified &) {
+			if (const auto cached = _cachedParticipants.lookup(
+					channel,
+					list)) {
+				applyParticipantsList(channel, list, *cached);
+			} else {
+				LOG(("API Error: "
+					"channels.channelParticipantsNotModified received!"));
+			}
 		});
-	}).fail([this, channel](const RPCError &error) {
-		_participantsRequests.remove(channel);
+	}).fail([=](const RPCError &error) {
+		participantsRequests(list).remove(channel);
 	}).send();
 
-	_participantsRequests.insert(channel, requestId);
+	requests.insert(channel, requestId);
 }
 
-void ApiWrap::requestBots(not_null<ChannelData*> channel) {
-	if (!channel->isMegagroup() || _botsRequests.contains(channel)) {
+void ApiWrap::applyParticipantsList(
+		not_null<ChannelData*> channel,
+		Data::ParticipantsList list,
+		const MTPchannels_ChannelParticipants &result) {
+	if (!channel->isMegagroup()) {
 		return;
 	}
-
-	auto offset = 0;
-	auto participantsHash = 0;
-	auto requestId = request(MTPchannels_GetParticipants(
-		channel->inputChannel,
-		MTP_channelParticipantsBots(),
-		MTP_int(offset),
-		MTP_int(Global::ChatSizeMax()),
-		MTP_int(participantsHash)
-	)).done([this, channel](const MTPchannels_ChannelParticipants &result) {
-		_botsRequests.remove(channel);
+	switch (list) {
+	case Data::ParticipantsList::Recent:
+		parseChannelParticipants(channel, result, [&](
+				int availableCount,
+				const QVector<MTPChannelParticipant> &participants) {
+			applyLastParticipantsList(
+				channel,
+				availableCount,
+				participants);
+		});
+		break;
+	case Data::ParticipantsList::Bots:
 		parseChannelParticipants(channel, result, [&](
 				int availableCount,
-				const QVector<MTPChannelParticipant> &list) {
+				const QVector<MTPChannelParticipant> &participants) {
 			applyBotsList(
 				channel,
 				availableCount,
-				list);
+				participants);
 		});
-	}).fail([this, channel](const RPCError &error) {
-		_botsRequests.remove(channel);
-	}).send();
-
-	_botsRequests.insert(channel, requestId);
-}
-
-void ApiWrap::requestAdmins(not_null<ChannelData*> channel) {
-	if (!channel->isMegagroup() || _adminsRequests.contains(channel)) {
-		return;
-	}
-
-	auto offset = 0;
-	auto participantsHash = 0;
-	auto requestId = request(MTPchannels_GetParticipants(
-		channel->inputChannel,
-		MTP_channelParticipantsAdmins(),
-		MTP_int(offset),
-		MTP_int(Global::ChatSizeMax()),
-		MTP_int(participantsHash)
-	)).done([this, channel](const MTPchannels_ChannelParticipants &result) {
-		_adminsRequests.remove(channel);
+		break;
+	case Data::ParticipantsList::Admins:
 		result.match([&](const MTPDchannels_channelParticipants &data) {
 			Data::ApplyMegagroupAdmins(channel, data);
-		}, [&](const MTPDchannels_channelParticipantsNotModified &) {
-			LOG(("API Error: channels.channelParticipantsNotModified received!"));
+		}, [](const MTPDchannels_channelParticipantsNotModified &) {
 		});
-	}).fail([this, channel](const RPCError &error) {
-		_adminsRequests.remove(channel);
-	}).send();
-
-	_adminsRequests.insert(channel, requestId);
+		break;
+	}
 }
 
 void ApiWrap::applyLastParticipantsList(
@@ -4663,7 +4732,8 @@ void ApiWrap::sendVoiceMessage(
 		QByteArray result,
 		VoiceWaveform waveform,
 		int duration,
-		const SendAction &action) {
+		const SendAction &action,
+		uint64 preuploadId) {
 	const auto caption = TextWithTags();
 	const auto to = fileLoadTaskOptions(action);
 	_fileLoader->addTask(std::make_unique<FileLoadTask>(
@@ -4671,7 +4741,8 @@ void ApiWrap::sendVoiceMessage(
 		duration,
 		waveform,
 		to,
-		caption));
+		caption,
+		preuploadId));
 }
 
 void ApiWrap::editMedia(
@@ -5054,6 +5125,7 @@ void ApiWrap::sendMessage(MessageToSend &&message) {
 			}
 			history->clearSentDraftText(QString());
 		}).afterRequest(history->sendRequestId
+		).withPriority(MTP::RequestPriority::Interactive
 		).send();
 	}
 
@@ -5963,19 +6035,47 @@ void ApiWrap::closePoll(not_null<HistoryItem*> item) {
 void ApiWrap::reloadPollResults(not_null<HistoryItem*> item) {
 	const auto itemId = item->fullId();
 	if (!IsServerMsgId(item->id)
-		|| _pollReloadRequestIds.contains(itemId)) {
+		|| _pollReloadRequestIds.contains(itemId)
+		|| (ranges::find(_pollReloadQueue, itemId)
+			!= end(_pollReloadQueue))) {
 		return;
 	}
-	const auto requestId = request(MTPmessages_GetPollResults(
-		item->history()->peer->input,
-		MTP_int(item->id)
-	)).done([=](const MTPUpdates &result) {
-		_pollReloadRequestIds.erase(itemId);
-		applyUpdates(result);
-	}).fail([=](const RPCError &error) {
+	_pollReloadQueue.push_back(itemId);
+	if (!_pollReloadTimer.isActive()) {
+		_pollReloadTimer.callOnce(kPollReloadDelay);
+	}
+}
+
+void ApiWrap::sendPollReloadRequests() {
+	const auto finish = [=](FullMsgId itemId) {
 		_pollReloadRequestIds.erase(itemId);
-	}).send();
-	_pollReloadRequestIds.emplace(itemId, requestId);
+		if (!_pollReloadQueue.empty() && !_pollReloadTimer.isActive()) {
+			_pollReloadTimer.callOnce(kPollReloadDelay);
+		}
+	};
+	while (!_pollReloadQueue.empty()
+		&& int(_pollReloadRequestIds.size()) < kPollReloadRequestsMax) {
+		const auto itemId = _pollReloadQueue.front();
+		_pollReloadQueue.pop_front();
+		const auto item = _session->data().message(itemId);
+		if (!item) {
+			continue;
+		}
+		// The requests of one batch go in one container.
+		const auto requestId = request(MTPmessages_GetPollResults(
+			item->history()->peer->input,
+			MTP_int(item->id)
+		)).done([=](const MTPUpdates &result) {
+			finish(itemId);
+			applyUpdates(result);
+		}).fail([=](const RPCError &error) {
+			finish(itemId);
+		}).afterDelay(kSmallDelayMs).send();
+		_pollReloadRequestIds.emplace(itemId, requestId);
+	}
+	if (!_pollReloadQueue.empty()) {
+		_pollReloadTimer.callOnce(kPollReloadDelay);
+	}
 }
 
 void ApiWrap::readServerHistory(not_null<History*> history) {
@@ -6004,16 +6104,32 @@ void ApiWrap::readServerHistoryForce(not_null<History*> history) {
 		}
 	}
 
-	if (_readRequests.contains(peer)) {
-		const auto i = _readRequestsPending.find(peer);
-		if (i == _readRequestsPending.cend()) {
-			_readRequestsPending.emplace(peer, upTo);
-		} else if (i->second < upTo) {
-			i->second = upTo;
+	// The counters are updated already, only the highest id is sent
+	// after a short delay or when the current request is finished.
+	const auto i = _readRequestsPending.find(peer);
+	if (i == _readRequestsPending.cend()) {
+		_readRequestsPending.emplace(peer, upTo);
+	} else if (i->second < upTo) {
+		i->second = upTo;
+	}
+	if (!_readRequests.contains(peer) && !_readRequestsTimer.isActive()) {
+		_readRequestsTimer.callOnce(kReadRequestsDelay);
+	}
+}
+
+void ApiWrap::sendPendingReadRequests() {
+	_readRequestsTimer.cancel();
+	for (auto i = begin(_readRequestsPending); i != end(_readRequestsPending);) {
+		if (_readRequests.contains(i->first)) {
+			++i;
+			continue;
 		}
-	} else {
+		const auto peer = i->first;
+		const auto upTo = i->second;
+		i = _readRequestsPending.erase(i);
 		sendReadRequest(peer, upTo);
 	}
+	sendMediaReadRequests();
 }
 // // #feed
 //void ApiWrap::readFeed(
@@ -6090,7 +6206,7 @@ void ApiWrap::sendReadRequest(not_null<PeerData*> peer, MsgId upTo) {
 				finished();
 			}).fail([=](const RPCError &error) {
 				finished();
-			}).send();
+			}).withPriority(MTP::RequestPriority::Interactive).send();
 		}
 		return request(MTPmessages_ReadHistory(
 			peer->input,
@@ -6100,7 +6216,7 @@ void ApiWrap::sendReadRequest(not_null<PeerData*> peer, MsgId upTo) {
 			finished();
 		}).fail([=](const RPCError &error) {
 			finished();
-		}).send();
+		}).withPriority(MTP::RequestPriority::Interactive).send();
 	}();
 	_readRequests.emplace(peer, requestId, upTo);
 }
@@ -8,12 +8,14 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #pragma once
 
 #include "api/api_common.h"
+#include "api/api_coalescer.h"
 #include "base/timer.h"
 #include "base/flat_map.h"
 #include "base/flat_set.h"
 #include "mtproto/sender.h"
 #include "chat_helpers/stickers.h"
 #include "data/data_messages.h"
+#include "data/data_cached_participants.h"
 
 class TaskQueue;
 struct MessageGroupId;
@@ -387,6 +389,7 @@ public:
 	void shareContact(not_null<UserData*> user, const SendAction &action);
 	void readServerHistory(not_null<History*> history);
 	void readServerHistoryForce(not_null<History*> history);
+	void sendPendingReadRequests();
 	//void readFeed( // #feed
 	//	not_null<Data::Feed*> feed,
 	//	Data::MessagePosition position);
@@ -395,7 +398,8 @@ public:
 		QByteArray result,
 		VoiceWaveform waveform,
 		int duration,
-		const SendAction &action);
+		const SendAction &action,
+		uint64 preuploadId = 0);
 	void sendFiles(
 		Storage::PreparedList &&list,
 		SendMediaType type,
@@ -478,6 +482,8 @@ public:
 		FullMsgId itemId,
 		const std::vector<QByteArray> &options);
 	void closePoll(not_null<HistoryItem*> item);
+	// Reloads are queued and sent a few at a time to not flood the
+	// server when many polls are scrolled through.
 	void reloadPollResults(not_null<HistoryItem*> item);
 
 	~ApiWrap();
@@ -489,6 +495,7 @@ private:
 		Callbacks callbacks;
 	};
 	using MessageDataRequests = QMap<MsgId, MessageDataRequest>;
+	using PeerRequests = QMap<PeerData*, mtpRequestId>;
 	using SharedMediaType = Storage::SharedMediaType;
 
 	struct StickersByEmoji {
@@ -522,6 +529,10 @@ private:
 
 	void saveDraftsToCloud();
 
+	void sendPeersRequest(std::vector<not_null<UserData*>> &&users);
+	void sendPeersRequest(std::vector<not_null<ChatData*>> &&chats);
+	void sendPeersRequest(std::vector<not_null<ChannelData*>> &&channels);
+
 	void resolveMessageDatas();
 	void gotMessageDatas(ChannelData *channel, const MTPmessages_Messages &result, mtpRequestId requestId);
 	void finalizeMessageDataRequest(
@@ -540,6 +551,15 @@ private:
 		not_null<UserData*> user,
 		const MTPUserFull &result,
 		mtpRequestId req);
+	PeerRequests &participantsRequests(Data::ParticipantsList list);
+	void requestParticipantsList(
+		not_null<ChannelData*> channel,
+		Data::ParticipantsList list);
+	void sendPollReloadRequests();
+	void applyParticipantsList(
+		not_null<ChannelData*> channel,
+		Data::ParticipantsList list,
+		const MTPchannels_ChannelParticipants &result);
 	void applyLastParticipantsList(
 		not_null<ChannelData*> channel,
 		int availableCount,
@@ -623,6 +643,7 @@ private:
 		bool justClear,
 		bool revoke);
 	void sendReadRequest(not_null<PeerData*> peer, MsgId upTo);
+	void sendMediaReadRequests();
 	int applyAffectedHistory(
 		not_null<PeerData*> peer,
 		const MTPmessages_AffectedHistory &result);
@@ -696,14 +717,17 @@ private:
 	QMap<ChannelData*, MessageDataRequests> _channelMessageDataRequests;
 	SingleQueuedInvokation _messageDataResolveDelayed;
 
-	using PeerRequests = QMap<PeerData*, mtpRequestId>;
 	PeerRequests _fullPeerRequests;
 	PeerRequests _peerRequests;
+	Api::Coalescer<not_null<UserData*>> _usersRequests;
+	Api::Coalescer<not_null<ChatData*>> _chatsRequests;
+	Api::Coalescer<not_null<ChannelData*>> _channelsRequests;
 	base::flat_set<not_null<PeerData*>> _requestedPeerSettings;
 
 	PeerRequests _participantsRequests;
 	PeerRequests _botsRequests;
 	PeerRequests _adminsRequests;
+	Data::CachedParticipants _cachedParticipants;
 	base::DelayedCallTimer _participantsCountRequestTimer;
 
 	ChannelData *_channelMembersForAdd = nullptr;
@@ -812,6 +836,11 @@ private:
 	};
 	base::flat_map<not_null<PeerData*>, ReadRequest> _readRequests;
 	base::flat_map<not_null<PeerData*>, MsgId> _readRequestsPending;
+	QVector<MTPint> _mediaReadPending;
+	base::flat_map<
+		not_null<ChannelData*>,
+		QVector<MTPint>> _channelMediaReadPending;
+	base::Timer _readRequestsTimer;
 
 	std::unique_ptr<TaskQueue> _fileLoader;
 	base::flat_map<uint64, std::shared_ptr<SendingAlbum>> _sendingAlbums;
@@ -881,6 +910,8 @@ private:
 	base::flat_map<FullMsgId, mtpRequestId> _pollVotesRequestIds;
 	base::flat_map<FullMsgId, mtpRequestId> _pollCloseRequestIds;
 	base::flat_map<FullMsgId, mtpRequestId> _pollReloadRequestIds;
+	std::deque<FullMsgId> _pollReloadQueue;
+	base::Timer _pollReloadTimer;
 
 	mtpRequestId _wallPaperRequestId = 0;
 	QString _wallPaperSlug;
@@ -73,6 +73,70 @@ namespace {
 
 	int32 serviceImageCacheSize = 0;
 
+	QImage ReadImage(
+			QByteArray data,
+			QByteArray *format,
+			bool opaque,
+			bool *animated,
+			int size = 0,
+			QSize *original = nullptr) {
+        QByteArray tmpFormat;
+		QImage result;
+		QBuffer buffer(&data);
+        if (!format) {
+            format = &tmpFormat;
+        }
+		{
+			QImageReader reader(&buffer, *format);
+#ifndef OS_MAC_OLD
+			reader.setAutoTransform(true);
+#endif // OS_MAC_OLD
+			if (animated) *animated = reader.supportsAnimation() && reader.imageCount() > 1;
+			QByteArray fmt = reader.format();
+			if (!fmt.isEmpty()) *format = fmt;
+			const auto full = (size > 0)
+				? Images::PrepareReaderForSize(reader, size)
+				: QSize();
+			if (!reader.read(&result)) {
+				return QImage();
+			}
+			fmt = reader.format();
+			if (!fmt.isEmpty()) *format = fmt;
+			if (original) {
+				*original = full.isValid() ? full : result.size();
+			}
+		}
+		buffer.seek(0);
+		auto fmt = QString::fromUtf8(*format).toLower();
+		if (fmt == "jpg" || fmt == "jpeg") {
+#ifdef OS_MAC_OLD
+			if (auto exifData = exif_data_new_from_data((const uchar*)(data.constData()), data.size())) {
+				auto byteOrder = exif_data_get_byte_order(exifData);
+				if (auto exifEntry = exif_data_get_entry(exifData, EXIF_TAG_ORIENTATION)) {
+					auto orientationFix = [exifEntry, byteOrder] {
+						auto orientation = exif_get_short(exifEntry->data, byteOrder);
+						switch (orientation) {
+						case 2: return QTransform(-1, 0, 0, 1, 0, 0);
+						case 3: return QTransform(-1, 0, 0, -1, 0, 0);
+						case 4: return QTransform(1, 0, 0, -1, 0, 0);
+						case 5: return QTransform(0, -1, -1, 0, 0, 0);
+						case 6: return QTransform(0, 1, -1, 0, 0, 0);
+						case 7: return QTransform(0, 1, 1, 0, 0, 0);
+						case 8: return QTransform(0, -1, 1, 0, 0, 0);
+						}
+						return QTransform();
+					};
+					result = result.transformed(orientationFix());
+				}
+				exif_data_free(exifData);
+			}
+#endif // OS_MAC_OLD
+		} else if (opaque) {
+			result = Images::prepareOpaque(std::move(result));
+		}
+		return result;
+	}
+
 } // namespace
 
 namespace App {
@@ -316,55 +380,7 @@ namespace App {
 	}
 
 	QImage readImage(QByteArray data, QByteArray *format, bool opaque, bool *animated) {
-        QByteArray tmpFormat;
-		QImage result;
-		QBuffer buffer(&data);
-        if (!format) {
-            format = &tmpFormat;
-        }
-		{
-			QImageReader reader(&buffer, *format);
-#ifndef OS_MAC_OLD
-			reader.setAutoTransform(true);
-#endif // OS_MAC_OLD
-			if (animated) *animated = reader.supportsAnimation() && reader.imageCount() > 1;
-			QByteArray fmt = reader.format();
-			if (!fmt.isEmpty()) *format = fmt;
-			if (!reader.read(&result)) {
-				return QImage();
-			}
-			fmt = reader.format();
-			if (!fmt.isEmpty()) *format = fmt;
-		}
-		buffer.seek(0);
-		auto fmt = QString::fromUtf8(*format).toLower();
-		if (fmt == "jpg" || fmt == "jpeg") {
-#ifdef OS_MAC_OLD
-			if (auto exifData = exif_data_new_from_data((const uchar*)(data.constData()), data.size())) {
-				auto byteOrder = exif_data_get_byte_order(exifData);
-				if (auto exifEntry = exif_data_get_entry(exifData, EXIF_TAG_ORIENTATION)) {
-					auto orientationFix = [exifEntry, byteOrder] {
-						auto orientation = exif_get_short(exifEntry->data, byteOrder);
-						switch (orientation) {
-						case 2: return QTransform(-1, 0, 0, 1, 0, 0);
-						case 3: return QTransform(-1, 0, 0, -1, 0, 0);
-						case 4: return QTransform(1, 0, 0, -1, 0, 0);
-						case 5: return QTransform(0, -1, -1, 0, 0, 0);
-						case 6: return QTransform(0, 1, -1, 0, 0, 0);
-						case 7: return QTransform(0, 1, 1, 0, 0, 0);
-						case 8: return QTransform(0, -1, 1, 0, 0, 0);
-						}
-						return QTransform();
-					};
-					result = result.transformed(orientationFix());
-				}
-				exif_data_free(exifData);
-			}
-#endif // OS_MAC_OLD
-		} else if (opaque) {
-			result = Images::prepareOpaque(std::move(result));
-		}
-		return result;
+		return ReadImage(std::move(data), format, opaque, animated);
 	}
 
 	QImage readImage(const QString &file, QByteArray *format, bool opaque, bool *animated, QByteArray *content) {
@@ -381,6 +397,19 @@ namespace App {
 		return result;
 	}
 
+	QImage readImageForSize(QByteArray data, int size, QSize *original, bool opaque, bool *animated) {
+		return ReadImage(std::move(data), nullptr, opaque, animated, size, original);
+	}
+
+	QImage readImageForSize(const QString &file, int size, QSize *original, bool opaque, bool *animated) {
+		QFile f(file);
+		if (f.size() > kImageSizeLimit || !f.open(QIODevice::ReadOnly)) {
+			if (animated) *animated = false;
+			return QImage();
+		}
+		return ReadImage(f.readAll(), nullptr, opaque, animated, size, original);
+	}
+
 	QPixmap pixmapFromImageInPlace(QImage &&image) {
 		return QPixmap::fromImage(std::move(image), Qt::ColorOnly);
 	}
@@ -99,6 +99,11 @@ namespace App {
 	constexpr auto kImageSizeLimit = 64 * 1024 * 1024; // Open images up to 64mb jpg/png/gif
 	QImage readImage(QByteArray data, QByteArray *format = nullptr, bool opaque = true, bool *animated = nullptr);
 	QImage readImage(const QString &file, QByteArray *format = nullptr, bool opaque = true, bool *animated = nullptr, QByteArray *content = 0);
+
+	// Big JPEG images are decoded reduced to what's needed to fit in
+	// a square of the given size, 'original' gets the full image size.
+	QImage readImageForSize(QByteArray data, int size, QSize *original = nullptr, bool opaque = true, bool *animated = nullptr);
+	QImage readImageForSize(const QString &file, int size, QSize *original = nullptr, bool opaque = true, bool *animated = nullptr);
 	QPixmap pixmapFromImageInPlace(QImage &&image);
 
 	void complexOverlayRect(Painter &p, QRect rect, ImageRoundRadius radius, RectParts corners);
@@ -0,0 +1,271 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "base/flat_map.h"
+#include "base/timer.h"
+#include "base/weak_ptr.h"
+#include <rpl/rpl.h>
+
+#include <QtCore/QCoreApplication>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+// Every benchmark prints one JSON object per line, for example:
+// {"benchmark":"flat_map","case":"find","size":64,"ops":1048576,
+//  "ns_per_op":12.5}
+
+namespace {
+
+constexpr auto kOperations = 1 << 20;
+constexpr auto kSubscribers = { 1, 8, 64, 512 };
+constexpr auto kSizes = { 8, 64, 512, 4096, 32768 };
+constexpr auto kTimers = { 1, 16, 256 };
+
+using Clock = std::chrono::steady_clock;
+
+// Keeps the measured results from being optimized away.
+volatile long long Sink = 0;
+
+struct Result {
+	const char *benchmark = nullptr;
+	const char *name = nullptr;
+	int size = 0;
+	long long ops = 0;
+	Clock::duration duration = Clock::duration();
+};
+
+void Print(const Result &result) {
+	const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		result.duration).count();
+	std::cout
+		<< "{\"benchmark\":\"" << result.benchmark << "\""
+		<< ",\"case\":\"" << result.name << "\""
+		<< ",\"size\":" << result.size
+		<< ",\"ops\":" << result.ops
+		<< ",\"ns_per_op\":" << (double(ns) / std::max(result.ops, 1LL))
+		<< "}" << std::endl;
+}
+
+template <typename Method>
+void Measure(
+		const char *benchmark,
+		const char *name,
+		int size,
+		long long ops,
+		Method &&method) {
+	const auto started = Clock::now();
+	method();
+	Print({ benchmark, name, size, ops, Clock::now() - started });
+}
+
+std::vector<int> ShuffledKeys(int size) {
+	auto result = std::vector<int>(size);
+	std::iota(begin(result), end(result), 0);
+	std::shuffle(begin(result), end(result), std::mt19937(size));
+	return result;
+}
+
+// All three containers are filled and drained in the same random order.
+template <typename Container>
+void RunContainer(const char *benchmark, int size) {
+	const auto keys = ShuffledKeys(size);
+	const auto rounds = std::max(kOperations / size, 1);
+	const auto ops = (long long)rounds * size;
+	auto containers = std::vector<Container>(rounds);
+
+	Measure(benchmark, "insert", size, ops, [&] {
+		for (auto &container : containers) {
+			for (const auto key : keys) {
+				container.emplace(key, key);
+			}
+		}
+	});
+	Measure(benchmark, "find", size, ops, [&] {
+		auto sum = 0LL;
+		auto &container = containers.front();
+		for (auto i = 0; i != rounds; ++i) {
+			for (const auto key : keys) {
+				sum += container.find(key)->second;
+			}
+		}
+		Sink = sum;
+	});
+	Measure(benchmark, "iterate", size, ops, [&] {
+		auto sum = 0LL;
+		auto &container = containers.front();
+		for (auto i = 0; i != rounds; ++i) {
+			for (const auto &[key, value] : container) {
+				sum += value;
+			}
+		}
+		Sink = sum;
+	});
+	Measure(benchmark, "erase", size, ops, [&] {
+		for (auto &container : containers) {
+			for (const auto key : keys) {
+				container.erase(key);
+			}
+		}
+	});
+}
+
+class Guarded final : public base::has_weak_ptr {
+public:
+	int value = 1;
+
+};
+
+} // namespace
+
+TEST_CASE("rpl event_stream fire", "[.benchmark]") {
+	for (const auto subscribers : kSubscribers) {
+		auto lifetime = rpl::lifetime();
+		auto stream = rpl::event_stream<int>();
+		auto sum = 0LL;
+		for (auto i = 0; i != subscribers; ++i) {
+			stream.events(
+			) | rpl::start_with_next([&](int value) {
+				sum += value;
+			}, lifetime);
+		}
+		const auto fires = std::max(kOperations / subscribers, 1);
+		Measure("rpl_event_stream", "fire", subscribers, fires, [&] {
+			for (auto i = 0; i != fires; ++i) {
+				stream.fire_copy(i);
+			}
+		});
+		Sink = sum;
+
+		// Unsubscribed consumers are dropped only by the next fire.
+		const auto churn = std::max((kOperations >> 6) / subscribers, 1);
+		Measure("rpl_event_stream", "subscribe", subscribers, churn, [&] {
+			for (auto i = 0; i != churn; ++i) {
+				auto single = rpl::lifetime();
+				stream.events(
+				) | rpl::start_with_next([&](int value) {
+					sum += value;
+				}, single);
+			}
+		});
+	}
+}
+
+TEST_CASE("rpl variable update", "[.benchmark]") {
+	for (const auto subscribers : kSubscribers) {
+		auto lifetime = rpl::lifetime();
+		auto variable = rpl::variable<int>(-1);
+		auto sum = 0LL;
+		for (auto i = 0; i != subscribers; ++i) {
+			variable.value(
+			) | rpl::start_with_next([&](int value) {
+				sum += value;
+			}, lifetime);
+		}
+		const auto updates = std::max(kOperations / subscribers, 1);
+		Measure("rpl_variable", "change", subscribers, updates, [&] {
+			for (auto i = 0; i != updates; ++i) {
+				variable = i;
+			}
+		});
+		Measure("rpl_variable", "same", subscribers, updates, [&] {
+			for (auto i = 0; i != updates; ++i) {
+				variable = (updates - 1);
+			}
+		});
+		Sink = sum;
+	}
+}
+
+TEST_CASE("containers insert find erase", "[.benchmark]") {
+	for (const auto size : kSizes) {
+		RunContainer<base::flat_map<int, int>>("flat_map", size);
+		RunContainer<std::map<int, int>>("std_map", size);
+		RunContainer<std::unordered_map<int, int>>("unordered_map", size);
+	}
+}
+
+TEST_CASE("base weak_ptr checks", "[.benchmark]") {
+	auto guarded = Guarded();
+	const auto weak = base::make_weak(&guarded);
+	Measure("weak_ptr", "check", 1, kOperations, [&] {
+		auto sum = 0LL;
+		for (auto i = 0; i != kOperations; ++i) {
+			if (const auto strong = weak.get()) {
+				sum += strong->value;
+			}
+		}
+		Sink = sum;
+	});
+	Measure("weak_ptr", "copy", 1, kOperations, [&] {
+		auto sum = 0LL;
+		for (auto i = 0; i != kOperations; ++i) {
+			const auto copy = weak;
+			sum += copy ? 1 : 0;
+		}
+		Sink = sum;
+	});
+	Measure("weak_ptr", "make", 1, kOperations, [&] {
+		auto sum = 0LL;
+		for (auto i = 0; i != kOperations; ++i) {
+			sum += base::make_weak(&guarded) ? 1 : 0;
+		}
+		Sink = sum;
+	});
+}
+
+TEST_CASE("base Timer churn", "[.benchmark]") {
+	auto argc = 0;
+	auto application = QCoreApplication(argc, nullptr);
+	for (const auto count : kTimers) {
+		auto fired = 0;
+		auto timers = std::vector<std::unique_ptr<base::Timer>>();
+		for (auto i = 0; i != count; ++i) {
+			timers.push_back(std::make_unique<base::Timer>([&] {
+				++fired;
+			}));
+		}
+		const auto rounds = std::max((kOperations >> 4) / count, 1);
+		const auto ops = (long long)rounds * count;
+
+		// Restarting an active timer is what most delayed updates do.
+		Measure("timer", "restart", count, ops, [&] {
+			for (auto i = 0; i != rounds; ++i) {
+				for (const auto &timer : timers) {
+					timer->callOnce(1000 + i);
+				}
+			}
+		});
+		Measure("timer", "cancel", count, ops, [&] {
+			for (auto i = 0; i != rounds; ++i) {
+				for (const auto &timer : timers) {
+					timer->callOnce(1000);
+					timer->cancel();
+				}
+			}
+		});
+		const auto fireRounds = std::max(rounds >> 6, 1);
+		Measure("timer", "fire", count, (long long)fireRounds * count, [&] {
+			for (auto i = 0; i != fireRounds; ++i) {
+				const auto till = fired + count;
+				for (const auto &timer : timers) {
+					timer->callOnce(0);
+				}
+				while (fired < till) {
+					QCoreApplication::processEvents();
+				}
+			}
+		});
+	}
+}
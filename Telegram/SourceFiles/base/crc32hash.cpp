@@ -10,21 +10,36 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 namespace base {
 namespace {
 
+// Slicing-by-8: eight tables let us process eight bytes at a time.
+constexpr auto kSlices = 8;
+
 class Crc32Table {
 public:
 	Crc32Table() {
 		auto poly = std::uint32_t(0x04c11db7);
 		for (auto i = 0; i != 256; ++i) {
-			_data[i] = reflect(i, 8) << 24;
+			auto &value = _data[0][i];
+			value = reflect(i, 8) << 24;
 			for (auto j = 0; j != 8; ++j) {
-				_data[i] = (_data[i] << 1) ^ (_data[i] & (1 << 31) ? poly : 0);
+				value = (value << 1) ^ (value & (1 << 31) ? poly : 0);
+			}
+			value = reflect(value, 32);
+		}
+		for (auto slice = 1; slice != kSlices; ++slice) {
+			for (auto i = 0; i != 256; ++i) {
+				const auto previous = _data[slice - 1][i];
+				_data[slice][i] = (previous >> 8)
+					^ _data[0][previous & 0xFF];
 			}
-			_data[i] = reflect(_data[i], 32);
 		}
 	}
 
 	std::uint32_t operator[](int index) const {
-		return _data[index];
+		return _data[0][index];
+	}
+
+	std::uint32_t operator()(int slice, int index) const {
+		return _data[slice][index];
 	}
 
 private:
@@ -39,18 +54,37 @@ private:
 		return result;
 	}
 
-	std::uint32_t _data[256];
+	std::uint32_t _data[kSlices][256];
 
 };
 
+std::uint32_t ReadLittleEndian(const std::uint8_t *buffer) {
+	return std::uint32_t(buffer[0])
+		| (std::uint32_t(buffer[1]) << 8)
+		| (std::uint32_t(buffer[2]) << 16)
+		| (std::uint32_t(buffer[3]) << 24);
+}
+
 } // namespace
 
 std::int32_t crc32(const void *data, int len) {
 	static const auto kTable = Crc32Table();
 
-	const auto buffer = static_cast<const std::uint8_t*>(data);
+	auto buffer = static_cast<const std::uint8_t*>(data);
 
 	auto crc = std::uint32_t(0xffffffff);
+	for (; len >= kSlices; len -= kSlices, buffer += kSlices) {
+		const auto low = crc ^ ReadLittleEndian(buffer);
+		const auto high = ReadLittleEndian(buffer + 4);
+		crc = kTable(7, low & 0xFF)
+			^ kTable(6, (low >> 8) & 0xFF)
+			^ kTable(5, (low >> 16) & 0xFF)
+			^ kTable(4, low >> 24)
+			^ kTable(3, high & 0xFF)
+			^ kTable(2, (high >> 8) & 0xFF)
+			^ kTable(1, (high >> 16) & 0xFF)
+			^ kTable(0, high >> 24);
+	}
 	for (auto i = 0; i != len; ++i) {
 		crc = (crc >> 8) ^ kTable[(crc & 0xFF) ^ buffer[i]];
 	}
@@ -0,0 +1,47 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "base/crc32hash.h"
+#include <vector>
+
+namespace {
+
+// The plain bytewise algorithm to compare the fast one with.
+std::int32_t Reference(const void *data, int len) {
+	const auto buffer = static_cast<const std::uint8_t*>(data);
+	auto crc = std::uint32_t(0xffffffff);
+	for (auto i = 0; i != len; ++i) {
+		crc ^= buffer[i];
+		for (auto j = 0; j != 8; ++j) {
+			crc = (crc >> 1) ^ ((crc & 1) ? std::uint32_t(0xedb88320) : 0);
+		}
+	}
+	return static_cast<std::int32_t>(crc ^ 0xffffffff);
+}
+
+} // namespace
+
+TEST_CASE("crc32 known values", "[crc32]") {
+	const auto check = "123456789";
+	REQUIRE(base::crc32(check, 9) == std::int32_t(0xcbf43926));
+	REQUIRE(base::crc32(check, 0) == 0);
+}
+
+TEST_CASE("crc32 matches bytewise computation", "[crc32]") {
+	auto data = std::vector<std::uint8_t>(1031);
+	for (auto i = 0, count = int(data.size()); i != count; ++i) {
+		data[i] = std::uint8_t((i * 131) ^ (i >> 3));
+	}
+	for (auto offset = 0; offset != 8; ++offset) {
+		for (const auto len : { 0, 1, 7, 8, 9, 15, 16, 17, 64, 1000 }) {
+			const auto start = data.data() + offset;
+			REQUIRE(base::crc32(start, len) == Reference(start, len));
+		}
+	}
+}
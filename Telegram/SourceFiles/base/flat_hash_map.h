@@ -0,0 +1,321 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <iterator>
+#include <cstdint>
+#include <algorithm>
+#include <utility>
+
+namespace base {
+
+using std::begin;
+using std::end;
+
+// Open addressing hash map with Robin Hood probing over a single array.
+//
+// Unlike std::unordered_map it doesn't allocate a node for each value,
+// but any insertion or erase invalidates all iterators and pointers.
+template <
+	typename Key,
+	typename Type,
+	typename Hash = std::hash<Key>>
+class flat_hash_map;
+
+template <typename Me, typename Map, typename Value>
+class flat_hash_map_iterator_impl {
+public:
+	using iterator_category = std::forward_iterator_tag;
+	using value_type = std::remove_const_t<Value>;
+	using difference_type = std::ptrdiff_t;
+	using pointer = Value*;
+	using reference = Value&;
+
+	flat_hash_map_iterator_impl() = default;
+	flat_hash_map_iterator_impl(Map *map, std::size_t index)
+	: _map(map)
+	, _index(index) {
+		skipEmpty();
+	}
+
+	reference operator*() const {
+		return _map->_values[_index];
+	}
+	pointer operator->() const {
+		return std::addressof(_map->_values[_index]);
+	}
+	Me &operator++() {
+		++_index;
+		skipEmpty();
+		return static_cast<Me&>(*this);
+	}
+	Me operator++(int) {
+		auto result = static_cast<Me&>(*this);
+		++*this;
+		return result;
+	}
+
+	template <typename OtherMe, typename OtherValue>
+	bool operator==(const flat_hash_map_iterator_impl<
+			OtherMe,
+			std::remove_const_t<Map>,
+			OtherValue> &other) const {
+		return (_index == other._index);
+	}
+	template <typename OtherMe, typename OtherValue>
+	bool operator==(const flat_hash_map_iterator_impl<
+			OtherMe,
+			const std::remove_const_t<Map>,
+			OtherValue> &other) const {
+		return (_index == other._index);
+	}
+	template <typename Other>
+	bool operator!=(const Other &other) const {
+		return !(*this == other);
+	}
+
+private:
+	void skipEmpty() {
+		const auto size = _map->_distances.size();
+		while (_index < size && !_map->_distances[_index]) {
+			++_index;
+		}
+	}
+
+	Map *_map = nullptr;
+	std::size_t _index = 0;
+
+	template <typename OtherMe, typename OtherMap, typename OtherValue>
+	friend class flat_hash_map_iterator_impl;
+
+	template <typename, typename, typename>
+	friend class flat_hash_map;
+
+};
+
+template <typename Key, typename Type, typename Hash>
+class flat_hash_map {
+public:
+	using value_type = std::pair<Key, Type>;
+	using size_type = std::size_t;
+
+	class iterator : public flat_hash_map_iterator_impl<
+			iterator,
+			flat_hash_map,
+			value_type> {
+		using flat_hash_map_iterator_impl<
+			iterator,
+			flat_hash_map,
+			value_type>::flat_hash_map_iterator_impl;
+	};
+	class const_iterator : public flat_hash_map_iterator_impl<
+			const_iterator,
+			const flat_hash_map,
+			const value_type> {
+	public:
+		using flat_hash_map_iterator_impl<
+			const_iterator,
+			const flat_hash_map,
+			const value_type>::flat_hash_map_iterator_impl;
+		const_iterator(const iterator &other)
+		: const_iterator(other._map, other._index) {
+		}
+
+	};
+
+	flat_hash_map() = default;
+
+	size_type size() const {
+		return _size;
+	}
+	bool empty() const {
+		return !_size;
+	}
+	void clear() {
+		_values.clear();
+		_distances.clear();
+		_size = 0;
+	}
+	void reserve(size_type size) {
+		auto capacity = size_type(kMinCapacity);
+		while (capacity * kMaxLoadDivider < size * kMaxLoadMultiplier) {
+			capacity *= 2;
+		}
+		if (capacity > _values.size()) {
+			rehash(capacity);
+		}
+	}
+
+	iterator begin() {
+		return iterator(this, 0);
+	}
+	iterator end() {
+		return iterator(this, _values.size());
+	}
+	const_iterator begin() const {
+		return const_iterator(this, 0);
+	}
+	const_iterator end() const {
+		return const_iterator(this, _values.size());
+	}
+	const_iterator cbegin() const {
+		return begin();
+	}
+	const_iterator cend() const {
+		return end();
+	}
+
+	iterator find(const Key &key) {
+		return iterator(this, findIndex(key));
+	}
+	const_iterator find(const Key &key) const {
+		return const_iterator(this, findIndex(key));
+	}
+	bool contains(const Key &key) const {
+		return findIndex(key) != _values.size();
+	}
+
+	Type &operator[](const Key &key) {
+		const auto index = findIndex(key);
+		if (index != _values.size()) {
+			return _values[index].second;
+		}
+		return _values[insertNew(value_type(key, Type()))].second;
+	}
+
+	template <typename... Args>
+	std::pair<iterator, bool> emplace(const Key &key, Args&&... args) {
+		const auto index = findIndex(key);
+		if (index != _values.size()) {
+			return { iterator(this, index), false };
+		}
+		const auto inserted = insertNew(value_type(
+			key,
+			Type(std::forward<Args>(args)...)));
+		return { iterator(this, inserted), true };
+	}
+
+	void erase(const_iterator i) {
+		eraseIndex(i._index);
+	}
+	bool remove(const Key &key) {
+		const auto index = findIndex(key);
+		if (index == _values.size()) {
+			return false;
+		}
+		eraseIndex(index);
+		return true;
+	}
+
+private:
+	// Zero for an empty slot, otherwise one more than the probe length.
+	using Distance = std::uint32_t;
+
+	static constexpr auto kMinCapacity = size_type(16);
+	static constexpr auto kMaxLoadMultiplier = size_type(8);
+	static constexpr auto kMaxLoadDivider = size_type(7);
+
+	template <typename Me, typename Map, typename Value>
+	friend class flat_hash_map_iterator_impl;
+
+	static size_type Mix(size_type hash) {
+		// Spread weak hash values over the low bits used for indexing.
+		auto result = std::uint64_t(hash);
+		result ^= (result >> 33);
+		result *= 0xFF51AFD7ED558CCDULL;
+		result ^= (result >> 33);
+		return size_type(result);
+	}
+
+	size_type mask() const {
+		return _values.size() - 1;
+	}
+	size_type idealIndex(const Key &key) const {
+		return Mix(Hash()(key)) & mask();
+	}
+
+	size_type findIndex(const Key &key) const {
+		if (!_size) {
+			return _values.size();
+		}
+		auto index = idealIndex(key);
+		for (auto distance = size_type(1);; ++distance) {
+			if (_distances[index] < distance) {
+				return _values.size();
+			} else if (_values[index].first == key) {
+				return index;
+			}
+			index = (index + 1) & mask();
+		}
+	}
+
+	size_type insertNew(value_type &&value) {
+		if ((_size + 1) * kMaxLoadMultiplier
+			> _values.size() * kMaxLoadDivider) {
+			rehash(std::max(_values.size() * 2, kMinCapacity));
+		}
+		const auto key = value.first;
+		insertValue(std::move(value));
+		++_size;
+		return findIndex(key);
+	}
+
+	void insertValue(value_type &&value) {
+		auto index = idealIndex(value.first);
+		auto distance = Distance(1);
+		while (true) {
+			if (!_distances[index]) {
+				_values[index] = std::move(value);
+				_distances[index] = distance;
+				return;
+			} else if (_distances[index] < distance) {
+				std::swap(_values[index], value);
+				std::swap(_distances[index], distance);
+			}
+			++distance;
+			index = (index + 1) & mask();
+		}
+	}
+
+	void eraseIndex(size_type index) {
+		auto next = (index + 1) & mask();
+		while (_distances[next] > 1) {
+			_values[index] = std::move(_values[next]);
+			_distances[index] = _distances[next] - 1;
+			index = next;
+			next = (next + 1) & mask();
+		}
+		_values[index] = value_type();
+		_distances[index] = 0;
+		--_size;
+	}
+
+	void rehash(size_type capacity) {
+		auto values = std::exchange(
+			_values,
+			std::vector<value_type>(capacity));
+		auto distances = std::exchange(
+			_distances,
+			std::vector<Distance>(capacity));
+		const auto count = values.size();
+		for (auto i = size_type(0); i != count; ++i) {
+			if (distances[i]) {
+				insertValue(std::move(values[i]));
+			}
+		}
+	}
+
+	std::vector<value_type> _values;
+	std::vector<Distance> _distances;
+	size_type _size = 0;
+
+};
+
+} // namespace base
@@ -0,0 +1,100 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "base/flat_hash_map.h"
+#include <map>
+#include <string>
+
+struct same_hash {
+	inline std::size_t operator()(int value) const {
+		return std::size_t(value % 4);
+	}
+};
+
+using namespace std;
+
+TEST_CASE("flat_hash_maps should find inserted items", "[flat_hash_map]") {
+	base::flat_hash_map<int, string> v;
+	v.emplace(0, "a");
+	v.emplace(5, "b");
+	v[4] = "d";
+	v[2] = "e";
+
+	REQUIRE(v.size() == 4);
+	REQUIRE(v.find(5) != v.end());
+	REQUIRE(v.find(5)->second == "b");
+	REQUIRE(v[4] == "d");
+	REQUIRE(v.find(3) == v.end());
+
+	SECTION("emplace doesn't replace existing item") {
+		const auto [i, inserted] = v.emplace(0, "c");
+		REQUIRE(!inserted);
+		REQUIRE(i->second == "a");
+		REQUIRE(v.size() == 4);
+	}
+	SECTION("erase removes only one item") {
+		v.erase(v.find(5));
+		REQUIRE(v.size() == 3);
+		REQUIRE(v.find(5) == v.end());
+		REQUIRE(v.find(0) != v.end());
+		REQUIRE(v.remove(4));
+		REQUIRE(!v.remove(4));
+		REQUIRE(v.size() == 2);
+	}
+	SECTION("iteration visits every item once") {
+		auto count = 0;
+		for (const auto &[key, value] : v) {
+			REQUIRE(v.find(key)->second == value);
+			++count;
+		}
+		REQUIRE(count == 4);
+	}
+}
+
+TEST_CASE("flat_hash_maps with colliding hashes", "[flat_hash_map]") {
+	base::flat_hash_map<int, int, same_hash> v;
+	std::map<int, int> check;
+	for (auto i = 0; i != 1000; ++i) {
+		v[i * 7] = i;
+		check[i * 7] = i;
+	}
+	for (auto i = 0; i < 1000; i += 3) {
+		REQUIRE(v.remove(i * 7));
+		check.erase(i * 7);
+	}
+	REQUIRE(v.size() == check.size());
+	for (const auto &[key, value] : check) {
+		const auto i = v.find(key);
+		REQUIRE(i != v.end());
+		REQUIRE(i->second == value);
+	}
+	for (auto i = 0; i < 1000; i += 3) {
+		REQUIRE(v.find(i * 7) == v.end());
+	}
+}
+
+TEST_CASE("simple flat_hash_maps tests", "[flat_hash_map]") {
+	SECTION("copy constructor") {
+		base::flat_hash_map<int, string> v;
+		v.emplace(0, "a");
+		v.emplace(2, "b");
+		auto u = v;
+		REQUIRE(u.size() == 2);
+		REQUIRE(u.find(0)->second == "a");
+		REQUIRE(u.find(2)->second == "b");
+	}
+	SECTION("clear") {
+		base::flat_hash_map<int, string> v;
+		v.emplace(0, "a");
+		v = {};
+		REQUIRE(v.empty());
+		REQUIRE(v.begin() == v.end());
+		REQUIRE(v.find(0) == v.end());
+	}
+}
@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include <deque>
 #include <algorithm>
+#include <iterator>
 #include "base/optional.h"
 
 namespace base {
@@ -329,7 +330,9 @@ public:
 		typename = typename std::iterator_traits<Iterator>::iterator_category>
 	flat_multi_map(Iterator first, Iterator last)
 	: _data(first, last) {
-		std::sort(std::begin(impl()), std::end(impl()), compare());
+		if (!std::is_sorted(std::begin(impl()), std::end(impl()), compare())) {
+			std::sort(std::begin(impl()), std::end(impl()), compare());
+		}
 	}
 
 	flat_multi_map(std::initializer_list<pair_type> iter)
@@ -516,6 +519,21 @@ public:
 		return (range.second - range.first);
 	}
 
+	template <
+		typename Iterator,
+		typename = typename std::iterator_traits<Iterator>::iterator_category>
+	void merge(Iterator first, Iterator last) {
+		mergeRange(first, last);
+	}
+
+	void merge(const flat_multi_map &other) {
+		merge(other.begin(), other.end());
+	}
+
+	void merge(std::initializer_list<pair_type> list) {
+		merge(list.begin(), list.end());
+	}
+
 private:
 	friend class flat_map<Key, Type, Compare>;
 
@@ -587,6 +605,43 @@ private:
 		return _data.elements;
 	}
 
+	// Same as flat_multi_set::mergeRange, the merged values go after the
+	// existing ones with equal keys, so flat_map keeps the existing ones.
+	template <typename Iterator>
+	std::pair<size_type, size_type> mergeRange(
+			Iterator first,
+			Iterator last) {
+		auto &elements = impl();
+		const auto wasSize = elements.size();
+		// The pairs can't be copy-assigned, so deque::insert won't do.
+		std::copy(first, last, std::back_inserter(elements));
+		const auto size = elements.size();
+		const auto middle = std::begin(elements) + wasSize;
+		if (!std::is_sorted(middle, std::end(elements), compare())) {
+			std::stable_sort(middle, std::end(elements), compare());
+		}
+		if (!wasSize || wasSize == size) {
+			return { 0, size };
+		} else if (!compare()(*middle, *(middle - 1))) {
+			return { wasSize - 1, size };
+		} else if (compare()(elements.back(), elements.front())) {
+			auto added = impl_t(
+				std::make_move_iterator(middle),
+				std::make_move_iterator(std::end(elements)));
+			elements.erase(middle, std::end(elements));
+			for (auto i = added.rbegin(), e = added.rend(); i != e; ++i) {
+				elements.push_front(std::move(*i));
+			}
+			return { 0, size - wasSize + 1 };
+		}
+		std::inplace_merge(
+			std::begin(elements),
+			std::begin(elements) + wasSize,
+			std::end(elements),
+			compare());
+		return { 0, size };
+	}
+
 	template <typename OtherKey>
 	typename impl_t::iterator getLowerBound(const OtherKey &key) {
 		return std::lower_bound(
@@ -834,6 +889,23 @@ public:
 		return where->second;
 	}
 
+	// Keeps the existing values for the keys that are already present.
+	template <
+		typename Iterator,
+		typename = typename std::iterator_traits<Iterator>::iterator_category>
+	void merge(Iterator first, Iterator last) {
+		const auto changed = this->mergeRange(first, last);
+		finalize(changed.first, changed.second);
+	}
+
+	void merge(const flat_map &other) {
+		merge(other.begin(), other.end());
+	}
+
+	void merge(std::initializer_list<pair_type> list) {
+		merge(list.begin(), list.end());
+	}
+
 	std::optional<Type> take(const Key &key) {
 		auto it = find(key);
 		if (it == this->end()) {
@@ -846,15 +918,20 @@ public:
 
 private:
 	void finalize() {
+		finalize(0, this->impl().size());
+	}
+	void finalize(std::size_t from, std::size_t till) {
+		const auto begin = std::begin(this->impl()) + from;
+		const auto end = std::begin(this->impl()) + till;
 		this->impl().erase(
 			std::unique(
-				std::begin(this->impl()),
-				std::end(this->impl()),
+				begin,
+				end,
 				[&](auto &&a, auto &&b) {
 					return !this->compare()(a, b);
 				}
 			),
-			std::end(this->impl()));
+			end);
 	}
 
 };
@@ -119,3 +119,37 @@ TEST_CASE("flat_maps structured bindings", "[flat_map]") {
 		}
 	}
 }
+
+TEST_CASE("flat_maps merge ranges", "[flat_map]") {
+	base::flat_map<int, string> v = { { 10, "a" }, { 20, "b" }, { 30, "c" } };
+
+	auto check = [&](std::vector<std::pair<int, string>> expected) {
+		REQUIRE(v.size() == expected.size());
+		auto i = v.begin();
+		for (const auto &[key, value] : expected) {
+			REQUIRE(i->first == key);
+			REQUIRE(i->second == value);
+			++i;
+		}
+	};
+
+	SECTION("merging after the last item keeps the existing values") {
+		v.merge({ { 40, "d" }, { 30, "x" }, { 50, "e" }, { 40, "y" } });
+		check({ { 10, "a" }, { 20, "b" }, { 30, "c" }, { 40, "d" }, { 50, "e" } });
+	}
+	SECTION("merging before the first item") {
+		v.merge({ { 5, "d" }, { 1, "e" } });
+		check({ { 1, "e" }, { 5, "d" }, { 10, "a" }, { 20, "b" }, { 30, "c" } });
+	}
+	SECTION("merging inside the range") {
+		v.merge({ { 25, "d" }, { 15, "e" }, { 20, "x" }, { 5, "f" } });
+		check({ { 5, "f" }, { 10, "a" }, { 15, "e" }, { 20, "b" }, { 25, "d" }, { 30, "c" } });
+	}
+	SECTION("merging another map") {
+		auto other = base::flat_map<int, string>();
+		other.emplace(20, "x");
+		other.emplace(0, "d");
+		v.merge(other);
+		check({ { 0, "d" }, { 10, "a" }, { 20, "b" }, { 30, "c" } });
+	}
+}
@@ -186,7 +186,9 @@ public:
 		typename = typename std::iterator_traits<Iterator>::iterator_category>
 	flat_multi_set(Iterator first, Iterator last)
 	: _data(first, last) {
-		std::sort(std::begin(impl()), std::end(impl()), compare());
+		if (!std::is_sorted(std::begin(impl()), std::end(impl()), compare())) {
+			std::sort(std::begin(impl()), std::end(impl()), compare());
+		}
 	}
 
 	flat_multi_set(std::initializer_list<Type> iter)
@@ -396,8 +398,7 @@ public:
 		typename Iterator,
 		typename = typename std::iterator_traits<Iterator>::iterator_category>
 	void merge(Iterator first, Iterator last) {
-		impl().insert(impl().end(), first, last);
-		std::sort(std::begin(impl()), std::end(impl()), compare());
+		mergeRange(first, last);
 	}
 
 	void merge(const flat_multi_set<Type, Compare> &other) {
@@ -485,6 +486,47 @@ private:
 		return _data.elements;
 	}
 
+	// Returns the [from, till) range of indices where the merged values
+	// could have ended up next to equal ones, for flat_set to deduplicate.
+	//
+	// Most merges add a block of values entirely after or entirely before
+	// the existing ones (a newer or an older slice of ids), those cost
+	// only the size of the added block instead of a full resort.
+	template <typename Iterator>
+	std::pair<size_type, size_type> mergeRange(
+			Iterator first,
+			Iterator last) {
+		auto &elements = impl();
+		const auto wasSize = elements.size();
+		elements.insert(std::end(elements), first, last);
+		const auto size = elements.size();
+		const auto middle = std::begin(elements) + wasSize;
+		if (!std::is_sorted(middle, std::end(elements), compare())) {
+			std::sort(middle, std::end(elements), compare());
+		}
+		if (!wasSize || wasSize == size) {
+			return { 0, size };
+		} else if (!compare()(*middle, *(middle - 1))) {
+			return { wasSize - 1, size };
+		} else if (compare()(elements.back(), elements.front())) {
+			auto added = impl_t(
+				std::make_move_iterator(middle),
+				std::make_move_iterator(std::end(elements)));
+			elements.erase(middle, std::end(elements));
+			elements.insert(
+				std::begin(elements),
+				std::make_move_iterator(std::begin(added)),
+				std::make_move_iterator(std::end(added)));
+			return { 0, size - wasSize + 1 };
+		}
+		std::inplace_merge(
+			std::begin(elements),
+			std::begin(elements) + wasSize,
+			std::end(elements),
+			compare());
+		return { 0, size };
+	}
+
 	typename impl_t::iterator getLowerBound(const Type &value) {
 		return std::lower_bound(
 			std::begin(impl()),
@@ -690,29 +732,38 @@ public:
 		typename Iterator,
 		typename = typename std::iterator_traits<Iterator>::iterator_category>
 	void merge(Iterator first, Iterator last) {
-		parent::merge(first, last);
-		finalize();
+		const auto changed = this->mergeRange(first, last);
+		finalize(changed.first, changed.second);
 	}
 
 	void merge(const flat_multi_set<Type, Compare> &other) {
 		merge(other.begin(), other.end());
 	}
 
+	void merge(const flat_set &other) {
+		merge(other.begin(), other.end());
+	}
+
 	void merge(std::initializer_list<Type> list) {
 		merge(list.begin(), list.end());
 	}
 
 private:
 	void finalize() {
+		finalize(0, this->impl().size());
+	}
+	void finalize(std::size_t from, std::size_t till) {
+		const auto begin = std::begin(this->impl()) + from;
+		const auto end = std::begin(this->impl()) + till;
 		this->impl().erase(
 			std::unique(
-				std::begin(this->impl()),
-				std::end(this->impl()),
+				begin,
+				end,
 				[&](auto &&a, auto &&b) {
 					return !this->compare()(a, b);
 				}
 			),
-			std::end(this->impl()));
+			end);
 	}
 
 };
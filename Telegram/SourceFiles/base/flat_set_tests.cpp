@@ -82,3 +82,38 @@ TEST_CASE("flat_sets with custom comparators", "[flat_set]") {
 		checkSorted();
 	}
 }
+
+TEST_CASE("flat_sets merge ranges", "[flat_set]") {
+	base::flat_set<int> v = { 10, 20, 30 };
+
+	auto check = [&](std::vector<int> expected) {
+		REQUIRE(v.size() == expected.size());
+		REQUIRE(std::equal(v.begin(), v.end(), expected.begin()));
+	};
+
+	SECTION("merging after the last item") {
+		v.merge({ 40, 30, 50, 40 });
+		check({ 10, 20, 30, 40, 50 });
+	}
+	SECTION("merging before the first item") {
+		v.merge({ 5, 1, 5, 3 });
+		check({ 1, 3, 5, 10, 20, 30 });
+	}
+	SECTION("merging before the first item with an equal one") {
+		v.merge({ 10, 1 });
+		check({ 1, 10, 20, 30 });
+	}
+	SECTION("merging inside the range") {
+		v.merge({ 25, 15, 20, 35, 5 });
+		check({ 5, 10, 15, 20, 25, 30, 35 });
+	}
+	SECTION("merging into an empty set") {
+		v = {};
+		v.merge({ 3, 1, 2, 1 });
+		check({ 1, 2, 3 });
+	}
+	SECTION("merging another set") {
+		v.merge(base::flat_set<int>{ 30, 5, 40 });
+		check({ 5, 10, 20, 30, 40 });
+	}
+}
@@ -0,0 +1,80 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "base/frame_clock.h"
+
+#include "base/assertion.h"
+
+#include <algorithm>
+
+namespace base {
+namespace {
+
+FrameClock *ClockInstance = nullptr;
+
+} // namespace
+
+FrameClock::FrameClock() : _timer([=] { fire(); }) {
+	Expects(ClockInstance == nullptr);
+
+	ClockInstance = this;
+}
+
+FrameClock::~FrameClock() {
+	Expects(ClockInstance == this);
+
+	ClockInstance = nullptr;
+}
+
+FrameClock &FrameClock::Instance() {
+	Expects(ClockInstance != nullptr);
+
+	return *ClockInstance;
+}
+
+void FrameClock::setRefreshRate(int rate) {
+	if (rate > 0) {
+		_rate = std::min(rate, kMaxRefreshRate);
+	}
+}
+
+int FrameClock::refreshRate() const {
+	return _rate;
+}
+
+// Ticks are the frame starts rounded up to milliseconds, so that with
+// a 60 Hz refresh they don't drift from the display by 2/3 ms a frame.
+crl::time FrameClock::tick(crl::time when) const {
+	const auto frame = (when * _rate + 999) / 1000;
+	return (frame * 1000 + _rate - 1) / _rate;
+}
+
+void FrameClock::request(crl::time when) {
+	const auto at = tick(when);
+	if (_scheduled >= 0 && _scheduled <= at) {
+		return;
+	}
+	_scheduled = at;
+	const auto now = crl::now();
+	_timer.callOnce(std::max(at - now, crl::time(0)), Qt::PreciseTimer);
+}
+
+rpl::producer<crl::time> FrameClock::ticks() const {
+	return _ticks.events();
+}
+
+void FrameClock::fire() {
+	const auto now = crl::now();
+	if (now < _scheduled) {
+		_timer.callOnce(_scheduled - now, Qt::PreciseTimer);
+		return;
+	}
+	_scheduled = -1;
+	_ticks.fire_copy(now);
+}
+
+} // namespace base
@@ -0,0 +1,52 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/timer.h"
+
+#include <rpl/event_stream.h>
+
+namespace base {
+
+// A single clock for everything that shows frames on the main thread.
+// All the animations and players show their frames on its ticks, so the
+// ones running at the same time are painted in a single repaint.
+class FrameClock final {
+public:
+	static constexpr auto kDefaultRefreshRate = 60;
+	static constexpr auto kMaxRefreshRate = 120;
+
+	FrameClock();
+	FrameClock(const FrameClock &other) = delete;
+	FrameClock &operator=(const FrameClock &other) = delete;
+	~FrameClock();
+
+	[[nodiscard]] static FrameClock &Instance();
+
+	// Ticks follow the display refresh, rates above the max are limited.
+	void setRefreshRate(int rate);
+	[[nodiscard]] int refreshRate() const;
+
+	// The first tick not earlier than 'when'.
+	[[nodiscard]] crl::time tick(crl::time when) const;
+
+	// Fires ticks() once on the first tick not earlier than 'when'.
+	void request(crl::time when);
+	[[nodiscard]] rpl::producer<crl::time> ticks() const;
+
+private:
+	void fire();
+
+	Timer _timer;
+	rpl::event_stream<crl::time> _ticks;
+	crl::time _scheduled = -1;
+	int _rate = kDefaultRefreshRate;
+
+};
+
+} // namespace base
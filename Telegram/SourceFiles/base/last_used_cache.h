@@ -20,6 +20,7 @@ public:
 	void clear();
 
 	Entry take_lowest();
+	Entry lowest() const;
 
 private:
 	std::list<Entry> _queue;
@@ -66,4 +67,9 @@ Entry last_used_cache<Entry>::take_lowest() {
 	return result;
 }
 
+template <typename Entry>
+Entry last_used_cache<Entry>::lowest() const {
+	return _queue.empty() ? Entry() : _queue.front();
+}
+
 } // namespace base
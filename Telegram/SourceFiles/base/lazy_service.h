@@ -0,0 +1,49 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/basic_types.h"
+#include "base/algorithm.h"
+#include "base/assertion.h"
+
+#include <memory>
+
+namespace base {
+
+// Owns a service that is constructed on the first access, or earlier
+// by ensure() when the owner has some idle time for it.
+template <typename Type>
+class lazy_service final {
+public:
+	explicit lazy_service(FnMut<std::unique_ptr<Type>()> create)
+	: _create(std::move(create)) {
+	}
+	lazy_service(const lazy_service &other) = delete;
+	lazy_service &operator=(const lazy_service &other) = delete;
+
+	[[nodiscard]] Type &get() const {
+		ensure();
+		return *_value;
+	}
+	[[nodiscard]] Type *created() const {
+		return _value.get();
+	}
+	void ensure() const {
+		if (!_value) {
+			_value = base::take(_create)();
+			Assert(_value != nullptr);
+		}
+	}
+
+private:
+	mutable FnMut<std::unique_ptr<Type>()> _create;
+	mutable std::unique_ptr<Type> _value;
+
+};
+
+} // namespace base
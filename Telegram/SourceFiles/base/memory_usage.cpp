@@ -0,0 +1,134 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "base/memory_usage.h"
+
+#include "base/flat_map.h"
+
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+namespace base {
+namespace memory_usage {
+namespace {
+
+struct NameCompare {
+	bool operator()(const char *a, const char *b) const {
+		return std::strcmp(a, b) < 0;
+	}
+};
+
+struct Source {
+	const void *owner = nullptr;
+	const char *name = nullptr;
+	Fn<Usage()> usage;
+};
+
+struct Registry {
+	std::mutex mutex;
+	std::vector<Source> sources;
+};
+
+Registry &GlobalRegistry() {
+	static auto result = Registry();
+	return result;
+}
+
+void Register(const void *owner, const char *name, Fn<Usage()> usage) {
+	auto &registry = GlobalRegistry();
+	const auto lock = std::unique_lock(registry.mutex);
+	registry.sources.push_back({ owner, name, std::move(usage) });
+}
+
+void Unregister(const void *owner) {
+	auto &registry = GlobalRegistry();
+	const auto lock = std::unique_lock(registry.mutex);
+	auto &sources = registry.sources;
+	sources.erase(std::remove_if(begin(sources), end(sources), [&](
+			const Source &source) {
+		return (source.owner == owner);
+	}), end(sources));
+}
+
+} // namespace
+
+Counter::Counter(const char *name) {
+	Register(this, name, [=] { return usage(); });
+}
+
+Counter::~Counter() {
+	Unregister(this);
+}
+
+void Counter::add(int64 bytes, int64 count) {
+	_bytes.fetch_add(bytes, std::memory_order_relaxed);
+	_count.fetch_add(count, std::memory_order_relaxed);
+}
+
+void Counter::remove(int64 bytes, int64 count) {
+	_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+	_count.fetch_sub(count, std::memory_order_relaxed);
+}
+
+void Counter::set(Usage usage) {
+	_bytes.store(usage.bytes, std::memory_order_relaxed);
+	_count.store(usage.count, std::memory_order_relaxed);
+}
+
+Usage Counter::usage() const {
+	return {
+		_bytes.load(std::memory_order_relaxed),
+		_count.load(std::memory_order_relaxed)
+	};
+}
+
+Provider::Provider(const char *name, Fn<Usage()> compute) {
+	Register(this, name, std::move(compute));
+}
+
+Provider::~Provider() {
+	Unregister(this);
+}
+
+std::vector<Entry> Collect() {
+	auto summed = base::flat_map<const char*, Usage, NameCompare>();
+
+	auto &registry = GlobalRegistry();
+	const auto lock = std::unique_lock(registry.mutex);
+	for (const auto &source : registry.sources) {
+		const auto usage = source.usage();
+		auto &sum = summed[source.name];
+		sum.bytes += usage.bytes;
+		sum.count += usage.count;
+	}
+
+	auto result = std::vector<Entry>();
+	result.reserve(summed.size());
+	for (const auto &[name, usage] : summed) {
+		result.push_back({ name, usage });
+	}
+	return result;
+}
+
+Usage Collect(const char *name) {
+	auto result = Usage();
+
+	auto &registry = GlobalRegistry();
+	const auto lock = std::unique_lock(registry.mutex);
+	for (const auto &source : registry.sources) {
+		if (!std::strcmp(source.name, name)) {
+			const auto usage = source.usage();
+			result.bytes += usage.bytes;
+			result.count += usage.count;
+		}
+	}
+	return result;
+}
+
+} // namespace memory_usage
+} // namespace base
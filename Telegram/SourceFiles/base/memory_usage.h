@@ -0,0 +1,69 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/basic_types.h"
+
+#include <atomic>
+
+// Caches and stores report here how much memory they hold, so that the
+// totals can be shown in the debug box and logged. The numbers are an
+// estimate of the large allocations, not the exact heap usage.
+
+namespace base {
+namespace memory_usage {
+
+struct Usage {
+	int64 bytes = 0;
+	int64 count = 0;
+};
+
+struct Entry {
+	const char *name = nullptr;
+	Usage usage;
+};
+
+// Updated by the subsystem itself, from any thread.
+class Counter final {
+public:
+	explicit Counter(const char *name);
+	Counter(const Counter &other) = delete;
+	Counter &operator=(const Counter &other) = delete;
+	~Counter();
+
+	void add(int64 bytes, int64 count = 1);
+	void remove(int64 bytes, int64 count = 1);
+	void set(Usage usage);
+
+	[[nodiscard]] Usage usage() const;
+
+private:
+	std::atomic<int64> _bytes = 0;
+	std::atomic<int64> _count = 0;
+
+};
+
+// Computed on demand, the method is called on the main thread.
+class Provider final {
+public:
+	Provider(const char *name, Fn<Usage()> compute);
+	Provider(const Provider &other) = delete;
+	Provider &operator=(const Provider &other) = delete;
+	~Provider();
+
+};
+
+// Call on the main thread. Sources with the same name are summed,
+// entries are sorted by name.
+[[nodiscard]] std::vector<Entry> Collect();
+
+// The sum of the sources with this name only.
+[[nodiscard]] Usage Collect(const char *name);
+
+} // namespace memory_usage
+} // namespace base
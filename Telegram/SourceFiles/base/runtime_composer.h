@@ -7,6 +7,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #pragma once
 
+#include "base/small_pool.h"
+
 template <typename Base>
 class RuntimeComposer;
 
@@ -145,7 +147,7 @@ public:
 		if (mask) {
 			auto meta = GetRuntimeComposerMetadata(mask);
 
-			auto data = operator new(meta->size);
+			auto data = base::SmallPoolAllocate(meta->size);
 			Assert(data != nullptr);
 
 			_data = data;
@@ -185,7 +187,7 @@ public:
 					RuntimeComponentWraps[i].Destruct(_dataptrunsafe(offset));
 				}
 			}
-			operator delete(_data);
+			base::SmallPoolFree(_data, meta->size);
 		}
 	}
 
@@ -0,0 +1,120 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "base/small_pool.h"
+
+#include <array>
+#include <new>
+
+namespace base {
+namespace {
+
+constexpr auto kAlignment = std::size_t(16);
+constexpr auto kSizeClasses = kSmallPoolMaxSize / kAlignment;
+
+// How many freed blocks of one size class each thread keeps.
+constexpr auto kPoolLimit = 4096;
+
+class Pool {
+public:
+	Pool() = default;
+	Pool(const Pool &other) = delete;
+	Pool &operator=(const Pool &other) = delete;
+	~Pool();
+
+	[[nodiscard]] void *allocate(std::size_t sizeClass);
+	[[nodiscard]] bool release(void *pointer, std::size_t sizeClass);
+
+private:
+	struct Block {
+		Block *next = nullptr;
+	};
+	struct List {
+		Block *first = nullptr;
+		int count = 0;
+	};
+
+	std::array<List, kSizeClasses> _lists;
+
+};
+
+// Blocks can be freed while thread local objects are destroyed,
+// after the pool of the thread is gone, this flag tells about that.
+thread_local bool PoolDestroyed = false;
+
+Pool::~Pool() {
+	PoolDestroyed = true;
+	for (auto &list : _lists) {
+		while (const auto block = list.first) {
+			list.first = block->next;
+			::operator delete(block);
+		}
+	}
+}
+
+void *Pool::allocate(std::size_t sizeClass) {
+	auto &list = _lists[sizeClass];
+	if (const auto block = list.first) {
+		list.first = block->next;
+		--list.count;
+		return block;
+	}
+	return ::operator new((sizeClass + 1) * kAlignment);
+}
+
+bool Pool::release(void *pointer, std::size_t sizeClass) {
+	auto &list = _lists[sizeClass];
+	if (list.count >= kPoolLimit) {
+		return false;
+	}
+	list.first = new (pointer) Block{ list.first };
+	++list.count;
+	return true;
+}
+
+Pool *CurrentPool() {
+	if (PoolDestroyed) {
+		return nullptr;
+	}
+	thread_local auto result = Pool();
+	return &result;
+}
+
+std::size_t SizeClass(std::size_t size) {
+	return size ? ((size - 1) / kAlignment) : 0;
+}
+
+} // namespace
+
+void *SmallPoolAllocate(std::size_t size) {
+	if (size <= kSmallPoolMaxSize) {
+		if (const auto pool = CurrentPool()) {
+			return pool->allocate(SizeClass(size));
+		}
+		// Keep the block size the same as if it was pooled,
+		// so that any thread pool can take it when it is freed.
+		size = (SizeClass(size) + 1) * kAlignment;
+	}
+	return ::operator new(size);
+}
+
+// Blocks are often freed on a different thread than they were allocated
+// on, in that case they just move to the pool of the freeing thread.
+void SmallPoolFree(void *pointer, std::size_t size) {
+	if (!pointer) {
+		return;
+	} else if (size <= kSmallPoolMaxSize) {
+		if (const auto pool = CurrentPool()) {
+			if (pool->release(pointer, SizeClass(size))) {
+				return;
+			}
+		}
+	}
+	::operator delete(pointer);
+}
+
+} // namespace base
@@ -0,0 +1,36 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include <cstddef>
+
+namespace base {
+
+// Blocks up to kSmallPoolMaxSize bytes are kept in per-thread free lists
+// of 16 byte size classes when freed and reused by the next allocations
+// of the same size class on that thread, larger ones go to the heap.
+//
+// A block may be freed on any thread, the size passed to SmallPoolFree()
+// must be the same as the one passed to SmallPoolAllocate().
+constexpr auto kSmallPoolMaxSize = std::size_t(512);
+
+[[nodiscard]] void *SmallPoolAllocate(std::size_t size);
+void SmallPoolFree(void *pointer, std::size_t size);
+
+// Adds class-level operator new and delete that use the small pool.
+// The class must have a virtual destructor if it is destroyed through
+// a pointer to a base class, so that the right size is passed.
+#define BASE_SMALL_POOL_ALLOCATED \
+	static void *operator new(std::size_t size) { \
+		return ::base::SmallPoolAllocate(size); \
+	} \
+	static void operator delete(void *pointer, std::size_t size) { \
+		::base::SmallPoolFree(pointer, size); \
+	}
+
+} // namespace base
@@ -8,17 +8,126 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/timer.h"
 
 #include <QtCore/QTimerEvent>
+#include <algorithm>
+#include <limits>
 
 namespace base {
 namespace {
 
+// With the wheel tick of 16ms that makes at most 5% of slack,
+// the same that Qt allows for Qt::CoarseTimer.
+constexpr auto kWheelMinTimeout = crl::time(320);
+
+// Longer wheel deadlines just make the system timer wake up early.
+constexpr auto kWheelMaxDelay = crl::time(24 * 60 * 60 * 1000);
+
 QObject *TimersAdjuster() {
 	static QObject adjuster;
 	return &adjuster;
 }
 
+bool UseWheel(crl::time timeout, Qt::TimerType type) {
+	return (type != Qt::PreciseTimer) && (timeout >= kWheelMinTimeout);
+}
+
+// Timer wheel of the current thread with its single Qt timer.
+class Wheel final : public QObject {
+public:
+	Wheel();
+	~Wheel();
+
+	void add(not_null<details::TimerWheelEntry*> entry, crl::time timeout);
+
+protected:
+	void timerEvent(QTimerEvent *e) override;
+
+private:
+	void schedule(crl::time when);
+	void adjust();
+
+	details::TimerWheel _wheel;
+	crl::time _when = -1;
+	int _timerId = 0;
+
+};
+
+// The wheel entries can be cancelled while thread local objects are
+// destroyed, after the wheel of the thread is gone.
+thread_local bool WheelDestroyed = false;
+
+Wheel::Wheel() : _wheel([=](crl::time when) { schedule(when); }) {
+	connect(
+		TimersAdjuster(),
+		&QObject::destroyed,
+		this,
+		[=] { adjust(); },
+		Qt::QueuedConnection);
+}
+
+Wheel::~Wheel() {
+	WheelDestroyed = true;
+}
+
+void Wheel::add(
+		not_null<details::TimerWheelEntry*> entry,
+		crl::time timeout) {
+	const auto now = crl::now();
+	_wheel.add(entry, now + timeout, now);
+}
+
+void Wheel::timerEvent(QTimerEvent *e) {
+	killTimer(base::take(_timerId));
+	_when = -1;
+	_wheel.advance(crl::now());
+}
+
+void Wheel::schedule(crl::time when) {
+	if (_timerId) {
+		killTimer(base::take(_timerId));
+	}
+	_when = when;
+	if (when >= 0) {
+		const auto delay = std::clamp(
+			when - crl::now(),
+			crl::time(0),
+			kWheelMaxDelay);
+		_timerId = startTimer(int(delay), Qt::CoarseTimer);
+	}
+}
+
+void Wheel::adjust() {
+	if (_when >= 0) {
+		schedule(_when);
+	}
+}
+
+Wheel *CurrentWheel() {
+	if (WheelDestroyed) {
+		return nullptr;
+	}
+	thread_local auto result = Wheel();
+	return &result;
+}
+
 } // namespace
 
+class DelayedCallTimer::WheelCall final : public details::TimerWheelEntry {
+public:
+	WheelCall(
+		not_null<DelayedCallTimer*> owner,
+		int id,
+		FnMut<void()> callback);
+
+	FnMut<void()> callback;
+
+private:
+	void timerWheelFired() override;
+
+	const not_null<DelayedCallTimer*> _owner;
+	const int _id = 0;
+
+};
+
 Timer::Timer(
 	not_null<QThread*> thread,
 	Fn<void()> callback)
@@ -47,6 +156,12 @@ void Timer::start(crl::time timeout, Qt::TimerType type, Repeat repeat) {
 	setRepeat(repeat);
 	_adjusted = false;
 	setTimeout(timeout);
+	const auto wheel = UseWheel(_timeout, _type) ? CurrentWheel() : nullptr;
+	if (wheel) {
+		wheel->add(this, _timeout);
+		_next = crl::now() + _timeout;
+		return;
+	}
 	_timerId = startTimer(_timeout, _type);
 	if (_timerId) {
 		_next = crl::now() + _timeout;
@@ -56,9 +171,10 @@ void Timer::start(crl::time timeout, Qt::TimerType type, Repeat repeat) {
 }
 
 void Timer::cancel() {
-	if (isActive()) {
+	if (_timerId) {
 		killTimer(base::take(_timerId));
 	}
+	dequeue();
 }
 
 crl::time Timer::remainingTime() const {
@@ -80,7 +196,7 @@ void Timer::Adjust() {
 
 void Timer::adjust() {
 	auto remaining = remainingTime();
-	if (remaining >= 0) {
+	if (_timerId && remaining >= 0) {
 		cancel();
 		_timerId = startTimer(remaining, _type);
 		_adjusted = true;
@@ -107,12 +223,40 @@ void Timer::timerEvent(QTimerEvent *e) {
 	} else {
 		cancel();
 	}
+	fire();
+}
+
+void Timer::timerWheelFired() {
+	if (repeat() == Repeat::Interval) {
+		start(_timeout, _type, repeat());
+	}
+	fire();
+}
 
+void Timer::fire() {
 	if (const auto onstack = _callback) {
 		onstack();
 	}
 }
 
+DelayedCallTimer::WheelCall::WheelCall(
+	not_null<DelayedCallTimer*> owner,
+	int id,
+	FnMut<void()> callback)
+: callback(std::move(callback))
+, _owner(owner)
+, _id(id) {
+}
+
+void DelayedCallTimer::WheelCall::timerWheelFired() {
+	// Destroys this.
+	_owner->wheelCallFired(_id);
+}
+
+DelayedCallTimer::DelayedCallTimer() = default;
+
+DelayedCallTimer::~DelayedCallTimer() = default;
+
 int DelayedCallTimer::call(
 		crl::time timeout,
 		FnMut<void()> callback,
@@ -122,6 +266,17 @@ int DelayedCallTimer::call(
 	if (!callback) {
 		return 0;
 	}
+	const auto wheel = UseWheel(timeout, type) ? CurrentWheel() : nullptr;
+	if (wheel && _wheelCallIdLast > std::numeric_limits<int>::min()) {
+		const auto callId = --_wheelCallIdLast;
+		auto entry = std::make_unique<WheelCall>(
+			this,
+			callId,
+			std::move(callback));
+		wheel->add(entry.get(), timeout);
+		_wheelCalls.emplace(callId, std::move(entry));
+		return callId;
+	}
 	auto timerId = startTimer(static_cast<int>(timeout), type);
 	if (timerId) {
 		_callbacks.emplace(timerId, std::move(callback));
@@ -130,7 +285,9 @@ int DelayedCallTimer::call(
 }
 
 void DelayedCallTimer::cancel(int callId) {
-	if (callId) {
+	if (callId < 0) {
+		_wheelCalls.remove(callId);
+	} else if (callId) {
 		killTimer(callId);
 		_callbacks.remove(callId);
 	}
@@ -149,4 +306,14 @@ void DelayedCallTimer::timerEvent(QTimerEvent *e) {
 	}
 }
 
+void DelayedCallTimer::wheelCallFired(int callId) {
+	const auto i = _wheelCalls.find(callId);
+	Assert(i != _wheelCalls.end());
+
+	auto callback = std::move(i->second->callback);
+	_wheelCalls.erase(i);
+
+	callback();
+}
+
 } // namespace base
@@ -10,12 +10,15 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <QtCore/QObject>
 #include <QtCore/QThread>
 #include "base/flat_map.h"
+#include "base/timer_wheel.h"
 
 #include <crl/crl_time.h>
 
 namespace base {
 
-class Timer final : private QObject {
+// Coarse timers share a timer wheel with a single Qt timer per thread,
+// precise ones and the short ones register their own Qt timers.
+class Timer final : private QObject, private details::TimerWheelEntry {
 public:
 	explicit Timer(
 		not_null<QThread*> thread,
@@ -48,7 +51,7 @@ public:
 	}
 
 	bool isActive() const {
-		return (_timerId != 0);
+		return (_timerId != 0) || queued();
 	}
 
 	void cancel();
@@ -60,12 +63,15 @@ protected:
 	void timerEvent(QTimerEvent *e) override;
 
 private:
+	void timerWheelFired() override;
+
 	enum class Repeat : unsigned {
 		Interval   = 0,
 		SingleShot = 1,
 	};
 	void start(crl::time timeout, Qt::TimerType type, Repeat repeat);
 	void adjust();
+	void fire();
 
 	void setTimeout(crl::time timeout);
 	int timeout() const;
@@ -90,6 +96,9 @@ private:
 
 class DelayedCallTimer final : private QObject {
 public:
+	DelayedCallTimer();
+	~DelayedCallTimer();
+
 	int call(crl::time timeout, FnMut<void()> callback) {
 		return call(
 			timeout,
@@ -107,8 +116,15 @@ protected:
 	void timerEvent(QTimerEvent *e) override;
 
 private:
+	class WheelCall;
+	void wheelCallFired(int callId);
+
 	base::flat_map<int, FnMut<void()>> _callbacks;
 
+	// Calls on the timer wheel have negative ids.
+	base::flat_map<int, std::unique_ptr<WheelCall>> _wheelCalls;
+	int _wheelCallIdLast = 0;
+
 };
 
 } // namespace base
@@ -0,0 +1,270 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "base/timer_wheel.h"
+
+#include "base/assertion.h"
+
+#include <algorithm>
+
+namespace base {
+namespace details {
+namespace {
+
+constexpr auto kNoTick = crl::time(-1);
+
+void Init(TimerWheelLink &head) {
+	head.prev = head.next = &head;
+}
+
+bool Empty(const TimerWheelLink &head) {
+	return (head.next == &head);
+}
+
+void Append(TimerWheelLink &head, TimerWheelLink *link) {
+	link->prev = head.prev;
+	link->next = &head;
+	head.prev->next = link;
+	head.prev = link;
+}
+
+void Unlink(TimerWheelLink *link) {
+	link->prev->next = link->next;
+	link->next->prev = link->prev;
+	link->prev = link->next = nullptr;
+}
+
+// Moves all the links from one list to another, empty one.
+void Splice(TimerWheelLink &from, TimerWheelLink &to) {
+	Init(to);
+	if (Empty(from)) {
+		return;
+	}
+	to.next = from.next;
+	to.prev = from.prev;
+	to.next->prev = &to;
+	to.prev->next = &to;
+	Init(from);
+}
+
+} // namespace
+
+TimerWheelEntry::~TimerWheelEntry() {
+	dequeue();
+}
+
+void TimerWheelEntry::dequeue() {
+	if (_wheel) {
+		_wheel->remove(this);
+	}
+}
+
+TimerWheel::TimerWheel(FnMut<void(crl::time when)> schedule)
+: _schedule(std::move(schedule)) {
+	for (auto &slot : _slots) {
+		Init(slot);
+	}
+}
+
+TimerWheel::~TimerWheel() {
+	for (auto &slot : _slots) {
+		while (!Empty(slot)) {
+			const auto entry = static_cast<TimerWheelEntry*>(slot.next);
+			Unlink(entry);
+			entry->_wheel = nullptr;
+		}
+	}
+}
+
+void TimerWheel::add(
+		not_null<TimerWheelEntry*> entry,
+		crl::time when,
+		crl::time now) {
+	entry->dequeue();
+	if (!_count) {
+		// Nothing to cascade, start counting from now.
+		setCurrent(std::max(_current, now >> kTickShift));
+	}
+	const auto rounded = (when + kTickDuration - 1) >> kTickShift;
+	entry->_tick = std::max(rounded, _current);
+	entry->_wheel = this;
+	++_count;
+	place(entry);
+
+	if (_scheduled == kNoTick || entry->_tick < _scheduled) {
+		_scheduled = entry->_tick;
+		_schedule(_scheduled << kTickShift);
+	}
+}
+
+void TimerWheel::remove(not_null<TimerWheelEntry*> entry) {
+	Expects(entry->_wheel == this);
+
+	unlink(entry);
+	if (!_count && _scheduled != kNoTick) {
+		_scheduled = kNoTick;
+		_schedule(-1);
+	}
+}
+
+void TimerWheel::advance(crl::time now) {
+	_scheduled = kNoTick;
+
+	const auto till = now >> kTickShift;
+	while (true) {
+		const auto tick = nextTick();
+		if (tick == kNoTick || tick > till) {
+			break;
+		}
+		process(tick);
+	}
+	if (_current <= till) {
+		setCurrent(till + 1);
+	}
+	reschedule();
+}
+
+// The entry goes to the lowest level where its tick and the current one
+// differ only in this level bits. It moves down a level each time the
+// current tick reaches its slot, until it fires from the lowest level.
+//
+// The 7 levels of 64 slots of 16ms cover 2^46 ms, more than any deadline.
+void TimerWheel::place(not_null<TimerWheelEntry*> entry) {
+	const auto tick = entry->_tick = std::max(entry->_tick, _current);
+	auto level = 0;
+	while (level + 1 < kLevels) {
+		const auto shift = kLevelShift * (level + 1);
+		if ((tick >> shift) == (_current >> shift)) {
+			break;
+		}
+		++level;
+	}
+	const auto index = int((tick >> (kLevelShift * level))
+		& (kLevelSlots - 1));
+	entry->_slot = level * kLevelSlots + index;
+	Append(_slots[entry->_slot], entry.get());
+	_occupied[level] |= (std::uint64_t(1) << index);
+}
+
+void TimerWheel::unlink(not_null<TimerWheelEntry*> entry) {
+	Unlink(entry.get());
+	if (entry->_slot != kFiringSlot && Empty(_slots[entry->_slot])) {
+		const auto level = entry->_slot / kLevelSlots;
+		const auto index = entry->_slot % kLevelSlots;
+		_occupied[level] &= ~(std::uint64_t(1) << index);
+	}
+	entry->_wheel = nullptr;
+	--_count;
+}
+
+// The slots with the current tick on the levels above the lowest one are
+// always empty, so that the first occupied slot of the lowest occupied
+// level is always the next one that needs processing.
+void TimerWheel::setCurrent(crl::time tick) {
+	Expects(tick >= _current);
+
+	_current = tick;
+
+	// Higher levels first, so that entries can cascade through few levels.
+	for (auto level = kLevels - 1; level > 0; --level) {
+		const auto index = int((tick >> (kLevelShift * level))
+			& (kLevelSlots - 1));
+		auto &slot = _slots[level * kLevelSlots + index];
+		if (Empty(slot)) {
+			continue;
+		}
+		auto cascading = Link();
+		Splice(slot, cascading);
+		_occupied[level] &= ~(std::uint64_t(1) << index);
+		while (!Empty(cascading)) {
+			const auto entry = static_cast<TimerWheelEntry*>(
+				cascading.next);
+			Unlink(entry);
+			place(entry);
+		}
+	}
+}
+
+void TimerWheel::process(crl::time tick) {
+	setCurrent(tick);
+
+	const auto index = int(tick & (kLevelSlots - 1));
+	auto &slot = _slots[index];
+	auto firing = Link();
+	Splice(slot, firing);
+	_occupied[0] &= ~(std::uint64_t(1) << index);
+	for (auto i = firing.next; i != &firing; i = i->next) {
+		static_cast<TimerWheelEntry*>(i)->_slot = kFiringSlot;
+	}
+	setCurrent(tick + 1);
+	if (Empty(firing)) {
+		return;
+	}
+
+	// Callbacks may run nested event loops, keep the system timer going.
+	reschedule();
+
+	// Callbacks may remove or destroy other entries from this list.
+	while (!Empty(firing)) {
+		const auto entry = static_cast<TimerWheelEntry*>(firing.next);
+		unlink(entry);
+		entry->timerWheelFired();
+	}
+}
+
+void TimerWheel::reschedule() {
+	auto result = nextTick();
+	const auto level = int(std::find_if(
+		begin(_occupied),
+		end(_occupied),
+		[](std::uint64_t occupied) { return occupied != 0; }
+	) - begin(_occupied));
+	if (result != kNoTick && level > 0) {
+		// Wake up right for the earliest entry, not for the cascade:
+		// all the entries in this slot are before any other slot.
+		const auto index = int((result >> (kLevelShift * level))
+			& (kLevelSlots - 1));
+		const auto &slot = _slots[level * kLevelSlots + index];
+		result = static_cast<const TimerWheelEntry*>(slot.next)->_tick;
+		for (auto i = slot.next; i != &slot; i = i->next) {
+			const auto entry = static_cast<const TimerWheelEntry*>(i);
+			result = std::min(result, entry->_tick);
+		}
+	}
+	if (_scheduled != result) {
+		_scheduled = result;
+		_schedule((result == kNoTick) ? -1 : (result << kTickShift));
+	}
+}
+
+crl::time TimerWheel::nextTick() const {
+	for (auto level = 0; level != kLevels; ++level) {
+		auto occupied = _occupied[level];
+		if (!occupied) {
+			continue;
+		}
+		auto index = int((_current >> (kLevelShift * level))
+			& (kLevelSlots - 1));
+		occupied >>= index;
+		Assert(occupied != 0);
+		while (!(occupied & 1)) {
+			occupied >>= 1;
+			++index;
+		}
+		return slotTick(level, index);
+	}
+	return kNoTick;
+}
+
+crl::time TimerWheel::slotTick(int level, int index) const {
+	const auto shift = kLevelShift * level;
+	const auto above = shift + kLevelShift;
+	return ((_current >> above) << above) | (crl::time(index) << shift);
+}
+
+} // namespace details
+} // namespace base
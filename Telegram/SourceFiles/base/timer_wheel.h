@@ -0,0 +1,107 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/basic_types.h"
+
+#include <crl/crl_time.h>
+#include <array>
+#include <cstdint>
+
+namespace base {
+namespace details {
+
+class TimerWheel;
+
+struct TimerWheelLink {
+	TimerWheelLink *prev = nullptr;
+	TimerWheelLink *next = nullptr;
+};
+
+// Something that a TimerWheel calls back when its deadline comes.
+class TimerWheelEntry : private TimerWheelLink {
+public:
+	TimerWheelEntry() = default;
+	TimerWheelEntry(const TimerWheelEntry &other) = delete;
+	TimerWheelEntry &operator=(const TimerWheelEntry &other) = delete;
+
+	[[nodiscard]] bool queued() const {
+		return (_wheel != nullptr);
+	}
+
+protected:
+	~TimerWheelEntry();
+
+	void dequeue();
+
+	virtual void timerWheelFired() = 0;
+
+private:
+	friend class TimerWheel;
+
+	TimerWheel *_wheel = nullptr;
+	crl::time _tick = 0;
+	int _slot = 0;
+
+};
+
+// A hierarchical timer wheel: adding and removing an entry is O(1) and
+// the owner needs a single system timer for all the entries. Deadlines
+// are rounded up to kTickDuration, entries never fire before them.
+class TimerWheel final {
+public:
+	static constexpr auto kTickShift = 4;
+	static constexpr auto kTickDuration = crl::time(1) << kTickShift;
+
+	// The schedule callback gets the time when advance() should be called
+	// next, or -1 when no entries are left and the system timer can stop.
+	explicit TimerWheel(FnMut<void(crl::time when)> schedule);
+	TimerWheel(const TimerWheel &other) = delete;
+	TimerWheel &operator=(const TimerWheel &other) = delete;
+	~TimerWheel();
+
+	void add(not_null<TimerWheelEntry*> entry, crl::time when, crl::time now);
+	void remove(not_null<TimerWheelEntry*> entry);
+
+	// Fires all the entries with the deadline not later than now.
+	// The owner should forget the last scheduled time before the call.
+	void advance(crl::time now);
+
+	[[nodiscard]] int size() const {
+		return _count;
+	}
+
+private:
+	static constexpr auto kLevelShift = 6;
+	static constexpr auto kLevelSlots = 1 << kLevelShift;
+	static constexpr auto kLevels = 7;
+	static constexpr auto kFiringSlot = -1;
+
+	using Link = TimerWheelLink;
+
+	void place(not_null<TimerWheelEntry*> entry);
+	void unlink(not_null<TimerWheelEntry*> entry);
+	void setCurrent(crl::time tick);
+	void process(crl::time tick);
+	void reschedule();
+	[[nodiscard]] crl::time nextTick() const;
+	[[nodiscard]] crl::time slotTick(int level, int index) const;
+
+	FnMut<void(crl::time when)> _schedule;
+	std::array<Link, kLevels * kLevelSlots> _slots;
+	std::array<std::uint64_t, kLevels> _occupied = { { 0 } };
+
+	// All the ticks before this one are processed.
+	crl::time _current = 0;
+	crl::time _scheduled = -1;
+	int _count = 0;
+
+};
+
+} // namespace details
+} // namespace base
@@ -0,0 +1,192 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "base/timer_wheel.h"
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+using base::details::TimerWheel;
+using base::details::TimerWheelEntry;
+
+namespace {
+
+class Entry final : public TimerWheelEntry {
+public:
+	Entry(crl::time when, Fn<void(not_null<Entry*>)> fired)
+	: when(when)
+	, _fired(std::move(fired)) {
+	}
+
+	using TimerWheelEntry::dequeue;
+
+	crl::time when = 0;
+
+private:
+	void timerWheelFired() override {
+		_fired(this);
+	}
+
+	Fn<void(not_null<Entry*>)> _fired;
+
+};
+
+} // namespace
+
+TEST_CASE("timer wheel fires entries in order", "[timer_wheel]") {
+	auto scheduled = crl::time(-1);
+	auto wakeups = 0;
+	auto wheel = TimerWheel([&](crl::time when) {
+		scheduled = when;
+	});
+	auto now = crl::time(1000);
+	auto fired = std::vector<std::pair<crl::time, crl::time>>();
+	const auto fire = [&](not_null<Entry*> entry) {
+		fired.emplace_back(entry->when, now);
+	};
+	const auto run = [&] {
+		while (scheduled >= 0) {
+			now = std::max(now, std::exchange(scheduled, -1));
+			++wakeups;
+			wheel.advance(now);
+		}
+	};
+
+	auto entries = std::vector<std::unique_ptr<Entry>>();
+	for (const auto delay : { 5000, 20, 3'600'000, 70'000, 1000, 1001 }) {
+		entries.push_back(std::make_unique<Entry>(now + delay, fire));
+		wheel.add(entries.back().get(), entries.back()->when, now);
+	}
+	REQUIRE(wheel.size() == 6);
+
+	SECTION("each right after its deadline with a wakeup for each") {
+		run();
+		REQUIRE(wheel.size() == 0);
+		REQUIRE(fired.size() == 6);
+		REQUIRE(wakeups == 6);
+		for (auto i = 0; i != 6; ++i) {
+			const auto [when, at] = fired[i];
+			REQUIRE(at >= when);
+			REQUIRE(at < when + TimerWheel::kTickDuration);
+			if (i) {
+				REQUIRE(when > fired[i - 1].first);
+			}
+		}
+	}
+	SECTION("removed entries don't fire") {
+		entries[3]->dequeue();
+		entries[4].reset();
+		REQUIRE(wheel.size() == 4);
+		run();
+		REQUIRE(fired.size() == 4);
+	}
+	SECTION("schedule stops when all are removed") {
+		entries.clear();
+		REQUIRE(wheel.size() == 0);
+		REQUIRE(scheduled == -1);
+	}
+	SECTION("late advance fires everything due at once") {
+		scheduled = -1;
+		wheel.advance(now + 10'000);
+		REQUIRE(fired.size() == 4);
+		REQUIRE(scheduled >= entries[3]->when);
+		run();
+		REQUIRE(fired.size() == 6);
+	}
+}
+
+TEST_CASE("timer wheel entries changed from callbacks", "[timer_wheel]") {
+	auto scheduled = crl::time(-1);
+	auto wheel = TimerWheel([&](crl::time when) {
+		scheduled = when;
+	});
+	auto now = crl::time(0);
+	auto fired = std::vector<crl::time>();
+
+	auto second = std::unique_ptr<Entry>();
+	auto repeated = 0;
+	auto first = std::make_unique<Entry>(500, [&](not_null<Entry*> entry) {
+		fired.push_back(now);
+		second.reset();
+		if (++repeated < 3) {
+			entry->when = now + 500;
+			wheel.add(entry.get(), entry->when, now);
+		}
+	});
+	second = std::make_unique<Entry>(500, [&](not_null<Entry*> entry) {
+		fired.push_back(-1);
+	});
+	wheel.add(first.get(), first->when, now);
+	wheel.add(second.get(), second->when, now);
+
+	while (scheduled >= 0) {
+		now = std::exchange(scheduled, -1);
+		wheel.advance(now);
+	}
+	REQUIRE((fired == std::vector<crl::time>{ 512, 1024, 1536 }));
+}
+
+TEST_CASE("timer wheel random entries", "[timer_wheel]") {
+	auto scheduled = crl::time(-1);
+	auto wheel = TimerWheel([&](crl::time when) {
+		scheduled = when;
+	});
+	auto generator = std::mt19937(42);
+	auto random = [&](crl::time till) {
+		return std::uniform_int_distribution<crl::time>(0, till)(generator);
+	};
+	auto now = crl::time(1'000'000);
+	auto entries = std::map<int, std::unique_ptr<Entry>>();
+	auto firedCount = 0;
+	auto idLast = 0;
+	const auto fire = [&](not_null<Entry*> entry) {
+		REQUIRE(now >= entry->when);
+		++firedCount;
+	};
+
+	for (auto step = 0; step != 20'000; ++step) {
+		const auto action = random(9);
+		if (action < 5) {
+			const auto delay = random(1) ? random(2000) : random(20'000'000);
+			auto entry = std::make_unique<Entry>(now + delay, fire);
+			wheel.add(entry.get(), entry->when, now);
+			entries.emplace(++idLast, std::move(entry));
+		} else if (action < 7 && !entries.empty()) {
+			const auto i = entries.lower_bound(int(random(idLast)));
+			if (i != entries.end()) {
+				entries.erase(i);
+			}
+		} else if (action < 8 || scheduled < 0) {
+			now += random(100);
+			scheduled = -1;
+			wheel.advance(now);
+		} else {
+			// Wake up exactly when asked, check nothing is overdue.
+			now = std::max(now, std::exchange(scheduled, -1));
+			wheel.advance(now);
+			for (const auto &[id, entry] : entries) {
+				if (entry->queued()) {
+					REQUIRE(entry->when + TimerWheel::kTickDuration > now);
+				}
+			}
+		}
+	}
+	while (scheduled >= 0) {
+		now = std::max(now, std::exchange(scheduled, -1));
+		wheel.advance(now);
+	}
+	auto left = 0;
+	for (const auto &[id, entry] : entries) {
+		left += entry->queued() ? 1 : 0;
+	}
+	REQUIRE(left == 0);
+	REQUIRE(wheel.size() == 0);
+	REQUIRE(firedCount > 0);
+}
@@ -0,0 +1,157 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "base/tracing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace base {
+namespace tracing {
+namespace {
+
+// Each thread keeps only the latest events, about 1.5MB of them.
+constexpr auto kBufferEvents = std::size_t(1) << 16;
+
+struct Event {
+	const char *name = nullptr;
+	Timestamp start = 0;
+	Timestamp duration = 0;
+};
+
+// Written by its thread only, the mutex is locked by others only when
+// the events are exported or dropped, so it is almost never contended.
+struct Buffer {
+	explicit Buffer(int thread) : thread(thread) {
+	}
+
+	std::mutex mutex;
+	std::vector<Event> events;
+	std::size_t next = 0;
+	int thread = 0;
+};
+
+struct Registry {
+	std::mutex mutex;
+	std::vector<std::shared_ptr<Buffer>> buffers;
+	int threadsCreated = 0;
+};
+
+Registry &GlobalRegistry() {
+	static auto result = Registry();
+	return result;
+}
+
+Buffer &ThreadBuffer() {
+	thread_local const auto result = [] {
+		auto &registry = GlobalRegistry();
+		const auto lock = std::unique_lock(registry.mutex);
+		registry.buffers.push_back(
+			std::make_shared<Buffer>(++registry.threadsCreated));
+		return registry.buffers.back();
+	}();
+	return *result;
+}
+
+void AppendEscaped(std::string &to, const char *text) {
+	for (auto ch = text; *ch; ++ch) {
+		if (*ch == '"' || *ch == '\\') {
+			to += '\\';
+		} else if (static_cast<unsigned char>(*ch) < 0x20) {
+			continue;
+		}
+		to += *ch;
+	}
+}
+
+} // namespace
+
+namespace details {
+
+std::atomic<bool> Enabled = false;
+
+Timestamp Now() {
+	using namespace std::chrono;
+	return duration_cast<microseconds>(
+		steady_clock::now().time_since_epoch()).count();
+}
+
+void Record(const char *name, Timestamp start, Timestamp finish) {
+	auto &buffer = ThreadBuffer();
+	const auto lock = std::unique_lock(buffer.mutex);
+	const auto event = Event{ name, start, finish - start };
+	if (buffer.events.size() < kBufferEvents) {
+		buffer.events.push_back(event);
+	} else {
+		buffer.events[buffer.next] = event;
+		buffer.next = (buffer.next + 1) % kBufferEvents;
+	}
+}
+
+} // namespace details
+
+void SetEnabled(bool enabled) {
+	if (enabled && !Enabled()) {
+		auto &registry = GlobalRegistry();
+		const auto lock = std::unique_lock(registry.mutex);
+		auto &buffers = registry.buffers;
+
+		// The buffers of the finished threads are not needed any more.
+		buffers.erase(std::remove_if(begin(buffers), end(buffers), [](
+				const std::shared_ptr<Buffer> &buffer) {
+			return (buffer.use_count() == 1);
+		}), end(buffers));
+		for (const auto &buffer : buffers) {
+			const auto lock = std::unique_lock(buffer->mutex);
+			buffer->events = std::vector<Event>();
+			buffer->next = 0;
+		}
+	}
+	details::Enabled = enabled;
+}
+
+std::string ExportChromeJson() {
+	auto result = std::string("{\"traceEvents\":[");
+	auto first = true;
+	const auto append = [&](const Event &event, int thread) {
+		if (!first) {
+			result += ',';
+		}
+		first = false;
+		result += "\n{\"name\":\"";
+		AppendEscaped(result, event.name);
+		result += "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+			+ std::to_string(thread)
+			+ ",\"ts\":"
+			+ std::to_string(event.start)
+			+ ",\"dur\":"
+			+ std::to_string(event.duration)
+			+ '}';
+	};
+
+	auto &registry = GlobalRegistry();
+	const auto lock = std::unique_lock(registry.mutex);
+	for (const auto &buffer : registry.buffers) {
+		const auto lock = std::unique_lock(buffer->mutex);
+		const auto &events = buffer->events;
+		const auto from = begin(events) + buffer->next;
+		for (auto i = from; i != end(events); ++i) {
+			append(*i, buffer->thread);
+		}
+		for (auto i = begin(events); i != from; ++i) {
+			append(*i, buffer->thread);
+		}
+	}
+	result += "\n],\"displayTimeUnit\":\"ms\"}\n";
+	return result;
+}
+
+} // namespace tracing
+} // namespace base
@@ -0,0 +1,75 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Scoped markers for the hot paths, recorded only while tracing is enabled
+// and exported in the Chrome about:tracing format. Define
+// TDESKTOP_DISABLE_TRACING to compile all the markers to nothing.
+//
+// The name should be a string literal, only the pointer is recorded.
+
+namespace base {
+namespace tracing {
+
+using Timestamp = std::int64_t; // Microseconds.
+
+namespace details {
+
+extern std::atomic<bool> Enabled;
+
+[[nodiscard]] Timestamp Now();
+void Record(const char *name, Timestamp start, Timestamp finish);
+
+} // namespace details
+
+[[nodiscard]] inline bool Enabled() {
+	return details::Enabled.load(std::memory_order_relaxed);
+}
+
+// Enabling starts recording from scratch, all the old events are dropped.
+void SetEnabled(bool enabled);
+
+// All the recorded events as a JSON object for about:tracing.
+[[nodiscard]] std::string ExportChromeJson();
+
+class Scope final {
+public:
+	explicit Scope(const char *name)
+	: _name(Enabled() ? name : nullptr)
+	, _start(_name ? details::Now() : 0) {
+	}
+	Scope(const Scope &other) = delete;
+	Scope &operator=(const Scope &other) = delete;
+	~Scope() {
+		if (_name) {
+			details::Record(_name, _start, details::Now());
+		}
+	}
+
+private:
+	const char *_name = nullptr;
+	Timestamp _start = 0;
+
+};
+
+} // namespace tracing
+} // namespace base
+
+#ifdef TDESKTOP_DISABLE_TRACING
+#define TRACE_SCOPE(name) ((void)0)
+#else // TDESKTOP_DISABLE_TRACING
+#define TRACE_SCOPE_CONCAT_IMPL(a, b) a##b
+#define TRACE_SCOPE_CONCAT(a, b) TRACE_SCOPE_CONCAT_IMPL(a, b)
+#define TRACE_SCOPE(name) \
+	const auto TRACE_SCOPE_CONCAT(trace_scope_, __LINE__) \
+		= ::base::tracing::Scope(name)
+#endif // TDESKTOP_DISABLE_TRACING
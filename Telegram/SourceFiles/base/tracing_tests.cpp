@@ -0,0 +1,72 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "base/tracing.h"
+#include <thread>
+
+namespace {
+
+int Count(const std::string &json, const std::string &part) {
+	auto result = 0;
+	for (auto i = json.find(part); i != std::string::npos;) {
+		++result;
+		i = json.find(part, i + part.size());
+	}
+	return result;
+}
+
+} // namespace
+
+TEST_CASE("tracing records only when enabled", "[tracing]") {
+	base::tracing::SetEnabled(false);
+	{
+		TRACE_SCOPE("disabled");
+	}
+	base::tracing::SetEnabled(true);
+	{
+		TRACE_SCOPE("outer");
+		TRACE_SCOPE("inner \"quoted\"");
+	}
+	std::thread([] {
+		TRACE_SCOPE("thread");
+	}).join();
+	base::tracing::SetEnabled(false);
+	{
+		TRACE_SCOPE("disabled");
+	}
+
+	const auto json = base::tracing::ExportChromeJson();
+	REQUIRE(Count(json, "\"ph\":\"X\"") == 3);
+	REQUIRE(Count(json, "\"disabled\"") == 0);
+	REQUIRE(Count(json, "\"outer\"") == 1);
+	REQUIRE(Count(json, "\"inner \\\"quoted\\\"\"") == 1);
+	REQUIRE(Count(json, "\"thread\"") == 1);
+
+	SECTION("enabling again drops the old events") {
+		base::tracing::SetEnabled(true);
+		base::tracing::SetEnabled(false);
+		REQUIRE(Count(base::tracing::ExportChromeJson(), "\"ph\"") == 0);
+	}
+}
+
+TEST_CASE("tracing keeps the latest events of a thread", "[tracing]") {
+	base::tracing::SetEnabled(true);
+	for (auto i = 0; i != 100'000; ++i) {
+		TRACE_SCOPE("old");
+	}
+	for (auto i = 0; i != 100; ++i) {
+		TRACE_SCOPE("new");
+	}
+	base::tracing::SetEnabled(false);
+
+	const auto json = base::tracing::ExportChromeJson();
+	REQUIRE(Count(json, "\"new\"") == 100);
+	REQUIRE(Count(json, "\"ph\"") == (1 << 16));
+	REQUIRE(json.rfind("\"old\"") < json.find("\"new\""));
+}
@@ -21,6 +21,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "lang/lang_keys.h"
 #include "mainwindow.h"
 #include "main/main_session.h"
+#include "core/application.h"
 #include "layout.h"
 #include "styles/style_boxes.h"
 
@@ -347,11 +348,13 @@ auto LocalStorageBox::summary() const -> Database::TaggedSummary {
 void LocalStorageBox::clearByTag(uint16 tag) {
 	if (tag == kFakeMediaCacheTag) {
 		_dbBig->clear();
+		Core::App().sharedMediaCache().clear();
 	} else if (tag) {
 		_db->clearByTag(tag);
 	} else {
 		_db->clear();
 		_dbBig->clear();
+		Core::App().sharedMediaCache().clear();
 		Ui::Emoji::ClearIrrelevantCache();
 	}
 }
@@ -31,6 +31,13 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/unixtime.h"
 #include "window/themes/window_theme.h"
 
+namespace {
+
+// Rows keep the prepared texts while they are that many screens away.
+constexpr auto kKeepTextsHeightsCount = 3;
+
+} // namespace
+
 auto PaintUserpicCallback(
 	not_null<PeerData*> peer,
 	bool respectSavedMessagesChat)
@@ -353,6 +360,7 @@ PeerListRow::PeerListRow(not_null<PeerData*> peer, PeerListRowId id)
 : _id(id)
 , _peer(peer)
 , _initialized(false)
+, _textsReleased(false)
 , _isSearchResult(false)
 , _isSavedMessagesChat(false) {
 }
@@ -556,6 +564,26 @@ void PeerListRow::lazyInitialize(const style::PeerListItem &st) {
 	refreshStatus();
 }
 
+void PeerListRow::releaseTexts() {
+	if (!_initialized || _textsReleased) {
+		return;
+	}
+	_textsReleased = true;
+	_name = Ui::Text::String();
+	if (_statusType != StatusType::Custom) {
+		_status = Ui::Text::String();
+	}
+}
+
+void PeerListRow::restoreTexts(const style::PeerListItem &st) {
+	if (!_textsReleased) {
+		return;
+	}
+	_textsReleased = false;
+	refreshName(st);
+	refreshStatus();
+}
+
 void PeerListRow::createCheckbox(Fn<void()> updateCallback) {
 	_checkbox = std::make_unique<Ui::RoundImageCheckbox>(
 		st::contactsPhotoCheckbox,
@@ -786,6 +814,7 @@ void PeerListContent::clearAllContent() {
 	_searchIndex.clear();
 	_rows.clear();
 	_searchRows.clear();
+	_textsFrom = _textsTill = 0;
 	_searchQuery
 		= _normalizedSearchQuery
 		= _mentionHighlight
@@ -875,6 +904,7 @@ int PeerListContent::labelHeight() const {
 void PeerListContent::refreshRows() {
 	resizeToWidth(width());
 	if (_visibleBottom > 0) {
+		releaseHiddenTexts();
 		checkScrollForPreload();
 	}
 	if (_mouseSelection) {
@@ -1110,6 +1140,7 @@ crl::time PeerListContent::paintRow(Painter &p, crl::time ms, RowIndex index) {
 	Assert(row != nullptr);
 
 	row->lazyInitialize(_st.item);
+	row->restoreTexts(_st.item);
 
 	auto refreshStatusAt = row->refreshStatusTime();
 	if (refreshStatusAt >= 0 && ms >= refreshStatusAt) {
@@ -1333,12 +1364,14 @@ void PeerListContent::searchQueryChanged(QString query) {
 				auto searchWordInNames = [](
 						not_null<PeerData*> peer,
 						const QString &searchWord) {
-					for (auto &nameWord : peer->nameWords()) {
-						if (nameWord.startsWith(searchWord)) {
-							return true;
-						}
-					}
-					return false;
+					// Names starting with the word come right after it.
+					const auto &nameWords = peer->nameWords();
+					const auto i = std::lower_bound(
+						begin(nameWords),
+						end(nameWords),
+						searchWord);
+					return (i != end(nameWords))
+						&& i->startsWith(searchWord);
 				};
 				auto allSearchWordsInNames = [&](
 						not_null<PeerData*> peer) {
@@ -1415,6 +1448,15 @@ void PeerListContent::setSearchQuery(
 	setContexted(Selected());
 	_mouseSelection = false;
 	_lastMousePosition = std::nullopt;
+
+	// The shown rows are different after the query change.
+	for (auto i = _textsFrom; i < _textsTill; ++i) {
+		if (const auto row = getRow(RowIndex(i))) {
+			row->releaseTexts();
+		}
+	}
+	_textsFrom = _textsTill = 0;
+
 	_searchQuery = query;
 	_normalizedSearchQuery = normalizedQuery;
 	_mentionHighlight = _searchQuery.startsWith('@')
@@ -1440,9 +1482,38 @@ void PeerListContent::visibleTopBottomUpdated(
 	_visibleTop = visibleTop;
 	_visibleBottom = visibleBottom;
 	loadProfilePhotos();
+	releaseHiddenTexts();
 	checkScrollForPreload();
 }
 
+void PeerListContent::releaseHiddenTexts() {
+	const auto count = shownRowsCount();
+	const auto keep = (_visibleBottom - _visibleTop) * kKeepTextsHeightsCount;
+	const auto top = _visibleTop - rowsTop() - keep;
+	const auto bottom = _visibleBottom - rowsTop() + keep;
+	const auto from = std::clamp(
+		(_rowHeight > 0) ? (std::max(top, 0) / _rowHeight) : 0,
+		0,
+		count);
+	const auto till = std::clamp(
+		(_rowHeight > 0) ? (std::max(bottom, 0) / _rowHeight + 1) : count,
+		from,
+		count);
+	const auto release = [&](int index) {
+		if (const auto row = getRow(RowIndex(index))) {
+			row->releaseTexts();
+		}
+	};
+	for (auto i = _textsFrom; i < std::min(_textsTill, from); ++i) {
+		release(i);
+	}
+	for (auto i = std::max(_textsFrom, till); i < _textsTill; ++i) {
+		release(i);
+	}
+	_textsFrom = from;
+	_textsTill = till;
+}
+
 void PeerListContent::setSelected(Selected selected) {
 	updateRow(_selected.index);
 	if (_selected != selected) {
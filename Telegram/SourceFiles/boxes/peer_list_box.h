@@ -178,6 +178,11 @@ public:
 	}
 
 	virtual void lazyInitialize(const style::PeerListItem &st);
+
+	// Rows far from the viewport drop the name and status texts,
+	// they are prepared again when the row is painted.
+	void releaseTexts();
+	void restoreTexts(const style::PeerListItem &st);
 	virtual void paintStatusText(
 		Painter &p,
 		const style::PeerListItem &st,
@@ -215,6 +220,7 @@ private:
 	int _absoluteIndex = -1;
 	State _disabledState = State::Active;
 	bool _initialized : 1;
+	bool _textsReleased : 1;
 	bool _isSearchResult : 1;
 	bool _isSavedMessagesChat : 1;
 
@@ -559,6 +565,7 @@ private:
 
 	void selectByMouse(QPoint globalPosition);
 	void loadProfilePhotos();
+	void releaseHiddenTexts();
 	void checkScrollForPreload();
 
 	void updateRow(not_null<PeerListRow*> row, RowIndex hint);
@@ -630,6 +637,11 @@ private:
 	object_ptr<Ui::FlatLabel> _searchLoading = { nullptr };
 
 	std::vector<std::unique_ptr<PeerListRow>> _searchRows;
+
+	// Shown rows that may have the texts prepared.
+	int _textsFrom = 0;
+	int _textsTill = 0;
+
 	base::Timer _repaintByStatus;
 	base::unique_qptr<Ui::PopupMenu> _contextMenu;
 
@@ -20,8 +20,11 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "calls/calls_panel.h"
 #include "data/data_user.h"
 #include "data/data_session.h"
+#include "platform/platform_specific.h"
 #include "facades.h"
 
+#include <QtCore/QRegularExpression>
+
 #ifdef slots
 #undef slots
 #define NEED_TO_RESTORE_SLOTS
@@ -42,6 +45,39 @@ constexpr auto kMinLayer = 65;
 constexpr auto kHangupTimeoutMs = 5000;
 constexpr auto kSha256Size = 32;
 
+// Stats are polled rarely, all the numbers are averages for the interval.
+constexpr auto kStatsInterval = crl::time(5000);
+constexpr auto kStatsLogsLimit = 16;
+
+QString StatsLogFolder() {
+	return cWorkingDir() + qsl("DebugLogs");
+}
+
+void RemoveOldStatsLogs() {
+	auto files = QDir(StatsLogFolder()).entryInfoList(
+		{ qsl("call_stats_*.txt") },
+		QDir::Files,
+		QDir::Time);
+	while (files.size() >= kStatsLogsLimit) {
+		QFile(files.back().absoluteFilePath()).remove();
+		files.pop_back();
+	}
+}
+
+// The controller puts packet loss and jitter only in the debug string.
+std::optional<int> ParseDebugValue(
+		const QString &debug,
+		const QString &pattern,
+		int group = 1) {
+	const auto match = QRegularExpression(pattern).match(debug);
+	if (!match.hasMatch()) {
+		return std::nullopt;
+	}
+	auto ok = false;
+	const auto result = match.captured(group).toDouble(&ok);
+	return ok ? std::make_optional(int(std::round(result))) : std::nullopt;
+}
+
 void AppendEndpoint(
 		std::vector<tgvoip::Endpoint> &list,
 		const MTPPhoneConnection &connection) {
@@ -637,6 +673,92 @@ void Call::createAndStartController(const MTPDphoneCall &call) {
 	}
 	_controller->Start();
 	_controller->Connect();
+	if (Logs::DebugEnabled()) {
+		startStats();
+	}
+}
+
+void Call::startStats() {
+	QDir().mkpath(StatsLogFolder());
+	RemoveOldStatsLogs();
+	const auto name = qsl("/call_stats_%1_%2.txt").arg(
+		QDateTime::currentDateTime().toString(qsl("yyyyMMdd_hhmmss"))
+	).arg(_id);
+	_statsFile = std::make_unique<QFile>(StatsLogFolder() + name);
+	if (!_statsFile->open(QIODevice::WriteOnly | QIODevice::Append)) {
+		LOG(("Call Error: Could not open '%1' for stats."
+			).arg(_statsFile->fileName()));
+		_statsFile = nullptr;
+		return;
+	}
+	_statsFile->write(qsl("{\"call\":\"%1\",\"type\":\"%2\"}\n"
+	).arg(_id
+	).arg((_type == Type::Outgoing) ? qsl("outgoing") : qsl("incoming")
+	).toUtf8());
+
+	_statsTime = crl::now();
+	_statsCpuTime = Platform::ProcessCpuTime().value_or(0);
+	_statsBytesSent = _statsBytesReceived = 0;
+	_statsTimer.setCallback([=] { collectStats(); });
+	_statsTimer.callEach(kStatsInterval);
+}
+
+void Call::collectStats() {
+	if (!_controller || !_statsFile) {
+		return;
+	}
+	const auto now = crl::now();
+	const auto elapsed = std::max(now - _statsTime, crl::time(1));
+
+	auto traffic = tgvoip::VoIPController::TrafficStats();
+	_controller->GetStats(&traffic);
+	const auto sent = uint64(traffic.bytesSentWifi + traffic.bytesSentMobile);
+	const auto received = uint64(
+		traffic.bytesRecvdWifi + traffic.bytesRecvdMobile);
+	const auto cpu = Platform::ProcessCpuTime();
+	const auto debug = getDebugLog();
+	const auto rtt = int(std::round(_controller->GetAverageRTT() * 1000));
+
+	auto fields = QStringList();
+	const auto add = [&](const char *name, std::optional<int> value) {
+		if (value) {
+			fields.push_back(qsl("\"%1\":%2").arg(name).arg(*value));
+		}
+	};
+	const auto losses = qsl("losses: (\\d+)/(\\d+) \\((\\d+)%\\)");
+	const auto jitter = qsl("Jitter buffer: (\\d+)/([\\d.]+)");
+	add("duration_ms", _startTime ? int(now - _startTime) : 0);
+	add("rtt_ms", rtt);
+	add("send_loss", ParseDebugValue(debug, losses, 1));
+	add("recv_loss", ParseDebugValue(debug, losses, 2));
+	add("loss_percent", ParseDebugValue(debug, losses, 3));
+	add("jitter_delay", ParseDebugValue(debug, jitter, 1));
+	add("jitter_average", ParseDebugValue(debug, jitter, 2));
+	add("audio_kbit", ParseDebugValue(debug, qsl("Audio bitrate: (\\d+)")));
+	add("sent_kbit", int((sent - _statsBytesSent) * 8 / elapsed));
+	add("received_kbit", int((received - _statsBytesReceived) * 8 / elapsed));
+	if (cpu) {
+		add("cpu_percent", int((*cpu - _statsCpuTime) * 100 / elapsed));
+		_statsCpuTime = *cpu;
+	}
+	add("bars", _signalBarCount);
+	fields.push_back(qsl("\"codec\":\"opus\""));
+
+	_statsFile->write(('{' + fields.join(',') + qsl("}\n")).toUtf8());
+	_statsFile->flush();
+
+	_statsTime = now;
+	_statsBytesSent = sent;
+	_statsBytesReceived = received;
+}
+
+void Call::finishStats() {
+	if (!_statsFile) {
+		return;
+	}
+	collectStats();
+	_statsTimer.cancel();
+	_statsFile = nullptr;
 }
 
 void Call::handleControllerStateChange(
@@ -896,6 +1018,7 @@ void Call::handleControllerError(int error) {
 void Call::destroyController() {
 	if (_controller) {
 		DEBUG_LOG(("Call Info: Destroying call controller.."));
+		finishStats();
 		_controller.reset();
 		DEBUG_LOG(("Call Info: Call controller destroyed."));
 	}
@@ -181,6 +181,10 @@ private:
 	void setSignalBarCount(int count);
 	void destroyController();
 
+	void startStats();
+	void collectStats();
+	void finishStats();
+
 	not_null<Delegate*> _delegate;
 	not_null<UserData*> _user;
 	Type _type = Type::Outgoing;
@@ -211,6 +215,14 @@ private:
 
 	ControllerPointer _controller;
 
+	// Quality and CPU samples written to a log while debug logs are on.
+	base::Timer _statsTimer;
+	std::unique_ptr<QFile> _statsFile;
+	crl::time _statsTime = 0;
+	crl::time _statsCpuTime = 0;
+	uint64 _statsBytesSent = 0;
+	uint64 _statsBytesReceived = 0;
+
 	std::unique_ptr<Media::Audio::Track> _waitingTrack;
 
 };
@@ -16,6 +16,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "main/main_account.h"
 #include "main/main_session.h"
 #include "apiwrap.h"
+#include "base/flat_set.h"
 
 #include <QtGui/QGuiApplication>
 
@@ -41,6 +42,14 @@ struct LangPackData {
 	std::map<QString, std::vector<LangPackEmoji>> emoji;
 };
 
+// Contiguous copy of the LangPackData::emoji keys, in the same order,
+// so that the prefix lookup on every keystroke is a binary search
+// over an array instead of a walk over the map nodes.
+struct LangPackIndexEntry {
+	QString key;
+	not_null<const std::vector<LangPackEmoji>*> list;
+};
+
 [[nodiscard]] bool MustAddPostfix(const QString &text) {
 	if (text.size() != 1) {
 		return false;
@@ -164,23 +173,31 @@ void WriteLocalCache(const QString &id, const LangPackData &data) {
 	return key.toLower().trimmed();
 }
 
+[[nodiscard]] std::vector<LangPackIndexEntry> BuildIndex(
+		const LangPackData &data) {
+	auto result = std::vector<LangPackIndexEntry>();
+	result.reserve(data.emoji.size());
+	for (const auto &[key, list] : data.emoji) {
+		result.push_back({ key, &list });
+	}
+	return result;
+}
+
 void AppendFoundEmoji(
 		std::vector<Result> &result,
+		base::flat_set<EmojiPtr> &added,
 		const QString &label,
 		const std::vector<LangPackEmoji> &list) {
-	auto &&add = ranges::view::all(
-		list
-	) | ranges::view::filter([&](const LangPackEmoji &entry) {
-		const auto i = ranges::find(result, entry.emoji, &Result::emoji);
-		return (i == end(result));
-	}) | ranges::view::transform([&](const LangPackEmoji &entry) {
-		return Result{ entry.emoji, label, entry.text };
-	});
-	result.insert(end(result), add.begin(), add.end());
+	for (const auto &entry : list) {
+		if (added.emplace(entry.emoji).second) {
+			result.push_back({ entry.emoji, label, entry.text });
+		}
+	}
 }
 
 void AppendLegacySuggestions(
 		std::vector<Result> &result,
+		base::flat_set<EmojiPtr> &added,
 		const QString &query) {
 	const auto badSuggestionChar = [](QChar ch) {
 		return (ch < 'a' || ch > 'z')
@@ -195,22 +212,16 @@ void AppendLegacySuggestions(
 	}
 
 	const auto suggestions = GetSuggestions(QStringToUTF16(query));
-	auto &&add = ranges::view::all(
-		suggestions
-	) | ranges::view::transform([](const Suggestion &suggestion) {
-		return Result{
-			Find(QStringFromUTF16(suggestion.emoji())),
-			QStringFromUTF16(suggestion.label()),
-			QStringFromUTF16(suggestion.replacement())
-		};
-	}) | ranges::view::filter([&](const Result &entry) {
-		const auto i = entry.emoji
-			? ranges::find(result, entry.emoji, &Result::emoji)
-			: end(result);
-		return (entry.emoji != nullptr)
-			&& (i == end(result));
-	});
-	result.insert(end(result), add.begin(), add.end());
+	for (const auto &suggestion : suggestions) {
+		const auto emoji = Find(QStringFromUTF16(suggestion.emoji()));
+		if (emoji && added.emplace(emoji).second) {
+			result.push_back({
+				emoji,
+				QStringFromUTF16(suggestion.label()),
+				QStringFromUTF16(suggestion.replacement())
+			});
+		}
+	}
 }
 
 void ApplyDifference(
@@ -290,7 +301,9 @@ public:
 	void refresh();
 	void apiChanged();
 
-	[[nodiscard]] std::vector<Result> query(
+	void query(
+		std::vector<Result> &result,
+		base::flat_set<EmojiPtr> &added,
 		const QString &normalized,
 		bool exact) const;
 	[[nodiscard]] int maxQueryLength() const;
@@ -311,6 +324,7 @@ private:
 	QString _id;
 	State _state = State::ReadingCache;
 	LangPackData _data;
+	std::vector<LangPackIndexEntry> _index;
 	crl::time _lastRefreshTime = 0;
 	mtpRequestId _requestId = 0;
 	base::binary_guard _guard;
@@ -425,6 +439,7 @@ void EmojiKeywords::LangPack::applyDifference(
 
 void EmojiKeywords::LangPack::applyData(LangPackData &&data) {
 	_data = std::move(data);
+	_index = BuildIndex(_data);
 	_state = State::Refreshed;
 	_delegate->langPackRefreshed();
 }
@@ -439,29 +454,31 @@ void EmojiKeywords::LangPack::apiChanged() {
 	refresh();
 }
 
-std::vector<Result> EmojiKeywords::LangPack::query(
+void EmojiKeywords::LangPack::query(
+		std::vector<Result> &result,
+		base::flat_set<EmojiPtr> &added,
 		const QString &normalized,
 		bool exact) const {
 	if (normalized.size() > _data.maxKeyLength
-		|| _data.emoji.empty()
+		|| _index.empty()
 		|| (exact && SkipExactKeyword(_id, normalized))) {
-		return {};
+		return;
 	}
 
-	const auto from = _data.emoji.lower_bound(normalized);
-	auto &&chosen = ranges::subrange(
-		from,
-		end(_data.emoji)
-	) | ranges::view::take_while([&](const auto &pair) {
-		const auto &key = pair.first;
-		return exact ? (key == normalized) : key.startsWith(normalized);
-	});
-
-	auto result = std::vector<Result>();
-	for (const auto &[key, list] : chosen) {
-		AppendFoundEmoji(result, key, list);
+	const auto till = end(_index);
+	for (auto i = std::lower_bound(
+			begin(_index),
+			till,
+			normalized,
+			[](const LangPackIndexEntry &entry, const QString &key) {
+				return entry.key < key;
+			}); i != till; ++i) {
+		const auto &key = i->key;
+		if (exact ? (key != normalized) : !key.startsWith(normalized)) {
+			break;
+		}
+		AppendFoundEmoji(result, added, key, *i->list);
 	}
-	return result;
 }
 
 int EmojiKeywords::LangPack::maxQueryLength() const {
@@ -583,27 +600,12 @@ std::vector<Result> EmojiKeywords::query(
 		return {};
 	}
 	auto result = std::vector<Result>();
+	auto added = base::flat_set<EmojiPtr>();
 	for (const auto &[language, item] : _data) {
-		const auto oldcount = result.size();
-		const auto list = item->query(normalized, exact);
-		auto &&add = ranges::view::all(
-			list
-		) | ranges::view::filter([&](Result entry) {
-			// In each item->query() result the list has no duplicates.
-			// So we need to check only for duplicates between queries.
-			const auto oldbegin = begin(result);
-			const auto oldend = oldbegin + oldcount;
-			const auto i = ranges::find(
-				oldbegin,
-				oldend,
-				entry.emoji,
-				&Result::emoji);
-			return (i == oldend);
-		});
-		result.insert(end(result), add.begin(), add.end());
+		item->query(result, added, normalized, exact);
 	}
 	if (!exact) {
-		AppendLegacySuggestions(result, query);
+		AppendLegacySuggestions(result, added, query);
 	}
 	return result;
 }
@@ -22,6 +22,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "main/main_session.h"
 #include "chat_helpers/stickers.h"
 #include "base/unixtime.h"
+#include "observer_peer.h"
 #include "facades.h"
 #include "app.h"
 #include "styles/style_history.h"
@@ -30,6 +31,58 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include <QtWidgets/QApplication>
 
+namespace internal {
+
+template <typename Container>
+void MentionsIndex::refresh(
+		not_null<PeerData*> peer,
+		const Container &users) {
+	const auto signature = Signature{
+		peer,
+		int(users.size()),
+		users.empty() ? nullptr : users.front().get(),
+		users.empty() ? nullptr : users.back().get(),
+	};
+	if (_signature == signature) {
+		return;
+	}
+	_signature = signature;
+	_all.clear();
+	_byFirstLetter.clear();
+	_all.reserve(users.size());
+	for (const auto user : users) {
+		add(user);
+	}
+}
+
+void MentionsIndex::invalidate() {
+	_signature = Signature();
+}
+
+void MentionsIndex::add(not_null<UserData*> user) {
+	_all.push_back(user);
+	for (const auto letter : user->nameFirstLetters()) {
+		_byFirstLetter[letter].push_back(user);
+	}
+	if (!user->username.isEmpty()) {
+		const auto letter = user->username[0].toLower();
+		if (!user->nameFirstLetters().contains(letter)) {
+			_byFirstLetter[letter].push_back(user);
+		}
+	}
+}
+
+auto MentionsIndex::candidates(const QString &filter) const -> const Users & {
+	static const auto kEmpty = Users();
+	if (filter.isEmpty()) {
+		return _all;
+	}
+	const auto i = _byFirstLetter.find(filter[0].toLower());
+	return (i != end(_byFirstLetter)) ? i->second : kEmpty;
+}
+
+} // namespace internal
+
 FieldAutocomplete::FieldAutocomplete(
 	QWidget *parent,
 	not_null<Main::Session*> session)
@@ -59,6 +112,15 @@ FieldAutocomplete::FieldAutocomplete(
 	hide();
 
 	connect(_scroll, SIGNAL(geometryChanged()), _inner, SLOT(onParentGeometryChanged()));
+
+	using UpdateFlag = Notify::PeerUpdate::Flag;
+	Notify::PeerUpdateViewer(
+		UpdateFlag::NameChanged
+		| UpdateFlag::UsernameChanged
+		| UpdateFlag::MembersChanged
+	) | rpl::start_with_next([=] {
+		_mentionsIndex.invalidate();
+	}, lifetime());
 }
 
 FieldAutocomplete::~FieldAutocomplete() = default;
@@ -157,7 +219,7 @@ bool FieldAutocomplete::clearFilteredBotCommands() {
 namespace {
 template <typename T, typename U>
 inline int indexOfInFirstN(const T &v, const U &elem, int last) {
-	for (auto b = v.cbegin(), i = b, e = b + qMax(v.size(), last); i != e; ++i) {
+	for (auto b = v.cbegin(), i = b, e = b + qMin(v.size(), last); i != e; ++i) {
 		if (*i == elem) {
 			return (i - b);
 		}
@@ -249,7 +311,8 @@ void FieldAutocomplete::updateFiltered(bool resetScroll) {
 			if (_chat->noParticipantInfo()) {
 				Auth().api().requestFullPeer(_chat);
 			} else if (!_chat->participants.empty()) {
-				for (const auto user : _chat->participants) {
+				_mentionsIndex.refresh(_chat, _chat->participants);
+				for (const auto user : _mentionsIndex.candidates(_filter)) {
 					if (user->isInaccessible()) continue;
 					if (!listAllSuggestions && filterNotPassedByName(user)) continue;
 					if (indexOfInFirstN(mrows, user, recentInlineBots) >= 0) continue;
@@ -276,8 +339,11 @@ void FieldAutocomplete::updateFiltered(bool resetScroll) {
 			if (_channel->mgInfo->lastParticipants.empty() || _channel->lastParticipantsCountOutdated()) {
 				Auth().api().requestLastParticipants(_channel);
 			} else {
-				mrows.reserve(mrows.size() + _channel->mgInfo->lastParticipants.size());
-				for (const auto user : _channel->mgInfo->lastParticipants) {
+				const auto &participants = _channel->mgInfo->lastParticipants;
+				_mentionsIndex.refresh(_channel, participants);
+				const auto &candidates = _mentionsIndex.candidates(_filter);
+				mrows.reserve(mrows.size() + candidates.size());
+				for (const auto user : candidates) {
 					if (user->isInaccessible()) continue;
 					if (!listAllSuggestions && filterNotPassedByName(user)) continue;
 					if (indexOfInFirstN(mrows, user, recentInlineBots) >= 0) continue;
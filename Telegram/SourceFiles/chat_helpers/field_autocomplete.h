@@ -40,6 +40,45 @@ using StickerRows = std::vector<StickerSuggestion>;
 
 class FieldAutocompleteInner;
 
+// Chat members grouped by the first letters of their name words and
+// username, so that a query checks only the members that can match it.
+// It is rebuilt lazily, only when the members list has changed.
+class MentionsIndex final {
+public:
+	using Users = std::vector<not_null<UserData*>>;
+
+	template <typename Container>
+	void refresh(not_null<PeerData*> peer, const Container &users);
+	void invalidate();
+
+	// All the members when the filter is empty.
+	[[nodiscard]] const Users &candidates(const QString &filter) const;
+
+private:
+	struct Signature {
+		PeerData *peer = nullptr;
+		int size = 0;
+		UserData *front = nullptr;
+		UserData *back = nullptr;
+
+		friend inline bool operator==(
+				const Signature &a,
+				const Signature &b) {
+			return (a.peer == b.peer)
+				&& (a.size == b.size)
+				&& (a.front == b.front)
+				&& (a.back == b.back);
+		}
+	};
+
+	void add(not_null<UserData*> user);
+
+	Signature _signature;
+	Users _all;
+	base::flat_map<QChar, Users> _byFirstLetter;
+
+};
+
 } // namespace internal
 
 class FieldAutocomplete final : public Ui::RpWidget {
@@ -138,6 +177,7 @@ private:
 		Stickers,
 	};
 	Type _type = Type::Mentions;
+	internal::MentionsIndex _mentionsIndex;
 	QString _filter;
 	QRect _boundings;
 	bool _addInlineBots;
@@ -14,8 +14,10 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "lang/lang_keys.h"
 #include "apiwrap.h"
 #include "storage/localstorage.h"
+#include "storage/cache/storage_cache_database.h"
 #include "mainwidget.h"
 #include "main/main_session.h"
+#include "core/application.h"
 #include "mainwindow.h"
 #include "ui/toast/toast.h"
 #include "ui/emoji_config.h"
@@ -723,10 +725,11 @@ std::vector<not_null<DocumentData*>> GetListByEmoji(
 	auto &sets = session->data().stickerSetsRef();
 	auto setsToRequest = base::flat_map<uint64, uint64>();
 
+	// A popular emoji can be found in most of the installed sets,
+	// so a linear search in the result for each sticker is quadratic.
+	auto added = base::flat_set<not_null<DocumentData*>>();
 	const auto add = [&](not_null<DocumentData*> document, TimeId date) {
-		if (ranges::find(result, document, [](const StickerWithDate &data) {
-			return data.document;
-		}) == result.end()) {
+		if (added.emplace(document).second) {
 			result.push_back({ document, date });
 		}
 	};
@@ -798,9 +801,7 @@ std::vector<not_null<DocumentData*>> GetListByEmoji(
 				const auto date = usageDate
 					? usageDate
 					: InstallDate(document);
-				result.push_back({
-					document,
-					date ? date : CreateRecentSortKey(document) });
+				add(document, date ? date : CreateRecentSortKey(document));
 			}
 		}
 	}
@@ -1126,14 +1127,12 @@ auto LottieCachedFromContent(
 		baseKey.low + keyShift
 	};
 	const auto get = [=](FnMut<void(QByteArray &&cached)> handler) {
-		session->data().cacheBigFile().get(
-			key,
-			std::move(handler));
+		Core::App().sharedMediaCache().get(key, std::move(handler));
 	};
 	const auto weak = base::make_weak(session.get());
 	const auto put = [=](QByteArray &&cached) {
 		crl::on_main(weak, [=, data = std::move(cached)]() mutable {
-			weak->data().cacheBigFile().put(key, std::move(data));
+			Core::App().sharedMediaCache().put(key, std::move(data));
 		});
 	};
 	return method(
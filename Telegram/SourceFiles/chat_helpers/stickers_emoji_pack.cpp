@@ -138,6 +138,7 @@ public:
 	void cancel() override;
 	float64 progress() override;
 	int loadOffset() override;
+	QByteArray loadedBytes() override;
 
 	const StorageImageLocation &location() override;
 	void refreshFileReference(const QByteArray &data) override;
@@ -249,6 +250,10 @@ int ImageSource::loadOffset() {
 	return 0;
 }
 
+QByteArray ImageSource::loadedBytes() {
+	return QByteArray();
+}
+
 const StorageImageLocation &ImageSource::location() {
 	return StorageImageLocation::Invalid();
 }
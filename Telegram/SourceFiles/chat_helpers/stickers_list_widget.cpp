@@ -1498,10 +1498,49 @@ void StickersListWidget::checkVisibleLottie() {
 				&& visibleBottom < info.rowsBottom)) {
 			pauseInvisibleLottieIn(info);
 		}
+		if ((destroyAbove > info.rowsTop && destroyAbove < info.rowsBottom)
+			|| (destroyBelow > info.rowsTop
+				&& destroyBelow < info.rowsBottom)) {
+			destroyFarLottieIn(info, destroyAbove, destroyBelow);
+		}
 		return true;
 	});
 }
 
+// Large sets (recent, faved, big packs) can be much taller than the
+// visible band, so the animations of their far rows are destroyed one
+// by one. The small sticker thumbnail is painted until they're recreated.
+void StickersListWidget::destroyFarLottieIn(
+		const SectionInfo &info,
+		int destroyAbove,
+		int destroyBelow) {
+	auto &set = shownSets()[info.section];
+	const auto player = set.lottiePlayer;
+	const auto i = _lottieData.find(set.id);
+	if (!player || i == end(_lottieData)) {
+		return;
+	}
+	auto &items = i->second.items;
+	const auto rowHeight = _singleSize.height();
+	for (auto row = 0; row != info.rowsCount; ++row) {
+		const auto top = info.rowsTop + row * rowHeight;
+		if (top + rowHeight > destroyAbove && top < destroyBelow) {
+			continue;
+		}
+		for (auto j = 0; j != _columnCount; ++j) {
+			const auto index = row * _columnCount + j;
+			if (index >= info.count) {
+				break;
+			}
+			auto &sticker = set.stickers[index];
+			if (const auto animated = base::take(sticker.animated)) {
+				player->remove(animated);
+				items.remove(sticker.document->id);
+			}
+		}
+	}
+}
+
 void StickersListWidget::destroyLottieIn(Set &set) {
 	if (!set.lottiePlayer) {
 		return;
@@ -2193,6 +2232,7 @@ void StickersListWidget::refillLottieData(Set &set) {
 	}
 	for (auto j = begin(items); j != end(items);) {
 		if (j->second.stale) {
+			i->second.player->remove(j->second.animation);
 			j = items.erase(j);
 		} else {
 			++j;
@@ -256,6 +256,10 @@ private:
 	void markLottieFrameShown(Set &set);
 	void checkVisibleLottie();
 	void pauseInvisibleLottieIn(const SectionInfo &info);
+	void destroyFarLottieIn(
+		const SectionInfo &info,
+		int destroyAbove,
+		int destroyBelow);
 	void destroyLottieIn(Set &set);
 	void refillLottieData();
 	void refillLottieData(Set &set);
@@ -14,6 +14,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "window/window_session_controller.h"
 #include "mainwindow.h"
 #include "core/application.h"
+#include "core/core_startup_timeline.h"
 #include "app.h"
 #include "styles/style_chat_helpers.h"
 
@@ -175,6 +176,8 @@ void TabbedPanel::updateContentHeight() {
 }
 
 void TabbedPanel::paintEvent(QPaintEvent *e) {
+	Core::StartupMilestone("tabbed panel painted");
+
 	Painter p(this);
 
 	// This call can finish _a_show animation and destroy _showAnimation.
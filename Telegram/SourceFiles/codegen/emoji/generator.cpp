@@ -15,6 +15,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <QtGui/QPainter>
 #include <QtCore/QDir>
 
+#include <array>
+
 #ifdef SUPPORT_IMAGE_GENERATION
 Q_IMPORT_PLUGIN(QWebpPlugin)
 #ifdef Q_OS_MAC
@@ -31,6 +33,7 @@ namespace emoji {
 namespace {
 
 constexpr auto kErrorCantWritePath = 851;
+constexpr auto kErrorTooManyFirstUnitPages = 852;
 
 constexpr auto kOriginalBits = 12;
 constexpr auto kIdSizeBits = 6;
@@ -364,6 +367,22 @@ EmojiPtr Find(const QChar *start, const QChar *end, int *outLength) {\n\
 	return index ? &Items[index - 1] : nullptr;\n\
 }\n\
 \n\
+EmojiPtr FindNext(\n\
+		const QChar *start,\n\
+		const QChar *end,\n\
+		const QChar **outStart,\n\
+		int *outLength) {\n\
+	for (auto ch = start; ch != end; ++ch) {\n\
+		if (!MayStartEmoji(ch->unicode())) {\n\
+			continue;\n\
+		} else if (const auto index = FindIndex(ch, end, outLength)) {\n\
+			if (outStart) *outStart = ch;\n\
+			return &Items[index - 1];\n\
+		}\n\
+	}\n\
+	return nullptr;\n\
+}\n\
+\n\
 void Init() {\n\
 	auto id = IdData;\n\
 	auto takeString = [&id](int size) {\n\
@@ -421,6 +440,11 @@ int FullCount();\n\
 EmojiPtr ByIndex(int index);\n\
 \n\
 EmojiPtr Find(const QChar *ch, const QChar *end, int *outLength = nullptr);\n\
+EmojiPtr FindNext(\n\
+	const QChar *start,\n\
+	const QChar *end,\n\
+	const QChar **outStart,\n\
+	int *outLength = nullptr);\n\
 \n\
 const std::vector<std::pair<QString, int>> GetReplacementPairs();\n\
 EmojiPtr FindReplace(const QChar *ch, const QChar *end, int *outLength = nullptr);\n\
@@ -630,10 +654,71 @@ int FindReplaceIndex(const QChar *start, const QChar *end, int *outLength) {\n\
 	return true;
 }
 
+bool Generator::writeFirstUnitFilter() {
+	// Two level bitmap of the first UTF-16 units of all emoji: a page
+	// index for the high byte and 256 bits for the low one, page 0 empty.
+	auto pages = std::map<int, std::array<quint64, 4>>();
+	for (auto &item : data_.map) {
+		const auto unit = item.first[0].unicode();
+		auto &bits = pages[unit >> 8];
+		bits[(unit >> 6) & 3] |= (quint64(1) << (unit & 63));
+	}
+	if (pages.size() > 255) {
+		common::logError(kErrorTooManyFirstUnitPages, "emoji") << "too many first unit pages.";
+		return false;
+	}
+
+	source_->stream() << "\
+\n\
+constexpr uchar FirstUnitPages[256] = {";
+	auto pageIndices = std::map<int, int>();
+	for (const auto &[page, bits] : pages) {
+		pageIndices.emplace(page, int(pageIndices.size()) + 1);
+	}
+	for (auto i = 0; i != 256; ++i) {
+		const auto j = pageIndices.find(i);
+		source_->stream()
+			<< ((i % 32) ? " " : "\n\t")
+			<< ((j != end(pageIndices)) ? j->second : 0)
+			<< ",";
+	}
+	source_->stream() << "\n\
+};\n\
+\n\
+constexpr uint64 FirstUnitBits[][4] = {\n\
+	{ 0, 0, 0, 0 },\n";
+	for (const auto &[page, bits] : pages) {
+		source_->stream() << "\t{ ";
+		for (auto i = 0; i != 4; ++i) {
+			source_->stream()
+				<< (i ? ", " : "")
+				<< "0x"
+				<< QString::number(bits[i], 16)
+				<< "ULL";
+		}
+		source_->stream() << " },\n";
+	}
+	source_->stream() << "\
+};\n\
+\n\
+inline bool MayStartEmoji(ushort unit) {\n\
+	const auto &bits = FirstUnitBits[FirstUnitPages[unit >> 8]];\n\
+	return (bits[(unit >> 6) & 3] >> (unit & 63)) & 1;\n\
+}\n";
+
+	return true;
+}
+
 bool Generator::writeFind() {
+	if (!writeFirstUnitFilter()) {
+		return false;
+	}
 	source_->stream() << "\
 \n\
 int FindIndex(const QChar *start, const QChar *end, int *outLength) {\n\
+	if (start == end || !MayStartEmoji(start->unicode())) {\n\
+		return 0;\n\
+	}\n\
 	auto ch = start;\n\
 \n";
 
@@ -48,6 +48,7 @@ private:
 	bool writeGetSections();
 	bool writeFindReplace();
 	bool writeFind();
+	bool writeFirstUnitFilter();
 	bool writeFindFromDictionary(
 		const std::map<QString, int, std::greater<QString>> &dictionary,
 		bool skipPostfixes = false,
@@ -10,6 +10,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/crc32hash.h"
 
 #include <set>
+#include <cmath>
+#include <iterator>
 #include <memory>
 #include <functional>
 #include <QtCore/QDir>
@@ -30,6 +32,11 @@ namespace {
 
 constexpr int kErrorBadIconSize     = 861;
 
+// Interface scales from the settings, their px values are computed here.
+constexpr int kPrecomputedScales[] = {
+	100, 110, 120, 125, 130, 140, 150, 200, 250, 300
+};
+
 const auto kMustBeContrast = std::map<QString, QString>{
 	{ "dialogsMenuIconFg", "dialogsBg" },
 	{ "windowBoldFg", "windowBg" },
@@ -108,6 +115,13 @@ QString stringToBinaryArray(const std::string &str) {
 	return QString("{") + ((rows.size() > 1) ? '\n' : ' ') + rows.join(",\n") + " }";
 }
 
+// Must give the same results as style::ConvertScale().
+int convertScale(int value, int scale) {
+	return (value < 0)
+		? (-convertScale(-value, scale))
+		: int(std::round((double(value) * scale / 100.) - 0.01));
+}
+
 QString pxValueName(int value) {
 	QString result = "px";
 	if (value < 0) {
@@ -1128,16 +1142,46 @@ bool Generator::writePxValuesInit() {
 		return true;
 	}
 
+	const auto joinValues = [&](auto &&convert) {
+		auto result = QStringList();
+		for (auto i = pxValues_.cbegin(), e = pxValues_.cend(); i != e; ++i) {
+			result.push_back(QString::number(convert(i.key())));
+		}
+		return result.join(", ");
+	};
+	const auto count = pxValues_.size();
+	const auto scales = int(std::size(kPrecomputedScales));
+	source_->stream() << "int pxValues[" << count << "] = { " << joinValues([](int value) { return value; }) << " };\n";
+	auto index = 0;
 	for (auto i = pxValues_.cbegin(), e = pxValues_.cend(); i != e; ++i) {
-		source_->stream() << "int " << pxValueName(i.key()) << " = " << i.key() << ";\n";
+		source_->stream() << "int &" << pxValueName(i.key()) << " = pxValues[" << (index++) << "];\n";
 	}
 	source_->stream() << "\
-void initPxValues(int scale) {\n";
-	for (auto it = pxValues_.cbegin(), e = pxValues_.cend(); it != e; ++it) {
-		auto value = it.key();
-		source_->stream() << "\t" << pxValueName(value) << " = ConvertScale(" << value << ", scale);\n";
+\n\
+const int pxScales[" << scales << "] = { ";
+	for (auto i = 0; i != scales; ++i) {
+		source_->stream() << (i ? ", " : "") << kPrecomputedScales[i];
+	}
+	source_->stream() << " };\n\
+const int pxScaledValues[" << scales << "][" << count << "] = {\n";
+	for (const auto scale : kPrecomputedScales) {
+		source_->stream() << "\t{ " << joinValues([&](int value) { return convertScale(value, scale); }) << " },\n";
 	}
 	source_->stream() << "\
+};\n\
+\n\
+void initPxValues(int scale) {\n\
+	for (auto i = 0; i != " << scales << "; ++i) {\n\
+		if (pxScales[i] == scale) {\n\
+			for (auto j = 0; j != " << count << "; ++j) {\n\
+				pxValues[j] = pxScaledValues[i][j];\n\
+			}\n\
+			return;\n\
+		}\n\
+	}\n\
+	for (auto &value : pxValues) {\n\
+		value = ConvertScale(value, scale);\n\
+	}\n\
 }\n\n";
 	return true;
 }
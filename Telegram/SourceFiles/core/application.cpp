@@ -20,6 +20,9 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/local_url_handlers.h"
 #include "core/launcher.h"
 #include "core/core_ui_integration.h"
+#include "core/core_startup_timeline.h"
+#include "core/core_memory_usage.h"
+#include "core/media_memory.h"
 #include "chat_helpers/emoji_keywords.h"
 #include "storage/localstorage.h"
 #include "platform/platform_specific.h"
@@ -74,6 +77,8 @@ namespace Core {
 namespace {
 
 constexpr auto kQuitPreventTimeoutMs = 1500;
+constexpr auto kMemoryUsageLogDelay = 10 * 60 * crl::time(1000);
+constexpr auto kMemoryPressureCheckDelay = 10 * crl::time(1000);
 
 } // namespace
 
@@ -93,7 +98,9 @@ Application::Application(not_null<Launcher*> launcher)
 , _dcOptions(std::make_unique<MTP::DcOptions>())
 , _account(std::make_unique<Main::Account>(cDataFile()))
 , _langpack(std::make_unique<Lang::Instance>())
-, _emojiKeywords(std::make_unique<ChatHelpers::EmojiKeywords>())
+, _emojiKeywords([] {
+	return std::make_unique<ChatHelpers::EmojiKeywords>();
+})
 , _audio(std::make_unique<Media::Audio::Instance>())
 , _logo(Window::LoadLogo())
 , _logoNoMargin(Window::LoadLogoNoMargin()) {
@@ -185,7 +192,10 @@ void Application::run() {
 
 	style::startManager(cScale());
 	Ui::InitTextOptions();
-	Ui::Emoji::Init();
+	{
+		const auto phase = StartupPhase("Emoji::Init");
+		Ui::Emoji::Init();
+	}
 	Media::Player::start(_audio.get());
 
 	style::ShortAnimationPlaying(
@@ -203,9 +213,15 @@ void Application::run() {
 
 	DEBUG_LOG(("Application Info: starting app..."));
 
-	// Create mime database, so it won't be slow later.
-	QMimeDatabase().mimeTypeForName(qsl("text/plain"));
+	postponeUntilFirstPaint([=] {
+		// Create mime database, so it won't be slow later.
+		QMimeDatabase().mimeTypeForName(qsl("text/plain"));
+	});
+	postponeUntilFirstPaint([=] {
+		_emojiKeywords.ensure();
+	});
 
+	auto windowPhase = std::make_optional<StartupPhase>("window create");
 	_window = std::make_unique<Window::Controller>(&activeAccount());
 
 	const auto currentGeometry = _window->widget()->geometry();
@@ -223,6 +239,7 @@ void Application::run() {
 
 	startShortcuts();
 	App::initMedia();
+	windowPhase = std::nullopt;
 
 	Local::ReadMapState state = Local::readMap(QByteArray());
 	if (state == Local::ReadMapPassNeeded) {
@@ -232,8 +249,12 @@ void Application::run() {
 		DEBUG_LOG(("Application Info: passcode needed..."));
 	} else {
 		DEBUG_LOG(("Application Info: local map read..."));
-		activeAccount().startMtp();
+		{
+			const auto phase = StartupPhase("MTP start");
+			activeAccount().startMtp();
+		}
 		DEBUG_LOG(("Application Info: MTP started..."));
+		const auto phase = StartupPhase("window setup");
 		if (activeAccount().sessionExists()) {
 			_window->setupMain();
 		} else {
@@ -241,7 +262,11 @@ void Application::run() {
 		}
 	}
 	DEBUG_LOG(("Application Info: showing."));
-	_window->firstShow();
+	{
+		const auto phase = StartupPhase("window show");
+		_window->firstShow();
+	}
+	StartupMilestone("window shown");
 
 	if (!locked() && cStartToSettings()) {
 		_window->showSettings();
@@ -340,6 +365,21 @@ bool Application::eventFilter(QObject *object, QEvent *e) {
 		}
 	} break;
 
+	case QEvent::Paint: {
+		if (!_firstPaintDone
+			&& _window
+			&& object->isWidgetType()
+			&& static_cast<QWidget*>(object)->window() == _window->widget()) {
+			_firstPaintDone = true;
+			const auto started = crl::profile();
+			crl::on_main([=] {
+				StartupPhaseRecord("first paint", started, crl::profile());
+				StartupTimelineFinish();
+				runPostponedAfterFirstPaint();
+			});
+		}
+	} break;
+
 	case QEvent::ApplicationActivate: {
 		if (object == QCoreApplication::instance()) {
 			updateNonIdle();
@@ -405,7 +445,10 @@ void Application::badMtprotoConfigurationError() {
 }
 
 void Application::startLocalStorage() {
-	Local::start();
+	{
+		const auto phase = StartupPhase("Local::start");
+		Local::start();
+	}
 	subscribe(_dcOptions->changed(), [this](const MTP::DcOptions::Ids &ids) {
 		Local::writeSettings();
 		if (const auto instance = activeAccount().mtp()) {
@@ -415,6 +458,50 @@ void Application::startLocalStorage() {
 		}
 	});
 	_saveSettingsTimer.setCallback([=] { Local::writeSettings(); });
+	_memoryUsageTimer.setCallback([] { MemoryUsageLog(); });
+	_memoryUsageTimer.callEach(kMemoryUsageLogDelay);
+	_memoryPressureTimer.setCallback([] {
+		if (Platform::PhysicalMemoryLow().value_or(false)) {
+			MediaMemory::Instance().pressure();
+		}
+	});
+	_memoryPressureTimer.callEach(kMemoryPressureCheckDelay);
+}
+
+Storage::Cache::Database &Application::sharedMediaCache() {
+	if (!_sharedMediaCache) {
+		_sharedMediaCache = std::make_unique<Storage::DatabasePointer>(
+			_databases->get(
+				Local::cacheSharedPath(),
+				Local::cacheSharedSettings()));
+		(*_sharedMediaCache)->open(Local::cacheKey());
+	}
+	return **_sharedMediaCache;
+}
+
+void Application::postponeUntilFirstPaint(FnMut<void()> callback) {
+	_postponedAfterFirstPaint.push_back(std::move(callback));
+	if (_firstPaintDone) {
+		runPostponedAfterFirstPaint();
+	}
+}
+
+void Application::runPostponedAfterFirstPaint() {
+	if (_postponedAfterFirstPaintQueued
+		|| _postponedAfterFirstPaint.empty()) {
+		return;
+	}
+	_postponedAfterFirstPaintQueued = true;
+	crl::on_main(this, [=] {
+		_postponedAfterFirstPaintQueued = false;
+		if (_postponedAfterFirstPaint.empty()) {
+			return;
+		}
+		auto callback = std::move(_postponedAfterFirstPaint.front());
+		_postponedAfterFirstPaint.erase(begin(_postponedAfterFirstPaint));
+		callback();
+		runPostponedAfterFirstPaint();
+	});
 }
 
 void Application::forceLogOut(const TextWithEntities &explanation) {
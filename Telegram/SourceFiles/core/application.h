@@ -11,6 +11,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mtproto/auth_key.h"
 #include "base/observer.h"
 #include "base/timer.h"
+#include "base/lazy_service.h"
 
 class MainWindow;
 class MainWidget;
@@ -20,6 +21,10 @@ class BoxContent;
 
 namespace Storage {
 class Databases;
+class DatabasePointer;
+namespace Cache {
+class Database;
+} // namespace Cache
 } // namespace Storage
 
 namespace Window {
@@ -145,6 +150,11 @@ public:
 		return *_databases;
 	}
 
+	// Immutable media that is the same for every account, like the
+	// rendered frames of animated stickers, is kept here once.
+	// Everything depending on the account stays in Data::Session caches.
+	[[nodiscard]] Storage::Cache::Database &sharedMediaCache();
+
 	// Account component.
 	[[nodiscard]] Main::Account &activeAccount() const {
 		return *_account;
@@ -168,9 +178,13 @@ public:
 		return _langCloudManager.get();
 	}
 	ChatHelpers::EmojiKeywords &emojiKeywords() {
-		return *_emojiKeywords;
+		return _emojiKeywords.get();
 	}
 
+	// Services not needed for showing the chats list are created here,
+	// one in each event loop iteration after the first window paint.
+	void postponeUntilFirstPaint(FnMut<void()> callback);
+
 	// Internal links.
 	void setInternalLinkDomain(const QString &domain) const;
 	QString createInternalLink(const QString &query) const;
@@ -237,6 +251,7 @@ private:
 	void startShortcuts();
 
 	void stateChanged(Qt::ApplicationState state);
+	void runPostponedAfterFirstPaint();
 
 	friend void App::quit();
 	static void QuitAttempt();
@@ -263,6 +278,7 @@ private:
 	Settings _settings;
 
 	const std::unique_ptr<Storage::Databases> _databases;
+	std::unique_ptr<Storage::DatabasePointer> _sharedMediaCache;
 	const std::unique_ptr<Ui::Animations::Manager> _animationsManager;
 	const std::unique_ptr<MTP::DcOptions> _dcOptions;
 	const std::unique_ptr<Main::Account> _account;
@@ -270,7 +286,7 @@ private:
 	std::unique_ptr<Media::View::OverlayWidget> _mediaView;
 	const std::unique_ptr<Lang::Instance> _langpack;
 	std::unique_ptr<Lang::CloudManager> _langCloudManager;
-	const std::unique_ptr<ChatHelpers::EmojiKeywords> _emojiKeywords;
+	const base::lazy_service<ChatHelpers::EmojiKeywords> _emojiKeywords;
 	std::unique_ptr<Lang::Translator> _translator;
 	base::Observable<void> _passcodedChanged;
 	QPointer<BoxContent> _badProxyDisableBox;
@@ -285,6 +301,8 @@ private:
 
 	base::DelayedCallTimer _callDelayedTimer;
 	base::Timer _saveSettingsTimer;
+	base::Timer _memoryUsageTimer;
+	base::Timer _memoryPressureTimer;
 
 	struct LeaveSubscription {
 		LeaveSubscription(
@@ -301,6 +319,9 @@ private:
 	rpl::lifetime _lifetime;
 
 	crl::time _lastNonIdleTime = 0;
+	bool _firstPaintDone = false;
+	std::vector<FnMut<void()>> _postponedAfterFirstPaint;
+	bool _postponedAfterFirstPaintQueued = false;
 
 };
 
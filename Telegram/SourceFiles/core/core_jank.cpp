@@ -0,0 +1,188 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "core/core_jank.h"
+
+#include <QtCore/QAbstractEventDispatcher>
+
+namespace Core {
+namespace {
+
+constexpr auto kMinJankDuration = crl::time(50);
+constexpr auto kBucketBounds = { 100, 200, 500, 1000, 2000 };
+constexpr auto kCallsitesInText = 10;
+constexpr auto kCallsitesMax = 256;
+constexpr auto kAverageWeight = 8;
+
+bool FrameTimeOverlayEnabled = false;
+
+QString Milliseconds(crl::time value) {
+	return QString::number(value) + "ms";
+}
+
+} // namespace
+
+JankWatchdog::JankWatchdog() {
+	Expects(QCoreApplication::instance() != nullptr);
+
+	const auto dispatcher = QCoreApplication::eventDispatcher();
+	Assert(dispatcher != nullptr);
+
+	QObject::connect(
+		dispatcher,
+		&QAbstractEventDispatcher::awake,
+		&_guard,
+		[=] { awake(); });
+	QObject::connect(
+		dispatcher,
+		&QAbstractEventDispatcher::aboutToBlock,
+		&_guard,
+		[=] { aboutToBlock(); });
+}
+
+auto JankWatchdog::eventStarted() const -> Event {
+	return { _iteration, crl::now() };
+}
+
+void JankWatchdog::eventFinished(
+		Event event,
+		const char *receiver,
+		int type) {
+	// Events that lasted for several iterations ran a nested event loop,
+	// the time they spent waiting in it is not a stall.
+	if (event.iteration != _iteration) {
+		return;
+	}
+	const auto duration = crl::now() - event.started;
+	if (duration > _slowestEvent) {
+		_slowestEvent = duration;
+		_slowestReceiver = receiver;
+		_slowestType = type;
+	}
+}
+
+void JankWatchdog::awake() {
+	finishIteration();
+	_iterationStarted = crl::now();
+}
+
+void JankWatchdog::aboutToBlock() {
+	finishIteration();
+}
+
+void JankWatchdog::finishIteration() {
+	const auto started = std::exchange(_iterationStarted, 0);
+	const auto receiver = std::exchange(_slowestReceiver, nullptr);
+	const auto type = std::exchange(_slowestType, 0);
+	_slowestEvent = 0;
+	++_iteration;
+	if (!started) {
+		return;
+	}
+	const auto duration = crl::now() - started;
+	if (duration < kMinJankDuration) {
+		return;
+	}
+	_longest = std::max(_longest, duration);
+
+	const auto bucket = ranges::count_if(kBucketBounds, [&](int bound) {
+		return (duration >= bound);
+	});
+	++_histogram[bucket];
+
+	const auto callsite = receiver
+		? (QString::fromLatin1(receiver) + ':' + QString::number(type))
+		: QString("unknown");
+	auto i = _callsites.find(callsite);
+	if (i == end(_callsites)) {
+		if (int(_callsites.size()) >= kCallsitesMax) {
+			return;
+		}
+		i = _callsites.emplace(callsite, Callsite()).first;
+	}
+	++i->second.count;
+	i->second.total += duration;
+	i->second.longest = std::max(i->second.longest, duration);
+
+	DEBUG_LOG(("Jank: %1 in '%2'.").arg(Milliseconds(duration), callsite));
+}
+
+QString JankWatchdog::text() const {
+	auto result = QStringList();
+	auto from = kMinJankDuration;
+	auto bucket = 0;
+	for (const auto bound : kBucketBounds) {
+		result.push_back(QString("%1 - %2: %3"
+			).arg(Milliseconds(from)
+			).arg(Milliseconds(bound)
+			).arg(_histogram[bucket++]));
+		from = bound;
+	}
+	result.push_back(QString("%1 and more: %2"
+		).arg(Milliseconds(from)
+		).arg(_histogram[bucket]));
+	result.push_back("Longest: " + Milliseconds(_longest));
+
+	using Entry = std::pair<QString, Callsite>;
+	auto callsites = std::vector<Entry>(
+		_callsites.begin(),
+		_callsites.end());
+	ranges::sort(callsites, ranges::greater(), [](const Entry &entry) {
+		return entry.second.total;
+	});
+	if (int(callsites.size()) > kCallsitesInText) {
+		callsites.resize(kCallsitesInText);
+	}
+	result.push_back(QString());
+	for (const auto &[name, callsite] : callsites) {
+		result.push_back(QString("%1: %2 times, %3 total, %4 longest"
+			).arg(name
+			).arg(callsite.count
+			).arg(Milliseconds(callsite.total)
+			).arg(Milliseconds(callsite.longest)));
+	}
+	return result.join('\n');
+}
+
+bool FrameTimeOverlay::Enabled() {
+	return FrameTimeOverlayEnabled;
+}
+
+void FrameTimeOverlay::SetEnabled(bool enabled) {
+	FrameTimeOverlayEnabled = enabled;
+}
+
+void FrameTimeOverlay::finish(
+		not_null<QWidget*> widget,
+		QRect clip,
+		crl::profile_time duration) {
+	// Show the previous paint, this one is not finished yet.
+	const auto text = QString("%1ms, avg %2ms"
+		).arg(_last / 1000.
+		).arg(_average / 1000.);
+	_last = duration;
+	_average = _average
+		? (_average * (kAverageWeight - 1) + duration) / kAverageWeight
+		: duration;
+
+	QPainter p(widget);
+	p.setClipRect(clip);
+	const auto metrics = p.fontMetrics();
+	const auto size = QSize(
+		metrics.width(text) + 8,
+		metrics.height() + 4);
+	const auto rect = QRect(
+		clip.x() + clip.width() - size.width(),
+		clip.y(),
+		size.width(),
+		size.height());
+	p.fillRect(rect, QColor(0, 0, 0, 160));
+	p.setPen(Qt::white);
+	p.drawText(rect, Qt::AlignCenter, text);
+}
+
+} // namespace Core
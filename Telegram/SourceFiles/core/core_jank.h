@@ -0,0 +1,84 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Core {
+
+// Measures the main thread event loop iterations, from the dispatcher
+// waking up till it is going to wait again. The long ones are counted in
+// a histogram together with the slowest event dispatched while they last.
+class JankWatchdog final {
+public:
+	struct Event {
+		int iteration = 0;
+		crl::time started = 0;
+	};
+
+	JankWatchdog();
+	JankWatchdog(const JankWatchdog &other) = delete;
+	JankWatchdog &operator=(const JankWatchdog &other) = delete;
+
+	[[nodiscard]] Event eventStarted() const;
+	void eventFinished(Event event, const char *receiver, int type);
+
+	[[nodiscard]] QString text() const;
+
+private:
+	static constexpr auto kBucketsCount = 6;
+
+	struct Callsite {
+		int count = 0;
+		crl::time total = 0;
+		crl::time longest = 0;
+	};
+
+	void awake();
+	void aboutToBlock();
+	void finishIteration();
+
+	QObject _guard;
+	int _iteration = 0;
+	crl::time _iterationStarted = 0;
+	crl::time _slowestEvent = 0;
+	const char *_slowestReceiver = nullptr;
+	int _slowestType = 0;
+
+	std::array<int, kBucketsCount> _histogram = { { 0 } };
+	base::flat_map<QString, Callsite> _callsites;
+	crl::time _longest = 0;
+
+};
+
+// Paints the duration of the previous paint over the painted area,
+// while it is enabled with the "frametimes" settings code.
+class FrameTimeOverlay final {
+public:
+	[[nodiscard]] auto measure(not_null<QWidget*> widget, QRect clip) {
+		const auto started = Enabled() ? crl::profile() : 0;
+		return gsl::finally([=] {
+			if (started) {
+				finish(widget, clip, crl::profile() - started);
+			}
+		});
+	}
+
+	[[nodiscard]] static bool Enabled();
+	static void SetEnabled(bool enabled);
+
+private:
+	void finish(
+		not_null<QWidget*> widget,
+		QRect clip,
+		crl::profile_time duration);
+
+	crl::profile_time _last = 0;
+	crl::profile_time _average = 0;
+
+};
+
+} // namespace Core
@@ -0,0 +1,36 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "core/core_memory_usage.h"
+
+#include "base/memory_usage.h"
+#include "layout.h"
+
+namespace Core {
+
+QString MemoryUsageText() {
+	auto result = QStringList();
+	auto total = int64();
+	for (const auto &[name, usage] : base::memory_usage::Collect()) {
+		total += usage.bytes;
+		result.push_back(QString("%1: %2 in %3"
+		).arg(name
+		).arg(formatSizeText(usage.bytes)
+		).arg(usage.count));
+	}
+	result.push_front("total " + formatSizeText(total));
+	return result.join('\n');
+}
+
+void MemoryUsageLog() {
+	if (!Logs::DebugEnabled()) {
+		return;
+	}
+	DEBUG_LOG(("Memory Info: %1").arg(MemoryUsageText()));
+}
+
+} // namespace Core
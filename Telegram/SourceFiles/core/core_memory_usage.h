@@ -0,0 +1,18 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Core {
+
+// The memory reported by the caches and stores, one line for each.
+[[nodiscard]] QString MemoryUsageText();
+
+// Writes a snapshot to the debug log, called periodically.
+void MemoryUsageLog();
+
+} // namespace Core
@@ -0,0 +1,235 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "core/core_startup_timeline.h"
+
+#include <QtCore/QMutex>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <atomic>
+
+namespace Core {
+namespace {
+
+constexpr auto kMaxPhasesCount = 256;
+constexpr auto kMaxFramesCount = 64 * 1024;
+
+std::atomic<bool> ReportEnabled = false;
+
+struct Phase {
+	const char *name = nullptr;
+	int depth = 0;
+	crl::profile_time started = 0;
+	crl::profile_time finished = 0;
+};
+
+struct Milestone {
+	const char *name = nullptr;
+	crl::profile_time reached = 0;
+};
+
+struct Timeline {
+	QMutex mutex;
+	crl::profile_time started = crl::profile();
+	std::vector<Phase> phases;
+	int depth = 0;
+	bool finished = false;
+
+	QString reportPath;
+	std::vector<Milestone> milestones;
+	std::map<QString, std::vector<crl::profile_time>> frames;
+};
+
+Timeline &Instance() {
+	static auto result = Timeline();
+	return result;
+}
+
+double Milliseconds(crl::profile_time value) {
+	return value / 1000.;
+}
+
+// Nearest rank percentile of the sorted durations.
+crl::profile_time Percentile(
+		const std::vector<crl::profile_time> &sorted,
+		int percent) {
+	Expects(!sorted.empty());
+
+	const auto rank = (int(sorted.size()) * percent + 99) / 100;
+	return sorted[std::clamp(rank, 1, int(sorted.size())) - 1];
+}
+
+QJsonObject FramesReport(std::vector<crl::profile_time> durations) {
+	ranges::sort(durations);
+	auto result = QJsonObject();
+	result.insert("count", int(durations.size()));
+	result.insert("p50", Milliseconds(Percentile(durations, 50)));
+	result.insert("p90", Milliseconds(Percentile(durations, 90)));
+	result.insert("p99", Milliseconds(Percentile(durations, 99)));
+	result.insert("max", Milliseconds(durations.back()));
+	return result;
+}
+
+} // namespace
+
+StartupPhase::StartupPhase(const char *name) {
+	auto &timeline = Instance();
+	QMutexLocker lock(&timeline.mutex);
+	if (timeline.finished || timeline.phases.size() >= kMaxPhasesCount) {
+		return;
+	}
+	_index = int(timeline.phases.size());
+	timeline.phases.push_back({ name, timeline.depth++, crl::profile() });
+}
+
+StartupPhase::~StartupPhase() {
+	if (_index < 0) {
+		return;
+	}
+	auto &timeline = Instance();
+	QMutexLocker lock(&timeline.mutex);
+	--timeline.depth;
+	timeline.phases[_index].finished = crl::profile();
+}
+
+void StartupPhaseRecord(
+		const char *name,
+		crl::profile_time started,
+		crl::profile_time finished) {
+	auto &timeline = Instance();
+	QMutexLocker lock(&timeline.mutex);
+	if (timeline.finished || timeline.phases.size() >= kMaxPhasesCount) {
+		return;
+	}
+	timeline.phases.push_back({ name, 0, started, finished });
+}
+
+void StartupTimelineFinish() {
+	{
+		auto &timeline = Instance();
+		QMutexLocker lock(&timeline.mutex);
+		if (timeline.finished) {
+			return;
+		}
+		timeline.finished = true;
+	}
+	LOG(("Startup Info: %1").arg(StartupTimelineText()));
+}
+
+QString StartupTimelineText() {
+	auto &timeline = Instance();
+	QMutexLocker lock(&timeline.mutex);
+
+	const auto ms = [&](crl::profile_time value) {
+		return QString::number(value / 1000.) + "ms";
+	};
+	auto result = QStringList();
+	result.push_back("total " + ms(crl::profile() - timeline.started));
+	for (const auto &phase : timeline.phases) {
+		const auto duration = (phase.finished >= phase.started)
+			? ms(phase.finished - phase.started)
+			: QString("unfinished");
+		result.push_back(QString(phase.depth * 2, ' ')
+			+ phase.name
+			+ " at "
+			+ ms(phase.started - timeline.started)
+			+ ": "
+			+ duration);
+	}
+	return result.join('\n');
+}
+
+void StartupReportEnable(const QString &path) {
+	auto &timeline = Instance();
+	QMutexLocker lock(&timeline.mutex);
+	timeline.reportPath = path;
+	ReportEnabled = !path.isEmpty();
+}
+
+bool StartupReportEnabled() {
+	return ReportEnabled.load(std::memory_order_relaxed);
+}
+
+void StartupMilestone(const char *name) {
+	if (!StartupReportEnabled()) {
+		return;
+	}
+	const auto now = crl::profile();
+	auto &timeline = Instance();
+	QMutexLocker lock(&timeline.mutex);
+	const auto i = ranges::find(
+		timeline.milestones,
+		name,
+		&Milestone::name);
+	if (i == end(timeline.milestones)) {
+		timeline.milestones.push_back({ name, now });
+	}
+}
+
+void StartupFrameRecord(const char *series, crl::profile_time duration) {
+	if (!StartupReportEnabled()) {
+		return;
+	}
+	auto &timeline = Instance();
+	QMutexLocker lock(&timeline.mutex);
+	auto &frames = timeline.frames[QString::fromLatin1(series)];
+	if (frames.size() < kMaxFramesCount) {
+		frames.push_back(duration);
+	}
+}
+
+void StartupReportWrite() {
+	if (!StartupReportEnabled()) {
+		return;
+	}
+	auto &timeline = Instance();
+	QMutexLocker lock(&timeline.mutex);
+
+	auto phases = QJsonArray();
+	for (const auto &phase : timeline.phases) {
+		auto object = QJsonObject();
+		object.insert("name", QString::fromLatin1(phase.name));
+		object.insert("depth", phase.depth);
+		object.insert(
+			"started",
+			Milliseconds(phase.started - timeline.started));
+		if (phase.finished >= phase.started) {
+			object.insert(
+				"duration",
+				Milliseconds(phase.finished - phase.started));
+		}
+		phases.push_back(object);
+	}
+	auto milestones = QJsonObject();
+	for (const auto &milestone : timeline.milestones) {
+		milestones.insert(
+			QString::fromLatin1(milestone.name),
+			Milliseconds(milestone.reached - timeline.started));
+	}
+	auto frames = QJsonObject();
+	for (const auto &[series, durations] : timeline.frames) {
+		if (!durations.empty()) {
+			frames.insert(series, FramesReport(durations));
+		}
+	}
+	auto report = QJsonObject();
+	report.insert("version", AppVersion);
+	report.insert("phases", phases);
+	report.insert("milestones", milestones);
+	report.insert("frames", frames);
+
+	QFile f(timeline.reportPath);
+	if (!f.open(QIODevice::WriteOnly)) {
+		LOG(("Startup Error: Could not write report to '%1'."
+			).arg(timeline.reportPath));
+		return;
+	}
+	f.write(QJsonDocument(report).toJson(QJsonDocument::Indented));
+}
+
+} // namespace Core
@@ -0,0 +1,67 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Core {
+
+// Measures one phase of the application startup, nested phases are
+// shown indented. Phases after StartupTimelineFinish() are ignored.
+class StartupPhase final {
+public:
+	explicit StartupPhase(const char *name);
+	StartupPhase(const StartupPhase &other) = delete;
+	StartupPhase &operator=(const StartupPhase &other) = delete;
+	~StartupPhase();
+
+private:
+	int _index = -1;
+
+};
+
+// May be called from any thread, for phases finished in background.
+void StartupPhaseRecord(
+	const char *name,
+	crl::profile_time started,
+	crl::profile_time finished);
+
+// Writes the timeline to the log, called after the first paint.
+void StartupTimelineFinish();
+
+[[nodiscard]] QString StartupTimelineText();
+
+// With the -startupreport command line argument the timeline, the first
+// time each milestone was reached and the percentiles of the recorded
+// frame durations are saved as JSON to the given path when the app exits.
+void StartupReportEnable(const QString &path);
+[[nodiscard]] bool StartupReportEnabled();
+void StartupMilestone(const char *name);
+void StartupFrameRecord(const char *series, crl::profile_time duration);
+void StartupReportWrite();
+
+// Records the scope duration as a frame of the series.
+class StartupFrame final {
+public:
+	explicit StartupFrame(const char *series)
+	: _series(StartupReportEnabled() ? series : nullptr)
+	, _started(_series ? crl::profile() : 0) {
+	}
+	StartupFrame(const StartupFrame &other) = delete;
+	StartupFrame &operator=(const StartupFrame &other) = delete;
+	~StartupFrame() {
+		if (_series) {
+			StartupFrameRecord(_series, crl::profile() - _started);
+		}
+	}
+
+private:
+	const char *_series = nullptr;
+	crl::profile_time _started = 0;
+
+};
+
+} // namespace Core
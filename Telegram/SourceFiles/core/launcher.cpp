@@ -12,6 +12,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "platform/platform_info.h"
 #include "ui/main_queue_processor.h"
 #include "core/crash_reports.h"
+#include "core/core_startup_timeline.h"
 #include "core/update_checker.h"
 #include "core/sandbox.h"
 #include "base/concurrent_timer.h"
@@ -276,6 +277,8 @@ int Launcher::exec() {
 
 	DEBUG_LOG(("Telegram finished, result: %1").arg(result));
 
+	StartupReportWrite();
+
 	if (!UpdaterDisabled() && cRestartingUpdate()) {
 		DEBUG_LOG(("Sandbox Info: executing updater to install update."));
 		if (!launchUpdater(UpdaterLaunch::PerformUpdate)) {
@@ -392,6 +395,7 @@ void Launcher::processArguments() {
 		{ "-workdir"        , KeyFormat::OneValue },
 		{ "--"              , KeyFormat::OneValue },
 		{ "-scale"          , KeyFormat::OneValue },
+		{ "-startupreport"  , KeyFormat::OneValue },
 	};
 	auto parseResult = QMap<QByteArray, QStringList>();
 	auto parsingKey = QByteArray();
@@ -442,6 +446,9 @@ void Launcher::processArguments() {
 	}
 	gStartUrl = parseResult.value("--", {}).join(QString());
 
+	StartupReportEnable(
+		parseResult.value("-startupreport", {}).join(QString()));
+
 	const auto scaleKey = parseResult.value("-scale", {});
 	if (scaleKey.size() > 0) {
 		const auto value = scaleKey[0].toInt();
@@ -7,15 +7,24 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #pragma once
 
+#include "core/media_memory.h"
 #include "base/last_used_cache.h"
 
+#include <unordered_set>
+
 namespace Core {
 
+// The entries share the media memory budget with all the other caches.
+// Those used since the last budget check, like the visible ones, are
+// pinned and are not unloaded even when the budget is exceeded.
 template <typename Type>
-class MediaActiveCache {
+class MediaActiveCache final : private MediaMemoryHolder {
 public:
 	template <typename Unload>
-	MediaActiveCache(int64 limit, Unload &&unload);
+	MediaActiveCache(MediaMemoryPriority priority, Unload &&unload);
+	MediaActiveCache(const MediaActiveCache &other) = delete;
+	MediaActiveCache &operator=(const MediaActiveCache &other) = delete;
+	~MediaActiveCache();
 
 	void up(Type *entry);
 	void remove(Type *entry);
@@ -25,42 +34,53 @@ public:
 	void decrement(int64 amount);
 
 private:
-	template <typename Unload>
-	void check(Unload &&unload);
+	int64 mediaMemoryUsage() const override;
+	bool mediaMemoryUnloadOne() override;
+	void mediaMemoryChecked() override;
 
 	base::last_used_cache<Type*> _cache;
-	SingleQueuedInvokation _delayed;
+	std::unordered_set<Type*> _pinned;
+	Fn<void(Type*)> _unload;
 	int64 _usage = 0;
-	int64 _limit = 0;
 
 };
 
 template <typename Type>
 template <typename Unload>
-MediaActiveCache<Type>::MediaActiveCache(int64 limit, Unload &&unload)
-: _delayed([=] { check(unload); })
-, _limit(limit) {
+MediaActiveCache<Type>::MediaActiveCache(
+	MediaMemoryPriority priority,
+	Unload &&unload)
+: _unload(std::forward<Unload>(unload)) {
+	MediaMemory::Instance().add(this, priority);
+}
+
+template <typename Type>
+MediaActiveCache<Type>::~MediaActiveCache() {
+	MediaMemory::Instance().remove(this);
 }
 
 template <typename Type>
 void MediaActiveCache<Type>::up(Type *entry) {
 	_cache.up(entry);
-	_delayed.call();
+	_pinned.emplace(entry);
 }
 
 template <typename Type>
 void MediaActiveCache<Type>::remove(Type *entry) {
 	_cache.remove(entry);
+	_pinned.erase(entry);
 }
 
 template <typename Type>
 void MediaActiveCache<Type>::clear() {
 	_cache.clear();
+	_pinned.clear();
 }
 
 template <typename Type>
 void MediaActiveCache<Type>::increment(int64 amount) {
 	_usage += amount;
+	MediaMemory::Instance().usageGrown();
 }
 
 template <typename Type>
@@ -69,15 +89,26 @@ void MediaActiveCache<Type>::decrement(int64 amount) {
 }
 
 template <typename Type>
-template <typename Unload>
-void MediaActiveCache<Type>::check(Unload &&unload) {
-	while (_usage > _limit) {
-		if (const auto entry = _cache.take_lowest()) {
-			unload(entry);
-		} else {
-			break;
-		}
+int64 MediaActiveCache<Type>::mediaMemoryUsage() const {
+	return _usage;
+}
+
+template <typename Type>
+bool MediaActiveCache<Type>::mediaMemoryUnloadOne() {
+	// All the entries after the lowest one were used later, so if it
+	// is pinned, all the others are pinned as well.
+	const auto entry = _cache.lowest();
+	if (!entry || _pinned.count(entry)) {
+		return false;
 	}
+	_cache.take_lowest();
+	_unload(entry);
+	return true;
+}
+
+template <typename Type>
+void MediaActiveCache<Type>::mediaMemoryChecked() {
+	_pinned.clear();
 }
 
 } // namespace Core
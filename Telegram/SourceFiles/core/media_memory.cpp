@@ -0,0 +1,126 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "core/media_memory.h"
+
+#include "base/memory_usage.h"
+
+namespace Core {
+namespace {
+
+// Under the memory pressure the usage goes down to a quarter of the budget.
+constexpr auto kPressureDivider = 4;
+
+// Reported by the media that can't be unloaded from here.
+const auto kUnmanaged = {
+	"Lottie caches",
+	"Lottie frames",
+	"Media::Clip readers",
+	"Media::Streaming slices",
+};
+
+[[nodiscard]] int64 Weight(MediaMemoryPriority priority) {
+	switch (priority) {
+	case MediaMemoryPriority::Low: return 1;
+	case MediaMemoryPriority::Normal: return 2;
+	case MediaMemoryPriority::High: return 4;
+	}
+	Unexpected("Priority in Core::MediaMemory.");
+}
+
+} // namespace
+
+MediaMemory::MediaMemory()
+: _delayed([=] { check(_budget); }) {
+}
+
+MediaMemory &MediaMemory::Instance() {
+	static auto result = MediaMemory();
+	return result;
+}
+
+void MediaMemory::setBudget(int64 budget) {
+	Expects(budget > 0);
+
+	_budget = budget;
+	_delayed.call();
+}
+
+int64 MediaMemory::budget() const {
+	return _budget;
+}
+
+int64 MediaMemory::usage() const {
+	auto result = unmanagedUsage();
+	for (const auto &entry : _holders) {
+		result += entry.holder->mediaMemoryUsage();
+	}
+	return result;
+}
+
+void MediaMemory::add(
+		not_null<MediaMemoryHolder*> holder,
+		MediaMemoryPriority priority) {
+	_holders.push_back({ holder, priority });
+}
+
+void MediaMemory::remove(not_null<MediaMemoryHolder*> holder) {
+	_holders.erase(
+		ranges::remove(_holders, holder, &Holder::holder),
+		end(_holders));
+}
+
+void MediaMemory::usageGrown() {
+	_delayed.call();
+}
+
+void MediaMemory::pressure() {
+	const auto was = usage();
+	check(_budget / kPressureDivider);
+	const auto now = usage();
+	if (now == was) {
+		return;
+	}
+	LOG(("Media Memory: Pressure, unloaded %1 of %2 bytes."
+		).arg(was - now
+		).arg(was));
+}
+
+int64 MediaMemory::unmanagedUsage() const {
+	auto result = int64();
+	for (const auto name : kUnmanaged) {
+		result += base::memory_usage::Collect(name).bytes;
+	}
+	return result;
+}
+
+void MediaMemory::check(int64 limit) {
+	auto usage = unmanagedUsage();
+	auto candidates = std::vector<Holder>();
+	candidates.reserve(_holders.size());
+	for (const auto &entry : _holders) {
+		usage += entry.holder->mediaMemoryUsage();
+		candidates.push_back(entry);
+	}
+	const auto share = [](const Holder &entry) {
+		return entry.holder->mediaMemoryUsage() / Weight(entry.priority);
+	};
+	while (usage > limit && !candidates.empty()) {
+		const auto i = ranges::max_element(candidates, ranges::less(), share);
+		const auto was = i->holder->mediaMemoryUsage();
+		if (!i->holder->mediaMemoryUnloadOne()) {
+			candidates.erase(i);
+			continue;
+		}
+		usage -= was - i->holder->mediaMemoryUsage();
+	}
+	for (const auto &entry : _holders) {
+		entry.holder->mediaMemoryChecked();
+	}
+}
+
+} // namespace Core
@@ -0,0 +1,81 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/invoke_queued.h"
+
+namespace Core {
+
+enum class MediaMemoryPriority {
+	Low,
+	Normal,
+	High,
+};
+
+class MediaMemoryHolder {
+public:
+	[[nodiscard]] virtual int64 mediaMemoryUsage() const = 0;
+
+	// Unloads the least recently used entry that is not pinned,
+	// returns false if there is no such entry.
+	virtual bool mediaMemoryUnloadOne() = 0;
+
+	// All the entries used till now are not pinned any more.
+	virtual void mediaMemoryChecked() = 0;
+
+protected:
+	~MediaMemoryHolder() = default;
+
+};
+
+// One budget for all the decoded media in memory. Lottie animations,
+// GIF readers and streaming slices are counted, but can't be unloaded
+// from here, so they leave less of the budget for the holders.
+//
+// Entries are unloaded from the holder with the largest usage for its
+// priority, the entries used since the last check are pinned.
+class MediaMemory final {
+public:
+	static constexpr auto kDefaultBudget = int64(160 * 1024 * 1024);
+
+	[[nodiscard]] static MediaMemory &Instance();
+
+	void setBudget(int64 budget);
+	[[nodiscard]] int64 budget() const;
+	[[nodiscard]] int64 usage() const;
+
+	void add(
+		not_null<MediaMemoryHolder*> holder,
+		MediaMemoryPriority priority);
+	void remove(not_null<MediaMemoryHolder*> holder);
+
+	// Holders call it each time their usage grows.
+	void usageGrown();
+
+	// The system is low on memory, unload all that is not pinned
+	// till the usage is a fraction of the budget.
+	void pressure();
+
+private:
+	struct Holder {
+		not_null<MediaMemoryHolder*> holder;
+		MediaMemoryPriority priority = MediaMemoryPriority::Normal;
+	};
+
+	MediaMemory();
+
+	void check(int64 limit);
+	[[nodiscard]] int64 unmanagedUsage() const;
+
+	std::vector<Holder> _holders;
+	SingleQueuedInvokation _delayed;
+	int64 _budget = kDefaultBudget;
+
+};
+
+} // namespace Core
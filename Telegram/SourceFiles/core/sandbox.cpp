@@ -14,6 +14,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "window/notifications_manager.h"
 #include "core/crash_reports.h"
 #include "core/crash_report_window.h"
+#include "core/core_jank.h"
 #include "core/application.h"
 #include "core/launcher.h"
 #include "core/local_url_handlers.h"
@@ -528,9 +529,33 @@ bool Sandbox::notify(QObject *receiver, QEvent *e) {
 			return true;
 		}
 	}
+	if (const auto watchdog = _jankWatchdog.get()) {
+		const auto receiverName = receiver->metaObject()->className();
+		const auto type = int(e->type());
+		const auto event = watchdog->eventStarted();
+		const auto result = notifyOrInvoke(receiver, e);
+
+		// The watchdog could be disabled while processing the event.
+		if (_jankWatchdog.get() == watchdog) {
+			watchdog->eventFinished(event, receiverName, type);
+		}
+		return result;
+	}
 	return notifyOrInvoke(receiver, e);
 }
 
+void Sandbox::setJankWatchdogEnabled(bool enabled) {
+	if (!enabled) {
+		_jankWatchdog = nullptr;
+	} else if (!_jankWatchdog) {
+		_jankWatchdog = std::make_unique<JankWatchdog>();
+	}
+}
+
+JankWatchdog *Sandbox::jankWatchdog() const {
+	return _jankWatchdog.get();
+}
+
 void Sandbox::processPostponedCalls(int level) {
 	while (!_postponedCalls.empty()) {
 		auto &last = _postponedCalls.back();
@@ -17,6 +17,7 @@ namespace Core {
 class Launcher;
 class UpdateChecker;
 class Application;
+class JankWatchdog;
 
 class Sandbox final
 	: public QApplication
@@ -50,6 +51,9 @@ public:
 
 	rpl::producer<> widgetUpdateRequests() const;
 
+	void setJankWatchdogEnabled(bool enabled);
+	[[nodiscard]] JankWatchdog *jankWatchdog() const;
+
 	ProxyData sandboxProxy() const;
 
 	static Sandbox &Instance() {
@@ -109,6 +113,7 @@ private:
 
 	not_null<Launcher*> _launcher;
 	std::unique_ptr<Application> _application;
+	std::unique_ptr<JankWatchdog> _jankWatchdog;
 
 	QString _localServerName, _localSocketReadData;
 	QLocalServer _localServer;
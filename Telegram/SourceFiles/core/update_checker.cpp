@@ -44,6 +44,9 @@ namespace {
 constexpr auto kUpdaterTimeout = 10 * crl::time(1000);
 constexpr auto kMaxResponseSize = 1024 * 1024;
 
+// The RSA signature and the SHA1 hash of everything that follows them.
+constexpr auto kUpdateHashedOffset = 128 + 20;
+
 #ifdef TDESKTOP_DISABLE_AUTOUPDATE
 bool UpdaterIsDisabled = true;
 #else // TDESKTOP_DISABLE_AUTOUPDATE
@@ -243,7 +246,9 @@ QString ExtractFilename(const QString &url) {
 	return QString();
 }
 
-bool UnpackUpdate(const QString &filepath) {
+// The SHA1 is counted by the loader while downloading, if it is empty
+// the file is hashed here once again.
+bool UnpackUpdate(const QString &filepath, const QByteArray &sha1) {
 	QFile input(filepath);
 	QByteArray packed;
 	if (!input.open(QIODevice::ReadOnly)) {
@@ -274,8 +279,12 @@ bool UnpackUpdate(const QString &filepath) {
 		return false;
 	}
 
+	static_assert(hSigLen + hShaLen == kUpdateHashedOffset);
 	uchar sha1Buffer[20];
-	bool goodSha1 = !memcmp(compressed.constData() + hSigLen, hashSha1(compressed.constData() + hSigLen + hShaLen, compressedLen + hPropsLen + hOriginalSizeLen, sha1Buffer), hShaLen);
+	const auto counted = (sha1.size() == hShaLen)
+		? static_cast<const void*>(sha1.constData())
+		: hashSha1(compressed.constData() + hSigLen + hShaLen, compressedLen + hPropsLen + hOriginalSizeLen, sha1Buffer);
+	bool goodSha1 = !memcmp(compressed.constData() + hSigLen, counted, hShaLen);
 	if (!goodSha1) {
 		LOG(("Update Error: bad SHA1 hash of update file!"));
 		return false;
@@ -1055,7 +1064,7 @@ private:
 		std::shared_ptr<Loader> loader);
 	void checkerFail(not_null<Implementation*> which);
 
-	void finalize(QString filepath);
+	void finalize(QString filepath, QByteArray sha1);
 	void unpackDone(bool ready);
 	void handleChecking();
 	void handleProgress();
@@ -1326,7 +1335,7 @@ bool Updater::tryLoaders() {
 			) | rpl::start_to_stream(_progress, loader->lifetime());
 			loader->ready(
 			) | rpl::start_with_next([=](QString &&filepath) {
-				finalize(std::move(filepath));
+				finalize(std::move(filepath), loader->hash());
 			}, loader->lifetime());
 			loader->failed(
 			) | rpl::start_with_next([=] {
@@ -1335,6 +1344,7 @@ bool Updater::tryLoaders() {
 
 			_retryTimer.callOnce(kUpdaterTimeout);
 			loader->wipeFolder();
+			loader->hashFrom(kUpdateHashedOffset);
 			loader->start();
 		} else {
 			_isLatest.fire({});
@@ -1356,7 +1366,7 @@ bool Updater::tryLoaders() {
 	return true;
 }
 
-void Updater::finalize(QString filepath) {
+void Updater::finalize(QString filepath, QByteArray sha1) {
 	if (_action != Action::Loading) {
 		return;
 	}
@@ -1364,7 +1374,7 @@ void Updater::finalize(QString filepath) {
 	_activeLoader = nullptr;
 	_action = Action::Unpacking;
 	crl::async([=] {
-		const auto ready = UnpackUpdate(filepath);
+		const auto ready = UnpackUpdate(filepath, sha1);
 		crl::on_main([=] {
 			GetUpdaterInstance()->unpackDone(ready);
 		});
@@ -0,0 +1,174 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "data/data_animation_posters.h"
+
+#include "data/data_session.h"
+#include "data/data_document.h"
+#include "main/main_session.h"
+#include "storage/cache/storage_cache_database.h"
+#include "ui/image/image_prepare.h"
+#include "app.h"
+
+#include <QtCore/QBuffer>
+
+namespace Data {
+namespace {
+
+constexpr auto kMemoryLimit = 16 * 1024 * 1024;
+constexpr auto kPosterQuality = 87;
+
+[[nodiscard]] uint8 SerializeOptions(
+		ImageRoundRadius radius,
+		RectParts corners) {
+	return uint8(radius)
+		| ((corners & RectPart::TopLeft) ? 0x04 : 0)
+		| ((corners & RectPart::TopRight) ? 0x08 : 0)
+		| ((corners & RectPart::BottomLeft) ? 0x10 : 0)
+		| ((corners & RectPart::BottomRight) ? 0x20 : 0);
+}
+
+[[nodiscard]] int64 ComputeMemory(const QPixmap &pixmap) {
+	return int64(pixmap.width()) * pixmap.height() * 4;
+}
+
+} // namespace
+
+AnimationPosters::AnimationPosters(not_null<Session*> owner)
+: _owner(owner) {
+}
+
+QPixmap AnimationPosters::lookup(
+		not_null<DocumentData*> document,
+		QSize size,
+		ImageRoundRadius radius,
+		RectParts corners) {
+	const auto key = AnimationPosterCacheKey(
+		document->id,
+		size * cIntRetinaFactor(),
+		SerializeOptions(radius, corners));
+	const auto i = _entries.find(key);
+	if (i != end(_entries)) {
+		i->second.used = ++_used;
+		return i->second.pixmap;
+	}
+	_entries.emplace(key, Entry{ QPixmap(), ++_used, State::Loading });
+	load(key);
+	return QPixmap();
+}
+
+void AnimationPosters::remember(
+		not_null<DocumentData*> document,
+		ImageRoundRadius radius,
+		RectParts corners,
+		const QPixmap &frame) {
+	if (frame.isNull()) {
+		return;
+	}
+	const auto key = AnimationPosterCacheKey(
+		document->id,
+		frame.size(),
+		SerializeOptions(radius, corners));
+	auto i = _entries.find(key);
+	if (i == end(_entries)) {
+		i = _entries.emplace(key, Entry()).first;
+	} else if (i->second.state != State::Missing) {
+		return;
+	}
+	auto &entry = i->second;
+	entry.used = ++_used;
+	setReady(entry, frame);
+	const auto opaque = (radius == ImageRoundRadius::None)
+		&& !document->sticker();
+	store(key, frame.toImage(), opaque);
+	checkMemoryLimit();
+}
+
+void AnimationPosters::load(const Storage::Cache::Key &key) {
+	const auto weak = base::make_weak(this);
+	_owner->cache().get(key, [=](QByteArray &&value) {
+		if (value.isEmpty()) {
+			crl::on_main(weak, [=] {
+				loaded(key, QImage());
+			});
+			return;
+		}
+		crl::async([=, value = std::move(value)] {
+			auto image = App::readImage(value, nullptr, false);
+			crl::on_main(weak, [=, image = std::move(image)]() mutable {
+				loaded(key, std::move(image));
+			});
+		});
+	});
+}
+
+void AnimationPosters::loaded(
+		const Storage::Cache::Key &key,
+		QImage &&image) {
+	const auto i = _entries.find(key);
+	if (i == end(_entries) || i->second.state != State::Loading) {
+		return;
+	} else if (image.isNull()) {
+		i->second.state = State::Missing;
+		return;
+	}
+	image.setDevicePixelRatio(cRetinaFactor());
+	setReady(i->second, App::pixmapFromImageInPlace(std::move(image)));
+	checkMemoryLimit();
+	_owner->session().downloaderTaskFinished().notify();
+}
+
+void AnimationPosters::store(
+		const Storage::Cache::Key &key,
+		QImage &&image,
+		bool opaque) {
+	const auto weak = base::make_weak(this);
+	crl::async([=, image = std::move(image)] {
+		auto bytes = QByteArray();
+		auto buffer = QBuffer(&bytes);
+		image.save(&buffer, opaque ? "JPG" : "PNG", kPosterQuality);
+		if (bytes.isEmpty()) {
+			return;
+		}
+		crl::on_main(weak, [=, bytes = std::move(bytes)]() mutable {
+			_owner->cache().put(
+				key,
+				Storage::Cache::Database::TaggedValue(
+					std::move(bytes),
+					kAnimationPosterCacheTag));
+		});
+	});
+}
+
+void AnimationPosters::setReady(Entry &entry, QPixmap pixmap) {
+	if (entry.state == State::Ready) {
+		_memory -= ComputeMemory(entry.pixmap);
+	}
+	entry.pixmap = std::move(pixmap);
+	entry.state = State::Ready;
+	_memory += ComputeMemory(entry.pixmap);
+}
+
+void AnimationPosters::checkMemoryLimit() {
+	while (_memory > kMemoryLimit) {
+		auto oldest = end(_entries);
+		for (auto i = begin(_entries); i != end(_entries); ++i) {
+			if (i->second.state == State::Ready
+				&& (oldest == end(_entries)
+					|| i->second.used < oldest->second.used)) {
+				oldest = i;
+			}
+		}
+		if (oldest == end(_entries)) {
+			break;
+		}
+		_memory -= ComputeMemory(oldest->second.pixmap);
+		_entries.erase(oldest);
+	}
+}
+
+} // namespace Data
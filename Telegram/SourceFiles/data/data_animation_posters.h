@@ -0,0 +1,73 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/weak_ptr.h"
+#include "storage/cache/storage_cache_types.h"
+
+enum class ImageRoundRadius;
+
+namespace Data {
+
+class Session;
+
+// Keeps the first painted frames of autoplaying GIFs and videos at the
+// size and rounding they are painted with, in memory and in the cache
+// database. While a clip reader starts again the tile paints the poster
+// instead of a blank rectangle or a blurred thumbnail. The media preview
+// keeps the first frames of animated stickers here as well.
+class AnimationPosters final : public base::has_weak_ptr {
+public:
+	explicit AnimationPosters(not_null<Session*> owner);
+	AnimationPosters(const AnimationPosters &other) = delete;
+	AnimationPosters &operator=(const AnimationPosters &other) = delete;
+
+	// A null pixmap is returned while the poster is not in memory,
+	// downloaderTaskFinished() fires when it is read from the cache.
+	[[nodiscard]] QPixmap lookup(
+		not_null<DocumentData*> document,
+		QSize size,
+		ImageRoundRadius radius,
+		RectParts corners);
+
+	// Does nothing if a poster of the frame size is already known.
+	void remember(
+		not_null<DocumentData*> document,
+		ImageRoundRadius radius,
+		RectParts corners,
+		const QPixmap &frame);
+
+private:
+	enum class State {
+		Loading,
+		Missing,
+		Ready,
+	};
+	struct Entry {
+		QPixmap pixmap;
+		uint64 used = 0;
+		State state = State::Loading;
+	};
+
+	void load(const Storage::Cache::Key &key);
+	void loaded(const Storage::Cache::Key &key, QImage &&image);
+	void store(
+		const Storage::Cache::Key &key,
+		QImage &&image,
+		bool opaque);
+	void setReady(Entry &entry, QPixmap pixmap);
+	void checkMemoryLimit();
+
+	const not_null<Session*> _owner;
+	base::flat_map<Storage::Cache::Key, Entry> _entries;
+	uint64 _used = 0;
+	int64 _memory = 0;
+
+};
+
+} // namespace Data
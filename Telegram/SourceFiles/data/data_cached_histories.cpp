@@ -0,0 +1,218 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "data/data_cached_histories.h"
+
+#include "data/data_session.h"
+#include "history/history.h"
+#include "history/history_item.h"
+#include "main/main_session.h"
+#include "apiwrap.h"
+#include "storage/cache/storage_cache_database.h"
+#include "core/version.h"
+
+namespace Data {
+namespace {
+
+constexpr auto kPreloadHistoriesCount = 16;
+
+// Same as the first page HistoryWidget requests at the end of a chat.
+constexpr auto kLastSliceCount = 30;
+
+} // namespace
+
+QByteArray SerializeMessages(const MTPmessages_Messages &slice) {
+	auto buffer = mtpBuffer();
+	buffer.push_back(mtpPrime(AppVersion));
+	slice.match([&](const MTPDmessages_messagesNotModified &) {
+	}, [&](const auto &data) {
+		// Drop the pts of channelMessages, it is outdated after restart.
+		MTP_messages_messages(
+			data.vmessages(),
+			data.vchats(),
+			data.vusers()
+		).write(buffer);
+	});
+	return QByteArray(
+		reinterpret_cast<const char*>(buffer.constData()),
+		buffer.size() * sizeof(mtpPrime));
+}
+
+std::optional<MTPDmessages_messages> DeserializeMessages(
+		const QByteArray &serialized) {
+	if (serialized.size() % sizeof(mtpPrime)) {
+		return std::nullopt;
+	}
+	auto from = reinterpret_cast<const mtpPrime*>(serialized.constData());
+	const auto till = from + serialized.size() / sizeof(mtpPrime);
+	if (from == till || *from++ != mtpPrime(AppVersion)) {
+		return std::nullopt;
+	}
+	auto result = MTPmessages_Messages();
+	if (!result.read(from, till)
+		|| from != till
+		|| result.type() != mtpc_messages_messages) {
+		return std::nullopt;
+	}
+	return result.c_messages_messages();
+}
+
+void ProcessCachedPeers(
+		not_null<Session*> owner,
+		const MTPDmessages_messages &data) {
+	// The peers we already know are newer than the cached ones.
+	auto users = QVector<MTPUser>();
+	for (const auto &user : data.vusers().v) {
+		const auto id = user.match([](const auto &data) {
+			return peerFromUser(data.vid());
+		});
+		if (!owner->peerLoaded(id)) {
+			users.push_back(user);
+		}
+	}
+	auto chats = QVector<MTPChat>();
+	for (const auto &chat : data.vchats().v) {
+		const auto id = chat.match([](const MTPDchannel &data) {
+			return peerFromChannel(data.vid().v);
+		}, [](const MTPDchannelForbidden &data) {
+			return peerFromChannel(data.vid().v);
+		}, [](const auto &data) {
+			return peerFromChat(data.vid().v);
+		});
+		if (!owner->peerLoaded(id)) {
+			chats.push_back(chat);
+		}
+	}
+	owner->processUsers(MTP_vector<MTPUser>(std::move(users)));
+	owner->processChats(MTP_vector<MTPChat>(std::move(chats)));
+}
+
+CachedHistories::CachedHistories(not_null<Session*> owner)
+: _owner(owner) {
+	_owner->itemRemoved(
+	) | rpl::filter([](not_null<const HistoryItem*> item) {
+		return item->isHistoryEntry() && IsServerMsgId(item->id);
+	}) | rpl::start_with_next([=](not_null<const HistoryItem*> item) {
+		forget(item->history());
+	}, _lifetime);
+}
+
+void CachedHistories::store(
+		not_null<History*> history,
+		const MTPmessages_Messages &slice) {
+	_owner->cache().put(
+		HistoryCacheKey(history->peer->id),
+		Storage::Cache::Database::TaggedValue(
+			SerializeMessages(slice),
+			kHistorySliceCacheTag));
+}
+
+void CachedHistories::forget(not_null<History*> history) {
+	_owner->cache().remove(HistoryCacheKey(history->peer->id));
+}
+
+void CachedHistories::preload() {
+	if (_preloaded) {
+		return;
+	}
+	_preloaded = true;
+
+	auto left = kPreloadHistoriesCount;
+	for (const auto row : *_owner->chatsList()->indexed()) {
+		const auto history = row->history();
+		if (!history || !history->isEmpty()) {
+			continue;
+		}
+		_owner->cache().get(
+			HistoryCacheKey(history->peer->id),
+			[=](QByteArray &&serialized) {
+				crl::on_main(&_owner->session(), [=] {
+					apply(history, serialized);
+				});
+			});
+		if (!--left) {
+			break;
+		}
+	}
+}
+
+void CachedHistories::request(not_null<History*> history) {
+	if (!needLastSlice(history) || _requests.contains(history)) {
+		return;
+	}
+	const auto requestId = _owner->session().api().request(
+		MTPmessages_GetHistory(
+			history->peer->input,
+			MTP_int(0), // offset_id
+			MTP_int(0), // offset_date
+			MTP_int(0), // add_offset
+			MTP_int(kLastSliceCount),
+			MTP_int(0), // max_id
+			MTP_int(0), // min_id
+			MTP_int(0)) // hash
+	).done([=](const MTPmessages_Messages &result) {
+		_requests.remove(history);
+		result.match([&](const MTPDmessages_messagesNotModified &) {
+		}, [&](const auto &data) {
+			// The pts of channelMessages is left for the full load.
+			_owner->processUsers(data.vusers());
+			_owner->processChats(data.vchats());
+			applyLastSlice(history, data.vmessages().v);
+		});
+		if (history->loadedAtBottom()) {
+			store(history, result);
+		}
+	}).fail([=](const RPCError &error) {
+		_requests.remove(history);
+	}).send();
+	_requests.emplace(history, requestId);
+}
+
+bool CachedHistories::needLastSlice(not_null<History*> history) const {
+	return history->isEmpty()
+		&& !history->loadedAtBottom()
+		&& (history->lastMessage() != nullptr);
+}
+
+void CachedHistories::apply(
+		not_null<History*> history,
+		const QByteArray &serialized) {
+	if (serialized.isEmpty() || !needLastSlice(history)) {
+		return;
+	}
+	const auto data = DeserializeMessages(serialized);
+	if (!data) {
+		forget(history);
+		return;
+	}
+	const auto &messages = data->vmessages().v;
+	const auto last = history->lastMessage();
+	if (messages.isEmpty() || IdFromMessage(messages.front()) != last->id) {
+		return;
+	}
+
+	ProcessCachedPeers(_owner, *data);
+	applyLastSlice(history, messages);
+}
+
+void CachedHistories::applyLastSlice(
+		not_null<History*> history,
+		const QVector<MTPMessage> &messages) {
+	if (!needLastSlice(history)) {
+		return;
+	}
+
+	// Only a page that ends with the message the chats list knows
+	// as the last one is current, otherwise there is a gap.
+	const auto last = history->lastMessage();
+	if (messages.isEmpty() || IdFromMessage(messages.front()) != last->id) {
+		return;
+	}
+	history->addOlderSlice(messages);
+}
+
+} // namespace Data
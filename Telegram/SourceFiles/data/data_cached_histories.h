@@ -0,0 +1,63 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+class History;
+
+namespace Data {
+
+class Session;
+
+// The cached pages are raw server data, stored with the application
+// version, pages stored by another version are ignored.
+[[nodiscard]] QByteArray SerializeMessages(const MTPmessages_Messages &slice);
+[[nodiscard]] std::optional<MTPDmessages_messages> DeserializeMessages(
+	const QByteArray &serialized);
+
+// Applies only the users and chats that are not known yet.
+void ProcessCachedPeers(
+	not_null<Session*> owner,
+	const MTPDmessages_messages &data);
+
+// Keeps the last page of messages of recently opened chats, together
+// with their senders, in the encrypted media cache database. After
+// a restart the top chats of the list get those pages from disk, so
+// opening them doesn't wait for messages.getHistory.
+class CachedHistories final {
+public:
+	explicit CachedHistories(not_null<Session*> owner);
+	CachedHistories(const CachedHistories &other) = delete;
+	CachedHistories &operator=(const CachedHistories &other) = delete;
+
+	void store(
+		not_null<History*> history,
+		const MTPmessages_Messages &slice);
+	void forget(not_null<History*> history);
+
+	// Reads the pages of the top chats once, after the chats list loads.
+	void preload();
+
+	// Requests the last page of a chat the user is likely to open next.
+	void request(not_null<History*> history);
+
+private:
+	void apply(not_null<History*> history, const QByteArray &serialized);
+	void applyLastSlice(
+		not_null<History*> history,
+		const QVector<MTPMessage> &messages);
+	[[nodiscard]] bool needLastSlice(not_null<History*> history) const;
+
+	const not_null<Session*> _owner;
+	bool _preloaded = false;
+	base::flat_map<not_null<History*>, mtpRequestId> _requests;
+
+	rpl::lifetime _lifetime;
+
+};
+
+} // namespace Data
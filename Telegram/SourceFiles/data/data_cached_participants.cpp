@@ -0,0 +1,160 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "data/data_cached_participants.h"
+
+#include "data/data_session.h"
+#include "data/data_channel.h"
+#include "api/api_hash.h"
+#include "main/main_session.h"
+#include "storage/cache/storage_cache_database.h"
+#include "core/version.h"
+
+namespace Data {
+namespace {
+
+[[nodiscard]] Storage::Cache::Key CacheKey(
+		not_null<ChannelData*> channel,
+		ParticipantsList list) {
+	return ParticipantsCacheKey(channel->id, uint8(list));
+}
+
+[[nodiscard]] QByteArray Serialize(
+		const MTPDchannels_channelParticipants &data) {
+	auto buffer = mtpBuffer();
+	buffer.push_back(mtpPrime(AppVersion));
+	MTP_channels_channelParticipants(
+		data.vcount(),
+		data.vparticipants(),
+		data.vusers()
+	).write(buffer);
+	return QByteArray(
+		reinterpret_cast<const char*>(buffer.constData()),
+		buffer.size() * sizeof(mtpPrime));
+}
+
+[[nodiscard]] std::optional<MTPDchannels_channelParticipants> Deserialize(
+		const QByteArray &serialized) {
+	if (serialized.size() % sizeof(mtpPrime)) {
+		return std::nullopt;
+	}
+	auto from = reinterpret_cast<const mtpPrime*>(serialized.constData());
+	const auto till = from + serialized.size() / sizeof(mtpPrime);
+	if (from == till || *from++ != mtpPrime(AppVersion)) {
+		return std::nullopt;
+	}
+	auto result = MTPchannels_ChannelParticipants();
+	if (!result.read(from, till)
+		|| from != till
+		|| result.type() != mtpc_channels_channelParticipants) {
+		return std::nullopt;
+	}
+	return result.c_channels_channelParticipants();
+}
+
+// The same ids hash the server computes for channels.getParticipants.
+[[nodiscard]] int32 CountHash(const MTPDchannels_channelParticipants &data) {
+	auto result = Api::HashInit();
+	for (const auto &participant : data.vparticipants().v) {
+		Api::HashUpdate(result, participant.match([](const auto &data) {
+			return data.vuser_id().v;
+		}));
+	}
+	return Api::HashFinalize(result);
+}
+
+} // namespace
+
+CachedParticipants::CachedParticipants(not_null<Main::Session*> session)
+: _session(session) {
+}
+
+bool CachedParticipants::loaded(
+		not_null<ChannelData*> channel,
+		ParticipantsList list) const {
+	return _entries.contains(Key{ channel, list });
+}
+
+void CachedParticipants::load(
+		not_null<ChannelData*> channel,
+		ParticipantsList list,
+		Fn<void()> done) {
+	if (loaded(channel, list)) {
+		done();
+		return;
+	}
+	const auto key = Key{ channel, list };
+	_session->data().cache().get(
+		CacheKey(channel, list),
+		[=](QByteArray &&serialized) {
+			crl::on_main(_session, [=] {
+				apply(key, serialized);
+				done();
+			});
+		});
+}
+
+void CachedParticipants::apply(Key key, const QByteArray &serialized) {
+	auto &entry = _entries[key];
+	if (entry.data || serialized.isEmpty()) {
+		return;
+	}
+	entry.data = Deserialize(serialized);
+	if (entry.data) {
+		entry.hash = CountHash(*entry.data);
+	} else {
+		_session->data().cache().remove(CacheKey(key.first, key.second));
+	}
+}
+
+int32 CachedParticipants::hash(
+		not_null<ChannelData*> channel,
+		ParticipantsList list) const {
+	const auto i = _entries.find(Key{ channel, list });
+	return (i != end(_entries)) ? i->second.hash : 0;
+}
+
+std::optional<MTPchannels_ChannelParticipants> CachedParticipants::lookup(
+		not_null<ChannelData*> channel,
+		ParticipantsList list) const {
+	const auto i = _entries.find(Key{ channel, list });
+	if (i == end(_entries) || !i->second.data) {
+		return std::nullopt;
+	}
+	const auto &data = *i->second.data;
+
+	// The users we already know are newer than the cached ones.
+	auto users = QVector<MTPUser>();
+	for (const auto &user : data.vusers().v) {
+		const auto id = user.match([](const auto &data) {
+			return data.vid().v;
+		});
+		if (!_session->data().userLoaded(id)) {
+			users.push_back(user);
+		}
+	}
+	return MTP_channels_channelParticipants(
+		data.vcount(),
+		data.vparticipants(),
+		MTP_vector<MTPUser>(std::move(users)));
+}
+
+void CachedParticipants::store(
+		not_null<ChannelData*> channel,
+		ParticipantsList list,
+		const MTPDchannels_channelParticipants &data) {
+	auto &entry = _entries[Key{ channel, list }];
+	entry.data = data;
+	entry.hash = CountHash(data);
+	_session->data().cache().put(
+		CacheKey(channel, list),
+		Storage::Cache::Database::TaggedValue(
+			Serialize(data),
+			kHistorySliceCacheTag));
+}
+
+} // namespace Data
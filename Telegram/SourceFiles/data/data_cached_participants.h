@@ -0,0 +1,72 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+class ChannelData;
+
+namespace Main {
+class Session;
+} // namespace Main
+
+namespace Data {
+
+enum class ParticipantsList : uchar {
+	Recent = 0x01,
+	Bots = 0x02,
+	Admins = 0x03,
+};
+
+// Keeps the last received participants lists of megagroups, so that
+// they are requested with a hash and shown from the encrypted media
+// cache database after a restart, before the server answers.
+class CachedParticipants final {
+public:
+	explicit CachedParticipants(not_null<Main::Session*> session);
+	CachedParticipants(const CachedParticipants &other) = delete;
+	CachedParticipants &operator=(
+		const CachedParticipants &other) = delete;
+
+	[[nodiscard]] bool loaded(
+		not_null<ChannelData*> channel,
+		ParticipantsList list) const;
+
+	// Reads the list from disk once, calls done on the main thread.
+	void load(
+		not_null<ChannelData*> channel,
+		ParticipantsList list,
+		Fn<void()> done);
+
+	[[nodiscard]] int32 hash(
+		not_null<ChannelData*> channel,
+		ParticipantsList list) const;
+
+	// The users known already are dropped from the result.
+	[[nodiscard]] std::optional<MTPchannels_ChannelParticipants> lookup(
+		not_null<ChannelData*> channel,
+		ParticipantsList list) const;
+
+	void store(
+		not_null<ChannelData*> channel,
+		ParticipantsList list,
+		const MTPDchannels_channelParticipants &data);
+
+private:
+	using Key = std::pair<not_null<ChannelData*>, ParticipantsList>;
+	struct Entry {
+		std::optional<MTPDchannels_channelParticipants> data;
+		int32 hash = 0;
+	};
+
+	void apply(Key key, const QByteArray &serialized);
+
+	const not_null<Main::Session*> _session;
+	base::flat_map<Key, Entry> _entries;
+
+};
+
+} // namespace Data
@@ -20,6 +20,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "media/streaming/media_streaming_loader_mtproto.h"
 #include "media/streaming/media_streaming_loader_local.h"
 #include "storage/localstorage.h"
+#include "storage/file_download.h"
 #include "storage/streamed_file_downloader.h"
 #include "platform/platform_specific.h"
 #include "history/history.h"
@@ -38,14 +39,13 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 namespace {
 
-constexpr auto kMemoryForCache = 32 * 1024 * 1024;
 const auto kAnimatedStickerDimensions = QSize(512, 512);
 
 using FilePathResolve = DocumentData::FilePathResolve;
 
 Core::MediaActiveCache<DocumentData> &ActiveCache() {
 	static auto Instance = Core::MediaActiveCache<DocumentData>(
-		kMemoryForCache,
+		Core::MediaMemoryPriority::Low,
 		[](DocumentData *document) { document->unload(); });
 	return Instance;
 }
@@ -999,6 +999,11 @@ void DocumentData::save(
 			&MainWidget::documentLoadFailed);
 	}
 	if (loading()) {
+		const auto priority = Storage::LoadPriorityScope(
+			&session().downloader(),
+			(autoLoading
+				? session().downloader().startPriority()
+				: Storage::LoadPriority::Background));
 		_loader->start();
 	}
 	_owner->notifyDocumentLayoutChanged(this);
@@ -1573,6 +1578,7 @@ void DocumentData::setRemoteLocation(
 	if (_dc != dc || _access != access) {
 		_dc = dc;
 		_access = access;
+		session().downloader().prewarmDc(dc);
 		if (!isNull()) {
 			if (_location.check()) {
 				Local::writeFileLocation(mediaKey(), _location);
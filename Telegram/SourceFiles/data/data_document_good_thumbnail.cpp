@@ -25,6 +25,7 @@ namespace {
 
 constexpr auto kGoodThumbQuality = 87;
 constexpr auto kWallPaperSize = 960;
+constexpr auto kMaxGeneratingCount = 2;
 
 enum class FileType {
 	Video,
@@ -57,6 +58,7 @@ QImage Prepare(
 	if (!reader.canRead() || !validateSize(reader.size())) {
 		return QImage();
 	}
+	Images::PrepareReaderForSize(reader, kWallPaperSize);
 	auto result = reader.read();
 	if (!result.width() || !result.height()) {
 		return QImage();
@@ -71,6 +73,60 @@ QImage Prepare(
 		: result;
 }
 
+// Decoding a frame is heavy, so only a few thumbnails are generated at
+// once. The last requested ones go first, they're the visible ones, and
+// the cancelled ones are skipped without decoding anything.
+class GenerateQueue final {
+public:
+	using Method = FnMut<void(base::binary_guard &&guard)>;
+
+	void push(base::binary_guard &&guard, Method &&method);
+
+private:
+	struct Task {
+		base::binary_guard guard;
+		Method method;
+	};
+
+	void next();
+
+	std::vector<Task> _tasks;
+	int _running = 0;
+
+};
+
+GenerateQueue &Queue() {
+	static const auto result = new GenerateQueue();
+	return *result;
+}
+
+void GenerateQueue::push(base::binary_guard &&guard, Method &&method) {
+	_tasks.erase(ranges::remove_if(_tasks, [](const Task &task) {
+		return !task.guard;
+	}), end(_tasks));
+	_tasks.push_back({ std::move(guard), std::move(method) });
+	next();
+}
+
+void GenerateQueue::next() {
+	while (_running < kMaxGeneratingCount && !_tasks.empty()) {
+		auto task = std::move(_tasks.back());
+		_tasks.pop_back();
+		if (!task.guard) {
+			continue;
+		}
+		++_running;
+		crl::async([task = std::move(task)]() mutable {
+			task.method(std::move(task.guard));
+			crl::on_main([] {
+				auto &queue = Queue();
+				--queue._running;
+				queue.next();
+			});
+		});
+	}
+}
+
 } // namespace
 
 GoodThumbSource::GoodThumbSource(not_null<DocumentData*> document)
@@ -96,11 +152,10 @@ void GoodThumbSource::generate(base::binary_guard &&guard) {
 		_empty = true;
 		return;
 	}
-	crl::async([
+	Queue().push(std::move(guard), [
 		=,
-		guard = std::move(guard),
 		location = std::move(location)
-	]() mutable {
+	](base::binary_guard &&guard) mutable {
 		const auto filepath = (location && location->accessEnable())
 			? location->name()
 			: QString();
@@ -228,6 +283,10 @@ int GoodThumbSource::loadOffset() {
 	return 0;
 }
 
+QByteArray GoodThumbSource::loadedBytes() {
+	return QByteArray();
+}
+
 const StorageImageLocation &GoodThumbSource::location() {
 	return StorageImageLocation::Invalid();
 }
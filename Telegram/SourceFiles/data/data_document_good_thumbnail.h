@@ -33,6 +33,7 @@ public:
 	void cancel() override;
 	float64 progress() override;
 	int loadOffset() override;
+	QByteArray loadedBytes() override;
 
 	const StorageImageLocation &location() override;
 	void refreshFileReference(const QByteArray &data) override;
@@ -7,6 +7,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #pragma once
 
+#include "base/small_pool.h"
+
 class HistoryItem;
 
 namespace base {
@@ -63,6 +65,8 @@ struct Invoice {
 
 class Media {
 public:
+	BASE_SMALL_POOL_ALLOCATED
+
 	Media(not_null<HistoryItem*> parent);
 	virtual ~Media() = default;
 
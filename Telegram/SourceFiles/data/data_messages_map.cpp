@@ -0,0 +1,69 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "data/data_messages_map.h"
+
+#include "history/history_item.h"
+
+namespace Data {
+
+MessagesMap::MessagesMap() = default;
+
+MessagesMap::MessagesMap(MessagesMap &&other) = default;
+
+MessagesMap &MessagesMap::operator=(MessagesMap &&other) = default;
+
+MessagesMap::~MessagesMap() = default;
+
+HistoryItem *MessagesMap::find(MsgId id) const {
+	const auto key = uint32(id);
+	const auto i = _segments.find(key >> kSegmentShift);
+	return (i != _segments.end())
+		? i->second->items[key & (kSegmentSize - 1)].get()
+		: nullptr;
+}
+
+void MessagesMap::emplace(MsgId id, std::unique_ptr<HistoryItem> item) {
+	Expects(item != nullptr);
+
+	const auto key = uint32(id);
+	auto &segment = _segments[key >> kSegmentShift];
+	if (!segment) {
+		segment = std::make_unique<Segment>();
+	}
+	auto &place = segment->items[key & (kSegmentSize - 1)];
+	Assert(place == nullptr);
+	place = std::move(item);
+	++segment->count;
+}
+
+std::unique_ptr<HistoryItem> MessagesMap::take(MsgId id) {
+	const auto key = uint32(id);
+	const auto i = _segments.find(key >> kSegmentShift);
+	if (i == _segments.end()) {
+		return nullptr;
+	}
+	auto result = std::move(i->second->items[key & (kSegmentSize - 1)]);
+	if (result && !--i->second->count) {
+		_segments.erase(i);
+	}
+	return result;
+}
+
+int MessagesMap::size() const {
+	auto result = 0;
+	for (const auto &[index, segment] : _segments) {
+		result += segment->count;
+	}
+	return result;
+}
+
+int64 MessagesMap::segmentsBytes() const {
+	return int64(_segments.size()) * sizeof(Segment);
+}
+
+} // namespace Data
@@ -0,0 +1,48 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/flat_hash_map.h"
+
+namespace Data {
+
+// Owns the items of one channel or of all the non-channel chats by id.
+//
+// Message ids are given out sequentially and are loaded in pages, so
+// the items are kept in segments of consecutive ids. A lookup costs one
+// probe of a flat hash map plus an array index, and a loaded page takes
+// a couple of segments instead of a hash node for every item.
+class MessagesMap final {
+public:
+	MessagesMap();
+	MessagesMap(MessagesMap &&other);
+	MessagesMap &operator=(MessagesMap &&other);
+	~MessagesMap();
+
+	[[nodiscard]] HistoryItem *find(MsgId id) const;
+	void emplace(MsgId id, std::unique_ptr<HistoryItem> item);
+	std::unique_ptr<HistoryItem> take(MsgId id);
+
+	// Items count and the bytes taken by the map itself.
+	[[nodiscard]] int size() const;
+	[[nodiscard]] int64 segmentsBytes() const;
+
+private:
+	static constexpr auto kSegmentShift = 5;
+	static constexpr auto kSegmentSize = (1 << kSegmentShift);
+
+	struct Segment {
+		std::array<std::unique_ptr<HistoryItem>, kSegmentSize> items;
+		int count = 0;
+	};
+
+	base::flat_hash_map<uint32, std::unique_ptr<Segment>> _segments;
+
+};
+
+} // namespace Data
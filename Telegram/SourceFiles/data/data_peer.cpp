@@ -105,7 +105,6 @@ PeerData::PeerData(not_null<Data::Session*> owner, PeerId id)
 : id(id)
 , _owner(owner)
 , _userpicEmpty(createEmptyUserpic()) {
-	_nameText.setText(st::msgNameStyle, QString(), Ui::NameTextOptions());
 }
 
 Data::Session &PeerData::owner() const {
@@ -139,7 +138,7 @@ void PeerData::updateNameDelayed(
 		}
 	}
 	name = newName;
-	_nameText.setText(st::msgNameStyle, name, Ui::NameTextOptions());
+	_nameText.clear();
 	refreshEmptyUserpic();
 	Notify::PeerUpdate update(this);
 	if (nameVersion++ > 1) {
@@ -225,11 +224,19 @@ ImagePtr PeerData::currentUserpic() const {
 }
 
 void PeerData::paintUserpic(Painter &p, int x, int y, int size) const {
+	// Lists show many userpics at once, so they are prepared in the
+	// background and the monogram placeholder is painted meanwhile.
 	if (auto userpic = currentUserpic()) {
-		p.drawPixmap(x, y, userpic->pixCircled(userpicOrigin(), size, size));
-	} else {
-		_userpicEmpty->paint(p, x, y, x + size + x, size);
+		const auto origin = userpicOrigin();
+		if (const auto pixmap = userpic->pixCircledAsync(origin, size, size)) {
+			p.drawPixmap(x, y, *pixmap);
+			return;
+		}
 	}
+	if (!_userpicEmpty) {
+		_userpicEmpty = createEmptyUserpic();
+	}
+	_userpicEmpty->paint(p, x, y, x + size + x, size);
 }
 
 void PeerData::paintUserpicRounded(Painter &p, int x, int y, int size) const {
@@ -601,17 +608,22 @@ const Ui::Text::String &PeerData::topBarNameText() const {
 	if (const auto to = migrateTo()) {
 		return to->topBarNameText();
 	} else if (const auto user = asUser()) {
-		if (!user->phoneText.isEmpty()) {
-			return user->phoneText;
+		if (const auto &phoneText = user->phoneText(); !phoneText.isEmpty()) {
+			return phoneText;
 		}
 	}
-	return _nameText;
+	return nameText();
 }
 
 const Ui::Text::String &PeerData::nameText() const {
 	if (const auto to = migrateTo()) {
 		return to->nameText();
 	}
+	// Most of the known peers are never painted, so the layout is built
+	// only on the first request.
+	if (_nameText.isEmpty() && !name.isEmpty()) {
+		_nameText.setText(st::msgNameStyle, name, Ui::NameTextOptions());
+	}
 	return _nameText;
 }
 
@@ -360,7 +360,7 @@ private:
 	PhotoId _userpicPhotoId = kUnknownPhotoId;
 	mutable std::unique_ptr<Ui::EmptyUserpic> _userpicEmpty;
 	StorageImageLocation _userpicLocation;
-	Ui::Text::String _nameText;
+	mutable Ui::Text::String _nameText;
 
 	Data::NotifySettings _notify;
 
@@ -9,6 +9,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "data/data_session.h"
 #include "data/data_file_origin.h"
+#include "main/main_session.h"
+#include "storage/file_download.h"
 #include "ui/image/image.h"
 #include "ui/image/image_source.h"
 #include "mainwidget.h"
@@ -145,6 +147,7 @@ void PhotoData::setRemoteLocation(
 	if (_dc != dc || _access != access) {
 		_dc = dc;
 		_access = access;
+		session().downloader().prewarmDc(dc);
 	}
 }
 
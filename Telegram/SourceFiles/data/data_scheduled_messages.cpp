@@ -9,12 +9,14 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "data/data_peer.h"
 #include "data/data_session.h"
+#include "data/data_cached_histories.h"
 #include "api/api_hash.h"
 #include "api/api_text_entities.h"
 #include "main/main_session.h"
 #include "history/history.h"
 #include "history/history_item_components.h"
 #include "apiwrap.h"
+#include "storage/cache/storage_cache_database.h"
 
 namespace Data {
 namespace {
@@ -231,6 +233,10 @@ Data::MessagesSlice ScheduledMessages::list(not_null<History*> history) {
 }
 
 void ScheduledMessages::request(not_null<History*> history) {
+	if (_cacheRequested.emplace(history).second) {
+		readCache(history);
+		return;
+	}
 	auto &request = _requests[history];
 	if (request.requestId || TooEarlyForRequest(request.lastReceived)) {
 		return;
@@ -262,28 +268,74 @@ void ScheduledMessages::parse(
 	}, [&](const auto &data) {
 		_session->data().processUsers(data.vusers());
 		_session->data().processChats(data.vchats());
+		applyMessages(history, data.vmessages().v);
 
-		const auto &messages = data.vmessages().v;
-		if (messages.isEmpty()) {
-			clearNotSending(history);
-			return;
+		const auto key = ScheduledCacheKey(history->peer->id);
+		if (data.vmessages().v.isEmpty()) {
+			_session->data().cache().remove(key);
+		} else {
+			_session->data().cache().put(
+				key,
+				Storage::Cache::Database::TaggedValue(
+					SerializeMessages(list),
+					kHistorySliceCacheTag));
 		}
-		auto received = base::flat_set<not_null<HistoryItem*>>();
-		auto clear = base::flat_set<not_null<HistoryItem*>>();
-		auto &list = _data.emplace(history, List()).first->second;
-		for (const auto &message : messages) {
-			if (const auto item = append(history, list, message)) {
-				received.emplace(item);
-			}
+	});
+}
+
+// The list from the cache is shown until the server answers, with the
+// request hash computed from it, so usually nothing has to be resent.
+void ScheduledMessages::readCache(not_null<History*> history) {
+	const auto weak = base::make_weak(this);
+	_session->data().cache().get(
+		ScheduledCacheKey(history->peer->id),
+		[=](QByteArray &&serialized) {
+			crl::on_main(weak, [=] {
+				applyCache(history, serialized);
+				request(history);
+			});
+		});
+}
+
+void ScheduledMessages::applyCache(
+		not_null<History*> history,
+		const QByteArray &serialized) {
+	const auto i = _requests.find(history);
+	if (serialized.isEmpty()
+		|| (i != end(_requests) && i->second.lastReceived)) {
+		return;
+	}
+	const auto data = DeserializeMessages(serialized);
+	if (!data) {
+		_session->data().cache().remove(ScheduledCacheKey(history->peer->id));
+		return;
+	}
+	ProcessCachedPeers(&_session->data(), *data);
+	applyMessages(history, data->vmessages().v);
+}
+
+void ScheduledMessages::applyMessages(
+		not_null<History*> history,
+		const QVector<MTPMessage> &messages) {
+	if (messages.isEmpty()) {
+		clearNotSending(history);
+		return;
+	}
+	auto received = base::flat_set<not_null<HistoryItem*>>();
+	auto clear = base::flat_set<not_null<HistoryItem*>>();
+	auto &list = _data.emplace(history, List()).first->second;
+	for (const auto &message : messages) {
+		if (const auto item = append(history, list, message)) {
+			received.emplace(item);
 		}
-		for (const auto &owned : list.items) {
-			const auto item = owned.get();
-			if (!item->isSending() && !received.contains(item)) {
-				clear.emplace(item);
-			}
+	}
+	for (const auto &owned : list.items) {
+		const auto item = owned.get();
+		if (!item->isSending() && !received.contains(item)) {
+			clear.emplace(item);
 		}
-		updated(history, received, clear);
-	});
+	}
+	updated(history, received, clear);
 }
 
 HistoryItem *ScheduledMessages::append(
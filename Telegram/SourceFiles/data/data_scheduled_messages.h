@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "history/history_item.h"
 #include "base/timer.h"
+#include "base/weak_ptr.h"
 
 class History;
 
@@ -21,7 +22,7 @@ namespace Data {
 class Session;
 struct MessagesSlice;
 
-class ScheduledMessages final {
+class ScheduledMessages final : public base::has_weak_ptr {
 public:
 	explicit ScheduledMessages(not_null<Session*> owner);
 	ScheduledMessages(const ScheduledMessages &other) = delete;
@@ -59,6 +60,13 @@ private:
 	void parse(
 		not_null<History*> history,
 		const MTPmessages_Messages &list);
+	void readCache(not_null<History*> history);
+	void applyCache(
+		not_null<History*> history,
+		const QByteArray &serialized);
+	void applyMessages(
+		not_null<History*> history,
+		const QVector<MTPMessage> &messages);
 	HistoryItem *append(
 		not_null<History*> history,
 		List &list,
@@ -78,6 +86,7 @@ private:
 	base::Timer _clearTimer;
 	base::flat_map<not_null<History*>, List> _data;
 	base::flat_map<not_null<History*>, Request> _requests;
+	base::flat_set<not_null<History*>> _cacheRequested;
 	rpl::event_stream<not_null<History*>> _updates;
 
 	rpl::lifetime _lifetime;
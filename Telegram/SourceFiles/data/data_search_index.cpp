@@ -0,0 +1,140 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "data/data_search_index.h"
+
+#include "history/history_item.h"
+
+namespace Data {
+namespace {
+
+[[nodiscard]] QStringList ItemWords(not_null<HistoryItem*> item) {
+	if (!item->toHistoryMessage() || !item->isHistoryEntry()) {
+		return {};
+	}
+	auto result = TextUtilities::PrepareSearchWords(
+		item->originalText().text);
+	result.removeDuplicates();
+	return result;
+}
+
+} // namespace
+
+void SearchIndex::registerMessage(not_null<HistoryItem*> item) {
+	auto words = ItemWords(item);
+	if (!words.isEmpty()) {
+		add(item, std::move(words));
+	}
+}
+
+void SearchIndex::unregisterMessage(not_null<const HistoryItem*> item) {
+	remove(item);
+}
+
+void SearchIndex::refreshMessage(not_null<HistoryItem*> item) {
+	// Items are indexed only after they are registered in the session.
+	if (!_words.contains(item)) {
+		return;
+	}
+	remove(item);
+	registerMessage(item);
+}
+
+void SearchIndex::add(not_null<HistoryItem*> item, QStringList &&words) {
+	for (const auto &word : words) {
+		_items[word].emplace(item);
+	}
+	_words.emplace(item, std::move(words));
+}
+
+void SearchIndex::remove(not_null<const HistoryItem*> item) {
+	const auto i = _words.find(item);
+	if (i == _words.end()) {
+		return;
+	}
+	for (const auto &word : i->second) {
+		const auto j = _items.find(word);
+		if (j != _items.end()) {
+			j->second.remove(const_cast<HistoryItem*>(item.get()));
+			if (j->second.empty()) {
+				_items.erase(j);
+			}
+		}
+	}
+	_words.erase(i);
+}
+
+bool SearchIndex::hasWordWithPrefix(
+		not_null<HistoryItem*> item,
+		const QString &prefix) const {
+	const auto i = _words.find(item);
+	if (i == _words.end()) {
+		return false;
+	}
+	for (const auto &word : i->second) {
+		if (word.startsWith(prefix)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+std::vector<not_null<HistoryItem*>> SearchIndex::query(
+		const QString &query,
+		Fn<bool(not_null<HistoryItem*>)> filter,
+		int limit) const {
+	const auto words = TextUtilities::PrepareSearchWords(query);
+	if (words.isEmpty() || limit <= 0) {
+		return {};
+	}
+
+	// Take the candidates from the longest word of the query,
+	// it usually matches the smallest amount of indexed words.
+	const auto longest = *ranges::max_element(
+		words,
+		std::less<>(),
+		&QString::size);
+	auto result = std::vector<not_null<HistoryItem*>>();
+	for (auto i = _items.lower_bound(longest); i != _items.end(); ++i) {
+		if (!i->first.startsWith(longest)) {
+			break;
+		}
+		for (const auto item : i->second) {
+			if (!filter || filter(item)) {
+				result.push_back(item);
+			}
+		}
+	}
+	ranges::sort(result);
+	result.erase(ranges::unique(result), result.end());
+
+	const auto missing = [&](not_null<HistoryItem*> item) {
+		for (const auto &word : words) {
+			if (word != longest && !hasWordWithPrefix(item, word)) {
+				return true;
+			}
+		}
+		return false;
+	};
+	result.erase(ranges::remove_if(result, missing), result.end());
+
+	const auto newer = [](
+			not_null<HistoryItem*> a,
+			not_null<HistoryItem*> b) {
+		return (a->date() > b->date())
+			|| (a->date() == b->date() && a->id > b->id);
+	};
+	if (int(result.size()) > limit) {
+		ranges::partial_sort(result, result.begin() + limit, newer);
+		result.erase(result.begin() + limit, result.end());
+	} else {
+		ranges::sort(result, newer);
+	}
+	return result;
+}
+
+} // namespace Data
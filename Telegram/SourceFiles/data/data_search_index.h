@@ -0,0 +1,44 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/flat_hash_map.h"
+
+namespace Data {
+
+// Inverted index of words in the texts of messages that are loaded
+// in memory, so that search can show something before the server
+// answers. An item leaves the index when it is destroyed.
+class SearchIndex {
+public:
+	void registerMessage(not_null<HistoryItem*> item);
+	void unregisterMessage(not_null<const HistoryItem*> item);
+	void refreshMessage(not_null<HistoryItem*> item);
+
+	// Every word of the query must be a prefix of some word of a result.
+	// Results are ordered from the newest to the oldest.
+	[[nodiscard]] std::vector<not_null<HistoryItem*>> query(
+		const QString &query,
+		Fn<bool(not_null<HistoryItem*>)> filter,
+		int limit) const;
+
+private:
+	using Items = base::flat_set<not_null<HistoryItem*>>;
+
+	void add(not_null<HistoryItem*> item, QStringList &&words);
+	void remove(not_null<const HistoryItem*> item);
+	[[nodiscard]] bool hasWordWithPrefix(
+		not_null<HistoryItem*> item,
+		const QString &prefix) const;
+
+	std::map<QString, Items> _items;
+	base::flat_hash_map<const HistoryItem*, QStringList> _words;
+
+};
+
+} // namespace Data
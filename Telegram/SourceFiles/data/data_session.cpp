@@ -14,6 +14,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "api/api_text_entities.h"
 #include "core/application.h"
 #include "core/crash_reports.h" // CrashReports::SetAnnotation
+#include "core/core_startup_timeline.h"
 #include "ui/image/image.h"
 #include "ui/image/image_source.h" // Images::LocalFileSource
 #include "export/export_controller.h"
@@ -21,6 +22,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "window/notifications_manager.h"
 #include "history/history.h"
 #include "history/history_item_components.h"
+#include "history/history_message.h"
 #include "history/view/media/history_view_media.h"
 #include "history/view/history_view_element.h"
 #include "inline_bots/inline_bot_layout_item.h"
@@ -48,6 +50,10 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_poll.h"
 #include "data/data_scheduled_messages.h"
 #include "data/data_cloud_themes.h"
+#include "data/data_cached_histories.h"
+#include "data/data_web_page_previews.h"
+#include "data/data_text_layouts.h"
+#include "data/data_animation_posters.h"
 #include "base/unixtime.h"
 #include "facades.h"
 #include "app.h"
@@ -58,6 +64,8 @@ namespace {
 
 constexpr auto kMaxNotifyCheckDelay = 24 * 3600 * crl::time(1000);
 constexpr auto kMaxWallpaperSize = 10 * 1024 * 1024;
+constexpr auto kUnloadViewsCheckTimeout = 60 * crl::time(1000);
+constexpr auto kUnloadViewsHiddenTimeout = 5 * 60 * crl::time(1000);
 
 using ViewElement = HistoryView::Element;
 
@@ -212,11 +220,33 @@ Session::Session(not_null<Main::Session*> session)
 	return sendActionsAnimationCallback(now);
 })
 , _unmuteByFinishedTimer([=] { unmuteByFinished(); })
+, _unloadViewsTimer([=] {
+	unloadHistoryViews();
+	sweepUnreferencedMedia();
+})
 , _groups(this)
 , _scheduledMessages(std::make_unique<ScheduledMessages>(this))
-, _cloudThemes(std::make_unique<CloudThemes>(session)) {
-	_cache->open(Local::cacheKey());
-	_bigFileCache->open(Local::cacheBigFileKey());
+, _cloudThemes([=] { return std::make_unique<CloudThemes>(session); })
+, _cachedHistories(std::make_unique<CachedHistories>(this))
+, _webPagePreviews(std::make_unique<WebPagePreviews>(this))
+, _textLayouts(std::make_unique<TextLayouts>(this))
+, _animationPosters(std::make_unique<AnimationPosters>(this))
+, _itemsMemory("Data::Session items", [=] { return itemsMemoryUsage(); })
+, _peersMemory("Data::Session peers", [=] { return peersMemoryUsage(); }) {
+	const auto started = crl::profile();
+	_cache->open(Local::cacheKey(), [=](Storage::Cache::Error) {
+		Core::StartupPhaseRecord("cache open", started, crl::profile());
+	});
+	_bigFileCache->open(Local::cacheBigFileKey(), [=](
+			Storage::Cache::Error) {
+		Core::StartupPhaseRecord(
+			"big file cache open",
+			started,
+			crl::profile());
+	});
+	Core::App().postponeUntilFirstPaint(crl::guard(session, [=] {
+		_cloudThemes.ensure();
+	}));
 
 	if constexpr (Platform::IsLinux()) {
 		const auto wasVersion = Local::oldMapVersion();
@@ -230,10 +260,15 @@ Session::Session(not_null<Main::Session*> session)
 	setupChannelLeavingViewer();
 	setupPeerNameViewer();
 	setupUserIsContactViewer();
+
+	_unloadViewsTimer.callEach(kUnloadViewsCheckTimeout);
 }
 
 void Session::clear() {
 	_sendActions.clear();
+	_sendActionAnimationUpdates.clear();
+	_unreferencedPhotos.clear();
+	_unreferencedDocuments.clear();
 
 	for (const auto &[peerId, history] : _histories) {
 		history->clear(History::ClearType::Unload);
@@ -242,6 +277,7 @@ void Session::clear() {
 	_dependentMessages.clear();
 	base::take(_messages);
 	base::take(_channelMessages);
+	_searchIndex = SearchIndex();
 	_messageByRandomId.clear();
 	_sentMessagesData.clear();
 	cSetRecentInlineBots(RecentInlineBots());
@@ -841,7 +877,6 @@ void Session::registerSendAction(
 	if (history->updateSendActionNeedsAnimating(user, action)) {
 		user->madeAction(when);
 
-		const auto i = _sendActions.find(history);
 		if (!_sendActions.contains(history)) {
 			_sendActions.emplace(history, crl::now());
 			_sendActionsAnimation.start();
@@ -857,6 +892,15 @@ bool Session::sendActionsAnimationCallback(crl::time now) {
 			i = _sendActions.erase(i);
 		}
 	}
+	if (!_sendActionAnimationUpdates.empty()) {
+		auto updates = SendActionAnimationUpdates();
+		updates.reserve(_sendActionAnimationUpdates.size());
+		for (const auto &[history, update] : base::take(
+				_sendActionAnimationUpdates)) {
+			updates.push_back(update);
+		}
+		_sendActionAnimationUpdate.fire(std::move(updates));
+	}
 	return !_sendActions.empty();
 }
 
@@ -1203,13 +1247,9 @@ rpl::producer<not_null<HistoryItem*>> Session::unreadItemAdded() const {
 
 void Session::changeMessageId(ChannelId channel, MsgId wasId, MsgId nowId) {
 	const auto list = messagesListForInsert(channel);
-	auto i = list->find(wasId);
-	Assert(i != list->end());
-	auto owned = std::move(i->second);
-	list->erase(i);
-	const auto [j, ok] = list->emplace(nowId, std::move(owned));
-
-	Ensures(ok);
+	auto owned = list->take(wasId);
+	Assert(owned != nullptr);
+	list->emplace(nowId, std::move(owned));
 }
 
 void Session::notifyItemIdChange(IdChange event) {
@@ -1253,6 +1293,17 @@ rpl::producer<not_null<const ViewElement*>> Session::viewRepaintRequest() const
 	return _viewRepaintRequest.events();
 }
 
+void Session::requestViewPartRepaint(
+		not_null<const ViewElement*> view,
+		QRect rect) {
+	_viewPartRepaintRequest.fire({ view, rect });
+}
+
+auto Session::viewPartRepaintRequest() const
+-> rpl::producer<ViewPartRepaint> {
+	return _viewPartRepaintRequest.events();
+}
+
 void Session::requestItemResize(not_null<const HistoryItem*> item) {
 	_itemResizeRequest.fire_copy(item);
 	enumerateItemViews(item, [&](not_null<ViewElement*> view) {
@@ -1355,6 +1406,118 @@ void Session::sendHistoryChangeNotifications() {
 	}
 }
 
+void Session::unloadHistoryViews() {
+	const auto limit = _session->settings().loadedViewsLimit();
+	if (!limit) {
+		return;
+	}
+	const auto now = crl::now();
+	auto loaded = 0;
+	auto candidates = std::vector<not_null<History*>>();
+	for (const auto &[peerId, history] : _histories) {
+		const auto count = history->loadedViewsCount();
+		if (!count) {
+			continue;
+		}
+		loaded += count;
+		const auto shownAt = history->lastShownTime();
+		if (!history->shown()
+			&& (!shownAt || shownAt + kUnloadViewsHiddenTimeout <= now)) {
+			candidates.push_back(history.get());
+		}
+	}
+	if (loaded <= limit) {
+		return;
+	}
+
+	// Items stay loaded, they may be referenced by replies, notifications
+	// or other sections, only the views are destroyed here.
+	ranges::sort(candidates, ranges::less(), &History::lastShownTime);
+	for (const auto history : candidates) {
+		loaded -= history->loadedViewsCount();
+		history->clear(History::ClearType::Unload);
+		if (loaded <= limit) {
+			break;
+		}
+	}
+}
+
+// The media objects themselves stay alive, raw pointers to them are kept
+// in too many places. Only their loaded images and bytes are freed if
+// they had no items for two sweeps in a row, they're loaded again from
+// the local cache when needed.
+void Session::sweepUnreferencedMedia() {
+	const auto referenced = [](const auto &items, const auto *data) {
+		const auto i = items.find(data);
+		return (i != end(items)) && !i->second.empty();
+	};
+
+	auto photos = std::vector<not_null<PhotoData*>>();
+	for (const auto &[id, photo] : _photos) {
+		const auto raw = photo.get();
+		if (referenced(_photoItems, raw)
+			|| (!raw->thumbnailSmall()->loaded()
+				&& !raw->thumbnail()->loaded()
+				&& !raw->large()->loaded())) {
+			continue;
+		} else if (_unreferencedPhotos.contains(raw)) {
+			raw->unload();
+		} else {
+			photos.push_back(raw);
+		}
+	}
+	_unreferencedPhotos = base::flat_set<not_null<PhotoData*>>(
+		begin(photos),
+		end(photos));
+
+	auto documents = std::vector<not_null<DocumentData*>>();
+	for (const auto &[id, document] : _documents) {
+		const auto raw = document.get();
+		const auto sticker = raw->sticker();
+		if (referenced(_documentItems, raw)
+			|| (raw->data().isEmpty() && !(sticker && sticker->image))) {
+			continue;
+		} else if (_unreferencedDocuments.contains(raw)) {
+			raw->unload();
+		} else {
+			documents.push_back(raw);
+		}
+	}
+	_unreferencedDocuments = base::flat_set<not_null<DocumentData*>>(
+		begin(documents),
+		end(documents));
+}
+
+// Only the objects themselves, without texts, media and components.
+base::memory_usage::Usage Session::itemsMemoryUsage() const {
+	auto result = base::memory_usage::Usage();
+	const auto add = [&](const Messages &messages) {
+		const auto count = messages.size();
+		result.count += count;
+		result.bytes += count * int64(sizeof(HistoryMessage))
+			+ messages.segmentsBytes();
+	};
+	add(_messages);
+	for (const auto &[channelId, messages] : _channelMessages) {
+		add(*messages);
+	}
+	return result;
+}
+
+base::memory_usage::Usage Session::peersMemoryUsage() const {
+	auto result = base::memory_usage::Usage();
+	for (const auto &[peerId, peer] : _peers) {
+		++result.count;
+		result.bytes += peer->isUser()
+			? sizeof(UserData)
+			: peer->isChat()
+			? sizeof(ChatData)
+			: sizeof(ChannelData);
+	}
+	result.bytes += int64(_histories.size()) * sizeof(History);
+	return result;
+}
+
 void Session::registerHeavyViewPart(not_null<ViewElement*> view) {
 	_heavyViewParts.emplace(view);
 }
@@ -1668,6 +1831,31 @@ bool Session::checkEntitiesAndViewsUpdate(const MTPDmessage &data) {
 	return false;
 }
 
+void Session::allowStickersLoad() {
+	_stickersLoadAllowed = true;
+}
+
+void Session::loadStickers() const {
+	if (_stickersLoaded || !_stickersLoadAllowed) {
+		return;
+	}
+	_stickersLoaded = true;
+	Local::readInstalledStickers();
+	Local::readFeaturedStickers();
+	Local::readRecentStickers();
+	Local::readFavedStickers();
+	Local::writeStickersHashes();
+}
+
+void Session::loadSavedGifs() const {
+	if (_savedGifsLoaded || !_stickersLoadAllowed) {
+		return;
+	}
+	_savedGifsLoaded = true;
+	Local::readSavedGifs();
+	Local::writeStickersHashes();
+}
+
 void Session::addSavedGif(not_null<DocumentData*> document) {
 	const auto index = _savedGifs.indexOf(document);
 	if (!index) {
@@ -1728,6 +1916,7 @@ void Session::updateEditedMessage(const MTPMessage &data) {
 	}, [&](const auto &data) {
 		existing->applyEdition(data);
 	});
+	cachedHistories().forget(existing->history());
 }
 
 void Session::processMessages(
@@ -1766,14 +1955,19 @@ const Session::Messages *Session::messagesList(ChannelId channelId) const {
 		return &_messages;
 	}
 	const auto i = _channelMessages.find(channelId);
-	return (i != end(_channelMessages)) ? &i->second : nullptr;
+	return (i != end(_channelMessages)) ? i->second.get() : nullptr;
 }
 
 auto Session::messagesListForInsert(ChannelId channelId)
 -> not_null<Messages*> {
-	return (channelId == NoChannel)
-		? &_messages
-		: &_channelMessages[channelId];
+	if (channelId == NoChannel) {
+		return &_messages;
+	}
+	auto &result = _channelMessages[channelId];
+	if (!result) {
+		result = std::make_unique<Messages>();
+	}
+	return result.get();
 }
 
 HistoryItem *Session::registerMessage(std::unique_ptr<HistoryItem> item) {
@@ -1781,12 +1975,12 @@ HistoryItem *Session::registerMessage(std::unique_ptr<HistoryItem> item) {
 
 	const auto result = item.get();
 	const auto list = messagesListForInsert(result->channelId());
-	const auto i = list->find(result->id);
-	if (i != list->end()) {
+	if (const auto existing = list->find(result->id)) {
 		LOG(("App Error: Trying to re-registerMessage()."));
-		i->second->destroy();
+		existing->destroy();
 	}
 	list->emplace(result->id, std::move(item));
+	_searchIndex.registerMessage(result);
 	return result;
 }
 
@@ -1803,10 +1997,9 @@ void Session::processMessagesDeleted(
 
 	auto historiesToCheck = base::flat_set<not_null<History*>>();
 	for (const auto messageId : data) {
-		const auto i = list ? list->find(messageId.v) : Messages::iterator();
-		if (list && i != list->end()) {
-			const auto history = i->second->history();
-			destroyMessage(i->second.get());
+		if (const auto item = list ? list->find(messageId.v) : nullptr) {
+			const auto history = item->history();
+			destroyMessage(item);
 			if (!history->chatListMessageKnown()) {
 				historiesToCheck.emplace(history);
 			}
@@ -1853,11 +2046,12 @@ void Session::destroyMessage(not_null<HistoryItem*> item) {
 	}
 	_itemRemoved.fire_copy(item);
 	groups().unregisterMessage(item);
+	_searchIndex.unregisterMessage(item);
 	removeDependencyMessage(item);
 	session().notifications().clearFromItem(item);
 
 	const auto list = messagesListForInsert(peerToChannel(peerId));
-	list->erase(item->id);
+	list->take(item->id);
 }
 
 MsgId Session::nextLocalMessageId() {
@@ -1872,12 +2066,7 @@ HistoryItem *Session::message(ChannelId channelId, MsgId itemId) const {
 	}
 
 	const auto data = messagesList(channelId);
-	if (!data) {
-		return nullptr;
-	}
-
-	const auto i = data->find(itemId);
-	return (i != data->end()) ? i->second.get() : nullptr;
+	return data ? data->find(itemId) : nullptr;
 }
 
 HistoryItem *Session::message(
@@ -2043,13 +2232,22 @@ HistoryItem *Session::addNewMessage(
 }
 
 auto Session::sendActionAnimationUpdated() const
--> rpl::producer<SendActionAnimationUpdate> {
+-> rpl::producer<SendActionAnimationUpdates> {
 	return _sendActionAnimationUpdate.events();
 }
 
 void Session::updateSendActionAnimation(
 		SendActionAnimationUpdate &&update) {
-	_sendActionAnimationUpdate.fire(std::move(update));
+	const auto i = _sendActionAnimationUpdates.find(update.history);
+	if (i != end(_sendActionAnimationUpdates)) {
+		update.textUpdated |= i->second.textUpdated;
+		i->second = std::move(update);
+	} else {
+		_sendActionAnimationUpdates.emplace(update.history, std::move(update));
+	}
+	if (!_sendActionsAnimation.animating()) {
+		_sendActionsAnimation.start();
+	}
 }
 
 int Session::unreadBadge() const {
@@ -2128,6 +2326,7 @@ void Session::unreadEntryChanged(const Dialogs::Key &key, bool added) {
 		} else {
 			_chatsList.unreadEntryChanged(state, added);
 		}
+		Notify::unreadCounterUpdated();
 	}
 }
 
@@ -3439,6 +3638,29 @@ void Session::removeChatListEntry(Dialogs::Key key) {
 	}
 }
 
+bool Session::postponeChatListExistence(Dialogs::Key key, bool exists) {
+	if (!_chatListUpdatesPostponed) {
+		return false;
+	}
+	_postponedChatListExistence[key] = exists;
+	return true;
+}
+
+void Session::applyPostponedChatListUpdates() {
+	auto postponed = base::take(_postponedChatListExistence);
+
+	// Dialogs rows are moved one by one, starting from the top ones.
+	auto entries = std::vector<std::pair<Dialogs::Key, bool>>(
+		begin(postponed),
+		end(postponed));
+	ranges::sort(entries, std::greater<>(), [](const auto &pair) {
+		return pair.first.entry()->sortKeyInChatList();
+	});
+	for (const auto &[key, exists] : entries) {
+		key.entry()->applyChatListExistence(exists);
+	}
+}
+
 void Session::dialogsRowReplaced(DialogsRowReplacement replacement) {
 	_dialogsRowReplacements.fire(std::move(replacement));
 }
@@ -13,10 +13,14 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "dialogs/dialogs_indexed_list.h"
 #include "dialogs/dialogs_main_list.h"
 #include "data/data_groups.h"
+#include "data/data_search_index.h"
+#include "data/data_messages_map.h"
 #include "data/data_notify_settings.h"
 #include "history/history_location_manager.h"
 #include "base/timer.h"
 #include "base/flags.h"
+#include "base/memory_usage.h"
+#include "base/lazy_service.h"
 #include "ui/effects/animations.h"
 
 class Image;
@@ -65,6 +69,10 @@ class LocationPoint;
 class WallPaper;
 class ScheduledMessages;
 class CloudThemes;
+class CachedHistories;
+class WebPagePreviews;
+class AnimationPosters;
+class TextLayouts;
 
 class Session final {
 public:
@@ -88,11 +96,29 @@ public:
 	[[nodiscard]] const Groups &groups() const {
 		return _groups;
 	}
+	[[nodiscard]] SearchIndex &searchIndex() {
+		return _searchIndex;
+	}
+	[[nodiscard]] const SearchIndex &searchIndex() const {
+		return _searchIndex;
+	}
 	[[nodiscard]] ScheduledMessages &scheduledMessages() const {
 		return *_scheduledMessages;
 	}
 	[[nodiscard]] CloudThemes &cloudThemes() const {
-		return *_cloudThemes;
+		return _cloudThemes.get();
+	}
+	[[nodiscard]] CachedHistories &cachedHistories() const {
+		return *_cachedHistories;
+	}
+	[[nodiscard]] WebPagePreviews &webPagePreviews() const {
+		return *_webPagePreviews;
+	}
+	[[nodiscard]] TextLayouts &textLayouts() const {
+		return *_textLayouts;
+	}
+	[[nodiscard]] AnimationPosters &animationPosters() const {
+		return *_animationPosters;
 	}
 	[[nodiscard]] MsgId nextNonHistoryEntryId() {
 		return ++_nonHistoryEntryId;
@@ -204,6 +230,17 @@ public:
 	[[nodiscard]] rpl::producer<not_null<const HistoryItem*>> itemRepaintRequest() const;
 	void requestViewRepaint(not_null<const ViewElement*> view);
 	[[nodiscard]] rpl::producer<not_null<const ViewElement*>> viewRepaintRequest() const;
+
+	// The rect is in the view coordinates, several parts requested
+	// before the next paint are united by the widget update region.
+	struct ViewPartRepaint {
+		not_null<const ViewElement*> view;
+		QRect rect;
+	};
+	void requestViewPartRepaint(
+		not_null<const ViewElement*> view,
+		QRect rect);
+	[[nodiscard]] rpl::producer<ViewPartRepaint> viewPartRepaintRequest() const;
 	void requestItemResize(not_null<const HistoryItem*> item);
 	[[nodiscard]] rpl::producer<not_null<const HistoryItem*>> itemResizeRequest() const;
 	void requestViewResize(not_null<ViewElement*> view);
@@ -301,22 +338,39 @@ public:
 	[[nodiscard]] rpl::producer<int> featuredStickerSetsUnreadCountValue() const {
 		return _featuredStickerSetsUnreadCount.value();
 	}
+
+	// Sticker sets and saved gifs are read from the local storage
+	// on the first access after this call.
+	void allowStickersLoad();
+	[[nodiscard]] bool stickersLoaded() const {
+		return _stickersLoaded;
+	}
+	[[nodiscard]] bool savedGifsLoaded() const {
+		return _savedGifsLoaded;
+	}
+
 	const Stickers::Sets &stickerSets() const {
+		loadStickers();
 		return _stickerSets;
 	}
 	Stickers::Sets &stickerSetsRef() {
+		loadStickers();
 		return _stickerSets;
 	}
 	const Stickers::Order &stickerSetsOrder() const {
+		loadStickers();
 		return _stickerSetsOrder;
 	}
 	Stickers::Order &stickerSetsOrderRef() {
+		loadStickers();
 		return _stickerSetsOrder;
 	}
 	const Stickers::Order &featuredStickerSetsOrder() const {
+		loadStickers();
 		return _featuredStickerSetsOrder;
 	}
 	Stickers::Order &featuredStickerSetsOrderRef() {
+		loadStickers();
 		return _featuredStickerSetsOrder;
 	}
 	const Stickers::Order &archivedStickerSetsOrder() const {
@@ -326,9 +380,11 @@ public:
 		return _archivedStickerSetsOrder;
 	}
 	const Stickers::SavedGifs &savedGifs() const {
+		loadSavedGifs();
 		return _savedGifs;
 	}
 	Stickers::SavedGifs &savedGifsRef() {
+		loadSavedGifs();
 		return _savedGifs;
 	}
 
@@ -448,8 +504,11 @@ public:
 		int height = 0;
 		bool textUpdated = false;
 	};
+	using SendActionAnimationUpdates = std::vector<SendActionAnimationUpdate>;
+
+	// Updates are collected and fired once an animation frame.
 	[[nodiscard]] auto sendActionAnimationUpdated() const
-		-> rpl::producer<SendActionAnimationUpdate>;
+		-> rpl::producer<SendActionAnimationUpdates>;
 	void updateSendActionAnimation(SendActionAnimationUpdate &&update);
 
 	int unreadBadge() const;
@@ -651,6 +710,19 @@ public:
 	RefreshChatListEntryResult refreshChatListEntry(Dialogs::Key key);
 	void removeChatListEntry(Dialogs::Key key);
 
+	// While the result is alive chat list entries only remember if they
+	// should be shown or hidden, the dialogs list is refreshed once for
+	// each entry when the last such guard is destroyed.
+	[[nodiscard]] auto postponeChatListUpdates() {
+		++_chatListUpdatesPostponed;
+		return gsl::finally([=] {
+			if (!--_chatListUpdatesPostponed) {
+				applyPostponedChatListUpdates();
+			}
+		});
+	}
+	bool postponeChatListExistence(Dialogs::Key key, bool exists);
+
 	struct DialogsRowReplacement {
 		not_null<Dialogs::Row*> old;
 		Dialogs::Row *now = nullptr;
@@ -699,7 +771,7 @@ public:
 	void clearLocalStorage();
 
 private:
-	using Messages = std::unordered_map<MsgId, std::unique_ptr<HistoryItem>>;
+	using Messages = MessagesMap;
 
 	void suggestStartExport();
 
@@ -709,6 +781,7 @@ private:
 	void setupUserIsContactViewer();
 
 	void checkSelfDestructItems();
+	void applyPostponedChatListUpdates();
 
 	int computeUnreadBadge(const Dialogs::UnreadState &state) const;
 	bool computeUnreadBadgeMuted(const Dialogs::UnreadState &state) const;
@@ -806,6 +879,9 @@ private:
 		return (lastUpdate == 0)
 			|| (now >= lastUpdate + kStickersUpdateTimeout);
 	}
+	void loadStickers() const;
+	void loadSavedGifs() const;
+
 	void userIsContactUpdated(not_null<UserData*> user);
 
 	void setPinnedFromDialog(const Dialogs::Key &key, bool pinned);
@@ -814,6 +890,10 @@ private:
 	const NotifySettings &defaultNotifySettings(
 		not_null<const PeerData*> peer) const;
 	void unmuteByFinished();
+	void unloadHistoryViews();
+	void sweepUnreferencedMedia();
+	[[nodiscard]] base::memory_usage::Usage itemsMemoryUsage() const;
+	[[nodiscard]] base::memory_usage::Usage peersMemoryUsage() const;
 	void unmuteByFinishedDelayed(crl::time delay);
 	void updateNotifySettingsLocal(not_null<PeerData*> peer);
 
@@ -852,6 +932,7 @@ private:
 	rpl::event_stream<not_null<HistoryItem*>> _unreadItemAdded;
 	rpl::event_stream<not_null<const HistoryItem*>> _itemRepaintRequest;
 	rpl::event_stream<not_null<const ViewElement*>> _viewRepaintRequest;
+	rpl::event_stream<ViewPartRepaint> _viewPartRepaintRequest;
 	rpl::event_stream<not_null<const HistoryItem*>> _itemResizeRequest;
 	rpl::event_stream<not_null<ViewElement*>> _viewResizeRequest;
 	rpl::event_stream<not_null<HistoryItem*>> _itemViewRefreshRequest;
@@ -882,14 +963,19 @@ private:
 	Stickers::Order _featuredStickerSetsOrder;
 	Stickers::Order _archivedStickerSetsOrder;
 	Stickers::SavedGifs _savedGifs;
+	bool _stickersLoadAllowed = false;
+	mutable bool _stickersLoaded = false;
+	mutable bool _savedGifsLoaded = false;
 
 	Dialogs::MainList _chatsList;
+	int _chatListUpdatesPostponed = 0;
+	base::flat_map<Dialogs::Key, bool> _postponedChatListExistence;
 	Dialogs::IndexedList _contactsList;
 	Dialogs::IndexedList _contactsNoChatsList;
 
 	MsgId _localMessageIdCounter = StartClientMsgId;
 	Messages _messages;
-	std::map<ChannelId, Messages> _channelMessages;
+	base::flat_hash_map<ChannelId, std::unique_ptr<Messages>> _channelMessages;
 	std::map<
 		not_null<HistoryItem*>,
 		base::flat_set<not_null<HistoryItem*>>> _dependentMessages;
@@ -977,6 +1063,11 @@ private:
 	rpl::event_stream<> _defaultBroadcastNotifyUpdates;
 	std::unordered_set<not_null<const PeerData*>> _mutedPeers;
 	base::Timer _unmuteByFinishedTimer;
+	base::Timer _unloadViewsTimer;
+
+	// Loaded media without items found by the previous sweep.
+	base::flat_set<not_null<PhotoData*>> _unreferencedPhotos;
+	base::flat_set<not_null<DocumentData*>> _unreferencedDocuments;
 
 	std::unordered_map<PeerId, std::unique_ptr<PeerData>> _peers;
 	std::unordered_map<PeerId, std::unique_ptr<History>> _histories;
@@ -990,16 +1081,27 @@ private:
 
 	rpl::event_stream<> _newAuthorizationChecks;
 
-	rpl::event_stream<SendActionAnimationUpdate> _sendActionAnimationUpdate;
+	base::flat_map<
+		not_null<History*>,
+		SendActionAnimationUpdate> _sendActionAnimationUpdates;
+	rpl::event_stream<SendActionAnimationUpdates> _sendActionAnimationUpdate;
 
 	std::vector<WallPaper> _wallpapers;
 	int32 _wallpapersHash = 0;
 
 	Groups _groups;
+	SearchIndex _searchIndex;
 	std::unique_ptr<ScheduledMessages> _scheduledMessages;
-	std::unique_ptr<CloudThemes> _cloudThemes;
+	const base::lazy_service<CloudThemes> _cloudThemes;
+	std::unique_ptr<CachedHistories> _cachedHistories;
+	std::unique_ptr<WebPagePreviews> _webPagePreviews;
+	std::unique_ptr<TextLayouts> _textLayouts;
+	std::unique_ptr<AnimationPosters> _animationPosters;
 	MsgId _nonHistoryEntryId = ServerMaxMsgId;
 
+	base::memory_usage::Provider _itemsMemory;
+	base::memory_usage::Provider _peersMemory;
+
 	rpl::lifetime _lifetime;
 
 };
@@ -199,19 +199,50 @@ bool SparseIdsSliceBuilder::applyUpdate(
 	if (!needMergeMessages && !update.count) {
 		return false;
 	}
+	if (!needMergeMessages) {
+		mergeSliceData(
+			update.count,
+			base::flat_set<MsgId> {},
+			std::nullopt,
+			std::nullopt);
+		return true;
+	}
+
+	// The updated slice may hold the whole shared media of a huge chat,
+	// while the viewer keeps only its limits around the key. Merge just
+	// the part of the slice that can survive sliceToLimits, so that every
+	// update costs the size of the viewer instead of the size of the slice.
+	const auto &messages = *update.messages;
+	auto from = messages.begin();
+	auto till = messages.end();
+	if (_key) {
+		const auto reserve = int(_ids.size());
+		const auto minId = _ids.empty() ? _key : std::min(_ids.front(), _key);
+		const auto maxId = _ids.empty() ? _key : std::max(_ids.back(), _key);
+		const auto lower = ranges::lower_bound(messages, minId);
+		const auto upper = ranges::upper_bound(messages, maxId);
+		from = lower - std::min(
+			int(lower - messages.begin()),
+			_limitBefore + reserve + 1);
+		till = upper + std::min(
+			int(messages.end() - upper),
+			_limitAfter + reserve + 1);
+	}
 	auto skippedBefore = (update.range.from == 0)
-		? 0
+		? int(from - messages.begin())
 		: std::optional<int> {};
 	auto skippedAfter = (update.range.till == ServerMaxMsgId)
-		? 0
+		? int(messages.end() - till)
 		: std::optional<int> {};
-	mergeSliceData(
-		update.count,
-		needMergeMessages
-			? *update.messages
-			: base::flat_set<MsgId> {},
-		skippedBefore,
-		skippedAfter);
+	if (from == messages.begin() && till == messages.end()) {
+		mergeSliceData(update.count, messages, skippedBefore, skippedAfter);
+	} else {
+		mergeSliceData(
+			update.count,
+			base::flat_set<MsgId>(from, till),
+			skippedBefore,
+			skippedAfter);
+	}
 	return true;
 }
 
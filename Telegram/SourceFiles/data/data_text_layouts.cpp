@@ -0,0 +1,101 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "data/data_text_layouts.h"
+
+#include "data/data_session.h"
+#include "history/history_item.h"
+#include "ui/text/text.h"
+
+namespace Data {
+namespace {
+
+// Shorter texts are broken into lines faster than they are copied.
+constexpr auto kMinTextLength = 512;
+
+} // namespace
+
+struct TextLayouts::Request {
+	not_null<const HistoryItem*> item;
+	uint64 token = 0;
+	Ui::Text::String text;
+	int width = 0;
+	int height = 0;
+};
+
+TextLayouts::TextLayouts(not_null<Session*> owner) : _owner(owner) {
+	_owner->itemRemoved(
+	) | rpl::start_with_next([=](not_null<const HistoryItem*> item) {
+		cancel(item);
+	}, _lifetime);
+}
+
+TextLayouts::~TextLayouts() = default;
+
+bool TextLayouts::Worthy(const Ui::Text::String &text) {
+	return (text.length() >= kMinTextLength);
+}
+
+int TextLayouts::EstimateHeight(const Ui::Text::String &text, int width) {
+	Expects(width > 0);
+
+	// The natural layout stretched to the width, area is preserved.
+	const auto natural = int64(text.maxWidth()) * text.minHeight();
+	return std::max(int((natural + width - 1) / width), text.minHeight());
+}
+
+void TextLayouts::enqueue(
+		not_null<const HistoryItem*> item,
+		const Ui::Text::String &text,
+		int width,
+		Fn<void(int height)> done) {
+	const auto token = ++_token;
+	_pending[item] = Pending{ token, std::move(done) };
+	_queued.push_back({ item, token, text, width });
+	if (!_sendScheduled) {
+		_sendScheduled = true;
+		crl::on_main(this, [=] { send(); });
+	}
+}
+
+void TextLayouts::cancel(not_null<const HistoryItem*> item) {
+	_pending.remove(item);
+}
+
+void TextLayouts::send() {
+	_sendScheduled = false;
+	crl::async([
+		weak = base::make_weak(this),
+		requests = base::take(_queued)
+	]() mutable {
+		for (auto &request : requests) {
+			request.height = request.text.countHeight(request.width);
+		}
+		crl::on_main([
+			weak,
+			requests = std::move(requests)
+		]() mutable {
+			if (const auto strong = weak.get()) {
+				strong->apply(std::move(requests));
+			}
+		});
+	});
+}
+
+void TextLayouts::apply(std::vector<Request> &&requests) {
+	for (const auto &request : requests) {
+		const auto i = _pending.find(request.item);
+		if (i == end(_pending) || i->second.token != request.token) {
+			continue;
+		}
+		const auto done = std::move(i->second.done);
+		_pending.erase(i);
+		done(request.height);
+	}
+}
+
+} // namespace Data
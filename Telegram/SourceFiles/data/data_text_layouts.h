@@ -0,0 +1,70 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/weak_ptr.h"
+
+class HistoryItem;
+
+namespace Ui {
+namespace Text {
+class String;
+} // namespace Text
+} // namespace Ui
+
+namespace Data {
+
+class Session;
+
+// Breaks long message texts into lines on a worker thread.
+//
+// The parsed text is copied, so the worker reads only its own blocks
+// and the integer metrics of the fonts. The result is passed back on
+// the main thread, where the copy is destroyed as well.
+class TextLayouts final : public base::has_weak_ptr {
+public:
+	explicit TextLayouts(not_null<Session*> owner);
+	TextLayouts(const TextLayouts &other) = delete;
+	TextLayouts &operator=(const TextLayouts &other) = delete;
+	~TextLayouts();
+
+	[[nodiscard]] static bool Worthy(const Ui::Text::String &text);
+	[[nodiscard]] static int EstimateHeight(
+		const Ui::Text::String &text,
+		int width);
+
+	// The callback is not called if the item is destroyed or if
+	// the request was cancelled or replaced by a newer one in between.
+	void enqueue(
+		not_null<const HistoryItem*> item,
+		const Ui::Text::String &text,
+		int width,
+		Fn<void(int height)> done);
+	void cancel(not_null<const HistoryItem*> item);
+
+private:
+	struct Request;
+	struct Pending {
+		uint64 token = 0;
+		Fn<void(int height)> done;
+	};
+
+	void send();
+	void apply(std::vector<Request> &&requests);
+
+	const not_null<Session*> _owner;
+	std::vector<Request> _queued;
+	base::flat_map<not_null<const HistoryItem*>, Pending> _pending;
+	uint64 _token = 0;
+	bool _sendScheduled = false;
+
+	rpl::lifetime _lifetime;
+
+};
+
+} // namespace Data
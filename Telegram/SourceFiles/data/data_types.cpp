@@ -31,6 +31,29 @@ constexpr auto kUrlCacheTag = 0x0000030000000000ULL;
 constexpr auto kUrlCacheMask = 0x000000FFFFFFFFFFULL;
 constexpr auto kGeoPointCacheTag = 0x0000040000000000ULL;
 constexpr auto kGeoPointCacheMask = 0x000000FFFFFFFFFFULL;
+constexpr auto kHistoryCacheTag = 0x0000050000000000ULL;
+constexpr auto kPosterCacheTag = 0x0000060000000000ULL;
+constexpr auto kScheduledCacheTag = 0x0000070000000000ULL;
+constexpr auto kParticipantsCacheTag = 0x0000080000000000ULL;
+constexpr auto kWebPagePreviewCacheTag = 0x0000090000000000ULL;
+
+Storage::Cache::Key UrlHashCacheKey(uint64 tag, const QString &location) {
+	const auto url = location.toUtf8();
+	const auto hash = openssl::Sha256(bytes::make_span(url));
+	const auto bytes = bytes::make_span(hash);
+	const auto bytes1 = bytes.subspan(0, sizeof(uint32));
+	const auto bytes2 = bytes.subspan(sizeof(uint32), sizeof(uint64));
+	const auto bytes3 = bytes.subspan(
+		sizeof(uint32) + sizeof(uint64),
+		sizeof(uint16));
+	const auto part1 = *reinterpret_cast<const uint32*>(bytes1.data());
+	const auto part2 = *reinterpret_cast<const uint64*>(bytes2.data());
+	const auto part3 = *reinterpret_cast<const uint16*>(bytes3.data());
+	return Storage::Cache::Key{
+		tag | (uint64(part3) << 32) | part1,
+		part2
+	};
+}
 
 } // namespace
 
@@ -80,21 +103,11 @@ Storage::Cache::Key WebDocumentCacheKey(const WebFileLocation &location) {
 }
 
 Storage::Cache::Key UrlCacheKey(const QString &location) {
-	const auto url = location.toUtf8();
-	const auto hash = openssl::Sha256(bytes::make_span(url));
-	const auto bytes = bytes::make_span(hash);
-	const auto bytes1 = bytes.subspan(0, sizeof(uint32));
-	const auto bytes2 = bytes.subspan(sizeof(uint32), sizeof(uint64));
-	const auto bytes3 = bytes.subspan(
-		sizeof(uint32) + sizeof(uint64),
-		sizeof(uint16));
-	const auto part1 = *reinterpret_cast<const uint32*>(bytes1.data());
-	const auto part2 = *reinterpret_cast<const uint64*>(bytes2.data());
-	const auto part3 = *reinterpret_cast<const uint16*>(bytes3.data());
-	return Storage::Cache::Key{
-		Data::kUrlCacheTag | (uint64(part3) << 32) | part1,
-		part2
-	};
+	return UrlHashCacheKey(Data::kUrlCacheTag, location);
+}
+
+Storage::Cache::Key WebPagePreviewCacheKey(const QString &links) {
+	return UrlHashCacheKey(Data::kWebPagePreviewCacheTag, links);
 }
 
 Storage::Cache::Key GeoPointCacheKey(const GeoPointLocation &location) {
@@ -109,6 +122,34 @@ Storage::Cache::Key GeoPointCacheKey(const GeoPointLocation &location) {
 	};
 }
 
+Storage::Cache::Key HistoryCacheKey(uint64 peerId) {
+	return Storage::Cache::Key{ Data::kHistoryCacheTag, peerId };
+}
+
+Storage::Cache::Key ScheduledCacheKey(uint64 peerId) {
+	return Storage::Cache::Key{ Data::kScheduledCacheTag, peerId };
+}
+
+Storage::Cache::Key ParticipantsCacheKey(uint64 peerId, uint8 list) {
+	return Storage::Cache::Key{
+		Data::kParticipantsCacheTag | uint64(list),
+		peerId,
+	};
+}
+
+Storage::Cache::Key AnimationPosterCacheKey(
+		uint64 documentId,
+		QSize size,
+		uint8 options) {
+	return Storage::Cache::Key{
+		Data::kPosterCacheTag
+			| (uint64(options) << 32)
+			| (uint64(size.width() & 0xFFFF) << 16)
+			| uint64(size.height() & 0xFFFF),
+		documentId,
+	};
+}
+
 ReplyPreview::ReplyPreview() = default;
 
 ReplyPreview::ReplyPreview(ReplyPreview &&other) = default;
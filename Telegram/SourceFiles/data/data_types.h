@@ -46,13 +46,23 @@ Storage::Cache::Key DocumentCacheKey(int32 dcId, uint64 id);
 Storage::Cache::Key DocumentThumbCacheKey(int32 dcId, uint64 id);
 Storage::Cache::Key WebDocumentCacheKey(const WebFileLocation &location);
 Storage::Cache::Key UrlCacheKey(const QString &location);
+Storage::Cache::Key WebPagePreviewCacheKey(const QString &links);
 Storage::Cache::Key GeoPointCacheKey(const GeoPointLocation &location);
+Storage::Cache::Key HistoryCacheKey(uint64 peerId);
+Storage::Cache::Key ScheduledCacheKey(uint64 peerId);
+Storage::Cache::Key ParticipantsCacheKey(uint64 peerId, uint8 list);
+Storage::Cache::Key AnimationPosterCacheKey(
+	uint64 documentId,
+	QSize size,
+	uint8 options);
 
 constexpr auto kImageCacheTag = uint8(0x01);
 constexpr auto kStickerCacheTag = uint8(0x02);
 constexpr auto kVoiceMessageCacheTag = uint8(0x03);
 constexpr auto kVideoMessageCacheTag = uint8(0x04);
 constexpr auto kAnimationCacheTag = uint8(0x05);
+constexpr auto kHistorySliceCacheTag = uint8(0x06);
+constexpr auto kAnimationPosterCacheTag = uint8(0x07);
 
 struct FileOrigin;
 
@@ -204,11 +204,18 @@ void UserData::setBotInfo(const MTPBotInfo &info) {
 void UserData::setNameOrPhone(const QString &newNameOrPhone) {
 	if (nameOrPhone != newNameOrPhone) {
 		nameOrPhone = newNameOrPhone;
-		phoneText.setText(
+		_phoneText.clear();
+	}
+}
+
+const Ui::Text::String &UserData::phoneText() const {
+	if (_phoneText.isEmpty() && !nameOrPhone.isEmpty()) {
+		_phoneText.setText(
 			st::msgNameStyle,
 			nameOrPhone,
 			Ui::NameTextOptions());
 	}
+	return _phoneText;
 }
 
 void UserData::madeAction(TimeId when) {
@@ -164,7 +164,7 @@ public:
 		return _phone;
 	}
 	QString nameOrPhone;
-	Ui::Text::String phoneText;
+	[[nodiscard]] const Ui::Text::String &phoneText() const;
 	TimeId onlineTill = 0;
 
 	enum class ContactStatus : char {
@@ -221,6 +221,7 @@ private:
 
 	QString _unavailableReason;
 	QString _phone;
+	mutable Ui::Text::String _phoneText;
 	ContactStatus _contactStatus = ContactStatus::Unknown;
 	BlockStatus _blockStatus = BlockStatus::Unknown;
 	CallsStatus _callsStatus = CallsStatus::Unknown;
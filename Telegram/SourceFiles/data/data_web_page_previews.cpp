@@ -0,0 +1,198 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "data/data_web_page_previews.h"
+
+#include "data/data_session.h"
+#include "data/data_web_page.h"
+#include "main/main_session.h"
+#include "base/unixtime.h"
+#include "apiwrap.h"
+#include "storage/cache/storage_cache_database.h"
+#include "core/version.h"
+
+namespace Data {
+namespace {
+
+constexpr auto kMaxEntries = 256;
+constexpr auto kStoredLifetime = TimeId(24 * 60 * 60);
+
+[[nodiscard]] bool Expired(TimeId received) {
+	return (received + kStoredLifetime <= base::unixtime::now());
+}
+
+// Only resolved pages and empty results are stored, pending ones change.
+[[nodiscard]] bool ShouldStore(const MTPMessageMedia &result) {
+	return result.match([](const MTPDmessageMediaWebPage &data) {
+		return (data.vwebpage().type() == mtpc_webPage)
+			|| (data.vwebpage().type() == mtpc_webPageEmpty);
+	}, [](const MTPDmessageMediaEmpty &) {
+		return true;
+	}, [](const auto &) {
+		return false;
+	});
+}
+
+[[nodiscard]] QByteArray Serialize(
+		const MTPMessageMedia &result,
+		TimeId received) {
+	auto buffer = mtpBuffer();
+	buffer.push_back(mtpPrime(AppVersion));
+	buffer.push_back(mtpPrime(received));
+	result.write(buffer);
+	return QByteArray(
+		reinterpret_cast<const char*>(buffer.constData()),
+		buffer.size() * sizeof(mtpPrime));
+}
+
+[[nodiscard]] std::optional<std::pair<MTPMessageMedia, TimeId>> Deserialize(
+		const QByteArray &serialized) {
+	if (serialized.size() % sizeof(mtpPrime)) {
+		return std::nullopt;
+	}
+	auto from = reinterpret_cast<const mtpPrime*>(serialized.constData());
+	const auto till = from + serialized.size() / sizeof(mtpPrime);
+	if (till - from < 2 || *from++ != mtpPrime(AppVersion)) {
+		return std::nullopt;
+	}
+	const auto received = TimeId(*from++);
+	auto result = MTPMessageMedia();
+	if (!result.read(from, till) || from != till) {
+		return std::nullopt;
+	}
+	return std::make_pair(std::move(result), received);
+}
+
+} // namespace
+
+WebPagePreviews::WebPagePreviews(not_null<Session*> owner)
+: _owner(owner) {
+}
+
+std::optional<WebPageData*> WebPagePreviews::lookup(
+		const QString &links) const {
+	const auto i = _entries.find(links);
+	if (i == end(_entries) || Expired(i->second.received)) {
+		return std::nullopt;
+	}
+	i->second.used = ++_used;
+	return i->second.id ? _owner->webpage(i->second.id).get() : nullptr;
+}
+
+void WebPagePreviews::request(
+		const QString &links,
+		Fn<void(WebPageData*)> done,
+		bool reload) {
+	auto &waiting = _waiting[links];
+	waiting.push_back(std::move(done));
+	if (waiting.size() > 1) {
+		return;
+	} else if (reload) {
+		send(links);
+		return;
+	}
+	_owner->cache().get(
+		WebPagePreviewCacheKey(links),
+		[=](QByteArray &&serialized) {
+			crl::on_main(&_owner->session(), [=] {
+				applyStored(links, serialized);
+			});
+		});
+}
+
+void WebPagePreviews::applyStored(
+		const QString &links,
+		const QByteArray &serialized) {
+	if (!_waiting.contains(links)) {
+		return;
+	}
+	const auto stored = serialized.isEmpty()
+		? std::nullopt
+		: Deserialize(serialized);
+	if (!stored || Expired(stored->second)) {
+		if (!serialized.isEmpty()) {
+			_owner->cache().remove(WebPagePreviewCacheKey(links));
+		}
+		send(links);
+		return;
+	}
+	apply(links, stored->first, stored->second);
+}
+
+void WebPagePreviews::send(const QString &links) {
+	_owner->session().api().request(MTPmessages_GetWebPagePreview(
+		MTP_flags(0),
+		MTP_string(links),
+		MTPVector<MTPMessageEntity>()
+	)).done([=](const MTPMessageMedia &result) {
+		if (ShouldStore(result)) {
+			store(links, result);
+		}
+		apply(links, result, base::unixtime::now());
+	}).fail([=](const RPCError &error) {
+		_waiting.remove(links);
+	}).send();
+}
+
+void WebPagePreviews::apply(
+		const QString &links,
+		const MTPMessageMedia &result,
+		TimeId received) {
+	result.match([&](const MTPDmessageMediaWebPage &data) {
+		const auto page = _owner->processWebpage(data.vwebpage());
+		if (page->pendingTill > 0
+			&& page->pendingTill <= base::unixtime::now()) {
+			page->pendingTill = -1;
+		}
+		remember(links, page->id, received);
+		_owner->sendWebPageGamePollNotifications();
+		finish(links, page);
+	}, [&](const MTPDmessageMediaEmpty &) {
+		remember(links, 0, received);
+		finish(links, nullptr);
+	}, [&](const auto &) {
+		finish(links, nullptr);
+	});
+}
+
+void WebPagePreviews::store(
+		const QString &links,
+		const MTPMessageMedia &result) {
+	_owner->cache().put(
+		WebPagePreviewCacheKey(links),
+		Storage::Cache::Database::TaggedValue(
+			Serialize(result, base::unixtime::now()),
+			kHistorySliceCacheTag));
+}
+
+void WebPagePreviews::remember(
+		const QString &links,
+		WebPageId id,
+		TimeId received) {
+	_entries[links] = Entry{ id, received, ++_used };
+	if (int(_entries.size()) > kMaxEntries) {
+		const auto oldest = ranges::min_element(
+			_entries,
+			std::less<>(),
+			[](const auto &pair) { return pair.second.used; });
+		_entries.erase(oldest);
+	}
+}
+
+void WebPagePreviews::finish(const QString &links, WebPageData *page) {
+	const auto i = _waiting.find(links);
+	if (i == end(_waiting)) {
+		return;
+	}
+	const auto callbacks = std::move(i->second);
+	_waiting.erase(i);
+	for (const auto &callback : callbacks) {
+		callback(page);
+	}
+}
+
+} // namespace Data
@@ -0,0 +1,61 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+class WebPageData;
+
+namespace Data {
+
+class Session;
+
+// Remembers messages.getWebPagePreview results by the links text, in
+// memory and in the encrypted media cache database, so that typing the
+// same links again or after a restart doesn't request the preview.
+class WebPagePreviews final {
+public:
+	explicit WebPagePreviews(not_null<Session*> owner);
+	WebPagePreviews(const WebPagePreviews &other) = delete;
+	WebPagePreviews &operator=(const WebPagePreviews &other) = delete;
+
+	// Empty if unknown, nullptr if the links don't have a preview.
+	[[nodiscard]] std::optional<WebPageData*> lookup(
+		const QString &links) const;
+
+	// Requests for the same links wait for the same answer, done is not
+	// called if the request fails. With reload the stored result is
+	// skipped, for example for a pending web page.
+	void request(
+		const QString &links,
+		Fn<void(WebPageData*)> done,
+		bool reload = false);
+
+private:
+	struct Entry {
+		WebPageId id = 0;
+		TimeId received = 0;
+		uint64 used = 0;
+	};
+
+	void send(const QString &links);
+	void apply(
+		const QString &links,
+		const MTPMessageMedia &result,
+		TimeId received);
+	void applyStored(const QString &links, const QByteArray &serialized);
+	void store(const QString &links, const MTPMessageMedia &result);
+	void remember(const QString &links, WebPageId id, TimeId received);
+	void finish(const QString &links, WebPageData *page);
+
+	const not_null<Session*> _owner;
+	mutable base::flat_map<QString, Entry> _entries;
+	mutable uint64 _used = 0;
+	base::flat_map<QString, std::vector<Fn<void(WebPageData*)>>> _waiting;
+
+};
+
+} // namespace Data
@@ -114,6 +114,12 @@ void Entry::notifyUnreadStateChange(const UnreadState &wasState) {
 }
 
 void Entry::setChatListExistence(bool exists) {
+	if (!owner().postponeChatListExistence(_key, exists)) {
+		applyChatListExistence(exists);
+	}
+}
+
+void Entry::applyChatListExistence(bool exists) {
 	if (const auto main = App::main()) {
 		if (exists && _sortKeyInChatList) {
 			main->refreshDialog(_key);
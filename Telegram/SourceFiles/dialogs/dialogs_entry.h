@@ -124,6 +124,7 @@ public:
 	void updateChatListSortPosition();
 	void setChatListTimeId(TimeId date);
 	virtual void updateChatListExistence();
+	void applyChatListExistence(bool exists);
 	bool needUpdateInChatList() const;
 	virtual TimeId adjustedChatListTimeId() const;
 
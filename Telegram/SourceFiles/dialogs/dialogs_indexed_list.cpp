@@ -23,6 +23,7 @@ RowsByLetter IndexedList::addToEnd(Key key) {
 	RowsByLetter result;
 	if (!_list.contains(key)) {
 		result.emplace(0, _list.addToEnd(key));
+		indexWords(key);
 		for (const auto ch : key.entry()->chatListFirstLetters()) {
 			auto j = _index.find(ch);
 			if (j == _index.cend()) {
@@ -40,6 +41,7 @@ Row *IndexedList::addByName(Key key) {
 	}
 
 	const auto result = _list.addByName(key);
+	indexWords(key);
 	for (const auto ch : key.entry()->chatListFirstLetters()) {
 		auto j = _index.find(ch);
 		if (j == _index.cend()) {
@@ -119,6 +121,9 @@ void IndexedList::adjustByName(
 	const auto mainRow = _list.adjustByName(key);
 	if (!mainRow) return;
 
+	unindexWords(key);
+	indexWords(key);
+
 	auto toRemove = oldLetters;
 	auto toAdd = base::flat_set<QChar>();
 	for (const auto ch : key.entry()->chatListFirstLetters()) {
@@ -156,6 +161,9 @@ void IndexedList::adjustNames(
 	auto mainRow = _list.getRow(key);
 	if (!mainRow) return;
 
+	unindexWords(key);
+	indexWords(key);
+
 	auto toRemove = oldLetters;
 	auto toAdd = base::flat_set<QChar>();
 	for (const auto ch : key.entry()->chatListFirstLetters()) {
@@ -188,6 +196,7 @@ void IndexedList::adjustNames(
 
 void IndexedList::del(Key key, Row *replacedBy) {
 	if (_list.del(key, replacedBy)) {
+		unindexWords(key);
 		for (const auto ch : key.entry()->chatListFirstLetters()) {
 			if (auto it = _index.find(ch); it != _index.cend()) {
 				it->second.del(key, replacedBy);
@@ -198,55 +207,90 @@ void IndexedList::del(Key key, Row *replacedBy) {
 
 void IndexedList::clear() {
 	_index.clear();
+	_words.clear();
+	_wordsByKey.clear();
+}
+
+void IndexedList::indexWords(Key key) {
+	const auto &words = key.entry()->chatListNameWords();
+	if (words.empty()) {
+		return;
+	}
+	for (const auto &word : words) {
+		_words[word].emplace(key);
+	}
+	_wordsByKey.emplace(key, words);
+}
+
+void IndexedList::unindexWords(Key key) {
+	const auto i = _wordsByKey.find(key);
+	if (i == _wordsByKey.end()) {
+		return;
+	}
+	for (const auto &word : i->second) {
+		const auto j = _words.find(word);
+		if (j != _words.end()) {
+			j->second.remove(key);
+			if (j->second.empty()) {
+				_words.erase(j);
+			}
+		}
+	}
+	_wordsByKey.erase(i);
+}
+
+bool IndexedList::hasWordWithPrefix(Key key, const QString &prefix) const {
+	const auto i = _wordsByKey.find(key);
+	if (i == _wordsByKey.end()) {
+		return false;
+	}
+
+	// Words starting with the prefix come right after it when sorted.
+	const auto &words = i->second;
+	const auto j = std::lower_bound(begin(words), end(words), prefix);
+	return (j != end(words)) && j->startsWith(prefix);
 }
 
 std::vector<not_null<Row*>> IndexedList::filtered(
 		const QStringList &words) const {
-	const auto minimal = [&]() -> const Dialogs::List* {
-		if (empty()) {
-			return nullptr;
+	auto longest = QString();
+	for (const auto &word : words) {
+		if (word.size() > longest.size()) {
+			longest = word;
 		}
-		auto result = (const Dialogs::List*)nullptr;
-		for (const auto &word : words) {
-			if (word.isEmpty()) {
-				continue;
-			}
-			const auto found = filtered(word[0]);
-			if (!found || found->empty()) {
-				return nullptr;
-			} else if (!result || result->size() > found->size()) {
-				result = found;
-			}
-		}
-		return result;
-	}();
+	}
 	auto result = std::vector<not_null<Row*>>();
-	if (!minimal || minimal->empty()) {
+	if (longest.isEmpty()) {
 		return result;
 	}
-	result.reserve(minimal->size());
-	for (const auto row : *minimal) {
-		const auto &nameWords = row->entry()->chatListNameWords();
-		const auto found = [&](const QString &word) {
-			for (const auto &name : nameWords) {
-				if (name.startsWith(word)) {
-					return true;
-				}
-			}
-			return false;
-		};
-		const auto allFound = [&] {
-			for (const auto &word : words) {
-				if (!found(word)) {
-					return false;
-				}
+
+	// Take the candidates from the longest word, it usually matches
+	// the smallest amount of rows, and check the other words for them.
+	for (auto i = _words.lower_bound(longest); i != _words.end(); ++i) {
+		if (!i->first.startsWith(longest)) {
+			break;
+		}
+		for (const auto &key : i->second) {
+			if (const auto row = _list.getRow(key)) {
+				result.push_back(row);
 			}
-			return true;
-		}();
-		if (allFound) {
-			result.push_back(row);
 		}
 	}
+	ranges::sort(result);
+	result.erase(ranges::unique(result), result.end());
+
+	const auto missing = [&](not_null<Row*> row) {
+		for (const auto &word : words) {
+			if (!word.isEmpty()
+				&& word != longest
+				&& !hasWordWithPrefix(row->key(), word)) {
+				return true;
+			}
+		}
+		return false;
+	};
+	result.erase(ranges::remove_if(result, missing), result.end());
+	ranges::sort(result, std::less<>(), &Row::pos);
 	return result;
 }
 
@@ -47,6 +47,9 @@ public:
 		const auto i = _index.find(ch);
 		return (i != _index.end()) ? &i->second : nullptr;
 	}
+
+	// Rows of all() that have a name word starting with each of the words,
+	// in the order of all().
 	std::vector<not_null<Row*>> filtered(const QStringList &words) const;
 
 	~IndexedList();
@@ -81,11 +84,22 @@ private:
 		Mode list,
 		not_null<History*> history,
 		const base::flat_set<QChar> &oldChars);
+	void indexWords(Key key);
+	void unindexWords(Key key);
+	[[nodiscard]] bool hasWordWithPrefix(
+		Key key,
+		const QString &prefix) const;
 
 	SortMode _sortMode = SortMode();
 	List _list, _empty;
 	base::flat_map<QChar, List> _index;
 
+	// Name words of all the rows, sorted for the prefix lookups.
+	// The indexed words of each row are kept to unindex them later,
+	// because the entry already has the new ones when its name changes.
+	std::map<QString, base::flat_set<Key>> _words;
+	std::map<Key, base::flat_set<QString>> _wordsByKey;
+
 };
 
 } // namespace Dialogs
@@ -9,16 +9,19 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "dialogs/dialogs_indexed_list.h"
 #include "dialogs/dialogs_layout.h"
+#include "dialogs/dialogs_row_cache.h"
 #include "dialogs/dialogs_widget.h"
 #include "dialogs/dialogs_search_from_controllers.h"
 //#include "history/feed/history_feed_section.h" // #feed
 #include "history/history.h"
 #include "history/history_item.h"
 #include "core/shortcuts.h"
+#include "core/core_startup_timeline.h"
 #include "ui/widgets/buttons.h"
 #include "ui/widgets/popup_menu.h"
 #include "ui/text_options.h"
 #include "ui/ui_utility.h"
+#include "data/data_cached_histories.h"
 #include "data/data_drafts.h"
 #include "data/data_folder.h"
 #include "data/data_session.h"
@@ -31,6 +34,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mainwindow.h"
 #include "mainwidget.h"
 #include "storage/localstorage.h"
+#include "storage/file_download.h"
 #include "apiwrap.h"
 #include "window/themes/window_theme.h"
 #include "observer_peer.h"
@@ -52,6 +56,7 @@ namespace {
 
 constexpr auto kHashtagResultsLimit = 5;
 constexpr auto kStartReorderThreshold = 30;
+constexpr auto kPreloadSelectedDelay = crl::time(300);
 
 int FixedOnTopDialogsCount(not_null<Dialogs::IndexedList*> list) {
 	auto result = 0;
@@ -109,6 +114,8 @@ InnerWidget::InnerWidget(
 , _pinnedShiftAnimation([=](crl::time now) {
 	return pinnedShiftAnimationCallback(now);
 })
+, _rowCache(std::make_unique<RowCache>())
+, _preloadSelectedTimer([=] { preloadSelected(); })
 , _addContactLnk(this, tr::lng_add_contact_button(tr::now))
 , _cancelSearchInChat(this, st::dialogsCancelSearchInPeer)
 , _cancelSearchFromUser(this, st::dialogsCancelSearchInPeer) {
@@ -169,17 +176,19 @@ InnerWidget::InnerWidget(
 
 	session().data().sendActionAnimationUpdated(
 	) | rpl::start_with_next([=](
-			const Data::Session::SendActionAnimationUpdate &update) {
+			const Data::Session::SendActionAnimationUpdates &updates) {
 		using RowPainter = Layout::RowPainter;
-		const auto updateRect = RowPainter::sendActionAnimationRect(
-			update.width,
-			update.height,
-			width(),
-			update.textUpdated);
-		updateDialogRow(
-			RowDescriptor(update.history, FullMsgId()),
-			updateRect,
-			UpdateRowSection::Default | UpdateRowSection::Filtered);
+		for (const auto &update : updates) {
+			const auto updateRect = RowPainter::sendActionAnimationRect(
+				update.width,
+				update.height,
+				width(),
+				update.textUpdated);
+			updateDialogRow(
+				RowDescriptor(update.history, FullMsgId()),
+				updateRect,
+				UpdateRowSection::Default | UpdateRowSection::Filtered);
+		}
 	}, lifetime());
 
 	setupOnlineStatusCheck();
@@ -218,6 +227,13 @@ InnerWidget::InnerWidget(
 		if (update.flags & UpdateFlag::ChatPinnedChanged) {
 			stopReorderPinned();
 		}
+		if (update.flags & (UpdateFlag::NameChanged
+			| UpdateFlag::PhotoChanged
+			| UpdateFlag::UserOccupiedChanged)) {
+			if (const auto history = session().data().historyLoaded(update.peer)) {
+				_rowCache->invalidate(history);
+			}
+		}
 		if (update.flags & UpdateFlag::NameChanged) {
 			this->update();
 		}
@@ -379,6 +395,10 @@ void InnerWidget::changeOpenedFolder(Data::Folder *folder) {
 }
 
 void InnerWidget::paintEvent(QPaintEvent *e) {
+	const auto frame = Core::StartupFrame("dialogs paint");
+	const auto overlay = _frameTimes.measure(this, e->rect());
+	Core::StartupMilestone("dialogs painted");
+
 	Painter p(this);
 
 	const auto r = e->rect();
@@ -425,7 +445,7 @@ void InnerWidget::paintEvent(QPaintEvent *e) {
 				}
 				const auto isActive = (row->key() == active);
 				const auto isSelected = (row->key() == selected);
-				Layout::RowPainter::paint(
+				_rowCache->paint(
 					p,
 					row,
 					fullWidth,
@@ -550,7 +570,7 @@ void InnerWidget::paintEvent(QPaintEvent *e) {
 						: (from == (isPressed()
 							? _filteredPressed
 							: _filteredSelected));
-					Layout::RowPainter::paint(
+					_rowCache->paint(
 						p,
 						_filterResults[from],
 						fullWidth,
@@ -953,6 +973,7 @@ void InnerWidget::selectByMouse(QPoint globalPosition) {
 			_selected = selected;
 			_collapsedSelected = collapsedSelected;
 			updateSelectedRow();
+			schedulePreloadSelected();
 			setCursor((_selected || _collapsedSelected)
 				? style::cur_pointer
 				: style::cur_default);
@@ -1512,6 +1533,7 @@ int InnerWidget::defaultRowTop(not_null<Row*> row) const {
 void InnerWidget::repaintDialogRow(
 		Mode list,
 		not_null<Row*> row) {
+	_rowCache->invalidate(row->key());
 	if (_state == WidgetState::Default) {
 		if (_mode == list) {
 			if (const auto folder = row->folder()) {
@@ -1573,6 +1595,8 @@ void InnerWidget::updateDialogRow(
 		}
 	}
 
+	_rowCache->invalidate(row.key);
+
 	const auto updateRow = [&](int rowTop) {
 		rtlupdate(
 			updateRect.x(),
@@ -1895,6 +1919,7 @@ InnerWidget::~InnerWidget() {
 void InnerWidget::clearSearchResults(bool clearPeerSearchResults) {
 	if (clearPeerSearchResults) _peerSearchResults.clear();
 	_searchResults.clear();
+	_searchResultsLocal = false;
 	_searchedCount = _searchedMigratedCount = 0;
 	_lastSearchDate = 0;
 	_lastSearchPeer = nullptr;
@@ -2078,6 +2103,26 @@ bool InnerWidget::searchReceived(
 	return lastDateFound != 0;
 }
 
+void InnerWidget::searchLocalReceived(
+		const std::vector<not_null<HistoryItem*>> &items) {
+	if (!_waitingForSearch && !_searchResultsLocal) {
+		return;
+	}
+
+	// Shown until the server results for the same query replace them.
+	clearSearchResults(false);
+	const auto uniquePeers = uniqueSearchResults();
+	for (const auto item : items) {
+		if (!uniquePeers || !hasHistoryInResults(item->history())) {
+			_searchResults.push_back(
+				std::make_unique<FakeRow>(_searchInChat, item));
+		}
+	}
+	_searchResultsLocal = true;
+	_searchedCount = int(_searchResults.size());
+	refresh();
+}
+
 void InnerWidget::peerSearchReceived(
 		const QString &query,
 		const QVector<MTPPeer> &my,
@@ -2342,6 +2387,7 @@ void InnerWidget::selectSkip(int32 direction) {
 				: (dialogsOffset() + _selected->pos() * st::dialogsRowHeight);
 			emit mustScrollTo(fromY, fromY + st::dialogsRowHeight);
 		}
+		schedulePreloadSelected();
 	} else if (_state == WidgetState::Filtered) {
 		if (_hashtagResults.empty() && _filterResults.empty() && _peerSearchResults.empty() && _searchResults.empty()) {
 			return;
@@ -2453,12 +2499,29 @@ void InnerWidget::selectSkipPage(int32 pixels, int32 direction) {
 				: (dialogsOffset() + _selected->pos() * st::dialogsRowHeight);
 			emit mustScrollTo(fromY, fromY + st::dialogsRowHeight);
 		}
+		schedulePreloadSelected();
 	} else {
 		return selectSkip(direction * toSkip);
 	}
 	update();
 }
 
+void InnerWidget::schedulePreloadSelected() {
+	if (_selected && _selected->history()) {
+		_preloadSelectedTimer.callOnce(kPreloadSelectedDelay);
+	} else {
+		_preloadSelectedTimer.cancel();
+	}
+}
+
+void InnerWidget::preloadSelected() {
+	if (_state != WidgetState::Default || !_selected) {
+		return;
+	} else if (const auto history = _selected->history()) {
+		session().data().cachedHistories().request(history);
+	}
+}
+
 void InnerWidget::loadPeerPhotos() {
 	if (!parentWidget()) return;
 
@@ -2469,9 +2532,15 @@ void InnerWidget::loadPeerPhotos() {
 		auto otherStart = shownDialogs()->size() * st::dialogsRowHeight;
 		if (yFrom < otherStart) {
 			for (auto i = shownDialogs()->cfind(yFrom, st::dialogsRowHeight), end = shownDialogs()->cend(); i != end; ++i) {
-				if (((*i)->pos() * st::dialogsRowHeight) >= yTo) {
+				const auto top = (*i)->pos() * st::dialogsRowHeight;
+				if (top >= yTo) {
 					break;
 				}
+				const auto priority = Storage::LoadPriorityScope(
+					&session().downloader(),
+					((top < _visibleBottom)
+						? Storage::LoadPriority::Visible
+						: Storage::LoadPriority::NearViewport));
 				(*i)->entry()->loadUserpic();
 			}
 			yFrom = 0;
@@ -12,7 +12,9 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "ui/effects/animations.h"
 #include "ui/rp_widget.h"
 #include "base/flags.h"
+#include "base/timer.h"
 #include "base/object_ptr.h"
+#include "core/core_jank.h"
 
 namespace Main {
 class Session;
@@ -37,6 +39,7 @@ namespace Dialogs {
 class Row;
 class FakeRow;
 class IndexedList;
+class RowCache;
 enum class Mode;
 
 struct ChosenRow {
@@ -75,6 +78,11 @@ public:
 		HistoryItem *inject,
 		SearchRequestType type,
 		int fullCount);
+	void searchLocalReceived(
+		const std::vector<not_null<HistoryItem*>> &items);
+	[[nodiscard]] bool hasLocalSearchResults() const {
+		return _searchResultsLocal;
+	}
 	void peerSearchReceived(
 		const QString &query,
 		const QVector<MTPPeer> &my,
@@ -294,6 +302,8 @@ private:
 
 	void clearSearchResults(bool clearPeerSearchResults = true);
 	void updateSelectedRow(Key key = Key());
+	void schedulePreloadSelected();
+	void preloadSelected();
 
 	not_null<IndexedList*> shownDialogs() const;
 
@@ -322,6 +332,7 @@ private:
 	int _skipTopDialogs = 0;
 	Row *_selected = nullptr;
 	Row *_pressed = nullptr;
+	base::Timer _preloadSelectedTimer;
 
 	Row *_dragging = nullptr;
 	int _draggingIndex = -1;
@@ -333,6 +344,7 @@ private:
 	};
 	std::vector<PinnedRow> _pinnedRows;
 	Ui::Animations::Basic _pinnedShiftAnimation;
+	const std::unique_ptr<RowCache> _rowCache;
 	base::flat_set<Key> _pinnedOnDragStart;
 
 	// Remember the last currently dragged row top shift for updating area.
@@ -363,6 +375,7 @@ private:
 	int _peerSearchPressed = -1;
 
 	std::vector<std::unique_ptr<FakeRow>> _searchResults;
+	bool _searchResultsLocal = false;
 	int _searchedCount = 0;
 	int _searchedMigratedCount = 0;
 	int _searchedSelected = -1;
@@ -392,6 +405,8 @@ private:
 
 	base::unique_qptr<Ui::PopupMenu> _menu;
 
+	Core::FrameTimeOverlay _frameTimes;
+
 };
 
 } // namespace Dialogs
@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #pragma once
 
 #include "dialogs/dialogs_row.h"
+#include "base/flat_hash_map.h"
 
 class PeerData;
 namespace Dialogs {
@@ -71,6 +72,12 @@ public:
 	iterator find(int y, int h) { return cfind(y, h); }
 
 private:
+	struct KeyHash {
+		std::size_t operator()(const Key &key) const {
+			return std::hash<Entry*>()(key.entry().get());
+		}
+	};
+
 	void adjustByName(not_null<Row*> row);
 	void rotate(
 		std::vector<not_null<Row*>>::iterator first,
@@ -79,7 +86,7 @@ private:
 
 	SortMode _sortMode = SortMode();
 	std::vector<not_null<Row*>> _rows;
-	std::map<Key, std::unique_ptr<Row>> _rowByKey;
+	base::flat_hash_map<Key, std::unique_ptr<Row>, KeyHash> _rowByKey;
 
 };
 
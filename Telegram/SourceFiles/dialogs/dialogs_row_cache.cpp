@@ -0,0 +1,225 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "dialogs/dialogs_row_cache.h"
+
+#include "dialogs/dialogs_row.h"
+#include "dialogs/dialogs_layout.h"
+#include "data/data_drafts.h"
+#include "data/data_peer_values.h"
+#include "history/history.h"
+#include "history/history_item.h"
+#include "window/themes/window_theme.h"
+#include "styles/style_dialogs.h"
+#include "app.h"
+
+namespace Dialogs {
+namespace {
+
+constexpr auto kAnimatedTimeout = crl::time(1000);
+constexpr auto kMaxCacheBytes = int64(32 * 1024 * 1024);
+
+[[nodiscard]] int64 PixmapBytes(QSize size) {
+	return int64(size.width()) * size.height() * cIntRetinaFactor()
+		* cIntRetinaFactor() * 4;
+}
+
+} // namespace
+
+RowCache::RowCache() {
+	subscribe(Window::Theme::Background(), [=](
+			const Window::Theme::BackgroundUpdate &update) {
+		if (update.paletteChanged()) {
+			clear();
+		}
+	});
+}
+
+bool RowCache::Same(const State &a, const State &b) {
+	const auto tie = [](const State &state) {
+		return std::tie(
+			state.peer,
+			state.item,
+			state.itemId,
+			state.draft,
+			state.draftDate,
+			state.userpic,
+			state.width,
+			state.unreadCount,
+			state.nameVersion,
+			state.fixedOnTopIndex,
+			state.day,
+			state.active,
+			state.itemUnread,
+			state.unreadMark,
+			state.mutedBadge,
+			state.mentions,
+			state.pinned,
+			state.online,
+			state.userpicLoaded);
+	};
+	return (tie(a) == tie(b));
+}
+
+auto RowCache::ComputeState(
+		not_null<const Row*> row,
+		int fullWidth,
+		bool active) -> std::optional<State> {
+	// Folder rows show the names of the chats inside, that can change
+	// without a repaint request for the folder row itself.
+	const auto history = row->history();
+	if (!history) {
+		return std::nullopt;
+	}
+	const auto entry = row->entry();
+	const auto peer = history->peer;
+	const auto item = entry->chatListMessage();
+	const auto draft = history->cloudDraft();
+
+	auto result = State();
+	result.peer = peer;
+	result.item = item;
+	result.itemId = item ? item->id : 0;
+	result.draft = draft;
+	result.draftDate = draft ? draft->date : 0;
+	result.userpic = peer->userpicUniqueKey();
+	result.width = fullWidth;
+	result.unreadCount = entry->chatListUnreadCount();
+	result.nameVersion = peer->nameVersion;
+	result.fixedOnTopIndex = entry->fixedOnTopIndex();
+
+	// Dates of today's messages are shown as time, of others as a date.
+	result.day = QDate::currentDate().toJulianDay();
+	result.active = active;
+	result.itemUnread = item && item->unread();
+	result.unreadMark = entry->chatListUnreadMark();
+	result.mutedBadge = entry->chatListMutedBadge();
+	result.mentions = history->hasUnreadMentions();
+	result.pinned = entry->isPinnedDialog();
+	result.online = Data::IsPeerAnOnlineUser(peer);
+	result.userpicLoaded = !peer->useEmptyUserpic();
+	return result;
+}
+
+void RowCache::paint(
+		Painter &p,
+		not_null<const Row*> row,
+		int fullWidth,
+		bool active,
+		bool selected,
+		crl::time ms) {
+	const auto state = ComputeState(row, fullWidth, active);
+	if (!state) {
+		Layout::RowPainter::paint(p, row, fullWidth, active, selected, ms);
+		return;
+	}
+	auto &entry = _entries[row->key()];
+	if (entry.valid && !Same(entry.state, *state)) {
+		entry.valid = false;
+	}
+	entry.used = ++_paintIndex;
+	if (!entry.valid) {
+		if (!canCache(row, entry, selected, ms)) {
+			Layout::RowPainter::paint(
+				p,
+				row,
+				fullWidth,
+				active,
+				selected,
+				ms);
+			return;
+		}
+		render(row, entry, *state, ms);
+	}
+	p.drawPixmap(0, 0, entry.pixmap);
+}
+
+bool RowCache::canCache(
+		not_null<const Row*> row,
+		const Entry &entry,
+		bool selected,
+		crl::time ms) const {
+	if (entry.invalidated && entry.invalidated + kAnimatedTimeout > ms) {
+		return false;
+	} else if (selected || row->animating()) {
+		return false;
+	}
+	return !row->history()->hasSendActionAnimation();
+}
+
+void RowCache::render(
+		not_null<const Row*> row,
+		Entry &entry,
+		const State &state,
+		crl::time ms) {
+	_bytes -= PixmapBytes(entry.size);
+
+	entry.size = QSize(state.width, st::dialogsRowHeight);
+	entry.state = state;
+	entry.valid = true;
+
+	auto image = QImage(
+		entry.size * cIntRetinaFactor(),
+		QImage::Format_ARGB32_Premultiplied);
+	image.setDevicePixelRatio(cRetinaFactor());
+	{
+		Painter q(&image);
+		Layout::RowPainter::paint(
+			q,
+			row,
+			state.width,
+			state.active,
+			false,
+			ms);
+	}
+	entry.pixmap = App::pixmapFromImageInPlace(std::move(image));
+
+	_bytes += PixmapBytes(entry.size);
+	shrinkToLimit();
+}
+
+void RowCache::invalidate(Key key) {
+	const auto i = _entries.find(key);
+	if (i == _entries.end()) {
+		return;
+	}
+	i->second.valid = false;
+	i->second.invalidated = crl::now();
+	i->second.pixmap = QPixmap();
+	_bytes -= PixmapBytes(base::take(i->second.size));
+}
+
+void RowCache::clear() {
+	_entries.clear();
+	_bytes = 0;
+}
+
+void RowCache::shrinkToLimit() {
+	if (_bytes <= kMaxCacheBytes) {
+		return;
+	}
+	auto used = std::vector<uint64>();
+	used.reserve(_entries.size());
+	for (const auto &[key, entry] : _entries) {
+		if (entry.valid) {
+			used.push_back(entry.used);
+		}
+	}
+	ranges::sort(used);
+
+	// Drop the least recently painted half of the cached images.
+	const auto border = used[used.size() / 2];
+	for (auto &[key, entry] : _entries) {
+		if (entry.valid && entry.used < border) {
+			entry.valid = false;
+			entry.pixmap = QPixmap();
+			_bytes -= PixmapBytes(base::take(entry.size));
+		}
+	}
+}
+
+} // namespace Dialogs
@@ -0,0 +1,101 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "dialogs/dialogs_key.h"
+#include "base/observer.h"
+
+class Painter;
+class HistoryItem;
+
+namespace Data {
+struct Draft;
+} // namespace Data
+
+namespace Dialogs {
+
+class Row;
+
+// Keeps the last rendered image of chat list rows, so that scrolling
+// and repainting the list only blits the rows that didn't change.
+//
+// A row is rendered again when its entry asked for a repaint or when
+// anything painted in it differs from the time it was rendered.
+// Rows with a typing or online animation, a ripple or under the cursor
+// are drawn directly every time.
+class RowCache final : private base::Subscriber {
+public:
+	RowCache();
+
+	void paint(
+		Painter &p,
+		not_null<const Row*> row,
+		int fullWidth,
+		bool active,
+		bool selected,
+		crl::time ms);
+
+	void invalidate(Key key);
+	void clear();
+
+private:
+	struct State {
+		const PeerData *peer = nullptr;
+		const HistoryItem *item = nullptr;
+		MsgId itemId = 0;
+		const Data::Draft *draft = nullptr;
+		TimeId draftDate = 0;
+		InMemoryKey userpic;
+		int width = 0;
+		int unreadCount = 0;
+		int nameVersion = 0;
+		int fixedOnTopIndex = 0;
+		int64 day = 0;
+		bool active = false;
+		bool itemUnread = false;
+		bool unreadMark = false;
+		bool mutedBadge = false;
+		bool mentions = false;
+		bool pinned = false;
+		bool online = false;
+		bool userpicLoaded = false;
+	};
+
+	struct Entry {
+		QPixmap pixmap;
+		QSize size;
+		State state;
+		bool valid = false;
+		crl::time invalidated = 0;
+		uint64 used = 0;
+	};
+
+	[[nodiscard]] static bool Same(const State &a, const State &b);
+	[[nodiscard]] static std::optional<State> ComputeState(
+		not_null<const Row*> row,
+		int fullWidth,
+		bool active);
+	[[nodiscard]] bool canCache(
+		not_null<const Row*> row,
+		const Entry &entry,
+		bool selected,
+		crl::time ms) const;
+	void render(
+		not_null<const Row*> row,
+		Entry &entry,
+		const State &state,
+		crl::time ms);
+	void shrinkToLimit();
+
+	base::flat_map<Key, Entry> _entries;
+	int64 _bytes = 0;
+	uint64 _paintIndex = 0;
+
+};
+
+} // namespace Dialogs
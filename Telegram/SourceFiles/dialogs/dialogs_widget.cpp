@@ -12,6 +12,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "dialogs/dialogs_key.h"
 #include "dialogs/dialogs_entry.h"
 #include "history/history.h"
+#include "history/history_item.h"
 //#include "history/feed/history_feed_section.h" // #feed
 #include "history/view/history_view_top_bar_widget.h"
 #include "ui/widgets/buttons.h"
@@ -760,6 +761,8 @@ bool Widget::onSearchMessages(bool searchCache) {
 				i.value(),
 				0);
 			result = true;
+		} else if (!q.isEmpty()) {
+			searchLocal(q);
 		}
 	} else if (_searchQuery != q || _searchQueryFrom != _searchFromUser) {
 		_searchQuery = q;
@@ -904,7 +907,29 @@ void Widget::searchMessages(
 	}
 }
 
+void Widget::searchLocal(const QString &query) {
+	const auto history = _searchInChat.history();
+	const auto migrated = _searchInMigrated;
+	const auto from = _searchFromUser;
+	const auto filter = [=](not_null<HistoryItem*> item) {
+		if (history
+			&& item->history() != history
+			&& item->history() != migrated) {
+			return false;
+		}
+		return !from || (item->from().get() == from);
+	};
+	_inner->searchLocalReceived(session().data().searchIndex().query(
+		query,
+		filter,
+		SearchPerPage));
+}
+
 void Widget::onSearchMore() {
+	if (_inner->hasLocalSearchResults()) {
+		// Wait for the first page from the server before loading more.
+		return;
+	}
 	if (!_searchRequest) {
 		if (!_searchFull) {
 			auto offsetPeer = _inner->lastSearchPeer();
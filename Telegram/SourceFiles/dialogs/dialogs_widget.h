@@ -139,6 +139,7 @@ private:
 	void setupSupportMode();
 	void setupConnectingWidget();
 	bool searchForPeersRequired(const QString &query) const;
+	void searchLocal(const QString &query);
 	void setSearchInChat(Key chat, UserData *from = nullptr);
 	void showJumpToDate();
 	void showSearchFrom();
@@ -11,6 +11,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "export/data/export_data_types.h"
 #include "export/output/export_output_result.h"
 #include "export/output/export_output_file.h"
+#include "export/output/export_output_manifest.h"
+#include "export/output/export_output_stats.h"
 #include "mtproto/rpc_sender.h"
 #include "base/value_ordering.h"
 #include "base/bytes.h"
@@ -21,9 +23,16 @@ namespace Export {
 namespace {
 
 constexpr auto kUserpicsSliceLimit = 100;
-constexpr auto kFileChunkSize = 128 * 1024;
+constexpr auto kFileChunkSize = 512 * 1024;
 constexpr auto kFileRequestsCount = 2;
-constexpr auto kFileNextRequestDelay = crl::time(20);
+
+// Files of a messages slice are loaded concurrently, the limit halves
+// when parts start coming slowly (usually because of delayed requests
+// after FLOOD_WAIT) and grows back by one after enough fast parts.
+constexpr auto kFileProcessesCount = 4;
+constexpr auto kFileProcessesMaxCount = 8;
+constexpr auto kFileSlowPartDuration = crl::time(4000);
+constexpr auto kFileFastPartsToGrow = 16;
 constexpr auto kChatsSliceLimit = 100;
 constexpr auto kMessagesSliceLimit = 100;
 constexpr auto kTopPeerSliceLimit = 100;
@@ -88,6 +97,11 @@ LocationKey ComputeLocationKey(const Data::FileLocation &value) {
 	return result;
 }
 
+QString ComputeManifestKey(const Data::FileLocation &value) {
+	const auto key = ComputeLocationKey(value);
+	return QString::number(key.type, 16) + '_' + QString::number(key.id, 16);
+}
+
 Settings::Type SettingsFromDialogsType(Data::DialogInfo::Type type) {
 	using DialogType = Data::DialogInfo::Type;
 	switch (type) {
@@ -179,15 +193,18 @@ struct ApiWrap::FileProcess {
 	Data::FileLocation location;
 	int offset = 0;
 	int size = 0;
+	int sessionIndex = 0;
 
 	struct Request {
 		int offset = 0;
 		QByteArray bytes;
+		crl::time sent = 0;
 	};
 	std::deque<Request> requests;
 };
 
 struct ApiWrap::FileProgress {
+	QString path;
 	int ready = 0;
 	int total = 0;
 };
@@ -230,7 +247,11 @@ struct ApiWrap::ChatProcess {
 	Data::ParseMediaContext context;
 	std::optional<Data::MessagesSlice> slice;
 	bool lastSlice = false;
+	bool paused = false;
+	bool nextWaiting = false;
 	int fileIndex = 0;
+	bool thumbNext = false;
+	int filesLoading = 0;
 };
 
 
@@ -242,7 +263,8 @@ public:
 
 	RequestBuilder(
 		Original &&builder,
-		FnMut<void(RPCError&&)> commonFailHandler);
+		FnMut<void(RPCError&&)> commonFailHandler,
+		Output::Stats *stats);
 
 	[[nodiscard]] RequestBuilder &done(FnMut<void()> &&handler);
 	[[nodiscard]] RequestBuilder &done(
@@ -255,15 +277,20 @@ public:
 private:
 	Original _builder;
 	FnMut<void(RPCError&&)> _commonFailHandler;
+	Output::Stats *_stats = nullptr;
+	crl::time _started = 0;
 
 };
 
 template <typename Request>
 ApiWrap::RequestBuilder<Request>::RequestBuilder(
 	Original &&builder,
-	FnMut<void(RPCError&&)> commonFailHandler)
+	FnMut<void(RPCError&&)> commonFailHandler,
+	Output::Stats *stats)
 : _builder(std::move(builder))
-, _commonFailHandler(std::move(commonFailHandler)) {
+, _commonFailHandler(std::move(commonFailHandler))
+, _stats(stats)
+, _started(crl::now()) {
 }
 
 template <typename Request>
@@ -271,7 +298,16 @@ auto ApiWrap::RequestBuilder<Request>::done(
 	FnMut<void()> &&handler
 ) -> RequestBuilder& {
 	if (handler) {
-		auto &silence_warning = _builder.done(std::move(handler));
+		auto &silence_warning = _builder.done(FnMut<void()>([
+			stats = _stats,
+			started = _started,
+			handler = std::move(handler)
+		]() mutable {
+			if (stats) {
+				stats->addTime(Output::Phase::Api, crl::now() - started);
+			}
+			handler();
+		}));
 	}
 	return *this;
 }
@@ -281,7 +317,16 @@ auto ApiWrap::RequestBuilder<Request>::done(
 	FnMut<void(Response &&)> &&handler
 ) -> RequestBuilder& {
 	if (handler) {
-		auto &silence_warning = _builder.done(std::move(handler));
+		auto &silence_warning = _builder.done(FnMut<void(Response &&)>([
+			stats = _stats,
+			started = _started,
+			handler = std::move(handler)
+		](Response &&result) mutable {
+			if (stats) {
+				stats->addTime(Output::Phase::Api, crl::now() - started);
+			}
+			handler(std::move(result));
+		}));
 	}
 	return *this;
 }
@@ -353,11 +398,13 @@ auto ApiWrap::mainRequest(Request &&request) {
 	auto original = std::move(_mtp.request(MTPInvokeWithTakeout<Request>(
 		MTP_long(*_takeoutId),
 		std::forward<Request>(request)
-	)).toDC(MTP::ShiftDcId(0, MTP::kExportDcShift)));
+	)).toDC(MTP::ShiftDcId(0, MTP::kExportDcShift)
+	).withPriority(MTP::RequestPriority::Bulk));
 
 	return RequestBuilder<MTPInvokeWithTakeout<Request>>(
 		std::move(original),
-		[=](RPCError &&result) { error(std::move(result)); });
+		[=](RPCError &&result) { error(std::move(result)); },
+		_stats);
 }
 
 template <typename Request>
@@ -372,9 +419,15 @@ auto ApiWrap::splitRequest(int index, Request &&request) {
 		std::forward<Request>(request)));
 }
 
-auto ApiWrap::fileRequest(const Data::FileLocation &location, int offset) {
+auto ApiWrap::fileRequest(
+		uint64 processId,
+		const Data::FileLocation &location,
+		int offset,
+		int sessionIndex) {
 	Expects(location.dcId != 0
 		|| location.data.type() == mtpc_inputTakeoutFileLocation);
+	Expects(sessionIndex >= 0
+		&& sessionIndex < MTP::kExportMediaSessionsCount);
 	Expects(_takeoutId.has_value());
 
 	return std::move(_mtp.request(MTPInvokeWithTakeout<MTPupload_GetFile>(
@@ -388,6 +441,7 @@ auto ApiWrap::fileRequest(const Data::FileLocation &location, int offset) {
 		if (result.type() == qstr("TAKEOUT_FILE_EMPTY")
 			&& _otherDataProcess != nullptr) {
 			filePartDone(
+				processId,
 				0,
 				MTP_upload_file(
 					MTP_storage_filePartial(),
@@ -395,16 +449,20 @@ auto ApiWrap::fileRequest(const Data::FileLocation &location, int offset) {
 					MTP_bytes()));
 		} else if (result.type() == qstr("LOCATION_INVALID")
 			|| result.type() == qstr("VERSION_INVALID")) {
-			filePartUnavailable();
+			filePartUnavailable(processId);
 		} else {
 			error(std::move(result));
 		}
-	}).toDC(MTP::ShiftDcId(location.dcId, MTP::kExportMediaDcShift)));
+	}).toDC(MTP::ShiftDcId(
+		location.dcId,
+		MTP::kExportMediaDcShift + sessionIndex)
+	).withPriority(MTP::RequestPriority::Bulk));
 }
 
 ApiWrap::ApiWrap(Fn<void(FnMut<void()>)> runner)
 : _mtp(std::move(runner))
-, _fileCache(std::make_unique<LoadedFileCache>(kLocationCacheSize)) {
+, _fileCache(std::make_unique<LoadedFileCache>(kLocationCacheSize))
+, _fileProcessesLimit(kFileProcessesCount) {
 }
 
 rpl::producer<RPCError> ApiWrap::errors() const {
@@ -424,6 +482,11 @@ void ApiWrap::startExport(
 
 	_settings = std::make_unique<Settings>(settings);
 	_stats = stats;
+	if (!_settings->archive) {
+		_manifest = std::make_unique<Output::Manifest>(
+			_settings->path,
+			*_settings);
+	}
 	_startProcess = std::make_unique<StartProcess>();
 	_startProcess->done = std::move(done);
 
@@ -813,7 +876,6 @@ void ApiWrap::finishUserpicsSlice() {
 }
 
 bool ApiWrap::loadUserpicProgress(FileProgress progress) {
-	Expects(_fileProcess != nullptr);
 	Expects(_userpicsProcess != nullptr);
 	Expects(_userpicsProcess->slice.has_value());
 	Expects((_userpicsProcess->fileIndex >= 0)
@@ -821,7 +883,7 @@ bool ApiWrap::loadUserpicProgress(FileProgress progress) {
 			< _userpicsProcess->slice->list.size()));
 
 	return _userpicsProcess->fileProgress(DownloadProgress{
-		_fileProcess->relativePath,
+		progress.path,
 		_userpicsProcess->fileIndex,
 		progress.ready,
 		progress.total });
@@ -1022,6 +1084,9 @@ void ApiWrap::messagesCountLoaded(int localSplitIndex, int count) {
 void ApiWrap::finishExport(FnMut<void()> done) {
 	const auto guard = gsl::finally([&] { _takeoutId = std::nullopt; });
 
+	if (_manifest) {
+		_manifest->remove();
+	}
 	mainRequest(MTPaccount_FinishTakeoutSession(
 		MTP_flags(MTPaccount_FinishTakeoutSession::Flag::f_success)
 	)).done(std::move(done)).send();
@@ -1374,6 +1439,7 @@ void ApiWrap::loadMessagesFiles(Data::MessagesSlice &&slice) {
 	}
 	_chatProcess->slice = std::move(slice);
 	_chatProcess->fileIndex = 0;
+	_chatProcess->thumbNext = false;
 
 	loadNextMessageFile();
 }
@@ -1385,34 +1451,55 @@ void ApiWrap::loadNextMessageFile() {
 	for (auto &list = _chatProcess->slice->list
 		; _chatProcess->fileIndex < list.size()
 		; ++_chatProcess->fileIndex) {
-		const auto &message = list[_chatProcess->fileIndex];
-		if (Data::SkipMessageByDate(message, *_settings)) {
+		const auto index = _chatProcess->fileIndex;
+		if (Data::SkipMessageByDate(list[index], *_settings)) {
 			continue;
 		}
-		const auto fileProgress = [=](FileProgress value) {
-			return loadMessageFileProgress(value);
-		};
-		const auto ready = processFileLoad(
-			list[_chatProcess->fileIndex].file(),
-			fileProgress,
-			[=](const QString &path) { loadMessageFileDone(path); },
-			&list[_chatProcess->fileIndex]);
-		if (!ready) {
-			return;
+		if (!_chatProcess->thumbNext) {
+			if (!startMessageFileLoad(index, false)) {
+				return;
+			}
+			_chatProcess->thumbNext = true;
 		}
-		const auto thumbProgress = [=](FileProgress value) {
-			return loadMessageThumbProgress(value);
-		};
-		const auto thumbReady = processFileLoad(
-			list[_chatProcess->fileIndex].thumb().file,
-			thumbProgress,
-			[=](const QString &path) { loadMessageThumbDone(path); },
-			&list[_chatProcess->fileIndex]);
-		if (!thumbReady) {
+		if (!startMessageFileLoad(index, true)) {
 			return;
 		}
+		_chatProcess->thumbNext = false;
+	}
+	if (!_chatProcess->filesLoading) {
+		finishMessagesSlice();
 	}
-	finishMessagesSlice();
+}
+
+bool ApiWrap::startMessageFileLoad(int index, bool thumb) {
+	Expects(_chatProcess != nullptr);
+	Expects(_chatProcess->slice.has_value());
+	Expects(index >= 0 && index < _chatProcess->slice->list.size());
+
+	if (_chatProcess->filesLoading >= _fileProcessesLimit) {
+		return false;
+	}
+	auto &message = _chatProcess->slice->list[index];
+	++_chatProcess->filesLoading;
+	const auto ready = thumb
+		? processFileLoad(
+			message.thumb().file,
+			[=](FileProgress value) {
+				return loadMessageThumbProgress(index, value);
+			},
+			[=](const QString &path) { loadMessageThumbDone(index, path); },
+			&message)
+		: processFileLoad(
+			message.file(),
+			[=](FileProgress value) {
+				return loadMessageFileProgress(index, value);
+			},
+			[=](const QString &path) { loadMessageFileDone(index, path); },
+			&message);
+	if (ready) {
+		--_chatProcess->filesLoading;
+	}
+	return true;
 }
 
 void ApiWrap::finishMessagesSlice() {
@@ -1426,6 +1513,33 @@ void ApiWrap::finishMessagesSlice() {
 			return;
 		}
 	}
+	if (_chatProcess->paused) {
+		_chatProcess->nextWaiting = true;
+		return;
+	}
+	requestNextMessagesSlice();
+}
+
+void ApiWrap::pauseMessages() {
+	Expects(_chatProcess != nullptr);
+
+	_chatProcess->paused = true;
+}
+
+void ApiWrap::resumeMessages() {
+	if (!_chatProcess) {
+		return;
+	}
+	_chatProcess->paused = false;
+	if (base::take(_chatProcess->nextWaiting)) {
+		requestNextMessagesSlice();
+	}
+}
+
+void ApiWrap::requestNextMessagesSlice() {
+	Expects(_chatProcess != nullptr);
+	Expects(!_chatProcess->slice.has_value());
+
 	if (_chatProcess->lastSlice
 		&& (++_chatProcess->localSplitIndex
 			< _chatProcess->info.splits.size())) {
@@ -1439,51 +1553,49 @@ void ApiWrap::finishMessagesSlice() {
 	}
 }
 
-bool ApiWrap::loadMessageFileProgress(FileProgress progress) {
-	Expects(_fileProcess != nullptr);
+bool ApiWrap::loadMessageFileProgress(int index, FileProgress progress) {
 	Expects(_chatProcess != nullptr);
 	Expects(_chatProcess->slice.has_value());
-	Expects((_chatProcess->fileIndex >= 0)
-		&& (_chatProcess->fileIndex < _chatProcess->slice->list.size()));
+	Expects((index >= 0) && (index < _chatProcess->slice->list.size()));
 
 	return _chatProcess->fileProgress(DownloadProgress{
-		_fileProcess->relativePath,
-		_chatProcess->fileIndex,
+		progress.path,
+		index,
 		progress.ready,
 		progress.total });
 }
 
-void ApiWrap::loadMessageFileDone(const QString &relativePath) {
+void ApiWrap::loadMessageFileDone(int index, const QString &relativePath) {
 	Expects(_chatProcess != nullptr);
 	Expects(_chatProcess->slice.has_value());
-	Expects((_chatProcess->fileIndex >= 0)
-		&& (_chatProcess->fileIndex < _chatProcess->slice->list.size()));
+	Expects((index >= 0) && (index < _chatProcess->slice->list.size()));
+	Expects(_chatProcess->filesLoading > 0);
 
-	const auto index = _chatProcess->fileIndex;
 	auto &file = _chatProcess->slice->list[index].file();
 	file.relativePath = relativePath;
 	if (relativePath.isEmpty()) {
 		file.skipReason = Data::File::SkipReason::Unavailable;
 	}
+	--_chatProcess->filesLoading;
 	loadNextMessageFile();
 }
 
-bool ApiWrap::loadMessageThumbProgress(FileProgress progress) {
-	return loadMessageFileProgress(progress);
+bool ApiWrap::loadMessageThumbProgress(int index, FileProgress progress) {
+	return loadMessageFileProgress(index, progress);
 }
 
-void ApiWrap::loadMessageThumbDone(const QString &relativePath) {
+void ApiWrap::loadMessageThumbDone(int index, const QString &relativePath) {
 	Expects(_chatProcess != nullptr);
 	Expects(_chatProcess->slice.has_value());
-	Expects((_chatProcess->fileIndex >= 0)
-		&& (_chatProcess->fileIndex < _chatProcess->slice->list.size()));
+	Expects((index >= 0) && (index < _chatProcess->slice->list.size()));
+	Expects(_chatProcess->filesLoading > 0);
 
-	const auto index = _chatProcess->fileIndex;
 	auto &file = _chatProcess->slice->list[index].thumb().file;
 	file.relativePath = relativePath;
 	if (relativePath.isEmpty()) {
 		file.skipReason = Data::File::SkipReason::Unavailable;
 	}
+	--_chatProcess->filesLoading;
 	loadNextMessageFile();
 }
 
@@ -1556,9 +1668,19 @@ bool ApiWrap::writePreloadedFile(Data::File &file) {
 	if (const auto path = _fileCache->find(file.location)) {
 		file.relativePath = *path;
 		return true;
+	} else if (const auto path = (file.location && _manifest)
+		? _manifest->find(ComputeManifestKey(file.location))
+		: std::nullopt) {
+		file.relativePath = *path;
+		_fileCache->save(file.location, file.relativePath);
+		return true;
 	} else if (!file.content.isEmpty()) {
 		const auto process = prepareFileProcess(file);
-		if (const auto result = process->file.writeBlock(file.content)) {
+		const auto write = [&] {
+			const auto result = process->file.writeBlock(file.content);
+			return result ? process->file.finish() : result;
+		};
+		if (const auto result = write()) {
 			file.relativePath = process->relativePath;
 			_fileCache->save(file.location, file.relativePath);
 		} else {
@@ -1573,25 +1695,34 @@ void ApiWrap::loadFile(
 		const Data::File &file,
 		Fn<bool(FileProgress)> progress,
 		FnMut<void(QString)> done) {
-	Expects(_fileProcess == nullptr);
 	Expects(file.location.dcId != 0
 		|| file.location.data.type() == mtpc_inputTakeoutFileLocation);
 
-	_fileProcess = prepareFileProcess(file);
-	_fileProcess->progress = std::move(progress);
-	_fileProcess->done = std::move(done);
+	const auto id = ++_fileProcessIdLast;
+	auto process = prepareFileProcess(file);
+	process->progress = std::move(progress);
+	process->done = std::move(done);
+	process->sessionIndex = int(id % MTP::kExportMediaSessionsCount);
 
-	if (_fileProcess->progress) {
+	if (process->progress) {
 		const auto progress = FileProgress{
-			_fileProcess->file.size(),
-			_fileProcess->size
+			process->relativePath,
+			process->file.size(),
+			process->size
 		};
-		if (!_fileProcess->progress(progress)) {
+		if (!process->progress(progress)) {
 			return;
 		}
 	}
 
-	loadFilePart();
+	// Create the file now, so that files loaded at the same time
+	// get different relative paths.
+	if (const auto result = process->file.writeBlock({}); !result) {
+		ioError(result);
+		return;
+	}
+	_fileProcesses.emplace(id, std::move(process));
+	loadFilePart(id);
 }
 
 auto ApiWrap::prepareFileProcess(const Data::File &file) const
@@ -1610,40 +1741,45 @@ auto ApiWrap::prepareFileProcess(const Data::File &file) const
 	return result;
 }
 
-void ApiWrap::loadFilePart() {
-	if (!_fileProcess
-		|| _fileProcess->requests.size() >= kFileRequestsCount
-		|| (_fileProcess->size > 0
-			&& _fileProcess->offset >= _fileProcess->size)) {
+void ApiWrap::loadFilePart(uint64 processId) {
+	const auto i = _fileProcesses.find(processId);
+	if (i == end(_fileProcesses)) {
 		return;
 	}
-
-	const auto offset = _fileProcess->offset;
-	_fileProcess->requests.push_back({ offset });
-	fileRequest(
-		_fileProcess->location,
-		_fileProcess->offset
-	).done([=](const MTPupload_File &result) {
-		filePartDone(offset, result);
-	}).send();
-	_fileProcess->offset += kFileChunkSize;
-
-	if (_fileProcess->size > 0
-		&& _fileProcess->requests.size() < kFileRequestsCount) {
-		//const auto runner = _runner;
-		//crl::on_main([=] {
-		//	QTimer::singleShot(kFileNextRequestDelay, [=] {
-		//		runner([=] {
-		//			loadFilePart();
-		//		});
-		//	});
-		//});
+	const auto process = i->second.get();
+
+	// While the size is unknown we request parts one by one.
+	const auto more = [&] {
+		return (process->size > 0)
+			? (process->requests.size() < kFileRequestsCount
+				&& process->offset < process->size)
+			: process->requests.empty();
+	};
+	while (more()) {
+		const auto offset = process->offset;
+		process->requests.push_back({ offset, QByteArray(), crl::now() });
+		fileRequest(
+			processId,
+			process->location,
+			offset,
+			process->sessionIndex
+		).done([=](const MTPupload_File &result) {
+			filePartDone(processId, offset, result);
+		}).send();
+		process->offset += kFileChunkSize;
 	}
 }
 
-void ApiWrap::filePartDone(int offset, const MTPupload_File &result) {
-	Expects(_fileProcess != nullptr);
-	Expects(!_fileProcess->requests.empty());
+void ApiWrap::filePartDone(
+		uint64 processId,
+		int offset,
+		const MTPupload_File &result) {
+	const auto i = _fileProcesses.find(processId);
+	if (i == end(_fileProcesses)) {
+		return;
+	}
+	const auto process = i->second.get();
+	Assert(!process->requests.empty());
 
 	if (result.type() == mtpc_upload_fileCdnRedirect) {
 		error("Cdn redirect is not supported.");
@@ -1651,27 +1787,32 @@ void ApiWrap::filePartDone(int offset, const MTPupload_File &result) {
 	}
 	const auto &data = result.c_upload_file();
 	if (data.vbytes().v.isEmpty()) {
-		if (_fileProcess->size > 0) {
+		if (process->size > 0) {
 			error("Empty bytes received in file part.");
 			return;
 		}
-		const auto result = _fileProcess->file.writeBlock({});
+		const auto result = process->file.writeBlock({});
 		if (!result) {
 			ioError(result);
 			return;
 		}
 	} else {
 		using Request = FileProcess::Request;
-		auto &requests = _fileProcess->requests;
-		const auto i = ranges::find(
+		auto &requests = process->requests;
+		const auto j = ranges::find(
 			requests,
 			offset,
 			[](const Request &request) { return request.offset; });
-		Assert(i != end(requests));
+		Assert(j != end(requests));
 
-		i->bytes = data.vbytes().v;
+		j->bytes = data.vbytes().v;
+		const auto duration = crl::now() - j->sent;
+		if (_stats) {
+			_stats->addTime(Output::Phase::Download, duration);
+		}
+		filePartTimed(duration);
 
-		auto &file = _fileProcess->file;
+		auto &file = process->file;
 		while (!requests.empty() && !requests.front().bytes.isEmpty()) {
 			const auto &bytes = requests.front().bytes;
 			if (const auto result = file.writeBlock(bytes); !result) {
@@ -1681,33 +1822,65 @@ void ApiWrap::filePartDone(int offset, const MTPupload_File &result) {
 			requests.pop_front();
 		}
 
-		if (_fileProcess->progress) {
-			_fileProcess->progress(FileProgress{
+		if (process->progress) {
+			process->progress(FileProgress{
+				process->relativePath,
 				file.size(),
-				_fileProcess->size });
+				process->size });
 		}
 
 		if (!requests.empty()
-			|| !_fileProcess->size
-			|| _fileProcess->size > _fileProcess->offset) {
-			loadFilePart();
+			|| !process->size
+			|| process->size > process->offset) {
+			loadFilePart(processId);
 			return;
 		}
 	}
 
-	auto process = base::take(_fileProcess);
-	const auto relativePath = process->relativePath;
-	_fileCache->save(process->location, relativePath);
-	process->done(process->relativePath);
+	auto taken = std::move(i->second);
+	_fileProcesses.erase(i);
+	if (const auto result = taken->file.finish(); !result) {
+		ioError(result);
+		return;
+	} else if (taken->location && _manifest) {
+		const auto result = _manifest->add(
+			ComputeManifestKey(taken->location),
+			taken->relativePath,
+			taken->file.size());
+		if (!result) {
+			ioError(result);
+			return;
+		}
+	}
+	const auto relativePath = taken->relativePath;
+	_fileCache->save(taken->location, relativePath);
+	taken->done(relativePath);
+}
+
+void ApiWrap::filePartTimed(crl::time duration) {
+	if (duration >= kFileSlowPartDuration) {
+		_fileProcessesLimit = std::max(_fileProcessesLimit / 2, 1);
+		_fileFastParts = 0;
+	} else if (++_fileFastParts >= kFileFastPartsToGrow) {
+		_fileProcessesLimit = std::min(
+			_fileProcessesLimit + 1,
+			kFileProcessesMaxCount);
+		_fileFastParts = 0;
+	}
 }
 
-void ApiWrap::filePartUnavailable() {
-	Expects(_fileProcess != nullptr);
-	Expects(!_fileProcess->requests.empty());
+void ApiWrap::filePartUnavailable(uint64 processId) {
+	const auto i = _fileProcesses.find(processId);
+	if (i == end(_fileProcesses)) {
+		return;
+	}
+	Assert(!i->second->requests.empty());
 
 	LOG(("Export Error: File unavailable."));
 
-	base::take(_fileProcess)->done(QString());
+	auto taken = std::move(i->second);
+	_fileProcesses.erase(i);
+	taken->done(QString());
 }
 
 void ApiWrap::error(RPCError &&error) {
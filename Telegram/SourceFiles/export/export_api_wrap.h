@@ -28,6 +28,7 @@ struct Message;
 namespace Output {
 struct Result;
 class Stats;
+class Manifest;
 } // namespace Output
 
 struct Settings;
@@ -81,6 +82,11 @@ public:
 		Fn<bool(Data::MessagesSlice&&)> slice,
 		FnMut<void()> done);
 
+	// Called from the slice callback to hold the next slice request
+	// until the consumer catches up.
+	void pauseMessages();
+	void resumeMessages();
+
 	void finishExport(FnMut<void()> done);
 	void cancelExportFast();
 
@@ -152,11 +158,13 @@ private:
 		FnMut<void(MTPmessages_Messages&&)> done);
 	void loadMessagesFiles(Data::MessagesSlice &&slice);
 	void loadNextMessageFile();
-	bool loadMessageFileProgress(FileProgress value);
-	void loadMessageFileDone(const QString &relativePath);
-	bool loadMessageThumbProgress(FileProgress value);
-	void loadMessageThumbDone(const QString &relativePath);
+	bool startMessageFileLoad(int index, bool thumb);
+	bool loadMessageFileProgress(int index, FileProgress value);
+	void loadMessageFileDone(int index, const QString &relativePath);
+	bool loadMessageThumbProgress(int index, FileProgress value);
+	void loadMessageThumbDone(int index, const QString &relativePath);
 	void finishMessagesSlice();
+	void requestNextMessagesSlice();
 	void finishMessages();
 
 	bool processFileLoad(
@@ -171,9 +179,13 @@ private:
 		const Data::File &file,
 		Fn<bool(FileProgress)> progress,
 		FnMut<void(QString)> done);
-	void loadFilePart();
-	void filePartDone(int offset, const MTPupload_File &result);
-	void filePartUnavailable();
+	void loadFilePart(uint64 processId);
+	void filePartDone(
+		uint64 processId,
+		int offset,
+		const MTPupload_File &result);
+	void filePartTimed(crl::time duration);
+	void filePartUnavailable(uint64 processId);
 
 	template <typename Request>
 	class RequestBuilder;
@@ -185,8 +197,10 @@ private:
 	[[nodiscard]] auto splitRequest(int index, Request &&request);
 
 	[[nodiscard]] auto fileRequest(
+		uint64 processId,
 		const Data::FileLocation &location,
-		int offset);
+		int offset,
+		int sessionIndex);
 
 	void error(RPCError &&error);
 	void error(const QString &text);
@@ -201,10 +215,14 @@ private:
 
 	std::unique_ptr<StartProcess> _startProcess;
 	std::unique_ptr<LoadedFileCache> _fileCache;
+	std::unique_ptr<Output::Manifest> _manifest;
 	std::unique_ptr<ContactsProcess> _contactsProcess;
 	std::unique_ptr<UserpicsProcess> _userpicsProcess;
 	std::unique_ptr<OtherDataProcess> _otherDataProcess;
-	std::unique_ptr<FileProcess> _fileProcess;
+	base::flat_map<uint64, std::unique_ptr<FileProcess>> _fileProcesses;
+	uint64 _fileProcessIdLast = 0;
+	int _fileProcessesLimit = 0;
+	int _fileFastParts = 0;
 	std::unique_ptr<LeftChannelsProcess> _leftChannelsProcess;
 	std::unique_ptr<DialogsProcess> _dialogsProcess;
 	std::unique_ptr<ChatProcess> _chatProcess;
@@ -11,12 +11,26 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "export/export_settings.h"
 #include "export/data/export_data_types.h"
 #include "export/output/export_output_abstract.h"
+#include "export/output/export_output_archive.h"
+#include "export/output/export_output_file.h"
 #include "export/output/export_output_result.h"
 #include "export/output/export_output_stats.h"
 
+#include <deque>
+
 namespace Export {
 namespace {
 
+// Messages slices are formatted by the writer on its own queue, while
+// the next slice with its media is loaded. Fetching pauses if that many
+// slices are still waiting to be written.
+constexpr auto kSlicesWritingLimit = 2;
+
+constexpr auto kSpeedWindow = crl::time(30000);
+constexpr auto kSpeedSampleDelay = crl::time(250);
+constexpr auto kSpeedMinDuration = crl::time(2000);
+constexpr auto kSummaryFileName = "export_stats.txt";
+
 const auto kNullStateCallback = [](ProcessingState&) {};
 
 Settings NormalizeSettings(const Settings &settings) {
@@ -31,11 +45,33 @@ Settings NormalizeSettings(const Settings &settings) {
 
 } // namespace
 
+float64 ProcessingProgress(const ProcessingState &state) {
+	if (!state.substepsTotal) {
+		return 0.;
+	}
+	const auto substepsTotal = state.substepsTotal;
+	const auto done = state.substepsPassed;
+	const auto add = state.substepsNow;
+	const auto doneProgress = done / float64(substepsTotal);
+	const auto addPart = [&](int index, int count) {
+		return (count > 0)
+			? ((float64(add) * index)
+				/ (float64(substepsTotal) * count))
+			: 0.;
+	};
+	const auto addProgress = (state.entityCount == 1
+		&& !state.entityIndex)
+		? addPart(state.itemIndex, state.itemCount)
+		: addPart(state.entityIndex, state.entityCount);
+	return doneProgress + addProgress;
+}
+
 class ControllerObject {
 public:
 	ControllerObject(
 		crl::weak_on_queue<ControllerObject> weak,
 		const MTPInputPeer &peer);
+	~ControllerObject();
 
 	rpl::producer<State> state() const;
 
@@ -57,9 +93,11 @@ private:
 	using DownloadProgress = ApiWrap::DownloadProgress;
 
 	void setState(State &&state);
+	void fillSpeed(ProcessingState &state);
 	void ioError(const QString &path);
 	bool ioCatchError(Output::Result result);
 	void setFinishedState();
+	[[nodiscard]] Output::Result writeSummary() const;
 
 	//void requestPasswordState();
 	//void passwordStateDone(const MTPaccount_Password &password);
@@ -77,6 +115,9 @@ private:
 	void exportOtherData();
 	void exportDialogs();
 	void exportNextDialog();
+	void writeDialogSlice(Data::MessagesSlice &&slice);
+	void dialogSliceWritten(const Output::Result &result, int count);
+	void afterDialogSlicesWritten(FnMut<void()> callback);
 
 	template <typename Callback = const decltype(kNullStateCallback) &>
 	ProcessingState prepareState(
@@ -98,6 +139,20 @@ private:
 
 	int substepsInStep(Step step) const;
 
+	struct SpeedSample {
+		crl::time when = 0;
+		int64 bytes = 0;
+		float64 progress = 0.;
+	};
+
+	crl::weak_on_queue<ControllerObject> _weak;
+
+	// Files written by the api and the writer use it until destroyed.
+	Output::Stats _stats;
+	std::shared_ptr<Output::Archive> _archive;
+	crl::time _started = 0;
+	std::deque<SpeedSample> _speedSamples;
+
 	ApiWrap _api;
 	Settings _settings;
 	Environment _environment;
@@ -115,14 +170,15 @@ private:
 	State _state;
 	rpl::event_stream<State> _stateChanges;
 
-	Output::Stats _stats;
-
 	std::vector<int> _substepsInStep;
 	int _substepsTotal = 0;
 	mutable int _substepsPassed = 0;
 	mutable Step _lastProcessingStep = Step::Initializing;
 
-	std::unique_ptr<Output::AbstractWriter> _writer;
+	std::shared_ptr<Output::AbstractWriter> _writer;
+	crl::queue _writerQueue;
+	int _slicesWriting = 0;
+	FnMut<void()> _slicesWritten;
 	std::vector<Step> _steps;
 	int _stepIndex = -1;
 
@@ -133,7 +189,8 @@ private:
 ControllerObject::ControllerObject(
 	crl::weak_on_queue<ControllerObject> weak,
 	const MTPInputPeer &peer)
-: _api(weak.runner())
+: _weak(std::move(weak))
+, _api(_weak.runner())
 , _state(PasswordCheckState{}) {
 	_api.errors(
 	) | rpl::start_with_next([=](RPCError &&error) {
@@ -153,6 +210,13 @@ ControllerObject::ControllerObject(
 	setState(std::move(state));
 }
 
+ControllerObject::~ControllerObject() {
+	// Wait for the slices already posted to the writer queue.
+	crl::semaphore semaphore;
+	_writerQueue.async([&] { semaphore.release(); });
+	semaphore.acquire();
+}
+
 rpl::producer<State> ControllerObject::state() const {
 	return rpl::single(
 		_state
@@ -168,10 +232,37 @@ void ControllerObject::setState(State &&state) {
 	if (_state.is<CancelledState>()) {
 		return;
 	}
+	if (const auto processing = base::get_if<ProcessingState>(&state)) {
+		fillSpeed(*processing);
+	}
 	_state = std::move(state);
 	_stateChanges.fire_copy(_state);
 }
 
+void ControllerObject::fillSpeed(ProcessingState &state) {
+	const auto now = crl::now();
+	const auto bytes = _stats.bytesCount();
+	const auto progress = ProcessingProgress(state);
+	if (_speedSamples.empty()
+		|| now - _speedSamples.back().when >= kSpeedSampleDelay) {
+		_speedSamples.push_back({ now, bytes, progress });
+	}
+	while (_speedSamples.size() > 1
+		&& now - _speedSamples.front().when > kSpeedWindow) {
+		_speedSamples.pop_front();
+	}
+	const auto &first = _speedSamples.front();
+	const auto duration = now - first.when;
+	if (duration < kSpeedMinDuration) {
+		return;
+	}
+	state.bytesPerSecond = (bytes - first.bytes) * 1000 / duration;
+	const auto done = progress - first.progress;
+	if (done > 0.) {
+		state.remaining = crl::time((1. - progress) * duration / done);
+	}
+}
+
 void ControllerObject::ioError(const QString &path) {
 	setState(OutputErrorState{ path });
 }
@@ -239,6 +330,7 @@ void ControllerObject::startExport(
 
 	_settings.path = Output::NormalizePath(_settings);
 	_writer = Output::CreateWriter(_settings.format);
+	_started = crl::now();
 	fillExportSteps();
 	exportNext();
 }
@@ -313,6 +405,10 @@ void ControllerObject::exportNext() {
 	if (++_stepIndex >= _steps.size()) {
 		if (ioCatchError(_writer->finish())) {
 			return;
+		} else if (ioCatchError(writeSummary())) {
+			return;
+		} else if (_archive && ioCatchError(_archive->finish())) {
+			return;
 		}
 		_api.finishExport([=] {
 			setFinishedState();
@@ -336,6 +432,12 @@ void ControllerObject::exportNext() {
 
 void ControllerObject::initialize() {
 	setState(stateInitializing());
+	if (_settings.archive) {
+		_archive = std::make_shared<Output::Archive>(_settings.path);
+		if (ioCatchError(_archive->start())) {
+			return;
+		}
+	}
 	_api.startExport(_settings, &_stats, [=](ApiWrap::StartInfo info) {
 		initialized(info);
 	});
@@ -453,17 +555,18 @@ void ControllerObject::exportNextDialog() {
 			setState(stateDialogs(progress));
 			return true;
 		}, [=](Data::MessagesSlice &&result) {
-			if (ioCatchError(_writer->writeDialogSlice(result))) {
+			if (_state.is<OutputErrorState>()) {
 				return false;
 			}
-			_messagesWritten += result.list.size();
-			setState(stateDialogs(DownloadProgress()));
+			writeDialogSlice(std::move(result));
 			return true;
 		}, [=] {
-			if (ioCatchError(_writer->writeDialogEnd())) {
-				return;
-			}
-			exportNextDialog();
+			afterDialogSlicesWritten([=] {
+				if (ioCatchError(_writer->writeDialogEnd())) {
+					return;
+				}
+				exportNextDialog();
+			});
 		});
 		return;
 	}
@@ -473,6 +576,55 @@ void ControllerObject::exportNextDialog() {
 	exportNext();
 }
 
+void ControllerObject::writeDialogSlice(Data::MessagesSlice &&slice) {
+	if (++_slicesWriting >= kSlicesWritingLimit) {
+		_api.pauseMessages();
+	}
+	_writerQueue.async([
+		writer = _writer,
+		stats = &_stats,
+		weak = _weak,
+		slice = std::move(slice)
+	]() mutable {
+		const auto started = crl::now();
+		const auto result = writer->writeDialogSlice(slice);
+		stats->addTime(Output::Phase::Format, crl::now() - started);
+		const auto count = int(slice.list.size());
+		weak.with([=](ControllerObject &that) {
+			that.dialogSliceWritten(result, count);
+		});
+	});
+}
+
+void ControllerObject::dialogSliceWritten(
+		const Output::Result &result,
+		int count) {
+	Expects(_slicesWriting > 0);
+
+	--_slicesWriting;
+	if (ioCatchError(result)) {
+		return;
+	}
+	_messagesWritten += count;
+	setState(stateDialogs(DownloadProgress()));
+	if (_slicesWriting < kSlicesWritingLimit) {
+		_api.resumeMessages();
+	}
+	if (!_slicesWriting && _slicesWritten) {
+		base::take(_slicesWritten)();
+	}
+}
+
+void ControllerObject::afterDialogSlicesWritten(FnMut<void()> callback) {
+	Expects(!_slicesWritten);
+
+	if (!_slicesWriting) {
+		callback();
+	} else {
+		_slicesWritten = std::move(callback);
+	}
+}
+
 template <typename Callback>
 ProcessingState ControllerObject::prepareState(
 		Step step,
@@ -578,9 +730,42 @@ int ControllerObject::substepsInStep(Step step) const {
 	return _substepsInStep[static_cast<int>(step)];
 }
 
+Output::Result ControllerObject::writeSummary() const {
+	using Output::Phase;
+	const auto line = [](const QString &label, const QString &value) {
+		return (label + ": " + value + '\n').toUtf8();
+	};
+	const auto time = [](crl::time value) {
+		return QString::number(value / 1000., 'f', 1) + " s";
+	};
+	const auto elapsed = std::max(crl::now() - _started, crl::time(1));
+	const auto bytes = _stats.bytesCount();
+	auto block = QByteArray();
+	block.append(line("Elapsed", time(elapsed)));
+	block.append(line("Files", QString::number(_stats.filesCount())));
+	block.append(line("Bytes", QString::number(bytes)));
+	block.append(line(
+		"Average speed",
+		QString::number(bytes * 1000 / elapsed) + " bytes/s"));
+
+	// Phases are summed over concurrent requests and files.
+	block.append(line("API wait", time(_stats.time(Phase::Api))));
+	block.append(line(
+		"File download",
+		time(_stats.time(Phase::Download))));
+	block.append(line("Formatting", time(_stats.time(Phase::Format))));
+	block.append(line("Disk write", time(_stats.time(Phase::Write))));
+
+	auto file = Output::File(_settings.path + kSummaryFileName, nullptr);
+	if (const auto result = file.writeBlock(block); !result) {
+		return result;
+	}
+	return file.finish();
+}
+
 void ControllerObject::setFinishedState() {
 	setState(FinishedState{
-		_writer->mainFilePath(),
+		_archive ? _archive->path() : _writer->mainFilePath(),
 		_stats.filesCount(),
 		_stats.bytesCount() });
 }
@@ -71,8 +71,15 @@ struct ProcessingState {
 	QString bytesName;
 	int bytesLoaded = 0;
 	int bytesCount = 0;
+
+	// Measured over the last seconds, remaining is -1 if unknown.
+	int64 bytesPerSecond = 0;
+	crl::time remaining = -1;
 };
 
+// Fraction of the whole export that is done.
+[[nodiscard]] float64 ProcessingProgress(const ProcessingState &state);
+
 struct ApiErrorState {
 	RPCError data;
 };
@@ -73,6 +73,9 @@ struct Settings {
 	bool forceSubPath = false;
 	Output::Format format = Output::Format();
 
+	// All the files are packed into one zip archive next to the path.
+	bool archive = false;
+
 	Types types = DefaultTypes();
 	Types fullChats = DefaultFullChats();
 	MediaSettings media;
@@ -7,9 +7,11 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #include "export/output/export_output_abstract.h"
 
+#include "export/output/export_output_archive.h"
 #include "export/output/export_output_text.h"
 #include "export/output/export_output_html.h"
 #include "export/output/export_output_json.h"
+#include "export/output/export_output_manifest.h"
 #include "export/output/export_output_stats.h"
 #include "export/output/export_output_result.h"
 
@@ -23,26 +25,48 @@ QString NormalizePath(const Settings &settings) {
 	QDir folder(settings.path);
 	const auto path = folder.absolutePath();
 	auto result = path.endsWith('/') ? path : (path + '/');
-	if (!folder.exists() && !settings.forceSubPath) {
+
+	// Archives are not resumed and always get a separate name.
+	const auto forceSubPath = settings.forceSubPath || settings.archive;
+	if (!folder.exists() && !forceSubPath) {
+		return result;
+	} else if (!settings.archive && Manifest::CanResume(result, settings)) {
 		return result;
 	}
 	const auto mode = QDir::AllEntries | QDir::NoDotAndDotDot;
-	const auto list = folder.entryInfoList(mode);
-	if (list.isEmpty() && !settings.forceSubPath) {
+	const auto list = folder.entryInfoList(mode, QDir::Time);
+	if (list.isEmpty() && !forceSubPath) {
 		return result;
 	}
+	const auto prefix = QString(settings.onlySinglePeer()
+		? "ChatExport_"
+		: "DataExport_");
+
+	// Continue the latest interrupted export with the same settings.
+	for (const auto &info : list) {
+		const auto subPath = result + info.fileName() + '/';
+		if (!settings.archive
+			&& info.isDir()
+			&& info.fileName().startsWith(prefix)
+			&& Manifest::CanResume(subPath, settings)) {
+			return subPath;
+		}
+	}
 	const auto date = QDate::currentDate();
-	const auto base = QString(settings.onlySinglePeer()
-		? "ChatExport_%1_%2_%3"
-		: "DataExport_%1_%2_%3"
+	const auto base = QString(prefix + "%1_%2_%3"
 	).arg(date.day(), 2, 10, QChar('0')
 	).arg(date.month(), 2, 10, QChar('0')
 	).arg(date.year());
 	const auto add = [&](int i) {
 		return base + (i ? " (" + QString::number(i) + ')' : QString());
 	};
+	const auto exists = [&](int i) {
+		const auto subPath = result + add(i);
+		return QDir(subPath).exists()
+			|| QFile::exists(Archive::PathForFolder(subPath));
+	};
 	auto index = 0;
-	while (QDir(result + add(index)).exists()) {
+	while (exists(index)) {
 		++index;
 	}
 	result += add(index) + '/';
@@ -0,0 +1,434 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "export/output/export_output_archive.h"
+
+#include "export/output/export_output_result.h"
+
+#include <QtCore/QFileInfo>
+#include <QtCore/QDir>
+#include <QtCore/QDateTime>
+
+#include "zip.h"
+
+namespace Export {
+namespace Output {
+namespace {
+
+constexpr auto kDeflateChunk = 64 * 1024;
+constexpr auto kUtf8NamesFlag = uLong(1 << 11);
+constexpr auto kZip64Size = ZPOS64_T(0xFFFFFFFFU);
+
+QMutex RegistryMutex;
+std::vector<std::weak_ptr<Archive>> Registry;
+
+bool Deflated(const QString &name) {
+	const auto extension = QFileInfo(name).suffix().toLower();
+	return (extension == qstr("html"))
+		|| (extension == qstr("css"))
+		|| (extension == qstr("js"))
+		|| (extension == qstr("json"))
+		|| (extension == qstr("txt"))
+		|| (extension == qstr("csv"));
+}
+
+zip_fileinfo PrepareFileInfo() {
+	const auto now = QDateTime::currentDateTime();
+	auto result = zip_fileinfo();
+	result.tmz_date.tm_sec = now.time().second();
+	result.tmz_date.tm_min = now.time().minute();
+	result.tmz_date.tm_hour = now.time().hour();
+	result.tmz_date.tm_mday = now.date().day();
+	result.tmz_date.tm_mon = now.date().month() - 1;
+	result.tmz_date.tm_year = now.date().year();
+	return result;
+}
+
+voidpf ZCALLBACK Open(voidpf opaque, const void *filename, int mode) {
+	const auto file = static_cast<QFile*>(opaque);
+	const auto flags = (mode & ZLIB_FILEFUNC_MODE_CREATE)
+		? (QIODevice::ReadWrite | QIODevice::Truncate)
+		: QIODevice::ReadWrite;
+	return file->open(flags) ? file : nullptr;
+}
+
+uLong ZCALLBACK Read(voidpf opaque, voidpf stream, void *buf, uLong size) {
+	const auto file = static_cast<QFile*>(stream);
+	const auto result = file->read(static_cast<char*>(buf), size);
+	return (result > 0) ? uLong(result) : 0;
+}
+
+uLong ZCALLBACK Write(
+		voidpf opaque,
+		voidpf stream,
+		const void *buf,
+		uLong size) {
+	const auto file = static_cast<QFile*>(stream);
+	const auto result = file->write(static_cast<const char*>(buf), size);
+	return (result > 0) ? uLong(result) : 0;
+}
+
+ZPOS64_T ZCALLBACK Tell(voidpf opaque, voidpf stream) {
+	return static_cast<QFile*>(stream)->pos();
+}
+
+long ZCALLBACK Seek(
+		voidpf opaque,
+		voidpf stream,
+		ZPOS64_T offset,
+		int origin) {
+	const auto file = static_cast<QFile*>(stream);
+	const auto base = [&]() -> qint64 {
+		switch (origin) {
+		case ZLIB_FILEFUNC_SEEK_SET: return 0;
+		case ZLIB_FILEFUNC_SEEK_CUR: return file->pos();
+		case ZLIB_FILEFUNC_SEEK_END: return file->size();
+		}
+		return -1;
+	}();
+	return (base >= 0 && file->seek(base + qint64(offset))) ? 0 : -1;
+}
+
+int ZCALLBACK Close(voidpf opaque, voidpf stream) {
+	const auto file = static_cast<QFile*>(stream);
+	const auto flushed = file->flush();
+	file->close();
+	return flushed ? 0 : -1;
+}
+
+int ZCALLBACK Error(voidpf opaque, voidpf stream) {
+	const auto file = static_cast<QFile*>(stream);
+	return (file->error() != QFileDevice::NoError) ? -1 : 0;
+}
+
+} // namespace
+
+struct Archive::Deflater {
+	Deflater();
+	~Deflater();
+
+	[[nodiscard]] bool append(
+		const QByteArray &block,
+		QByteArray &output,
+		bool last);
+
+	z_stream stream = z_stream();
+	uLong crc = crc32(0, nullptr, 0);
+	ZPOS64_T size = 0;
+	bool initialized = false;
+};
+
+Archive::Deflater::Deflater() {
+	initialized = (deflateInit2(
+		&stream,
+		Z_DEFAULT_COMPRESSION,
+		Z_DEFLATED,
+		-MAX_WBITS,
+		DEF_MEM_LEVEL,
+		Z_DEFAULT_STRATEGY) == Z_OK);
+}
+
+Archive::Deflater::~Deflater() {
+	if (initialized) {
+		deflateEnd(&stream);
+	}
+}
+
+bool Archive::Deflater::append(
+		const QByteArray &block,
+		QByteArray &output,
+		bool last) {
+	if (!initialized) {
+		return false;
+	}
+	const auto bytes = reinterpret_cast<const Bytef*>(block.constData());
+	crc = crc32(crc, bytes, block.size());
+	size += block.size();
+
+	stream.next_in = const_cast<Bytef*>(bytes);
+	stream.avail_in = block.size();
+	while (true) {
+		const auto offset = output.size();
+		output.resize(offset + kDeflateChunk);
+		stream.next_out = reinterpret_cast<Bytef*>(output.data() + offset);
+		stream.avail_out = kDeflateChunk;
+		const auto code = deflate(&stream, last ? Z_FINISH : Z_NO_FLUSH);
+		output.resize(output.size() - stream.avail_out);
+		if (code == Z_STREAM_ERROR) {
+			return false;
+		} else if (last ? (code == Z_STREAM_END) : (stream.avail_out > 0)) {
+			return true;
+		}
+	}
+}
+
+QString Archive::PathForFolder(const QString &folder) {
+	const auto path = folder.endsWith('/') ? folder.chopped(1) : folder;
+	return path + ".zip";
+}
+
+std::shared_ptr<Archive> Archive::Find(const QString &path) {
+	QMutexLocker lock(&RegistryMutex);
+	for (const auto &weak : Registry) {
+		if (const auto strong = weak.lock()) {
+			if (path.startsWith(strong->_folder)) {
+				return strong;
+			}
+		}
+	}
+	return nullptr;
+}
+
+Archive::Archive(const QString &folder)
+: _folder(folder.endsWith('/') ? folder : (folder + '/'))
+, _path(PathForFolder(folder))
+, _file(_path) {
+}
+
+Archive::~Archive() {
+	closeHandle();
+}
+
+QString Archive::path() const {
+	return _path;
+}
+
+Result Archive::start() {
+	const auto dir = QFileInfo(_path).absoluteDir();
+	if (!dir.exists() && !dir.mkpath(dir.absolutePath())) {
+		return error();
+	}
+	auto funcs = zlib_filefunc64_def();
+	funcs.zopen64_file = Open;
+	funcs.zread_file = Read;
+	funcs.zwrite_file = Write;
+	funcs.ztell64_file = Tell;
+	funcs.zseek64_file = Seek;
+	funcs.zclose_file = Close;
+	funcs.zerror_file = Error;
+	funcs.opaque = &_file;
+	_handle = zipOpen2_64(nullptr, APPEND_STATUS_CREATE, nullptr, &funcs);
+	if (!_handle) {
+		return error();
+	}
+	QMutexLocker lock(&RegistryMutex);
+	Registry.push_back(shared_from_this());
+	return Result::Success();
+}
+
+bool Archive::contains(const QString &path) const {
+	QMutexLocker lock(&_mutex);
+	return path.startsWith(_folder)
+		&& _names.contains(path.mid(_folder.size()));
+}
+
+uint64 Archive::add(const QString &path) {
+	Expects(path.startsWith(_folder));
+
+	QMutexLocker lock(&_mutex);
+	auto entry = Entry();
+	entry.name = path.mid(_folder.size());
+	if (Deflated(entry.name)) {
+		entry.deflater = std::make_unique<Deflater>();
+	}
+	_names.emplace(entry.name);
+	const auto id = ++_entryIdLast;
+	_entries.emplace(id, std::move(entry));
+	return id;
+}
+
+Result Archive::write(uint64 id, const QByteArray &block) {
+	QMutexLocker lock(&_mutex);
+	if (_failed) {
+		return error();
+	}
+	const auto i = _entries.find(id);
+	if (i == end(_entries) || i->second.closed) {
+		return error();
+	}
+	auto &entry = i->second;
+	if (entry.deflater) {
+		return entry.deflater->append(block, entry.data, false)
+			? Result::Success()
+			: error();
+	} else if (!_streaming) {
+		if (const auto result = startStreaming(id); !result) {
+			return result;
+		}
+	}
+	if (_streaming != id) {
+		entry.data.append(block);
+		return Result::Success();
+	}
+	return check(zipWriteInFileInZip(
+		_handle,
+		block.constData(),
+		block.size()));
+}
+
+Result Archive::close(uint64 id) {
+	QMutexLocker lock(&_mutex);
+	if (_failed) {
+		return error();
+	}
+	const auto i = _entries.find(id);
+	if (i == end(_entries)) {
+		return Result::Success();
+	}
+	i->second.closed = true;
+	if (_streaming == id) {
+		if (const auto result = closeStreaming(); !result) {
+			return result;
+		}
+	} else if (_streaming) {
+		return Result::Success();
+	}
+	return writeWaiting(false);
+}
+
+Result Archive::finish() {
+	{
+		QMutexLocker lock(&RegistryMutex);
+		Registry.erase(ranges::remove_if(Registry, [&](const auto &weak) {
+			const auto strong = weak.lock();
+			return !strong || (strong.get() == this);
+		}), end(Registry));
+	}
+	QMutexLocker lock(&_mutex);
+	if (_failed) {
+		return error();
+	} else if (_streaming) {
+		if (const auto result = closeStreaming(); !result) {
+			return result;
+		}
+	}
+	if (const auto result = writeWaiting(true); !result) {
+		return result;
+	}
+	const auto result = check(zipClose(_handle, nullptr));
+	_handle = nullptr;
+	return result;
+}
+
+Result Archive::startStreaming(uint64 id) {
+	Expects(!_streaming);
+
+	const auto i = _entries.find(id);
+	Assert(i != end(_entries));
+
+	auto &entry = i->second;
+	if (const auto result = openEntry(entry, false, 0); !result) {
+		return result;
+	}
+	_streaming = id;
+	const auto data = base::take(entry.data);
+	return data.isEmpty()
+		? Result::Success()
+		: check(zipWriteInFileInZip(_handle, data.constData(), data.size()));
+}
+
+Result Archive::closeStreaming() {
+	Expects(_streaming != 0);
+
+	_entries.remove(base::take(_streaming));
+	return check(zipCloseFileInZip(_handle));
+}
+
+Result Archive::writeWaiting(bool all) {
+	Expects(!_streaming);
+
+	// Closed files are written whole, then the first stored file
+	// that is still being written continues as the stream.
+	for (auto i = begin(_entries); i != end(_entries);) {
+		if (!all && !i->second.closed) {
+			++i;
+			continue;
+		} else if (const auto result = writeWhole(i->second); !result) {
+			return result;
+		}
+		i = _entries.erase(i);
+	}
+	for (const auto &[id, entry] : _entries) {
+		if (!entry.deflater) {
+			return startStreaming(id);
+		}
+	}
+	return Result::Success();
+}
+
+Result Archive::writeWhole(Entry &entry) {
+	const auto deflater = entry.deflater.get();
+	if (deflater && !deflater->append(QByteArray(), entry.data, true)) {
+		return error();
+	}
+	const auto size = deflater ? deflater->size : entry.data.size();
+	if (const auto result = openEntry(entry, true, size); !result) {
+		return result;
+	} else if (!entry.data.isEmpty()) {
+		const auto result = check(zipWriteInFileInZip(
+			_handle,
+			entry.data.constData(),
+			entry.data.size()));
+		if (!result) {
+			return result;
+		}
+	}
+	return check(deflater
+		? zipCloseFileInZipRaw64(_handle, deflater->size, deflater->crc)
+		: zipCloseFileInZip(_handle));
+}
+
+Result Archive::openEntry(
+		const Entry &entry,
+		bool whole,
+		uint64 size) {
+	const auto info = PrepareFileInfo();
+	const auto name = entry.name.toUtf8();
+	const auto deflated = (entry.deflater != nullptr);
+	return check(zipOpenNewFileInZip4_64(
+		_handle,
+		name.constData(),
+		&info,
+		nullptr,
+		0,
+		nullptr,
+		0,
+		nullptr,
+		deflated ? Z_DEFLATED : 0,
+		deflated ? Z_DEFAULT_COMPRESSION : 0,
+		deflated ? 1 : 0,
+		-MAX_WBITS,
+		DEF_MEM_LEVEL,
+		Z_DEFAULT_STRATEGY,
+		nullptr,
+		0,
+		0,
+		kUtf8NamesFlag,
+		(whole && size >= kZip64Size) ? 1 : 0));
+}
+
+Result Archive::check(int code) {
+	return (code == ZIP_OK) ? Result::Success() : error();
+}
+
+Result Archive::error() {
+	_failed = true;
+	return Result(Result::Type::FatalError, _path);
+}
+
+void Archive::closeHandle() {
+	if (_handle) {
+		if (_streaming) {
+			zipCloseFileInZip(_handle);
+		}
+		zipClose(_handle, nullptr);
+		_handle = nullptr;
+	}
+}
+
+} // namespace Output
+} // namespace Export
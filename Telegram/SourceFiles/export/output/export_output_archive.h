@@ -0,0 +1,91 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/flat_map.h"
+#include "base/flat_set.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QString>
+#include <QtCore/QByteArray>
+#include <QtCore/QMutex>
+
+namespace Export {
+namespace Output {
+
+struct Result;
+
+// A single zip archive with all the files of an export folder. Media are
+// stored as is, text files are deflated in memory while they're written.
+// ZIP entries can't interleave, so one stored file streams right into the
+// archive and the others wait in memory until it is closed.
+class Archive final : public std::enable_shared_from_this<Archive> {
+public:
+	// The export folder is not created, the archive is put next to it.
+	[[nodiscard]] static QString PathForFolder(const QString &folder);
+
+	// The started archive with the folder that contains this path, if any.
+	[[nodiscard]] static std::shared_ptr<Archive> Find(const QString &path);
+
+	explicit Archive(const QString &folder);
+	Archive(const Archive &other) = delete;
+	Archive &operator=(const Archive &other) = delete;
+	~Archive();
+
+	[[nodiscard]] Result start();
+
+	[[nodiscard]] QString path() const;
+	[[nodiscard]] bool contains(const QString &path) const;
+
+	// Reserves the name, returns the entry id for the following calls.
+	[[nodiscard]] uint64 add(const QString &path);
+	[[nodiscard]] Result write(uint64 id, const QByteArray &block);
+	[[nodiscard]] Result close(uint64 id);
+
+	// Writes all files left and the central directory.
+	[[nodiscard]] Result finish();
+
+private:
+	struct Deflater;
+	struct Entry {
+		QString name;
+
+		// Stored bytes waiting for the stream or the deflated content.
+		QByteArray data;
+		std::unique_ptr<Deflater> deflater;
+		bool closed = false;
+	};
+
+	[[nodiscard]] Result startStreaming(uint64 id);
+	[[nodiscard]] Result closeStreaming();
+	[[nodiscard]] Result writeWhole(Entry &entry);
+	[[nodiscard]] Result writeWaiting(bool all);
+	[[nodiscard]] Result openEntry(
+		const Entry &entry,
+		bool whole,
+		uint64 size);
+	[[nodiscard]] Result check(int code);
+	[[nodiscard]] Result error();
+	void closeHandle();
+
+	QString _folder;
+	QString _path;
+	QFile _file;
+	void *_handle = nullptr;
+	bool _failed = false;
+
+	mutable QMutex _mutex;
+	base::flat_set<QString> _names;
+	base::flat_map<uint64, Entry> _entries;
+	uint64 _entryIdLast = 0;
+	uint64 _streaming = 0;
+
+};
+
+} // namespace Output
+} // namespace Export
@@ -7,6 +7,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #include "export/output/export_output_file.h"
 
+#include "export/output/export_output_archive.h"
 #include "export/output/export_output_result.h"
 #include "export/output/export_output_stats.h"
 
@@ -15,33 +16,90 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include <gsl/gsl_util>
 
+#ifdef Q_OS_WIN
+#include <io.h>
+#else // Q_OS_WIN
+#include <unistd.h>
+#endif // Q_OS_WIN
+
 namespace Export {
 namespace Output {
 
-File::File(const QString &path, Stats *stats) : _path(path), _stats(stats) {
-}
+namespace {
 
-int File::size() const {
-	return _offset;
+constexpr auto kWriteBehindSize = 1024 * 1024;
+
+crl::queue &Queue() {
+	static auto result = crl::queue();
+	return result;
 }
 
-bool File::empty() const {
-	return !_offset;
+bool SyncToDisk(QFile &file) {
+	if (!file.flush()) {
+		return false;
+	}
+	const auto handle = file.handle();
+#ifdef Q_OS_WIN
+	return (handle < 0) || !_commit(handle);
+#else // Q_OS_WIN
+	return (handle < 0) || !fsync(handle);
+#endif // Q_OS_WIN
 }
 
-Result File::writeBlock(const QByteArray &block) {
-	const auto result = writeBlockAttempt(block);
+} // namespace
+
+// Everything here is used only on the I/O queue after the first block.
+struct File::Shared {
+	Shared(const QString &path, Stats *stats)
+	: path(path)
+	, stats(stats)
+	, archive(Archive::Find(path)) {
+	}
+
+	[[nodiscard]] Result write(const QByteArray &block);
+	[[nodiscard]] Result writeAttempt(const QByteArray &block);
+	[[nodiscard]] Result reopen();
+	[[nodiscard]] Result sync();
+	[[nodiscard]] Result close();
+
+	[[nodiscard]] Result error() const;
+	[[nodiscard]] Result fatalError() const;
+
+	void setResult(const Result &value);
+	[[nodiscard]] Result result() const;
+
+	QString path;
+	Stats *stats = nullptr;
+	int offset = 0;
+	std::optional<QFile> file;
+
+	// Instead of the file, if the export is written to an archive.
+	std::shared_ptr<Archive> archive;
+	uint64 entry = 0;
+
+	mutable QMutex mutex;
+	Result failed = Result::Success();
+};
+
+Result File::Shared::write(const QByteArray &block) {
+	if (const auto previous = result(); !previous) {
+		return previous;
+	}
+	const auto started = crl::now();
+	const auto result = archive
+		? archive->write(entry, block)
+		: writeAttempt(block);
+	if (stats) {
+		stats->addTime(Phase::Write, crl::now() - started);
+	}
 	if (!result) {
-		_file.reset();
+		file.reset();
+		setResult(result);
 	}
 	return result;
 }
 
-Result File::writeBlockAttempt(const QByteArray &block) {
-	if (_stats && !_inStats) {
-		_inStats = true;
-		_stats->incrementFiles();
-	}
+Result File::Shared::writeAttempt(const QByteArray &block) {
 	if (const auto result = reopen(); !result) {
 		return result;
 	}
@@ -49,54 +107,175 @@ Result File::writeBlockAttempt(const QByteArray &block) {
 	if (!size) {
 		return Result::Success();
 	}
-	if (_file->write(block) == size && _file->flush()) {
-		_offset += size;
-		if (_stats) {
-			_stats->incrementBytes(size);
-		}
+	if (file->write(block) == size && file->flush()) {
+		offset += size;
 		return Result::Success();
 	}
 	return error();
 }
 
-Result File::reopen() {
-	if (_file && _file->isOpen()) {
+Result File::Shared::reopen() {
+	if (file && file->isOpen()) {
 		return Result::Success();
 	}
-	_file.emplace(_path);
-	if (_file->exists()) {
-		if (_file->size() < _offset) {
+	file.emplace(path);
+	if (file->exists()) {
+		if (file->size() < offset) {
 			return fatalError();
-		} else if (!_file->resize(_offset)) {
+		} else if (!file->resize(offset)) {
 			return error();
 		}
-	} else if (_offset > 0) {
+	} else if (offset > 0) {
 		return fatalError();
 	}
-	if (_file->open(QIODevice::Append)) {
+	if (file->open(QIODevice::Append)) {
 		return Result::Success();
 	}
-	const auto info = QFileInfo(_path);
+	const auto info = QFileInfo(path);
 	const auto dir = info.absoluteDir();
 	return (!dir.exists()
 		&& dir.mkpath(dir.absolutePath())
-		&& _file->open(QIODevice::Append))
+		&& file->open(QIODevice::Append))
 		? Result::Success()
 		: error();
 }
 
-Result File::error() const {
-	return Result(Result::Type::Error, _path);
+Result File::Shared::sync() {
+	if (const auto previous = result(); !previous) {
+		return previous;
+	} else if (file && file->isOpen() && !SyncToDisk(*file)) {
+		const auto result = error();
+		setResult(result);
+		return result;
+	}
+	return Result::Success();
+}
+
+Result File::Shared::close() {
+	if (const auto previous = result(); !previous) {
+		return previous;
+	} else if (archive) {
+		const auto result = archive->close(entry);
+		if (!result) {
+			setResult(result);
+		}
+		return result;
+	}
+	return Result::Success();
+}
+
+Result File::Shared::error() const {
+	return Result(Result::Type::Error, path);
+}
+
+Result File::Shared::fatalError() const {
+	return Result(Result::Type::FatalError, path);
 }
 
-Result File::fatalError() const {
-	return Result(Result::Type::FatalError, _path);
+void File::Shared::setResult(const Result &value) {
+	QMutexLocker lock(&mutex);
+	if (failed) {
+		failed = value;
+	}
+}
+
+Result File::Shared::result() const {
+	QMutexLocker lock(&mutex);
+	return failed;
+}
+
+File::File(const QString &path, Stats *stats)
+: _path(path)
+, _shared(std::make_shared<Shared>(path, stats))
+, _stats(stats) {
+}
+
+File::~File() {
+	(void)finish();
+}
+
+int File::size() const {
+	return _offset;
+}
+
+bool File::empty() const {
+	return !_offset;
+}
+
+Result File::writeBlock(const QByteArray &block) {
+	if (const auto result = lastResult(); !result) {
+		return result;
+	}
+	if (_stats && !_inStats) {
+		_inStats = true;
+		_stats->incrementFiles();
+	}
+	const auto size = block.size();
+	if (!_created) {
+		// Create the file right away, so that PrepareRelativePath()
+		// won't choose the same path for some other file.
+		_created = true;
+		if (_shared->archive) {
+			_shared->entry = _shared->archive->add(_path);
+			_buffer.append(block);
+		} else if (const auto result = _shared->write(block); !result) {
+			return result;
+		}
+	} else if (!size) {
+		return Result::Success();
+	} else {
+		_buffer.append(block);
+		if (_buffer.size() >= kWriteBehindSize) {
+			writeBuffered();
+		}
+	}
+	_offset += size;
+	if (_stats) {
+		_stats->incrementBytes(size);
+	}
+	return Result::Success();
+}
+
+void File::writeBuffered() {
+	if (_buffer.isEmpty()) {
+		return;
+	}
+	Queue().async([shared = _shared, buffer = base::take(_buffer)] {
+		(void)shared->write(buffer);
+	});
+}
+
+Result File::finish(bool sync) {
+	writeBuffered();
+	if (!_created) {
+		return Result::Success();
+	}
+	crl::semaphore semaphore;
+	Queue().async([&] {
+		if (_shared->archive) {
+			(void)_shared->close();
+		} else if (sync) {
+			(void)_shared->sync();
+		}
+		semaphore.release();
+	});
+	semaphore.acquire();
+	return lastResult();
+}
+
+Result File::lastResult() const {
+	return _shared->result();
+}
+
+bool File::Exists(const QString &path) {
+	const auto archive = Archive::Find(path);
+	return archive ? archive->contains(path) : QFile::exists(path);
 }
 
 QString File::PrepareRelativePath(
 		const QString &folder,
 		const QString &suggested) {
-	if (!QFile::exists(folder + suggested)) {
+	if (!Exists(folder + suggested)) {
 		return suggested;
 	}
 
@@ -114,7 +293,7 @@ QString File::PrepareRelativePath(
 	auto attempt = 0;
 	while (true) {
 		const auto relativePath = relativePart(++attempt);
-		if (!QFile::exists(folder + relativePath)) {
+		if (!Exists(folder + relativePath)) {
 			return relativePath;
 		}
 	}
@@ -132,7 +311,11 @@ Result File::Copy(
 	if (bytes.size() != f.size()) {
 		return Result(Result::Type::FatalError, source);
 	}
-	return File(path, stats).writeBlock(bytes);
+	auto file = File(path, stats);
+	if (const auto result = file.writeBlock(bytes); !result) {
+		return result;
+	}
+	return file.finish();
 }
 
 } // namespace Output
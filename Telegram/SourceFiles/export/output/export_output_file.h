@@ -12,6 +12,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <QtCore/QFile>
 #include <QtCore/QString>
 #include <QtCore/QByteArray>
+#include <QtCore/QMutex>
 
 namespace Export {
 namespace Output {
@@ -22,12 +23,25 @@ class Stats;
 class File {
 public:
 	File(const QString &path, Stats *stats);
+	File(const File &other) = delete;
+	File &operator=(const File &other) = delete;
+	~File();
 
 	[[nodiscard]] int size() const;
 	[[nodiscard]] bool empty() const;
 
+	// The file is created by the first block, next blocks are collected
+	// and written in large chunks on the I/O queue. A failed write is
+	// reported by one of the following writeBlock() or finish() calls.
 	[[nodiscard]] Result writeBlock(const QByteArray &block);
 
+	// Waits until everything is written, optionally syncing it to disk.
+	// An archive entry is closed by it and can't be written any more.
+	[[nodiscard]] Result finish(bool sync = false);
+
+	// Checks the export archive instead of the disk, if it is used.
+	[[nodiscard]] static bool Exists(const QString &path);
+
 	[[nodiscard]] static QString PrepareRelativePath(
 		const QString &folder,
 		const QString &suggested);
@@ -38,15 +52,16 @@ public:
 		Stats *stats);
 
 private:
-	[[nodiscard]] Result reopen();
-	[[nodiscard]] Result writeBlockAttempt(const QByteArray &block);
+	struct Shared;
 
-	[[nodiscard]] Result error() const;
-	[[nodiscard]] Result fatalError() const;
+	void writeBuffered();
+	[[nodiscard]] Result lastResult() const;
 
 	QString _path;
 	int _offset = 0;
-	std::optional<QFile> _file;
+	QByteArray _buffer;
+	bool _created = false;
+	std::shared_ptr<Shared> _shared;
 
 	Stats *_stats = nullptr;
 	bool _inStats = false;
@@ -1100,7 +1100,10 @@ Result JsonWriter::finish() {
 
 	auto block = popNesting();
 	Assert(_context.nesting.empty());
-	return _output->writeBlock(block);
+	if (const auto result = _output->writeBlock(block); !result) {
+		return result;
+	}
+	return _output->finish(true);
 }
 
 QString JsonWriter::mainFilePath() {
@@ -0,0 +1,134 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "export/output/export_output_manifest.h"
+
+#include "export/export_settings.h"
+#include "export/output/export_output_abstract.h"
+#include "export/output/export_output_result.h"
+
+#include <QtCore/QFileInfo>
+#include <QtCore/QDir>
+
+namespace Export {
+namespace Output {
+namespace {
+
+constexpr auto kManifestName = "export_resume.txt";
+constexpr auto kManifestVersion = 1;
+
+QString PeerFingerprint(const MTPInputPeer &peer) {
+	return peer.match([](const MTPDinputPeerUser &data) {
+		return 'u' + QString::number(data.vuser_id().v);
+	}, [](const MTPDinputPeerChat &data) {
+		return 'c' + QString::number(data.vchat_id().v);
+	}, [](const MTPDinputPeerChannel &data) {
+		return 'h' + QString::number(data.vchannel_id().v);
+	}, [](const auto &data) {
+		return QString();
+	});
+}
+
+// Everything that changes the list of the exported files.
+QByteArray Header(const Settings &settings) {
+	return QString("TDESKTOP_EXPORT %1 %2 %3 %4 %5 %6 %7 %8 %9\n").arg(
+		QString::number(kManifestVersion),
+		QString::number(int(settings.format)),
+		QString::number(int(settings.types.value())),
+		QString::number(int(settings.fullChats.value())),
+		QString::number(int(settings.media.types.value())),
+		QString::number(settings.media.sizeLimit),
+		PeerFingerprint(settings.singlePeer),
+		QString::number(settings.singlePeerFrom),
+		QString::number(settings.singlePeerTill)
+	).toUtf8();
+}
+
+QString ManifestPath(const QString &folder) {
+	return folder + kManifestName;
+}
+
+} // namespace
+
+Manifest::Manifest(const QString &folder, const Settings &settings)
+: _folder(folder)
+, _file(ManifestPath(folder)) {
+	const auto header = Header(settings);
+	if (CanResume(folder, settings) && _file.open(QIODevice::ReadOnly)) {
+		(void)_file.readLine();
+		while (!_file.atEnd()) {
+			const auto line = QString::fromUtf8(_file.readLine()).trimmed();
+			const auto key = line.section('\t', 0, 0);
+			const auto size = line.section('\t', 1, 1).toInt();
+			const auto relativePath = line.section('\t', 2);
+			if (!key.isEmpty() && size > 0 && !relativePath.isEmpty()) {
+				_entries[key] = Entry{ relativePath, size };
+			}
+		}
+		_file.close();
+		if (_file.open(QIODevice::Append)) {
+			return;
+		}
+	}
+	_entries.clear();
+	if (QDir().mkpath(folder) && _file.open(QIODevice::WriteOnly)) {
+		_file.write(header);
+		_file.flush();
+	}
+}
+
+bool Manifest::CanResume(const QString &folder, const Settings &settings) {
+	auto file = QFile(ManifestPath(folder));
+	return file.open(QIODevice::ReadOnly)
+		&& (file.readLine() == Header(settings));
+}
+
+std::optional<QString> Manifest::find(const QString &key) const {
+	const auto i = _entries.find(key);
+	if (i == end(_entries)) {
+		return std::nullopt;
+	}
+	const auto info = QFileInfo(_folder + i->second.relativePath);
+	if (!info.isFile() || info.size() != i->second.size) {
+		return std::nullopt;
+	}
+	return i->second.relativePath;
+}
+
+Result Manifest::add(
+		const QString &key,
+		const QString &relativePath,
+		int size) {
+	if (size <= 0) {
+		return Result::Success();
+	} else if (!_file.isOpen()) {
+		return error();
+	}
+	_entries[key] = Entry{ relativePath, size };
+	const auto line = (key
+		+ '\t'
+		+ QString::number(size)
+		+ '\t'
+		+ relativePath
+		+ '\n').toUtf8();
+	return (_file.write(line) == line.size() && _file.flush())
+		? Result::Success()
+		: error();
+}
+
+void Manifest::remove() {
+	_file.close();
+	_file.remove();
+	_entries.clear();
+}
+
+Result Manifest::error() const {
+	return Result(Result::Type::Error, _file.fileName());
+}
+
+} // namespace Output
+} // namespace Export
@@ -0,0 +1,58 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/flat_map.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QString>
+
+namespace Export {
+
+struct Settings;
+
+namespace Output {
+
+struct Result;
+
+// Media files already written to the export folder. When an interrupted
+// export is started again with the same settings in the same folder it
+// skips the files that are still there with the same size.
+class Manifest final {
+public:
+	Manifest(const QString &folder, const Settings &settings);
+
+	[[nodiscard]] static bool CanResume(
+		const QString &folder,
+		const Settings &settings);
+
+	[[nodiscard]] std::optional<QString> find(const QString &key) const;
+	[[nodiscard]] Result add(
+		const QString &key,
+		const QString &relativePath,
+		int size);
+
+	// The export has finished, nothing is left to resume.
+	void remove();
+
+private:
+	struct Entry {
+		QString relativePath;
+		int size = 0;
+	};
+
+	[[nodiscard]] Result error() const;
+
+	QString _folder;
+	QFile _file;
+	base::flat_map<QString, Entry> _entries;
+
+};
+
+} // namespace Output
+} // namespace Export
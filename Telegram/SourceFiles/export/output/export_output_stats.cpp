@@ -13,6 +13,9 @@ namespace Output {
 Stats::Stats(const Stats &other)
 : _files(other._files.load())
 , _bytes(other._bytes.load()) {
+	for (auto i = 0; i != kPhasesCount; ++i) {
+		_times[i] = other._times[i].load();
+	}
 }
 
 void Stats::incrementFiles() {
@@ -23,6 +26,10 @@ void Stats::incrementBytes(int count) {
 	_bytes += count;
 }
 
+void Stats::addTime(Phase phase, crl::time duration) {
+	_times[static_cast<int>(phase)] += duration;
+}
+
 int Stats::filesCount() const {
 	return _files;
 }
@@ -31,5 +38,9 @@ int64 Stats::bytesCount() const {
 	return _bytes;
 }
 
+crl::time Stats::time(Phase phase) const {
+	return _times[static_cast<int>(phase)];
+}
+
 } // namespace Output
 } // namespace Export
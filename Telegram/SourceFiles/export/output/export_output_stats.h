@@ -7,11 +7,21 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #pragma once
 
+#include <array>
 #include <atomic>
 
 namespace Export {
 namespace Output {
 
+// Time spent in each phase is summed over all the concurrent requests.
+enum class Phase {
+	Api,
+	Download,
+	Format,
+	Write,
+};
+constexpr auto kPhasesCount = 4;
+
 class Stats {
 public:
 	Stats() = default;
@@ -19,13 +29,16 @@ public:
 
 	void incrementFiles();
 	void incrementBytes(int count);
+	void addTime(Phase phase, crl::time duration);
 
 	int filesCount() const;
 	int64 bytesCount() const;
+	crl::time time(Phase phase) const;
 
 private:
-	std::atomic<int> _files;
-	std::atomic<int64> _bytes;
+	std::atomic<int> _files = 0;
+	std::atomic<int64> _bytes = 0;
+	std::array<std::atomic<crl::time>, kPhasesCount> _times = {};
 
 };
 
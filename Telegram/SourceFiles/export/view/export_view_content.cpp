@@ -32,26 +32,7 @@ Content ContentFromState(const ProcessingState &state) {
 				+ " / "
 				+ QString::number(state.entityCount))
 			: QString();
-		if (!state.substepsTotal) {
-			push("main", label, info, 0.);
-			return;
-		}
-		const auto substepsTotal = state.substepsTotal;
-		const auto step = static_cast<int>(state.step);
-		const auto done = state.substepsPassed;
-		const auto add = state.substepsNow;
-		const auto doneProgress = done / float64(substepsTotal);
-		const auto addPart = [&](int index, int count) {
-			return (count > 0)
-				? ((float64(add) * index)
-					/ (float64(substepsTotal) * count))
-				: 0.;
-		};
-		const auto addProgress = (state.entityCount == 1
-			&& !state.entityIndex)
-			? addPart(state.itemIndex, state.itemCount)
-			: addPart(state.entityIndex, state.entityCount);
-		push("main", label, info, doneProgress + addProgress);
+		push("main", label, info, ProcessingProgress(state));
 	};
 	const auto pushBytes = [&](const QString &id, const QString &label) {
 		if (!state.bytesCount) {
@@ -114,6 +95,21 @@ Content ContentFromState(const ProcessingState &state) {
 		break;
 	default: Unexpected("Step in ContentFromState.");
 	}
+	if (state.bytesPerSecond > 0) {
+		push(
+			"speed",
+			tr::lng_export_state_speed(
+				tr::now,
+				lt_speed,
+				formatSizeText(state.bytesPerSecond)),
+			((state.remaining >= 0)
+				? tr::lng_export_state_remaining(
+					tr::now,
+					lt_time,
+					formatDurationText(state.remaining / 1000))
+				: QString()),
+			ProcessingProgress(state));
+	}
 	while (result.rows.size() < 3) {
 		result.rows.emplace_back();
 	}
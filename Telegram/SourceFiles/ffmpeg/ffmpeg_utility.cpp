@@ -18,8 +18,15 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 extern "C" {
 #include <libavutil/opt.h>
+#include <libavutil/hwcontext.h>
+#include <libavutil/pixdesc.h>
 } // extern "C"
 
+// Hardware device contexts for decoders are available since FFmpeg 4.0.
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(58, 0, 0)
+#define TDESKTOP_FFMPEG_HW_DECODING
+#endif // LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(58, 0, 0)
+
 namespace FFmpeg {
 namespace {
 
@@ -30,6 +37,75 @@ constexpr auto kAvioBlockSize = 4096;
 constexpr auto kTimeUnknown = std::numeric_limits<crl::time>::min();
 constexpr auto kDurationMax = crl::time(std::numeric_limits<int>::max());
 
+#ifdef TDESKTOP_FFMPEG_HW_DECODING
+constexpr AVHWDeviceType kHwDeviceTypes[] = {
+#if defined Q_OS_WIN
+	AV_HWDEVICE_TYPE_D3D11VA,
+	AV_HWDEVICE_TYPE_DXVA2,
+#elif defined Q_OS_MAC // Q_OS_WIN
+	AV_HWDEVICE_TYPE_VIDEOTOOLBOX,
+#else // Q_OS_WIN || Q_OS_MAC
+	AV_HWDEVICE_TYPE_VAAPI,
+	AV_HWDEVICE_TYPE_VDPAU,
+#endif // Q_OS_WIN || Q_OS_MAC
+};
+
+[[nodiscard]] const AVCodecHWConfig *FindHwConfig(
+		not_null<const AVCodec*> codec,
+		AVHWDeviceType type) {
+	for (auto i = 0;; ++i) {
+		const auto config = avcodec_get_hw_config(codec, i);
+		if (!config) {
+			return nullptr;
+		} else if ((config->device_type == type)
+			&& (config->methods & AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX)) {
+			return config;
+		}
+	}
+}
+
+AVPixelFormat GetHwFormat(
+		AVCodecContext *context,
+		const AVPixelFormat *formats) {
+	const auto device = reinterpret_cast<AVHWDeviceContext*>(
+		context->hw_device_ctx->data);
+	if (const auto config = FindHwConfig(context->codec, device->type)) {
+		for (auto format = formats; *format != AV_PIX_FMT_NONE; ++format) {
+			if (*format == config->pix_fmt) {
+				return *format;
+			}
+		}
+	}
+
+	// This stream can't be decoded by hardware, fallback to software.
+	for (auto format = formats; *format != AV_PIX_FMT_NONE; ++format) {
+		const auto descriptor = av_pix_fmt_desc_get(*format);
+		if (!(descriptor->flags & AV_PIX_FMT_FLAG_HWACCEL)) {
+			return *format;
+		}
+	}
+	return AV_PIX_FMT_NONE;
+}
+
+bool InitHwDecoding(
+		not_null<AVCodecContext*> context,
+		not_null<const AVCodec*> codec) {
+	for (const auto type : kHwDeviceTypes) {
+		if (!FindHwConfig(codec, type)) {
+			continue;
+		}
+		auto device = (AVBufferRef*)nullptr;
+		if (av_hwdevice_ctx_create(&device, type, nullptr, nullptr, 0) < 0) {
+			continue;
+		}
+		context->hw_device_ctx = device;
+		context->get_format = GetHwFormat;
+		return true;
+	}
+	return false;
+}
+#endif // TDESKTOP_FFMPEG_HW_DECODING
+
 void AlignedImageBufferCleanupHandler(void* data) {
 	const auto buffer = static_cast<uchar*>(data);
 	delete[] buffer;
@@ -177,7 +253,7 @@ void FormatDeleter::operator()(AVFormatContext *value) {
 	}
 }
 
-CodecPointer MakeCodecPointer(not_null<AVStream*> stream) {
+CodecPointer MakeCodecPointer(not_null<AVStream*> stream, bool hwAllowed) {
 	auto error = AvErrorWrap();
 
 	auto result = CodecPointer(avcodec_alloc_context3(nullptr));
@@ -198,9 +274,15 @@ CodecPointer MakeCodecPointer(not_null<AVStream*> stream) {
 	if (!codec) {
 		LogError(qstr("avcodec_find_decoder"), context->codec_id);
 		return {};
-	} else if ((error = avcodec_open2(context, codec, nullptr))) {
+	}
+#ifdef TDESKTOP_FFMPEG_HW_DECODING
+	const auto hw = hwAllowed && InitHwDecoding(context, codec);
+#else // TDESKTOP_FFMPEG_HW_DECODING
+	const auto hw = false;
+#endif // TDESKTOP_FFMPEG_HW_DECODING
+	if ((error = avcodec_open2(context, codec, nullptr))) {
 		LogError(qstr("avcodec_open2"), error);
-		return {};
+		return hw ? MakeCodecPointer(stream, false) : CodecPointer();
 	}
 	return result;
 }
@@ -216,7 +298,27 @@ FramePointer MakeFramePointer() {
 }
 
 bool FrameHasData(AVFrame *frame) {
-	return (frame && frame->data[0] != nullptr);
+	return frame
+		&& (frame->data[0] != nullptr || frame->hw_frames_ctx != nullptr);
+}
+
+bool TransferHwFrame(not_null<AVFrame*> frame, FramePointer &buffer) {
+	Expects(frame->hw_frames_ctx != nullptr);
+
+	if (!buffer) {
+		buffer = MakeFramePointer();
+	} else {
+		ClearFrameMemory(buffer.get());
+	}
+	auto error = AvErrorWrap(av_hwframe_transfer_data(
+		buffer.get(),
+		frame,
+		0));
+	if (error) {
+		LogError(qstr("av_hwframe_transfer_data"), error);
+		return false;
+	}
+	return true;
 }
 
 void ClearFrameMemory(AVFrame *frame) {
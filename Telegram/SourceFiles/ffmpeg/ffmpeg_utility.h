@@ -136,7 +136,10 @@ struct CodecDeleter {
 	void operator()(AVCodecContext *value);
 };
 using CodecPointer = std::unique_ptr<AVCodecContext, CodecDeleter>;
-[[nodiscard]] CodecPointer MakeCodecPointer(not_null<AVStream*> stream);
+// Hardware decoding is tried first if allowed, software is the fallback.
+[[nodiscard]] CodecPointer MakeCodecPointer(
+	not_null<AVStream*> stream,
+	bool hwAllowed = false);
 
 struct FrameDeleter {
 	void operator()(AVFrame *value);
@@ -146,6 +149,11 @@ using FramePointer = std::unique_ptr<AVFrame, FrameDeleter>;
 [[nodiscard]] bool FrameHasData(AVFrame *frame);
 void ClearFrameMemory(AVFrame *frame);
 
+// Copies a hardware decoded frame to system memory in the buffer frame.
+[[nodiscard]] bool TransferHwFrame(
+	not_null<AVFrame*> frame,
+	FramePointer &buffer);
+
 struct SwscaleDeleter {
 	QSize srcSize;
 	int srcFormat = int(AV_PIX_FMT_NONE);
@@ -239,6 +239,12 @@ InnerWidget::InnerWidget(
 			repaintItem(view);
 		}
 	}, lifetime());
+	session().data().viewPartRepaintRequest(
+	) | rpl::start_with_next([=](const auto &part) {
+		if (part.view->delegate() == this) {
+			repaintItem(part.view, part.rect);
+		}
+	}, lifetime());
 	session().data().viewResizeRequest(
 	) | rpl::start_with_next([=](auto view) {
 		if (view->delegate() == this) {
@@ -1697,6 +1703,12 @@ void InnerWidget::repaintItem(const Element *view) {
 	update(0, itemTop(view), width(), view->height());
 }
 
+void InnerWidget::repaintItem(not_null<const Element*> view, QRect rect) {
+	update(rect.intersected(
+		QRect(0, 0, width(), view->height())
+	).translated(0, itemTop(view)));
+}
+
 void InnerWidget::resizeItem(not_null<Element*> view) {
 	updateSize();
 }
@@ -1348,6 +1348,16 @@ void History::addItemToBlock(not_null<HistoryItem*> item) {
 	}
 }
 
+void History::allowBackgroundTextLayout(
+		const std::vector<not_null<HistoryItem*>> &items) {
+	// Slices loaded while scrolling are added outside of the viewport.
+	for (const auto item : items) {
+		if (const auto view = item->mainView()) {
+			view->allowBackgroundTextLayout();
+		}
+	}
+}
+
 void History::addEdgesToSharedMedia() {
 	auto from = loadedAtTop() ? 0 : minMsgId();
 	auto till = loadedAtBottom() ? ServerMaxMsgId : maxMsgId();
@@ -1368,12 +1378,16 @@ void History::addOlderSlice(const QVector<MTPMessage> &slice) {
 		return;
 	}
 
+	const auto wasEmpty = isEmpty();
 	if (const auto added = createItems(slice); !added.empty()) {
 		startBuildingFrontBlock(added.size());
 		for (const auto item : added) {
 			addItemToBlock(item);
 		}
 		finishBuildingFrontBlock();
+		if (!wasEmpty) {
+			allowBackgroundTextLayout(added);
+		}
 
 		if (loadedAtBottom()) {
 			// Add photos to overview and authors to lastAuthors.
@@ -1406,6 +1420,9 @@ void History::addNewerSlice(const QVector<MTPMessage> &slice) {
 		for (const auto item : added) {
 			addItemToBlock(item);
 		}
+		if (!wasEmpty) {
+			allowBackgroundTextLayout(added);
+		}
 
 		addToSharedMedia(added);
 	} else {
@@ -3111,6 +3128,21 @@ void History::clear(ClearType type) {
 	}
 }
 
+void History::setShown(bool shown) {
+	_shownCount += shown ? 1 : -1;
+	_lastShownTime = crl::now();
+
+	Ensures(_shownCount >= 0);
+}
+
+int History::loadedViewsCount() const {
+	auto result = 0;
+	for (const auto &block : blocks) {
+		result += block->messages.size();
+	}
+	return result;
+}
+
 void History::clearUpTill(MsgId availableMinId) {
 	auto minId = minMsgId();
 	if (!minId || minId > availableMinId) {
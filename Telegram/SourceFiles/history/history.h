@@ -88,6 +88,17 @@ public:
 	void clear(ClearType type);
 	void clearUpTill(MsgId availableMinId);
 
+	// Views of the histories that are not shown for some time may be
+	// unloaded by Data::Session if there are too many of them loaded.
+	void setShown(bool shown);
+	[[nodiscard]] bool shown() const {
+		return (_shownCount > 0);
+	}
+	[[nodiscard]] crl::time lastShownTime() const {
+		return _lastShownTime;
+	}
+	[[nodiscard]] int loadedViewsCount() const;
+
 	void applyGroupAdminChanges(const base::flat_set<UserId> &changes);
 
 	HistoryItem *addNewMessage(
@@ -230,6 +241,9 @@ public:
 	void setHasPendingResizedItems();
 
 	bool mySendActionUpdated(SendAction::Type type, bool doing);
+	[[nodiscard]] bool hasSendActionAnimation() const {
+		return !!_sendActionAnimation;
+	}
 	bool paintSendAction(
 		Painter &p,
 		int x,
@@ -458,6 +472,8 @@ private:
 	void checkAddAllToUnreadMentions();
 
 	void addToSharedMedia(const std::vector<not_null<HistoryItem*>> &items);
+	void allowBackgroundTextLayout(
+		const std::vector<not_null<HistoryItem*>> &items);
 	void addEdgesToSharedMedia();
 
 	void addItemsToLists(const std::vector<not_null<HistoryItem*>> &items);
@@ -492,6 +508,8 @@ private:
 	HistoryService *_joinedMessage = nullptr;
 	bool _loadedAtTop = false;
 	bool _loadedAtBottom = true;
+	int _shownCount = 0;
+	crl::time _lastShownTime = 0;
 
 	std::optional<Data::Folder*> _folder;
 
@@ -11,6 +11,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "styles/style_history.h"
 #include "core/file_utilities.h"
 #include "core/crash_reports.h"
+#include "core/core_startup_timeline.h"
+#include "base/tracing.h"
 #include "history/history.h"
 #include "history/history_message.h"
 #include "history/view/media/history_view_media.h"
@@ -22,6 +24,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "history/view/history_view_service_message.h"
 #include "history/view/history_view_cursor_state.h"
 #include "history/view/history_view_context_menu.h"
+#include "history/view/history_view_paint_cache.h"
 #include "ui/widgets/popup_menu.h"
 #include "ui/image/image.h"
 #include "ui/toast/toast.h"
@@ -143,6 +146,11 @@ HistoryInner::HistoryInner(
 , _scrollDateHideTimer([this] { scrollDateHideByTimer(); }) {
 	Instance = this;
 
+	_history->setShown(true);
+	if (_migrated) {
+		_migrated->setShown(true);
+	}
+
 	_touchSelectTimer.setSingleShot(true);
 	connect(&_touchSelectTimer, SIGNAL(timeout()), this, SLOT(onTouchSelect()));
 
@@ -155,10 +163,20 @@ HistoryInner::HistoryInner(
 
 	setMouseTracking(true);
 	subscribe(_controller->gifPauseLevelChanged(), [this] {
+		if (_paintCache) {
+			_paintCache->clear();
+		}
 		if (!_controller->isGifPausedAtLeastFor(Window::GifPauseReason::Any)) {
 			update();
 		}
 	});
+	session().settings().historyPaintCacheValue(
+	) | rpl::start_with_next([=](bool enabled) {
+		_paintCache = enabled
+			? std::make_unique<HistoryView::PaintCache>()
+			: nullptr;
+		update();
+	}, lifetime());
 	subscribe(_controller->widget()->dragFinished(), [this] {
 		mouseActionUpdate(QCursor::pos());
 	});
@@ -186,6 +204,10 @@ HistoryInner::HistoryInner(
 	) | rpl::start_with_next([this](not_null<const Element*> view) {
 		repaintItem(view);
 	}, lifetime());
+	session().data().viewPartRepaintRequest(
+	) | rpl::start_with_next([this](const Data::Session::ViewPartRepaint &part) {
+		repaintItem(part.view, part.rect);
+	}, lifetime());
 	session().data().viewLayoutChanged(
 	) | rpl::filter([](not_null<const Element*> view) {
 		return (view == view->data()->mainView()) && view->isUnderCursor();
@@ -236,6 +258,9 @@ void HistoryInner::repaintItem(const HistoryItem *item) {
 }
 
 void HistoryInner::repaintItem(const Element *view) {
+	if (_paintCache && view) {
+		_paintCache->invalidate(view);
+	}
 	if (_widget->skipItemRepaint()) {
 		return;
 	}
@@ -245,6 +270,21 @@ void HistoryInner::repaintItem(const Element *view) {
 	}
 }
 
+void HistoryInner::repaintItem(not_null<const Element*> view, QRect rect) {
+	if (_paintCache) {
+		_paintCache->invalidate(view);
+	}
+	if (_widget->skipItemRepaint()) {
+		return;
+	}
+	const auto top = itemTop(view);
+	if (top >= 0) {
+		update(rect.intersected(
+			QRect(0, 0, width(), view->height())
+		).translated(0, top));
+	}
+}
+
 template <bool TopToBottom, typename Method>
 void HistoryInner::enumerateItemsInHistory(History *history, int historytop, Method method) {
 	// No displayed messages in this history.
@@ -553,6 +593,11 @@ void HistoryInner::paintEmpty(Painter &p, int width, int height) {
 }
 
 void HistoryInner::paintEvent(QPaintEvent *e) {
+	TRACE_SCOPE("HistoryInner::paintEvent");
+	const auto frame = Core::StartupFrame("chat paint");
+	const auto overlay = _frameTimes.measure(this, e->rect());
+	Core::StartupMilestone("chat painted");
+
 	if (Ui::skipPaintEvent(this, e)) {
 		return;
 	}
@@ -592,6 +637,17 @@ void HistoryInner::paintEvent(QPaintEvent *e) {
 		adjustCurrent(clip.top());
 
 		auto drawToY = clip.y() + clip.height();
+		const auto drawView = [&](
+				not_null<Element*> view,
+				QRect clip,
+				TextSelection selection) {
+			view->validateLayout();
+			if (_paintCache) {
+				_paintCache->paint(p, view, clip, selection, ms);
+			} else {
+				view->draw(p, clip, selection, ms);
+			}
+		};
 
 		auto selfromy = itemTop(_dragSelFrom);
 		auto seltoy = itemTop(_dragSelTo);
@@ -619,7 +675,7 @@ void HistoryInner::paintEvent(QPaintEvent *e) {
 					view,
 					selfromy - mtop,
 					seltoy - mtop);
-				view->draw(p, clip.translated(0, -y), selection, ms);
+				drawView(view, clip.translated(0, -y), selection);
 
 				if (item->hasViews()) {
 					App::main()->scheduleViewIncrement(item);
@@ -665,7 +721,7 @@ void HistoryInner::paintEvent(QPaintEvent *e) {
 						view,
 						selfromy - htop,
 						seltoy - htop);
-					view->draw(p, hclip.translated(0, -y), selection, ms);
+					drawView(view, hclip.translated(0, -y), selection);
 
 					if (item->hasViews()) {
 						App::main()->scheduleViewIncrement(item);
@@ -1294,6 +1350,9 @@ void HistoryInner::viewRemoved(not_null<const Element*> view) {
 	if (_scrollDateLastItem == view) {
 		_scrollDateLastItem = nullptr;
 	}
+	if (_paintCache) {
+		_paintCache->remove(view);
+	}
 }
 
 void HistoryInner::refreshView(not_null<HistoryItem*> item) {
@@ -2168,6 +2227,31 @@ void HistoryInner::visibleAreaUpdated(int top, int bottom) {
 	const auto from = _visibleAreaTop - pages * visibleAreaHeight;
 	const auto till = _visibleAreaBottom + pages * visibleAreaHeight;
 	session().data().unloadHeavyViewParts(ElementDelegate(), from, till);
+
+	prefetchMedia(_mediaPrefetch.update(top, bottom));
+}
+
+void HistoryInner::prefetchMedia(HistoryView::MediaPrefetch::Area area) {
+	if (area.empty()) {
+		return;
+	}
+	adjustCurrent(area.down ? area.from : (area.till - 1));
+	if (!_curHistory) {
+		return;
+	}
+	auto views = std::vector<not_null<Element*>>();
+	auto view = _curHistory->blocks[_curBlock]->messages[_curItem].get();
+	while (view) {
+		const auto top = itemTop(view);
+		if (top < 0
+			|| (area.down && top >= area.till)
+			|| (!area.down && top + view->height() <= area.from)) {
+			break;
+		}
+		views.push_back(view);
+		view = area.down ? nextItem(view) : prevItem(view);
+	}
+	HistoryView::PrefetchMedia(&session(), views);
 }
 
 bool HistoryInner::displayScrollDate() const {
@@ -2291,6 +2375,10 @@ HistoryInner::~HistoryInner() {
 	if (Instance == this) {
 		Instance = nullptr;
 	}
+	_history->setShown(false);
+	if (_migrated) {
+		_migrated->setShown(false);
+	}
 	delete _menu;
 	_mouseAction = MouseAction::None;
 }
@@ -2495,6 +2583,7 @@ void HistoryInner::mouseActionUpdate() {
 		block = _curHistory->blocks[_curBlock].get();
 		view = block->messages[_curItem].get();
 		item = view->data();
+		view->validateLayout();
 
 		App::mousedItem(view);
 		m = mapPointToItem(point, view);
@@ -2864,7 +2953,13 @@ void HistoryInner::notifyIsBotChanged() {
 }
 
 void HistoryInner::notifyMigrateUpdated() {
+	if (_migrated) {
+		_migrated->setShown(false);
+	}
 	_migrated = _history->migrateFrom();
+	if (_migrated) {
+		_migrated->setShown(true);
+	}
 }
 
 int HistoryInner::moveScrollFollowingInlineKeyboard(
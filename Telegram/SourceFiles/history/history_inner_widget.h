@@ -8,11 +8,13 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #pragma once
 
 #include "base/timer.h"
+#include "core/core_jank.h"
 #include "ui/rp_widget.h"
 #include "ui/effects/animations.h"
 #include "ui/widgets/tooltip.h"
 #include "ui/widgets/scroll_area.h"
 #include "history/view/history_view_top_bar_widget.h"
+#include "history/view/history_view_media_prefetch.h"
 
 namespace Data {
 struct Group;
@@ -26,6 +28,7 @@ enum class CursorState : char;
 enum class PointState : char;
 class EmptyPainter;
 class Element;
+class PaintCache;
 } // namespace HistoryView
 
 namespace Window {
@@ -67,6 +70,7 @@ public:
 
 	void repaintItem(const HistoryItem *item);
 	void repaintItem(const Element *view);
+	void repaintItem(not_null<const Element*> view, QRect rect);
 
 	bool canCopySelected() const;
 	bool canDeleteSelected() const;
@@ -202,6 +206,7 @@ private:
 	ClickHandlerPtr hiddenUserpicLink(FullMsgId id);
 
 	void scrollDateCheck();
+	void prefetchMedia(HistoryView::MediaPrefetch::Area area);
 	void scrollDateHideByTimer();
 	bool canHaveFromUserpics() const;
 	void mouseActionStart(const QPoint &screenPos, Qt::MouseButton button);
@@ -383,4 +388,8 @@ private:
 	int _scrollDateLastItemTop = 0;
 	ClickHandlerPtr _scrollDateLink;
 
+	std::unique_ptr<HistoryView::PaintCache> _paintCache;
+	HistoryView::MediaPrefetch _mediaPrefetch;
+	Core::FrameTimeOverlay _frameTimes;
+
 };
@@ -780,7 +780,7 @@ MessageGroupId HistoryItem::groupId() const {
 }
 
 bool HistoryItem::isEmpty() const {
-	return _text.isEmpty()
+	return emptyText()
 		&& !_media
 		&& !Has<HistoryMessageLogEntryOriginal>();
 }
@@ -789,6 +789,8 @@ QString HistoryItem::notificationText() const {
 	const auto result = [&] {
 		if (_media) {
 			return _media->notificationText();
+		} else if (_textToParse) {
+			return _textToParse->text;
 		} else if (!emptyText()) {
 			return _text.toString();
 		}
@@ -806,6 +808,8 @@ QString HistoryItem::inDialogsText(DrawInDialog way) const {
 				return textcmdLink(1, TextUtilities::Clean(tr::lng_in_dlg_album(tr::now)));
 			}
 			return _media->chatListText();
+		} else if (_textToParse) {
+			return TextUtilities::Clean(_textToParse->text);
 		} else if (!emptyText()) {
 			return TextUtilities::Clean(_text.toString());
 		}
@@ -834,6 +838,17 @@ Ui::Text::IsolatedEmoji HistoryItem::isolatedEmoji() const {
 	return Ui::Text::IsolatedEmoji();
 }
 
+Ui::Text::String &HistoryItem::text() {
+	if (_textToParse) {
+		parseText(*base::take(_textToParse));
+	}
+	return _text;
+}
+
+const Ui::Text::String &HistoryItem::text() const {
+	return const_cast<HistoryItem*>(this)->text();
+}
+
 void HistoryItem::drawInDialog(
 		Painter &p,
 		const QRect &r,
@@ -59,6 +59,8 @@ class History;
 
 class HistoryItem : public RuntimeComposer<HistoryItem> {
 public:
+	BASE_SMALL_POOL_ALLOCATED
+
 	static not_null<HistoryItem*> Create(
 		not_null<History*> history,
 		const MTPMessage &message,
@@ -168,6 +170,7 @@ public:
 		return isGroupEssential() && isEmpty();
 	}
 	[[nodiscard]] bool isIsolatedEmoji() const {
+		text();
 		return _clientFlags & MTPDmessage_ClientFlag::f_isolated_emoji;
 	}
 	[[nodiscard]] bool hasViews() const {
@@ -256,7 +259,9 @@ public:
 		Ui::Text::String &cache) const;
 
 	[[nodiscard]] bool emptyText() const {
-		return _text.isEmpty();
+		return _textToParse
+			? _textToParse->text.isEmpty()
+			: _text.isEmpty();
 	}
 
 	[[nodiscard]] bool isPinned() const;
@@ -356,7 +361,15 @@ protected:
 
 	void setGroupId(MessageGroupId groupId);
 
+	// Most of the loaded messages are never displayed, so the text is kept
+	// as the source until it is required in the parsed form.
+	[[nodiscard]] Ui::Text::String &text();
+	[[nodiscard]] const Ui::Text::String &text() const;
+	virtual void parseText(TextWithEntities &&textWithEntities) {
+	}
+
 	Ui::Text::String _text = { st::msgMinWidth };
+	std::optional<TextWithEntities> _textToParse;
 	int _textWidth = -1;
 	int _textHeight = 0;
 
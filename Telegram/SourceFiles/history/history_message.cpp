@@ -33,6 +33,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "observer_peer.h"
 #include "storage/storage_shared_media.h"
 #include "data/data_session.h"
+#include "data/data_text_layouts.h"
 #include "data/data_game.h"
 #include "data/data_media_types.h"
 #include "data/data_channel.h"
@@ -1163,6 +1164,20 @@ void HistoryMessage::setText(const TextWithEntities &textWithEntities) {
 		return;
 	}
 	clearIsolatedEmoji();
+	_text = Ui::Text::String(st::msgMinWidth);
+	_textToParse = textWithEntities;
+	_textWidth = -1;
+	_textHeight = 0;
+
+	// Displayed messages are laid out right away anyway.
+	if (mainView()) {
+		text();
+	}
+	history()->owner().textLayouts().cancel(this);
+	history()->owner().searchIndex().refreshMessage(this);
+}
+
+void HistoryMessage::parseText(TextWithEntities &&textWithEntities) {
 	_text.setMarkedText(
 		st::messageTextStyle,
 		textWithEntities,
@@ -1183,6 +1198,7 @@ void HistoryMessage::setText(const TextWithEntities &textWithEntities) {
 
 void HistoryMessage::setEmptyText() {
 	clearIsolatedEmoji();
+	_textToParse = std::nullopt;
 	_text.setMarkedText(
 		st::messageTextStyle,
 		{ QString(), EntitiesInText() },
@@ -1190,6 +1206,8 @@ void HistoryMessage::setEmptyText() {
 
 	_textWidth = -1;
 	_textHeight = 0;
+	history()->owner().textLayouts().cancel(this);
+	history()->owner().searchIndex().refreshMessage(this);
 }
 
 void HistoryMessage::clearIsolatedEmoji() {
@@ -1249,12 +1267,14 @@ void HistoryMessage::setReplyMarkup(const MTPReplyMarkup *markup) {
 }
 
 Ui::Text::IsolatedEmoji HistoryMessage::isolatedEmoji() const {
-	return _text.toIsolatedEmoji();
+	return text().toIsolatedEmoji();
 }
 
 TextWithEntities HistoryMessage::originalText() const {
 	if (emptyText()) {
 		return { QString(), EntitiesInText() };
+	} else if (_textToParse) {
+		return *_textToParse;
 	}
 	return _text.toTextWithEntities();
 }
@@ -1263,11 +1283,11 @@ TextForMimeData HistoryMessage::clipboardText() const {
 	if (emptyText()) {
 		return TextForMimeData();
 	}
-	return _text.toTextForMimeData();
+	return text().toTextForMimeData();
 }
 
 bool HistoryMessage::textHasLinks() const {
-	return emptyText() ? false : _text.hasLinks();
+	return emptyText() ? false : text().hasLinks();
 }
 
 void HistoryMessage::setViewsCount(int32 count) {
@@ -1322,6 +1342,7 @@ QString HistoryMessage::notificationHeader() const {
 
 std::unique_ptr<HistoryView::Element> HistoryMessage::createView(
 		not_null<HistoryView::ElementDelegate*> delegate) {
+	text();
 	return delegate->elementCreate(this);
 }
 
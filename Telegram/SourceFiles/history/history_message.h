@@ -173,6 +173,7 @@ public:
 	~HistoryMessage();
 
 private:
+	void parseText(TextWithEntities &&textWithEntities) override;
 	void setEmptyText();
 	[[nodiscard]] bool isTooOldForEdit(TimeId now) const;
 	[[nodiscard]] bool isLegacyMessage() const {
@@ -32,6 +32,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_drafts.h"
 #include "data/data_session.h"
 #include "data/data_web_page.h"
+#include "data/data_web_page_previews.h"
 #include "data/data_document.h"
 #include "data/data_photo.h"
 #include "data/data_media_types.h"
@@ -39,6 +40,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_chat.h"
 #include "data/data_user.h"
 #include "data/data_scheduled_messages.h"
+#include "data/data_cached_histories.h"
 #include "history/history.h"
 #include "history/history_item.h"
 #include "history/history_message.h"
@@ -338,6 +340,7 @@ HistoryWidget::HistoryWidget(
 	connect(Media::Capture::instance(), SIGNAL(error()), this, SLOT(onRecordError()));
 	connect(Media::Capture::instance(), SIGNAL(updated(quint16,qint32)), this, SLOT(onRecordUpdate(quint16,qint32)));
 	connect(Media::Capture::instance(), SIGNAL(done(QByteArray,VoiceWaveform,qint32)), this, SLOT(onRecordDone(QByteArray,VoiceWaveform,qint32)));
+	connect(Media::Capture::instance(), SIGNAL(encoded(QByteArray)), this, SLOT(onRecordEncoded(QByteArray)));
 
 	_attachToggle->addClickHandler(App::LambdaDelayed(
 		st::historyAttach.ripple.hideDuration,
@@ -1371,13 +1374,35 @@ void HistoryWidget::onRecordDone(
 		QByteArray result,
 		VoiceWaveform waveform,
 		qint32 samples) {
-	if (!canWriteMessage() || result.isEmpty()) return;
+	const auto preuploadId = base::take(_recordingPreuploadId);
+	if (!canWriteMessage() || result.isEmpty()) {
+		if (preuploadId) {
+			session().uploader().cancelPreupload(preuploadId);
+		}
+		return;
+	}
 
 	ActivateWindow(controller());
 	const auto duration = samples / Media::Player::kDefaultFrequency;
 	auto action = Api::SendAction(_history);
 	action.replyTo = replyToId();
-	session().api().sendVoiceMessage(result, waveform, duration, action);
+	session().api().sendVoiceMessage(
+		result,
+		waveform,
+		duration,
+		action,
+		preuploadId);
+}
+
+void HistoryWidget::onRecordEncoded(QByteArray bytes) {
+	auto &uploader = session().uploader();
+	if (!_recordingPreuploadId) {
+		if (!_recording) {
+			return;
+		}
+		_recordingPreuploadId = uploader.startPreupload();
+	}
+	uploader.preuploadBytes(_recordingPreuploadId, bytes);
 }
 
 void HistoryWidget::onRecordUpdate(quint16 level, qint32 samples) {
@@ -1712,6 +1737,7 @@ void HistoryWidget::showHistory(
 		if (App::main()) {
 			App::main()->saveDraftToCloud();
 		}
+		session().api().sendPendingReadRequests();
 		if (_migrated) {
 			_migrated->clearLocalDraft(); // use migrated draft only once
 			_migrated->clearEditDraft();
@@ -1741,7 +1767,6 @@ void HistoryWidget::showHistory(
 	_replyEditMsg = nullptr;
 	_editMsgId = _replyToId = 0;
 	_previewData = nullptr;
-	_previewCache.clear();
 	_fieldBarCancel->hide();
 
 	_membersDropdownShowTimer.stop();
@@ -2408,6 +2433,9 @@ void HistoryWidget::messagesReceived(PeerData *peer, const MTPmessages_Messages
 			firstLoadMessages();
 			return;
 		}
+		if (!toMigrated && _history->loadedAtBottom()) {
+			session().data().cachedHistories().store(_history, messages);
+		}
 
 		historyLoaded();
 	} else if (_delayedShowAtRequest == requestId) {
@@ -2677,6 +2705,7 @@ void HistoryWidget::delayedShowAt(MsgId showAtMsgId) {
 }
 
 void HistoryWidget::onScroll() {
+	session().downloader().clearPriorities();
 	preloadHistoryIfNeeded();
 	visibleAreaUpdated();
 	if (!_synteticScrollEvent) {
@@ -3343,6 +3372,10 @@ void HistoryWidget::recordStartCallback() {
 		return;
 	}
 
+	if (_recordingPreuploadId) {
+		session().uploader().cancelPreupload(
+			base::take(_recordingPreuploadId));
+	}
 	emit Media::Capture::instance()->start();
 
 	_recording = _inField = true;
@@ -3378,6 +3411,10 @@ void HistoryWidget::mouseReleaseEvent(QMouseEvent *e) {
 
 void HistoryWidget::stopRecording(bool send) {
 	emit Media::Capture::instance()->stop(send);
+	if (!send && _recordingPreuploadId) {
+		session().uploader().cancelPreupload(
+			base::take(_recordingPreuploadId));
+	}
 
 	_recordingLevel = anim::value();
 	_recordingAnimation.stop();
@@ -6096,7 +6133,6 @@ void HistoryWidget::cancelFieldAreaState() {
 }
 
 void HistoryWidget::previewCancel() {
-	MTP::cancel(base::take(_previewRequest));
 	_previewData = nullptr;
 	_previewLinks.clear();
 	updatePreview();
@@ -6112,23 +6148,18 @@ void HistoryWidget::checkPreview() {
 	}
 	const auto newLinks = _parsedLinks.join(' ');
 	if (_previewLinks != newLinks) {
-		MTP::cancel(base::take(_previewRequest));
 		_previewLinks = newLinks;
 		if (_previewLinks.isEmpty()) {
 			if (_previewData && _previewData->pendingTill >= 0) {
 				previewCancel();
 			}
 		} else {
-			const auto i = _previewCache.constFind(_previewLinks);
-			if (i == _previewCache.cend()) {
-				_previewRequest = MTP::send(
-					MTPmessages_GetWebPagePreview(
-						MTP_flags(0),
-						MTP_string(_previewLinks),
-						MTPVector<MTPMessageEntity>()),
-					rpcDone(&HistoryWidget::gotPreview, _previewLinks));
-			} else if (i.value()) {
-				_previewData = session().data().webpage(i.value());
+			const auto known = session().data().webPagePreviews().lookup(
+				_previewLinks);
+			if (!known) {
+				sendPreviewRequest(false);
+			} else if (const auto page = *known) {
+				_previewData = page;
 				updatePreview();
 			} else {
 				if (_previewData && _previewData->pendingTill >= 0) previewCancel();
@@ -6143,39 +6174,27 @@ void HistoryWidget::requestPreview() {
 		|| _previewLinks.isEmpty()) {
 		return;
 	}
-	_previewRequest = MTP::send(
-		MTPmessages_GetWebPagePreview(
-			MTP_flags(0),
-			MTP_string(_previewLinks),
-			MTPVector<MTPMessageEntity>()),
-		rpcDone(&HistoryWidget::gotPreview, _previewLinks));
+	sendPreviewRequest(true);
 }
 
-void HistoryWidget::gotPreview(QString links, const MTPMessageMedia &result, mtpRequestId req) {
-	if (req == _previewRequest) {
-		_previewRequest = 0;
-	}
-	if (result.type() == mtpc_messageMediaWebPage) {
-		const auto &data = result.c_messageMediaWebPage().vwebpage();
-		const auto page = session().data().processWebpage(data);
-		_previewCache.insert(links, page->id);
-		if (page->pendingTill > 0 && page->pendingTill <= base::unixtime::now()) {
-			page->pendingTill = -1;
-		}
-		if (links == _previewLinks && !_previewCancelled) {
-			_previewData = (page->id && page->pendingTill >= 0)
-				? page.get()
-				: nullptr;
-			updatePreview();
-		}
-		session().data().sendWebPageGamePollNotifications();
-	} else if (result.type() == mtpc_messageMediaEmpty) {
-		_previewCache.insert(links, 0);
-		if (links == _previewLinks && !_previewCancelled) {
-			_previewData = nullptr;
-			updatePreview();
-		}
+void HistoryWidget::sendPreviewRequest(bool reload) {
+	const auto links = _previewLinks;
+	session().data().webPagePreviews().request(
+		links,
+		crl::guard(this, [=](WebPageData *page) {
+			gotPreview(links, page);
+		}),
+		reload);
+}
+
+void HistoryWidget::gotPreview(const QString &links, WebPageData *page) {
+	if (links != _previewLinks || _previewCancelled) {
+		return;
 	}
+	_previewData = (page && page->id && page->pendingTill >= 0)
+		? page
+		: nullptr;
+	updatePreview();
 }
 
 void HistoryWidget::updatePreview() {
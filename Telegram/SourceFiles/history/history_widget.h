@@ -303,6 +303,7 @@ public slots:
 	void onRecordError();
 	void onRecordDone(QByteArray result, VoiceWaveform waveform, qint32 samples);
 	void onRecordUpdate(quint16 level, qint32 samples);
+	void onRecordEncoded(QByteArray bytes);
 
 	void onUpdateHistoryItems();
 
@@ -563,7 +564,8 @@ private:
 
 	void checkPreview();
 	void requestPreview();
-	void gotPreview(QString links, const MTPMessageMedia &media, mtpRequestId req);
+	void sendPreviewRequest(bool reload);
+	void gotPreview(const QString &links, WebPageData *page);
 	bool messagesFailed(const RPCError &error, mtpRequestId requestId);
 	void addMessagesToFront(PeerData *peer, const QVector<MTPMessage> &messages);
 	void addMessagesToBack(PeerData *peer, const QVector<MTPMessage> &messages);
@@ -660,9 +662,6 @@ private:
 	QStringList _parsedLinks;
 	QString _previewLinks;
 	WebPageData *_previewData = nullptr;
-	typedef QMap<QString, WebPageId> PreviewCache;
-	PreviewCache _previewCache;
-	mtpRequestId _previewRequest = 0;
 	Ui::Text::String _previewTitle;
 	Ui::Text::String _previewDescription;
 	base::Timer _previewTimer;
@@ -747,6 +746,7 @@ private:
 	bool _inPinnedMsg = false;
 	bool _inClickable = false;
 	int _recordingSamples = 0;
+	uint64 _recordingPreuploadId = 0;
 	int _recordCancelWidth;
 
 	rpl::lifetime _uploaderSubscriptions;
@@ -21,6 +21,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_session.h"
 #include "data/data_groups.h"
 #include "data/data_media_types.h"
+#include "base/memory_usage.h"
 #include "lang/lang_keys.h"
 #include "layout.h"
 #include "facades.h"
@@ -33,6 +34,11 @@ namespace {
 // A new message from the same sender is attached to previous within 15 minutes.
 constexpr int kAttachMessageToPreviousSecondsDelta = 900;
 
+// Views are counted by the size of a message view, without the media.
+constexpr auto kElementBytes = int64(sizeof(Message));
+
+base::memory_usage::Counter ElementsMemory("HistoryView elements");
+
 bool IsAttachedToPreviousInSavedMessages(
 		not_null<HistoryItem*> previous,
 		not_null<HistoryItem*> item) {
@@ -209,6 +215,7 @@ Element::Element(
 	if (_context == Context::History) {
 		history()->setHasPendingResizedItems();
 	}
+	ElementsMemory.add(kElementBytes);
 }
 
 not_null<ElementDelegate*> Element::delegate() const {
@@ -291,6 +298,16 @@ bool Element::pendingResize() const {
 	return _flags & Flag::NeedsResize;
 }
 
+void Element::validateLayout() {
+	if (!(_flags & Flag::LayoutStale)) {
+		return;
+	}
+	_flags &= ~Flag::LayoutStale;
+
+	// The height is known already, only the content is placed again.
+	performCountCurrentSize(width());
+}
+
 bool Element::isAttachedToPrevious() const {
 	return _flags & Flag::AttachedToPrevious;
 }
@@ -325,6 +342,7 @@ bool Element::isHidden() const {
 
 void Element::refreshMedia() {
 	_flags &= ~Flag::HiddenByGroup;
+	clearCachedLayouts();
 
 	const auto item = data();
 	const auto media = item->media();
@@ -491,9 +509,63 @@ QSize Element::countOptimalSize() {
 QSize Element::countCurrentSize(int newWidth) {
 	if (_flags & Flag::NeedsResize) {
 		_flags &= ~Flag::NeedsResize;
+		clearCachedLayouts();
 		initDimensions();
 	}
-	return performCountCurrentSize(newWidth);
+	const auto key = layoutKey(newWidth);
+	if (key >= 0) {
+		if (key == _layoutKey) {
+			return { newWidth, height() };
+		} else if (const auto cached = cachedLayoutHeight(key)) {
+			_flags |= Flag::LayoutStale;
+			_layoutKey = key;
+			return { newWidth, *cached };
+		}
+	}
+	_flags &= ~Flag::LayoutStale;
+	const auto result = performCountCurrentSize(newWidth);
+	_layoutKey = key;
+	if (key >= 0) {
+		rememberLayout(key, result.height());
+	}
+	return result;
+}
+
+void Element::allowBackgroundTextLayout() {
+	_flags |= Flag::BackgroundText;
+}
+
+bool Element::takeBackgroundTextLayout() {
+	const auto result = (_flags & Flag::BackgroundText);
+	_flags &= ~Flag::BackgroundText;
+	return result;
+}
+
+int Element::layoutKey(int newWidth) const {
+	return newWidth;
+}
+
+std::optional<int> Element::cachedLayoutHeight(int key) const {
+	for (const auto &cached : _cachedLayouts) {
+		if (cached.key == key) {
+			return cached.height;
+		}
+	}
+	return std::nullopt;
+}
+
+void Element::rememberLayout(int key, int height) {
+	auto i = ranges::find(_cachedLayouts, key, &CachedLayout::key);
+	if (i == end(_cachedLayouts)) {
+		i = end(_cachedLayouts) - 1;
+	}
+	std::move_backward(begin(_cachedLayouts), i, i + 1);
+	_cachedLayouts.front() = CachedLayout{ key, height };
+}
+
+void Element::clearCachedLayouts() {
+	_cachedLayouts.fill(CachedLayout());
+	_layoutKey = -1;
 }
 
 void Element::setDisplayDate(bool displayDate) {
@@ -595,6 +667,10 @@ bool Element::hasVisibleText() const {
 	return false;
 }
 
+std::optional<QPoint> Element::mediaPosition() const {
+	return std::nullopt;
+}
+
 void Element::unloadHeavyPart() {
 	if (_media) {
 		_media->unloadHeavyPart();
@@ -727,6 +803,7 @@ void Element::clickHandlerPressedChanged(
 }
 
 Element::~Element() {
+	ElementsMemory.remove(kElementBytes);
 	if (_data->mainView() == this) {
 		_data->clearMainView();
 	}
@@ -131,6 +131,8 @@ class Element
 	, public RuntimeComposer<Element>
 	, public ClickHandlerHost {
 public:
+	BASE_SMALL_POOL_ALLOCATED
+
 	Element(
 		not_null<ElementDelegate*> delegate,
 		not_null<HistoryItem*> data);
@@ -140,6 +142,8 @@ public:
 		AttachedToPrevious = 0x02,
 		AttachedToNext     = 0x04,
 		HiddenByGroup      = 0x08,
+		LayoutStale        = 0x10,
+		BackgroundText     = 0x20,
 	};
 	using Flags = base::flags<Flag>;
 	friend inline constexpr auto is_flag_type(Flag) { return true; }
@@ -161,6 +165,17 @@ public:
 
 	void setPendingResize();
 	bool pendingResize() const;
+
+	// Heights for the last few layout widths are remembered, so that
+	// resizing back and forth doesn't break the text lines again. When
+	// the height is taken from there the content is laid out only when
+	// the element is about to be painted or hit tested.
+	void validateLayout();
+
+	// Elements added to an already displayed list may get an estimated
+	// text height first and the exact one from a worker thread later.
+	void allowBackgroundTextLayout();
+	[[nodiscard]] bool takeBackgroundTextLayout();
 	bool isUnderCursor() const;
 
 	bool isAttachedToPrevious() const;
@@ -257,6 +272,9 @@ public:
 	virtual TimeId displayedEditDate() const;
 	virtual bool hasVisibleText() const;
 
+	// Where media() is drawn, if it is known without painting.
+	[[nodiscard]] virtual std::optional<QPoint> mediaPosition() const;
+
 	virtual void unloadHeavyPart();
 
 	// Legacy blocks structure.
@@ -299,6 +317,14 @@ private:
 	virtual QSize performCountOptimalSize() = 0;
 	virtual QSize performCountCurrentSize(int newWidth) = 0;
 
+	// Different widths with the same layout key give the same layout.
+	// Negative key means the layout shouldn't be taken from the cache.
+	virtual int layoutKey(int newWidth) const;
+
+	[[nodiscard]] std::optional<int> cachedLayoutHeight(int key) const;
+	void rememberLayout(int key, int height);
+	void clearCachedLayouts();
+
 	void refreshMedia();
 
 	const not_null<ElementDelegate*> _delegate;
@@ -311,6 +337,13 @@ private:
 
 	Flags _flags = Flag::NeedsResize;
 
+	struct CachedLayout {
+		int key = -1;
+		int height = 0;
+	};
+	std::array<CachedLayout, 3> _cachedLayouts;
+	int _layoutKey = -1;
+
 	HistoryBlock *_block = nullptr;
 	int _indexInBlock = -1;
 
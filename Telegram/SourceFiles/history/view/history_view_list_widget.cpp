@@ -17,6 +17,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "history/view/history_view_message.h"
 #include "history/view/history_view_service_message.h"
 #include "history/view/history_view_cursor_state.h"
+#include "history/view/history_view_paint_cache.h"
 #include "chat_helpers/message_field.h"
 #include "mainwindow.h"
 #include "mainwidget.h"
@@ -256,6 +257,12 @@ ListWidget::ListWidget(
 			repaintItem(view);
 		}
 	}, lifetime());
+	session().data().viewPartRepaintRequest(
+	) | rpl::start_with_next([this](const auto &part) {
+		if (part.view->delegate() == this) {
+			repaintItem(part.view, part.rect);
+		}
+	}, lifetime());
 	session().data().viewResizeRequest(
 	) | rpl::start_with_next([this](auto view) {
 		if (view->delegate() == this) {
@@ -298,6 +305,13 @@ ListWidget::ListWidget(
 			}
 		}
 	});
+	session().settings().historyPaintCacheValue(
+	) | rpl::start_with_next([=](bool enabled) {
+		_paintCache = enabled
+			? std::make_unique<PaintCache>()
+			: nullptr;
+		update();
+	}, lifetime());
 }
 
 Main::Session &ListWidget::session() const {
@@ -594,6 +608,32 @@ void ListWidget::visibleTopBottomUpdated(
 	}
 	_controller->floatPlayerAreaUpdated().notify(true);
 	_applyUpdatedScrollState.call();
+	prefetchMedia(_mediaPrefetch.update(visibleTop, visibleBottom));
+}
+
+void ListWidget::prefetchMedia(MediaPrefetch::Area area) {
+	if (area.empty()) {
+		return;
+	}
+	const auto from = std::lower_bound(
+		begin(_items),
+		end(_items),
+		area.from,
+		[this](auto &elem, int top) {
+			return this->itemTop(elem) + elem->height() <= top;
+		});
+	const auto till = std::lower_bound(
+		from,
+		end(_items),
+		area.till,
+		[this](auto &elem, int bottom) {
+			return this->itemTop(elem) < bottom;
+		});
+	auto views = std::vector<not_null<Element*>>(from, till);
+	if (!area.down) {
+		ranges::reverse(views);
+	}
+	PrefetchMedia(&session(), views);
 }
 
 void ListWidget::applyUpdatedScrollState() {
@@ -1310,11 +1350,18 @@ void ListWidget::paintEvent(QPaintEvent *e) {
 		p.translate(0, top);
 		for (auto i = from; i != to; ++i) {
 			const auto view = *i;
-			view->draw(
-				p,
-				clip.translated(0, -top),
-				itemRenderSelection(view),
-				ms);
+			const auto selection = itemRenderSelection(view);
+			view->validateLayout();
+			if (_paintCache) {
+				_paintCache->paint(
+					p,
+					view,
+					clip.translated(0, -top),
+					selection,
+					ms);
+			} else {
+				view->draw(p, clip.translated(0, -top), selection, ms);
+			}
 			const auto height = view->height();
 			top += height;
 			p.translate(0, height);
@@ -2080,6 +2127,9 @@ void ListWidget::mouseActionUpdate() {
 	const auto view = strictFindItemByY(point.y());
 	const auto item = view ? view->data().get() : nullptr;
 	const auto itemPoint = mapPointToItem(point, view);
+	if (view) {
+		view->validateLayout();
+	}
 	_overState = MouseState(
 		item ? item->fullId() : FullMsgId(),
 		view ? view->height() : 0,
@@ -2392,10 +2442,21 @@ int ListWidget::itemTop(not_null<const Element*> view) const {
 void ListWidget::repaintItem(const Element *view) {
 	if (!view) {
 		return;
+	} else if (_paintCache) {
+		_paintCache->invalidate(view);
 	}
 	update(0, itemTop(view), width(), view->height());
 }
 
+void ListWidget::repaintItem(not_null<const Element*> view, QRect rect) {
+	if (_paintCache) {
+		_paintCache->invalidate(view);
+	}
+	update(rect.intersected(
+		QRect(0, 0, width(), view->height())
+	).translated(0, itemTop(view)));
+}
+
 void ListWidget::repaintItem(FullMsgId itemId) {
 	if (const auto view = viewForItem(itemId)) {
 		repaintItem(view);
@@ -2485,6 +2546,9 @@ void ListWidget::refreshItem(not_null<const Element*> view) {
 }
 
 void ListWidget::viewReplaced(not_null<const Element*> was, Element *now) {
+	if (_paintCache) {
+		_paintCache->remove(was);
+	}
 	if (_visibleTopItem == was) _visibleTopItem = now;
 	if (_scrollDateLastItem == was) _scrollDateLastItem = now;
 	if (_overElement == was) _overElement = now;
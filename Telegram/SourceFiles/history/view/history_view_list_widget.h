@@ -14,6 +14,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/timer.h"
 #include "data/data_messages.h"
 #include "history/view/history_view_element.h"
+#include "history/view/history_view_media_prefetch.h"
 
 namespace Main {
 class Session;
@@ -38,6 +39,7 @@ struct StateRequest;
 enum class CursorState : char;
 enum class PointState : char;
 enum class Context : char;
+class PaintCache;
 
 struct SelectedItem {
 	explicit SelectedItem(FullMsgId msgId) : msgId(msgId) {
@@ -296,6 +298,7 @@ private:
 	int itemTop(not_null<const Element*> view) const;
 	void repaintItem(FullMsgId itemId);
 	void repaintItem(const Element *view);
+	void repaintItem(not_null<const Element*> view, QRect rect);
 	void resizeItem(not_null<Element*> view);
 	void refreshItem(not_null<const Element*> view);
 	void itemRemoved(not_null<const HistoryItem*> item);
@@ -311,6 +314,7 @@ private:
 
 	void checkMoveToOtherViewer();
 	void updateVisibleTopItem();
+	void prefetchMedia(MediaPrefetch::Area area);
 	void updateItemsGeometry();
 	void updateSize();
 	void refreshAttachmentsFromTill(int from, int till);
@@ -466,6 +470,9 @@ private:
 	ClickHandlerPtr _scrollDateLink;
 	SingleQueuedInvokation _applyUpdatedScrollState;
 
+	std::unique_ptr<PaintCache> _paintCache;
+	MediaPrefetch _mediaPrefetch;
+
 	Element *_unreadBarElement = nullptr;
 
 	MouseAction _mouseAction = MouseAction::None;
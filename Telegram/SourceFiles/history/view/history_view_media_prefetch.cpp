@@ -0,0 +1,81 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "history/view/history_view_media_prefetch.h"
+
+#include "history/view/history_view_element.h"
+#include "history/view/media/history_view_media.h"
+#include "main/main_session.h"
+#include "storage/file_download.h"
+
+namespace HistoryView {
+namespace {
+
+// Prefetch what will be shown in this time at the current speed.
+constexpr auto kLookahead = crl::time(1500);
+constexpr auto kMinLookaheadPages = 0.5;
+constexpr auto kMaxLookaheadPages = 2.;
+
+// Moving further than that in one step is a jump, not a scroll.
+constexpr auto kJumpPages = 3;
+
+// The scroll speed is forgotten after a pause this long.
+constexpr auto kSpeedTimeout = crl::time(500);
+
+} // namespace
+
+auto MediaPrefetch::update(int visibleTop, int visibleBottom) -> Area {
+	const auto now = crl::now();
+	const auto height = visibleBottom - visibleTop;
+	const auto delta = visibleTop - _visibleTop;
+	const auto elapsed = now - _updated;
+	const auto initial = (_visibleTop >= _visibleBottom);
+	_visibleTop = visibleTop;
+	_visibleBottom = visibleBottom;
+	_updated = now;
+
+	if (initial || height <= 0 || !delta) {
+		return Area();
+	} else if (std::abs(delta) > kJumpPages * height) {
+		_speed = 0.;
+		return Area();
+	}
+	const auto speed = delta / float64(std::max(elapsed, crl::time(1)));
+	_speed = (elapsed > kSpeedTimeout || (speed > 0.) != (_speed > 0.))
+		? speed
+		: (_speed + speed) / 2.;
+
+	const auto lookahead = std::clamp(
+		int(std::abs(_speed) * kLookahead),
+		int(height * kMinLookaheadPages),
+		int(height * kMaxLookaheadPages));
+	const auto down = (_speed > 0.);
+	return down
+		? Area{ visibleBottom, visibleBottom + lookahead, true }
+		: Area{ visibleTop - lookahead, visibleTop, false };
+}
+
+void MediaPrefetch::reset() {
+	_visibleTop = _visibleBottom = 0;
+	_updated = 0;
+	_speed = 0.;
+}
+
+void PrefetchMedia(
+		not_null<Main::Session*> session,
+		const std::vector<not_null<Element*>> &views) {
+	const auto priority = Storage::LoadPriorityScope(
+		&session->downloader(),
+		Storage::LoadPriority::Prefetch);
+	for (const auto view : views) {
+		if (const auto media = view->media()) {
+			media->prefetch();
+		}
+	}
+}
+
+} // namespace HistoryView
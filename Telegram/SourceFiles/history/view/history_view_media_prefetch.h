@@ -0,0 +1,49 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+namespace Main {
+class Session;
+} // namespace Main
+
+namespace HistoryView {
+
+class Element;
+
+// Follows the scroll speed of a list and tells which part of it beyond
+// the viewport, in the scroll direction, will be shown soon.
+class MediaPrefetch final {
+public:
+	struct Area {
+		int from = 0;
+		int till = 0;
+		bool down = true;
+
+		[[nodiscard]] bool empty() const {
+			return (from >= till);
+		}
+	};
+
+	// Returns an empty area when the list didn't scroll or jumped away.
+	[[nodiscard]] Area update(int visibleTop, int visibleBottom);
+	void reset();
+
+private:
+	int _visibleTop = 0;
+	int _visibleBottom = 0;
+	crl::time _updated = 0;
+	float64 _speed = 0.;
+
+};
+
+// Starts loading the media of the views with the prefetch priority.
+void PrefetchMedia(
+	not_null<Main::Session*> session,
+	const std::vector<not_null<Element*>> &views);
+
+} // namespace HistoryView
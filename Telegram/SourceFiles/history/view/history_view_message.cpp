@@ -15,6 +15,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "history/history.h"
 #include "ui/toast/toast.h"
 #include "data/data_session.h"
+#include "data/data_text_layouts.h"
 #include "data/data_user.h"
 #include "data/data_channel.h"
 #include "lang/lang_keys.h"
@@ -250,17 +251,17 @@ QSize Message::performCountOptimalSize() {
 		auto mediaOnTop = (mediaDisplayed && media->isBubbleTop()) || (entry && entry->isBubbleTop());
 
 		if (mediaOnBottom) {
-			if (item->_text.removeSkipBlock()) {
+			if (item->text().removeSkipBlock()) {
 				item->_textWidth = -1;
 				item->_textHeight = 0;
 			}
-		} else if (item->_text.updateSkipBlock(skipBlockWidth(), skipBlockHeight())) {
+		} else if (item->text().updateSkipBlock(skipBlockWidth(), skipBlockHeight())) {
 			item->_textWidth = -1;
 			item->_textHeight = 0;
 		}
 
 		maxWidth = plainMaxWidth();
-		minHeight = hasVisibleText() ? item->_text.minHeight() : 0;
+		minHeight = hasVisibleText() ? item->text().minHeight() : 0;
 		if (!mediaOnBottom) {
 			minHeight += st::msgPadding.bottom();
 			if (mediaDisplayed) minHeight += st::mediaInBubbleSkip;
@@ -275,8 +276,8 @@ QSize Message::performCountOptimalSize() {
 			if (media->enforceBubbleWidth()) {
 				maxWidth = media->maxWidth();
 				if (hasVisibleText() && maxWidth < plainMaxWidth()) {
-					minHeight -= item->_text.minHeight();
-					minHeight += item->_text.countHeight(maxWidth - st::msgPadding.left() - st::msgPadding.right());
+					minHeight -= item->text().minHeight();
+					minHeight += item->text().countHeight(maxWidth - st::msgPadding.left() - st::msgPadding.right());
 				}
 			} else {
 				accumulate_max(maxWidth, media->maxWidth());
@@ -510,6 +511,34 @@ void Message::draw(
 	}
 }
 
+// Follows the media geometry of Message::draw().
+std::optional<QPoint> Message::mediaPosition() const {
+	const auto media = this->media();
+	if (!media || !media->isDisplayed() || isHidden()) {
+		return std::nullopt;
+	}
+	auto g = countGeometry();
+	if (g.width() < 1) {
+		return std::nullopt;
+	} else if (!drawBubble()) {
+		return g.topLeft();
+	}
+	if (const auto keyboard = message()->inlineReplyKeyboard()) {
+		g.setHeight(g.height()
+			- st::msgBotKbButton.margin
+			- keyboard->naturalHeight());
+	}
+	const auto entry = logEntryOriginal();
+	auto bottom = g.y() + g.height();
+	if (!media->isBubbleBottom() && !entry) {
+		bottom -= st::msgPadding.bottom();
+	}
+	if (entry) {
+		bottom -= entry->height();
+	}
+	return QPoint(g.left(), bottom - media->height());
+}
+
 void Message::paintFromName(
 		Painter &p,
 		QRect &trect,
@@ -645,7 +674,7 @@ void Message::paintText(Painter &p, QRect &trect, TextSelection selection) const
 	auto selected = (selection == FullSelection);
 	p.setPen(outbg ? (selected ? st::historyTextOutFgSelected : st::historyTextOutFg) : (selected ? st::historyTextInFgSelected : st::historyTextInFg));
 	p.setFont(st::msgFont);
-	item->_text.draw(p, trect.x(), trect.y(), trect.width(), style::al_left, 0, -1, selection);
+	item->text().draw(p, trect.x(), trect.y(), trect.width(), style::al_left, 0, -1, selection);
 }
 
 PointState Message::pointState(QPoint point) const {
@@ -787,7 +816,7 @@ TextState Message::textState(
 				result = entry->textState(
 					point - QPoint(entryLeft, entryTop),
 					request);
-				result.symbol += item->_text.length() + (mediaDisplayed ? media->fullSelectionLength() : 0);
+				result.symbol += item->text().length() + (mediaDisplayed ? media->fullSelectionLength() : 0);
 			}
 		}
 
@@ -812,18 +841,18 @@ TextState Message::textState(
 
 				if (point.y() >= mediaTop && point.y() < mediaTop + mediaHeight) {
 					result = media->textState(point - QPoint(mediaLeft, mediaTop), request);
-					result.symbol += item->_text.length();
+					result.symbol += item->text().length();
 				} else if (getStateText(point, trect, &result, request)) {
 					checkForPointInTime();
 					return result;
 				} else if (point.y() >= trect.y() + trect.height()) {
-					result.symbol = item->_text.length();
+					result.symbol = item->text().length();
 				}
 			} else if (getStateText(point, trect, &result, request)) {
 				checkForPointInTime();
 				return result;
 			} else if (point.y() >= trect.y() + trect.height()) {
-				result.symbol = item->_text.length();
+				result.symbol = item->text().length();
 			}
 		}
 		checkForPointInTime();
@@ -845,7 +874,7 @@ TextState Message::textState(
 		}
 	} else if (media && media->isDisplayed()) {
 		result = media->textState(point - g.topLeft(), request);
-		result.symbol += item->_text.length();
+		result.symbol += item->text().length();
 	}
 
 	if (keyboard && item->isHistoryEntry()) {
@@ -997,7 +1026,7 @@ bool Message::getStateText(
 	}
 	const auto item = message();
 	if (base::in_range(point.y(), trect.y(), trect.y() + trect.height())) {
-		*outResult = TextState(item, item->_text.getState(
+		*outResult = TextState(item, item->text().getState(
 			point - trect.topLeft(),
 			trect.width(),
 			request.forText()));
@@ -1065,7 +1094,7 @@ TextForMimeData Message::selectedText(TextSelection selection) const {
 	const auto media = this->media();
 
 	auto logEntryOriginalResult = TextForMimeData();
-	auto textResult = item->_text.toTextForMimeData(selection);
+	auto textResult = item->text().toTextForMimeData(selection);
 	auto skipped = skipTextSelection(selection);
 	auto mediaDisplayed = (media && media->isDisplayed());
 	auto mediaResult = (mediaDisplayed || isHiddenByGroup())
@@ -1097,8 +1126,8 @@ TextSelection Message::adjustSelection(
 	const auto item = message();
 	const auto media = this->media();
 
-	auto result = item->_text.adjustSelection(selection, type);
-	auto beforeMediaLength = item->_text.length();
+	auto result = item->text().adjustSelection(selection, type);
+	auto beforeMediaLength = item->text().length();
 	if (selection.to <= beforeMediaLength) {
 		return result;
 	}
@@ -1299,7 +1328,7 @@ int Message::timeLeft() const {
 
 int Message::plainMaxWidth() const {
 	return st::msgPadding.left()
-		+ (hasVisibleText() ? message()->_text.maxWidth() : 0)
+		+ (hasVisibleText() ? message()->text().maxWidth() : 0)
 		+ st::msgPadding.right();
 }
 
@@ -1586,11 +1615,11 @@ void Message::fromNameUpdated(int width) const {
 }
 
 TextSelection Message::skipTextSelection(TextSelection selection) const {
-	return HistoryView::UnshiftItemSelection(selection, message()->_text);
+	return HistoryView::UnshiftItemSelection(selection, message()->text());
 }
 
 TextSelection Message::unskipTextSelection(TextSelection selection) const {
-	return HistoryView::ShiftItemSelection(selection, message()->_text);
+	return HistoryView::ShiftItemSelection(selection, message()->text());
 }
 
 QRect Message::countGeometry() const {
@@ -1695,7 +1724,7 @@ int Message::resizeContentGetHeight(int newWidth) {
 				auto textWidth = qMax(contentWidth - st::msgPadding.left() - st::msgPadding.right(), 1);
 				if (textWidth != item->_textWidth) {
 					item->_textWidth = textWidth;
-					item->_textHeight = item->_text.countHeight(textWidth);
+					item->_textHeight = countTextHeight(textWidth);
 				}
 				newHeight = item->_textHeight;
 			} else {
@@ -1753,6 +1782,22 @@ int Message::resizeContentGetHeight(int newWidth) {
 	return newHeight;
 }
 
+int Message::countTextHeight(int textWidth) {
+	const auto item = message();
+	const auto &text = item->text();
+	if (!takeBackgroundTextLayout() || !Data::TextLayouts::Worthy(text)) {
+		return text.countHeight(textWidth);
+	}
+	const auto owner = &history()->owner();
+	owner->textLayouts().enqueue(item, text, textWidth, [=](int height) {
+		if (item->_textWidth == textWidth) {
+			item->_textHeight = height;
+			owner->requestItemResize(item);
+		}
+	});
+	return Data::TextLayouts::EstimateHeight(text, textWidth);
+}
+
 bool Message::hasVisibleText() const {
 	if (message()->emptyText()) {
 		return false;
@@ -1782,6 +1827,23 @@ QSize Message::performCountCurrentSize(int newWidth) {
 	return { newWidth, newHeight };
 }
 
+int Message::layoutKey(int newWidth) const {
+	if (isHidden()) {
+		return 0;
+	} else if (newWidth < st::msgMinWidth) {
+		return -1;
+	}
+
+	// Everything in resizeContentGetHeight() depends on this width only.
+	auto contentWidth = newWidth - (st::msgMargin.left() + st::msgMargin.right());
+	if (hasFromPhoto() && displayRightAction()) {
+		contentWidth -= st::msgPhotoSkip;
+	}
+	accumulate_min(contentWidth, maxWidth());
+	accumulate_min(contentWidth, st::msgMaxWidth);
+	return contentWidth;
+}
+
 void Message::refreshEditedBadge() {
 	const auto item = message();
 	const auto edited = displayedEditBadge();
@@ -1817,8 +1879,8 @@ void Message::initTime() {
 			? 0
 			: st::msgDateFont->width(views->_viewsText);
 	}
-	if (item->_text.hasSkipBlock()) {
-		if (item->_text.updateSkipBlock(skipBlockWidth(), skipBlockHeight())) {
+	if (item->text().hasSkipBlock()) {
+		if (item->text().updateSkipBlock(skipBlockWidth(), skipBlockHeight())) {
 			item->_textWidth = -1;
 			item->_textHeight = 0;
 		}
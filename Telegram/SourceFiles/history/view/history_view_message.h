@@ -85,6 +85,7 @@ public:
 	bool displayEditedBadge() const override;
 	TimeId displayedEditDate() const override;
 	int infoWidth() const override;
+	std::optional<QPoint> mediaPosition() const override;
 
 protected:
 	void refreshDataIdHook() override;
@@ -135,8 +136,10 @@ private:
 	QRect countGeometry() const;
 
 	int resizeContentGetHeight(int newWidth);
+	int countTextHeight(int textWidth);
 	QSize performCountOptimalSize() override;
 	QSize performCountCurrentSize(int newWidth) override;
+	int layoutKey(int newWidth) const override;
 	bool hasVisibleText() const override;
 
 	bool displayFastShare() const;
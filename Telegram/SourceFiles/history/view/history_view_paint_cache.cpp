@@ -0,0 +1,156 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "history/view/history_view_paint_cache.h"
+
+#include "history/view/history_view_element.h"
+#include "window/themes/window_theme.h"
+#include "app.h"
+
+namespace HistoryView {
+namespace {
+
+constexpr auto kAnimatedTimeout = crl::time(1000);
+constexpr auto kMaxCacheBytes = int64(48 * 1024 * 1024);
+
+[[nodiscard]] int64 PixmapBytes(QSize size) {
+	return int64(size.width()) * size.height() * cIntRetinaFactor()
+		* cIntRetinaFactor() * 4;
+}
+
+} // namespace
+
+PaintCache::PaintCache() {
+	subscribe(Window::Theme::Background(), [=](
+			const Window::Theme::BackgroundUpdate &update) {
+		if (update.paletteChanged()) {
+			clear();
+		}
+	});
+}
+
+void PaintCache::paint(
+		Painter &p,
+		not_null<Element*> view,
+		QRect clip,
+		TextSelection selection,
+		crl::time ms) {
+	auto &entry = _entries[view];
+	const auto size = QSize(view->width(), view->height());
+	const auto selectionMode = view->delegate()->elementInSelectionMode();
+	if (entry.valid
+		&& (entry.size != size
+			|| entry.selection != selection
+			|| entry.selectionMode != selectionMode)) {
+		entry.valid = false;
+	}
+	entry.used = ++_paintIndex;
+	if (!entry.valid) {
+		if (!canCache(view, entry, ms)) {
+			view->draw(p, clip, selection, ms);
+			return;
+		}
+		render(view, entry, selection, ms);
+	}
+	const auto part = clip.intersected(QRect(QPoint(), size));
+	if (!part.isEmpty()) {
+		p.drawPixmap(part.topLeft(), entry.pixmap, QRect(
+			part.topLeft() * cIntRetinaFactor(),
+			part.size() * cIntRetinaFactor()));
+	}
+}
+
+bool PaintCache::canCache(
+		not_null<Element*> view,
+		const Entry &entry,
+		crl::time ms) const {
+	if (entry.invalidated && entry.invalidated + kAnimatedTimeout > ms) {
+		return false;
+	} else if (view->isUnderCursor()) {
+		return false;
+	} else if (view->delegate()->elementHighlightTime(view) > 0) {
+		return false;
+	}
+	return (view->width() > 0) && (view->height() > 0);
+}
+
+void PaintCache::render(
+		not_null<Element*> view,
+		Entry &entry,
+		TextSelection selection,
+		crl::time ms) {
+	_bytes -= PixmapBytes(entry.size);
+
+	entry.size = QSize(view->width(), view->height());
+	entry.selection = selection;
+	entry.selectionMode = view->delegate()->elementInSelectionMode();
+	entry.valid = true;
+
+	auto image = QImage(
+		entry.size * cIntRetinaFactor(),
+		QImage::Format_ARGB32_Premultiplied);
+	image.setDevicePixelRatio(cRetinaFactor());
+	image.fill(Qt::transparent);
+	{
+		Painter q(&image);
+		view->draw(q, QRect(QPoint(), entry.size), selection, ms);
+	}
+	entry.pixmap = App::pixmapFromImageInPlace(std::move(image));
+
+	_bytes += PixmapBytes(entry.size);
+	shrinkToLimit();
+}
+
+void PaintCache::invalidate(not_null<const Element*> view) {
+	const auto i = _entries.find(view);
+	if (i == _entries.end()) {
+		return;
+	}
+	i->second.valid = false;
+	i->second.invalidated = crl::now();
+	i->second.pixmap = QPixmap();
+	_bytes -= PixmapBytes(base::take(i->second.size));
+}
+
+void PaintCache::remove(not_null<const Element*> view) {
+	const auto i = _entries.find(view);
+	if (i != _entries.end()) {
+		_bytes -= PixmapBytes(i->second.size);
+		_entries.erase(i);
+	}
+}
+
+void PaintCache::clear() {
+	_entries.clear();
+	_bytes = 0;
+}
+
+void PaintCache::shrinkToLimit() {
+	if (_bytes <= kMaxCacheBytes) {
+		return;
+	}
+	auto used = std::vector<uint64>();
+	used.reserve(_entries.size());
+	for (const auto &[view, entry] : _entries) {
+		if (entry.valid) {
+			used.push_back(entry.used);
+		}
+	}
+	ranges::sort(used);
+
+	// Drop the least recently painted half of the cached images.
+	const auto border = used[used.size() / 2];
+	for (auto &[view, entry] : _entries) {
+		if (entry.valid && entry.used < border) {
+			entry.valid = false;
+			entry.pixmap = QPixmap();
+			_bytes -= PixmapBytes(base::take(entry.size));
+		}
+	}
+}
+
+} // namespace HistoryView
@@ -0,0 +1,66 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/observer.h"
+
+class Painter;
+
+namespace HistoryView {
+
+class Element;
+
+// Keeps the last rendered image of message views that didn't ask for
+// a repaint recently, so that scrolling a chat only blits them.
+//
+// Views that repaint often (animations, progress, playback) and views
+// under the cursor or highlighted are drawn directly every time.
+class PaintCache final : private base::Subscriber {
+public:
+	PaintCache();
+
+	void paint(
+		Painter &p,
+		not_null<Element*> view,
+		QRect clip,
+		TextSelection selection,
+		crl::time ms);
+
+	void invalidate(not_null<const Element*> view);
+	void remove(not_null<const Element*> view);
+	void clear();
+
+private:
+	struct Entry {
+		QPixmap pixmap;
+		QSize size;
+		TextSelection selection;
+		bool selectionMode = false;
+		bool valid = false;
+		crl::time invalidated = 0;
+		uint64 used = 0;
+	};
+
+	[[nodiscard]] bool canCache(
+		not_null<Element*> view,
+		const Entry &entry,
+		crl::time ms) const;
+	void render(
+		not_null<Element*> view,
+		Entry &entry,
+		TextSelection selection,
+		crl::time ms);
+	void shrinkToLimit();
+
+	base::flat_map<not_null<const Element*>, Entry> _entries;
+	int64 _bytes = 0;
+	uint64 _paintIndex = 0;
+
+};
+
+} // namespace HistoryView
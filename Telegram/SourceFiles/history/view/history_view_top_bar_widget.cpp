@@ -104,10 +104,15 @@ TopBarWidget::TopBarWidget(
 	subscribe(Adaptive::Changed(), [=] { updateAdaptiveLayout(); });
 	refreshUnreadBadge();
 	{
+		using AnimationUpdates = Data::Session::SendActionAnimationUpdates;
 		using AnimationUpdate = Data::Session::SendActionAnimationUpdate;
 		session().data().sendActionAnimationUpdated(
-		) | rpl::filter([=](const AnimationUpdate &update) {
-			return (update.history == _activeChat.history());
+		) | rpl::filter([=](const AnimationUpdates &updates) {
+			const auto history = _activeChat.history();
+			return history && ranges::find(
+				updates,
+				not_null<History*>(history),
+				&AnimationUpdate::history) != end(updates);
 		}) | rpl::start_with_next([=] {
 			update();
 		}, lifetime());
@@ -124,7 +129,7 @@ TopBarWidget::TopBarWidget(
 				updateControlsVisibility();
 			}
 		} else {
-			updateOnlineDisplay();
+			scheduleOnlineDisplayUpdate();
 		}
 	}));
 	subscribe(Global::RefPhoneCallsEnabledChanged(), [this] {
@@ -907,6 +912,14 @@ void TopBarWidget::updateOnlineDisplayTimer() {
 	updateOnlineDisplayIn(minTimeout);
 }
 
+void TopBarWidget::scheduleOnlineDisplayUpdate() {
+	// Many members of a large group may change their status at once,
+	// count the online members only once for all of them.
+	if (!_onlineUpdater.isActive() || _onlineUpdater.remainingTime() > 0) {
+		updateOnlineDisplayIn(0);
+	}
+}
+
 void TopBarWidget::updateOnlineDisplayIn(crl::time timeout) {
 	_onlineUpdater.callOnce(timeout);
 }
@@ -114,6 +114,7 @@ private:
 	void updateMembersShowArea();
 	void updateOnlineDisplay();
 	void updateOnlineDisplayTimer();
+	void scheduleOnlineDisplayUpdate();
 	void updateOnlineDisplayIn(crl::time timeout);
 
 	void infoClicked();
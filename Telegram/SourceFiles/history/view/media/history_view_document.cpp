@@ -65,6 +65,19 @@ bool Document::dataLoaded() const {
 	return _data->loaded();
 }
 
+// Everything above the caption: the icon, the name and the status line.
+QRect Document::progressRect() const {
+	const auto topMinus = isBubbleTop() ? 0 : st::msgFileTopMinus;
+	const auto bottom = Get<HistoryDocumentThumbed>()
+		? (st::msgFileThumbPadding.top()
+			+ st::msgFileThumbSize
+			+ st::msgFileThumbPadding.bottom())
+		: (st::msgFilePadding.top()
+			+ st::msgFileSize
+			+ st::msgFilePadding.bottom());
+	return QRect(0, 0, width(), bottom - topMinus);
+}
+
 void Document::createComponents(bool caption) {
 	uint64 mask = 0;
 	if (_data->isVoiceMessage()) {
@@ -205,6 +218,11 @@ QSize Document::countCurrentSize(int newWidth) {
 	return { newWidth, newHeight };
 }
 
+void Document::prefetch() {
+	_data->loadThumbnail(_realParent->fullId());
+	_data->automaticLoad(_realParent->fullId(), _parent->data());
+}
+
 void Document::draw(Painter &p, const QRect &r, TextSelection selection, crl::time ms) const {
 	if (width() < st::msgPadding.left() + st::msgPadding.right() + 1) return;
 
@@ -629,7 +647,7 @@ void Document::updatePressed(QPoint point) {
 				nameright = st::msgFilePadding.left();
 			}
 			voice->setSeekingCurrent(snap((point.x() - nameleft) / float64(width() - nameleft - nameright), 0., 1.));
-			history()->owner().requestViewRepaint(_parent);
+			repaint(progressRect());
 		}
 	}
 }
@@ -778,7 +796,7 @@ bool Document::voiceProgressAnimationCallback(crl::time now) {
 			} else {
 				voice->_playback->progress.update(qMin(dt, 1.), anim::linear);
 			}
-			history()->owner().requestViewRepaint(_parent);
+			repaint(progressRect());
 			return (dt < 1.);
 		}
 	}
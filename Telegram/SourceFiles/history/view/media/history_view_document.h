@@ -23,6 +23,7 @@ public:
 		not_null<DocumentData*> document);
 
 	void draw(Painter &p, const QRect &r, TextSelection selection, crl::time ms) const override;
+	void prefetch() override;
 	TextState textState(QPoint point, StateRequest request) const override;
 	void updatePressed(QPoint point) override;
 
@@ -61,6 +62,7 @@ protected:
 	float64 dataProgress() const override;
 	bool dataFinished() const override;
 	bool dataLoaded() const override;
+	QRect progressRect() const override;
 
 private:
 	struct StateFromPlayback {
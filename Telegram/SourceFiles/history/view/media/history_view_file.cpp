@@ -29,7 +29,11 @@ void File::clickHandlerActiveChanged(const ClickHandlerPtr &p, bool active) {
 }
 
 void File::thumbAnimationCallback() {
-	history()->owner().requestViewRepaint(_parent);
+	repaint(progressRect());
+}
+
+QRect File::progressRect() const {
+	return QRect(0, 0, width(), height());
 }
 
 void File::clickHandlerPressedChanged(
@@ -77,7 +81,7 @@ void File::radialAnimationCallback(crl::time now) const {
 			now);
 	}();
 	if (!anim::Disabled() || updated) {
-		history()->owner().requestViewRepaint(_parent);
+		repaint(progressRect());
 	}
 	if (!_animation->radial.animating()) {
 		checkAnimationFinished();
@@ -68,6 +68,9 @@ protected:
 	void radialAnimationCallback(crl::time now) const;
 	void thumbAnimationCallback();
 
+	// The part that changes with the loading or playback progress.
+	[[nodiscard]] virtual QRect progressRect() const;
+
 	void ensureAnimation() const;
 	void checkAnimationFinished() const;
 
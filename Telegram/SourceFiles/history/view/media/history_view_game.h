@@ -56,6 +56,9 @@ public:
 	void stopAnimation() override {
 		if (_attach) _attach->stopAnimation();
 	}
+	void prefetch() override {
+		if (_attach) _attach->prefetch();
+	}
 
 	not_null<GameData*> game() {
 		return _data;
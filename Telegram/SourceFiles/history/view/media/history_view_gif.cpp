@@ -28,6 +28,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_session.h"
 #include "data/data_document.h"
 #include "data/data_file_origin.h"
+#include "data/data_animation_posters.h"
 #include "app.h"
 #include "styles/style_history.h"
 
@@ -230,6 +231,11 @@ bool Gif::autoplayEnabled() const {
 	return history()->session().settings().autoplayGifs();
 }
 
+void Gif::prefetch() {
+	_data->loadThumbnail(_realParent->fullId());
+	_data->automaticLoad(_realParent->fullId(), _parent->data());
+}
+
 void Gif::draw(Painter &p, const QRect &r, TextSelection selection, crl::time ms) const {
 	if (width() < st::msgPadding.left() + st::msgPadding.right() + 1) return;
 
@@ -315,7 +321,9 @@ void Gif::draw(Painter &p, const QRect &r, TextSelection selection, crl::time ms
 			request.radius = roundRadius;
 			p.drawImage(rthumb, player->frame(request));
 		} else {
-			p.drawPixmap(rthumb.topLeft(), reader->current(_thumbw, _thumbh, usew, painth, roundRadius, roundCorners, paused ? 0 : ms));
+			const auto frame = reader->current(_thumbw, _thumbh, usew, painth, roundRadius, roundCorners, paused ? 0 : ms);
+			p.drawPixmap(rthumb.topLeft(), frame);
+			_data->owner().animationPosters().remember(_data, roundRadius, roundCorners, frame);
 		}
 
 		if (const auto playback = videoPlayback()) {
@@ -340,6 +348,8 @@ void Gif::draw(Painter &p, const QRect &r, TextSelection selection, crl::time ms
 				p.setOpacity(1.);
 			}
 		}
+	} else if (const auto poster = _data->owner().animationPosters().lookup(_data, QSize(usew, painth), roundRadius, roundCorners); !poster.isNull()) {
+		p.drawPixmap(rthumb.topLeft(), poster);
 	} else {
 		const auto good = _data->goodThumbnail();
 		if (good && good->loaded()) {
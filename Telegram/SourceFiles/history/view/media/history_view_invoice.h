@@ -66,6 +66,10 @@ public:
 		return false;
 	}
 
+	void prefetch() override {
+		if (_attach) _attach->prefetch();
+	}
+
 	Media *attach() const {
 		return _attach.get();
 	}
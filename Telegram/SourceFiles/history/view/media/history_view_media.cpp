@@ -8,6 +8,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "history/view/media/history_view_media.h"
 
 #include "history/history_item.h"
+#include "history/history.h"
+#include "data/data_session.h"
 #include "history/view/history_view_element.h"
 #include "history/view/history_view_cursor_state.h"
 #include "storage/storage_shared_media.h"
@@ -24,6 +26,23 @@ not_null<History*> Media::history() const {
 	return _parent->history();
 }
 
+void Media::repaint(QRect rect) const {
+	const auto position = (_parent->media() == this)
+		? _parent->mediaPosition()
+		: std::nullopt;
+	if (position) {
+		history()->owner().requestViewPartRepaint(
+			_parent,
+			rect.translated(*position));
+	} else {
+		history()->owner().requestViewRepaint(_parent);
+	}
+}
+
+void Media::repaint() const {
+	repaint(QRect(0, 0, width(), height()));
+}
+
 bool Media::isDisplayed() const {
 	return true;
 }
@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "history/view/history_view_object.h"
 #include "ui/rect_part.h"
+#include "base/small_pool.h"
 
 class History;
 struct HistoryMessageEdited;
@@ -42,6 +43,8 @@ enum class MediaInBubbleState {
 
 class Media : public Object {
 public:
+	BASE_SMALL_POOL_ALLOCATED
+
 	Media(not_null<Element*> parent) : _parent(parent) {
 	}
 
@@ -223,6 +226,10 @@ public:
 	virtual void unloadHeavyPart() {
 	}
 
+	// Starts loading what draw() will need, before it is visible.
+	virtual void prefetch() {
+	}
+
 	// Should be called only by Data::Session.
 	virtual void updateSharedContactUserId(UserId userId) {
 	}
@@ -238,6 +245,10 @@ protected:
 	virtual void playAnimation(bool autoplay) {
 	}
 
+	// Repaints a part of the media, the whole view if its place is unknown.
+	void repaint(QRect rect) const;
+	void repaint() const;
+
 	not_null<Element*> _parent;
 	MediaInBubbleState _inBubbleState = MediaInBubbleState::None;
 
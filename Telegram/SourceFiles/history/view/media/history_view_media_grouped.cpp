@@ -160,6 +160,12 @@ void GroupedMedia::refreshParentId(
 	}
 }
 
+void GroupedMedia::prefetch() {
+	for (const auto &part : _parts) {
+		part.content->prefetch();
+	}
+}
+
 void GroupedMedia::draw(
 		Painter &p,
 		const QRect &clip,
@@ -35,6 +35,7 @@ public:
 		const QRect &clip,
 		TextSelection selection,
 		crl::time ms) const override;
+	void prefetch() override;
 	PointState pointState(QPoint point) const override;
 	TextState textState(
 		QPoint point,
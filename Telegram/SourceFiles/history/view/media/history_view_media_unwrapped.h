@@ -36,6 +36,8 @@ public:
 		}
 		virtual void unloadHeavyPart() {
 		}
+		virtual void prefetch() {
+		}
 		virtual void refreshLink() {
 		}
 		[[nodiscard]] virtual bool alwaysShowOutTimestamp() {
@@ -82,6 +84,9 @@ public:
 	void unloadHeavyPart() override {
 		_content->unloadHeavyPart();
 	}
+	void prefetch() override {
+		_content->prefetch();
+	}
 
 private:
 	int surroundingHeight(
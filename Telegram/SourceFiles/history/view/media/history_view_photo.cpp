@@ -15,6 +15,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "history/view/history_view_cursor_state.h"
 #include "history/view/media/history_view_media_common.h"
 #include "ui/image/image.h"
+#include "ui/image/image_prepare.h"
 #include "ui/grouped_layout.h"
 #include "data/data_session.h"
 #include "data/data_photo.h"
@@ -23,6 +24,11 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "styles/style_history.h"
 
 namespace HistoryView {
+namespace {
+
+constexpr auto kPrepareGroupedInBackgroundPixels = 320 * 320;
+
+} // namespace
 
 Photo::Photo(
 	not_null<Element*> parent,
@@ -142,6 +148,10 @@ QSize Photo::countCurrentSize(int newWidth) {
 	return { newWidth, newHeight };
 }
 
+void Photo::prefetch() {
+	_data->automaticLoad(_realParent->fullId(), _parent->data());
+}
+
 void Photo::draw(Painter &p, const QRect &r, TextSelection selection, crl::time ms) const {
 	if (width() < st::msgPadding.left() + st::msgPadding.right() + 1) return;
 
@@ -508,7 +518,12 @@ void Photo::validateGroupedCache(
 		| (uint64(height) << 32)
 		| (uint64(options) << 16)
 		| (uint64(loadLevel));
-	if (*cacheKey == key) {
+	if (_groupedPreparedKey == key && !_groupedPrepared.isNull()) {
+		*cacheKey = key;
+		*cache = base::take(_groupedPrepared);
+		_groupedPreparedKey = 0;
+		return;
+	} else if (*cacheKey == key) {
 		return;
 	}
 
@@ -529,8 +544,49 @@ void Photo::validateGroupedCache(
 		? _data->thumbnailInline()
 		: Image::BlankMedia().get();
 
+	// Smooth scaling of all the album parts goes to the background in
+	// parallel, a fast version is shown until they're ready.
+	const auto background = loaded
+		&& (image->width() * image->height()
+			>= kPrepareGroupedInBackgroundPixels);
 	*cacheKey = key;
-	*cache = image->pixNoCache(_realParent->fullId(), pixWidth, pixHeight, options, width, height);
+	*cache = image->pixNoCache(
+		_realParent->fullId(),
+		pixWidth,
+		pixHeight,
+		background ? (options & ~Option::Smooth) : options,
+		width,
+		height);
+	if (!background) {
+		_groupedPreparing = nullptr;
+		return;
+	} else if (_groupedPreparing && _groupedPreparingKey == key) {
+		return;
+	}
+	_groupedPrepared = QPixmap();
+	_groupedPreparedKey = 0;
+	_groupedPreparingKey = key;
+	auto guard = _groupedPreparing.make_guard();
+	crl::async([
+		=,
+		data = image->original(),
+		guard = std::move(guard)
+	]() mutable {
+		auto result = Images::prepare(
+			std::move(data),
+			pixWidth,
+			pixHeight,
+			options,
+			width,
+			height);
+		crl::on_main(std::move(guard), [=, result = std::move(result)]() mutable {
+			_groupedPreparing = nullptr;
+			_groupedPrepared = App::pixmapFromImageInPlace(std::move(result));
+			_groupedPrepared.setDevicePixelRatio(cRetinaFactor());
+			_groupedPreparedKey = key;
+			history()->owner().requestViewRepaint(_parent);
+		});
+	});
 }
 
 TextForMimeData Photo::selectedText(TextSelection selection) const {
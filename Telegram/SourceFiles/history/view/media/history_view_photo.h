@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #pragma once
 
 #include "history/view/media/history_view_file.h"
+#include "base/binary_guard.h"
 
 namespace HistoryView {
 
@@ -24,6 +25,7 @@ public:
 		int width);
 
 	void draw(Painter &p, const QRect &clip, TextSelection selection, crl::time ms) const override;
+	void prefetch() override;
 	TextState textState(QPoint point, StateRequest request) const override;
 
 	[[nodiscard]] TextSelection adjustSelection(
@@ -97,6 +99,11 @@ private:
 	int _pixh = 1;
 	Ui::Text::String _caption;
 
+	mutable base::binary_guard _groupedPreparing;
+	mutable uint64 _groupedPreparingKey = 0;
+	mutable QPixmap _groupedPrepared;
+	mutable uint64 _groupedPreparedKey = 0;
+
 };
 
 } // namespace HistoryView
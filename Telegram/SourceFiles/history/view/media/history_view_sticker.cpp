@@ -34,6 +34,66 @@ double GetEmojiStickerZoom(not_null<Main::Session*> session) {
 	return session->appConfig().get<double>("emojies_animated_zoom", 0.625);
 }
 
+struct SharedPlayerKey {
+	not_null<DocumentData*> document;
+	const Lottie::ColorReplacements *replacements = nullptr;
+	QSize box;
+
+	friend inline bool operator<(
+			const SharedPlayerKey &a,
+			const SharedPlayerKey &b) {
+		const auto tuple = [](const SharedPlayerKey &key) {
+			return std::make_tuple(
+				key.document.get(),
+				key.replacements,
+				key.box.width(),
+				key.box.height());
+		};
+		return tuple(a) < tuple(b);
+	}
+};
+
+using SharedPlayersMap = base::flat_map<
+	SharedPlayerKey,
+	std::weak_ptr<Lottie::SinglePlayer>>;
+
+SharedPlayersMap &SharedPlayers() {
+	static auto result = SharedPlayersMap();
+	return result;
+}
+
+// Looping copies of the same sticker at the same size show the same
+// frames, so they share one player: one decode and one frame ring.
+std::shared_ptr<Lottie::SinglePlayer> SharedPlayer(
+		not_null<DocumentData*> document,
+		const Lottie::ColorReplacements *replacements,
+		QSize box) {
+	const auto key = SharedPlayerKey{ document, replacements, box };
+	auto &players = SharedPlayers();
+	const auto i = players.find(key);
+	if (i != end(players)) {
+		if (auto result = i->second.lock()) {
+			return result;
+		}
+	}
+	auto result = std::shared_ptr<Lottie::SinglePlayer>(
+		Stickers::LottiePlayerFromDocument(
+			document,
+			replacements,
+			Stickers::LottieSize::MessageHistory,
+			box,
+			Lottie::Quality::High).release(),
+		[=](Lottie::SinglePlayer *player) {
+			const auto i = SharedPlayers().find(key);
+			if (i != end(SharedPlayers()) && i->second.expired()) {
+				SharedPlayers().erase(i);
+			}
+			delete player;
+		});
+	players[key] = result;
+	return result;
+}
+
 } // namespace
 
 Sticker::Sticker(
@@ -186,12 +246,18 @@ void Sticker::refreshLink() {
 }
 
 void Sticker::setupLottie() {
-	_lottie = Stickers::LottiePlayerFromDocument(
-		_document,
-		_replacements,
-		Stickers::LottieSize::MessageHistory,
-		_size * cIntRetinaFactor(),
-		Lottie::Quality::High);
+	// Stickers played once keep their own timeline.
+	const auto playOnce = isEmojiSticker()
+		|| !_document->session().settings().loopAnimatedStickers();
+	_lottie = playOnce
+		? std::shared_ptr<Lottie::SinglePlayer>(
+			Stickers::LottiePlayerFromDocument(
+				_document,
+				_replacements,
+				Stickers::LottieSize::MessageHistory,
+				_size * cIntRetinaFactor(),
+				Lottie::Quality::High))
+		: SharedPlayer(_document, _replacements, _size * cIntRetinaFactor());
 	_parent->data()->history()->owner().registerHeavyViewPart(_parent);
 
 	_lottie->updates(
@@ -201,13 +267,14 @@ void Sticker::setupLottie() {
 		}, [&](const Lottie::DisplayFrameRequest &request) {
 			_parent->data()->history()->owner().requestViewRepaint(_parent);
 		});
-	}, _lifetime);
+	}, _lottieLifetime);
 }
 
 void Sticker::unloadLottie() {
 	if (!_lottie) {
 		return;
 	}
+	_lottieLifetime.destroy();
 	_lottie = nullptr;
 	_parent->data()->history()->owner().unregisterHeavyViewPart(_parent);
 }
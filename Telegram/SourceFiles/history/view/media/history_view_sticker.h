@@ -46,6 +46,9 @@ public:
 	void unloadHeavyPart() override {
 		unloadLottie();
 	}
+	void prefetch() override {
+		_document->checkStickerLarge();
+	}
 	void refreshLink() override;
 
 private:
@@ -60,12 +63,12 @@ private:
 	const not_null<Element*> _parent;
 	const not_null<DocumentData*> _document;
 	const Lottie::ColorReplacements *_replacements = nullptr;
-	std::unique_ptr<Lottie::SinglePlayer> _lottie;
+	std::shared_ptr<Lottie::SinglePlayer> _lottie;
 	ClickHandlerPtr _link;
 	QSize _size;
 	mutable bool _lottieOncePlayed = false;
 
-	rpl::lifetime _lifetime;
+	rpl::lifetime _lottieLifetime;
 
 };
 
@@ -97,6 +97,11 @@ QSize ThemeDocument::countCurrentSize(int newWidth) {
 	return { newWidth, newHeight };
 }
 
+void ThemeDocument::prefetch() {
+	_data->loadThumbnail(_parent->data()->fullId());
+	_data->automaticLoad(_realParent->fullId(), _parent->data());
+}
+
 void ThemeDocument::draw(Painter &p, const QRect &r, TextSelection selection, crl::time ms) const {
 	if (width() < st::msgPadding.left() + st::msgPadding.right() + 1) return;
 
@@ -23,6 +23,7 @@ public:
 		const QRect &clip,
 		TextSelection selection,
 		crl::time ms) const override;
+	void prefetch() override;
 	TextState textState(QPoint point, StateRequest request) const override;
 
 	DocumentData *getDocument() const override {
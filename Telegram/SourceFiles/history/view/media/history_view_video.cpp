@@ -147,6 +147,11 @@ bool Video::downloadInCorner() const {
 		&& IsServerMsgId(_parent->data()->id);
 }
 
+void Video::prefetch() {
+	_data->loadThumbnail(_realParent->fullId());
+	_data->automaticLoad(_realParent->fullId(), _parent->data());
+}
+
 void Video::draw(Painter &p, const QRect &r, TextSelection selection, crl::time ms) const {
 	if (width() < st::msgPadding.left() + st::msgPadding.right() + 1) return;
 
@@ -19,6 +19,7 @@ public:
 		not_null<DocumentData*> document);
 
 	void draw(Painter &p, const QRect &r, TextSelection selection, crl::time ms) const override;
+	void prefetch() override;
 	TextState textState(QPoint point, StateRequest request) const override;
 
 	[[nodiscard]] TextSelection adjustSelection(
@@ -62,6 +62,9 @@ public:
 	void stopAnimation() override {
 		if (_attach) _attach->stopAnimation();
 	}
+	void prefetch() override {
+		if (_attach) _attach->prefetch();
+	}
 
 	not_null<WebPageData*> webpage() {
 		return _data;
@@ -51,6 +51,9 @@ constexpr auto kPreloadedScreensCountFull
 	= kPreloadedScreensCount + 1 + kPreloadedScreensCount;
 constexpr auto kMediaCountForSearch = 10;
 
+// Layouts that just left the slice are kept for scrolling back.
+constexpr auto kKeptStaleLayouts = 64;
+
 UniversalMsgId GetUniversalId(FullMsgId itemId) {
 	return (itemId.channel != 0)
 		? UniversalMsgId(itemId.msg)
@@ -1027,6 +1030,7 @@ void ListWidget::visibleTopBottomUpdated(
 	_visibleTop = visibleTop;
 	_visibleBottom = visibleBottom;
 
+	session().downloader().clearPriorities();
 	checkMoveToOtherViewer();
 }
 
@@ -1768,7 +1772,9 @@ void ListWidget::updateDragSelection() {
 	for (auto &layoutItem : _layouts) {
 		auto &&universalId = layoutItem.first;
 		auto &&layout = layoutItem.second;
-		if (universalId <= fromId && universalId > tillId) {
+		if (layout.stale) {
+			continue;
+		} else if (universalId <= fromId && universalId > tillId) {
 			changeItemSelection(
 				_dragSelected,
 				universalId,
@@ -2100,15 +2106,38 @@ void ListWidget::mouseActionUpdate() {
 }
 
 void ListWidget::clearStaleLayouts() {
-	for (auto i = _layouts.begin(); i != _layouts.end();) {
+	// Layouts are ordered by id, so the stale ones close to a live one
+	// are those that will be needed first if the slice moves back.
+	constexpr auto kFar = kKeptStaleLayouts + 1;
+	const auto next = [](int distance, const CachedItem &layout) {
+		return layout.stale ? std::min(distance + 1, kFar) : 0;
+	};
+	auto distances = std::vector<int>();
+	distances.reserve(_layouts.size());
+	auto distance = kFar;
+	for (const auto &[universalId, layout] : _layouts) {
+		distances.push_back(distance = next(distance, layout));
+	}
+	distance = kFar;
+	auto index = int(distances.size());
+	for (auto i = _layouts.rbegin(); i != _layouts.rend(); ++i) {
+		distance = next(distance, i->second);
+		auto &already = distances[--index];
+		already = std::min(already, distance);
+	}
+
+	index = 0;
+	for (auto i = _layouts.begin(); i != _layouts.end(); ++index) {
 		if (i->second.stale) {
 			if (i->second.item.get() == _overLayout) {
 				_overLayout = nullptr;
 			}
-			i = _layouts.erase(i);
-		} else {
-			++i;
+			if (distances[index] == kFar) {
+				i = _layouts.erase(i);
+				continue;
+			}
 		}
+		++i;
 	}
 }
 
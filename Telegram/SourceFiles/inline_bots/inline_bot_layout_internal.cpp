@@ -10,6 +10,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_photo.h"
 #include "data/data_document.h"
 #include "data/data_session.h"
+#include "data/data_animation_posters.h"
 #include "styles/style_overview.h"
 #include "styles/style_history.h"
 #include "styles/style_chat_helpers.h"
@@ -161,10 +162,14 @@ void Gif::paint(Painter &p, const QRect &clip, const PaintContext *context) cons
 	QSize frame = countFrameSize();
 
 	QRect r(0, 0, _width, height);
+	auto &posters = document->owner().animationPosters();
 	if (animating) {
 		if (!_thumb.isNull()) _thumb = QPixmap();
 		auto pixmap = _gif->current(frame.width(), frame.height(), _width, height, ImageRoundRadius::None, RectPart::None, context->paused ? 0 : context->ms);
 		p.drawPixmap(r.topLeft(), pixmap);
+		posters.remember(document, ImageRoundRadius::None, RectPart::None, pixmap);
+	} else if (const auto poster = posters.lookup(document, { _width, height }, ImageRoundRadius::None, RectPart::None); !poster.isNull()) {
+		p.drawPixmap(r.topLeft(), poster);
 	} else {
 		prepareThumbnail({ _width, height }, frame);
 		if (_thumb.isNull()) {
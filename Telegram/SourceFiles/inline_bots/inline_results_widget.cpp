@@ -43,6 +43,8 @@ namespace internal {
 namespace {
 
 constexpr auto kInlineBotRequestDelay = 400;
+constexpr auto kInlinePreloadScreens = 2;
+constexpr auto kInlineCacheLimit = 64;
 
 } // namespace
 
@@ -85,6 +87,7 @@ void Inner::visibleTopBottomUpdated(
 		_visibleTop = visibleTop;
 		_lastScrolled = crl::now();
 	}
+	preloadRows();
 }
 
 void Inner::checkRestrictedPeer() {
@@ -314,7 +317,6 @@ bool Inner::inlineRowsAddItem(Result *result, Row &row, int32 &sumWidth) {
 	auto layout = layoutPrepareInlineResult(result, (_rows.size() * MatrixRowShift) + row.items.size());
 	if (!layout) return false;
 
-	layout->preload();
 	if (inlineRowFinalize(row, sumWidth, layout->isFullLine())) {
 		layout->setPosition(_rows.size() * MatrixRowShift);
 	}
@@ -359,6 +361,7 @@ void Inner::clearInlineRows(bool resultsDeleted) {
 		}
 	}
 	_rows.clear();
+	_preloadedRows = 0;
 }
 
 ItemBase *Inner::layoutPrepareInlineResult(Result *result, int32 position) {
@@ -427,9 +430,36 @@ Inner::Row &Inner::layoutInlineRow(Row &row, int32 sumWidth) {
 }
 
 void Inner::preloadImages() {
-	for (auto row = 0, rows = _rows.size(); row != rows; ++row) {
-		for (auto col = 0, cols = _rows[row].items.size(); col != cols; ++col) {
-			_rows[row].items[col]->preload();
+	_preloadedRows = 0;
+	preloadRows();
+}
+
+void Inner::preloadRows() {
+	// Thumbnails are requested row by row, a few screens ahead only.
+	const auto visibleHeight = std::max(
+		_visibleBottom - _visibleTop,
+		int(st::inlineResultsMinHeight));
+	const auto till = _visibleBottom + kInlinePreloadScreens * visibleHeight;
+	auto top = st::stickerPanPadding;
+	for (auto row = 0, rows = int(_rows.size()); row != rows; ++row) {
+		if (top >= till) {
+			break;
+		} else if (row >= _preloadedRows) {
+			for (const auto item : _rows[row].items) {
+				item->preload();
+			}
+			_preloadedRows = row + 1;
+		}
+		top += _rows[row].height;
+	}
+}
+
+void Inner::inlineResultsDeleted(const Results &results) {
+	for (const auto &result : results) {
+		const auto i = _inlineLayouts.find(result.get());
+		if (i != end(_inlineLayouts)) {
+			Assert(i->second->position() < 0);
+			_inlineLayouts.erase(i);
 		}
 	}
 }
@@ -494,6 +524,7 @@ int Inner::refreshInlineRows(PeerData *queryPeer, UserData *bot, const CacheEntr
 	auto count = int(entry->results.size());
 	auto from = validateExistingInlineRows(entry->results);
 	auto added = 0;
+	_preloadedRows = std::min(_preloadedRows, int(_rows.size()));
 
 	if (count) {
 		_rows.reserve(count);
@@ -511,6 +542,7 @@ int Inner::refreshInlineRows(PeerData *queryPeer, UserData *bot, const CacheEntr
 	auto h = countHeight();
 	if (h != height()) resize(width(), h);
 	update();
+	preloadRows();
 
 	_lastMousePos = QCursor::pos();
 	updateSelected();
@@ -1037,18 +1069,19 @@ void Widget::inlineBotChanged() {
 	_inlineRequestId = 0;
 	_inlineQuery = _inlineNextQuery = _inlineNextOffset = QString();
 	_inlineBot = nullptr;
-	_inlineCache.clear();
 	_inner->inlineBotChanged();
 	_inner->hideInlineRowsPanel();
 
 	Notify::inlineBotRequesting(false);
 }
 
-void Widget::inlineResultsDone(const MTPmessages_BotResults &result) {
+void Widget::inlineResultsDone(
+		const CacheKey &key,
+		const MTPmessages_BotResults &result) {
 	_inlineRequestId = 0;
 	Notify::inlineBotRequesting(false);
 
-	auto it = _inlineCache.find(_inlineQuery);
+	auto it = _inlineCache.find(key);
 	auto adding = (it != _inlineCache.cend());
 	if (result.type() == mtpc_messages_botResults) {
 		auto &d = result.c_messages_botResults();
@@ -1057,10 +1090,13 @@ void Widget::inlineResultsDone(const MTPmessages_BotResults &result) {
 		auto &v = d.vresults().v;
 		auto queryId = d.vquery_id().v;
 
+		const auto now = crl::now();
 		if (it == _inlineCache.cend()) {
-			it = _inlineCache.emplace(_inlineQuery, std::make_unique<internal::CacheEntry>()).first;
+			it = _inlineCache.emplace(key, std::make_unique<internal::CacheEntry>()).first;
+			it->second->validTill = now + d.vcache_time().v * crl::time(1000);
 		}
 		auto entry = it->second.get();
+		entry->lastUsed = now;
 		entry->nextOffset = qs(d.vnext_offset().value_or_empty());
 		if (const auto switchPm = d.vswitch_pm()) {
 			switchPm->match([&](const MTPDinlineBotSwitchPM &data) {
@@ -1090,9 +1126,52 @@ void Widget::inlineResultsDone(const MTPmessages_BotResults &result) {
 	if (!showInlineRows(!adding)) {
 		it->second->nextOffset = QString();
 	}
+	if (!adding) {
+		trimInlineCache();
+	}
 	onScroll();
 }
 
+auto Widget::cacheKey(const QString &query) const -> CacheKey {
+	Expects(_inlineBot != nullptr);
+	Expects(_inlineQueryPeer != nullptr);
+
+	return { _inlineBot, _inlineQueryPeer, query };
+}
+
+internal::CacheEntry *Widget::cachedEntry(const QString &query) {
+	if (!_inlineBot || !_inlineQueryPeer) {
+		return nullptr;
+	}
+	const auto i = _inlineCache.find(cacheKey(query));
+	if (i == end(_inlineCache)) {
+		return nullptr;
+	}
+	const auto now = crl::now();
+	if (i->second->validTill <= now) {
+		removeCachedEntry(i);
+		return nullptr;
+	}
+	i->second->lastUsed = now;
+	return i->second.get();
+}
+
+void Widget::removeCachedEntry(Cache::iterator i) {
+	_inner->inlineResultsDeleted(i->second->results);
+	_inlineCache.erase(i);
+}
+
+void Widget::trimInlineCache() {
+	// The shown results are the most recently used, they always stay.
+	while (int(_inlineCache.size()) > internal::kInlineCacheLimit) {
+		const auto i = ranges::min_element(
+			_inlineCache,
+			ranges::less(),
+			[](const auto &pair) { return pair.second->lastUsed; });
+		removeCachedEntry(i);
+	}
+}
+
 void Widget::queryInlineBot(UserData *bot, PeerData *peer, QString query) {
 	bool force = false;
 	_inlineQueryPeer = peer;
@@ -1108,7 +1187,7 @@ void Widget::queryInlineBot(UserData *bot, PeerData *peer, QString query) {
 			_inlineRequestId = 0;
 			Notify::inlineBotRequesting(false);
 		}
-		if (_inlineCache.find(query) != _inlineCache.cend()) {
+		if (cachedEntry(query)) {
 			_inlineRequestTimer.stop();
 			_inlineQuery = _inlineNextQuery = query;
 			showInlineRows(true);
@@ -1124,7 +1203,8 @@ void Widget::onInlineRequest() {
 	_inlineQuery = _inlineNextQuery;
 
 	QString nextOffset;
-	auto it = _inlineCache.find(_inlineQuery);
+	const auto key = cacheKey(_inlineQuery);
+	auto it = _inlineCache.find(key);
 	if (it != _inlineCache.cend()) {
 		nextOffset = it->second->nextOffset;
 		if (nextOffset.isEmpty()) {
@@ -1132,8 +1212,8 @@ void Widget::onInlineRequest() {
 		}
 	}
 	Notify::inlineBotRequesting(true);
-	_inlineRequestId = request(MTPmessages_GetInlineBotResults(MTP_flags(0), _inlineBot->inputUser, _inlineQueryPeer->input, MTPInputGeoPoint(), MTP_string(_inlineQuery), MTP_string(nextOffset))).done([this](const MTPmessages_BotResults &result, mtpRequestId requestId) {
-		inlineResultsDone(result);
+	_inlineRequestId = request(MTPmessages_GetInlineBotResults(MTP_flags(0), _inlineBot->inputUser, _inlineQueryPeer->input, MTPInputGeoPoint(), MTP_string(_inlineQuery), MTP_string(nextOffset))).done([=](const MTPmessages_BotResults &result, mtpRequestId requestId) {
+		inlineResultsDone(key, result);
 	}).fail([this](const RPCError &error) {
 		// show error?
 		Notify::inlineBotRequesting(false);
@@ -1147,7 +1227,9 @@ void Widget::onEmptyInlineRows() {
 }
 
 bool Widget::refreshInlineRows(int *added) {
-	auto it = _inlineCache.find(_inlineQuery);
+	auto it = (_inlineBot && _inlineQueryPeer)
+		? _inlineCache.find(cacheKey(_inlineQuery))
+		: _inlineCache.end();
 	const internal::CacheEntry *entry = nullptr;
 	if (it != _inlineCache.cend()) {
 		if (!it->second->results.empty() || !it->second->switchPmText.isEmpty()) {
@@ -49,6 +49,10 @@ struct CacheEntry {
 	QString nextOffset;
 	QString switchPmText, switchPmStartToken;
 	Results results;
+
+	// From the cache_time of the first page of the results.
+	crl::time validTill = 0;
+	crl::time lastUsed = 0;
 };
 
 class Inner
@@ -71,6 +75,7 @@ public:
 	void clearInlineRowsPanel();
 
 	void preloadImages();
+	void inlineResultsDeleted(const Results &results);
 
 	void inlineItemLayoutChanged(const ItemBase *layout) override;
 	void inlineItemRepaint(const ItemBase *layout) override;
@@ -123,6 +128,7 @@ private:
 	bool isRestrictedView();
 
 	void paintInlineItems(Painter &p, const QRect &r);
+	void preloadRows();
 
 	void refreshSwitchPmButton(const CacheEntry *entry);
 
@@ -157,6 +163,7 @@ private:
 	object_ptr<Ui::FlatLabel> _restrictedLabel = { nullptr };
 
 	QVector<Row> _rows;
+	int _preloadedRows = 0;
 
 	std::map<Result*, std::unique_ptr<ItemBase>> _inlineLayouts;
 
@@ -210,6 +217,12 @@ private slots:
 	void onEmptyInlineRows();
 
 private:
+	using CacheKey = std::tuple<
+		not_null<UserData*>,
+		not_null<PeerData*>,
+		QString>;
+	using Cache = std::map<CacheKey, std::unique_ptr<internal::CacheEntry>>;
+
 	void moveByBottom();
 	void paintContent(Painter &p);
 
@@ -243,7 +256,14 @@ private:
 	int showInlineRows(bool newResults);
 	void recountContentMaxHeight();
 	bool refreshInlineRows(int *added = nullptr);
-	void inlineResultsDone(const MTPmessages_BotResults &result);
+	void inlineResultsDone(
+		const CacheKey &key,
+		const MTPmessages_BotResults &result);
+
+	CacheKey cacheKey(const QString &query) const;
+	internal::CacheEntry *cachedEntry(const QString &query);
+	void removeCachedEntry(Cache::iterator i);
+	void trimInlineCache();
 
 	not_null<Window::SessionController*> _controller;
 
@@ -266,7 +286,7 @@ private:
 	object_ptr<Ui::ScrollArea> _scroll;
 	QPointer<internal::Inner> _inner;
 
-	std::map<QString, std::unique_ptr<internal::CacheEntry>> _inlineCache;
+	Cache _inlineCache;
 	QTimer _inlineRequestTimer;
 
 	UserData *_inlineBot = nullptr;
@@ -243,12 +243,30 @@ struct Instance::PrivateTag {
 
 Instance::Instance()
 : _values(PrepareDefaultValues())
-, _nonDefaultSet(kKeysCount, 0) {
+, _nonDefaultSet(kKeysCount, 0)
+, _memory("Lang strings", [=] { return memoryUsage(); }) {
 }
 
 Instance::Instance(not_null<Instance*> derived, const PrivateTag &)
 : _derived(derived)
-, _nonDefaultSet(kKeysCount, 0) {
+, _nonDefaultSet(kKeysCount, 0)
+, _memory("Lang strings", [=] { return memoryUsage(); }) {
+}
+
+base::memory_usage::Usage Instance::memoryUsage() const {
+	auto result = base::memory_usage::Usage();
+	for (const auto &value : _values) {
+		result.bytes += value.size() * int64(sizeof(QChar));
+		++result.count;
+	}
+	for (const auto &pending : _pendingValues) {
+		result.bytes += pending.key.size() + pending.value.size();
+	}
+	for (const auto &[key, value] : _nonDefaultValues) {
+		result.bytes += key.size() + value.size();
+	}
+	result.bytes += _customFileContent.size();
+	return result;
 }
 
 void Instance::switchToId(const Language &data) {
@@ -299,6 +317,7 @@ void Instance::reset(const Language &data) {
 	_customFileContent = QByteArray();
 	_version = 0;
 	_nonDefaultValues.clear();
+	_pendingValues.clear();
 	for (auto i = 0, count = int(_values.size()); i != count; ++i) {
 		_values[i] = GetOriginalValue(ushort(i));
 	}
@@ -545,7 +564,7 @@ void Instance::fillFromSerialized(
 	_customFileContent = customFileContent;
 	LOG(("Lang Info: Loaded cached, keys: %1").arg(nonDefaultValuesCount));
 	for (auto i = 0, count = nonDefaultValuesCount * 2; i != count; i += 2) {
-		applyValue(nonDefaultStrings[i], nonDefaultStrings[i + 1]);
+		applySerializedValue(nonDefaultStrings[i], nonDefaultStrings[i + 1]);
 	}
 	updatePluralRules();
 
@@ -705,13 +724,52 @@ void Instance::applyValue(const QByteArray &key, const QByteArray &value) {
 	ParseKeyValue(key, value, [&](ushort key, QString &&value) {
 		_nonDefaultSet[key] = 1;
 		if (!_derived) {
-			_values[key] = std::move(value);
+			setValue(key, std::move(value));
 		} else if (!_derived->_nonDefaultSet[key]) {
-			_derived->_values[key] = std::move(value);
+			_derived->setValue(key, std::move(value));
 		}
 	});
 }
 
+// Only the key index is found here, QString values are created later.
+void Instance::applySerializedValue(
+		const QByteArray &key,
+		const QByteArray &value) {
+	_nonDefaultValues[key] = value;
+	const auto index = GetKeyIndex(QLatin1String(key));
+	if (index == kKeysCount) {
+		if (!key.startsWith("cloud_")) {
+			DEBUG_LOG(("Lang Warning: Unknown key '%1'"
+				).arg(QString::fromLatin1(key)));
+		}
+		return;
+	}
+	_nonDefaultSet[index] = 1;
+	if (_derived && _derived->_nonDefaultSet[index]) {
+		return;
+	}
+	const auto owner = _derived ? _derived : this;
+	if (owner->_pendingValues.empty()) {
+		owner->_pendingValues.resize(kKeysCount);
+	}
+	owner->_pendingValues[index] = { key, value };
+}
+
+void Instance::setValue(ushort key, QString &&value) {
+	_values[key] = std::move(value);
+	if (key < _pendingValues.size()) {
+		_pendingValues[key] = PendingValue();
+	}
+}
+
+void Instance::parsePendingValue(ushort key) const {
+	const auto pending = std::exchange(_pendingValues[key], PendingValue());
+	auto parser = ValueParser(pending.key, key, pending.value);
+	_values[key] = parser.parse()
+		? parser.takeResult()
+		: GetOriginalValue(key);
+}
+
 void Instance::updatePluralRules() {
 	if (_pluralId.isEmpty()) {
 		_pluralId = isCustom()
@@ -733,11 +791,11 @@ void Instance::resetValue(const QByteArray &key) {
 			const auto base = _base
 				? _base->getNonDefaultValue(key)
 				: QString();
-			_values[keyIndex] = !base.isEmpty()
+			setValue(keyIndex, !base.isEmpty()
 				? base
-				: GetOriginalValue(keyIndex);
+				: GetOriginalValue(keyIndex));
 		} else if (!_derived->_nonDefaultSet[keyIndex]) {
-			_derived->_values[keyIndex] = GetOriginalValue(keyIndex);
+			_derived->setValue(keyIndex, GetOriginalValue(keyIndex));
 		}
 	}
 }
@@ -10,6 +10,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <rpl/producer.h>
 #include "lang_auto.h"
 #include "base/weak_ptr.h"
+#include "base/memory_usage.h"
 
 namespace Lang {
 
@@ -86,6 +87,9 @@ public:
 	QString getValue(ushort key) const {
 		Expects(key < _values.size());
 
+		if (key < _pendingValues.size() && !_pendingValues[key].key.isEmpty()) {
+			parsePendingValue(key);
+		}
 		return _values[key];
 	}
 	QString getNonDefaultValue(const QByteArray &key) const;
@@ -102,10 +106,18 @@ public:
 	}
 
 private:
+	struct PendingValue {
+		QByteArray key;
+		QByteArray value;
+	};
+
 	void setBaseId(const QString &baseId, const QString &pluralId);
 
 	void applyDifferenceToMe(const MTPDlangPackDifference &difference);
 	void applyValue(const QByteArray &key, const QByteArray &value);
+	void applySerializedValue(const QByteArray &key, const QByteArray &value);
+	void setValue(ushort key, QString &&value);
+	void parsePendingValue(ushort key) const;
 	void resetValue(const QByteArray &key);
 	void reset(const Language &language);
 	void fillFromCustomContent(
@@ -119,6 +131,7 @@ private:
 		const QString &relativePath,
 		const QByteArray &content);
 	void updatePluralRules();
+	[[nodiscard]] base::memory_usage::Usage memoryUsage() const;
 
 	Instance *_derived = nullptr;
 
@@ -133,12 +146,17 @@ private:
 
 	mutable QString _systemLanguage;
 
-	std::vector<QString> _values;
+	mutable std::vector<QString> _values;
+
+	// Values read from the cache are parsed on the first getValue().
+	mutable std::vector<PendingValue> _pendingValues;
 	std::vector<uchar> _nonDefaultSet;
 	std::map<QByteArray, QByteArray> _nonDefaultValues;
 
 	std::unique_ptr<Instance> _base;
 
+	base::memory_usage::Provider _memory;
+
 };
 
 namespace details {
@@ -12,6 +12,20 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "core/crash_reports.h"
 #include "core/launcher.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+// Debug logs are written by a separate thread in batches.
+constexpr auto kDebugFlushDelay = std::chrono::milliseconds(100);
+constexpr auto kDebugFlushSize = 256 * 1024;
+
+} // namespace
+
 enum LogDataType {
 	LogDataMain,
 	LogDataDebug,
@@ -44,14 +58,34 @@ QString _logsFilePath(LogDataType type, const QString &postfix = QString()) {
 }
 
 int32 LogsStartIndexChosen = -1;
+
+// Local time is computed only once a second on each thread.
+QString _logsTimeNow() {
+	thread_local auto second = time_t(-1);
+	thread_local auto formatted = QString();
+
+	const auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+	const auto t = time_t(now / 1000);
+	if (t != second) {
+		struct tm tm;
+		mylocaltime(&tm, &t);
+		second = t;
+		formatted = QString("%1:%2:%3."
+		).arg(tm.tm_hour, 2, 10, QChar('0')
+		).arg(tm.tm_min, 2, 10, QChar('0')
+		).arg(tm.tm_sec, 2, 10, QChar('0'));
+	}
+	return formatted + QString("%1").arg(int(now % 1000), 3, 10, QChar('0'));
+}
+
 QString _logsEntryStart() {
-	static int32 index = 0;
-	QDateTime tm(QDateTime::currentDateTime());
+	static auto index = std::atomic<int32>(0);
 
 	auto thread = qobject_cast<MTP::internal::Thread*>(QThread::currentThread());
 	auto threadId = thread ? thread->getThreadIndex() : 0;
 
-	return QString("[%1 %2-%3]").arg(tm.toString("hh:mm:ss.zzz")).arg(QString("%1").arg(threadId, 2, 10, QChar('0'))).arg(++index, 7, 10, QChar('0'));
+	return QString("[%1 %2-%3]").arg(_logsTimeNow()).arg(QString("%1").arg(threadId, 2, 10, QChar('0'))).arg(++index, 7, 10, QChar('0'));
 }
 
 class LogsDataFields {
@@ -61,6 +95,17 @@ public:
 		for (int32 i = 0; i < LogDataCount; ++i) {
 			files[i].reset(new QFile());
 		}
+		flusher = std::thread([=] { flushLoop(); });
+	}
+
+	~LogsDataFields() {
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			finishing = true;
+		}
+		queueChanged.notify_one();
+		flusher.join();
+		flushQueued();
 	}
 
 	bool openMain() {
@@ -92,11 +137,26 @@ public:
 		return QString();
 	}
 
+	// The main log is written right away, so that it has everything
+	// before a crash, debug logs are only queued for the flusher thread.
 	void write(LogDataType type, const QString &msg) {
-		QMutexLocker lock(_logsMutex(type));
 		if (type != LogDataMain) {
-			reopenDebug();
+			auto utf8 = msg.toUtf8();
+			auto notify = false;
+			{
+				std::unique_lock<std::mutex> lock(queueMutex);
+				auto &queue = queued[type];
+				notify = queue.isEmpty()
+					|| (queue.size() + utf8.size() >= kDebugFlushSize
+						&& queue.size() < kDebugFlushSize);
+				queue.append(utf8);
+			}
+			if (notify) {
+				queueChanged.notify_one();
+			}
+			return;
 		}
+		QMutexLocker lock(_logsMutex(type));
 		const auto file = files[type].get();
 		if (!file || !file->isOpen()) {
 			return;
@@ -108,8 +168,70 @@ public:
 private:
 	std::unique_ptr<QFile> files[LogDataCount];
 
+	std::thread flusher;
+	std::mutex queueMutex;
+	std::condition_variable queueChanged;
+	QByteArray queued[LogDataCount];
+	bool finishing = false;
+
 	int32 part = -1;
 
+	[[nodiscard]] bool hasQueued() const {
+		for (const auto &queue : queued) {
+			if (!queue.isEmpty()) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	[[nodiscard]] bool hasQueuedEnough() const {
+		for (const auto &queue : queued) {
+			if (queue.size() >= kDebugFlushSize) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void flushLoop() {
+		std::unique_lock<std::mutex> lock(queueMutex);
+		while (!finishing) {
+			queueChanged.wait(lock, [&] { return finishing || hasQueued(); });
+
+			// Give the others a chance to add more lines to this batch.
+			queueChanged.wait_for(lock, kDebugFlushDelay, [&] {
+				return finishing || hasQueuedEnough();
+			});
+			lock.unlock();
+			flushQueued();
+			lock.lock();
+		}
+	}
+
+	void flushQueued() {
+		QByteArray taken[LogDataCount];
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			for (auto i = 0; i != LogDataCount; ++i) {
+				std::swap(taken[i], queued[i]);
+			}
+		}
+		for (auto i = 0; i != LogDataCount; ++i) {
+			if (taken[i].isEmpty()) {
+				continue;
+			}
+			const auto type = LogDataType(i);
+			QMutexLocker lock(_logsMutex(type));
+			reopenDebug();
+			const auto file = files[type].get();
+			if (file && file->isOpen()) {
+				file->write(taken[i]);
+				file->flush();
+			}
+		}
+	}
+
 	bool reopen(LogDataType type, int32 dayIndex, const QString &postfix) {
 		if (files[type] && files[type]->isOpen()) {
 			if (type == LogDataMain) {
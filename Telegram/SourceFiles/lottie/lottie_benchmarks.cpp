@@ -0,0 +1,186 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "lottie/lottie_animation.h"
+#include "lottie/lottie_cache.h"
+#include "lottie/lottie_common.h"
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtGui/QImage>
+#include <rlottie.h>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+// Every benchmark prints one JSON object per line, for example:
+// {"benchmark":"lottie","file":"a.tgs","quality":"default","box":256,
+//  "frames":90,"parse_us":1,"render_us":2,"encode_us":3,"decode_us":4,
+//  "cache_bytes":12345}
+//
+// Run with LOTTIE_BENCHMARK_PATH set to a directory with .tgs files.
+
+namespace Logs {
+
+void writeMain(const QString &v) {
+	std::cout << v.toStdString() << std::endl;
+}
+
+} // namespace Logs
+
+namespace Images {
+
+QImage prepareColored(QColor add, QImage image) {
+	return image;
+}
+
+} // namespace Images
+
+namespace {
+
+using namespace Lottie;
+
+constexpr auto kBoxes = { 128, 256, 512 };
+constexpr auto kImageFormat = QImage::Format_ARGB32_Premultiplied;
+
+using Clock = std::chrono::steady_clock;
+
+long long Microseconds(Clock::duration duration) {
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+		duration).count();
+}
+
+struct Result {
+	QString file;
+	const char *quality = nullptr;
+	int box = 0;
+	int frames = 0;
+	long long parse = 0;
+	long long render = 0;
+	long long encode = 0;
+	long long decode = 0;
+	int cacheBytes = 0;
+};
+
+void Print(const Result &result) {
+	std::cout
+		<< "{\"benchmark\":\"lottie\""
+		<< ",\"file\":\"" << result.file.toStdString() << "\""
+		<< ",\"quality\":\"" << result.quality << "\""
+		<< ",\"box\":" << result.box
+		<< ",\"frames\":" << result.frames
+		<< ",\"parse_us\":" << result.parse
+		<< ",\"render_us\":" << result.render
+		<< ",\"encode_us\":" << result.encode
+		<< ",\"decode_us\":" << result.decode
+		<< ",\"cache_bytes\":" << result.cacheBytes
+		<< "}" << std::endl;
+}
+
+// Same decimation as SharedState does without power saving.
+int FrameStep(not_null<rlottie::Animation*> animation, Quality quality) {
+	const auto rate = int(qRound(animation->frameRate()));
+	return (quality == Quality::Default && rate == 60) ? 2 : 1;
+}
+
+void Run(const QString &name, const QByteArray &content, Quality quality) {
+	for (const auto box : kBoxes) {
+		auto result = Result();
+		result.file = name;
+		result.quality = (quality == Quality::High) ? "high" : "default";
+		result.box = box;
+
+		const auto parseStarted = Clock::now();
+		const auto animation = details::CreateFromContent(content, nullptr);
+		result.parse = Microseconds(Clock::now() - parseStarted);
+		if (!animation) {
+			std::cout << "Could not parse " << name.toStdString() << std::endl;
+			return;
+		}
+		auto width = size_t(0);
+		auto height = size_t(0);
+		animation->size(width, height);
+		const auto original = QSize(int(width), int(height));
+		const auto step = FrameStep(animation.get(), quality);
+		const auto rate = int(qRound(animation->frameRate())) / step;
+		const auto count = int(animation->totalFrame()) / step;
+		const auto request = FrameRequest{ QSize(box, box) };
+		const auto size = request.size(original);
+		result.frames = count;
+
+		auto cached = QByteArray();
+		auto encoder = Cache(QByteArray(), request, [&](QByteArray &&data) {
+			cached = std::move(data);
+		});
+		encoder.init(original, rate, count, request);
+
+		auto image = QImage(size, kImageFormat);
+		auto render = Clock::duration();
+		const auto encodeStarted = Clock::now();
+		for (auto i = 0; i != count; ++i) {
+			const auto renderStarted = Clock::now();
+			if (!image.isDetached()) {
+				image = QImage(size, kImageFormat);
+			}
+			image.fill(Qt::transparent);
+			auto surface = rlottie::Surface(
+				reinterpret_cast<uint32_t*>(image.bits()),
+				image.width(),
+				image.height(),
+				image.bytesPerLine());
+			animation->renderSync(i * step, surface);
+			render += Clock::now() - renderStarted;
+
+			encoder.appendFrame(image, request, i);
+		}
+
+		// Encoding runs in the background, collect it as a new pass would.
+		while (cached.isEmpty()) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			(void)encoder.renderFrame(image, request, 0);
+		}
+		result.render = Microseconds(render);
+		result.encode = Microseconds(Clock::now() - encodeStarted - render);
+		result.cacheBytes = cached.size();
+
+		if (!cached.isEmpty()) {
+			const auto decodeStarted = Clock::now();
+			auto decoder = Cache(cached, request, [](QByteArray &&) {});
+			auto frame = decoder.takeFirstFrame();
+			for (auto i = 1; i < decoder.framesReady(); ++i) {
+				REQUIRE(decoder.renderFrame(frame, request, i));
+			}
+			result.decode = Microseconds(Clock::now() - decodeStarted);
+		}
+		Print(result);
+	}
+}
+
+} // namespace
+
+TEST_CASE("lottie render and cache", "[.benchmark]") {
+	const auto path = qEnvironmentVariable("LOTTIE_BENCHMARK_PATH");
+	if (path.isEmpty()) {
+		std::cout << "Set LOTTIE_BENCHMARK_PATH to a .tgs folder." << std::endl;
+		return;
+	}
+	const auto files = QDir(path).entryInfoList(
+		{ "*.tgs", "*.json" },
+		QDir::Files,
+		QDir::Name);
+	for (const auto &info : files) {
+		auto file = QFile(info.absoluteFilePath());
+		if (!file.open(QIODevice::ReadOnly)) {
+			continue;
+		}
+		const auto content = file.readAll();
+		Run(info.fileName(), content, Quality::Default);
+		Run(info.fileName(), content, Quality::High);
+	}
+}
@@ -10,11 +10,20 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "lottie/lottie_frame_renderer.h"
 #include "ffmpeg/ffmpeg_utility.h"
 #include "base/bytes.h"
+#include "base/build_config.h"
+#include "base/memory_usage.h"
 
 #include <QDataStream>
+#include <QMutex>
 #include <lz4.h>
 #include <lz4hc.h>
 #include <range/v3/numeric/accumulate.hpp>
+#include <crl/crl_async.h>
+#include <deque>
+
+#ifdef ARCH_CPU_X86_FAMILY
+#include <emmintrin.h>
+#endif // ARCH_CPU_X86_FAMILY
 
 namespace Lottie {
 namespace {
@@ -24,6 +33,12 @@ constexpr auto kAlignStorage = 16;
 // Must not exceed max database allowed entry size.
 constexpr auto kMaxCacheSize = 10 * 1024 * 1024;
 
+// Frames are encoded on the thread pool, so they can afford the high
+// compression mode. Its output is plain LZ4 and decodes just as fast.
+constexpr auto kCompressionLevel = LZ4HC_CLEVEL_DEFAULT;
+
+base::memory_usage::Counter CachesMemory("Lottie caches");
+
 void Xor(EncodedStorage &to, const EncodedStorage &from) {
 	Expects(to.size() == from.size());
 
@@ -67,11 +82,12 @@ void CompressFromRaw(QByteArray &to, const EncodedStorage &from) {
 	const auto max = sizeof(qint32) + LZ4_compressBound(size);
 	to.reserve(max);
 	to.resize(max);
-	const auto compressed = LZ4_compress_default(
+	const auto compressed = LZ4_compress_HC(
 		from.data(),
 		to.data() + sizeof(qint32),
 		size,
-		to.size() - sizeof(qint32));
+		to.size() - sizeof(qint32),
+		kCompressionLevel);
 	Assert(compressed > 0);
 	if (compressed >= size + sizeof(qint32)) {
 		to.resize(size + sizeof(qint32));
@@ -151,7 +167,66 @@ void DecodeYUV2RGB(
 	Ensures(lines == to.height());
 }
 
-void DecodeAlpha(QImage &to, const EncodedStorage &from) {
+[[nodiscard]] inline uint32 HighAlpha(uint32 value) {
+	return (value & 0xF0U) | ((value & 0xF0U) >> 4);
+}
+
+[[nodiscard]] inline uint32 LowAlpha(uint32 value) {
+	return ((value & 0x0FU) << 4) | (value & 0x0FU);
+}
+
+// Same rounding as qPremultiply(), so both paths give equal results.
+[[nodiscard]] inline uint32 Premultiplied(uint32 rgb, uint32 alpha) {
+	if (alpha == 0xFFU) {
+		return rgb | 0xFF000000U;
+	} else if (!alpha) {
+		return 0;
+	}
+	auto t = (rgb & 0x00FF00FFU) * alpha;
+	t = ((t + ((t >> 8) & 0x00FF00FFU) + 0x00800080U) >> 8) & 0x00FF00FFU;
+	auto x = ((rgb >> 8) & 0xFFU) * alpha;
+	x = (x + ((x >> 8) & 0xFFU) + 0x80U) & 0xFF00U;
+	return x | t | (alpha << 24);
+}
+
+#ifdef ARCH_CPU_X86_FAMILY
+
+// Four pixels with their two bytes of 4-bit alpha at once.
+inline void PremultiplyFour(uint32 *ints, const uint8_t *alpha) {
+	const auto a0 = short(HighAlpha(alpha[0]));
+	const auto a1 = short(LowAlpha(alpha[0]));
+	const auto a2 = short(HighAlpha(alpha[1]));
+	const auto a3 = short(LowAlpha(alpha[1]));
+	const auto shifted = [](short alpha) {
+		return int(uint32(alpha) << 24);
+	};
+	const auto zero = _mm_setzero_si128();
+	const auto half = _mm_set1_epi16(0x80);
+	const auto multiply = [&](__m128i channels, __m128i alphas) {
+		const auto t = _mm_mullo_epi16(channels, alphas);
+		return _mm_srli_epi16(
+			_mm_add_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), half),
+			8);
+	};
+	const auto pixels = _mm_loadu_si128(reinterpret_cast<__m128i*>(ints));
+
+	// The alpha lanes are multiplied by zero and filled in afterwards.
+	const auto low = multiply(
+		_mm_unpacklo_epi8(pixels, zero),
+		_mm_set_epi16(0, a1, a1, a1, 0, a0, a0, a0));
+	const auto high = multiply(
+		_mm_unpackhi_epi8(pixels, zero),
+		_mm_set_epi16(0, a3, a3, a3, 0, a2, a2, a2));
+	const auto result = _mm_or_si128(
+		_mm_packus_epi16(low, high),
+		_mm_set_epi32(shifted(a3), shifted(a2), shifted(a1), shifted(a0)));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(ints), result);
+}
+
+#endif // ARCH_CPU_X86_FAMILY
+
+// Merges the 4-bit alpha and premultiplies the colors in one pass.
+void DecodeAlphaPremultiplied(QImage &to, const EncodedStorage &from) {
 	auto bytes = to.bits();
 	auto alpha = from.aData();
 	const auto perLine = to.bytesPerLine();
@@ -160,15 +235,16 @@ void DecodeAlpha(QImage &to, const EncodedStorage &from) {
 	for (auto i = 0; i != height; ++i) {
 		auto ints = reinterpret_cast<uint32*>(bytes);
 		const auto till = ints + width;
+#ifdef ARCH_CPU_X86_FAMILY
+		for (; till - ints >= 4; ints += 4, alpha += 2) {
+			PremultiplyFour(ints, alpha);
+		}
+#endif // ARCH_CPU_X86_FAMILY
 		while (ints != till) {
 			const auto value = uint32(*alpha++);
-			*ints = (*ints & 0x00FFFFFFU)
-				| ((value & 0xF0U) << 24)
-				| ((value & 0xF0U) << 20);
+			*ints = Premultiplied(*ints & 0x00FFFFFFU, HighAlpha(value));
 			++ints;
-			*ints = (*ints & 0x00FFFFFFU)
-				| (value << 28)
-				| ((value & 0x0FU) << 24);
+			*ints = Premultiplied(*ints & 0x00FFFFFFU, LowAlpha(value));
 			++ints;
 		}
 		bytes += perLine;
@@ -184,8 +260,7 @@ void Decode(
 		to = FFmpeg::CreateFrameStorage(fromSize);
 	}
 	DecodeYUV2RGB(to, from, context);
-	DecodeAlpha(to, from);
-	FFmpeg::PremultiplyInplace(to);
+	DecodeAlphaPremultiplied(to, from);
 }
 
 void EncodeRGB2YUV(
@@ -276,6 +351,75 @@ int ASize(int width, int height) {
 
 } // namespace
 
+// Rendered frames are converted and compressed on the thread pool, one
+// by one in the order they were rendered. This way the first playback
+// of an animation doesn't pay for its encoding on the renderer thread.
+struct Cache::Encoding {
+	struct Frame {
+		QImage image;
+		bool first = false;
+	};
+
+	static void Enqueue(const std::shared_ptr<Encoding> &that, Frame frame);
+	static void Run(const std::shared_ptr<Encoding> &that);
+
+	QMutex mutex;
+	std::deque<Frame> waiting;
+	std::vector<QByteArray> encoded;
+	bool running = false;
+
+	// Accessed only from the running encoding task.
+	EncodedStorage uncompressed;
+	EncodedStorage previous;
+	QByteArray compressBuffer;
+	QByteArray xorCompressBuffer;
+	QImage cache;
+	FFmpeg::SwscalePointer context;
+
+};
+
+void Cache::Encoding::Enqueue(
+		const std::shared_ptr<Encoding> &that,
+		Frame frame) {
+	{
+		QMutexLocker lock(&that->mutex);
+		that->waiting.push_back(std::move(frame));
+		if (that->running) {
+			return;
+		}
+		that->running = true;
+	}
+	crl::async([=] {
+		Run(that);
+	});
+}
+
+void Cache::Encoding::Run(const std::shared_ptr<Encoding> &that) {
+	while (true) {
+		auto frame = Frame();
+		{
+			QMutexLocker lock(&that->mutex);
+			if (that->waiting.empty()) {
+				that->running = false;
+				return;
+			}
+			frame = std::move(that->waiting.front());
+			that->waiting.pop_front();
+		}
+		Encode(that->uncompressed, frame.image, that->cache, that->context);
+		CompressAndSwapFrame(
+			that->compressBuffer,
+			frame.first ? nullptr : &that->xorCompressBuffer,
+			that->uncompressed,
+			that->previous);
+		auto compressed = that->compressBuffer;
+		compressed.detach();
+
+		QMutexLocker lock(&that->mutex);
+		that->encoded.push_back(std::move(compressed));
+	}
+}
+
 void EncodedStorage::allocate(int width, int height) {
 	Expects((width % 2) == 0 && (height % 2) == 0);
 
@@ -376,9 +520,10 @@ Cache::Cache(
 : _data(data)
 , _put(std::move(put)) {
 	if (!readHeader(request)) {
-		_framesReady = 0;
-		_data = QByteArray();
+		resetFrames();
 	}
+	CachesMemory.add(0);
+	updateMemoryUsage();
 }
 
 void Cache::init(
@@ -390,8 +535,9 @@ void Cache::init(
 	_original = original;
 	_frameRate = frameRate;
 	_framesCount = framesCount;
-	_framesReady = 0;
+	_framesReady = _framesEncoded = _framesQueued = 0;
 	prepareBuffers();
+	updateMemoryUsage();
 }
 
 int Cache::frameRate() const {
@@ -451,7 +597,7 @@ bool Cache::readHeader(const FrameRequest &request) {
 	_original = original;
 	_frameRate = frameRate;
 	_framesCount = framesCount;
-	_framesReady = framesReady;
+	_framesReady = _framesEncoded = _framesQueued = framesReady;
 	prepareBuffers();
 	return renderFrame(_firstFrame, request, 0);
 }
@@ -468,6 +614,10 @@ bool Cache::renderFrame(
 		|| index == _offsetFrameIndex
 		|| index == 0);
 
+	if (index == 0) {
+		// Frames encoded during the previous pass are readable after this.
+		takeEncodedFrames();
+	}
 	if (index >= _framesReady) {
 		return false;
 	} else if (request.size(_original) != _size) {
@@ -478,8 +628,7 @@ bool Cache::renderFrame(
 	}
 	const auto [ok, xored] = readCompressedFrame();
 	if (!ok || (xored && index == 0)) {
-		_framesReady = 0;
-		_data = QByteArray();
+		resetFrames();
 		return false;
 	} else if (index + 1 == _framesReady && _data.size() > _offset) {
 		_data.resize(_offset);
@@ -490,6 +639,7 @@ bool Cache::renderFrame(
 		std::swap(_uncompressed, _previous);
 	}
 	Decode(to, _previous, _size, _decodeContext);
+	updateMemoryUsage();
 	return true;
 }
 
@@ -498,45 +648,83 @@ void Cache::appendFrame(
 		const FrameRequest &request,
 		int index) {
 	if (request.size(_original) != _size) {
-		_framesReady = 0;
-		_data = QByteArray();
+		resetFrames();
 	}
-	if (index != _framesReady) {
+	if (index != _framesQueued) {
 		return;
 	}
 	if (index == 0) {
 		_size = request.size(_original);
 		_encode = EncodeFields();
 		_encode.compressedFrames.reserve(_framesCount);
+		_encoding = nullptr;
 		prepareBuffers();
 	}
 	Assert(frame.size() == _size);
-	Encode(_uncompressed, frame, _encode.cache, _encode.context);
-	CompressAndSwapFrame(
-		_encode.compressBuffer,
-		(index != 0) ? &_encode.xorCompressBuffer : nullptr,
-		_uncompressed,
-		_previous);
-	const auto compressed = _encode.compressBuffer;
-	const auto nowSize = (_data.isEmpty() ? headerSize() : _data.size())
-		+ _encode.totalSize;
-	const auto totalSize = nowSize + compressed.size();
-	if (nowSize <= kMaxCacheSize && totalSize > kMaxCacheSize) {
-		// Write to cache while we still can.
-		finalizeEncoding();
+	if (!_encoding) {
+		_encoding = std::make_shared<Encoding>();
+		_encoding->uncompressed.allocate(_size.width(), _size.height());
+		_encoding->previous.allocate(_size.width(), _size.height());
+		if (index > 0) {
+			// Continue the frames read from the cache with a XOR-d delta.
+			memcpy(
+				_encoding->previous.data(),
+				_previous.data(),
+				_previous.size());
+		}
 	}
-	_encode.totalSize += compressed.size();
-	_encode.compressedFrames.push_back(compressed);
-	_encode.compressedFrames.back().detach();
-	if (++_framesReady == _framesCount) {
-		finalizeEncoding();
+	takeEncodedFrames();
+	++_framesQueued;
+	Encoding::Enqueue(_encoding, { frame, (index == 0) });
+	updateMemoryUsage();
+}
+
+void Cache::updateMemoryUsage() {
+	const auto now = int64(_data.size())
+		+ _encode.totalSize
+		+ _uncompressed.size()
+		+ _previous.size();
+	CachesMemory.add(now - _memoryBytes, 0);
+	_memoryBytes = now;
+}
+
+void Cache::takeEncodedFrames() {
+	if (!_encoding) {
+		return;
+	}
+	auto encoded = std::vector<QByteArray>();
+	{
+		QMutexLocker lock(&_encoding->mutex);
+		encoded = base::take(_encoding->encoded);
 	}
+	for (auto &compressed : encoded) {
+		const auto nowSize = (_data.isEmpty() ? headerSize() : _data.size())
+			+ _encode.totalSize;
+		const auto totalSize = nowSize + compressed.size();
+		if (nowSize <= kMaxCacheSize && totalSize > kMaxCacheSize) {
+			// Write to cache while we still can.
+			finalizeEncoding();
+		}
+		_encode.totalSize += compressed.size();
+		_encode.compressedFrames.push_back(std::move(compressed));
+		if (++_framesEncoded == _framesCount) {
+			finalizeEncoding();
+		}
+	}
+}
+
+void Cache::resetFrames() {
+	_framesReady = _framesEncoded = _framesQueued = 0;
+	_data = QByteArray();
+	_encode = EncodeFields();
+	_encoding = nullptr;
 }
 
 void Cache::finalizeEncoding() {
 	if (_encode.compressedFrames.empty()) {
 		return;
 	}
+	_framesReady = _framesEncoded;
 	const auto size = (_data.isEmpty() ? headerSize() : _data.size())
 		+ _encode.totalSize;
 	if (_data.isEmpty()) {
@@ -620,7 +808,11 @@ Cache::ReadResult Cache::readCompressedFrame() {
 }
 
 Cache::~Cache() {
+	// Frames still being encoded are dropped, they'll be encoded again
+	// the next time this animation plays from the frames saved here.
+	takeEncodedFrames();
 	finalizeEncoding();
+	CachesMemory.remove(_memoryBytes);
 }
 
 } // namespace Lottie
@@ -90,23 +90,25 @@ private:
 	};
 	struct EncodeFields {
 		std::vector<QByteArray> compressedFrames;
-		QByteArray compressBuffer;
-		QByteArray xorCompressBuffer;
-		QImage cache;
-		FFmpeg::SwscalePointer context;
 		int totalSize = 0;
 	};
+	struct Encoding;
+
 	int headerSize() const;
 	void prepareBuffers();
+	void takeEncodedFrames();
 	void finalizeEncoding();
+	void resetFrames();
 
 	void writeHeader();
 	void updateFramesReadyCount();
+	void updateMemoryUsage();
 	[[nodiscard]] bool readHeader(const FrameRequest &request);
 	[[nodiscard]] ReadResult readCompressedFrame();
 
 	QByteArray _data;
 	EncodeFields _encode;
+	std::shared_ptr<Encoding> _encoding;
 	QSize _size;
 	QSize _original;
 	EncodedStorage _uncompressed;
@@ -116,10 +118,13 @@ private:
 	int _frameRate = 0;
 	int _framesCount = 0;
 	int _framesReady = 0;
+	int _framesEncoded = 0;
+	int _framesQueued = 0;
 	int _offset = 0;
 	int _offsetFrameIndex = 0;
 	Encoder _encoder = Encoder::YUV420A4_LZ4;
 	FnMut<void(QByteArray &&cached)> _put;
+	int64 _memoryBytes = 0;
 
 };
 
@@ -10,13 +10,17 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "lottie/lottie_player.h"
 #include "lottie/lottie_animation.h"
 #include "lottie/lottie_cache.h"
-#include "base/flat_map.h"
 #include "logs.h"
+#include "base/tracing.h"
+#include "base/memory_usage.h"
 
 #include <QPainter>
+#include <QThread>
 #include <rlottie.h>
 #include <range/v3/algorithm/find.hpp>
 #include <range/v3/algorithm/count_if.hpp>
+#include <range/v3/algorithm/min_element.hpp>
+#include <atomic>
 
 namespace Images {
 QImage prepareColored(QColor add, QImage image);
@@ -27,6 +31,21 @@ namespace {
 
 std::weak_ptr<FrameRenderer> GlobalInstance;
 
+constexpr auto kMaxWorkers = 4;
+
+// When rendering all the animations of a worker takes longer than
+// a frame several times in a row, new animations are played at half
+// the usual frame rate, until the workers are mostly idle for a while.
+constexpr auto kRenderOverrunTime = crl::time(1000) / kNormalFrameRate;
+constexpr auto kOverrunsToSavePower = 8;
+constexpr auto kCalmPassesToRestore = 600;
+constexpr auto kPowerSavingFrameRate = kNormalFrameRate / 2;
+
+std::atomic<bool> PowerSaving = false;
+
+// Only the rendered originals, they are written on the worker thread.
+base::memory_usage::Counter FramesMemory("Lottie frames");
+
 constexpr auto kImageFormat = QImage::Format_ARGB32_Premultiplied;
 
 bool GoodStorageForFrame(const QImage &storage, QSize size) {
@@ -40,20 +59,13 @@ QImage CreateFrameStorage(QSize size) {
 	return QImage(size, kImageFormat);
 }
 
-int GetLottieFrameRate(not_null<rlottie::Animation*> animation, Quality quality) {
-	const auto rate = int(qRound(animation->frameRate()));
-	return (quality == Quality::Default && rate == 60) ? (rate / 2) : rate;
-}
-
-int GetLottieFramesCount(not_null<rlottie::Animation*> animation, Quality quality) {
-	const auto rate = int(qRound(animation->frameRate()));
-	const auto count = int(animation->totalFrame());
-	return (quality == Quality::Default && rate == 60) ? (count / 2) : count;
-}
-
-int GetLottieFrameIndex(not_null<rlottie::Animation*> animation, Quality quality, int index) {
+int GetLottieFrameStep(not_null<rlottie::Animation*> animation, Quality quality) {
 	const auto rate = int(qRound(animation->frameRate()));
-	return (quality == Quality::Default && rate == 60) ? (index * 2) : index;
+	const auto saving = PowerSaving.load(std::memory_order_relaxed);
+	const auto max = (quality == Quality::High)
+		? (saving ? kNormalFrameRate : kMaxFrameRate)
+		: (saving ? kPowerSavingFrameRate : kNormalFrameRate);
+	return (rate == 60 || rate == 30) ? std::max(rate / max, 1) : 1;
 }
 
 } // namespace
@@ -84,9 +96,12 @@ private:
 
 	void queueGenerateFrames();
 	void generateFrames();
+	void checkPowerSaving(crl::time duration);
 
 	crl::weak_on_queue<FrameRendererObject> _weak;
 	std::vector<Entry> _entries;
+	int _overruns = 0;
+	int _calmPasses = 0;
 	bool _queued = false;
 
 };
@@ -176,6 +191,9 @@ void FrameRendererObject::remove(not_null<SharedState*> entry) {
 }
 
 void FrameRendererObject::generateFrames() {
+	TRACE_SCOPE("Lottie::FrameRenderer::generateFrames");
+
+	const auto started = crl::now();
 	auto players = base::flat_map<Player*, base::weak_ptr<Player>>();
 	const auto renderOne = [&](const Entry &entry) {
 		const auto result = entry.state->renderNextFrame(entry.request);
@@ -186,6 +204,7 @@ void FrameRendererObject::generateFrames() {
 	};
 	const auto rendered = ranges::count_if(_entries, renderOne);
 	if (rendered) {
+		checkPowerSaving(crl::now() - started);
 		if (!players.empty()) {
 			crl::on_main([players = std::move(players)] {
 				for (const auto &[player, weak] : players) {
@@ -199,6 +218,21 @@ void FrameRendererObject::generateFrames() {
 	}
 }
 
+void FrameRendererObject::checkPowerSaving(crl::time duration) {
+	if (duration > kRenderOverrunTime) {
+		_calmPasses = 0;
+		if (++_overruns == kOverrunsToSavePower) {
+			PowerSaving = true;
+		}
+	} else {
+		_overruns = 0;
+		if (duration < kRenderOverrunTime / 4
+			&& ++_calmPasses == kCalmPassesToRestore) {
+			PowerSaving = false;
+		}
+	}
+}
+
 void FrameRendererObject::queueGenerateFrames() {
 	if (_queued) {
 		return;
@@ -211,10 +245,24 @@ void FrameRendererObject::queueGenerateFrames() {
 }
 
 
-Information SharedState::CalculateInformation(
+int SharedState::CalculateFrameStep(
 		Quality quality,
 		rlottie::Animation *animation,
 		Cache *cache) {
+	if (!animation) {
+		return 1;
+	} else if (cache && cache->framesCount() > 0) {
+		// Continue the cached frames with the same rate.
+		const auto rate = int(qRound(animation->frameRate()));
+		return std::max(rate / std::max(cache->frameRate(), 1), 1);
+	}
+	return GetLottieFrameStep(animation, quality);
+}
+
+Information SharedState::CalculateInformation(
+		int frameStep,
+		rlottie::Animation *animation,
+		Cache *cache) {
 	Expects(animation != nullptr || cache != nullptr);
 
 	auto width = size_t(0);
@@ -226,10 +274,10 @@ Information SharedState::CalculateInformation(
 		height = cache->originalSize().height();
 	}
 	const auto rate = animation
-		? GetLottieFrameRate(animation, quality)
+		? (int(qRound(animation->frameRate())) / frameStep)
 		: cache->frameRate();
 	const auto count = animation
-		? GetLottieFramesCount(animation, quality)
+		? (int(animation->totalFrame()) / frameStep)
 		: cache->framesCount();
 
 	auto result = Information();
@@ -247,7 +295,8 @@ SharedState::SharedState(
 	std::unique_ptr<rlottie::Animation> animation,
 	const FrameRequest &request,
 	Quality quality)
-: _info(CalculateInformation(quality, animation.get(), nullptr))
+: _frameStep(CalculateFrameStep(quality, animation.get(), nullptr))
+, _info(CalculateInformation(_frameStep, animation.get(), nullptr))
 , _quality(quality)
 , _animation(std::move(animation)) {
 	construct(request);
@@ -260,7 +309,8 @@ SharedState::SharedState(
 	std::unique_ptr<Cache> cache,
 	const FrameRequest &request,
 	Quality quality)
-: _info(CalculateInformation(quality, animation.get(), cache.get()))
+: _frameStep(CalculateFrameStep(quality, animation.get(), cache.get()))
+, _info(CalculateInformation(_frameStep, animation.get(), cache.get()))
 , _quality(quality)
 , _cache(std::move(cache))
 , _animation(std::move(animation))
@@ -270,6 +320,7 @@ SharedState::SharedState(
 }
 
 void SharedState::construct(const FrameRequest &request) {
+	FramesMemory.add(0);
 	if (!isValid()) {
 		return;
 	}
@@ -313,6 +364,9 @@ void SharedState::renderFrame(
 		return;
 	} else if (!_animation) {
 		_animation = details::CreateFromContent(_content, _replacements);
+		_frameStep = std::max(
+			int(qRound(_animation->frameRate())) / _info.frameRate,
+			1);
 	}
 
 	image.fill(Qt::transparent);
@@ -322,7 +376,7 @@ void SharedState::renderFrame(
 		image.height(),
 		image.bytesPerLine());
 	_animation->renderSync(
-		GetLottieFrameIndex(_animation.get(), _quality, index),
+		index * _frameStep,
 		surface);
 	if (_cache) {
 		_cache->appendFrame(image, request, index);
@@ -337,6 +391,16 @@ void SharedState::init(QImage cover, const FrameRequest &request) {
 
 	_frames[0].request = request;
 	_frames[0].original = std::move(cover);
+	updateMemoryUsage();
+}
+
+void SharedState::updateMemoryUsage() {
+	auto now = int64();
+	for (const auto &frame : _frames) {
+		now += frame.original.byteCount();
+	}
+	FramesMemory.add(now - _memoryBytes, 0);
+	_memoryBytes = now;
 }
 
 void SharedState::start(
@@ -368,6 +432,7 @@ void SharedState::renderNextFrame(
 	PrepareFrameByRequest(frame);
 	frame->index = _frameIndex;
 	frame->displayed = kTimeUnknown;
+	updateMemoryUsage();
 }
 
 auto SharedState::renderNextFrame(const FrameRequest &request)
@@ -565,7 +630,22 @@ bool SharedState::markFrameShown() {
 	Unexpected("Counter value in Lottie::SharedState::markFrameShown.");
 }
 
-SharedState::~SharedState() = default;
+SharedState::~SharedState() {
+	FramesMemory.remove(_memoryBytes);
+}
+
+FrameRenderer::FrameRenderer() {
+	const auto count = std::clamp(
+		QThread::idealThreadCount() - 1,
+		1,
+		kMaxWorkers);
+	_workers.reserve(count);
+	for (auto i = 0; i != count; ++i) {
+		_workers.push_back(std::make_unique<Worker>());
+	}
+}
+
+FrameRenderer::~FrameRenderer() = default;
 
 std::shared_ptr<FrameRenderer> FrameRenderer::CreateIndependent() {
 	return std::make_shared<FrameRenderer>();
@@ -580,31 +660,51 @@ std::shared_ptr<FrameRenderer> FrameRenderer::Instance() {
 	return result;
 }
 
+auto FrameRenderer::workerFor(not_null<SharedState*> entry) -> Worker & {
+	const auto i = _workerByEntry.find(entry);
+	Assert(i != end(_workerByEntry));
+	return *i->second;
+}
+
 void FrameRenderer::append(
 		std::unique_ptr<SharedState> entry,
 		const FrameRequest &request) {
-	_wrapped.with([=, entry = std::move(entry)](
+	const auto worker = ranges::min_element(
+		_workers,
+		ranges::less(),
+		&Worker::entries)->get();
+	++worker->entries;
+	_workerByEntry.emplace(entry.get(), worker);
+	worker->wrapped.with([=, entry = std::move(entry)](
 			FrameRendererObject &unwrapped) mutable {
 		unwrapped.append(std::move(entry), request);
 	});
 }
 
 void FrameRenderer::frameShown() {
-	_wrapped.with([=](FrameRendererObject &unwrapped) {
-		unwrapped.frameShown();
-	});
+	for (const auto &worker : _workers) {
+		if (!worker->entries) {
+			continue;
+		}
+		worker->wrapped.with([=](FrameRendererObject &unwrapped) {
+			unwrapped.frameShown();
+		});
+	}
 }
 
 void FrameRenderer::updateFrameRequest(
 		not_null<SharedState*> entry,
 		const FrameRequest &request) {
-	_wrapped.with([=](FrameRendererObject &unwrapped) {
+	workerFor(entry).wrapped.with([=](FrameRendererObject &unwrapped) {
 		unwrapped.updateFrameRequest(entry, request);
 	});
 }
 
 void FrameRenderer::remove(not_null<SharedState*> entry) {
-	_wrapped.with([=](FrameRendererObject &unwrapped) {
+	auto &worker = workerFor(entry);
+	--worker.entries;
+	_workerByEntry.remove(entry);
+	worker.wrapped.with([=](FrameRendererObject &unwrapped) {
 		unwrapped.remove(entry);
 	});
 }
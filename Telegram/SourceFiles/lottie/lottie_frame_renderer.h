@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "base/basic_types.h"
 #include "base/weak_ptr.h"
+#include "base/flat_map.h"
 #include "lottie/lottie_common.h"
 
 #include <QImage>
@@ -90,10 +91,14 @@ public:
 	~SharedState();
 
 private:
-	static Information CalculateInformation(
+	static int CalculateFrameStep(
 		Quality quality,
 		rlottie::Animation *animation,
 		Cache *cache);
+	static Information CalculateInformation(
+		int frameStep,
+		rlottie::Animation *animation,
+		Cache *cache);
 
 	void construct(const FrameRequest &request);
 	bool isValid() const;
@@ -105,6 +110,7 @@ private:
 	[[nodiscard]] not_null<Frame*> getFrame(int index);
 	[[nodiscard]] not_null<const Frame*> getFrame(int index) const;
 	[[nodiscard]] int counter() const;
+	void updateMemoryUsage();
 
 	// crl::queue changes 0,2,4,6 to 1,3,5,7.
 	// main thread changes 1,3,5,7 to 2,4,6,0.
@@ -123,10 +129,14 @@ private:
 
 	int _frameIndex = 0;
 	int _skippedFrames = 0;
+
+	// Rendered frames are each _frameStep-th frame of the animation.
+	int _frameStep = 1;
 	const Information _info;
 	const Quality _quality = Quality::Default;
 
 	const std::unique_ptr<Cache> _cache;
+	int64 _memoryBytes = 0;
 
 	std::unique_ptr<rlottie::Animation> _animation;
 	const QByteArray _content;
@@ -136,8 +146,13 @@ private:
 
 class FrameRendererObject;
 
+// Animations are spread between several workers, each one rendering
+// its animations in order on its own crl queue.
 class FrameRenderer final {
 public:
+	FrameRenderer();
+	~FrameRenderer();
+
 	static std::shared_ptr<FrameRenderer> CreateIndependent();
 	static std::shared_ptr<FrameRenderer> Instance();
 
@@ -153,7 +168,15 @@ public:
 
 private:
 	using Implementation = FrameRendererObject;
-	crl::object_on_queue<Implementation> _wrapped;
+	struct Worker {
+		crl::object_on_queue<Implementation> wrapped;
+		int entries = 0;
+	};
+
+	[[nodiscard]] Worker &workerFor(not_null<SharedState*> entry);
+
+	std::vector<std::unique_ptr<Worker>> _workers;
+	base::flat_map<not_null<SharedState*>, not_null<Worker*>> _workerByEntry;
 
 };
 
@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "lottie/lottie_frame_renderer.h"
 #include "lottie/lottie_animation.h"
+#include "base/frame_clock.h"
 #include "logs.h"
 
 #include <range/v3/algorithm/remove.hpp>
@@ -19,12 +20,15 @@ MultiPlayer::MultiPlayer(
 	Quality quality,
 	std::shared_ptr<FrameRenderer> renderer)
 : _quality(quality)
-, _timer([=] { checkNextFrameRender(); })
 , _renderer(renderer ? std::move(renderer) : FrameRenderer::Instance()) {
 	crl::on_main_update_requests(
 	) | rpl::start_with_next([=] {
 		checkStep();
 	}, _lifetime);
+	base::FrameClock::Instance().ticks(
+	) | rpl::start_with_next([=] {
+		checkStep();
+	}, _lifetime);
 }
 
 MultiPlayer::~MultiPlayer() {
@@ -173,7 +177,6 @@ void MultiPlayer::removeNow(not_null<Animation*> animation) {
 
 	if (_active.empty()) {
 		_nextFrameTime = kTimeUnknown;
-		_timer.cancel();
 		if (_paused.empty()) {
 			_started = kTimeUnknown;
 			_lastSyncTime = kTimeUnknown;
@@ -309,15 +312,14 @@ void MultiPlayer::checkNextFrameRender() {
 	Expects(_nextFrameTime != kTimeUnknown);
 
 	const auto now = crl::now();
+	auto &clock = base::FrameClock::Instance();
 	if (now < _nextFrameTime) {
-		if (!_timer.isActive()) {
-			_timer.callOnce(_nextFrameTime - now);
-		}
+		clock.request(_nextFrameTime);
 	} else {
-		_timer.cancel();
-
+		// Waiting for the clock tick doesn't delay the timeline.
+		const auto tick = clock.tick(_nextFrameTime);
 		markFrameDisplayed(now);
-		addTimelineDelay(now - _nextFrameTime);
+		addTimelineDelay(std::max(now - tick, crl::time(0)));
 		_lastSyncTime = now;
 		_nextFrameTime = kFrameDisplayTimeAlreadyDone;
 		processPending();
@@ -8,7 +8,6 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #pragma once
 
 #include "lottie/lottie_player.h"
-#include "base/timer.h"
 #include "base/algorithm.h"
 #include "base/flat_set.h"
 #include "base/flat_map.h"
@@ -92,7 +91,6 @@ private:
 	void removeNow(not_null<Animation*> animation);
 
 	Quality _quality = Quality::Default;
-	base::Timer _timer;
 	const std::shared_ptr<FrameRenderer> _renderer;
 	std::vector<std::unique_ptr<Animation>> _animations;
 	base::flat_map<not_null<Animation*>, not_null<SharedState*>> _active;
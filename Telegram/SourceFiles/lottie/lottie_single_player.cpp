@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "lottie/lottie_single_player.h"
 
 #include "lottie/lottie_frame_renderer.h"
+#include "base/frame_clock.h"
 
 namespace Lottie {
 
@@ -18,7 +19,6 @@ SinglePlayer::SinglePlayer(
 	const ColorReplacements *replacements,
 	std::shared_ptr<FrameRenderer> renderer)
 : _animation(this, content, request, quality, replacements)
-, _timer([=] { checkNextFrameRender(); })
 , _renderer(renderer ? renderer : FrameRenderer::Instance()) {
 }
 
@@ -38,7 +38,6 @@ SinglePlayer::SinglePlayer(
 	request,
 	quality,
 	replacements)
-, _timer([=] { checkNextFrameRender(); })
 , _renderer(renderer ? renderer : FrameRenderer::Instance()) {
 }
 
@@ -64,6 +63,10 @@ void SinglePlayer::start(
 	) | rpl::start_with_next([=] {
 		checkStep();
 	}, _lifetime);
+	base::FrameClock::Instance().ticks(
+	) | rpl::start_with_next([=] {
+		checkStep();
+	}, _lifetime);
 }
 
 void SinglePlayer::failed(not_null<Animation*> animation, Error error) {
@@ -118,15 +121,14 @@ void SinglePlayer::checkNextFrameRender() {
 	Expects(_nextFrameTime != kTimeUnknown);
 
 	const auto now = crl::now();
+	auto &clock = base::FrameClock::Instance();
 	if (now < _nextFrameTime) {
-		if (!_timer.isActive()) {
-			_timer.callOnce(_nextFrameTime - now);
-		}
+		clock.request(_nextFrameTime);
 	} else {
-		_timer.cancel();
-
+		// Waiting for the clock tick doesn't delay the timeline.
+		const auto tick = clock.tick(_nextFrameTime);
 		_state->markFrameDisplayed(now);
-		_state->addTimelineDelay(now - _nextFrameTime);
+		_state->addTimelineDelay(std::max(now - tick, crl::time(0)));
 
 		_nextFrameTime = kFrameDisplayTimeAlreadyDone;
 		_updates.fire({ DisplayFrameRequest() });
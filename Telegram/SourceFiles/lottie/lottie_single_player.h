@@ -9,7 +9,6 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "lottie/lottie_player.h"
 #include "lottie/lottie_animation.h"
-#include "base/timer.h"
 
 #include <rpl/event_stream.h>
 
@@ -67,7 +66,6 @@ private:
 	void checkNextFrameRender();
 
 	Animation _animation;
-	base::Timer _timer;
 	const std::shared_ptr<FrameRenderer> _renderer;
 	SharedState *_state = nullptr;
 	crl::time _nextFrameTime = kTimeUnknown;
@@ -43,14 +43,18 @@ Session::Session(
 , _autoLockTimer([=] { checkAutoLock(); })
 , _api(std::make_unique<ApiWrap>(this))
 , _appConfig(std::make_unique<AppConfig>(this))
-, _calls(std::make_unique<Calls::Instance>(this))
+, _calls([=] { return std::make_unique<Calls::Instance>(this); })
 , _downloader(std::make_unique<Storage::Downloader>(_api.get()))
 , _uploader(std::make_unique<Storage::Uploader>(_api.get()))
 , _storage(std::make_unique<Storage::Facade>())
-, _notifications(std::make_unique<Window::Notifications::System>(this))
+, _notifications([=] {
+	return std::make_unique<Window::Notifications::System>(this);
+})
 , _data(std::make_unique<Data::Session>(this))
 , _user(_data->processUser(user))
-, _emojiStickersPack(std::make_unique<Stickers::EmojiPack>(this))
+, _emojiStickersPack([=] {
+	return std::make_unique<Stickers::EmojiPack>(this);
+})
 , _changelogs(Core::Changelogs::Create(this))
 , _supportHelper(Support::Helper::Create(this)) {
 	Core::App().passcodeLockChanges(
@@ -87,6 +91,13 @@ Session::Session(
 	});
 
 	Window::Theme::Background()->start();
+
+	const auto postpone = [=](FnMut<void()> callback) {
+		Core::App().postponeUntilFirstPaint(
+			crl::guard(this, std::move(callback)));
+	};
+	postpone([=] { _notifications.ensure(); });
+	postpone([=] { _emojiStickersPack.ensure(); });
 }
 
 Session::~Session() {
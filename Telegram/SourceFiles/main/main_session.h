@@ -12,6 +12,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <rpl/variable.h>
 #include "main/main_settings.h"
 #include "base/timer.h"
+#include "base/lazy_service.h"
 
 class ApiWrap;
 
@@ -84,7 +85,7 @@ public:
 		return *_storage;
 	}
 	[[nodiscard]] Stickers::EmojiPack &emojiStickersPack() {
-		return *_emojiStickersPack;
+		return _emojiStickersPack.get();
 	}
 	[[nodiscard]] AppConfig &appConfig() {
 		return *_appConfig;
@@ -93,7 +94,7 @@ public:
 	[[nodiscard]] base::Observable<void> &downloaderTaskFinished();
 
 	[[nodiscard]] Window::Notifications::System &notifications() {
-		return *_notifications;
+		return _notifications.get();
 	}
 
 	[[nodiscard]] Data::Session &data() {
@@ -111,7 +112,7 @@ public:
 	}
 
 	[[nodiscard]] Calls::Instance &calls() {
-		return *_calls;
+		return _calls.get();
 	}
 
 	void checkAutoLock();
@@ -143,18 +144,18 @@ private:
 
 	const std::unique_ptr<ApiWrap> _api;
 	const std::unique_ptr<AppConfig> _appConfig;
-	const std::unique_ptr<Calls::Instance> _calls;
+	const base::lazy_service<Calls::Instance> _calls;
 	const std::unique_ptr<Storage::Downloader> _downloader;
 	const std::unique_ptr<Storage::Uploader> _uploader;
 	const std::unique_ptr<Storage::Facade> _storage;
-	const std::unique_ptr<Window::Notifications::System> _notifications;
+	const base::lazy_service<Window::Notifications::System> _notifications;
 
 	// _data depends on _downloader / _uploader / _notifications.
 	const std::unique_ptr<Data::Session> _data;
 	const not_null<UserData*> _user;
 
 	// _emojiStickersPack depends on _data.
-	const std::unique_ptr<Stickers::EmojiPack> _emojiStickersPack;
+	const base::lazy_service<Stickers::EmojiPack> _emojiStickersPack;
 
 	// _changelogs depends on _data, subscribes on chats loading event.
 	const std::unique_ptr<Core::Changelogs> _changelogs;
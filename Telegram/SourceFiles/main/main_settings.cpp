@@ -33,7 +33,7 @@ Settings::Variables::Variables()
 
 QByteArray Settings::serialize() const {
 	const auto autoDownload = _variables.autoDownload.serialize();
-	auto size = sizeof(qint32) * 30;
+	auto size = sizeof(qint32) * 32 + sizeof(qint64) * 3;
 	for (auto i = _variables.soundOverrides.cbegin(), e = _variables.soundOverrides.cend(); i != e; ++i) {
 		size += Serialize::stringSize(i.key()) + Serialize::stringSize(i.value());
 	}
@@ -89,6 +89,11 @@ QByteArray Settings::serialize() const {
 		stream << qint32(_variables.replaceEmoji.current() ? 1 : 0);
 		stream << qint32(_variables.suggestEmoji ? 1 : 0);
 		stream << qint32(_variables.suggestStickersByEmoji ? 1 : 0);
+		stream << qint32(_variables.loadedViewsLimit);
+		stream << qint32(_variables.historyPaintCache.current() ? 1 : 0);
+		stream << qint64(_variables.autoDownloadDailyLimit);
+		stream << qint64(_variables.autoDownloadDay);
+		stream << qint64(_variables.autoDownloadedBytes);
 	}
 	return result;
 }
@@ -135,6 +140,13 @@ void Settings::constructFromSerialized(const QByteArray &serialized) {
 	qint32 replaceEmoji = _variables.replaceEmoji.current() ? 1 : 0;
 	qint32 suggestEmoji = _variables.suggestEmoji ? 1 : 0;
 	qint32 suggestStickersByEmoji = _variables.suggestStickersByEmoji ? 1 : 0;
+	qint32 loadedViewsLimit = _variables.loadedViewsLimit;
+	qint32 historyPaintCache = _variables.historyPaintCache.current()
+		? 1
+		: 0;
+	qint64 autoDownloadDailyLimit = _variables.autoDownloadDailyLimit;
+	qint64 autoDownloadDay = _variables.autoDownloadDay;
+	qint64 autoDownloadedBytes = _variables.autoDownloadedBytes;
 
 	stream >> selectorTab;
 	stream >> lastSeenWarningSeen;
@@ -234,6 +246,17 @@ void Settings::constructFromSerialized(const QByteArray &serialized) {
 		stream >> suggestEmoji;
 		stream >> suggestStickersByEmoji;
 	}
+	if (!stream.atEnd()) {
+		stream >> loadedViewsLimit;
+	}
+	if (!stream.atEnd()) {
+		stream >> historyPaintCache;
+	}
+	if (!stream.atEnd()) {
+		stream >> autoDownloadDailyLimit;
+		stream >> autoDownloadDay;
+		stream >> autoDownloadedBytes;
+	}
 	if (stream.status() != QDataStream::Ok) {
 		LOG(("App Error: "
 			"Bad data for Main::Settings::constructFromSerialized()"));
@@ -313,6 +336,29 @@ void Settings::constructFromSerialized(const QByteArray &serialized) {
 	_variables.replaceEmoji = (replaceEmoji == 1);
 	_variables.suggestEmoji = (suggestEmoji == 1);
 	_variables.suggestStickersByEmoji = (suggestStickersByEmoji == 1);
+	_variables.loadedViewsLimit = std::max(loadedViewsLimit, 0);
+	_variables.historyPaintCache = (historyPaintCache == 1);
+	_variables.autoDownloadDailyLimit = std::max(
+		autoDownloadDailyLimit,
+		qint64(0));
+	_variables.autoDownloadDay = autoDownloadDay;
+	_variables.autoDownloadedBytes = std::max(autoDownloadedBytes, qint64(0));
+}
+
+bool Settings::autoDownloadBudgetSpent() const {
+	return (_variables.autoDownloadDailyLimit > 0)
+		&& (_variables.autoDownloadDay == QDate::currentDate().toJulianDay())
+		&& (_variables.autoDownloadedBytes
+			>= _variables.autoDownloadDailyLimit);
+}
+
+void Settings::autoDownloaded(int64 bytes) {
+	const auto today = QDate::currentDate().toJulianDay();
+	if (_variables.autoDownloadDay != today) {
+		_variables.autoDownloadDay = today;
+		_variables.autoDownloadedBytes = 0;
+	}
+	_variables.autoDownloadedBytes += bytes;
 }
 
 void Settings::setSupportChatsTimeSlice(int slice) {
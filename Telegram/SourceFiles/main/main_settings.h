@@ -234,6 +234,34 @@ public:
 		_variables.suggestStickersByEmoji = value;
 	}
 
+	// Zero means no limit for the loaded message views count.
+	[[nodiscard]] int loadedViewsLimit() const {
+		return _variables.loadedViewsLimit;
+	}
+	void setLoadedViewsLimit(int limit) {
+		_variables.loadedViewsLimit = std::max(limit, 0);
+	}
+
+	[[nodiscard]] bool historyPaintCache() const {
+		return _variables.historyPaintCache.current();
+	}
+	[[nodiscard]] rpl::producer<bool> historyPaintCacheValue() const {
+		return _variables.historyPaintCache.value();
+	}
+	void setHistoryPaintCache(bool enabled) {
+		_variables.historyPaintCache = enabled;
+	}
+
+	// Zero means no limit for the bytes auto-downloaded in a day.
+	[[nodiscard]] int64 autoDownloadDailyLimit() const {
+		return _variables.autoDownloadDailyLimit;
+	}
+	void setAutoDownloadDailyLimit(int64 limit) {
+		_variables.autoDownloadDailyLimit = std::max(limit, int64(0));
+	}
+	[[nodiscard]] bool autoDownloadBudgetSpent() const;
+	void autoDownloaded(int64 bytes);
+
 private:
 	struct Variables {
 		Variables();
@@ -274,6 +302,18 @@ private:
 		bool suggestEmoji = true;
 		bool suggestStickersByEmoji = true;
 
+		static constexpr auto kDefaultLoadedViewsLimit = 20000;
+
+		int loadedViewsLimit = kDefaultLoadedViewsLimit;
+		rpl::variable<bool> historyPaintCache = false;
+
+		static constexpr auto kDefaultAutoDownloadDailyLimit
+			= int64(1024 * 1024 * 1024);
+
+		int64 autoDownloadDailyLimit = kDefaultAutoDownloadDailyLimit;
+		int64 autoDownloadDay = 0; // Julian day.
+		int64 autoDownloadedBytes = 0;
+
 		static constexpr auto kDefaultSupportChatsLimitSlice
 			= 7 * 24 * 60 * 60;
 
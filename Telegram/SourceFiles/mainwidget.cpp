@@ -75,6 +75,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/qthelp_regex.h"
 #include "base/qthelp_url.h"
 #include "base/flat_set.h"
+#include "base/tracing.h"
 #include "window/window_top_bar_wrap.h"
 #include "window/notifications_manager.h"
 #include "window/window_slide_animation.h"
@@ -110,6 +111,10 @@ namespace {
 
 constexpr auto kChannelGetDifferenceLimit = 100;
 
+// After a sleep hundreds of channels may need getChannelDifference,
+// they're requested by several at a time, most important chats first.
+constexpr auto kMaxChannelDifferenceRequests = 8;
+
 // 1s wait after show channel history before sending getChannelDifference.
 constexpr auto kWaitForChannelGetDifference = crl::time(1000);
 
@@ -268,6 +273,42 @@ DataIsLoadedResult AllDataLoadedForMessage(
 	});
 }
 
+QImage PrepareTiledBackground(
+		const QImage &tile,
+		QSize size,
+		int retinaFactor) {
+	auto result = QImage(
+		size * retinaFactor,
+		QImage::Format_RGB32);
+	result.setDevicePixelRatio(retinaFactor);
+	{
+		QPainter p(&result);
+		const auto w = tile.width() / double(retinaFactor);
+		const auto h = tile.height() / double(retinaFactor);
+		const auto cx = qCeil(size.width() / w);
+		const auto cy = qCeil(size.height() / h);
+		for (auto i = 0; i < cx; ++i) {
+			for (auto j = 0; j < cy; ++j) {
+				p.drawImage(QPointF(i * w, j * h), tile);
+			}
+		}
+	}
+	return result;
+}
+
+QImage PrepareScaledBackground(
+		const QImage &image,
+		QRect from,
+		QSize size,
+		int retinaFactor) {
+	auto result = image.copy(from).scaled(
+		size * retinaFactor,
+		Qt::IgnoreAspectRatio,
+		Qt::SmoothTransformation);
+	result.setDevicePixelRatio(retinaFactor);
+	return result;
+}
+
 } // namespace
 
 enum StackItemType {
@@ -933,45 +974,47 @@ void MainWidget::removeDialog(Dialogs::Key key) {
 }
 
 void MainWidget::cacheBackground() {
-	if (Window::Theme::Background()->colorForFill()) {
+	const auto background = Window::Theme::Background();
+	if (background->colorForFill()) {
 		return;
-	} else if (Window::Theme::Background()->tile()) {
-		auto &bg = Window::Theme::Background()->pixmapForTiled();
-
-		auto result = QImage(_willCacheFor.width() * cIntRetinaFactor(), _willCacheFor.height() * cIntRetinaFactor(), QImage::Format_RGB32);
-		result.setDevicePixelRatio(cRetinaFactor());
-		{
-			QPainter p(&result);
-			auto left = 0;
-			auto top = 0;
-			auto right = _willCacheFor.width();
-			auto bottom = _willCacheFor.height();
-			auto w = bg.width() / cRetinaFactor();
-			auto h = bg.height() / cRetinaFactor();
-			auto sx = 0;
-			auto sy = 0;
-			auto cx = qCeil(_willCacheFor.width() / w);
-			auto cy = qCeil(_willCacheFor.height() / h);
-			for (int i = sx; i < cx; ++i) {
-				for (int j = sy; j < cy; ++j) {
-					p.drawPixmap(QPointF(i * w, j * h), bg);
-				}
-			}
-		}
-		_cachedX = 0;
-		_cachedY = 0;
-		_cachedBackground = App::pixmapFromImageInPlace(std::move(result));
-	} else {
-		auto &bg = Window::Theme::Background()->pixmap();
-
-		QRect to, from;
-		Window::Theme::ComputeBackgroundRects(_willCacheFor, bg.size(), to, from);
-		_cachedX = to.x();
-		_cachedY = to.y();
-		_cachedBackground = App::pixmapFromImageInPlace(bg.toImage().copy(from).scaled(to.width() * cIntRetinaFactor(), to.height() * cIntRetinaFactor(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
-		_cachedBackground.setDevicePixelRatio(cRetinaFactor());
 	}
-	_cachedFor = _willCacheFor;
+
+	// Scale the wallpaper on a worker thread, keep painting it directly
+	// until the prepared one for this size is ready.
+	const auto tile = background->tile();
+	const auto image = tile
+		? background->pixmapForTiled().toImage()
+		: background->pixmap().toImage();
+	const auto rect = _willCacheFor;
+	const auto retinaFactor = cIntRetinaFactor();
+	auto guard = _cachingBackground.make_guard();
+	crl::async([=, guard = std::move(guard)]() mutable {
+		auto to = QRect(QPoint(), rect.size());
+		auto result = QImage();
+		if (tile) {
+			result = PrepareTiledBackground(image, rect.size(), retinaFactor);
+		} else {
+			auto from = QRect();
+			Window::Theme::ComputeBackgroundRects(rect, image.size(), to, from);
+			result = PrepareScaledBackground(
+				image,
+				from,
+				to.size(),
+				retinaFactor);
+		}
+		crl::on_main(std::move(guard), [=, result = std::move(result)]() mutable {
+			_cachingBackground = nullptr;
+			if (_willCacheFor != rect) {
+				return;
+			}
+			_cachedX = to.x();
+			_cachedY = to.y();
+			_cachedBackground = App::pixmapFromImageInPlace(std::move(result));
+			_cachedBackground.setDevicePixelRatio(cRetinaFactor());
+			_cachedFor = rect;
+			update();
+		});
+	});
 }
 
 crl::time MainWidget::highlightStartTime(not_null<const HistoryItem*> item) const {
@@ -1331,6 +1374,7 @@ bool MainWidget::isIdle() const {
 void MainWidget::clearCachedBackground() {
 	_cachedBackground = QPixmap();
 	_cacheBackgroundTimer.cancel();
+	_cachingBackground = nullptr;
 	update();
 }
 
@@ -1340,7 +1384,8 @@ QPixmap MainWidget::cachedBackground(const QRect &forRect, int &x, int &y) {
 		y = _cachedY;
 		return _cachedBackground;
 	}
-	if (_willCacheFor != forRect || !_cacheBackgroundTimer.isActive()) {
+	if (_willCacheFor != forRect
+		|| (!_cacheBackgroundTimer.isActive() && !_cachingBackground)) {
 		_willCacheFor = forRect;
 		_cacheBackgroundTimer.callOnce(kCacheBackgroundTimeout);
 	}
@@ -2908,6 +2953,7 @@ void MainWidget::gotChannelDifference(
 	});
 
 	channel->ptsSetRequesting(false);
+	_channelDifferenceRequests.remove(channel);
 
 	if (!isFinal) {
 		MTP_LOG(0, ("getChannelDifference { good - after not final channelDifference was received }%1").arg(cTestMode() ? " TESTMODE" : ""));
@@ -2917,10 +2963,13 @@ void MainWidget::gotChannelDifference(
 			? (timeout * crl::time(1000))
 			: kWaitForChannelGetDifference);
 	}
+	sendQueuedChannelDifferences();
 }
 
 void MainWidget::feedChannelDifference(
 		const MTPDupdates_channelDifference &data) {
+	const auto postponed = session().data().postponeChatListUpdates();
+
 	session().data().processUsers(data.vusers());
 	session().data().processChats(data.vchats());
 
@@ -2934,6 +2983,8 @@ void MainWidget::feedChannelDifference(
 }
 
 bool MainWidget::failChannelDifference(ChannelData *channel, const RPCError &error) {
+	_channelDifferenceRequests.remove(channel);
+	sendQueuedChannelDifferences();
 	if (MTP::isDefaultHandledError(error)) return false;
 
 	LOG(("RPC Error in getChannelDifference: %1 %2: %3").arg(error.code()).arg(error.type()).arg(error.description()));
@@ -3071,6 +3122,8 @@ void MainWidget::feedDifference(
 		const MTPVector<MTPChat> &chats,
 		const MTPVector<MTPMessage> &msgs,
 		const MTPVector<MTPUpdate> &other) {
+	const auto postponed = session().data().postponeChatListUpdates();
+
 	session().checkAutoLock();
 	session().data().processUsers(users);
 	session().data().processChats(chats);
@@ -3180,6 +3233,19 @@ void MainWidget::getChannelDifference(ChannelData *channel, ChannelDifferenceReq
 
 	channel->ptsSetRequesting(true);
 
+	if (int(_channelDifferenceRequests.size())
+		< kMaxChannelDifferenceRequests) {
+		sendChannelDifference(channel, from);
+	} else {
+		_channelDifferenceQueue.emplace(channel, from);
+	}
+}
+
+void MainWidget::sendChannelDifference(
+		not_null<ChannelData*> channel,
+		ChannelDifferenceRequest from) {
+	_channelDifferenceRequests.emplace(channel);
+
 	auto filter = MTP_channelMessagesFilterEmpty();
 	auto flags = MTPupdates_GetChannelDifference::Flag::f_force | 0;
 	if (from != ChannelDifferenceRequest::PtsGapOrShortPoll) {
@@ -3194,8 +3260,40 @@ void MainWidget::getChannelDifference(ChannelData *channel, ChannelDifferenceReq
 			filter,
 			MTP_int(channel->pts()),
 			MTP_int(kChannelGetDifferenceLimit)),
-		rpcDone(&MainWidget::gotChannelDifference, channel),
-		rpcFail(&MainWidget::failChannelDifference, channel));
+		rpcDone(&MainWidget::gotChannelDifference, channel.get()),
+		rpcFail(&MainWidget::failChannelDifference, channel.get()));
+}
+
+int MainWidget::channelDifferencePriority(
+		not_null<ChannelData*> channel) const {
+	if (_controller->activeChatCurrent().peer() == channel) {
+		return 3;
+	}
+	const auto history = session().data().historyLoaded(channel->id);
+	if (history && history->isPinnedDialog()) {
+		return 2;
+	} else if (!session().data().notifyIsMuted(channel)) {
+		return 1;
+	}
+	return 0;
+}
+
+void MainWidget::sendQueuedChannelDifferences() {
+	while (!_channelDifferenceQueue.empty()
+		&& (int(_channelDifferenceRequests.size())
+			< kMaxChannelDifferenceRequests)) {
+		// Priorities are checked only now, the user could open a chat
+		// or pin it while its difference was waiting in the queue.
+		const auto i = ranges::max_element(
+			_channelDifferenceQueue,
+			std::less<>(),
+			[&](const auto &pair) {
+				return channelDifferencePriority(pair.first);
+			});
+		const auto [queued, from] = *i;
+		_channelDifferenceQueue.erase(i);
+		sendChannelDifference(queued, from);
+	}
 }
 
 void MainWidget::sendPing() {
@@ -3214,16 +3312,11 @@ void MainWidget::start() {
 	update();
 
 	_started = true;
-	Local::readInstalledStickers();
-	Local::readFeaturedStickers();
-	Local::readRecentStickers();
-	Local::readFavedStickers();
-	Local::readSavedGifs();
+	Local::readStickersHashes();
+	session().data().allowStickersLoad();
 	if (const auto availableAt = Local::ReadExportSettings().availableAt) {
 		session().data().suggestStartExport(availableAt);
 	}
-	session().data().notifyStickersUpdated();
-	session().data().notifySavedGifsUpdated();
 
 	_history->start();
 
@@ -3704,6 +3797,10 @@ bool MainWidget::updateReceived(const mtpPrime *from, const mtpPrime *end) {
 }
 
 void MainWidget::feedUpdates(const MTPUpdates &updates, uint64 randomId) {
+	TRACE_SCOPE("MainWidget::feedUpdates");
+
+	const auto postponed = session().data().postponeChatListUpdates();
+
 	switch (updates.type()) {
 	case mtpc_updates: {
 		auto &d = updates.c_updates();
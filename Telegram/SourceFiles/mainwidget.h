@@ -7,6 +7,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #pragma once
 
+#include "base/binary_guard.h"
 #include "base/timer.h"
 #include "base/weak_ptr.h"
 #include "ui/rp_widget.h"
@@ -384,6 +385,12 @@ private:
 	void saveSectionInStack();
 
 	void getChannelDifference(ChannelData *channel, ChannelDifferenceRequest from = ChannelDifferenceRequest::Unknown);
+	void sendChannelDifference(
+		not_null<ChannelData*> channel,
+		ChannelDifferenceRequest from);
+	[[nodiscard]] int channelDifferencePriority(
+		not_null<ChannelData*> channel) const;
+	void sendQueuedChannelDifferences();
 	void gotDifference(const MTPupdates_Difference &diff);
 	bool failDifference(const RPCError &e);
 	void feedDifference(const MTPVector<MTPUser> &users, const MTPVector<MTPChat> &chats, const MTPVector<MTPMessage> &msgs, const MTPVector<MTPUpdate> &other);
@@ -521,6 +528,10 @@ private:
 
 	int32 _failDifferenceTimeout = 1; // growing timeout for getDifference calls, if it fails
 	QMap<ChannelData*, int32> _channelFailDifferenceTimeout; // growing timeout for getChannelDifference calls, if it fails
+	base::flat_set<not_null<ChannelData*>> _channelDifferenceRequests;
+	base::flat_map<
+		not_null<ChannelData*>,
+		ChannelDifferenceRequest> _channelDifferenceQueue;
 	base::Timer _failDifferenceTimer;
 
 	crl::time _lastUpdateTime = 0;
@@ -531,6 +542,7 @@ private:
 	int _cachedX = 0;
 	int _cachedY = 0;
 	base::Timer _cacheBackgroundTimer;
+	base::binary_guard _cachingBackground;
 
 	PhotoData *_deletingPhoto = nullptr;
 
@@ -952,6 +952,9 @@ void MainWindow::sendPaths() {
 
 void MainWindow::updateIsActiveHook() {
 	if (_main) _main->updateOnline();
+	if (const auto controller = sessionController()) {
+		controller->checkWindowActive();
+	}
 }
 
 MainWindow::~MainWindow() {
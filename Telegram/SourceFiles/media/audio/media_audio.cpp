@@ -18,6 +18,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "platform/platform_audio.h"
 #include "core/application.h"
 #include "main/main_session.h"
+#include "base/build_config.h"
 #include "facades.h"
 #include "app.h"
 
@@ -27,6 +28,10 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include <numeric>
 
+#ifdef ARCH_CPU_X86_FAMILY
+#include <emmintrin.h>
+#endif // ARCH_CPU_X86_FAMILY
+
 Q_DECLARE_METATYPE(AudioMsgId);
 Q_DECLARE_METATYPE(VoiceWaveform);
 
@@ -52,6 +57,49 @@ int CoarseTuneForSpeed(float64 speed) {
 	return -int(std::round(kTuneSteps * tuneRatio));
 }
 
+[[nodiscard]] uint16 MaxAbsSample(gsl::span<const uchar> samples) {
+	auto result = uint16(0);
+	for (const auto sample : samples) {
+		accumulate_max(result, Media::Audio::ReadOneSample(sample));
+	}
+	return result;
+}
+
+[[nodiscard]] uint16 MaxAbsSample(gsl::span<const int16> samples) {
+	auto result = uint16(0);
+	auto from = samples.data();
+	const auto till = from + samples.size();
+#ifdef ARCH_CPU_X86_FAMILY
+	constexpr auto kStep = 8;
+	if (till - from >= kStep) {
+		// SSE2 has only a signed 16 bit max, so compare the absolute
+		// values with the top bit flipped and flip them back after.
+		const auto flip = _mm_set1_epi16(short(0x8000));
+		auto max = flip;
+		for (; till - from >= kStep; from += kStep) {
+			const auto values = _mm_loadu_si128(
+				reinterpret_cast<const __m128i*>(from));
+			const auto sign = _mm_srai_epi16(values, 15);
+			const auto abs = _mm_sub_epi16(
+				_mm_xor_si128(values, sign),
+				sign);
+			max = _mm_max_epi16(max, _mm_xor_si128(abs, flip));
+		}
+		alignas(16) uint16 maxes[kStep];
+		_mm_store_si128(
+			reinterpret_cast<__m128i*>(maxes),
+			_mm_xor_si128(max, flip));
+		for (const auto value : maxes) {
+			accumulate_max(result, value);
+		}
+	}
+#endif // ARCH_CPU_X86_FAMILY
+	for (; from != till; ++from) {
+		accumulate_max(result, Media::Audio::ReadOneSample(*from));
+	}
+	return result;
+}
+
 } // namespace
 
 namespace Media {
@@ -280,9 +328,9 @@ namespace Player {
 namespace {
 
 constexpr auto kVolumeRound = 10000;
-constexpr auto kPreloadSamples = 2LL * kDefaultFrequency; // preload next part if less than 2 seconds remains
 constexpr auto kFadeDuration = crl::time(500);
 constexpr auto kCheckPlaybackPositionTimeout = crl::time(100); // 100ms per check audio position
+constexpr auto kCheckPlaybackPositionMin = crl::time(10);
 constexpr auto kCheckPlaybackPositionDelta = 2400LL; // update position called each 2400 samples
 constexpr auto kCheckFadingTimeout = crl::time(7); // 7ms
 
@@ -1287,12 +1335,13 @@ void Fader::onTimer() {
 	}
 	auto hasFading = (_suppressAll || _suppressSongAnim);
 	auto hasPlaying = false;
+	auto nextCheck = kCheckPlaybackPositionTimeout;
 
-	auto updatePlayback = [this, &hasPlaying, &hasFading](AudioMsgId::Type type, int index, float64 volumeMultiplier, bool suppressGainChanged) {
+	auto updatePlayback = [&](AudioMsgId::Type type, int index, float64 volumeMultiplier, bool suppressGainChanged) {
 		auto track = mixer()->trackForType(type, index);
 		if (IsStopped(track->state.state) || track->state.state == State::Paused || !track->isStreamCreated()) return;
 
-		auto emitSignals = updateOnePlayback(track, hasPlaying, hasFading, volumeMultiplier, suppressGainChanged);
+		auto emitSignals = updateOnePlayback(track, hasPlaying, hasFading, nextCheck, volumeMultiplier, suppressGainChanged);
 		if (emitSignals & EmitError) emit error(track->state.id);
 		if (emitSignals & EmitStopped) emit audioStopped(track->state.id);
 		if (emitSignals & EmitPositionUpdated) emit playPositionUpdated(track->state.id);
@@ -1314,14 +1363,14 @@ void Fader::onTimer() {
 		_timer.start(kCheckFadingTimeout);
 		Audio::StopDetachIfNotUsedSafe();
 	} else if (hasPlaying) {
-		_timer.start(kCheckPlaybackPositionTimeout);
+		_timer.start(std::max(nextCheck, kCheckPlaybackPositionMin));
 		Audio::StopDetachIfNotUsedSafe();
 	} else {
 		Audio::ScheduleDetachIfNotUsedSafe();
 	}
 }
 
-int32 Fader::updateOnePlayback(Mixer::Track *track, bool &hasPlaying, bool &hasFading, float64 volumeMultiplier, bool volumeChanged) {
+int32 Fader::updateOnePlayback(Mixer::Track *track, bool &hasPlaying, bool &hasFading, crl::time &nextCheck, float64 volumeMultiplier, bool volumeChanged) {
 	const auto errorHappened = [&] {
 		if (Audio::PlaybackErrorHappened()) {
 			setStoppedState(track, State::StoppedAtError);
@@ -1422,13 +1471,32 @@ int32 Fader::updateOnePlayback(Mixer::Track *track, bool &hasPlaying, bool &hasF
 	}
 	if (playing || track->state.state == State::Starting || track->state.state == State::Resuming) {
 		if (!track->loaded && !track->loading) {
-			auto needPreload = (track->state.position + kPreloadSamples > track->bufferedPosition + track->bufferedLength);
-			if (needPreload) {
+			const auto bufferedAhead = track->bufferedPosition
+				+ track->bufferedLength
+				- track->state.position;
+			if (bufferedAhead < kPreloadSamples) {
 				track->loading = true;
 				emitSignals |= EmitNeedToPreload;
+			} else if (track->state.frequency > 0) {
+				// Wake up right when the next part should be preloaded.
+				accumulate_min(
+					nextCheck,
+					(bufferedAhead - kPreloadSamples) * crl::time(1000)
+						/ track->state.frequency);
 			}
 		}
 	}
+	if (alState == AL_PLAYING
+		&& track->state.id.type() == AudioMsgId::Type::Video
+		&& track->state.frequency > 0) {
+		// Video frames are synced to this position, report it in time.
+		const auto left = track->state.position
+			+ kCheckPlaybackPositionDelta
+			- fullPosition;
+		accumulate_min(
+			nextCheck,
+			std::max(left, 0LL) * crl::time(1000) / track->state.frequency);
+	}
 	if (playing) hasPlaying = true;
 	if (fading) hasFading = true;
 
@@ -1676,13 +1744,25 @@ public:
 
 		auto fmt = format();
 		auto peak = uint16(0);
-		auto callback = [&](uint16 sample) {
-			accumulate_max(peak, sample);
-			sumbytes += Media::Player::kWaveformSamplesCount;
-			if (sumbytes >= countbytes) {
-				sumbytes -= countbytes;
-				peaks.push_back(peak);
-				peak = 0;
+
+		// Each sample adds kWaveformSamplesCount to sumbytes and a peak
+		// is taken when it reaches countbytes, so the samples between
+		// two peaks can be reduced as one block.
+		const auto step = int64(Media::Player::kWaveformSamplesCount);
+		const auto process = [&](auto samples) {
+			while (!samples.empty()) {
+				const auto left = countbytes - sumbytes;
+				const auto count = std::min(
+					int64(samples.size()),
+					(left + step - 1) / step);
+				accumulate_max(peak, MaxAbsSample(samples.first(count)));
+				sumbytes += count * step;
+				if (sumbytes >= countbytes) {
+					sumbytes -= countbytes;
+					peaks.push_back(peak);
+					peak = 0;
+				}
+				samples = samples.subspan(count);
 			}
 		};
 		while (processed < countbytes) {
@@ -1697,11 +1777,14 @@ public:
 				continue;
 			}
 
-			auto sampleBytes = bytes::make_span(buffer);
 			if (fmt == AL_FORMAT_MONO8 || fmt == AL_FORMAT_STEREO8) {
-				Media::Audio::IterateSamples<uchar>(sampleBytes, callback);
+				process(gsl::make_span(
+					reinterpret_cast<const uchar*>(buffer.constData()),
+					buffer.size()));
 			} else if (fmt == AL_FORMAT_MONO16 || fmt == AL_FORMAT_STEREO16) {
-				Media::Audio::IterateSamples<int16>(sampleBytes, callback);
+				process(gsl::make_span(
+					reinterpret_cast<const int16*>(buffer.constData()),
+					buffer.size() / sizeof(int16)));
 			}
 			processed += sampleSize() * samples;
 		}
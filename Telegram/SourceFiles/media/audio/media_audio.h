@@ -53,6 +53,13 @@ constexpr auto kDefaultFrequency = 48000; // 48 kHz
 constexpr auto kTogetherLimit = 4;
 constexpr auto kWaveformSamplesCount = 100;
 
+// The first buffer of a track is small so that playback starts as soon
+// as it is decoded. Then free buffers are filled one after another while
+// less than kPreloadSamples are buffered ahead of the playback position.
+constexpr auto kPlaybackStartBufferSize = 16 * 1024;
+constexpr auto kPlaybackBufferSize = 256 * 1024;
+constexpr auto kPreloadSamples = 2LL * kDefaultFrequency;
+
 class Fader;
 class Loaders;
 
@@ -200,7 +207,7 @@ private:
 
 	class Track {
 	public:
-		static constexpr int kBuffersCount = 3;
+		static constexpr int kBuffersCount = 4;
 
 		// Thread: Any. Must be locked: AudioMutex.
 		void reattach(AudioMsgId::Type type);
@@ -329,7 +336,7 @@ private:
 		EmitPositionUpdated = 0x04,
 		EmitNeedToPreload = 0x08,
 	};
-	int32 updateOnePlayback(Mixer::Track *track, bool &hasPlaying, bool &hasFading, float64 volumeMultiplier, bool volumeChanged);
+	int32 updateOnePlayback(Mixer::Track *track, bool &hasPlaying, bool &hasFading, crl::time &nextCheck, float64 volumeMultiplier, bool volumeChanged);
 	void setStoppedState(Mixer::Track *track, State state = State::Stopped);
 
 	QTimer _timer;
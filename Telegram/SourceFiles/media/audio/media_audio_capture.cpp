@@ -25,6 +25,9 @@ constexpr auto kCaptureFadeInDuration = crl::time(300);
 constexpr auto kCaptureBufferSlice = 256 * 1024;
 constexpr auto kCaptureUpdateDelta = crl::time(100);
 
+// Encoded bytes are passed for the upload in slices of at least that size.
+constexpr auto kCaptureEncodedSlice = 16 * 1024;
+
 Instance *CaptureInstance = nullptr;
 
 bool ErrorHappened(ALCdevice *device) {
@@ -54,6 +57,7 @@ Instance::Instance() : _inner(new Inner(&_thread)) {
 	connect(this, SIGNAL(stop(bool)), _inner, SLOT(onStop(bool)));
 	connect(_inner, SIGNAL(done(QByteArray, VoiceWaveform, qint32)), this, SIGNAL(done(QByteArray, VoiceWaveform, qint32)));
 	connect(_inner, SIGNAL(updated(quint16, qint32)), this, SIGNAL(updated(quint16, qint32)));
+	connect(_inner, SIGNAL(encoded(QByteArray)), this, SIGNAL(encoded(QByteArray)));
 	connect(_inner, SIGNAL(error()), this, SIGNAL(error()));
 	connect(&_thread, SIGNAL(started()), _inner, SLOT(onInit()));
 	connect(&_thread, SIGNAL(finished()), _inner, SLOT(deleteLater()));
@@ -110,6 +114,7 @@ struct Instance::Inner::Private {
 
 	QByteArray data;
 	int32 dataPos = 0;
+	int32 dataEncodedSent = 0;
 
 	int64 waveformMod = 0;
 	int64 waveformEach = (kCaptureFrequency / 100);
@@ -466,6 +471,7 @@ void Instance::Inner::onStop(bool needResult) {
 		d->levelMax = 0;
 
 		d->dataPos = 0;
+		d->dataEncodedSent = 0;
 		d->data.clear();
 
 		d->waveformMod = 0;
@@ -536,6 +542,12 @@ void Instance::Inner::onTimeout() {
 			memmove(_captured.data(), _captured.constData() + encoded, goodSize);
 			_captured.resize(goodSize);
 		}
+
+		// Pass the encoded pages so they're uploaded while recording.
+		if (d->data.size() >= d->dataEncodedSent + kCaptureEncodedSlice) {
+			emit encoded(d->data.mid(d->dataEncodedSent));
+			d->dataEncodedSent = d->data.size();
+		}
 	} else {
 		DEBUG_LOG(("Audio Capture: no samples to capture."));
 	}
@@ -36,6 +36,7 @@ signals:
 
 	void done(QByteArray data, VoiceWaveform waveform, qint32 samples);
 	void updated(quint16 level, qint32 samples);
+	void encoded(QByteArray bytes);
 	void error();
 
 private:
@@ -62,6 +63,9 @@ signals:
 	void updated(quint16 level, qint32 samples);
 	void done(QByteArray data, VoiceWaveform waveform, qint32 samples);
 
+	// New bytes of the file appended after the ones passed before.
+	void encoded(QByteArray bytes);
+
 public slots:
 	void onInit();
 	void onStart();
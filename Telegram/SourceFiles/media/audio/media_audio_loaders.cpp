@@ -10,14 +10,10 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "media/audio/media_audio.h"
 #include "media/audio/media_audio_ffmpeg_loader.h"
 #include "media/audio/media_child_ffmpeg_loader.h"
+#include "base/invoke_queued.h"
 
 namespace Media {
 namespace Player {
-namespace {
-
-constexpr auto kPlaybackBufferSize = 256 * 1024;
-
-} // namespace
 
 Loaders::Loaders(QThread *thread)
 : _fromExternalNotify([=] { videoSoundAdded(); }) {
@@ -146,6 +142,19 @@ void Loaders::onLoad(const AudioMsgId &audio) {
 	loadData(audio);
 }
 
+void Loaders::refill(const AudioMsgId &audio) {
+	const auto stillLoading = [&] {
+		QMutexLocker lock(internal::audioPlayerMutex());
+		const auto track = mixer()
+			? mixer()->trackForType(audio.type())
+			: nullptr;
+		return track && (track->state.id == audio) && track->loading;
+	}();
+	if (stillLoading) {
+		loadData(audio);
+	}
+}
+
 void Loaders::loadData(AudioMsgId audio, crl::time positionMs) {
 	auto err = SetupNoErrorStarted;
 	auto type = audio.type();
@@ -162,12 +171,15 @@ void Loaders::loadData(AudioMsgId audio, crl::time positionMs) {
 	auto waiting = false;
 	auto errAtStart = started;
 
+	const auto bufferSize = started
+		? kPlaybackStartBufferSize
+		: kPlaybackBufferSize;
 	QByteArray samples;
 	int64 samplesCount = 0;
 	if (l->holdsSavedDecodedSamples()) {
 		l->takeSavedDecodedSamples(&samples, &samplesCount);
 	}
-	while (samples.size() < kPlaybackBufferSize) {
+	while (samples.size() < bufferSize) {
 		auto res = l->readMore(samples, samplesCount);
 		using Result = AudioPlayerLoader::ReadResult;
 		if (res == Result::Error) {
@@ -189,7 +201,7 @@ void Loaders::loadData(AudioMsgId audio, crl::time positionMs) {
 		} else if (res == Result::Ok) {
 			errAtStart = false;
 		} else if (res == Result::Wait) {
-			waiting = (samples.size() < kPlaybackBufferSize)
+			waiting = (samples.size() < bufferSize)
 				&& !l->forceToBuffer();
 			if (waiting) {
 				l->saveDecodedSamples(&samples, &samplesCount);
@@ -275,6 +287,17 @@ void Loaders::loadData(AudioMsgId audio, crl::time positionMs) {
 	}
 
 	track->loading = false;
+	if (!finished
+		&& (track->bufferedPosition + track->bufferedLength
+			< track->state.position + kPreloadSamples)
+		&& track->getNotQueuedBufferIndex() >= 0) {
+		// Fill the next free buffer right away instead of waiting
+		// for the Fader to notice that we need more data.
+		track->loading = true;
+		InvokeQueued(this, [=] {
+			refill(audio);
+		});
+	}
 	if (IsPausedOrPausing(track->state.state)
 		|| IsStoppedOrStopping(track->state.state)) {
 		return;
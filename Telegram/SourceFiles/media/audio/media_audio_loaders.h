@@ -38,6 +38,7 @@ public slots:
 
 private:
 	void videoSoundAdded();
+	void refill(const AudioMsgId &audio);
 
 	AudioMsgId _audio, _song, _video;
 	std::unique_ptr<AudioPlayerLoader> _audioLoader;
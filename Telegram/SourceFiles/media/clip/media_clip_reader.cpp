@@ -13,6 +13,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "media/clip/media_clip_check_streaming.h"
 #include "mainwidget.h"
 #include "mainwindow.h"
+#include "base/flat_map.h"
+#include "base/memory_usage.h"
 
 #include <QtCore/QBuffer>
 #include <QtCore/QAbstractEventDispatcher>
@@ -29,8 +31,27 @@ namespace Media {
 namespace Clip {
 namespace {
 
+constexpr auto kThreadsCountMin = 2;
+constexpr auto kThreadsCountMax = 16;
+
+struct SharedThread {
+	int index = 0;
+	int readers = 0;
+};
+
+base::memory_usage::Counter ReadersMemory("Media::Clip readers");
+
 QVector<QThread*> threads;
 QVector<Manager*> managers;
+base::flat_map<uint64, SharedThread> sharedThreads;
+
+int ThreadsCount() {
+	static const auto result = std::clamp(
+		QThread::idealThreadCount(),
+		kThreadsCountMin,
+		kThreadsCountMax);
+	return result;
+}
 
 QImage PrepareFrameImage(const FrameRequest &request, const QImage &original, bool hasAlpha, QImage &cache) {
 	auto needResize = (original.width() != request.framew) || (original.height() != request.frameh);
@@ -98,7 +119,8 @@ Reader::Reader(not_null<DocumentData*> document, FullMsgId msgId, Callback &&cal
 	document,
 	msgId,
 	(mode == Mode::Video) ? AudioMsgId::CreateExternalPlayId() : 0)
-, _seekPositionMs(seekMs) {
+, _seekPositionMs(seekMs)
+, _shareId((mode == Mode::Gif && !seekMs) ? document->id : 0) {
 	init(document->location(), document->data());
 }
 
@@ -110,7 +132,17 @@ Reader::Reader(const QByteArray &data, Callback &&callback, Mode mode, crl::time
 }
 
 void Reader::init(const FileLocation &location, const QByteArray &data) {
-	if (threads.size() < ClipThreadsCount) {
+	ReadersMemory.add(0);
+	if (_shareId) {
+		const auto i = sharedThreads.find(_shareId);
+		if (i != end(sharedThreads)) {
+			_threadIndex = i->second.index;
+			++i->second.readers;
+			managers.at(_threadIndex)->append(this, location, data);
+			return;
+		}
+	}
+	if (threads.size() < ThreadsCount()) {
 		_threadIndex = threads.size();
 		threads.push_back(new QThread());
 		managers.push_back(new Manager(threads.back()));
@@ -126,6 +158,9 @@ void Reader::init(const FileLocation &location, const QByteArray &data) {
 			}
 		}
 	}
+	if (_shareId) {
+		sharedThreads.emplace(_shareId, SharedThread{ _threadIndex, 1 });
+	}
 	managers.at(_threadIndex)->append(this, location, data);
 }
 
@@ -264,6 +299,7 @@ QPixmap Reader::current(int32 framew, int32 frameh, int32 outerw, int32 outerh,
 	frame->original.setDevicePixelRatio(factor);
 	frame->pix = QPixmap();
 	frame->pix = PrepareFrame(frame->request, frame->original, true, cacheForResize);
+	updateMemoryUsage(frame);
 
 	auto other = frameToWriteNext(true);
 	if (other) other->request = frame->request;
@@ -358,8 +394,24 @@ void Reader::finished() {
 	_private = nullptr;
 }
 
+// All the frames are estimated by the one that is shown right now.
+void Reader::updateMemoryUsage(not_null<const Frame*> shown) {
+	const auto pix = int64(shown->pix.width()) * shown->pix.height() * 4;
+	const auto now = int64(std::size(_frames))
+		* (shown->original.byteCount() + pix);
+	ReadersMemory.add(now - _memoryBytes, 0);
+	_memoryBytes = now;
+}
+
 Reader::~Reader() {
+	ReadersMemory.remove(_memoryBytes);
 	stop();
+	if (_shareId) {
+		const auto i = sharedThreads.find(_shareId);
+		if (i != end(sharedThreads) && !--i->second.readers) {
+			sharedThreads.erase(i);
+		}
+	}
 }
 
 class ReaderPrivate {
@@ -436,6 +488,12 @@ public:
 		if (!_request.valid()) {
 			return start(ms);
 		}
+		if (_source && _source->_request != _request) {
+			detachSource(ms);
+			if (_state == State::Error) {
+				return ProcessResult::Error;
+			}
+		}
 		if (!_started) {
 			_started = true;
 			if (!_videoPausedAtMs && _hasAudio) {
@@ -443,6 +501,14 @@ public:
 			}
 		}
 
+		if (_source) {
+			if (_autoPausedGif
+				|| _framesCopied == _source->_framesRendered) {
+				_nextFrameWhen = _source->_nextFrameWhen;
+				return ProcessResult::Wait;
+			}
+			return ProcessResult::Repaint;
+		}
 		if (!_autoPausedGif && !_videoPausedAtMs && ms >= _nextFrameWhen) {
 			return ProcessResult::Repaint;
 		}
@@ -450,6 +516,9 @@ public:
 	}
 
 	ProcessResult finishProcess(crl::time ms) {
+		if (_source) {
+			return copySourceFrame();
+		}
 		auto frameMs = _seekPositionMs + ms - _animationStarted;
 		auto readResult = _implementation->readFramesTill(frameMs, ms);
 		if (readResult == internal::ReaderImplementation::ReadResult::EndOfFile) {
@@ -484,9 +553,65 @@ public:
 		frame()->pix = PrepareFrame(_request, frame()->original, frame()->alpha, frame()->cache);
 		frame()->when = _nextFrameWhen;
 		frame()->positionMs = _nextFramePositionMs;
+		++_framesRendered;
 		return true;
 	}
 
+	void setRequest(const FrameRequest &request) {
+		if (_request != request) {
+			_request = request;
+			_shareChecked = false;
+		}
+	}
+
+	[[nodiscard]] bool canFollow(not_null<const ReaderPrivate*> source) const {
+		return (source != this)
+			&& (source->_shareId == _shareId)
+			&& !source->_source
+			&& (source->_implementation != nullptr)
+			&& (source->_state == State::Reading)
+			&& source->_started
+			&& !source->_autoPausedGif
+			&& (source->_request == _request);
+	}
+
+	// Frames are taken from the source, our own decoder is not needed.
+	void followSource(not_null<ReaderPrivate*> source) {
+		if (_source) {
+			--_source->_followers;
+		}
+		_source = source;
+		++_source->_followers;
+		_framesCopied = _source->_framesRendered - 1;
+		_implementation = nullptr;
+	}
+
+	// Continue decoding by ourselves from the position of the source.
+	void detachSource(crl::time ms) {
+		const auto source = base::take(_source);
+		--source->_followers;
+		_shareChecked = false;
+		_seekPositionMs = source->_nextFramePositionMs;
+		if (!init()) {
+			error();
+			return;
+		}
+		startedAt(ms);
+	}
+
+	ProcessResult copySourceFrame() {
+		const auto from = _source->frame();
+		frame()->pix = from->pix;
+		frame()->original = from->original;
+		frame()->alpha = from->alpha;
+		frame()->when = from->when;
+		frame()->positionMs = from->positionMs;
+		_nextFrameWhen = _source->_nextFrameWhen;
+		_nextFramePositionMs = _source->_nextFramePositionMs;
+		_framesCopied = _source->_framesRendered;
+		return ProcessResult::CopyFrame;
+	}
+
 	bool init() {
 		if (_data.isEmpty() && QFileInfo(_location->name()).size() <= Storage::kMaxAnimationInMemory) {
 			QFile f(_location->name());
@@ -605,6 +730,13 @@ private:
 	bool _started = false;
 	crl::time _videoPausedAtMs = 0;
 
+	uint64 _shareId = 0;
+	ReaderPrivate *_source = nullptr;
+	int _followers = 0;
+	int _framesRendered = 0;
+	int _framesCopied = 0;
+	bool _shareChecked = false;
+
 	friend class Manager;
 
 };
@@ -628,6 +760,7 @@ Manager::Manager(QThread *thread) {
 
 void Manager::append(Reader *reader, const FileLocation &location, const QByteArray &data) {
 	reader->_private = new ReaderPrivate(reader, location, data);
+	reader->_private->_shareId = reader->_shareId;
 	_loadLevel.fetchAndAddRelaxed(AverageGifSize);
 	update(reader);
 }
@@ -701,7 +834,8 @@ bool Manager::handleProcessResult(ReaderPrivate *reader, ProcessResult result, c
 		it.key()->_hasAudio = reader->_hasAudio;
 	}
 	// See if we need to pause GIF because it is not displayed right now.
-	if (!reader->_autoPausedGif && reader->_mode == Reader::Mode::Gif && result == ProcessResult::Repaint) {
+	// The decoder shared with other readers is never paused.
+	if (!reader->_autoPausedGif && !reader->_followers && reader->_mode == Reader::Mode::Gif && result == ProcessResult::Repaint) {
 		int32 ishowing, iprevious;
 		auto showing = it.key()->frameToShow(&ishowing), previous = it.key()->frameToWriteNext(false, &iprevious);
 		Assert(previous != nullptr && showing != nullptr && ishowing >= 0 && iprevious >= 0);
@@ -738,8 +872,7 @@ bool Manager::handleProcessResult(ReaderPrivate *reader, ProcessResult result, c
 
 Manager::ResultHandleState Manager::handleResult(ReaderPrivate *reader, ProcessResult result, crl::time ms) {
 	if (!handleProcessResult(reader, result, ms)) {
-		_loadLevel.fetchAndAddRelaxed(-1 * (reader->_width > 0 ? reader->_width * reader->_height : AverageGifSize));
-		delete reader;
+		destroyReader(reader);
 		return ResultHandleRemove;
 	}
 
@@ -770,6 +903,50 @@ Manager::ResultHandleState Manager::handleResult(ReaderPrivate *reader, ProcessR
 	return ResultHandleContinue;
 }
 
+void Manager::shareDecoder(not_null<ReaderPrivate*> reader) {
+	reader->_shareChecked = true;
+	if (reader->_source || reader->_followers) {
+		return;
+	}
+	for (auto i = _readers.cbegin(), e = _readers.cend(); i != e; ++i) {
+		if (reader->canFollow(i.key())) {
+			reader->followSource(i.key());
+			return;
+		}
+	}
+}
+
+void Manager::unshareDecoder(not_null<ReaderPrivate*> reader) {
+	if (const auto source = base::take(reader->_source)) {
+		--source->_followers;
+		return;
+	}
+	auto promoted = (ReaderPrivate*)nullptr;
+	const auto ms = crl::now();
+	for (auto i = _readers.cbegin(), e = _readers.cend(); i != e; ++i) {
+		if (!reader->_followers) {
+			break;
+		}
+		const auto follower = i.key();
+		if (follower->_source != reader) {
+			continue;
+		} else if (promoted) {
+			follower->followSource(promoted);
+			continue;
+		}
+		follower->detachSource(ms);
+		if (follower->_state == State::Reading) {
+			promoted = follower;
+		}
+	}
+}
+
+void Manager::destroyReader(ReaderPrivate *reader) {
+	unshareDecoder(reader);
+	_loadLevel.fetchAndAddRelaxed(-1 * (reader->_width > 0 ? reader->_width * reader->_height : AverageGifSize));
+	delete reader;
+}
+
 void Manager::process() {
 	if (_processingInThread) {
 		_needReProcess = true;
@@ -800,7 +977,7 @@ void Manager::process() {
 					}
 				}
 				auto frame = it.key()->frameToWrite();
-				if (frame) it.key()->_private->_request = frame->request;
+				if (frame) it.key()->_private->setRequest(frame->request);
 				it->storeRelease(0);
 			}
 		}
@@ -810,6 +987,9 @@ void Manager::process() {
 	for (auto i = _readers.begin(), e = _readers.end(); i != e;) {
 		ReaderPrivate *reader = i.key();
 		if (i.value() <= ms) {
+			if (reader->_shareId && reader->_started && !reader->_shareChecked) {
+				shareDecoder(reader);
+			}
 			ResultHandleState state = handleResult(reader, reader->process(ms), ms);
 			if (state == ResultHandleRemove) {
 				i = _readers.erase(i);
@@ -830,8 +1010,7 @@ void Manager::process() {
 			QMutexLocker lock(&_readerPointersMutex);
 			auto it = constUnsafeFindReaderPointer(reader);
 			if (it == _readerPointers.cend()) {
-				_loadLevel.fetchAndAddRelaxed(-1 * (reader->_width > 0 ? reader->_width * reader->_height : AverageGifSize));
-				delete reader;
+				destroyReader(reader);
 				i = _readers.erase(i);
 				continue;
 			}
@@ -930,6 +1109,7 @@ void Finish() {
 		}
 		threads.clear();
 		managers.clear();
+		sharedThreads.clear();
 	}
 }
 
@@ -27,6 +27,18 @@ struct FrameRequest {
 	bool valid() const {
 		return factor > 0;
 	}
+	bool operator==(const FrameRequest &other) const {
+		return (factor == other.factor)
+			&& (framew == other.framew)
+			&& (frameh == other.frameh)
+			&& (outerw == other.outerw)
+			&& (outerh == other.outerh)
+			&& (radius == other.radius)
+			&& (corners == other.corners);
+	}
+	bool operator!=(const FrameRequest &other) const {
+		return !(*this == other);
+	}
 	int factor = 0;
 	int framew = 0;
 	int frameh = 0;
@@ -138,6 +150,9 @@ private:
 	crl::time _durationMs = 0;
 	crl::time _seekPositionMs = 0;
 
+	// Readers of the same GIF are placed in one thread to share decoding.
+	uint64 _shareId = 0;
+
 	mutable int _width = 0;
 	mutable int _height = 0;
 
@@ -163,12 +178,14 @@ private:
 	Frame *frameToWriteNext(bool check, int *index = nullptr) const;
 	void moveToNextShow() const;
 	void moveToNextWrite() const;
+	void updateMemoryUsage(not_null<const Frame*> shown);
 
 	QAtomicInt _autoPausedGif = 0;
 	QAtomicInt _videoPauseRequest = 0;
 	int32 _threadIndex;
 
 	bool _autoplay = false;
+	int64 _memoryBytes = 0;
 
 	friend class Manager;
 
@@ -282,6 +299,9 @@ private:
 	ReaderPointers::iterator unsafeFindReaderPointer(ReaderPrivate *reader);
 
 	bool handleProcessResult(ReaderPrivate *reader, ProcessResult result, crl::time ms);
+	void shareDecoder(not_null<ReaderPrivate*> reader);
+	void unshareDecoder(not_null<ReaderPrivate*> reader);
+	void destroyReader(ReaderPrivate *reader);
 
 	enum ResultHandleState {
 		ResultHandleRemove,
@@ -41,6 +41,9 @@ constexpr auto kIdsLimit = 32;
 // Preload next messages if we went further from current than that.
 constexpr auto kIdsPreloadAfter = 28;
 
+// Start loading the next playlist item when that much is left to play.
+constexpr auto kPrefetchNextBefore = 5 * crl::time(1000);
+
 } // namespace
 
 void start(not_null<Audio::Instance*> instance) {
@@ -67,6 +70,8 @@ struct Instance::Streamed {
 	Streaming::Player player;
 	Streaming::Information info;
 	View::PlaybackProgress progress;
+	std::shared_ptr<Streaming::Reader> nextReader;
+	bool nextPrefetched = false;
 	bool clearing = false;
 };
 
@@ -311,6 +316,45 @@ bool Instance::moveInPlaylist(
 	return false;
 }
 
+void Instance::prefetchNextIfNeeded(not_null<Data*> data) {
+	Expects(data->streamed != nullptr);
+
+	const auto streamed = data->streamed.get();
+	const auto &state = streamed->info.video.size.isEmpty()
+		? streamed->info.audio.state
+		: streamed->info.video.state;
+	if (streamed->nextPrefetched
+		|| data->repeatEnabled
+		|| !data->playlistIndex
+		|| state.position == kTimeUnknown
+		|| state.duration == kTimeUnknown
+		|| state.duration == Streaming::kDurationUnavailable
+		|| state.duration - state.position > kPrefetchNextBefore) {
+		return;
+	}
+	streamed->nextPrefetched = true;
+
+	const auto item = itemByIndex(data, *data->playlistIndex + 1);
+	const auto media = item ? item->media() : nullptr;
+	const auto document = media ? media->document() : nullptr;
+	if (!document
+		|| !(document->isAudioFile()
+			|| document->isVoiceMessage()
+			|| document->isVideoMessage())) {
+		return;
+	}
+	auto reader = document->owner().documentStreamedReader(
+		document,
+		item->fullId());
+	if (!reader) {
+		return;
+	}
+	reader->prefetch();
+
+	// Keep the reader alive until we switch to the next item.
+	streamed->nextReader = std::move(reader);
+}
+
 bool Instance::previousAvailable(AudioMsgId::Type type) const {
 	const auto data = getData(type);
 	Assert(data != nullptr);
@@ -696,12 +740,14 @@ void Instance::handleStreamingUpdate(
 		//emitUpdate(data->type, [](AudioMsgId) { return true; });
 	}, [&](UpdateVideo &update) {
 		data->streamed->info.video.state.position = update.position;
+		prefetchNextIfNeeded(data);
 		emitUpdate(data->type);
 	}, [&](PreloadedAudio &update) {
 		data->streamed->info.audio.state.receivedTill = update.till;
 		//emitUpdate(data->type, [](AudioMsgId) { return true; });
 	}, [&](UpdateAudio &update) {
 		data->streamed->info.audio.state.position = update.position;
+		prefetchNextIfNeeded(data);
 		emitUpdate(data->type);
 	}, [&](WaitingForData) {
 	}, [&](MutedByOther) {
@@ -211,6 +211,7 @@ private:
 	void validatePlaylist(not_null<Data*> data);
 	void playlistUpdated(not_null<Data*> data);
 	bool moveInPlaylist(not_null<Data*> data, int delta, bool autonext);
+	void prefetchNextIfNeeded(not_null<Data*> data);
 	HistoryItem *itemByIndex(not_null<Data*> data, int index);
 
 	void handleStreamingUpdate(
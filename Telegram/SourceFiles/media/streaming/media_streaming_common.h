@@ -107,6 +107,17 @@ struct Update {
 		Finished> data;
 };
 
+struct PlaybackStats {
+	crl::time firstFrameDelay = kTimeUnknown;
+	int stalls = 0;
+	crl::time stalledDuration = 0;
+	int64 bytesFromNetwork = 0;
+	int64 bytesFromCache = 0;
+	int framesDecoded = 0;
+	int framesDropped = 0;
+	crl::time decodeDuration = 0;
+};
+
 enum class Error {
 	OpenFailed,
 	LoadFailed,
@@ -16,6 +16,8 @@ namespace Streaming {
 namespace {
 
 constexpr auto kMaxSingleReadAmount = 8 * 1024 * 1024;
+constexpr auto kSeekIndexEntriesMax = 64 * 1024;
+constexpr auto kSeekIndexVersion = qint32(1);
 
 } // namespace
 
@@ -140,7 +142,9 @@ Stream File::Context::initStream(
 		}
 	}
 
-	result.codec = FFmpeg::MakeCodecPointer(info);
+	result.codec = FFmpeg::MakeCodecPointer(
+		info,
+		(type == AVMEDIA_TYPE_VIDEO));
 	if (!result.codec) {
 		return result;
 	}
@@ -207,6 +211,85 @@ void File::Context::seekToPosition(
 	return logFatal(qstr("av_seek_frame"), error);
 }
 
+// Demuxers that find keyframes only while reading, without an index in
+// the header, get the keyframes found during the previous playback.
+void File::Context::restoreSeekIndex(
+		not_null<AVFormatContext*> format,
+		const Stream &stream) {
+	const auto info = format->streams[stream.index];
+	if (info->nb_index_entries > 0) {
+		return;
+	}
+	_seekIndexStream = stream.index;
+
+	auto serialized = _reader->seekIndex();
+	auto data = QDataStream(&serialized, QIODevice::ReadOnly);
+	data.setVersion(QDataStream::Qt_5_1);
+	auto version = qint32();
+	auto count = qint32();
+	data >> version >> count;
+	if (data.status() != QDataStream::Ok
+		|| version != kSeekIndexVersion
+		|| count <= 0
+		|| count > kSeekIndexEntriesMax) {
+		return;
+	}
+	for (auto i = 0; i != count; ++i) {
+		auto position = qint64();
+		auto timestamp = qint64();
+		data >> position >> timestamp;
+		if (data.status() != QDataStream::Ok
+			|| position < 0
+			|| position >= _size) {
+			break;
+		}
+		av_add_index_entry(
+			info,
+			position,
+			timestamp,
+			0,
+			0,
+			AVINDEX_KEYFRAME);
+	}
+	_seekIndexRestored = info->nb_index_entries;
+}
+
+void File::Context::saveSeekIndex() {
+	if (!_format || _seekIndexStream < 0) {
+		return;
+	}
+	const auto info = _format->streams[_seekIndexStream];
+	if (info->nb_index_entries <= _seekIndexRestored) {
+		return;
+	}
+	const auto entries = gsl::make_span(
+		info->index_entries,
+		info->nb_index_entries);
+	auto keyframes = std::vector<const AVIndexEntry*>();
+	keyframes.reserve(entries.size());
+	for (const auto &entry : entries) {
+		if (entry.flags & AVINDEX_KEYFRAME) {
+			keyframes.push_back(&entry);
+		}
+	}
+	const auto count = std::min(int(keyframes.size()), kSeekIndexEntriesMax);
+	if (!count) {
+		return;
+	}
+	auto serialized = QByteArray();
+	serialized.reserve(2 * sizeof(qint32) + count * 2 * sizeof(qint64));
+	{
+		auto data = QDataStream(&serialized, QIODevice::WriteOnly);
+		data.setVersion(QDataStream::Qt_5_1);
+		data << kSeekIndexVersion << qint32(count);
+		for (const auto entry : keyframes | ranges::view::take(count)) {
+			data << qint64(entry->pos) << qint64(entry->timestamp);
+		}
+	}
+	_reader->putSeekIndex(std::move(serialized));
+	_seekIndexRestored = info->nb_index_entries;
+}
+
 base::variant<FFmpeg::Packet, FFmpeg::AvErrorWrap> File::Context::readPacket() {
 	auto error = FFmpeg::AvErrorWrap();
 
@@ -256,7 +339,9 @@ void File::Context::start(crl::time position) {
 		sendFullInCache(true);
 	}
 	if (video.codec || audio.codec) {
-		seekToPosition(format.get(), video.codec ? video : audio, position);
+		const auto &main = video.codec ? video : audio;
+		restoreSeekIndex(format.get(), main);
+		seekToPosition(format.get(), main, position);
 	}
 	if (unroll()) {
 		return;
@@ -380,6 +465,9 @@ void File::stop(bool stillActive) {
 		_context->interrupt();
 		_thread.join();
 	}
+	if (_context) {
+		_context->saveSeekIndex();
+	}
 	_reader->stopStreaming(stillActive);
 	_context.reset();
 }
@@ -388,6 +476,14 @@ bool File::isRemoteLoader() const {
 	return _reader->isRemoteLoader();
 }
 
+int64 File::bytesFromNetwork() const {
+	return _reader->bytesFromNetwork();
+}
+
+int64 File::bytesFromCache() const {
+	return _reader->bytesFromCache();
+}
+
 File::~File() {
 	stop();
 }
@@ -37,6 +37,8 @@ public:
 	void stop(bool stillActive = false);
 
 	[[nodiscard]] bool isRemoteLoader() const;
+	[[nodiscard]] int64 bytesFromNetwork() const;
+	[[nodiscard]] int64 bytesFromCache() const;
 
 	~File();
 
@@ -50,6 +52,7 @@ private:
 
 		void interrupt();
 		void wake();
+		void saveSeekIndex();
 		[[nodiscard]] bool interrupted() const;
 		[[nodiscard]] bool failed() const;
 		[[nodiscard]] bool finished() const;
@@ -77,6 +80,9 @@ private:
 			not_null<AVFormatContext *> format,
 			const Stream &stream,
 			crl::time position);
+		void restoreSeekIndex(
+			not_null<AVFormatContext *> format,
+			const Stream &stream);
 
 		// TODO base::expected.
 		[[nodiscard]] auto readPacket()
@@ -97,6 +103,8 @@ private:
 		std::atomic<bool> _interrupted = false;
 
 		FFmpeg::FormatPointer _format;
+		int _seekIndexStream = -1;
+		int _seekIndexRestored = 0;
 
 	};
 
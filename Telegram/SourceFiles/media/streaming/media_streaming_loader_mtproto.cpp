@@ -16,7 +16,13 @@ namespace Media {
 namespace Streaming {
 namespace {
 
-constexpr auto kMaxConcurrentRequests = 4;
+constexpr auto kMinConcurrentRequests = 4;
+constexpr auto kMaxConcurrentRequests = 16;
+
+// When parts start coming this much slower than the fastest one did, the
+// link is saturated and more parallel requests would only wait in queues.
+constexpr auto kSaturatedDurationRatio = 2;
+constexpr auto kSaturatedDurationSlack = crl::time(50);
 
 } // namespace
 
@@ -29,7 +35,12 @@ LoaderMtproto::LoaderMtproto(
 , _location(location)
 , _dcId(location.dcId())
 , _size(size)
-, _origin(origin) {
+, _origin(origin)
+, _concurrentRequestsLimit(kMinConcurrentRequests) {
+	_owner->bandwidth().refilled(
+	) | rpl::start_with_next([=] {
+		sendNext();
+	}, _lifetime);
 }
 
 LoaderMtproto::~LoaderMtproto() {
@@ -110,7 +121,13 @@ void LoaderMtproto::changeRequestedAmount(int index, int amount) {
 }
 
 void LoaderMtproto::sendNext() {
-	if (_requests.size() >= kMaxConcurrentRequests) {
+	if (int(_requests.size()) >= _concurrentRequestsLimit) {
+		return;
+	} else if (!_requested.front()) {
+		return;
+	} else if (!_owner->bandwidth().acquire(
+			Storage::BandwidthClass::Streaming,
+			kPartSize)) {
 		return;
 	}
 	const auto offset = _requested.take().value_or(-1);
@@ -122,6 +139,7 @@ void LoaderMtproto::sendNext() {
 	changeRequestedAmount(index, kPartSize);
 
 	const auto usedFileReference = _location.fileReference();
+	const auto sent = crl::now();
 	const auto id = _sender.request(MTPupload_GetFile(
 		MTP_flags(0),
 		_location.tl(Auth().userId()),
@@ -129,6 +147,7 @@ void LoaderMtproto::sendNext() {
 		MTP_int(kPartSize)
 	)).done([=](const MTPupload_File &result) {
 		changeRequestedAmount(index, -kPartSize);
+		updateConcurrentRequestsLimit(crl::now() - sent);
 		requestDone(offset, result);
 	}).fail([=](const RPCError &error) {
 		changeRequestedAmount(index, -kPartSize);
@@ -141,6 +160,28 @@ void LoaderMtproto::sendNext() {
 	sendNext();
 }
 
+void LoaderMtproto::updateConcurrentRequestsLimit(crl::time duration) {
+	_requestDuration = _requestDuration
+		? ((_requestDuration * 3 + duration) / 4)
+		: duration;
+	if (!_minRequestDuration || duration < _minRequestDuration) {
+		_minRequestDuration = duration;
+	}
+	const auto saturated = (_requestDuration
+		> kSaturatedDurationRatio * _minRequestDuration
+			+ kSaturatedDurationSlack);
+	if (saturated) {
+		if (_concurrentRequestsLimit > kMinConcurrentRequests) {
+			--_concurrentRequestsLimit;
+		}
+	} else if (_requested.front()
+		&& int(_requests.size()) >= _concurrentRequestsLimit
+		&& _concurrentRequestsLimit < kMaxConcurrentRequests) {
+		// Parts are waiting for us and the link has spare capacity.
+		++_concurrentRequestsLimit;
+	}
+}
+
 void LoaderMtproto::requestDone(int offset, const MTPupload_File &result) {
 	result.match([&](const MTPDupload_file &data) {
 		_requests.erase(offset);
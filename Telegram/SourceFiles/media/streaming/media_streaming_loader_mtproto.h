@@ -60,6 +60,7 @@ private:
 		const QVector<MTPFileHash> &hashes);
 	void cancelForOffset(int offset);
 	void changeRequestedAmount(int index, int amount);
+	void updateConcurrentRequestsLimit(crl::time duration);
 
 	const not_null<Storage::Downloader*> _owner;
 
@@ -75,10 +76,15 @@ private:
 	PriorityQueue _requested;
 	base::flat_map<int, mtpRequestId> _requests;
 	base::flat_map<int, int> _amountByDcIndex;
+	crl::time _requestDuration = 0;
+	crl::time _minRequestDuration = 0;
+	int _concurrentRequestsLimit = 0;
 	rpl::event_stream<LoadedPart> _parts;
 
 	Storage::StreamedFileDownloader *_downloader = nullptr;
 
+	rpl::lifetime _lifetime;
+
 };
 
 } // namespace Streaming
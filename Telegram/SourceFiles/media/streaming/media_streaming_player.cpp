@@ -13,6 +13,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "media/streaming/media_streaming_video_track.h"
 #include "media/audio/media_audio.h" // for SupportsSpeedControl()
 #include "data/data_document.h" // for DocumentData::duration()
+#include "base/frame_clock.h"
 
 namespace Media {
 namespace Streaming {
@@ -83,8 +84,7 @@ Player::Player(
 	not_null<Data::Session*> owner,
 	std::shared_ptr<Reader> reader)
 : _file(std::make_unique<File>(owner, std::move(reader)))
-, _remoteLoader(_file->isRemoteLoader())
-, _renderFrameTimer([=] { checkNextFrameRender(); }) {
+, _remoteLoader(_file->isRemoteLoader()) {
 }
 
 not_null<FileDelegate*> Player::delegate() {
@@ -96,11 +96,8 @@ void Player::checkNextFrameRender() {
 
 	const auto now = crl::now();
 	if (now < _nextFrameTime) {
-		if (!_renderFrameTimer.isActive()) {
-			_renderFrameTimer.callOnce(_nextFrameTime - now);
-		}
+		base::FrameClock::Instance().request(_nextFrameTime);
 	} else {
-		_renderFrameTimer.cancel();
 		_nextFrameTime = kTimeUnknown;
 		renderFrame(now);
 	}
@@ -447,6 +444,9 @@ void Player::provideStartInformation() {
 		fail(Error::OpenFailed);
 	} else {
 		_stage = Stage::Ready;
+		if (_stats.firstFrameDelay == kTimeUnknown) {
+			_stats.firstFrameDelay = crl::now() - _playRequestedTime;
+		}
 
 		// Don't keep the reference to the video cover.
 		auto copy = _information;
@@ -485,6 +485,10 @@ void Player::play(const PlaybackOptions &options) {
 	if (!Media::Audio::SupportsSpeedControl()) {
 		_options.speed = 1.;
 	}
+	_stats = PlaybackStats();
+	_playRequestedTime = crl::now();
+	_bytesFromNetworkAtStart = _file->bytesFromNetwork();
+	_bytesFromCacheAtStart = _file->bytesFromCache();
 	_stage = Stage::Initializing;
 	_file->start(delegate(), _options.position);
 }
@@ -625,6 +629,10 @@ bool Player::receivedTillEnd() const {
 void Player::checkResumeFromWaitingForData() {
 	if (_pausedByWaitingForData && bothReceivedEnough(kBufferFor)) {
 		_pausedByWaitingForData = false;
+		if (_stallStartedTime != kTimeUnknown) {
+			_stats.stalledDuration += crl::now() - _stallStartedTime;
+			_stallStartedTime = kTimeUnknown;
+		}
 		updatePausedState();
 		_updates.fire({ WaitingForData{ false } });
 	}
@@ -642,6 +650,10 @@ void Player::start() {
 	) | rpl::filter([=] {
 		return !bothReceivedEnough(kBufferFor);
 	}) | rpl::start_with_next([=] {
+		if (!_pausedByWaitingForData) {
+			++_stats.stalls;
+			_stallStartedTime = crl::now();
+		}
 		_pausedByWaitingForData = true;
 		updatePausedState();
 		_updates.fire({ WaitingForData{ true } });
@@ -680,6 +692,13 @@ void Player::start() {
 		}) | rpl::start_with_next([=] {
 			checkVideoStep();
 		}, _sessionLifetime);
+
+		base::FrameClock::Instance().ticks(
+		) | rpl::filter([=] {
+			return !_videoFinished && (_nextFrameTime != kTimeUnknown);
+		}) | rpl::start_with_next([=] {
+			checkNextFrameRender();
+		}, _sessionLifetime);
 	}
 	if (guard && _audio) {
 		trackSendReceivedTill(*_audio, _information.audio.state);
@@ -697,7 +716,36 @@ void Player::checkVideoStep() {
 	}
 }
 
+void Player::finishStats() {
+	if (_stallStartedTime != kTimeUnknown) {
+		_stats.stalledDuration += crl::now() - _stallStartedTime;
+		_stallStartedTime = kTimeUnknown;
+	}
+	_stats.bytesFromNetwork = _file->bytesFromNetwork()
+		- _bytesFromNetworkAtStart;
+	_stats.bytesFromCache = _file->bytesFromCache()
+		- _bytesFromCacheAtStart;
+	if (_video) {
+		_video->fillStats(_stats);
+	}
+	DEBUG_LOG(("Streaming Info: First frame %1 ms, "
+		"stalls %2 (%3 ms), network %4, cache %5, "
+		"frames %6 (%7 dropped, %8 ms decoding)."
+		).arg(_stats.firstFrameDelay
+		).arg(_stats.stalls
+		).arg(_stats.stalledDuration
+		).arg(_stats.bytesFromNetwork
+		).arg(_stats.bytesFromCache
+		).arg(_stats.framesDecoded
+		).arg(_stats.framesDropped
+		).arg(_stats.decodeDuration));
+	_statsUpdates.fire_copy(_stats);
+}
+
 void Player::stop(bool stillActive) {
+	if (_stage != Stage::Uninitialized) {
+		finishStats();
+	}
 	_file->stop(stillActive);
 	_sessionLifetime = rpl::lifetime();
 	_stage = Stage::Uninitialized;
@@ -705,7 +753,6 @@ void Player::stop(bool stillActive) {
 	_video = nullptr;
 	invalidate_weak_ptrs(&_sessionGuard);
 	_pausedByUser = _pausedByWaitingForData = _paused = false;
-	_renderFrameTimer.cancel();
 	_nextFrameTime = kTimeUnknown;
 	_audioFinished = false;
 	_videoFinished = false;
@@ -784,6 +831,10 @@ rpl::producer<bool> Player::fullInCache() const {
 	return _fullInCache.events();
 }
 
+rpl::producer<PlaybackStats> Player::stats() const {
+	return _statsUpdates.events();
+}
+
 QSize Player::videoSize() const {
 	return _information.video.size;
 }
@@ -10,7 +10,6 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "media/streaming/media_streaming_common.h"
 #include "media/streaming/media_streaming_file_delegate.h"
 #include "base/weak_ptr.h"
-#include "base/timer.h"
 
 namespace Data {
 class Session;
@@ -59,6 +58,9 @@ public:
 	[[nodiscard]] rpl::producer<Update, Error> updates() const;
 	[[nodiscard]] rpl::producer<bool> fullInCache() const;
 
+	// Fired with the final values when the playback is stopped.
+	[[nodiscard]] rpl::producer<PlaybackStats> stats() const;
+
 	[[nodiscard]] QSize videoSize() const;
 	[[nodiscard]] QImage frame(const FrameRequest &request) const;
 
@@ -93,6 +95,7 @@ private:
 	void start();
 	void stop(bool stillActive);
 	void provideStartInformation();
+	void finishStats();
 	void fail(Error error);
 	void checkVideoStep();
 	void checkNextFrameRender();
@@ -176,11 +179,17 @@ private:
 	crl::time _startedTime = kTimeUnknown;
 	crl::time _pausedTime = kTimeUnknown;
 	crl::time _nextFrameTime = kTimeUnknown;
-	base::Timer _renderFrameTimer;
 	rpl::event_stream<Update, Error> _updates;
 	rpl::event_stream<bool> _fullInCache;
 	std::optional<bool> _fullInCacheSinceStart;
 
+	PlaybackStats _stats;
+	rpl::event_stream<PlaybackStats> _statsUpdates;
+	crl::time _playRequestedTime = kTimeUnknown;
+	crl::time _stallStartedTime = kTimeUnknown;
+	int64 _bytesFromNetworkAtStart = 0;
+	int64 _bytesFromCacheAtStart = 0;
+
 	crl::time _totalDuration = kTimeUnknown;
 	crl::time _loopingShift = 0;
 	crl::time _previousReceivedTill = kTimeUnknown;
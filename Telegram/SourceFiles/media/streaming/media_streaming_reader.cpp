@@ -10,6 +10,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "media/streaming/media_streaming_common.h"
 #include "media/streaming/media_streaming_loader.h"
 #include "storage/cache/storage_cache_database.h"
+#include "base/memory_usage.h"
 
 namespace Media {
 namespace Streaming {
@@ -21,12 +22,27 @@ constexpr auto kInSlice = kPartsInSlice * kPartSize;
 constexpr auto kMaxPartsInHeader = 64;
 constexpr auto kMaxOnlyInHeader = 80 * kPartSize;
 constexpr auto kPartsOutsideFirstSliceGood = 8;
-constexpr auto kSlicesInMemory = 2;
 
-// 1 MB of parts are requested from cloud ahead of reading demand.
-constexpr auto kPreloadPartsAhead = 8;
+// Least recently used slices are unloaded when they take more memory than
+// that, the first slice with the container header always stays loaded.
+constexpr auto kSlicesInMemoryMin = 2;
+constexpr auto kSlicesInMemoryLimit = 4 * kInSlice;
+
+// 2 MB of parts are requested from cloud ahead of reading demand, so that
+// the loader can keep more requests in flight on a fast link.
+constexpr auto kPreloadPartsAhead = 16;
+
+base::memory_usage::Counter SlicesMemory("Media::Streaming slices");
 constexpr auto kDownloaderRequestsLimit = 4;
 
+// 512 KB are enough for the header and a few seconds of a voice message
+// or a round video, so that the next playlist item starts without a gap.
+constexpr auto kPrefetchParts = 4;
+
+// Slice numbers take the low byte of the cache key, the last value is
+// used for the seek index if the file has less slices than that.
+constexpr auto kSeekIndexSliceNumber = 0xFF;
+
 using PartsMap = base::flat_map<int, QByteArray>;
 
 struct ParsedCacheEntry {
@@ -225,6 +241,7 @@ struct Reader::CacheHelper {
 	QMutex mutex;
 	base::flat_map<int, PartsMap> results;
 	std::vector<int> sizes;
+	QByteArray seekIndex;
 	std::atomic<crl::semaphore*> waiting = nullptr;
 };
 
@@ -450,6 +467,12 @@ void Reader::Slices::processCacheResult(int sliceNumber, PartsMap &&result) {
 	}
 	slice.processCacheData(std::move(result));
 	checkSliceFullLoaded(sliceNumber);
+	if (sliceNumber
+		&& (ranges::find(_usedSlices, sliceNumber - 1)
+			== end(_usedSlices))) {
+		// Read ahead slices should be the first to be unloaded if unused.
+		_usedSlices.push_front(sliceNumber - 1);
+	}
 	if (!sliceNumber) {
 		applyHeaderCacheData();
 		if (isGoodHeader()) {
@@ -591,6 +614,18 @@ auto Reader::Slices::fill(int offset, bytes::span buffer) -> FillResult {
 			result.sliceNumbersFromCache.add(sliceIndex + 1);
 		}
 	};
+	const auto handleReadAhead = [&] {
+		if (_lastFillSlice >= 0 && _lastFillSlice != fromSlice) {
+			_readingBackward = (fromSlice < _lastFillSlice);
+		}
+		_lastFillSlice = fromSlice;
+		const auto ahead = _readingBackward ? (fromSlice - 1) : tillSlice;
+		if (ahead >= 0
+			&& ahead < _data.size()
+			&& (_data[ahead].flags & Flag::FullInCache)) {
+			handleReadFromCache(ahead);
+		}
+	};
 	const auto firstFrom = offset - fromSlice * kInSlice;
 	const auto firstTill = std::min(kInSlice, till - fromSlice * kInSlice);
 	const auto secondFrom = 0;
@@ -620,6 +655,7 @@ auto Reader::Slices::fill(int offset, bytes::span buffer) -> FillResult {
 		}
 		result.toCache = serializeAndUnloadUnused();
 		result.filled = true;
+		handleReadAhead();
 	} else {
 		handleReadFromCache(fromSlice);
 		if (fromSlice + 1 < tillSlice) {
@@ -699,40 +735,49 @@ int Reader::Slices::maxSliceSize(int sliceNumber) const {
 	return MaxSliceSize(sliceNumber, _size);
 }
 
+int Reader::Slices::unpinnedSlicesMemory() const {
+	auto result = 0;
+	for (const auto sliceIndex : _usedSlices) {
+		if (sliceIndex > 0) {
+			result += _data[sliceIndex].parts.size() * kPartSize;
+		}
+	}
+	return result;
+}
+
+bool Reader::Slices::unloadRequired() const {
+	const auto unpinned = int(_usedSlices.size())
+		- ((ranges::find(_usedSlices, 0) != end(_usedSlices)) ? 1 : 0);
+	return (unpinned > kSlicesInMemoryMin)
+		&& (unpinnedSlicesMemory() > kSlicesInMemoryLimit);
+}
+
 Reader::SerializedSlice Reader::Slices::serializeAndUnloadUnused() {
 	using Flag = Slice::Flag;
 
-	if (_headerMode == HeaderMode::Unknown
-		|| _usedSlices.size() <= kSlicesInMemory) {
-		return {};
-	}
-	const auto purgeSlice = _usedSlices.front();
-	_usedSlices.pop_front();
-	if (!(_data[purgeSlice].flags & Flag::LoadedFromCache)) {
-		// If the only data in this slice was from _header, just leave it.
+	if (_headerMode == HeaderMode::Unknown) {
 		return {};
 	}
-	const auto noNeedToSaveToCache = [&] {
-		if (_headerMode == HeaderMode::NoCache) {
-			// Cache is not used.
-			return true;
-		} else if (!(_data[purgeSlice].flags & Flag::ChangedSinceCache)) {
-			// If no data was changed we should still save first slice,
-			// if header data was changed since loading from cache.
-			// Otherwise in destructor we won't be able to unload header.
-			if (!isGoodHeader()
-				|| (purgeSlice > 0)
-				|| (!(_header.flags & Flag::ChangedSinceCache))) {
-				return true;
-			}
+	while (unloadRequired()) {
+		const auto i = ranges::find_if(_usedSlices, [](int sliceIndex) {
+			return (sliceIndex > 0);
+		});
+		Assert(i != end(_usedSlices));
+		const auto purgeSlice = *i;
+		_usedSlices.erase(i);
+		if (!(_data[purgeSlice].flags & Flag::LoadedFromCache)) {
+			// If the only data in this slice was from _header, just leave it.
+			continue;
 		}
-		return false;
-	}();
-	if (noNeedToSaveToCache) {
-		unloadSlice(_data[purgeSlice]);
-		return {};
+		const auto noNeedToSaveToCache = (_headerMode == HeaderMode::NoCache)
+			|| !(_data[purgeSlice].flags & Flag::ChangedSinceCache);
+		if (noNeedToSaveToCache) {
+			unloadSlice(_data[purgeSlice]);
+			continue;
+		}
+		return serializeAndUnloadSlice(purgeSlice + 1);
 	}
-	return serializeAndUnloadSlice(purgeSlice + 1);
+	return {};
 }
 
 Reader::SerializedSlice Reader::Slices::serializeAndUnloadSlice(
@@ -828,6 +873,14 @@ QByteArray Reader::Slices::serializeAndUnloadFirstSliceNoHeader() {
 	return result;
 }
 
+int64 Reader::Slices::memoryBytes() const {
+	auto result = int64(_header.parts.size());
+	for (const auto &slice : _data) {
+		result += slice.parts.size();
+	}
+	return result * kPartSize;
+}
+
 Reader::SerializedSlice Reader::Slices::unloadToCache() {
 	if (_headerMode == HeaderMode::Unknown
 		|| _headerMode == HeaderMode::NoCache) {
@@ -851,12 +904,14 @@ Reader::Reader(
 , _loader(std::move(loader))
 , _cacheHelper(InitCacheHelper(_loader->baseCacheKey()))
 , _slices(_loader->size(), _cacheHelper != nullptr) {
+	SlicesMemory.add(0);
+
 	_loader->parts(
 	) | rpl::start_with_next([=](LoadedPart &&part) {
 		if (_attachedDownloader) {
 			_partsForDownloader.fire_copy(part);
 		}
-		if (_streamingActive) {
+		if (_streamingActive || _prefetching) {
 			_loadedParts.emplace(std::move(part));
 		}
 		if (const auto waiting = _waiting.load(std::memory_order_acquire)) {
@@ -867,6 +922,7 @@ Reader::Reader(
 
 	if (_cacheHelper) {
 		readFromCache(0);
+		readSeekIndexFromCache();
 	}
 }
 
@@ -886,8 +942,27 @@ void Reader::stopSleep() {
 	_sleeping.store(nullptr, std::memory_order_release);
 }
 
+void Reader::prefetch() {
+	if (_streamingActive || _prefetching) {
+		return;
+	}
+
+	// No streaming thread works with this reader, so we can process the
+	// header cache result here to find out if anything should be loaded.
+	processCacheResults();
+	if (_slices.waitingForHeaderCache() || !_slices.headerModeUnknown()) {
+		return;
+	}
+	_prefetching = true;
+	const auto till = std::min(kPrefetchParts * kPartSize, size());
+	for (auto offset = 0; offset < till; offset += kPartSize) {
+		loadAtOffset(offset);
+	}
+}
+
 void Reader::startStreaming() {
 	_streamingActive = true;
+	_prefetching = false;
 }
 
 void Reader::stopStreaming(bool stillActive) {
@@ -1160,6 +1235,53 @@ void Reader::putToCache(SerializedSlice &&slice) {
 	_cache->put(_cacheHelper->key(slice.number), std::move(slice.data));
 }
 
+int64 Reader::bytesFromNetwork() const {
+	return _bytesFromNetwork.load(std::memory_order_relaxed);
+}
+
+int64 Reader::bytesFromCache() const {
+	return _bytesFromCache.load(std::memory_order_relaxed);
+}
+
+bool Reader::seekIndexCacheAllowed() const {
+	return _cacheHelper
+		&& (SlicesCount(_loader->size()) < kSeekIndexSliceNumber);
+}
+
+void Reader::readSeekIndexFromCache() {
+	if (!seekIndexCacheAllowed()) {
+		return;
+	}
+	const auto cache = std::weak_ptr<CacheHelper>(_cacheHelper);
+	_cache->get(
+		_cacheHelper->key(kSeekIndexSliceNumber),
+		[=](QByteArray &&result) {
+			if (const auto strong = cache.lock()) {
+				QMutexLocker lock(&strong->mutex);
+				strong->seekIndex = std::move(result);
+			}
+		});
+}
+
+QByteArray Reader::seekIndex() const {
+	if (!seekIndexCacheAllowed()) {
+		return QByteArray();
+	}
+	QMutexLocker lock(&_cacheHelper->mutex);
+	return _cacheHelper->seekIndex;
+}
+
+void Reader::putSeekIndex(QByteArray &&data) {
+	if (!seekIndexCacheAllowed()) {
+		return;
+	}
+	{
+		QMutexLocker lock(&_cacheHelper->mutex);
+		_cacheHelper->seekIndex = data;
+	}
+	_cache->put(_cacheHelper->key(kSeekIndexSliceNumber), std::move(data));
+}
+
 int Reader::size() const {
 	return _loader->size();
 }
@@ -1228,6 +1350,7 @@ bool Reader::fillFromSlices(int offset, bytes::span buffer) {
 	using namespace rpl::mappers;
 
 	auto result = _slices.fill(offset, buffer);
+	updateMemoryUsage();
 	if (!result.filled && _slices.headerWontBeFilled()) {
 		_streamingError = Error::NotStreamable;
 		return false;
@@ -1297,6 +1420,9 @@ bool Reader::processCacheResults() {
 		return false;
 	}
 	for (auto &[sliceNumber, result] : loaded) {
+		for (const auto &[offset, part] : result) {
+			_bytesFromCache += part.size();
+		}
 		_slices.processCacheResult(sliceNumber, std::move(result));
 	}
 	if (!sizes.empty()) {
@@ -1324,6 +1450,7 @@ bool Reader::processLoadedParts() {
 		} else if (!_loadingOffsets.remove(part.offset)) {
 			continue;
 		}
+		_bytesFromNetwork += part.bytes.size();
 		_slices.processPart(
 			part.offset,
 			std::move(part.bytes));
@@ -1334,9 +1461,16 @@ bool Reader::processLoadedParts() {
 bool Reader::checkForSomethingMoreReceived() {
 	const auto result1 = processCacheResults();
 	const auto result2 = processLoadedParts();
+	updateMemoryUsage();
 	return result1 || result2;
 }
 
+void Reader::updateMemoryUsage() {
+	const auto now = _slices.memoryBytes();
+	SlicesMemory.add(now - _memoryBytes, 0);
+	_memoryBytes = now;
+}
+
 void Reader::loadAtOffset(int offset) {
 	if (_loadingOffsets.add(offset)) {
 		_loader->load(offset);
@@ -1361,6 +1495,7 @@ void Reader::finalizeCache() {
 
 Reader::~Reader() {
 	finalizeCache();
+	SlicesMemory.remove(_memoryBytes);
 }
 
 } // namespace Streaming
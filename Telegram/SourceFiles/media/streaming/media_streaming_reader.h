@@ -56,7 +56,17 @@ public:
 	void wakeFromSleep();
 	void stopSleep();
 
+	// Totals for all the streaming sessions of this reader.
+	[[nodiscard]] int64 bytesFromNetwork() const;
+	[[nodiscard]] int64 bytesFromCache() const;
+
+	// Demuxer seek index saved when this file was streamed last time.
+	[[nodiscard]] QByteArray seekIndex() const;
+	void putSeekIndex(QByteArray &&data);
+
 	// Main thread.
+	// Loads the first parts of a file that is going to be played soon.
+	void prefetch();
 	void startStreaming();
 	void stopStreaming(bool stillActive = false);
 	[[nodiscard]] rpl::producer<LoadedPart> partsForDownloader() const;
@@ -69,7 +79,7 @@ public:
 	~Reader();
 
 private:
-	static constexpr auto kLoadFromRemoteMax = 8;
+	static constexpr auto kLoadFromRemoteMax = 16;
 
 	struct CacheHelper;
 
@@ -91,7 +101,7 @@ private:
 		QByteArray data;
 	};
 	struct FillResult {
-		static constexpr auto kReadFromCacheMax = 2;
+		static constexpr auto kReadFromCacheMax = 3;
 
 		StackIntVector<kReadFromCacheMax> sliceNumbersFromCache;
 		StackIntVector<kLoadFromRemoteMax> offsetsFromLoader;
@@ -155,6 +165,8 @@ private:
 		[[nodiscard]] QByteArray partForDownloader(int offset) const;
 		[[nodiscard]] bool readCacheForDownloaderRequired(int offset);
 
+		[[nodiscard]] int64 memoryBytes() const;
+
 	private:
 		enum class HeaderMode {
 			Unknown,
@@ -169,6 +181,8 @@ private:
 		[[nodiscard]] SerializedSlice serializeAndUnloadSlice(
 			int sliceNumber);
 		[[nodiscard]] SerializedSlice serializeAndUnloadUnused();
+		[[nodiscard]] int unpinnedSlicesMemory() const;
+		[[nodiscard]] bool unloadRequired() const;
 		[[nodiscard]] QByteArray serializeComplexSlice(
 			const Slice &slice) const;
 		[[nodiscard]] QByteArray serializeAndUnloadFirstSliceNoHeader();
@@ -185,6 +199,8 @@ private:
 		Slice _header;
 		std::deque<int> _usedSlices;
 		int _size = 0;
+		int _lastFillSlice = -1;
+		bool _readingBackward = false;
 		HeaderMode _headerMode = HeaderMode::Unknown;
 		bool _fullInCache = false;
 
@@ -196,6 +212,8 @@ private:
 	[[nodiscard]] bool readFromCacheForDownloader(int sliceNumber);
 	bool processCacheResults();
 	void putToCache(SerializedSlice &&data);
+	void readSeekIndexFromCache();
+	[[nodiscard]] bool seekIndexCacheAllowed() const;
 
 	void cancelLoadInRange(int from, int till);
 	void loadAtOffset(int offset);
@@ -203,6 +221,7 @@ private:
 	bool processLoadedParts();
 
 	bool checkForSomethingMoreReceived();
+	void updateMemoryUsage();
 
 	bool fillFromSlices(int offset, bytes::span buffer);
 
@@ -226,11 +245,14 @@ private:
 	const std::shared_ptr<CacheHelper> _cacheHelper;
 
 	base::thread_safe_queue<LoadedPart, std::vector> _loadedParts;
+	std::atomic<int64> _bytesFromNetwork = 0;
+	std::atomic<int64> _bytesFromCache = 0;
 	std::atomic<crl::semaphore*> _waiting = nullptr;
 	std::atomic<crl::semaphore*> _sleeping = nullptr;
 	PriorityQueue _loadingOffsets;
 
 	Slices _slices;
+	int64 _memoryBytes = 0;
 
 	// Even if streaming had failed, the Reader can work for the downloader.
 	std::optional<Error> _streamingError;
@@ -242,6 +264,7 @@ private:
 	Storage::StreamedFileDownloader *_attachedDownloader = nullptr;
 	rpl::event_stream<LoadedPart> _partsForDownloader;
 	bool _streamingActive = false;
+	bool _prefetching = false;
 
 	// Streaming thread.
 	std::deque<int> _offsetsForDownloader;
@@ -103,6 +103,13 @@ QImage ConvertFrame(
 		QImage storage) {
 	Expects(frame != nullptr);
 
+	if (frame->hw_frames_ctx) {
+		if (!FFmpeg::TransferHwFrame(frame, stream.transferredFrame)) {
+			return QImage();
+		}
+		FFmpeg::ClearFrameMemory(frame);
+		frame = stream.transferredFrame.get();
+	}
 	const auto frameSize = QSize(frame->width, frame->height);
 	if (frameSize.isEmpty()) {
 		LOG(("Streaming Error: Bad frame size %1,%2"
@@ -183,7 +190,19 @@ QImage PrepareByRequest(
 	if (!FFmpeg::GoodStorageForFrame(storage, request.outer)) {
 		storage = FFmpeg::CreateFrameStorage(request.outer);
 	}
-	{
+	if (original.size() == request.outer) {
+		// Frame was already converted to the right size, only round it.
+		const auto perLine = std::min(
+			original.bytesPerLine(),
+			storage.bytesPerLine());
+		auto from = original.constBits();
+		auto to = storage.bits();
+		for (auto y = 0, height = original.height(); y != height; ++y) {
+			memcpy(to, from, perLine);
+			from += original.bytesPerLine();
+			to += storage.bytesPerLine();
+		}
+	} else {
 		Painter p(&storage);
 		PainterHighQualityEnabler hq(p);
 		p.drawImage(QRect(QPoint(), request.outer), original);
@@ -265,6 +265,7 @@ crl::time VideoTrackObject::computeDuration() const {
 }
 
 auto VideoTrackObject::readFrame(not_null<Frame*> frame) -> FrameResult {
+	const auto started = crl::now();
 	if (const auto error = ReadNextFrame(_stream)) {
 		if (error.code() == AVERROR_EOF) {
 			if (!_options.loop) {
@@ -293,6 +294,7 @@ auto VideoTrackObject::readFrame(not_null<Frame*> frame) -> FrameResult {
 	std::swap(frame->decoded, _stream.frame);
 	frame->position = position;
 	frame->displayed = kTimeUnknown;
+	_shared->frameDecoded(crl::now() - started);
 	return FrameResult::Done;
 }
 
@@ -572,6 +574,7 @@ auto VideoTrack::Shared::prepareState(
 		} else if (IsStale(frame, trackTime)) {
 			std::swap(*frame, *next);
 			next->displayed = kDisplaySkipped;
+			++_framesDropped;
 			return next;
 		} else {
 			return PrepareNextCheck(frame->position - trackTime + 1);
@@ -716,6 +719,17 @@ crl::time VideoTrack::Shared::markFrameDisplayed(crl::time now) {
 	Unexpected("Counter value in VideoTrack::Shared::markFrameDisplayed.");
 }
 
+void VideoTrack::Shared::frameDecoded(crl::time duration) {
+	++_framesDecoded;
+	_decodeDuration += duration;
+}
+
+void VideoTrack::Shared::fillStats(PlaybackStats &stats) const {
+	stats.framesDecoded = _framesDecoded.load(std::memory_order_relaxed);
+	stats.framesDropped = _framesDropped.load(std::memory_order_relaxed);
+	stats.decodeDuration = _decodeDuration.load(std::memory_order_relaxed);
+}
+
 not_null<VideoTrack::Frame*> VideoTrack::Shared::frameForPaint() {
 	const auto result = getFrame(counter() / 2);
 	Assert(!result->original.isNull());
@@ -852,6 +866,10 @@ rpl::producer<> VideoTrack::checkNextFrame() const {
 	});
 }
 
+void VideoTrack::fillStats(PlaybackStats &stats) const {
+	_shared->fillStats(stats);
+}
+
 rpl::producer<> VideoTrack::waitingForData() const {
 	return _wrapped.producer_on_main([](const Implementation &unwrapped) {
 		return unwrapped.waitingForData();
@@ -51,6 +51,7 @@ public:
 	[[nodiscard]] QImage frame(const FrameRequest &request);
 	[[nodiscard]] rpl::producer<> checkNextFrame() const;
 	[[nodiscard]] rpl::producer<> waitingForData() const;
+	void fillStats(PlaybackStats &stats) const;
 
 	// Called from the main thread.
 	~VideoTrack();
@@ -104,6 +105,10 @@ private:
 		[[nodiscard]] crl::time nextFrameDisplayTime() const;
 		[[nodiscard]] not_null<Frame*> frameForPaint();
 
+		// Called from the wrapped object queue, read from any thread.
+		void frameDecoded(crl::time duration);
+		void fillStats(PlaybackStats &stats) const;
+
 	private:
 		[[nodiscard]] not_null<Frame*> getFrame(int index);
 		[[nodiscard]] not_null<const Frame*> getFrame(int index) const;
@@ -115,6 +120,10 @@ private:
 		static constexpr auto kFramesCount = 4;
 		std::array<Frame, kFramesCount> _frames;
 
+		std::atomic<int> _framesDecoded = 0;
+		std::atomic<int> _framesDropped = 0;
+		std::atomic<crl::time> _decodeDuration = 0;
+
 	};
 
 	static QImage PrepareFrameByRequest(
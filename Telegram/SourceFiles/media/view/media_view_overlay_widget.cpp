@@ -57,6 +57,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <QtWidgets/QDesktopWidget>
 #include <QtCore/QBuffer>
 #include <QtGui/QGuiApplication>
+#include <QtGui/QImageReader>
 #include <QtGui/QClipboard>
 #include <QtGui/QWindow>
 #include <QtGui/QScreen>
@@ -81,6 +82,48 @@ constexpr auto kIdsLimit = 48;
 // Preload next messages if we went further from current than that.
 constexpr auto kIdsPreloadAfter = 28;
 
+// Decode the partially loaded large photo each time that much more arrives.
+constexpr auto kPartialDecodeStep = 32 * 1024;
+
+// Only progressive scans give a useful picture of the whole photo,
+// a truncated baseline image is just its top part over a gray fill.
+bool IsProgressiveJpeg(const QByteArray &bytes) {
+	const auto data = reinterpret_cast<const uchar*>(bytes.constData());
+	const auto size = bytes.size();
+	if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) {
+		return false;
+	}
+	auto offset = 2;
+	while (offset + 4 <= size) {
+		if (data[offset] != 0xFF) {
+			return false;
+		}
+		const auto marker = data[offset + 1];
+		if (marker == 0xC2 || marker == 0xCA) {
+			return true;
+		} else if (marker >= 0xC0
+			&& marker <= 0xCF
+			&& marker != 0xC4
+			&& marker != 0xC8
+			&& marker != 0xCC) {
+			return false;
+		}
+		offset += 2 + ((int(data[offset + 2]) << 8) | data[offset + 3]);
+	}
+	return false;
+}
+
+QImage DecodePartialImage(const QByteArray &bytes, QSize size) {
+	auto buffer = QBuffer();
+	buffer.setData(bytes);
+	auto reader = QImageReader(&buffer, "JPG");
+	reader.setScaledSize(size);
+	auto result = reader.read();
+	return (result.size() == size)
+		? result.convertToFormat(QImage::Format_ARGB32_Premultiplied)
+		: QImage();
+}
+
 Images::Options VideoThumbOptions(not_null<DocumentData*> document) {
 	const auto result = Images::Option::Smooth | Images::Option::Blurred;
 	return (document && document->isVideoMessage())
@@ -381,12 +424,17 @@ bool OverlayWidget::videoIsGifv() const {
 }
 
 QImage OverlayWidget::videoFrame() const {
-	Expects(videoShown());
-
 	auto request = Streaming::FrameRequest();
 	//request.radius = (_doc && _doc->isVideoMessage())
 	//	? ImageRoundRadius::Ellipse
 	//	: ImageRoundRadius::None;
+	return videoFrame(request);
+}
+
+QImage OverlayWidget::videoFrame(
+		const Streaming::FrameRequest &request) const {
+	Expects(videoShown());
+
 	return _streamed->player.ready()
 		? _streamed->player.frame(request)
 		: _streamed->info.video.cover;
@@ -395,7 +443,18 @@ QImage OverlayWidget::videoFrame() const {
 QImage OverlayWidget::videoFrameForDirectPaint() const {
 	Expects(_streamed != nullptr);
 
-	const auto result = videoFrame();
+	// Let the decoder scale the frame down right to the painted size,
+	// so that we don't scale the full frame once more while painting.
+	auto request = Streaming::FrameRequest();
+	const auto size = contentRect().size() * cIntRetinaFactor();
+	const auto rotation = _streamed->info.video.rotation;
+	if ((rotation == 0 || rotation == 180)
+		&& size.width() < videoSize().width()
+		&& size.height() < videoSize().height()
+		&& !size.isEmpty()) {
+		request.resize = request.outer = size;
+	}
+	const auto result = videoFrame(request);
 
 #ifdef USE_OPENGL_OVERLAY_WIDGET
 	const auto bytesPerLine = result.bytesPerLine();
@@ -1801,6 +1860,8 @@ void OverlayWidget::displayPhoto(not_null<PhotoData*> photo, HistoryItem *item)
 	Auth().downloader().clearPriorities();
 	_blurred = true;
 	_current = QPixmap();
+	_partialDecoding = nullptr;
+	_partialDecodedSize = 0;
 	_down = OverNone;
 	_w = style::ConvertScale(photo->width());
 	_h = style::ConvertScale(photo->height());
@@ -2532,6 +2593,40 @@ void OverlayWidget::validatePhotoCurrentImage() {
 	if (_current.isNull()) {
 		_photo->loadThumbnailSmall(fileOrigin());
 	}
+	if (_blurred) {
+		validatePhotoPartialImage();
+	}
+}
+
+void OverlayWidget::validatePhotoPartialImage() {
+	const auto large = _photo->large();
+	if (_partialDecoding || large->loaded() || !large->loading()) {
+		return;
+	}
+	auto bytes = large->loadedBytes();
+	if (bytes.size() < _partialDecodedSize + kPartialDecodeStep
+		|| !IsProgressiveJpeg(bytes)) {
+		return;
+	}
+	_partialDecodedSize = bytes.size();
+
+	const auto photo = _photo;
+	const auto size = QSize(_width, _height) * cIntRetinaFactor();
+	auto guard = _partialDecoding.make_guard();
+	crl::async([=, bytes = std::move(bytes), guard = std::move(guard)]() mutable {
+		auto image = DecodePartialImage(bytes, size);
+		crl::on_main(std::move(guard), [=, image = std::move(image)]() mutable {
+			_partialDecoding = nullptr;
+			if (image.isNull() || _photo != photo || !_blurred) {
+				return;
+			} else if (photo->large()->loaded()) {
+				return;
+			}
+			_current = App::pixmapFromImageInPlace(std::move(image));
+			_current.setDevicePixelRatio(cRetinaFactor());
+			update(contentRect());
+		});
+	});
 }
 
 void OverlayWidget::paintEvent(QPaintEvent *e) {
@@ -3269,6 +3364,9 @@ void OverlayWidget::preloadData(int delta) {
 		}
 	}
 
+	const auto priority = Storage::LoadPriorityScope(
+		&Auth().downloader(),
+		Storage::LoadPriority::Prefetch);
 	for (auto index = from; index != till; ++index) {
 		auto entity = entityByIndex(index);
 		if (auto photo = base::get_if<not_null<PhotoData*>>(&entity.data)) {
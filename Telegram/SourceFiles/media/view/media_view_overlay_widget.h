@@ -7,6 +7,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #pragma once
 
+#include "base/binary_guard.h"
 #include "ui/rp_widget.h"
 #include "ui/widgets/dropdown_menu.h"
 #include "ui/effects/animations.h"
@@ -313,11 +314,14 @@ private:
 
 	void validatePhotoImage(Image *image, bool blurred);
 	void validatePhotoCurrentImage();
+	void validatePhotoPartialImage();
 
 	[[nodiscard]] bool videoShown() const;
 	[[nodiscard]] QSize videoSize() const;
 	[[nodiscard]] bool videoIsGifv() const;
 	[[nodiscard]] QImage videoFrame() const;
+	[[nodiscard]] QImage videoFrame(
+		const Streaming::FrameRequest &request) const;
 	[[nodiscard]] QImage videoFrameForDirectPaint() const;
 	[[nodiscard]] QImage transformVideoFrame(QImage frame) const;
 	[[nodiscard]] bool documentContentShown() const;
@@ -372,6 +376,10 @@ private:
 	QPixmap _current;
 	bool _blurred = true;
 
+	// Scans of a progressive large photo decoded while it is loading.
+	base::binary_guard _partialDecoding;
+	int _partialDecodedSize = 0;
+
 	std::unique_ptr<Streamed> _streamed;
 
 	const style::icon *_docIcon = nullptr;
@@ -133,6 +133,11 @@ void ConcurrentSender::RequestBuilder::setAfter(
 	_afterRequestId = requestId;
 }
 
+void ConcurrentSender::RequestBuilder::setPriority(
+		RequestPriority priority) noexcept {
+	_serialized->priority = priority;
+}
+
 mtpRequestId ConcurrentSender::RequestBuilder::send() {
 	const auto requestId = GetNextRequestId();
 	const auto dcId = _dcId;
@@ -71,6 +71,7 @@ class ConcurrentSender : public base::has_weak_ptr {
 		void setFailHandler(InvokeFullFail &&invoke) noexcept;
 		void setFailSkipPolicy(FailSkipPolicy policy) noexcept;
 		void setAfter(mtpRequestId requestId) noexcept;
+		void setPriority(RequestPriority priority) noexcept;
 
 	private:
 		not_null<ConcurrentSender*> _sender;
@@ -133,6 +134,8 @@ public:
 		[[nodiscard]] SpecificRequestBuilder &handleAllErrors() noexcept;
 		[[nodiscard]] SpecificRequestBuilder &afterRequest(
 			mtpRequestId requestId) noexcept;
+		[[nodiscard]] SpecificRequestBuilder &withPriority(
+			RequestPriority priority) noexcept;
 
 	private:
 		SpecificRequestBuilder(
@@ -445,6 +448,14 @@ auto ConcurrentSender::SpecificRequestBuilder<Request>::afterRequest(
 	return *this;
 }
 
+template <typename Request>
+auto ConcurrentSender::SpecificRequestBuilder<Request>::withPriority(
+	RequestPriority priority
+) noexcept -> SpecificRequestBuilder & {
+	setPriority(priority);
+	return *this;
+}
+
 inline void ConcurrentSender::SentRequestWrap::cancel() {
 	_sender->senderRequestCancel(_requestId);
 }
@@ -16,9 +16,12 @@ namespace MTP {
 namespace internal {
 namespace {
 
-constexpr auto kEnumerateDcTimeout = 8000; // 8 seconds timeout for help_getConfig to work (then move to other dc)
+constexpr auto kEnumerateDcTimeout = 4000; // 4 seconds timeout for help_getConfig to work (then add other dc)
 constexpr auto kSpecialRequestTimeoutMs = 6000; // 4 seconds timeout for it to work in a specially requested dc.
 
+// While enumerating dcs, requests to this many of them are kept alive.
+constexpr auto kMaxParallelEnumRequests = 3;
+
 } // namespace
 
 ConfigLoader::ConfigLoader(
@@ -58,12 +61,16 @@ DcId ConfigLoader::specialToRealDcId(DcId specialDcId) {
 	return getTemporaryIdFromRealDcId(specialDcId);
 }
 
-void ConfigLoader::terminateRequest() {
-	if (_enumRequest) {
-		_instance->cancel(base::take(_enumRequest));
+void ConfigLoader::terminateRequest(const EnumRequest &request) {
+	if (request.requestId) {
+		_instance->cancel(request.requestId);
 	}
-	if (_enumCurrent) {
-		_instance->killSession(MTP::configDcId(_enumCurrent));
+	_instance->killSession(MTP::configDcId(request.dcId));
+}
+
+void ConfigLoader::terminateRequests() {
+	for (const auto &request : base::take(_enumRequests)) {
+		terminateRequest(request);
 	}
 }
 
@@ -77,12 +84,11 @@ void ConfigLoader::terminateSpecialRequest() {
 }
 
 ConfigLoader::~ConfigLoader() {
-	terminateRequest();
+	terminateRequests();
 	terminateSpecialRequest();
 }
 
 void ConfigLoader::enumerate() {
-	terminateRequest();
 	if (!_enumCurrent) {
 		_enumCurrent = _instance->mainDcId();
 	}
@@ -95,7 +101,24 @@ void ConfigLoader::enumerate() {
 	} else {
 		_enumCurrent = *i;
 	}
-	_enumRequest = sendRequest(MTP::configDcId(_enumCurrent));
+
+	// Don't cancel the previous requests, the slow dc may still answer
+	// first, only the oldest one is dropped when there are too many.
+	const auto j = ranges::find(
+		_enumRequests,
+		_enumCurrent,
+		&EnumRequest::dcId);
+	if (j != end(_enumRequests)) {
+		terminateRequest(*j);
+		_enumRequests.erase(j);
+	} else if (int(_enumRequests.size()) >= kMaxParallelEnumRequests) {
+		terminateRequest(_enumRequests.front());
+		_enumRequests.erase(begin(_enumRequests));
+	}
+	_enumRequests.push_back({
+		_enumCurrent,
+		sendRequest(MTP::configDcId(_enumCurrent))
+	});
 
 	_enumDCTimer.callOnce(kEnumerateDcTimeout);
 
@@ -44,13 +44,21 @@ private:
 	void createSpecialLoader();
 	DcId specialToRealDcId(DcId specialDcId);
 	void specialConfigLoaded(const MTPConfig &result);
-	void terminateRequest();
+	void terminateRequests();
 	void terminateSpecialRequest();
 
+	struct EnumRequest {
+		DcId dcId = 0;
+		mtpRequestId requestId = 0;
+	};
+	void terminateRequest(const EnumRequest &request);
+
 	not_null<Instance*> _instance;
 	base::Timer _enumDCTimer;
 	DcId _enumCurrent = 0;
-	mtpRequestId _enumRequest = 0;
+
+	// Requests to several dcs race, the first config received wins.
+	std::vector<EnumRequest> _enumRequests;
 
 	struct SpecialEndpoint {
 		DcId dcId;
@@ -18,6 +18,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "lang/lang_keys.h"
 #include "base/openssl_help.h"
 #include "base/qthelp_url.h"
+#include "base/tracing.h"
 #include "base/unixtime.h"
 
 extern "C" {
@@ -57,6 +58,18 @@ constexpr auto kRequestConfigTimeout = crl::time(8000);
 // Don't try to handle messages larger than this size.
 constexpr auto kMaxMessageLength = 16 * 1024 * 1024;
 
+// Don't trust the gzip trailer for the initial unpacked buffer above this.
+constexpr auto kMaxUnpackedSizeHint = 64 * 1024 * 1024;
+
+// Not more than this is put in one container, the rest waits for the next.
+constexpr auto kMaxContainerMessages = 64;
+constexpr auto kMaxContainerSizeInInts = 1024 * 1024 / kIntSize;
+
+// All connections share from kMinConnectionThreads to kMaxConnectionThreads
+// threads, depending on the number of processor cores.
+constexpr auto kMinConnectionThreads = 2;
+constexpr auto kMaxConnectionThreads = 4;
+
 QString LogIdsVector(const QVector<MTPlong> &ids) {
 	if (!ids.size()) return "[]";
 	auto idsStr = QString("[%1").arg(ids.cbegin()->v);
@@ -222,11 +235,55 @@ ModExpFirst CreateModExp(
 	}
 }
 
+// A request can't go before the one it should be invoked after.
+RequestPriority EffectivePriority(const SecureRequest &request) {
+	auto result = request->priority;
+	for (auto after = request->after; after; after = after->after) {
+		result = std::min(result, after->priority);
+	}
+	return result;
+}
+
+// Takes requests for one container from toSend, higher priority first,
+// the same priority in the order they were sent. The others stay there.
+std::vector<SecureRequest> TakeContainerRequests(PreRequestMap &toSend) {
+	auto ordered = std::vector<std::pair<RequestPriority, SecureRequest>>();
+	ordered.reserve(toSend.size());
+	for (const auto &[requestId, request] : toSend) {
+		ordered.emplace_back(EffectivePriority(request), request);
+	}
+	ranges::stable_sort(ordered, std::greater<>(), [](const auto &entry) {
+		return entry.first;
+	});
+
+	auto result = std::vector<SecureRequest>();
+	result.reserve(std::min(int(ordered.size()), kMaxContainerMessages));
+	auto size = uint32(0);
+	for (const auto &entry : ordered) {
+		const auto messageSize = entry.second.messageSize();
+		if (!result.empty()
+			&& (int(result.size()) >= kMaxContainerMessages
+				|| size + messageSize > kMaxContainerSizeInInts)) {
+			break;
+		}
+		size += messageSize;
+		result.push_back(entry.second);
+	}
+	if (result.size() == ordered.size()) {
+		toSend.clear();
+	} else {
+		for (const auto &request : result) {
+			toSend.remove(request->requestId);
+		}
+	}
+	return result;
+}
+
 void wrapInvokeAfter(SecureRequest &to, const SecureRequest &from, const RequestMap &haveSent, int32 skipBeforeRequest = 0) {
 	const auto afterId = *(mtpMsgId*)(from->after->data() + 4);
-	const auto i = afterId ? haveSent.constFind(afterId) : haveSent.cend();
+	const auto i = afterId ? haveSent.find(afterId) : haveSent.cend();
 	int32 size = to->size(), lenInInts = (from.innerLength() >> 2), headlen = 4, fulllen = headlen + lenInInts;
-	if (i == haveSent.constEnd()) { // no invoke after or such msg was not sent or was completed recently
+	if (i == haveSent.cend()) { // no invoke after or such msg was not sent or was completed recently
 		to->resize(size + fulllen + skipBeforeRequest);
 		if (skipBeforeRequest) {
 			memcpy(to->data() + size, from->constData() + 4, headlen * sizeof(mtpPrime));
@@ -245,6 +302,54 @@ void wrapInvokeAfter(SecureRequest &to, const SecureRequest &from, const Request
 	}
 }
 
+// Reads serialized TL bytes in place, without copying them to QByteArray.
+bool ReadSerializedBytes(
+		const mtpPrime *from,
+		const mtpPrime *end,
+		bytes::const_span &result) {
+	if (from >= end) {
+		return false;
+	}
+	const auto first = reinterpret_cast<const uchar*>(from);
+	const auto available = size_type((end - from) * sizeof(mtpPrime));
+	auto length = size_type(first[0]);
+	auto offset = 1;
+	if (length == 254) {
+		length = size_type(first[1])
+			| (size_type(first[2]) << 8)
+			| (size_type(first[3]) << 16);
+		offset = 4;
+	} else if (length > 254) {
+		return false;
+	}
+	if (offset + length > available) {
+		return false;
+	}
+	result = bytes::make_span(first + offset, length);
+	return true;
+}
+
+// The gzip trailer keeps the unpacked size modulo 2^32, so in the usual
+// case the whole reply can be inflated into a buffer of the final size.
+int UnpackedSizeHintInInts(bytes::const_span packed) {
+	constexpr auto kGzipHeaderSize = 10;
+	constexpr auto kGzipTrailerSize = 8;
+	const auto fallback = int(packed.size() / sizeof(mtpPrime)) * 4 + 1;
+	if (packed.size() < kGzipHeaderSize + kGzipTrailerSize) {
+		return fallback;
+	}
+	const auto trailer = reinterpret_cast<const uchar*>(
+		packed.data() + packed.size() - 4);
+	const auto size = uint32(trailer[0])
+		| (uint32(trailer[1]) << 8)
+		| (uint32(trailer[2]) << 16)
+		| (uint32(trailer[3]) << 24);
+	if (!size || size > kMaxUnpackedSizeHint) {
+		return fallback;
+	}
+	return int(size / sizeof(mtpPrime)) + 1;
+}
+
 bool parsePQ(const QByteArray &pqStr, QByteArray &pStr, QByteArray &qStr) {
 	if (pqStr.length() > 8) return false; // more than 64 bit pq
 
@@ -289,39 +394,97 @@ bool parsePQ(const QByteArray &pqStr, QByteArray &pStr, QByteArray &qStr) {
 
 } // namespace
 
+ConnectionThreads::ConnectionThreads()
+: _limit(std::clamp(
+	QThread::idealThreadCount(),
+	kMinConnectionThreads,
+	kMaxConnectionThreads)) {
+}
+
+ConnectionThreads::~ConnectionThreads() {
+	for (const auto &entry : _threads) {
+		Assert(entry.connections == 0);
+
+		entry.thread->quit();
+	}
+	for (const auto &entry : _threads) {
+		entry.thread->wait();
+	}
+}
+
+std::shared_ptr<ConnectionThreads> ConnectionThreads::Get() {
+	static auto Weak = std::weak_ptr<ConnectionThreads>();
+	if (auto result = Weak.lock()) {
+		return result;
+	}
+	auto result = std::make_shared<ConnectionThreads>();
+	Weak = result;
+	return result;
+}
+
+not_null<QThread*> ConnectionThreads::acquire() {
+	const auto i = ranges::min_element(
+		_threads,
+		std::less<>(),
+		&Entry::connections);
+	if (i == end(_threads)
+		|| (i->connections > 0 && int(_threads.size()) < _limit)) {
+		_threads.push_back({ std::make_unique<Thread>(), 1 });
+		_threads.back().thread->start();
+		return _threads.back().thread.get();
+	}
+	++i->connections;
+	return i->thread.get();
+}
+
+void ConnectionThreads::release(not_null<QThread*> thread) {
+	const auto i = ranges::find(
+		_threads,
+		thread.get(),
+		[](const Entry &entry) { return entry.thread.get(); });
+	Assert(i != end(_threads) && i->connections > 0);
+
+	--i->connections;
+}
+
 Connection::Connection(not_null<Instance*> instance) : _instance(instance) {
 }
 
 void Connection::start(SessionData *sessionData, ShiftedDcId shiftedDcId) {
 	Expects(_thread == nullptr && _private == nullptr);
 
-	_thread = std::make_unique<Thread>();
+	_threads = ConnectionThreads::Get();
+	_thread = _threads->acquire();
 	auto newData = std::make_unique<ConnectionPrivate>(
 		_instance,
-		_thread.get(),
+		_thread,
 		this,
 		sessionData,
 		shiftedDcId);
 
-	// will be deleted in the thread::finished signal
+	// will be deleted in finishAndDestroy() after kill()
 	_private = newData.release();
-	_thread->start();
 }
 
 void Connection::kill() {
 	Expects(_private != nullptr && _thread != nullptr);
 
 	_private->stop();
-	_private = nullptr;
-	_thread->quit();
+	const auto connection = base::take(_private);
+	InvokeQueued(connection, [=] {
+		connection->finishAndDestroy();
+		_finished.release();
+	});
 }
 
 void Connection::waitTillFinish() {
 	Expects(_private == nullptr && _thread != nullptr);
 
-	DEBUG_LOG(("Waiting for connectionThread to finish"));
-	_thread->wait();
-	_thread.reset();
+	DEBUG_LOG(("Waiting for connection to finish"));
+	_finished.acquire();
+	_threads->release(_thread);
+	_thread = nullptr;
+	_threads = nullptr;
 }
 
 int32 Connection::state() const {
@@ -438,8 +601,7 @@ ConnectionPrivate::ConnectionPrivate(
 
 	moveToThread(thread);
 
-	connect(thread, &QThread::started, this, [=] { connectToServer(); });
-	connect(thread, &QThread::finished, this, [=] { finishAndDestroy(); });
+	InvokeQueued(this, [=] { connectToServer(); });
 	connect(this, SIGNAL(finished(internal::Connection*)), _instance, SLOT(connectionFinished(internal::Connection*)), Qt::QueuedConnection);
 
 	connect(sessionData->owner(), SIGNAL(authKeyCreated()), this, SLOT(updateAuthKey()), Qt::QueuedConnection);
@@ -533,17 +695,17 @@ void ConnectionPrivate::resetSession() { // recreate all msg_id and msg_seqno
 
 	auto newId = base::unixtime::mtproto_msg_id();
 	auto setSeqNumbers = RequestMap();
-	auto replaces = QMap<mtpMsgId, mtpMsgId>();
+	auto replaces = base::flat_map<mtpMsgId, mtpMsgId>();
 	for (auto i = haveSent.cbegin(), e = haveSent.cend(); i != e; ++i) {
-		if (!i.value().isSentContainer()) {
-			if (!*(mtpMsgId*)(i.value()->constData() + 4)) continue;
+		if (!i->second.isSentContainer()) {
+			if (!*(mtpMsgId*)(i->second->constData() + 4)) continue;
 
-			mtpMsgId id = i.key();
+			mtpMsgId id = i->first;
 			if (id > newId) {
 				while (true) {
-					if (toResend.constFind(newId) == toResend.cend()
-						&& wereAcked.constFind(newId) == wereAcked.cend()
-						&& haveSent.constFind(newId) == haveSent.cend()) {
+					if (toResend.find(newId) == toResend.cend()
+						&& wereAcked.find(newId) == wereAcked.cend()
+						&& haveSent.find(newId) == haveSent.cend()) {
 						break;
 					}
 					const auto m = base::unixtime::mtproto_msg_id();
@@ -555,27 +717,27 @@ void ConnectionPrivate::resetSession() { // recreate all msg_id and msg_seqno
 				MTP_LOG(_shiftedDcId, ("Replacing msgId %1 to %2!"
 					).arg(id
 					).arg(newId));
-				replaces.insert(id, newId);
+				replaces.insert_or_assign(id, newId);
 				id = newId;
-				*(mtpMsgId*)(i.value()->data() + 4) = id;
+				*(mtpMsgId*)(i->second->data() + 4) = id;
 			}
-			setSeqNumbers.insert(id, i.value());
+			setSeqNumbers.insert_or_assign(id, i->second);
 		}
 	}
 	// Collect all non-container requests.
 	for (auto i = toResend.cbegin(), e = toResend.cend(); i != e; ++i) {
-		const auto j = toSend.constFind(i.value());
+		const auto j = toSend.find(i->second);
 		if (j == toSend.cend()) continue;
 
-		if (!j.value().isSentContainer()) {
-			if (!*(mtpMsgId*)(j.value()->constData() + 4)) continue;
+		if (!j->second.isSentContainer()) {
+			if (!*(mtpMsgId*)(j->second->constData() + 4)) continue;
 
-			mtpMsgId id = i.key();
+			mtpMsgId id = i->first;
 			if (id > newId) {
 				while (true) {
-					if (toResend.constFind(newId) == toResend.cend()
-						&& wereAcked.constFind(newId) == wereAcked.cend()
-						&& haveSent.constFind(newId) == haveSent.cend()) {
+					if (toResend.find(newId) == toResend.cend()
+						&& wereAcked.find(newId) == wereAcked.cend()
+						&& haveSent.find(newId) == haveSent.cend()) {
 						break;
 					}
 					const auto m = base::unixtime::mtproto_msg_id();
@@ -587,11 +749,11 @@ void ConnectionPrivate::resetSession() { // recreate all msg_id and msg_seqno
 				MTP_LOG(_shiftedDcId, ("Replacing msgId %1 to %2!"
 					).arg(id
 					).arg(newId));
-				replaces.insert(id, newId);
+				replaces.insert_or_assign(id, newId);
 				id = newId;
-				*(mtpMsgId*)(j.value()->data() + 4) = id;
+				*(mtpMsgId*)(j->second->data() + 4) = id;
 			}
-			setSeqNumbers.insert(id, j.value());
+			setSeqNumbers.insert_or_assign(id, j->second);
 		}
 	}
 
@@ -600,41 +762,41 @@ void ConnectionPrivate::resetSession() { // recreate all msg_id and msg_seqno
 	sessionData->setSession(session);
 
 	for (auto i = setSeqNumbers.cbegin(), e = setSeqNumbers.cend(); i != e; ++i) { // generate new seq_numbers
-		bool wasNeedAck = (*(i.value()->data() + 6) & 1);
-		*(i.value()->data() + 6) = sessionData->nextRequestSeqNumber(wasNeedAck);
+		bool wasNeedAck = (*(i->second->data() + 6) & 1);
+		*(i->second->data() + 6) = sessionData->nextRequestSeqNumber(wasNeedAck);
 	}
-	if (!replaces.isEmpty()) {
+	if (!replaces.empty()) {
 		for (auto i = replaces.cbegin(), e = replaces.cend(); i != e; ++i) { // replace msgIds keys in all data structs
-			const auto j = haveSent.find(i.key());
+			const auto j = haveSent.find(i->first);
 			if (j != haveSent.cend()) {
-				const auto req = j.value();
+				const auto req = j->second;
 				haveSent.erase(j);
-				haveSent.insert(i.value(), req);
+				haveSent.insert_or_assign(i->second, req);
 			}
-			const auto k = toResend.find(i.key());
+			const auto k = toResend.find(i->first);
 			if (k != toResend.cend()) {
-				const auto req = k.value();
+				const auto req = k->second;
 				toResend.erase(k);
-				toResend.insert(i.value(), req);
+				toResend.insert_or_assign(i->second, req);
 			}
-			const auto l = wereAcked.find(i.key());
+			const auto l = wereAcked.find(i->first);
 			if (l != wereAcked.cend()) {
 				DEBUG_LOG(("MTP Info: Replaced %1 with %2 in wereAcked."
-					).arg(i.key()
-					).arg(i.value()));
+					).arg(i->first
+					).arg(i->second));
 
-				const auto req = l.value();
+				const auto req = l->second;
 				wereAcked.erase(l);
-				wereAcked.insert(i.value(), req);
+				wereAcked.insert_or_assign(i->second, req);
 			}
 		}
 		for (auto i = haveSent.cbegin(), e = haveSent.cend(); i != e; ++i) { // replace msgIds in saved containers
-			if (i.value().isSentContainer()) {
-				mtpMsgId *ids = (mtpMsgId*)(i.value()->data() + 8);
-				for (uint32 j = 0, l = (i.value()->size() - 8) >> 1; j < l; ++j) {
-					const auto k = replaces.constFind(ids[j]);
+			if (i->second.isSentContainer()) {
+				mtpMsgId *ids = (mtpMsgId*)(i->second->data() + 8);
+				for (uint32 j = 0, l = (i->second->size() - 8) >> 1; j < l; ++j) {
+					const auto k = replaces.find(ids[j]);
 					if (k != replaces.cend()) {
-						ids[j] = k.value();
+						ids[j] = k->second;
 					}
 				}
 			}
@@ -682,7 +844,7 @@ mtpMsgId ConnectionPrivate::replaceMsgId(SecureRequest &request, mtpMsgId newId)
 			auto &haveSent = sessionData->haveSentMap();
 
 			while (true) {
-				if (toResend.constFind(newId) == toResend.cend() && wereAcked.constFind(newId) == wereAcked.cend() && haveSent.constFind(newId) == haveSent.cend()) {
+				if (toResend.find(newId) == toResend.cend() && wereAcked.find(newId) == wereAcked.cend() && haveSent.find(newId) == haveSent.cend()) {
 					break;
 				}
 				const auto m = base::unixtime::mtproto_msg_id();
@@ -693,27 +855,27 @@ mtpMsgId ConnectionPrivate::replaceMsgId(SecureRequest &request, mtpMsgId newId)
 
 			const auto i = toResend.find(oldMsgId);
 			if (i != toResend.cend()) {
-				const auto req = i.value();
+				const auto req = i->second;
 				toResend.erase(i);
-				toResend.insert(newId, req);
+				toResend.insert_or_assign(newId, req);
 			}
 
 			const auto j = wereAcked.find(oldMsgId);
 			if (j != wereAcked.cend()) {
-				const auto req = j.value();
+				const auto req = j->second;
 				wereAcked.erase(j);
-				wereAcked.insert(newId, req);
+				wereAcked.insert_or_assign(newId, req);
 			}
 
 			const auto k = haveSent.find(oldMsgId);
 			if (k != haveSent.cend()) {
-				const auto req = k.value();
+				const auto req = k->second;
 				haveSent.erase(k);
-				haveSent.insert(newId, req);
+				haveSent.insert_or_assign(newId, req);
 			}
 
 			for (auto l = haveSent.begin(); l != haveSent.cend(); ++l) {
-				const auto req = l.value();
+				const auto req = l->second;
 				if (req.isSentContainer()) {
 					const auto ids = (mtpMsgId *)(req->data() + 8);
 					for (uint32 i = 0, l = (req->size() - 8) >> 1; i < l; ++i) {
@@ -819,10 +981,10 @@ void ConnectionPrivate::tryToSend() {
 		{
 			QWriteLocker locker(sessionData->stateRequestMutex());
 			auto &ids = sessionData->stateRequestMap();
-			if (!ids.isEmpty()) {
+			if (!ids.empty()) {
 				stateReq.reserve(ids.size());
 				for (auto i = ids.cbegin(), e = ids.cend(); i != e; ++i) {
-					stateReq.push_back(MTP_long(i.key()));
+					stateReq.push_back(MTP_long(*i));
 				}
 			}
 			ids.clear();
@@ -889,11 +1051,21 @@ void ConnectionPrivate::tryToSend() {
 	bool needAnyResponse = false;
 	SecureRequest toSendRequest;
 	{
-		QWriteLocker locker1(sessionData->toSendMutex());
-
-		auto toSendDummy = PreRequestMap();
-		auto &toSend = prependOnly ? toSendDummy : sessionData->toSendMap();
-		if (prependOnly) locker1.unlock();
+		// Hold the lock only while moving the pending requests out, so that
+		// new requests can be queued while this batch is being serialized.
+		auto toSend = std::vector<SecureRequest>();
+		if (!prependOnly) {
+			const auto sendMore = [&] {
+				QWriteLocker locker1(sessionData->toSendMutex());
+				auto &toSendMap = sessionData->toSendMap();
+				toSend = TakeContainerRequests(toSendMap);
+				return !toSendMap.empty();
+			}();
+			if (sendMore) {
+				// What didn't fit goes in the next container.
+				emit needToSendAsync();
+			}
+		}
 
 		uint32 toSendCount = toSend.size();
 		if (pingRequest) ++toSendCount;
@@ -904,13 +1076,9 @@ void ConnectionPrivate::tryToSend() {
 
 		if (!toSendCount) return; // nothing to send
 
-		auto first = pingRequest ? pingRequest : (ackRequest ? ackRequest : (resendRequest ? resendRequest : (stateRequest ? stateRequest : (httpWaitRequest ? httpWaitRequest : toSend.cbegin().value()))));
+		auto first = pingRequest ? pingRequest : (ackRequest ? ackRequest : (resendRequest ? resendRequest : (stateRequest ? stateRequest : (httpWaitRequest ? httpWaitRequest : toSend.front()))));
 		if (toSendCount == 1 && first->msDate > 0) { // if can send without container
 			toSendRequest = first;
-			if (!prependOnly) {
-				toSend.clear();
-				locker1.unlock();
-			}
 
 			const auto msgId = prepareToSend(
 				toSendRequest,
@@ -928,7 +1096,7 @@ void ConnectionPrivate::tryToSend() {
 
 					QWriteLocker locker2(sessionData->haveSentMutex());
 					auto &haveSent = sessionData->haveSentMap();
-					haveSent.insert(msgId, toSendRequest);
+					haveSent.insert_or_assign(msgId, toSendRequest);
 
 					if (needsLayer && !toSendRequest->needsLayer) needsLayer = false;
 					if (toSendRequest->after) {
@@ -957,7 +1125,7 @@ void ConnectionPrivate::tryToSend() {
 					needAnyResponse = true;
 				} else {
 					QWriteLocker locker3(sessionData->wereAckedMutex());
-					sessionData->wereAckedMap().insert(msgId, toSendRequest->requestId);
+					sessionData->wereAckedMap().insert_or_assign(msgId, toSendRequest->requestId);
 				}
 			}
 		} else { // send in container
@@ -968,9 +1136,9 @@ void ConnectionPrivate::tryToSend() {
 			if (resendRequest) containerSize += resendRequest.messageSize();
 			if (stateRequest) containerSize += stateRequest.messageSize();
 			if (httpWaitRequest) containerSize += httpWaitRequest.messageSize();
-			for (auto i = toSend.begin(), e = toSend.end(); i != e; ++i) {
-				containerSize += i.value().messageSize();
-				if (needsLayer && i.value()->needsLayer) {
+			for (const auto &request : toSend) {
+				containerSize += request.messageSize();
+				if (needsLayer && request->needsLayer) {
 					containerSize += initSizeInInts;
 					willNeedInit = true;
 				}
@@ -989,6 +1157,13 @@ void ConnectionPrivate::tryToSend() {
 			toSendRequest->push_back(mtpc_msg_container);
 			toSendRequest->push_back(toSendCount);
 
+			{
+				QWriteLocker locker(sessionData->statsMutex());
+				auto &stats = sessionData->stats();
+				++stats.containersSent;
+				stats.containerMessages += toSendCount;
+			}
+
 			// check for a valid container
 			auto bigMsgId = base::unixtime::mtproto_msg_id();
 
@@ -1012,8 +1187,7 @@ void ConnectionPrivate::tryToSend() {
 			} else if (resendRequest || stateRequest) {
 				needAnyResponse = true;
 			}
-			for (auto i = toSend.begin(), e = toSend.end(); i != e; ++i) {
-				auto &req = i.value();
+			for (auto &req : toSend) {
 				auto msgId = prepareToSend(req, bigMsgId);
 				if (msgId > bigMsgId) {
 					msgId = replaceMsgId(req, bigMsgId);
@@ -1042,11 +1216,11 @@ void ConnectionPrivate::tryToSend() {
 							*(toSendRequest->data() + reqNeedsLayer + 3) += initSize;
 							added = true;
 						}
-						haveSent.insert(msgId, req);
+						haveSent.insert_or_assign(msgId, req);
 
 						needAnyResponse = true;
 					} else {
-						wereAcked.insert(msgId, req->requestId);
+						wereAcked.insert_or_assign(msgId, req->requestId);
 					}
 				}
 				if (!added) {
@@ -1058,7 +1232,7 @@ void ConnectionPrivate::tryToSend() {
 			if (stateRequest) {
 				mtpMsgId msgId = placeToContainer(toSendRequest, bigMsgId, haveSentArr, stateRequest);
 				stateRequest->msDate = 0; // 0 for state request, do not request state of it
-				haveSent.insert(msgId, stateRequest);
+				haveSent.insert_or_assign(msgId, stateRequest);
 			}
 			if (resendRequest) placeToContainer(toSendRequest, bigMsgId, haveSentArr, resendRequest);
 			if (ackRequest) placeToContainer(toSendRequest, bigMsgId, haveSentArr, ackRequest);
@@ -1067,8 +1241,7 @@ void ConnectionPrivate::tryToSend() {
 			mtpMsgId contMsgId = prepareToSend(toSendRequest, bigMsgId);
 			*(mtpMsgId*)(haveSentIdsWrap->data() + 4) = contMsgId;
 			(*haveSentIdsWrap)[6] = 0; // for container, msDate = 0, seqNo = 0
-			haveSent.insert(contMsgId, haveSentIdsWrap);
-			toSend.clear();
+			haveSent.insert_or_assign(contMsgId, haveSentIdsWrap);
 		}
 	}
 	sendSecureRequest(
@@ -1418,6 +1591,8 @@ void ConnectionPrivate::requestCDNConfig() {
 }
 
 void ConnectionPrivate::handleReceived() {
+	TRACE_SCOPE("ConnectionPrivate::handleReceived");
+
 	QReadLocker lockFinished(&sessionDataMutex);
 	if (!sessionData) return;
 
@@ -1469,16 +1644,16 @@ void ConnectionPrivate::handleReceived() {
 		auto encryptedInts = ints + kExternalHeaderIntsCount;
 		auto encryptedIntsCount = (intsCount - kExternalHeaderIntsCount) & ~0x03U;
 		auto encryptedBytesCount = encryptedIntsCount * kIntSize;
-		auto decryptedBuffer = QByteArray(encryptedBytesCount, Qt::Uninitialized);
+		_decryptedBuffer.resize(encryptedBytesCount);
 		auto msgKey = *(MTPint128*)(ints + 2);
 
 #ifdef TDESKTOP_MTPROTO_OLD
-		aesIgeDecrypt_oldmtp(encryptedInts, decryptedBuffer.data(), encryptedBytesCount, key, msgKey);
+		aesIgeDecrypt_oldmtp(encryptedInts, _decryptedBuffer.data(), encryptedBytesCount, key, msgKey);
 #else // TDESKTOP_MTPROTO_OLD
-		aesIgeDecrypt(encryptedInts, decryptedBuffer.data(), encryptedBytesCount, key, msgKey);
+		aesIgeDecrypt(encryptedInts, _decryptedBuffer.data(), encryptedBytesCount, key, msgKey);
 #endif // TDESKTOP_MTPROTO_OLD
 
-		auto decryptedInts = reinterpret_cast<const mtpPrime*>(decryptedBuffer.constData());
+		auto decryptedInts = reinterpret_cast<const mtpPrime*>(_decryptedBuffer.constData());
 		auto serverSalt = *(uint64*)&decryptedInts[0];
 		auto session = *(uint64*)&decryptedInts[2];
 		auto msgId = *(uint64*)&decryptedInts[4];
@@ -1544,6 +1719,13 @@ void ConnectionPrivate::handleReceived() {
 
 		TCP_LOG(("TCP Info: decrypted message %1,%2,%3 is %4 len").arg(msgId).arg(seqNo).arg(Logs::b(needAck)).arg(fullDataLength));
 
+		{
+			QWriteLocker locker(sessionData->statsMutex());
+			auto &stats = sessionData->stats();
+			stats.bytesReceived += intsCount * kIntSize;
+			++stats.packetsReceived;
+		}
+
 		uint64 serverSession = sessionData->getSession();
 		if (session != serverSession) {
 			LOG(("MTP Error: bad server session received"));
@@ -1614,16 +1796,8 @@ void ConnectionPrivate::handleReceived() {
 			emit sendAnythingAsync(kAckSendWaiting);
 		}
 
-		bool emitSignal = false;
-		{
-			QReadLocker locker(sessionData->haveReceivedMutex());
-			emitSignal = !sessionData->haveReceivedResponses().isEmpty() || !sessionData->haveReceivedUpdates().isEmpty();
-			if (emitSignal) {
-				DEBUG_LOG(("MTP Info: emitting needToReceive() - need to parse in another thread, %1 responses, %2 updates.").arg(sessionData->haveReceivedResponses().size()).arg(sessionData->haveReceivedUpdates().size()));
-			}
-		}
-
-		if (emitSignal) {
+		if (sessionData->scheduleReceive()) {
+			DEBUG_LOG(("MTP Info: emitting needToReceive() - need to parse in another thread."));
 			emit needToReceive();
 		}
 
@@ -1781,11 +1955,11 @@ ConnectionPrivate::HandleResult ConnectionPrivate::handleOneReceived(const mtpPr
 						QWriteLocker locker(sessionData->haveSentMutex());
 						auto &haveSent = sessionData->haveSentMap();
 
-						const auto i = haveSent.constFind(resendId);
+						const auto i = haveSent.find(resendId);
 						if (i == haveSent.cend()) {
 							LOG(("Message Error: Container not found!"));
 						} else {
-							request = i.value();
+							request = i->second;
 						}
 					}
 					if (request) {
@@ -1921,7 +2095,7 @@ ConnectionPrivate::HandleResult ConnectionPrivate::handleOneReceived(const mtpPr
 						state |= 0x02;
 					} else {
 						state |= 0x04;
-						if (wereAcked.constFind(reqMsgId) != wereAckedEnd) {
+						if (wereAcked.find(reqMsgId) != wereAckedEnd) {
 							state |= 0x80; // we know, that server knows, that we received request
 						}
 						if (msgIdState == ReceivedMsgIds::State::NeedsAck) { // need ack, so we sent ack
@@ -1952,7 +2126,7 @@ ConnectionPrivate::HandleResult ConnectionPrivate::handleOneReceived(const mtpPr
 		{ // find this request in session-shared sent requests map
 			QReadLocker locker(sessionData->haveSentMutex());
 			const auto &haveSent = sessionData->haveSentMap();
-			const auto replyTo = haveSent.constFind(reqMsgId);
+			const auto replyTo = haveSent.find(reqMsgId);
 			if (replyTo == haveSent.cend()) { // do not look in toResend, because we do not resend msgs_state_req requests
 				DEBUG_LOG(("Message Error: such message was not sent recently %1").arg(reqMsgId));
 				return (badTime ? HandleResult::Ignored : HandleResult::Success);
@@ -1965,7 +2139,7 @@ ConnectionPrivate::HandleResult ConnectionPrivate::handleOneReceived(const mtpPr
 
 				badTime = false;
 			}
-			requestBuffer = replyTo.value();
+			requestBuffer = replyTo->second;
 		}
 		QVector<MTPlong> toAckReq(1, MTP_long(reqMsgId)), toAck;
 		requestsAcked(toAck, true);
@@ -2145,7 +2319,7 @@ ConnectionPrivate::HandleResult ConnectionPrivate::handleOneReceived(const mtpPr
 		if (requestId && requestId != mtpRequestId(0xFFFFFFFF)) {
 			// Save rpc_result for processing in the main thread.
 			QWriteLocker locker(sessionData->haveReceivedMutex());
-			sessionData->haveReceivedResponses().insert(requestId, response);
+			sessionData->addReceivedResponse(requestId, std::move(response));
 		} else {
 			DEBUG_LOG(("RPC Info: requestId not found for msgId %1").arg(reqMsgId.v));
 		}
@@ -2178,8 +2352,8 @@ ConnectionPrivate::HandleResult ConnectionPrivate::handleOneReceived(const mtpPr
 			const auto &haveSent = sessionData->haveSentMap();
 			toResend.reserve(haveSent.size());
 			for (auto i = haveSent.cbegin(), e = haveSent.cend(); i != e; ++i) {
-				if (i.key() >= firstMsgId) break;
-				if (i.value()->requestId) toResend.push_back(i.key());
+				if (i->first >= firstMsgId) break;
+				if (i->second->requestId) toResend.push_back(i->first);
 			}
 		}
 		resendMany(toResend, 10, true);
@@ -2189,7 +2363,7 @@ ConnectionPrivate::HandleResult ConnectionPrivate::handleOneReceived(const mtpPr
 
 		// Notify main process about new session - need to get difference.
 		QWriteLocker locker(sessionData->haveReceivedMutex());
-		sessionData->haveReceivedUpdates().push_back(SerializedMessage(update));
+		sessionData->addReceivedUpdate(SerializedMessage(update));
 	} return HandleResult::Success;
 
 	case mtpc_pong: {
@@ -2234,7 +2408,7 @@ ConnectionPrivate::HandleResult ConnectionPrivate::handleOneReceived(const mtpPr
 
 		// Notify main process about the new updates.
 		QWriteLocker locker(sessionData->haveReceivedMutex());
-		sessionData->haveReceivedUpdates().push_back(SerializedMessage(update));
+		sessionData->addReceivedUpdate(SerializedMessage(update));
 
 		if (cons != mtpc_updatesTooLong
 			&& cons != mtpc_updateShortMessage
@@ -2254,15 +2428,11 @@ ConnectionPrivate::HandleResult ConnectionPrivate::handleOneReceived(const mtpPr
 }
 
 mtpBuffer ConnectionPrivate::ungzip(const mtpPrime *from, const mtpPrime *end) const {
-	mtpBuffer result; // * 4 because of mtpPrime type
-	result.resize(0);
-
-	MTPstring packed;
-	if (!packed.read(from, end)) { // read packed string as serialized mtp string type
+	auto packed = bytes::const_span();
+	if (!ReadSerializedBytes(from, end, packed)) {
 		LOG(("RPC Error: could not read gziped bytes."));
-		return result;
+		return mtpBuffer();
 	}
-	uint32 packedLen = packed.v.size(), unpackedChunk = packedLen, unpackedLen = 0;
 
 	z_stream stream;
 	stream.zalloc = 0;
@@ -2273,24 +2443,36 @@ mtpBuffer ConnectionPrivate::ungzip(const mtpPrime *from, const mtpPrime *end) c
 	int res = inflateInit2(&stream, 16 + MAX_WBITS);
 	if (res != Z_OK) {
 		LOG(("RPC Error: could not init zlib stream, code: %1").arg(res));
-		return result;
+		return mtpBuffer();
 	}
-	stream.avail_in = packedLen;
-	stream.next_in = reinterpret_cast<Bytef*>(packed.v.data());
+	stream.avail_in = packed.size();
+	stream.next_in = reinterpret_cast<Bytef*>(
+		const_cast<gsl::byte*>(packed.data()));
 
-	stream.avail_out = 0;
-	while (!stream.avail_out) {
-		result.resize(result.size() + unpackedChunk);
-		stream.avail_out = unpackedChunk * sizeof(mtpPrime);
-		stream.next_out = (Bytef*)&result[result.size() - unpackedChunk];
-		int res = inflate(&stream, Z_NO_FLUSH);
-		if (res != Z_OK && res != Z_STREAM_END) {
+	auto result = mtpBuffer();
+	result.resize(UnpackedSizeHintInInts(packed));
+	stream.avail_out = result.size() * sizeof(mtpPrime);
+	stream.next_out = reinterpret_cast<Bytef*>(result.data());
+	while (true) {
+		res = inflate(&stream, Z_NO_FLUSH);
+		if (res == Z_STREAM_END) {
+			break;
+		} else if ((res != Z_OK && res != Z_BUF_ERROR) || stream.avail_out) {
+			// With free output space left the input was not enough.
 			inflateEnd(&stream);
 			LOG(("RPC Error: could not unpack gziped data, code: %1").arg(res));
-			DEBUG_LOG(("RPC Error: bad gzip: %1").arg(Logs::mb(packed.v.constData(), packedLen).str()));
+			DEBUG_LOG(("RPC Error: bad gzip: %1").arg(Logs::mb(packed.data(), packed.size()).str()));
 			return mtpBuffer();
 		}
+
+		// The hint was wrong, grow the buffer geometrically.
+		const auto was = result.size();
+		result.resize(was * 2);
+		stream.avail_out = (result.size() - was) * sizeof(mtpPrime);
+		stream.next_out = reinterpret_cast<Bytef*>(result.data() + was);
 	}
+	inflateEnd(&stream);
+
 	if (stream.avail_out & 0x03) {
 		uint32 badSize = result.size() * sizeof(mtpPrime) - stream.avail_out;
 		LOG(("RPC Error: bad length of unpacked data %1").arg(badSize));
@@ -2298,7 +2480,6 @@ mtpBuffer ConnectionPrivate::ungzip(const mtpPrime *from, const mtpPrime *end) c
 		return mtpBuffer();
 	}
 	result.resize(result.size() - (stream.avail_out >> 2));
-	inflateEnd(&stream);
 	if (!result.size()) {
 		LOG(("RPC Error: bad length of unpacked data 0"));
 	}
@@ -2324,6 +2505,7 @@ void ConnectionPrivate::requestsAcked(const QVector<MTPlong> &ids, bool byRespon
 	DEBUG_LOG(("Message Info: requests acked, ids %1").arg(LogIdsVector(ids)));
 
 	auto clearedBecauseTooOld = std::vector<RPCCallbackClear>();
+	auto responseTimes = std::vector<crl::time>();
 	QVector<MTPlong> toAckMore;
 	{
 		QWriteLocker locker1(sessionData->wereAckedMutex());
@@ -2337,23 +2519,27 @@ void ConnectionPrivate::requestsAcked(const QVector<MTPlong> &ids, bool byRespon
 				mtpMsgId msgId = ids[i].v;
 				const auto req = haveSent.find(msgId);
 				if (req != haveSent.cend()) {
-					if (!req.value()->msDate) {
+					if (!req->second->msDate) {
 						DEBUG_LOG(("Message Info: container ack received, msgId %1").arg(ids[i].v));
-						uint32 inContCount = ((*req)->size() - 8) / 2;
-						const mtpMsgId *inContId = (const mtpMsgId *)(req.value()->constData() + 8);
+						uint32 inContCount = (req->second->size() - 8) / 2;
+						const mtpMsgId *inContId = (const mtpMsgId *)(req->second->constData() + 8);
 						toAckMore.reserve(toAckMore.size() + inContCount);
 						for (uint32 j = 0; j < inContCount; ++j) {
 							toAckMore.push_back(MTP_long(*(inContId++)));
 						}
 						haveSent.erase(req);
 					} else {
-						mtpRequestId reqId = req.value()->requestId;
+						if (byResponse && req->second->msDate > 0) {
+							responseTimes.push_back(
+								crl::now() - req->second->msDate);
+						}
+						mtpRequestId reqId = req->second->requestId;
 						bool moveToAcked = byResponse;
 						if (!moveToAcked) { // ignore ACK, if we need a response (if we have a handler)
 							moveToAcked = !_instance->hasCallbacks(reqId);
 						}
 						if (moveToAcked) {
-							wereAcked.insert(msgId, reqId);
+							wereAcked.insert_or_assign(msgId, reqId);
 							haveSent.erase(req);
 						} else {
 							DEBUG_LOG(("Message Info: ignoring ACK for msgId %1 because request %2 requires a response").arg(msgId).arg(reqId));
@@ -2365,7 +2551,7 @@ void ConnectionPrivate::requestsAcked(const QVector<MTPlong> &ids, bool byRespon
 					auto &toResend = sessionData->toResendMap();
 					const auto reqIt = toResend.find(msgId);
 					if (reqIt != toResend.cend()) {
-						const auto reqId = reqIt.value();
+						const auto reqId = reqIt->second;
 						bool moveToAcked = byResponse;
 						if (!moveToAcked) { // ignore ACK, if we need a response (if we have a handler)
 							moveToAcked = !_instance->hasCallbacks(reqId);
@@ -2375,9 +2561,9 @@ void ConnectionPrivate::requestsAcked(const QVector<MTPlong> &ids, bool byRespon
 							auto &toSend = sessionData->toSendMap();
 							const auto req = toSend.find(reqId);
 							if (req != toSend.cend()) {
-								wereAcked.insert(msgId, req.value()->requestId);
-								if (req.value()->requestId != reqId) {
-									DEBUG_LOG(("Message Error: for msgId %1 found resent request, requestId %2, contains requestId %3").arg(msgId).arg(reqId).arg(req.value()->requestId));
+								wereAcked.insert_or_assign(msgId, req->second->requestId);
+								if (req->second->requestId != reqId) {
+									DEBUG_LOG(("Message Error: for msgId %1 found resent request, requestId %2, contains requestId %3").arg(msgId).arg(reqId).arg(req->second->requestId));
 								} else {
 									DEBUG_LOG(("Message Info: acked msgId %1 that was prepared to resend, requestId %2").arg(msgId).arg(reqId));
 								}
@@ -2399,14 +2585,22 @@ void ConnectionPrivate::requestsAcked(const QVector<MTPlong> &ids, bool byRespon
 		uint32 ackedCount = wereAcked.size();
 		if (ackedCount > kIdsBufferSize) {
 			DEBUG_LOG(("Message Info: removing some old acked sent msgIds %1").arg(ackedCount - kIdsBufferSize));
+			const auto till = wereAcked.begin() + (ackedCount - kIdsBufferSize);
 			clearedBecauseTooOld.reserve(ackedCount - kIdsBufferSize);
-			while (ackedCount-- > kIdsBufferSize) {
-				auto i = wereAcked.begin();
+			for (auto i = wereAcked.begin(); i != till; ++i) {
 				clearedBecauseTooOld.push_back(RPCCallbackClear(
-					i.value(),
+					i->second,
 					RPCError::TimeoutError));
-				wereAcked.erase(i);
 			}
+			wereAcked.erase(wereAcked.begin(), till);
+		}
+	}
+
+	if (!responseTimes.empty()) {
+		QWriteLocker locker(sessionData->statsMutex());
+		auto &stats = sessionData->stats();
+		for (const auto time : responseTimes) {
+			stats.addRtt(time);
 		}
 	}
 
@@ -3249,6 +3443,13 @@ bool ConnectionPrivate::sendSecureRequest(
 	_connection->setSentEncrypted();
 	_connection->sendData(std::move(packet));
 
+	{
+		QWriteLocker locker(sessionData->statsMutex());
+		auto &stats = sessionData->stats();
+		stats.bytesSent += (prefix + fullSize) * sizeof(mtpPrime);
+		++stats.packetsSent;
+	}
+
 	if (needAnyResponse) {
 		onSentSome((prefix + fullSize) * sizeof(mtpPrime));
 	}
@@ -3261,24 +3462,24 @@ mtpRequestId ConnectionPrivate::wasSent(mtpMsgId msgId) const {
 	{
 		QReadLocker locker(sessionData->haveSentMutex());
 		const auto &haveSent = sessionData->haveSentMap();
-		const auto i = haveSent.constFind(msgId);
+		const auto i = haveSent.find(msgId);
 		if (i != haveSent.cend()) {
-			return i.value()->requestId
-				? i.value()->requestId
+			return i->second->requestId
+				? i->second->requestId
 				: mtpRequestId(0xFFFFFFFF);
 		}
 	}
 	{
 		QReadLocker locker(sessionData->toResendMutex());
 		const auto &toResend = sessionData->toResendMap();
-		const auto i = toResend.constFind(msgId);
-		if (i != toResend.cend()) return i.value();
+		const auto i = toResend.find(msgId);
+		if (i != toResend.cend()) return i->second;
 	}
 	{
 		QReadLocker locker(sessionData->wereAckedMutex());
 		const auto &wereAcked = sessionData->wereAckedMap();
-		const auto i = wereAcked.constFind(msgId);
-		if (i != wereAcked.cend()) return i.value();
+		const auto i = wereAcked.find(msgId);
+		if (i != wereAcked.cend()) return i->second;
 	}
 	return 0;
 }
@@ -65,6 +65,33 @@ private:
 
 };
 
+// Connections don't get a thread each, they share a few threads with
+// an event loop in each, the least busy one is chosen for a new connection.
+// Used only from the main thread.
+class ConnectionThreads {
+public:
+	ConnectionThreads();
+	ConnectionThreads(const ConnectionThreads &other) = delete;
+	ConnectionThreads &operator=(const ConnectionThreads &other) = delete;
+	~ConnectionThreads();
+
+	// Shared by all connections, destroyed with the last of them.
+	[[nodiscard]] static std::shared_ptr<ConnectionThreads> Get();
+
+	[[nodiscard]] not_null<QThread*> acquire();
+	void release(not_null<QThread*> thread);
+
+private:
+	struct Entry {
+		std::unique_ptr<Thread> thread;
+		int connections = 0;
+	};
+
+	const int _limit = 0;
+	std::vector<Entry> _threads;
+
+};
+
 class Connection {
 public:
 	enum ConnectionType {
@@ -87,8 +114,10 @@ public:
 
 private:
 	not_null<Instance*> _instance;
-	std::unique_ptr<QThread> _thread;
+	std::shared_ptr<ConnectionThreads> _threads;
+	QThread *_thread = nullptr;
 	ConnectionPrivate *_private = nullptr;
+	crl::semaphore _finished;
 
 };
 
@@ -106,6 +135,9 @@ public:
 
 	void stop();
 
+	// Disconnects and deletes itself, called in its thread after stop().
+	void finishAndDestroy();
+
 	int32 getShiftedDcId() const;
 
 	int32 getState() const;
@@ -163,7 +195,6 @@ private:
 	void connectingTimedOut();
 	void doDisconnect();
 	void restart();
-	void finishAndDestroy();
 	void requestCDNConfig();
 	void handleError(int errorCode);
 	void onError(
@@ -267,6 +298,10 @@ private:
 
 	QVector<MTPlong> ackRequestData, resendRequestData;
 
+	// Reused for every received packet, so that decrypting doesn't
+	// allocate once the buffer has grown to the usual packet size.
+	QByteArray _decryptedBuffer;
+
 	mtpPingId _pingId = 0;
 	mtpPingId _pingIdToSend = 0;
 	crl::time _pingSendAt = 0;
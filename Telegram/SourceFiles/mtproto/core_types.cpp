@@ -7,11 +7,17 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 */
 #include "mtproto/core_types.h"
 
+#include "base/small_pool.h"
+
 #include "zlib.h"
 
 namespace MTP {
 namespace {
 
+// Up to 6 ints of padding are always needed and the extended padding can
+// add up to 15 more 4-int blocks, see CountPaddingAmountInInts().
+constexpr auto kMaxPaddingInts = 6 + (0x0F << 2);
+
 uint32 CountPaddingAmountInInts(uint32 requestSize, bool extended) {
 #ifdef TDESKTOP_MTPROTO_OLD
 	return ((8 + requestSize) & 0x03)
@@ -45,8 +51,10 @@ SecureRequest::SecureRequest(const details::SecureRequestCreateTag &tag)
 SecureRequest SecureRequest::Prepare(uint32 size, uint32 reserveSize) {
 	const auto finalSize = std::max(size, reserveSize);
 
+	// Reserve the padding as well, so that addPadding() before sending
+	// doesn't reallocate and copy the whole serialized request.
 	auto result = SecureRequest(details::SecureRequestCreateTag{});
-	result->reserve(kMessageBodyPosition + finalSize);
+	result->reserve(kMessageBodyPosition + finalSize + kMaxPaddingInts);
 	result->resize(kMessageBodyPosition);
 	result->back() = (size << 2);
 	return result;
@@ -145,6 +153,17 @@ bool SecureRequest::needAck() const {
 	return true;
 }
 
+namespace internal {
+
+void *TypeData::operator new(std::size_t size) {
+	return base::SmallPoolAllocate(size);
+}
+
+void TypeData::operator delete(void *pointer, std::size_t size) {
+	base::SmallPoolFree(pointer, size);
+}
+
+} // namespace internal
 } // namespace MTP
 
 uint32 MTPstring::innerLength() const {
@@ -40,6 +40,7 @@ constexpr auto kLogoutDcShift = 0x02;
 constexpr auto kUpdaterDcShift = 0x03;
 constexpr auto kExportDcShift = 0x04;
 constexpr auto kExportMediaDcShift = 0x05;
+constexpr auto kExportMediaSessionsCount = 4; // 0x05 - 0x08
 constexpr auto kMaxMediaDcCount = 0x10;
 constexpr auto kBaseDownloadDcShift = 0x10;
 constexpr auto kBaseUploadDcShift = 0x20;
@@ -73,6 +74,12 @@ public:
 	virtual ~TypeData() {
 	}
 
+	// Data of generated types is small and is created and destroyed
+	// by tens of thousands when big replies are parsed, so it is kept
+	// in per-thread pools of freed blocks instead of the general heap.
+	static void *operator new(std::size_t size);
+	static void operator delete(void *pointer, std::size_t size);
+
 private:
 	void incrementCounter() const {
 		_counter.ref();
@@ -269,6 +276,14 @@ struct is_boxed<MTPBoxed<T>> : std::true_type {
 template <typename T>
 constexpr bool is_boxed_v = is_boxed<T>::value;
 
+// Interactive requests are placed in containers before the normal ones,
+// bulk requests (like export or sync) after all the others.
+enum class RequestPriority : uchar {
+	Bulk,
+	Normal,
+	Interactive,
+};
+
 class SecureRequestData;
 class SecureRequest {
 public:
@@ -331,6 +346,7 @@ public:
 	mtpRequestId requestId = 0;
 	SecureRequest after;
 	bool needsLayer = false;
+	RequestPriority priority = RequestPriority::Normal;
 
 };
 
@@ -783,6 +799,11 @@ public:
 		}
 		auto count = static_cast<uint32>(*(from++));
 
+		// Every element takes at least one prime, so a count that doesn't
+		// fit in the rest of the buffer is bad and we don't allocate for it.
+		if (count > uint32(end - from)) {
+			return false;
+		}
 		auto vector = QVector<T>(count, T());
 		for (auto &item : vector) {
 			if (!item.read(from, end)) {
@@ -12,6 +12,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "main/main_account.h" // Account::sessionChanges.
 #include "facades.h"
 
+#include <openssl/sha.h>
+
 namespace MTP {
 namespace {
 
@@ -144,6 +146,11 @@ WeakInstance::~WeakInstance() {
 	}
 }
 
+struct AbstractDedicatedLoader::Hasher {
+	int offset = 0;
+	SHA_CTX context;
+};
+
 AbstractDedicatedLoader::AbstractDedicatedLoader(
 	const QString &filepath,
 	int chunkSize)
@@ -151,8 +158,19 @@ AbstractDedicatedLoader::AbstractDedicatedLoader(
 , _chunkSize(chunkSize) {
 }
 
+AbstractDedicatedLoader::~AbstractDedicatedLoader() = default;
+
+void AbstractDedicatedLoader::hashFrom(int offset) {
+	Expects(offset >= 0);
+
+	_hasher = std::make_unique<Hasher>();
+	_hasher->offset = offset;
+	SHA1_Init(&_hasher->context);
+}
+
 void AbstractDedicatedLoader::start() {
 	if (!validateOutput()
+		|| !hashExisting()
 		|| (!_output.isOpen() && !_output.open(QIODevice::Append))) {
 		QFile(_filepath).remove();
 		threadSafeFailed();
@@ -175,6 +193,11 @@ int AbstractDedicatedLoader::totalSize() const {
 	return _totalSize;
 }
 
+QByteArray AbstractDedicatedLoader::hash() const {
+	QMutexLocker lock(&_sizesMutex);
+	return _hash;
+}
+
 rpl::producer<QString> AbstractDedicatedLoader::ready() const {
 	return _ready.events();
 }
@@ -227,6 +250,40 @@ bool AbstractDedicatedLoader::validateOutput() {
 	return false;
 }
 
+bool AbstractDedicatedLoader::hashExisting() {
+	if (!_hasher || _alreadySize <= _hasher->offset) {
+		return true;
+	}
+
+	// Continuing the previous download, count the part we already have.
+	QFile existing(_filepath);
+	if (!existing.open(QIODevice::ReadOnly)
+		|| !existing.seek(_hasher->offset)) {
+		return false;
+	}
+	auto left = _alreadySize - _hasher->offset;
+	while (left > 0) {
+		const auto part = existing.read(std::min(left, _chunkSize));
+		if (part.isEmpty()) {
+			return false;
+		}
+		SHA1_Update(&_hasher->context, part.constData(), part.size());
+		left -= part.size();
+	}
+	return true;
+}
+
+void AbstractDedicatedLoader::hashChunk(bytes::const_span data) {
+	if (!_hasher) {
+		return;
+	}
+	const auto size = int(data.size());
+	const auto skip = std::max(_hasher->offset - _alreadySize, 0);
+	if (skip < size) {
+		SHA1_Update(&_hasher->context, data.data() + skip, size - skip);
+	}
+}
+
 void AbstractDedicatedLoader::threadSafeProgress(Progress progress) {
 	crl::on_main(this, [=] {
 		_progress.fire_copy(progress);
@@ -255,6 +312,7 @@ void AbstractDedicatedLoader::writeChunk(bytes::const_span data, int totalSize)
 			threadSafeFailed();
 			return;
 		}
+		hashChunk(data);
 	}
 
 	const auto progress = [&] {
@@ -263,6 +321,15 @@ void AbstractDedicatedLoader::writeChunk(bytes::const_span data, int totalSize)
 			_totalSize = totalSize;
 		}
 		_alreadySize += size;
+		if (_hasher
+			&& _totalSize > 0
+			&& _alreadySize >= _totalSize) {
+			_hash.resize(SHA_DIGEST_LENGTH);
+			SHA1_Final(
+				reinterpret_cast<unsigned char*>(_hash.data()),
+				&_hasher->context);
+			_hasher = nullptr;
+		}
 		return Progress { _alreadySize, _totalSize };
 	}();
 
@@ -58,12 +58,17 @@ public:
 		}
 	};
 
+	// Counts SHA1 of the file part starting from offset while it is being
+	// written, so that the result can be checked without reading it again.
+	void hashFrom(int offset);
+
 	void start();
 	void wipeFolder();
 	void wipeOutput();
 
 	int alreadySize() const;
 	int totalSize() const;
+	QByteArray hash() const;
 
 	rpl::producer<Progress> progress() const;
 	rpl::producer<QString> ready() const;
@@ -71,7 +76,7 @@ public:
 
 	rpl::lifetime &lifetime();
 
-	virtual ~AbstractDedicatedLoader() = default;
+	virtual ~AbstractDedicatedLoader();
 
 protected:
 	void threadSafeFailed();
@@ -80,9 +85,13 @@ protected:
 	void writeChunk(bytes::const_span data, int totalSize);
 
 private:
+	struct Hasher;
+
 	virtual void startLoading() = 0;
 
 	bool validateOutput();
+	bool hashExisting();
+	void hashChunk(bytes::const_span data);
 	void threadSafeProgress(Progress progress);
 	void threadSafeReady();
 
@@ -92,6 +101,8 @@ private:
 	QFile _output;
 	int _alreadySize = 0;
 	int _totalSize = 0;
+	std::unique_ptr<Hasher> _hasher;
+	QByteArray _hash;
 	mutable QMutex _sizesMutex;
 	rpl::event_stream<Progress> _progress;
 	rpl::event_stream<QString> _ready;
@@ -0,0 +1,246 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "mtproto/mtp_aes_ige.h"
+
+#include "base/build_config.h"
+
+#include <cstring>
+
+extern "C" {
+#include <openssl/aes.h>
+} // extern "C"
+
+#ifdef ARCH_CPU_X86_FAMILY
+#define MTP_AES_IGE_HARDWARE
+#ifdef _MSC_VER
+#include <intrin.h>
+#define MTP_AES_NI_TARGET
+#else // _MSC_VER
+#include <cpuid.h>
+#define MTP_AES_NI_TARGET __attribute__((target("aes,sse2")))
+#endif // _MSC_VER
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#endif // ARCH_CPU_X86_FAMILY
+
+namespace MTP {
+namespace details {
+namespace {
+
+constexpr auto kBlockSize = 16;
+constexpr auto kKeySize = 32;
+constexpr auto kIvSize = 32;
+
+void ProcessGeneric(
+		const void *src,
+		void *dst,
+		std::uint32_t len,
+		const void *key,
+		const void *iv,
+		bool encrypt) {
+	unsigned char aesKey[kKeySize], aesIv[kIvSize];
+	memcpy(aesKey, key, kKeySize);
+	memcpy(aesIv, iv, kIvSize);
+
+	AES_KEY aes;
+	if (encrypt) {
+		AES_set_encrypt_key(aesKey, 256, &aes);
+	} else {
+		AES_set_decrypt_key(aesKey, 256, &aes);
+	}
+	AES_ige_encrypt(
+		static_cast<const unsigned char*>(src),
+		static_cast<unsigned char*>(dst),
+		len,
+		&aes,
+		aesIv,
+		encrypt ? AES_ENCRYPT : AES_DECRYPT);
+}
+
+#ifdef MTP_AES_IGE_HARDWARE
+
+constexpr auto kRounds = 14;
+
+bool DetectHardware() {
+#ifdef _MSC_VER
+	int info[4] = { 0 };
+	__cpuid(info, 1);
+	return (info[2] & (1 << 25)) != 0;
+#else // _MSC_VER
+	unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+		return false;
+	}
+	return (ecx & bit_AES) != 0;
+#endif // _MSC_VER
+}
+
+MTP_AES_NI_TARGET inline __m128i ShiftXor(__m128i value) {
+	value = _mm_xor_si128(value, _mm_slli_si128(value, 4));
+	return _mm_xor_si128(value, _mm_slli_si128(value, 8));
+}
+
+// See Intel AES New Instructions Set white paper, AES-256 key expansion.
+template <int Rcon>
+MTP_AES_NI_TARGET inline void ExpandStep(__m128i *keys, int index) {
+	const auto first = _mm_shuffle_epi32(
+		_mm_aeskeygenassist_si128(keys[index - 1], Rcon),
+		0xFF);
+	keys[index] = _mm_xor_si128(ShiftXor(keys[index - 2]), first);
+	if (index == kRounds) {
+		return;
+	}
+	const auto second = _mm_shuffle_epi32(
+		_mm_aeskeygenassist_si128(keys[index], 0x00),
+		0xAA);
+	keys[index + 1] = _mm_xor_si128(ShiftXor(keys[index - 1]), second);
+}
+
+MTP_AES_NI_TARGET void ExpandEncryptKey(const void *key, __m128i *keys) {
+	const auto from = static_cast<const __m128i*>(key);
+	keys[0] = _mm_loadu_si128(from);
+	keys[1] = _mm_loadu_si128(from + 1);
+	ExpandStep<0x01>(keys, 2);
+	ExpandStep<0x02>(keys, 4);
+	ExpandStep<0x04>(keys, 6);
+	ExpandStep<0x08>(keys, 8);
+	ExpandStep<0x10>(keys, 10);
+	ExpandStep<0x20>(keys, 12);
+	ExpandStep<0x40>(keys, 14);
+}
+
+MTP_AES_NI_TARGET void ExpandDecryptKey(const void *key, __m128i *keys) {
+	__m128i encrypt[kRounds + 1];
+	ExpandEncryptKey(key, encrypt);
+	keys[0] = encrypt[kRounds];
+	for (auto i = 1; i != kRounds; ++i) {
+		keys[i] = _mm_aesimc_si128(encrypt[kRounds - i]);
+	}
+	keys[kRounds] = encrypt[0];
+}
+
+// IGE is serial in both directions: each block of encryption depends on
+// the previous ciphertext and each block of decryption on the previous
+// plaintext, so the win comes from doing every block in AES-NI rounds.
+MTP_AES_NI_TARGET void EncryptHardware(
+		const void *src,
+		void *dst,
+		std::uint32_t len,
+		const void *key,
+		const void *iv) {
+	__m128i keys[kRounds + 1];
+	ExpandEncryptKey(key, keys);
+
+	const auto ivs = static_cast<const __m128i*>(iv);
+	auto cipher = _mm_loadu_si128(ivs);
+	auto plain = _mm_loadu_si128(ivs + 1);
+	auto from = static_cast<const __m128i*>(src);
+	auto to = static_cast<__m128i*>(dst);
+	for (auto i = len / kBlockSize; i != 0; --i) {
+		const auto block = _mm_loadu_si128(from++);
+		auto state = _mm_xor_si128(_mm_xor_si128(block, cipher), keys[0]);
+		for (auto round = 1; round != kRounds; ++round) {
+			state = _mm_aesenc_si128(state, keys[round]);
+		}
+		state = _mm_aesenclast_si128(state, keys[kRounds]);
+		cipher = _mm_xor_si128(state, plain);
+		plain = block;
+		_mm_storeu_si128(to++, cipher);
+	}
+}
+
+MTP_AES_NI_TARGET void DecryptHardware(
+		const void *src,
+		void *dst,
+		std::uint32_t len,
+		const void *key,
+		const void *iv) {
+	__m128i keys[kRounds + 1];
+	ExpandDecryptKey(key, keys);
+
+	const auto ivs = static_cast<const __m128i*>(iv);
+	auto cipher = _mm_loadu_si128(ivs);
+	auto plain = _mm_loadu_si128(ivs + 1);
+	auto from = static_cast<const __m128i*>(src);
+	auto to = static_cast<__m128i*>(dst);
+	for (auto i = len / kBlockSize; i != 0; --i) {
+		const auto block = _mm_loadu_si128(from++);
+		auto state = _mm_xor_si128(_mm_xor_si128(block, plain), keys[0]);
+		for (auto round = 1; round != kRounds; ++round) {
+			state = _mm_aesdec_si128(state, keys[round]);
+		}
+		state = _mm_aesdeclast_si128(state, keys[kRounds]);
+		plain = _mm_xor_si128(state, cipher);
+		cipher = block;
+		_mm_storeu_si128(to++, plain);
+	}
+}
+
+#endif // MTP_AES_IGE_HARDWARE
+
+} // namespace
+
+bool AesIgeHardwareAvailable() {
+#ifdef MTP_AES_IGE_HARDWARE
+	static const auto result = DetectHardware();
+	return result;
+#else // MTP_AES_IGE_HARDWARE
+	return false;
+#endif // MTP_AES_IGE_HARDWARE
+}
+
+void AesIgeEncrypt(
+		const void *src,
+		void *dst,
+		std::uint32_t len,
+		const void *key,
+		const void *iv) {
+#ifdef MTP_AES_IGE_HARDWARE
+	if (AesIgeHardwareAvailable()) {
+		EncryptHardware(src, dst, len, key, iv);
+		return;
+	}
+#endif // MTP_AES_IGE_HARDWARE
+	ProcessGeneric(src, dst, len, key, iv, true);
+}
+
+void AesIgeDecrypt(
+		const void *src,
+		void *dst,
+		std::uint32_t len,
+		const void *key,
+		const void *iv) {
+#ifdef MTP_AES_IGE_HARDWARE
+	if (AesIgeHardwareAvailable()) {
+		DecryptHardware(src, dst, len, key, iv);
+		return;
+	}
+#endif // MTP_AES_IGE_HARDWARE
+	ProcessGeneric(src, dst, len, key, iv, false);
+}
+
+void AesIgeEncryptGeneric(
+		const void *src,
+		void *dst,
+		std::uint32_t len,
+		const void *key,
+		const void *iv) {
+	ProcessGeneric(src, dst, len, key, iv, true);
+}
+
+void AesIgeDecryptGeneric(
+		const void *src,
+		void *dst,
+		std::uint32_t len,
+		const void *key,
+		const void *iv) {
+	ProcessGeneric(src, dst, len, key, iv, false);
+}
+
+} // namespace details
+} // namespace MTP
@@ -0,0 +1,51 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include <cstdint>
+
+namespace MTP {
+namespace details {
+
+// AES-256-IGE with the same key / iv layout as OpenSSL AES_ige_encrypt:
+// 32 bytes of key and 32 bytes of iv (previous ciphertext block first),
+// length must be a multiple of 16 bytes, src and dst may be the same.
+//
+// Uses AES-NI when the processor has it, checked once at runtime,
+// otherwise falls back to OpenSSL generic implementation.
+void AesIgeEncrypt(
+	const void *src,
+	void *dst,
+	std::uint32_t len,
+	const void *key,
+	const void *iv);
+void AesIgeDecrypt(
+	const void *src,
+	void *dst,
+	std::uint32_t len,
+	const void *key,
+	const void *iv);
+
+[[nodiscard]] bool AesIgeHardwareAvailable();
+
+// For benchmarks and tests: always use OpenSSL generic implementation.
+void AesIgeEncryptGeneric(
+	const void *src,
+	void *dst,
+	std::uint32_t len,
+	const void *key,
+	const void *iv);
+void AesIgeDecryptGeneric(
+	const void *src,
+	void *dst,
+	std::uint32_t len,
+	const void *key,
+	const void *iv);
+
+} // namespace details
+} // namespace MTP
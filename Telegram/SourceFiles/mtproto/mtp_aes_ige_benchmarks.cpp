@@ -0,0 +1,117 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "mtproto/mtp_aes_ige.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Every benchmark prints one JSON object per line, for example:
+// {"benchmark":"ige_decrypt","impl":"hardware","size":65536,"ops":1024,"us":12345}
+
+using namespace MTP::details;
+
+namespace {
+
+constexpr auto kPacketSizes = { 1024, 16 * 1024, 128 * 1024, 1024 * 1024 };
+constexpr auto kTotalBytes = 256 * 1024 * 1024;
+
+using Method = void(*)(
+	const void *src,
+	void *dst,
+	std::uint32_t len,
+	const void *key,
+	const void *iv);
+
+struct Result {
+	const char *benchmark = nullptr;
+	const char *impl = nullptr;
+	int size = 0;
+	int ops = 0;
+	long long duration = 0;
+};
+
+void Print(const Result &result) {
+	std::cout
+		<< "{\"benchmark\":\"" << result.benchmark << "\""
+		<< ",\"impl\":\"" << result.impl << "\""
+		<< ",\"size\":" << result.size
+		<< ",\"ops\":" << result.ops
+		<< ",\"us\":" << result.duration
+		<< "}" << std::endl;
+}
+
+std::vector<unsigned char> RandomBytes(int size) {
+	static auto engine = std::mt19937(42);
+	auto result = std::vector<unsigned char>(size);
+	for (auto &value : result) {
+		value = static_cast<unsigned char>(engine());
+	}
+	return result;
+}
+
+const auto Key = RandomBytes(32);
+const auto Iv = RandomBytes(32);
+
+void Run(const char *benchmark, const char *impl, Method method) {
+	for (const auto size : kPacketSizes) {
+		auto buffer = RandomBytes(size);
+		const auto ops = kTotalBytes / size;
+		const auto started = std::chrono::steady_clock::now();
+		for (auto i = 0; i != ops; ++i) {
+			method(buffer.data(), buffer.data(), size, Key.data(), Iv.data());
+		}
+		const auto duration = std::chrono::steady_clock::now() - started;
+		Print({
+			benchmark,
+			impl,
+			size,
+			ops,
+			std::chrono::duration_cast<std::chrono::microseconds>(
+				duration).count() });
+	}
+}
+
+} // namespace
+
+TEST_CASE("aes ige hardware matches generic", "[.benchmark]") {
+	if (!AesIgeHardwareAvailable()) {
+		std::cout << "No hardware AES available." << std::endl;
+		return;
+	}
+	for (const auto size : kPacketSizes) {
+		const auto plain = RandomBytes(size);
+		auto hardware = std::vector<unsigned char>(size);
+		auto generic = std::vector<unsigned char>(size);
+		AesIgeEncrypt(plain.data(), hardware.data(), size, Key.data(), Iv.data());
+		AesIgeEncryptGeneric(plain.data(), generic.data(), size, Key.data(), Iv.data());
+		REQUIRE(hardware == generic);
+
+		// In place, the way received packets are decrypted.
+		AesIgeDecrypt(hardware.data(), hardware.data(), size, Key.data(), Iv.data());
+		REQUIRE(hardware == plain);
+	}
+}
+
+TEST_CASE("aes ige encrypt", "[.benchmark]") {
+	Run("ige_encrypt", "generic", AesIgeEncryptGeneric);
+	if (AesIgeHardwareAvailable()) {
+		Run("ige_encrypt", "hardware", AesIgeEncrypt);
+	}
+}
+
+TEST_CASE("aes ige decrypt", "[.benchmark]") {
+	Run("ige_decrypt", "generic", AesIgeDecryptGeneric);
+	if (AesIgeHardwareAvailable()) {
+		Run("ige_decrypt", "hardware", AesIgeDecrypt);
+	}
+}
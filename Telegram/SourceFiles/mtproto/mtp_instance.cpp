@@ -33,8 +33,41 @@ namespace {
 constexpr auto kConfigBecomesOldIn = 2 * 60 * crl::time(1000);
 constexpr auto kConfigBecomesOldForBlockedIn = 8 * crl::time(1000);
 
+// Sessions stats are written to the log that often with DEBUG logs enabled.
+constexpr auto kLogSessionsStatsInterval = 60 * crl::time(1000);
+
 } // namespace
 
+QString FormatSessionStats(const SessionStats &stats) {
+	auto rtt = QStringList();
+	for (auto i = 0; i != SessionStats::kRttBuckets; ++i) {
+		const auto till = SessionStats::kRttBucketStart << i;
+		rtt.push_back(((i + 1 < SessionStats::kRttBuckets)
+			? (QString("<") + QString::number(till))
+			: (QString(">") + QString::number(till / 2)))
+			+ QString(":") + QString::number(stats.rtt[i]));
+	}
+	return QString("dc %1, sent %2 bytes in %3 packets, "
+		"received %4 bytes in %5 packets, resent %6, "
+		"%7 containers with %8 messages, "
+		"queues: to send %9, sent %10, to resend %11, received %12, "
+		"rtt ms: %13, smoothed %14"
+	).arg(stats.shiftedDcId
+	).arg(stats.bytesSent
+	).arg(stats.packetsSent
+	).arg(stats.bytesReceived
+	).arg(stats.packetsReceived
+	).arg(stats.resent
+	).arg(stats.containersSent
+	).arg(stats.containerMessages
+	).arg(stats.toSend
+	).arg(stats.haveSent
+	).arg(stats.toResend
+	).arg(stats.receivedResponses
+	).arg(rtt.join(' ')
+	).arg(stats.smoothedRtt);
+}
+
 class Instance::Private : private Sender {
 public:
 	Private(not_null<Instance*> instance, not_null<DcOptions*> options, Instance::Mode mode);
@@ -69,6 +102,8 @@ public:
 	void restart(ShiftedDcId shiftedDcId);
 	[[nodiscard]] int32 dcstate(ShiftedDcId shiftedDcId = 0);
 	[[nodiscard]] QString dctransport(ShiftedDcId shiftedDcId = 0);
+	[[nodiscard]] std::vector<SessionStats> sessionsStats() const;
+	void logSessionsStats();
 	void ping();
 	void cancel(mtpRequestId requestId);
 	[[nodiscard]] int32 state(mtpRequestId requestId); // < 0 means waiting for such count of ms
@@ -225,6 +260,7 @@ private:
 	Fn<void(ShiftedDcId shiftedDcId)> _sessionResetHandler;
 
 	base::Timer _checkDelayedTimer;
+	base::Timer _logSessionsStatsTimer;
 
 	// Debug flag to find out how we end up crashing.
 	bool MustNotCreateSessions = false;
@@ -289,6 +325,8 @@ void Instance::Private::start(Config &&config) {
 	}
 
 	_checkDelayedTimer.setCallback([this] { checkDelayedRequests(); });
+	_logSessionsStatsTimer.setCallback([this] { logSessionsStats(); });
+	_logSessionsStatsTimer.callEach(kLogSessionsStatsInterval);
 
 	Assert((_mainDcId == Config::kNoneMainDc) == isKeysDestroyer());
 	requestConfig();
@@ -529,6 +567,24 @@ QString Instance::Private::dctransport(ShiftedDcId shiftedDcId) {
 	return QString();
 }
 
+std::vector<SessionStats> Instance::Private::sessionsStats() const {
+	auto result = std::vector<SessionStats>();
+	result.reserve(_sessions.size());
+	for (const auto &[shiftedDcId, session] : _sessions) {
+		result.push_back(session->stats());
+	}
+	return result;
+}
+
+void Instance::Private::logSessionsStats() {
+	if (!Logs::DebugEnabled()) {
+		return;
+	}
+	for (const auto &stats : sessionsStats()) {
+		DEBUG_LOG(("MTP Stats: %1").arg(FormatSessionStats(stats)));
+	}
+}
+
 void Instance::Private::ping() {
 	getSession(0)->ping();
 }
@@ -1627,6 +1683,10 @@ QString Instance::dctransport(ShiftedDcId shiftedDcId) {
 	return _private->dctransport(shiftedDcId);
 }
 
+std::vector<SessionStats> Instance::sessionsStats() const {
+	return _private->sessionsStats();
+}
+
 void Instance::ping() {
 	_private->ping();
 }
@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include <map>
 #include <set>
+#include <array>
 #include "mtproto/rpc_sender.h"
 
 namespace MTP {
@@ -23,6 +24,48 @@ class AuthKey;
 using AuthKeyPtr = std::shared_ptr<AuthKey>;
 using AuthKeysList = std::vector<AuthKeyPtr>;
 
+// Counters of one session for debugging, see Instance::sessionsStats().
+struct SessionStats {
+	// Bucket i counts responses received in less than
+	// (kRttBucketStart << i) ms after sending, the last one all others.
+	static constexpr auto kRttBuckets = 8;
+	static constexpr auto kRttBucketStart = crl::time(50);
+
+	// Each new response time moves smoothedRtt by 1 / kRttSmoothing.
+	static constexpr auto kRttSmoothing = crl::time(8);
+
+	void addRtt(crl::time value) {
+		auto index = 0;
+		while (index + 1 < kRttBuckets
+			&& value >= (kRttBucketStart << index)) {
+			++index;
+		}
+		++rtt[index];
+		smoothedRtt = smoothedRtt
+			? (smoothedRtt * (kRttSmoothing - 1) + value) / kRttSmoothing
+			: value;
+	}
+
+	ShiftedDcId shiftedDcId = 0;
+	std::array<int, kRttBuckets> rtt = { { 0 } };
+	crl::time smoothedRtt = 0;
+	int64 bytesSent = 0;
+	int64 bytesReceived = 0;
+	int packetsSent = 0;
+	int packetsReceived = 0;
+	int resent = 0;
+	int containersSent = 0;
+	int containerMessages = 0;
+
+	// Queue depths at the moment the stats were taken.
+	int toSend = 0;
+	int haveSent = 0;
+	int toResend = 0;
+	int receivedResponses = 0;
+};
+
+[[nodiscard]] QString FormatSessionStats(const SessionStats &stats);
+
 class Instance : public QObject {
 	Q_OBJECT
 
@@ -72,11 +115,14 @@ public:
 			RPCResponseHandler &&callbacks = {},
 			ShiftedDcId shiftedDcId = 0,
 			crl::time msCanWait = 0,
-			mtpRequestId afterRequestId = 0) {
+			mtpRequestId afterRequestId = 0,
+			RequestPriority priority = RequestPriority::Normal) {
 		const auto requestId = GetNextRequestId();
+		auto serialized = SecureRequest::Serialize(request);
+		serialized->priority = priority;
 		sendSerialized(
 			requestId,
-			SecureRequest::Serialize(request),
+			std::move(serialized),
 			std::move(callbacks),
 			shiftedDcId,
 			msCanWait,
@@ -91,13 +137,15 @@ public:
 			RPCFailHandlerPtr &&onFail = nullptr,
 			ShiftedDcId shiftedDcId = 0,
 			crl::time msCanWait = 0,
-			mtpRequestId afterRequestId = 0) {
+			mtpRequestId afterRequestId = 0,
+			RequestPriority priority = RequestPriority::Normal) {
 		return send(
 			request,
 			RPCResponseHandler(std::move(onDone), std::move(onFail)),
 			shiftedDcId,
 			msCanWait,
-			afterRequestId);
+			afterRequestId,
+			priority);
 	}
 
 	template <typename Request>
@@ -140,6 +188,7 @@ public:
 	void restart(ShiftedDcId shiftedDcId);
 	int32 dcstate(ShiftedDcId shiftedDcId = 0);
 	QString dctransport(ShiftedDcId shiftedDcId = 0);
+	[[nodiscard]] std::vector<SessionStats> sessionsStats() const;
 	void ping();
 	void cancel(mtpRequestId requestId);
 	int32 state(mtpRequestId requestId); // < 0 means waiting for such count of ms
@@ -151,6 +151,9 @@ class Sender {
 		void setAfter(mtpRequestId requestId) noexcept {
 			_afterRequestId = requestId;
 		}
+		void setPriority(RequestPriority priority) noexcept {
+			_priority = priority;
+		}
 
 		ShiftedDcId takeDcId() const noexcept {
 			return _dcId;
@@ -172,6 +175,9 @@ class Sender {
 		mtpRequestId takeAfter() const noexcept {
 			return _afterRequestId;
 		}
+		RequestPriority takePriority() const noexcept {
+			return _priority;
+		}
 
 		not_null<Sender*> sender() const noexcept {
 			return _sender;
@@ -188,6 +194,7 @@ class Sender {
 		base::variant<FailPlainHandler, FailRequestIdHandler> _fail;
 		FailSkipPolicy _failSkipPolicy = FailSkipPolicy::Simple;
 		mtpRequestId _afterRequestId = 0;
+		RequestPriority _priority = RequestPriority::Normal;
 
 	};
 
@@ -240,6 +247,10 @@ public:
 			setAfter(requestId);
 			return *this;
 		}
+		[[nodiscard]] SpecificRequestBuilder &withPriority(RequestPriority priority) noexcept {
+			setPriority(priority);
+			return *this;
+		}
 
 		mtpRequestId send() {
 			const auto id = MainInstance()->send(
@@ -248,7 +259,8 @@ public:
 				takeOnFail(),
 				takeDcId(),
 				takeCanWait(),
-				takeAfter());
+				takeAfter(),
+				takePriority());
 			registerRequest(id);
 			return id;
 		}
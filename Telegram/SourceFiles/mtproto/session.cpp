@@ -32,6 +32,13 @@ constexpr auto kResendThreshold = 1;
 // Container lives 10 minutes in haveSent map.
 constexpr auto kContainerLives = 600;
 
+// Requests that can wait are held for up to smoothed rtt / kBatchingRttPart
+// to be sent together in one container, but not longer than
+// kMaxBatchingDelay and only while less than kFlushQueueSize are waiting.
+constexpr auto kBatchingRttPart = 8;
+constexpr auto kMaxBatchingDelay = crl::time(50);
+constexpr auto kFlushQueueSize = 16;
+
 QString LogIds(const QVector<uint64> &ids) {
 	if (!ids.size()) return "[]";
 	auto idsStr = QString("[%1").arg(*ids.cbegin());
@@ -91,6 +98,46 @@ void SessionData::notifyConnectionInited(const ConnectionOptions &options) {
 	}
 }
 
+void SessionData::addReceivedResponse(
+		mtpRequestId requestId,
+		SerializedMessage &&response) {
+	_receivedResponses.insert_or_assign(requestId, std::move(response));
+}
+
+void SessionData::addReceivedUpdate(SerializedMessage &&update) {
+	_receivedUpdates.push_back(std::move(update));
+}
+
+bool SessionData::scheduleReceive() {
+	QWriteLocker locker(haveReceivedMutex());
+	if (_receiveScheduled
+		|| (_receivedResponses.empty() && _receivedUpdates.isEmpty())) {
+		return false;
+	}
+	_receiveScheduled = true;
+	return true;
+}
+
+void SessionData::takeReceived(
+		base::flat_map<mtpRequestId, SerializedMessage> &responses,
+		QList<SerializedMessage> &updates) {
+	QWriteLocker locker(haveReceivedMutex());
+	_receiveScheduled = false;
+	if (responses.empty()) {
+		std::swap(responses, _receivedResponses);
+	} else {
+		for (auto &[requestId, response] : _receivedResponses) {
+			responses.insert_or_assign(requestId, std::move(response));
+		}
+		_receivedResponses.clear();
+	}
+	if (updates.isEmpty()) {
+		std::swap(updates, _receivedUpdates);
+	} else {
+		updates.append(base::take(_receivedUpdates));
+	}
+}
+
 void SessionData::clear(Instance *instance) {
 	auto clearCallbacks = std::vector<RPCCallbackClear>();
 	{
@@ -98,19 +145,19 @@ void SessionData::clear(Instance *instance) {
 		auto receivedResponsesEnd = _receivedResponses.cend();
 		clearCallbacks.reserve(_haveSent.size() + _wereAcked.size());
 		for (auto i = _haveSent.cbegin(), e = _haveSent.cend(); i != e; ++i) {
-			auto requestId = i.value()->requestId;
+			auto requestId = i->second->requestId;
 			if (!_receivedResponses.contains(requestId)) {
 				clearCallbacks.push_back(requestId);
 			}
 		}
 		for (auto i = _toResend.cbegin(), e = _toResend.cend(); i != e; ++i) {
-			auto requestId = i.value();
+			auto requestId = i->second;
 			if (!_receivedResponses.contains(requestId)) {
 				clearCallbacks.push_back(requestId);
 			}
 		}
 		for (auto i = _wereAcked.cbegin(), e = _wereAcked.cend(); i != e; ++i) {
-			auto requestId = i.value();
+			auto requestId = i->second;
 			if (!_receivedResponses.contains(requestId)) {
 				clearCallbacks.push_back(requestId);
 			}
@@ -319,22 +366,22 @@ void Session::checkRequestsByTimer() {
 		const auto haveSentCount = haveSent.size();
 		auto ms = crl::now();
 		for (auto i = haveSent.begin(), e = haveSent.end(); i != e; ++i) {
-			auto &req = i.value();
+			auto &req = i->second;
 			if (req->msDate > 0) {
 				if (req->msDate + kCheckResendTimeout < ms) { // need to resend or check state
 					if (req.messageSize() < kResendThreshold) { // resend
 						resendingIds.reserve(haveSentCount);
-						resendingIds.push_back(i.key());
+						resendingIds.push_back(i->first);
 					} else {
 						req->msDate = ms;
 						stateRequestIds.reserve(haveSentCount);
-						stateRequestIds.push_back(i.key());
+						stateRequestIds.push_back(i->first);
 					}
 				}
 			} else if (base::unixtime::now()
-					> int32(i.key() >> 32) + kContainerLives) {
+					> int32(i->first >> 32) + kContainerLives) {
 				removingIds.reserve(haveSentCount);
-				removingIds.push_back(i.key());
+				removingIds.push_back(i->first);
 			}
 		}
 	}
@@ -344,7 +391,7 @@ void Session::checkRequestsByTimer() {
 		{
 			QWriteLocker locker(data.stateRequestMutex());
 			for (uint32 i = 0, l = stateRequestIds.size(); i < l; ++i) {
-				data.stateRequestMap().insert(stateRequestIds[i], true);
+				data.stateRequestMap().insert(stateRequestIds[i]);
 			}
 		}
 		sendAnything(kCheckResendWaiting);
@@ -363,8 +410,8 @@ void Session::checkRequestsByTimer() {
 			for (uint32 i = 0, l = removingIds.size(); i < l; ++i) {
 				auto j = haveSent.find(removingIds[i]);
 				if (j != haveSent.cend()) {
-					if (j.value()->requestId) {
-						clearCallbacks.push_back(j.value()->requestId);
+					if (j->second->requestId) {
+						clearCallbacks.push_back(j->second->requestId);
 					}
 					haveSent.erase(j);
 				}
@@ -423,7 +470,7 @@ int32 Session::requestState(mtpRequestId requestId) const {
 
 	QWriteLocker locker(data.toSendMutex());
 	const auto &toSend = data.toSendMap();
-	const auto i = toSend.constFind(requestId);
+	const auto i = toSend.find(requestId);
 	if (i != toSend.cend()) {
 		return MTP::RequestSending;
 	} else {
@@ -458,6 +505,31 @@ QString Session::transport() const {
 	return _connection ? _connection->transport() : QString();
 }
 
+SessionStats Session::stats() const {
+	auto result = [&] {
+		QReadLocker locker(data.statsMutex());
+		return data.stats();
+	}();
+	result.shiftedDcId = dcWithShift;
+	{
+		QReadLocker locker(data.toSendMutex());
+		result.toSend = data.toSendMap().size();
+	}
+	{
+		QReadLocker locker(data.haveSentMutex());
+		result.haveSent = data.haveSentMap().size();
+	}
+	{
+		QReadLocker locker(data.toResendMutex());
+		result.toResend = data.toResendMap().size();
+	}
+	{
+		QReadLocker locker(data.haveReceivedMutex());
+		result.receivedResponses = data.haveReceivedResponses().size();
+	}
+	return result;
+}
+
 mtpRequestId Session::resend(quint64 msgId, qint64 msCanWait, bool forceContainer, bool sendMsgStateInfo) {
 	SecureRequest request;
 	{
@@ -481,7 +553,7 @@ mtpRequestId Session::resend(quint64 msgId, qint64 msCanWait, bool forceContaine
 			return 0;
 		}
 
-		request = i.value();
+		request = i->second;
 		haveSent.erase(i);
 	}
 	if (request.isSentContainer()) { // for container just resend all messages we can
@@ -494,9 +566,13 @@ mtpRequestId Session::resend(quint64 msgId, qint64 msCanWait, bool forceContaine
 	} else if (!request.isStateRequest()) {
 		request->msDate = forceContainer ? 0 : crl::now();
 		sendPrepared(request, msCanWait, false);
+		{
+			QWriteLocker locker(data.statsMutex());
+			++data.stats().resent;
+		}
 		{
 			QWriteLocker locker(data.toResendMutex());
-			data.toResendMap().insert(msgId, request->requestId);
+			data.toResendMap().insert_or_assign(msgId, request->requestId);
 		}
 		return request->requestId;
 	} else {
@@ -517,8 +593,8 @@ void Session::resendAll() {
 		const auto &haveSent = data.haveSentMap();
 		toResend.reserve(haveSent.size());
 		for (auto i = haveSent.cbegin(), e = haveSent.cend(); i != e; ++i) {
-			if (i.value()->requestId) {
-				toResend.push_back(i.key());
+			if (i->second->requestId) {
+				toResend.push_back(i->first);
 			}
 		}
 	}
@@ -533,9 +609,11 @@ void Session::sendPrepared(
 		bool newRequest) {
 	DEBUG_LOG(("MTP Info: adding request to toSendMap, msCanWait %1"
 		).arg(msCanWait));
+	auto queueSize = 0;
 	{
 		QWriteLocker locker(data.toSendMutex());
-		data.toSendMap().insert(request->requestId, request);
+		data.toSendMap().insert_or_assign(request->requestId, request);
+		queueSize = data.toSendMap().size();
 
 		if (newRequest) {
 			*(mtpMsgId*)(request->data() + 4) = 0;
@@ -545,7 +623,24 @@ void Session::sendPrepared(
 
 	DEBUG_LOG(("MTP Info: added, requestId %1").arg(request->requestId));
 
-	sendAnything(msCanWait);
+	sendAnything((request->priority == RequestPriority::Interactive)
+		? 0
+		: batchingDelay(msCanWait, queueSize));
+}
+
+crl::time Session::batchingDelay(crl::time msCanWait, int queueSize) const {
+	if (!msCanWait) {
+		// Interactive requests are sent right away.
+		return 0;
+	} else if (queueSize >= kFlushQueueSize) {
+		return 0;
+	}
+	const auto rtt = [&] {
+		QReadLocker locker(data.statsMutex());
+		return data.stats().smoothedRtt;
+	}();
+	const auto window = std::min(rtt / kBatchingRttPart, kMaxBatchingDelay);
+	return std::max(msCanWait, window);
 }
 
 QReadWriteLock *Session::keyMutex() const {
@@ -599,36 +694,24 @@ void Session::tryToReceive() {
 		_needToReceive = true;
 		return;
 	}
+	data.takeReceived(_receivedResponses, _receivedUpdates);
+
+	// Callbacks may call tryToReceive() from nested event loops, so each
+	// message is removed from the batch before it is processed.
 	while (true) {
-		auto requestId = mtpRequestId(0);
-		auto isUpdate = false;
-		auto message = SerializedMessage();
-		{
-			QWriteLocker locker(data.haveReceivedMutex());
-			auto &responses = data.haveReceivedResponses();
-			auto response = responses.begin();
-			if (response == responses.cend()) {
-				auto &updates = data.haveReceivedUpdates();
-				auto update = updates.begin();
-				if (update == updates.cend()) {
-					return;
-				} else {
-					message = std::move(*update);
-					isUpdate = true;
-					updates.pop_front();
-				}
-			} else {
-				requestId = response.key();
-				message = std::move(response.value());
-				responses.erase(response);
-			}
-		}
-		if (isUpdate) {
+		if (!_receivedResponses.empty()) {
+			const auto i = _receivedResponses.begin();
+			const auto requestId = i->first;
+			const auto message = std::move(i->second);
+			_receivedResponses.erase(i);
+			_instance->execCallback(requestId, message.constData(), message.constData() + message.size());
+		} else if (!_receivedUpdates.isEmpty()) {
+			const auto message = _receivedUpdates.takeFirst();
 			if (dcWithShift == BareDcId(dcWithShift)) { // call globalCallback only in main session
 				_instance->globalCallback(message.constData(), message.constData() + message.size());
 			}
 		} else {
-			_instance->execCallback(requestId, message.constData(), message.constData() + message.size());
+			return;
 		}
 	}
 }
@@ -9,12 +9,12 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "base/timer.h"
 #include "mtproto/rpc_sender.h"
+#include "mtproto/mtp_instance.h"
 
 #include <QtCore/QTimer>
 
 namespace MTP {
 
-class Instance;
 class AuthKey;
 using AuthKeyPtr = std::shared_ptr<AuthKey>;
 
@@ -26,20 +26,22 @@ constexpr auto kIdsBufferSize = 400;
 class Dcenter;
 class Connection;
 
-using PreRequestMap = QMap<mtpRequestId, SecureRequest>;
-using RequestMap = QMap<mtpMsgId, SecureRequest>;
+// Message ids grow monotonically, so new entries are appended to the back
+// of these sorted vectors and lookups are binary searches without any
+// per-node allocations.
+using PreRequestMap = base::flat_map<mtpRequestId, SecureRequest>;
+using RequestMap = base::flat_map<mtpMsgId, SecureRequest>;
 
-class RequestIdsMap : public QMap<mtpMsgId, mtpRequestId> {
+class RequestIdsMap : public base::flat_map<mtpMsgId, mtpRequestId> {
 public:
-	using ParentType = QMap<mtpMsgId, mtpRequestId>;
+	using ParentType = base::flat_map<mtpMsgId, mtpRequestId>;
 
 	mtpMsgId min() const {
-		return size() ? cbegin().key() : 0;
+		return empty() ? 0 : front().first;
 	}
 
 	mtpMsgId max() const {
-		ParentType::const_iterator e(cend());
-		return size() ? (--e).key() : 0;
+		return empty() ? 0 : back().first;
 	}
 
 };
@@ -47,10 +49,10 @@ public:
 class ReceivedMsgIds {
 public:
 	bool registerMsgId(mtpMsgId msgId, bool needAck) {
-		auto i = _idsNeedAck.constFind(msgId);
-		if (i == _idsNeedAck.cend()) {
+		auto i = _idsNeedAck.find(msgId);
+		if (i == _idsNeedAck.end()) {
 			if (_idsNeedAck.size() < kIdsBufferSize || msgId > min()) {
-				_idsNeedAck.insert(msgId, needAck);
+				_idsNeedAck.emplace(msgId, needAck);
 				return true;
 			}
 			MTP_LOG(-1, ("No need to handle - %1 < min = %2").arg(msgId).arg(min()));
@@ -61,18 +63,19 @@ public:
 	}
 
 	mtpMsgId min() const {
-		return _idsNeedAck.isEmpty() ? 0 : _idsNeedAck.cbegin().key();
+		return _idsNeedAck.empty() ? 0 : _idsNeedAck.front().first;
 	}
 
 	mtpMsgId max() const {
-		auto end = _idsNeedAck.cend();
-		return _idsNeedAck.isEmpty() ? 0 : (--end).key();
+		return _idsNeedAck.empty() ? 0 : _idsNeedAck.back().first;
 	}
 
 	void shrink() {
-		auto size = _idsNeedAck.size();
-		while (size-- > kIdsBufferSize) {
-			_idsNeedAck.erase(_idsNeedAck.begin());
+		const auto size = int(_idsNeedAck.size());
+		if (size > kIdsBufferSize) {
+			_idsNeedAck.erase(
+				_idsNeedAck.begin(),
+				_idsNeedAck.begin() + (size - kIdsBufferSize));
 		}
 	}
 
@@ -82,11 +85,11 @@ public:
 		NoAckNeeded,
 	};
 	State lookup(mtpMsgId msgId) const {
-		auto i = _idsNeedAck.constFind(msgId);
-		if (i == _idsNeedAck.cend()) {
+		const auto i = _idsNeedAck.find(msgId);
+		if (i == _idsNeedAck.end()) {
 			return State::NotFound;
 		}
-		return i.value() ? State::NeedsAck : State::NoAckNeeded;
+		return i->second ? State::NeedsAck : State::NoAckNeeded;
 	}
 
 	void clear() {
@@ -94,7 +97,7 @@ public:
 	}
 
 private:
-	QMap<mtpMsgId, bool> _idsNeedAck;
+	base::flat_map<mtpMsgId, bool> _idsNeedAck;
 
 };
 
@@ -215,6 +218,9 @@ public:
 	not_null<QReadWriteLock*> stateRequestMutex() const {
 		return &_stateRequestLock;
 	}
+	not_null<QReadWriteLock*> statsMutex() const {
+		return &_statsLock;
+	}
 
 	PreRequestMap &toSendMap() {
 		return _toSend;
@@ -246,24 +252,37 @@ public:
 	const RequestIdsMap &wereAckedMap() const {
 		return _wereAcked;
 	}
-	QMap<mtpRequestId, SerializedMessage> &haveReceivedResponses() {
-		return _receivedResponses;
-	}
-	const QMap<mtpRequestId, SerializedMessage> &haveReceivedResponses() const {
+	const base::flat_map<mtpRequestId, SerializedMessage> &haveReceivedResponses() const {
 		return _receivedResponses;
 	}
-	QList<SerializedMessage> &haveReceivedUpdates() {
-		return _receivedUpdates;
-	}
 	const QList<SerializedMessage> &haveReceivedUpdates() const {
 		return _receivedUpdates;
 	}
-	QMap<mtpMsgId, bool> &stateRequestMap() {
+
+	// Called from the connection thread under haveReceivedMutex().
+	void addReceivedResponse(
+		mtpRequestId requestId,
+		SerializedMessage &&response);
+	void addReceivedUpdate(SerializedMessage &&update);
+
+	// One needToReceive() is enough for all the messages received till
+	// the main thread takes them, the rest return false until then.
+	[[nodiscard]] bool scheduleReceive();
+	void takeReceived(
+		base::flat_map<mtpRequestId, SerializedMessage> &responses,
+		QList<SerializedMessage> &updates);
+	base::flat_set<mtpMsgId> &stateRequestMap() {
 		return _stateRequest;
 	}
-	const QMap<mtpMsgId, bool> &stateRequestMap() const {
+	const base::flat_set<mtpMsgId> &stateRequestMap() const {
 		return _stateRequest;
 	}
+	SessionStats &stats() {
+		return _stats;
+	}
+	const SessionStats &stats() const {
+		return _stats;
+	}
 
 	not_null<Session*> owner() {
 		return _owner;
@@ -299,10 +318,13 @@ private:
 	RequestIdsMap _toResend; // map of msg_id -> request_id, that request_id -> request lies in toSend and is waiting to be resent
 	ReceivedMsgIds _receivedIds; // set of received msg_id's, for checking new msg_ids
 	RequestIdsMap _wereAcked; // map of msg_id -> request_id, this msg_ids already were acked or do not need ack
-	QMap<mtpMsgId, bool> _stateRequest; // set of msg_id's, whose state should be requested
+	base::flat_set<mtpMsgId> _stateRequest; // set of msg_id's, whose state should be requested
 
-	QMap<mtpRequestId, SerializedMessage> _receivedResponses; // map of request_id -> response that should be processed in the main thread
+	base::flat_map<mtpRequestId, SerializedMessage> _receivedResponses; // map of request_id -> response that should be processed in the main thread
 	QList<SerializedMessage> _receivedUpdates; // list of updates that should be processed in the main thread
+	bool _receiveScheduled = false;
+
+	SessionStats _stats; // counters updated by the connection thread
 
 	// mutexes
 	mutable QReadWriteLock _lock;
@@ -313,6 +335,7 @@ private:
 	mutable QReadWriteLock _wereAckedLock;
 	mutable QReadWriteLock _haveReceivedLock;
 	mutable QReadWriteLock _stateRequestLock;
+	mutable QReadWriteLock _statsLock;
 
 };
 
@@ -343,6 +366,7 @@ public:
 	int32 requestState(mtpRequestId requestId) const;
 	int32 getState() const;
 	QString transport() const;
+	[[nodiscard]] SessionStats stats() const;
 
 	// Nulls msgId and seqNo in request, if newRequest = true.
 	void sendPrepared(
@@ -380,6 +404,12 @@ public slots:
 private:
 	void createDcData();
 
+	// How long a request that can wait msCanWait should be held, so that
+	// it goes in one container with the requests that follow it.
+	[[nodiscard]] crl::time batchingDelay(
+		crl::time msCanWait,
+		int queueSize) const;
+
 	bool rpcErrorOccured(mtpRequestId requestId, const RPCFailHandlerPtr &onFail, const RPCError &err);
 
 	not_null<Instance*> _instance;
@@ -388,6 +418,10 @@ private:
 	bool _killed = false;
 	bool _needToReceive = false;
 
+	// Taken from data in one batch, processed one by one.
+	base::flat_map<mtpRequestId, SerializedMessage> _receivedResponses;
+	QList<SerializedMessage> _receivedUpdates;
+
 	SessionData data;
 
 	ShiftedDcId dcWithShift = 0;
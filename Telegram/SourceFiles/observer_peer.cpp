@@ -10,6 +10,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/observer.h"
 #include "facades.h"
 
+#include <rpl/event_stream.h>
+
 namespace Notify {
 namespace {
 
@@ -29,6 +31,33 @@ void FinishCallback() {
 
 base::Observable<PeerUpdate, PeerUpdatedHandler> PeerUpdatedObservable;
 
+// Viewers of a single peer get only its updates, without waking up for
+// every other peer changing, for example, its online status.
+struct PeerChannel {
+	rpl::event_stream<PeerUpdate> updates;
+	int viewers = 0;
+};
+using PeerChannelsMap = base::flat_map<not_null<PeerData*>, PeerChannel>;
+NeverFreedPointer<PeerChannelsMap> PeerChannels;
+
+void NotifyPeerChannel(const PeerUpdate &update) {
+	if (!PeerChannels || !update.peer) {
+		return;
+	}
+	const auto i = PeerChannels->find(update.peer);
+	if (i != end(*PeerChannels)) {
+		i->second.updates.fire_copy(update);
+	}
+}
+
+void ReleasePeerChannel(not_null<PeerData*> peer) {
+	const auto i = PeerChannels->find(peer);
+	Assert(i != end(*PeerChannels));
+	if (!--i->second.viewers) {
+		PeerChannels->erase(i);
+	}
+}
+
 } // namespace
 
 void mergePeerUpdate(PeerUpdate &mergeTo, const PeerUpdate &mergeFrom) {
@@ -77,9 +106,11 @@ void peerUpdatedSendDelayed() {
 	auto smallList = base::take(*SmallUpdates);
 	auto allList = base::take(*AllUpdates);
 	for (auto &update : smallList) {
+		NotifyPeerChannel(update);
 		PeerUpdated().notify(std::move(update), true);
 	}
 	for (auto &update : allList) {
+		NotifyPeerChannel(update);
 		PeerUpdated().notify(std::move(update), true);
 	}
 
@@ -109,11 +140,20 @@ rpl::producer<PeerUpdate> PeerUpdateViewer(
 rpl::producer<PeerUpdate> PeerUpdateViewer(
 		not_null<PeerData*> peer,
 		PeerUpdate::Flags flags) {
-	return PeerUpdateViewer(
-		flags
-	) | rpl::filter([=](const PeerUpdate &update) {
-		return (update.peer == peer);
-	});
+	return [=](const auto &consumer) {
+		PeerChannels.createIfNull();
+		auto &channel = (*PeerChannels)[peer];
+		++channel.viewers;
+
+		auto lifetime = rpl::lifetime([=] { ReleasePeerChannel(peer); });
+		channel.updates.events(
+		) | rpl::filter([=](const PeerUpdate &update) {
+			return (update.flags & flags);
+		}) | rpl::start_with_next([=](const PeerUpdate &update) {
+			consumer.put_next_copy(update);
+		}, lifetime);
+		return lifetime;
+	};
 }
 
 rpl::producer<PeerUpdate> PeerUpdateValue(
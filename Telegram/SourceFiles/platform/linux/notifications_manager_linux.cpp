@@ -14,11 +14,22 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "lang/lang_keys.h"
 #include "facades.h"
 
+#include <crl/crl_queue.h>
+
 namespace Platform {
 namespace Notifications {
 #ifndef TDESKTOP_DISABLE_GTK_INTEGRATION
 namespace {
 
+// Decoded userpics sent to the daemon, they are dropped all at once.
+constexpr auto kMaxCachedImages = 32;
+
+// All the calls that talk to the notification daemon are made here.
+crl::queue &Queue() {
+	static auto result = crl::queue();
+	return result;
+}
+
 bool LibNotifyLoaded() {
 	return (Libs::notify_init != nullptr)
 		&& (Libs::notify_uninit != nullptr)
@@ -89,7 +100,9 @@ QString escapeHtml(const QString &text) {
 class NotificationData {
 public:
 	NotificationData(const std::shared_ptr<Manager*> &guarded, const QString &title, const QString &body, const QStringList &capabilities, PeerId peerId, MsgId msgId)
-	: _data(Libs::notify_notification_new(title.toUtf8().constData(), body.toUtf8().constData(), nullptr)) {
+	: _data(Libs::notify_notification_new(title.toUtf8().constData(), body.toUtf8().constData(), nullptr))
+	, _peerId(peerId)
+	, _msgId(msgId) {
 		if (valid()) {
 			init(guarded, capabilities, peerId, msgId);
 		}
@@ -97,17 +110,19 @@ public:
 	bool valid() const {
 		return (_data != nullptr);
 	}
+	PeerId peerId() const {
+		return _peerId;
+	}
+	MsgId msgId() const {
+		return _msgId;
+	}
 	NotificationData(const NotificationData &other) = delete;
 	NotificationData &operator=(const NotificationData &other) = delete;
 	NotificationData(NotificationData &&other) = delete;
 	NotificationData &operator=(NotificationData &&other) = delete;
 
-	void setImage(const QString &imagePath) {
-		auto imagePathNative = QFile::encodeName(imagePath);
-		if (auto pixbuf = Libs::gdk_pixbuf_new_from_file(imagePathNative.constData(), nullptr)) {
-			Libs::notify_notification_set_image_from_pixbuf(_data, pixbuf);
-			Libs::g_object_unref(Libs::g_object_cast(pixbuf));
-		}
+	void setImage(GdkPixbuf *pixbuf) {
+		Libs::notify_notification_set_image_from_pixbuf(_data, pixbuf);
 	}
 	bool show() {
 		if (valid()) {
@@ -222,12 +237,74 @@ private:
 	}
 
 	Libs::NotifyNotification *_data = nullptr;
+	const PeerId _peerId = 0;
+	const MsgId _msgId = 0;
 	gulong _handlerId = 0;
 
 };
 
 using Notification = std::shared_ptr<NotificationData>;
 
+// Used only from Queue().
+class Worker final {
+public:
+	Worker() = default;
+	Worker(const Worker &other) = delete;
+	Worker &operator=(const Worker &other) = delete;
+	~Worker();
+
+	bool show(const Notification &notification, const QString &imagePath);
+	void close(const Notification &notification);
+
+private:
+	GdkPixbuf *image(const QString &path);
+	void clearImages();
+
+	base::flat_map<QString, GdkPixbuf*> _images;
+
+};
+
+Worker::~Worker() {
+	clearImages();
+}
+
+bool Worker::show(
+		const Notification &notification,
+		const QString &imagePath) {
+	if (const auto pixbuf = image(imagePath)) {
+		notification->setImage(pixbuf);
+	}
+	return notification->show();
+}
+
+void Worker::close(const Notification &notification) {
+	notification->close();
+}
+
+GdkPixbuf *Worker::image(const QString &path) {
+	const auto i = _images.find(path);
+	if (i != end(_images)) {
+		return i->second;
+	}
+	const auto native = QFile::encodeName(path);
+	const auto result = Libs::gdk_pixbuf_new_from_file(
+		native.constData(),
+		nullptr);
+	if (result) {
+		if (_images.size() >= kMaxCachedImages) {
+			clearImages();
+		}
+		_images.emplace(path, result);
+	}
+	return result;
+}
+
+void Worker::clearImages() {
+	for (const auto &[path, pixbuf] : base::take(_images)) {
+		Libs::g_object_unref(Libs::g_object_cast(pixbuf));
+	}
+}
+
 QString GetServerName() {
 	if (!LibNotifyLoaded()) {
 		return QString();
@@ -288,9 +365,12 @@ std::unique_ptr<Window::Notifications::Manager> Create(Window::Notifications::Sy
 void Finish() {
 #ifndef TDESKTOP_DISABLE_GTK_INTEGRATION
 	if (Libs::notify_is_initted && Libs::notify_uninit) {
-		if (Libs::notify_is_initted()) {
-			Libs::notify_uninit();
-		}
+		// Wait for the closes sent by the destroyed manager.
+		Queue().sync([] {
+			if (Libs::notify_is_initted()) {
+				Libs::notify_uninit();
+			}
+		});
 	}
 #endif // !TDESKTOP_DISABLE_GTK_INTEGRATION
 }
@@ -330,6 +410,13 @@ private:
 	QString escapeNotificationText(const QString &text) const;
 	void showNextNotification();
 
+	// Closes and shows are sent to the queue once an event loop iteration,
+	// a newer notification for the same peer replaces the waiting one.
+	void sendToDaemon(const Notification &show, const QString &imagePath);
+	void closeInDaemon(const Notification &close);
+	void flushToDaemon();
+	void showFailed(PeerId peerId, MsgId msgId);
+
 	struct QueuedNotification {
 		PeerData *peer = nullptr;
 		MsgId msgId = 0;
@@ -347,6 +434,16 @@ private:
 	using Notifications = QMap<PeerId, QMap<MsgId, Notification>>;
 	Notifications _notifications;
 
+	struct PendingShow {
+		Notification notification;
+		MsgId msgId = 0;
+		QString imagePath;
+	};
+	base::flat_map<PeerId, PendingShow> _pendingShows;
+	std::vector<Notification> _pendingCloses;
+	bool _flushQueued = false;
+	std::shared_ptr<Worker> _worker;
+
 	Window::Notifications::CachedUserpics _cachedUserpics;
 	bool _actionsSupported = false;
 	bool _markupSupported = false;
@@ -360,6 +457,7 @@ private:
 #ifndef TDESKTOP_DISABLE_GTK_INTEGRATION
 void Manager::Private::init(Manager *manager) {
 	_guarded = std::make_shared<Manager*>(manager);
+	_worker = std::make_shared<Worker>();
 
 	if (auto capabilities = Libs::notify_get_server_caps()) {
 		for (auto capability = capabilities; capability; capability = capability->next) {
@@ -458,7 +556,7 @@ void Manager::Private::showNextNotification() {
 	const auto key = data.hideNameAndPhoto
 		? InMemoryKey()
 		: data.peer->userpicUniqueKey();
-	notification->setImage(_cachedUserpics.get(key, data.peer));
+	const auto imagePath = _cachedUserpics.get(key, data.peer);
 
 	auto i = _notifications.find(peerId);
 	if (i != _notifications.cend()) {
@@ -466,7 +564,7 @@ void Manager::Private::showNextNotification() {
 		if (j != i->cend()) {
 			auto oldNotification = j.value();
 			i->erase(j);
-			oldNotification->close();
+			closeInDaemon(oldNotification);
 			i = _notifications.find(peerId);
 		}
 	}
@@ -474,14 +572,80 @@ void Manager::Private::showNextNotification() {
 		i = _notifications.insert(peerId, QMap<MsgId, Notification>());
 	}
 	_notifications[peerId].insert(msgId, notification);
-	if (!notification->show()) {
-		i = _notifications.find(peerId);
-		if (i != _notifications.cend()) {
-			i->remove(msgId);
-			if (i->isEmpty()) _notifications.erase(i);
+	sendToDaemon(notification, imagePath);
+}
+
+void Manager::Private::sendToDaemon(
+		const Notification &show,
+		const QString &imagePath) {
+	const auto peerId = show->peerId();
+	const auto i = _pendingShows.find(peerId);
+	if (i != end(_pendingShows)) {
+		// The replaced one never reached the daemon, forget it.
+		const auto j = _notifications.find(peerId);
+		if (j != _notifications.cend()) {
+			j->remove(i->second.msgId);
+		}
+		i->second = PendingShow{ show, show->msgId(), imagePath };
+	} else {
+		_pendingShows.emplace(
+			peerId,
+			PendingShow{ show, show->msgId(), imagePath });
+	}
+	flushToDaemon();
+}
+
+void Manager::Private::closeInDaemon(const Notification &close) {
+	const auto i = _pendingShows.find(close->peerId());
+	if (i != end(_pendingShows) && i->second.notification == close) {
+		_pendingShows.erase(i);
+		return;
+	}
+	_pendingCloses.push_back(close);
+	flushToDaemon();
+}
+
+void Manager::Private::flushToDaemon() {
+	if (_flushQueued) {
+		return;
+	}
+	_flushQueued = true;
+	const auto weak = std::weak_ptr<Manager*>(_guarded);
+	crl::on_main(weak, [=] {
+		_flushQueued = false;
+		auto closes = base::take(_pendingCloses);
+		auto shows = base::take(_pendingShows);
+		if (closes.empty() && shows.empty()) {
+			return;
 		}
-		showNextNotification();
+		Queue().async([
+			=,
+			worker = _worker,
+			closes = std::move(closes),
+			shows = std::move(shows)
+		] {
+			for (const auto &notification : closes) {
+				worker->close(notification);
+			}
+			for (const auto &[peerId, pending] : shows) {
+				if (!worker->show(pending.notification, pending.imagePath)) {
+					const auto msgId = pending.msgId;
+					crl::on_main(weak, [=] {
+						showFailed(peerId, msgId);
+					});
+				}
+			}
+		});
+	});
+}
+
+void Manager::Private::showFailed(PeerId peerId, MsgId msgId) {
+	auto i = _notifications.find(peerId);
+	if (i != _notifications.cend()) {
+		i->remove(msgId);
+		if (i->isEmpty()) _notifications.erase(i);
 	}
+	showNextNotification();
 }
 
 void Manager::Private::clearAll() {
@@ -490,7 +654,7 @@ void Manager::Private::clearAll() {
 	auto temp = base::take(_notifications);
 	for_const (auto &notifications, temp) {
 		for_const (auto notification, notifications) {
-			notification->close();
+			closeInDaemon(notification);
 		}
 	}
 }
@@ -510,7 +674,7 @@ void Manager::Private::clearFromHistory(not_null<History*> history) {
 		_notifications.erase(i);
 
 		for_const (auto notification, temp) {
-			notification->close();
+			closeInDaemon(notification);
 		}
 	}
 
@@ -531,6 +695,19 @@ void Manager::Private::clearNotification(PeerId peerId, MsgId msgId) {
 
 Manager::Private::~Private() {
 	clearAll();
+
+	// The flush can't be invoked on main after the manager is destroyed.
+	_pendingShows.clear();
+	if (!_pendingCloses.empty()) {
+		Queue().async([
+			worker = _worker,
+			closes = base::take(_pendingCloses)
+		] {
+			for (const auto &notification : closes) {
+				worker->close(notification);
+			}
+		});
+	}
 }
 
 Manager::Manager(Window::Notifications::System *system) : NativeManager(system)
@@ -25,6 +25,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <QtCore/QVersionNumber>
 
 #include <sys/stat.h>
+#include <sys/resource.h>
 #include <sys/types.h>
 #include <cstdlib>
 #include <unistd.h>
@@ -232,6 +233,41 @@ void finish() {
 	Notifications::Finish();
 }
 
+std::optional<crl::time> ProcessCpuTime() {
+	auto usage = rusage();
+	if (getrusage(RUSAGE_SELF, &usage) != 0) {
+		return std::nullopt;
+	}
+	const auto ms = [](const timeval &value) {
+		return crl::time(value.tv_sec) * 1000 + value.tv_usec / 1000;
+	};
+	return ms(usage.ru_utime) + ms(usage.ru_stime);
+}
+
+std::optional<bool> PhysicalMemoryLow() {
+	auto file = QFile(qsl("/proc/meminfo"));
+	if (!file.open(QIODevice::ReadOnly)) {
+		return std::nullopt;
+	}
+	auto total = int64(-1);
+	auto available = int64(-1);
+	const auto lines = QString::fromLatin1(file.readAll()).split('\n');
+	for (const auto &line : lines) {
+		const auto parts = line.simplified().split(' ');
+		if (parts.size() < 2) {
+			continue;
+		} else if (parts[0] == qstr("MemTotal:")) {
+			total = parts[1].toLongLong();
+		} else if (parts[0] == qstr("MemAvailable:")) {
+			available = parts[1].toLongLong();
+		}
+	}
+	if (total <= 0 || available < 0) {
+		return std::nullopt;
+	}
+	return (available * 10 < total);
+}
+
 void RegisterCustomScheme() {
 #ifndef TDESKTOP_DISABLE_REGISTER_CUSTOM_SCHEME
 	auto home = getHomeDir();
@@ -25,6 +25,9 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <cstdlib>
 #include <execinfo.h>
 #include <sys/xattr.h>
+#include <sys/resource.h>
+#include <sys/sysctl.h>
+#include <mach/mach.h>
 
 #include <Cocoa/Cocoa.h>
 #include <CoreFoundation/CFURL.h>
@@ -196,6 +199,41 @@ bool OpenSystemSettings(SystemSettingsType type) {
 	return true;
 }
 
+std::optional<crl::time> ProcessCpuTime() {
+	auto usage = rusage();
+	if (getrusage(RUSAGE_SELF, &usage) != 0) {
+		return std::nullopt;
+	}
+	const auto ms = [](const timeval &value) {
+		return crl::time(value.tv_sec) * 1000 + value.tv_usec / 1000;
+	};
+	return ms(usage.ru_utime) + ms(usage.ru_stime);
+}
+
+std::optional<bool> PhysicalMemoryLow() {
+	auto total = uint64();
+	auto size = sizeof(total);
+	if (sysctlbyname("hw.memsize", &total, &size, nullptr, 0) != 0
+		|| !total) {
+		return std::nullopt;
+	}
+	auto page = vm_size_t();
+	auto statistics = vm_statistics64_data_t();
+	auto count = mach_msg_type_number_t(HOST_VM_INFO64_COUNT);
+	const auto host = mach_host_self();
+	if (host_page_size(host, &page) != KERN_SUCCESS
+		|| host_statistics64(
+			host,
+			HOST_VM_INFO64,
+			host_info64_t(&statistics),
+			&count) != KERN_SUCCESS) {
+		return std::nullopt;
+	}
+	const auto available = uint64(statistics.free_count
+		+ statistics.inactive_count) * page;
+	return (available * 10 < total);
+}
+
 // Taken from https://github.com/trueinteractions/tint/issues/53.
 std::optional<crl::time> LastUserInputTime() {
 	CFMutableDictionaryRef properties = 0;
@@ -39,6 +39,12 @@ bool OpenSystemSettings(SystemSettingsType type);
 	return LastUserInputTime().has_value();
 }
 
+// User and system CPU time used by all the threads of the process.
+[[nodiscard]] std::optional<crl::time> ProcessCpuTime();
+
+// Whether the system is running out of physical memory.
+[[nodiscard]] std::optional<bool> PhysicalMemoryLow();
+
 void IgnoreApplicationActivationRightNow();
 
 namespace ThirdParty {
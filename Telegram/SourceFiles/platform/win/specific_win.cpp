@@ -324,6 +324,36 @@ QString CurrentExecutablePath(int argc, char *argv[]) {
 	return QString();
 }
 
+std::optional<crl::time> ProcessCpuTime() {
+	auto creation = FILETIME();
+	auto exit = FILETIME();
+	auto kernel = FILETIME();
+	auto user = FILETIME();
+	if (!GetProcessTimes(
+			GetCurrentProcess(),
+			&creation,
+			&exit,
+			&kernel,
+			&user)) {
+		return std::nullopt;
+	}
+	const auto ms = [](const FILETIME &value) {
+		const auto ticks = (uint64(value.dwHighDateTime) << 32)
+			| uint64(value.dwLowDateTime);
+		return crl::time(ticks / 10000); // 100ns ticks.
+	};
+	return ms(kernel) + ms(user);
+}
+
+std::optional<bool> PhysicalMemoryLow() {
+	auto status = MEMORYSTATUSEX();
+	status.dwLength = sizeof(MEMORYSTATUSEX);
+	if (!GlobalMemoryStatusEx(&status)) {
+		return std::nullopt;
+	}
+	return (status.dwMemoryLoad >= 90);
+}
+
 std::optional<crl::time> LastUserInputTime() {
 	auto lii = LASTINPUTINFO{ 0 };
 	lii.cbSize = sizeof(LASTINPUTINFO);
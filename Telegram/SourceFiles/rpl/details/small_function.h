@@ -0,0 +1,255 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace rpl {
+namespace details {
+
+// Callables up to this size are kept inline, larger ones are allocated.
+// Most lifetime callbacks and leaf generators capture one or two
+// pointers, like a consumer or a weak pointer to an event stream.
+constexpr auto kSmallFunctionSize = 3 * sizeof(void*);
+
+template <typename Callable>
+constexpr bool small_function_inline_v
+	= (sizeof(Callable) <= kSmallFunctionSize)
+	&& (alignof(Callable) <= alignof(void*))
+	&& std::is_nothrow_move_constructible_v<Callable>;
+
+template <typename Return, typename ...Args>
+class small_function_base {
+public:
+	small_function_base() = default;
+	small_function_base(const small_function_base &other) = delete;
+	small_function_base &operator=(
+		const small_function_base &other) = delete;
+
+	~small_function_base() {
+		reset();
+	}
+
+	Return operator()(Args ...args) {
+		return _methods->call(&_storage, std::forward<Args>(args)...);
+	}
+
+	bool empty() const {
+		return !_methods;
+	}
+
+protected:
+	struct methods {
+		Return (*call)(void *storage, Args &&...args);
+		void (*move)(void *from, void *to) noexcept;
+		void (*copy)(const void *from, void *to);
+		void (*destroy)(void *storage) noexcept;
+	};
+
+	template <typename Callable>
+	struct inline_methods {
+		static Callable *get(void *storage) {
+			return reinterpret_cast<Callable*>(storage);
+		}
+		static Return call(void *storage, Args &&...args) {
+			return (*get(storage))(std::forward<Args>(args)...);
+		}
+		static void move(void *from, void *to) noexcept {
+			new (to) Callable(std::move(*get(from)));
+			get(from)->~Callable();
+		}
+		static void copy(const void *from, void *to) {
+			new (to) Callable(*get(const_cast<void*>(from)));
+		}
+		static void destroy(void *storage) noexcept {
+			get(storage)->~Callable();
+		}
+	};
+
+	template <typename Callable>
+	struct heap_methods {
+		static Callable *&get(void *storage) {
+			return *reinterpret_cast<Callable**>(storage);
+		}
+		static Return call(void *storage, Args &&...args) {
+			return (*get(storage))(std::forward<Args>(args)...);
+		}
+		static void move(void *from, void *to) noexcept {
+			new (to) Callable*(std::exchange(get(from), nullptr));
+		}
+		static void copy(const void *from, void *to) {
+			new (to) Callable*(new Callable(*get(const_cast<void*>(from))));
+		}
+		static void destroy(void *storage) noexcept {
+			delete get(storage);
+		}
+	};
+
+	template <typename Callable, bool Copyable>
+	static const methods *methods_for() {
+		using Implementation = std::conditional_t<
+			small_function_inline_v<Callable>,
+			inline_methods<Callable>,
+			heap_methods<Callable>>;
+		static constexpr auto result = methods{
+			&Implementation::call,
+			&Implementation::move,
+			Copyable ? &Implementation::copy : nullptr,
+			&Implementation::destroy,
+		};
+		return &result;
+	}
+
+	template <typename Callable, bool Copyable, typename Other>
+	void construct(Other &&callable) {
+		if constexpr (small_function_inline_v<Callable>) {
+			new (&_storage) Callable(std::forward<Other>(callable));
+		} else {
+			new (&_storage) Callable*(
+				new Callable(std::forward<Other>(callable)));
+		}
+		_methods = methods_for<Callable, Copyable>();
+	}
+
+	void move_from(small_function_base &other) noexcept {
+		if (other._methods) {
+			other._methods->move(&other._storage, &_storage);
+			_methods = std::exchange(other._methods, nullptr);
+		}
+	}
+
+	void copy_from(const small_function_base &other) {
+		if (other._methods) {
+			other._methods->copy(&other._storage, &_storage);
+			_methods = other._methods;
+		}
+	}
+
+	void reset() {
+		if (_methods) {
+			std::exchange(_methods, nullptr)->destroy(&_storage);
+		}
+	}
+
+private:
+	std::aligned_storage_t<kSmallFunctionSize, alignof(void*)> _storage;
+	const methods *_methods = nullptr;
+
+};
+
+template <typename Function>
+class small_function;
+
+// A move-only std::function replacement without allocations
+// for the small callables.
+template <typename Return, typename ...Args>
+class small_function<Return(Args...)> final
+: public small_function_base<Return, Args...> {
+public:
+	small_function(std::nullptr_t = nullptr) noexcept {
+	}
+
+	template <
+		typename Callable,
+		typename Decayed = std::decay_t<Callable>,
+		typename = std::enable_if_t<
+			!std::is_same_v<Decayed, small_function>
+			&& std::is_convertible_v<
+				decltype(std::declval<Decayed&>()(
+					std::declval<Args>()...)),
+				Return>>>
+	small_function(Callable &&callable) {
+		this->template construct<Decayed, false>(
+			std::forward<Callable>(callable));
+	}
+
+	small_function(small_function &&other) noexcept {
+		this->move_from(other);
+	}
+	small_function &operator=(small_function &&other) noexcept {
+		if (this != &other) {
+			this->reset();
+			this->move_from(other);
+		}
+		return *this;
+	}
+	small_function &operator=(std::nullptr_t) noexcept {
+		this->reset();
+		return *this;
+	}
+
+	explicit operator bool() const {
+		return !this->empty();
+	}
+
+};
+
+// The same, but copyable, for the callables that can be copied.
+template <typename Function>
+class small_copyable_function;
+
+template <typename Return, typename ...Args>
+class small_copyable_function<Return(Args...)> final
+: public small_function_base<Return, Args...> {
+public:
+	small_copyable_function(std::nullptr_t = nullptr) noexcept {
+	}
+
+	template <
+		typename Callable,
+		typename Decayed = std::decay_t<Callable>,
+		typename = std::enable_if_t<
+			!std::is_same_v<Decayed, small_copyable_function>
+			&& std::is_copy_constructible_v<Decayed>
+			&& std::is_convertible_v<
+				decltype(std::declval<Decayed&>()(
+					std::declval<Args>()...)),
+				Return>>>
+	small_copyable_function(Callable &&callable) {
+		this->template construct<Decayed, true>(
+			std::forward<Callable>(callable));
+	}
+
+	small_copyable_function(const small_copyable_function &other) {
+		this->copy_from(other);
+	}
+	small_copyable_function(small_copyable_function &&other) noexcept {
+		this->move_from(other);
+	}
+	small_copyable_function &operator=(
+			const small_copyable_function &other) {
+		if (this != &other) {
+			auto copy = other;
+			*this = std::move(copy);
+		}
+		return *this;
+	}
+	small_copyable_function &operator=(
+			small_copyable_function &&other) noexcept {
+		if (this != &other) {
+			this->reset();
+			this->move_from(other);
+		}
+		return *this;
+	}
+	small_copyable_function &operator=(std::nullptr_t) noexcept {
+		this->reset();
+		return *this;
+	}
+
+	explicit operator bool() const {
+		return !this->empty();
+	}
+
+};
+
+} // namespace details
+} // namespace rpl
@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #pragma once
 
 #include "base/unique_function.h"
+#include <rpl/details/small_function.h>
 #include <vector>
 
 namespace rpl {
@@ -48,7 +49,7 @@ public:
 	}
 
 private:
-	std::vector<base::unique_function<void()>> _callbacks;
+	std::vector<details::small_function<void()>> _callbacks;
 
 };
 
@@ -73,6 +74,11 @@ inline void lifetime::add(Destroy &&destroy) {
 }
 
 inline void lifetime::add(lifetime &&other) {
+	if (_callbacks.empty()) {
+		// Most consumers get the lifetime of a single producer.
+		_callbacks = details::take(other._callbacks);
+		return;
+	}
 	auto callbacks = details::take(other._callbacks);
 	_callbacks.insert(
 		_callbacks.end(),
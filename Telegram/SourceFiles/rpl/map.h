@@ -62,6 +62,71 @@ map_transform(
 	return { std::move(transform), consumer };
 }
 
+template <typename Initial, typename Transform>
+class map_generator {
+public:
+	map_generator(Initial &&initial, Transform &&transform)
+	: _initial(std::move(initial))
+	, _transform(std::move(transform)) {
+	}
+
+	template <typename Consumer>
+	lifetime operator()(const Consumer &consumer) {
+		return std::move(_initial).start(
+		map_transform(
+			std::move(_transform),
+			consumer
+		), [consumer](auto &&error) {
+			consumer.put_error_forward(
+				std::forward<decltype(error)>(error));
+		}, [consumer] {
+			consumer.put_done();
+		});
+	}
+
+private:
+	Initial _initial;
+	Transform _transform;
+
+	template <typename OtherTransform>
+	friend class map_helper;
+
+};
+
+// Applies two adjacent map() transforms in a single subscription.
+template <typename First, typename Second>
+class map_composed_transform {
+public:
+	map_composed_transform(First &&first, Second &&second)
+	: _first(std::move(first))
+	, _second(std::move(second)) {
+	}
+
+	template <
+		typename Value,
+		typename = std::enable_if_t<
+			std::is_rvalue_reference_v<Value&&>>>
+	decltype(auto) operator()(Value &&value) const {
+		return details::callable_invoke(
+			_second,
+			details::callable_invoke(_first, std::move(value)));
+	}
+	template <
+		typename Value,
+		typename = decltype(
+			std::declval<First>()(const_ref_val<Value>()))>
+	decltype(auto) operator()(const Value &value) const {
+		return details::callable_invoke(
+			_second,
+			details::callable_invoke(_first, value));
+	}
+
+private:
+	First _first;
+	Second _second;
+
+};
+
 template <typename Transform>
 class map_helper {
 public:
@@ -78,21 +143,36 @@ public:
 			Transform,
 			Value>>
 	auto operator()(producer<Value, Error, Generator> &&initial) {
-		return make_producer<NewValue, Error>([
-			initial = std::move(initial),
-			transform = std::move(_transform)
-		](const auto &consumer) mutable {
-			return std::move(initial).start(
-			map_transform(
-				std::move(transform),
-				consumer
-			), [consumer](auto &&error) {
-				consumer.put_error_forward(
-					std::forward<decltype(error)>(error));
-			}, [consumer] {
-				consumer.put_done();
-			});
-		});
+		using Initial = producer<Value, Error, Generator>;
+		using Result = map_generator<Initial, Transform>;
+		return producer<NewValue, Error, Result>(Result(
+			std::move(initial),
+			std::move(_transform)));
+	}
+
+	// A map() of a map() is fused, unless the new transform returns
+	// a reference that could outlive the intermediate value.
+	template <
+		typename Value,
+		typename Error,
+		typename Initial,
+		typename Previous,
+		typename NewValue = details::callable_result<
+			Transform,
+			Value>,
+		typename = std::enable_if_t<!std::is_reference_v<NewValue>>>
+	auto operator()(producer<
+			Value,
+			Error,
+			map_generator<Initial, Previous>> &&initial) {
+		using Composed = map_composed_transform<Previous, Transform>;
+		using Result = map_generator<Initial, Composed>;
+		auto &previous = initial._generator;
+		return producer<NewValue, Error, Result>(Result(
+			std::move(previous._initial),
+			Composed(
+				std::move(previous._transform),
+				std::move(_transform))));
 	}
 
 private:
@@ -158,6 +158,50 @@ TEST_CASE("basic operators tests", "[rpl::operators]") {
 		REQUIRE(*sum == "1 2 3 4 5 ");
 	}
 
+	SECTION("map of map test") {
+		auto sum = std::make_shared<std::string>("");
+		auto invoked = std::make_shared<int>(0);
+		{
+			rpl::lifetime lifetime;
+			event_stream<int> stream;
+			stream.events()
+				| map([](int value) {
+					return value * 2;
+				})
+				| map([](const int &value) {
+					return std::to_string(value);
+				})
+				| map([](std::string &&value) {
+					return value + ' ';
+				})
+				| start_with_next([=](std::string &&value) {
+					*sum += std::move(value);
+				}, lifetime);
+			stream.fire(1);
+			stream.fire_copy(2);
+			stream.fire(3);
+
+			// The second subscription to the same producer.
+			const auto doubled = stream.events()
+				| map([=](int value) {
+					++*invoked;
+					return value * 2;
+				});
+			rpl::duplicate(doubled)
+				| map([](int value) { return value + 1; })
+				| start_with_next([=](int value) {
+					*sum += std::to_string(value);
+				}, lifetime);
+			rpl::duplicate(doubled)
+				| start_with_next([=](int value) {
+					*sum += std::to_string(value);
+				}, lifetime);
+			stream.fire(4);
+		}
+		REQUIRE(*sum == "2 4 6 8 98");
+		REQUIRE(*invoked == 2);
+	}
+
 	SECTION("deferred test") {
 		auto launched = std::make_shared<int>(0);
 		auto checked = std::make_shared<int>(0);
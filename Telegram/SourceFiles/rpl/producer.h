@@ -12,6 +12,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <rpl/lifetime.h>
 #include <rpl/details/superset_type.h>
 #include <rpl/details/callable.h>
+#include <rpl/details/small_function.h>
 
 #if defined _DEBUG || defined COMPILER_MSVC
 #define RPL_PRODUCER_TYPE_ERASED_ALWAYS
@@ -23,31 +24,10 @@ namespace details {
 template <typename Value, typename Error>
 const consumer<Value, Error> &const_ref_consumer();
 
-template <typename Lambda>
-class mutable_lambda_wrap {
-public:
-	mutable_lambda_wrap(Lambda &&lambda)
-		: _lambda(std::move(lambda)) {
-	}
-	mutable_lambda_wrap(const mutable_lambda_wrap &other) = default;
-	mutable_lambda_wrap(mutable_lambda_wrap &&other) = default;
-	mutable_lambda_wrap &operator=(
-		const mutable_lambda_wrap &other) = default;
-	mutable_lambda_wrap &operator=(
-		mutable_lambda_wrap &&other) = default;
-
-	template <typename... Args>
-	auto operator()(Args&&... args) const {
-		return (const_cast<mutable_lambda_wrap*>(this)->_lambda)(
-			std::forward<Args>(args)...);
-	}
-
-private:
-	Lambda _lambda;
-
-};
+template <typename Transform>
+class map_helper;
 
-// Type-erased copyable mutable function using std::function.
+// Type-erased copyable mutable function, small generators are kept inline.
 template <typename Value, typename Error>
 class type_erased_generator final {
 public:
@@ -82,8 +62,8 @@ public:
 			!std::is_same_v<
 				std::decay_t<Generator>,
 				type_erased_generator>>>
-	type_erased_generator(Generator other) : _implementation(
-		mutable_lambda_wrap<Generator>(std::move(other))) {
+	type_erased_generator(Generator other)
+	: _implementation(std::move(other)) {
 	}
 	template <
 		typename Generator,
@@ -96,8 +76,7 @@ public:
 				std::decay_t<Generator>,
 				type_erased_generator>>>
 	type_erased_generator &operator=(Generator other) {
-		_implementation = mutable_lambda_wrap<Generator>(
-			std::move(other));
+		_implementation = std::move(other);
 		return *this;
 	}
 
@@ -111,7 +90,9 @@ public:
 	}
 
 private:
-	std::function<lifetime(const consumer_type<type_erased_handlers<Value, Error>> &)> _implementation;
+	small_copyable_function<lifetime(
+		const consumer_type<type_erased_handlers<Value, Error>> &)
+	> _implementation;
 
 };
 
@@ -255,6 +236,9 @@ private:
 		typename OtherGenerator>
 	friend class ::rpl::producer;
 
+	template <typename Transform>
+	friend class map_helper;
+
 };
 
 template <typename Value, typename Error, typename Generator>
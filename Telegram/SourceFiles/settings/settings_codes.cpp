@@ -12,6 +12,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mainwidget.h"
 #include "data/data_session.h"
 #include "storage/localstorage.h"
+#include "storage/cache/storage_cache_database.h"
 #include "boxes/confirm_box.h"
 #include "lang/lang_cloud_manager.h"
 #include "lang/lang_instance.h"
@@ -20,9 +21,16 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mtproto/dc_options.h"
 #include "core/file_utilities.h"
 #include "core/update_checker.h"
+#include "core/core_startup_timeline.h"
+#include "core/core_memory_usage.h"
+#include "core/core_jank.h"
+#include "core/sandbox.h"
+#include "storage/file_download.h"
+#include "main/main_session.h"
 #include "window/themes/window_theme.h"
 #include "window/themes/window_theme_editor.h"
 #include "media/audio/media_audio_track.h"
+#include "base/tracing.h"
 #include "facades.h"
 
 namespace Settings {
@@ -41,6 +49,27 @@ auto GenerateCodes() {
 	codes.emplace(qsl("viewlogs"), [](::Main::Session *session) {
 		File::ShowInFolder(cWorkingDir() + "log.txt");
 	});
+	codes.emplace(qsl("tracing"), [](::Main::Session *session) {
+		if (!base::tracing::Enabled()) {
+			Ui::show(Box<ConfirmBox>(qsl("Do you want to start tracing?\n\n"
+				"Type this code again to save the trace."), [] {
+				base::tracing::SetEnabled(true);
+				Ui::hideLayer();
+			}));
+			return;
+		}
+		base::tracing::SetEnabled(false);
+		const auto path = cWorkingDir() + qsl("trace.json");
+		QFile f(path);
+		if (!f.open(QIODevice::WriteOnly)) {
+			Ui::show(Box<InformBox>(qsl("Could not write the trace.")));
+			return;
+		}
+		const auto json = base::tracing::ExportChromeJson();
+		f.write(json.data(), json.size());
+		f.close();
+		File::ShowInFolder(path);
+	});
 	codes.emplace(qsl("testmode"), [](::Main::Session *session) {
 		auto text = cTestMode() ? qsl("Do you want to disable TEST mode?") : qsl("Do you want to enable TEST mode?\n\nYou will be switched to test cloud.");
 		Ui::show(Box<ConfirmBox>(text, [] {
@@ -103,6 +132,21 @@ auto GenerateCodes() {
 			Ui::hideLayer();
 		}));
 	});
+	codes.emplace(qsl("paintcache"), [](::Main::Session *session) {
+		if (!session) {
+			return;
+		}
+		const auto enabled = session->settings().historyPaintCache();
+		auto text = enabled
+			? qsl("Disable the chat paint cache?")
+			: qsl("Enable the chat paint cache?\n\n"
+				"Messages will be drawn from cached images while scrolling.");
+		Ui::show(Box<ConfirmBox>(text, [=] {
+			session->settings().setHistoryPaintCache(!enabled);
+			session->saveSettingsDelayed();
+			Ui::hideLayer();
+		}));
+	});
 	codes.emplace(qsl("endpoints"), [](::Main::Session *session) {
 		FileDialog::GetOpenPath(Core::App().getFileDialogParent(), "Open DC endpoints", "DC Endpoints (*.tdesktop-endpoints)", [](const FileDialog::OpenResult &result) {
 			if (!result.paths.isEmpty()) {
@@ -149,6 +193,96 @@ auto GenerateCodes() {
 			}));
 		});
 	}
+	codes.emplace(qsl("cachestats"), [](::Main::Session *session) {
+		if (!session) {
+			return;
+		}
+		rpl::combine(
+			session->data().cache().statsOnMain(),
+			session->data().cacheBigFile().statsOnMain()
+		) | rpl::take(
+			1
+		) | rpl::start_with_next([](
+				Storage::Cache::Database::Stats &&cache,
+				Storage::Cache::Database::Stats &&big) {
+			const auto text = "Cache:\n"
+				+ Storage::Cache::FormatStats(cache)
+				+ "\n\nBig files cache:\n"
+				+ Storage::Cache::FormatStats(big);
+			LOG(("Cache stats:\n%1").arg(text));
+			Ui::show(Box<InformBox>(text));
+		}, session->lifetime());
+	});
+	codes.emplace(qsl("startup"), [](::Main::Session *session) {
+		Ui::show(Box<InformBox>(Core::StartupTimelineText()));
+	});
+	codes.emplace(qsl("memory"), [](::Main::Session *session) {
+		Ui::show(Box<InformBox>(Core::MemoryUsageText()));
+	});
+	codes.emplace(qsl("jank"), [](::Main::Session *session) {
+		auto &sandbox = Core::Sandbox::Instance();
+		const auto watchdog = sandbox.jankWatchdog();
+		if (!watchdog) {
+			Ui::show(Box<ConfirmBox>(qsl("Do you want to count "
+				"the main thread stalls?\n\n"
+				"Type this code again to see them."), [] {
+				Core::Sandbox::Instance().setJankWatchdogEnabled(true);
+				Ui::hideLayer();
+			}));
+			return;
+		}
+		const auto text = watchdog->text();
+		sandbox.setJankWatchdogEnabled(false);
+		LOG(("Jank stats:\n%1").arg(text));
+		Ui::show(Box<InformBox>(text));
+	});
+	codes.emplace(qsl("frametimes"), [](::Main::Session *session) {
+		const auto enabled = !Core::FrameTimeOverlay::Enabled();
+		Core::FrameTimeOverlay::SetEnabled(enabled);
+		Ui::Toast::Show(enabled
+			? qsl("Frame times are shown.")
+			: qsl("Frame times are hidden."));
+	});
+	codes.emplace(qsl("bandwidth"), [](::Main::Session *session) {
+		if (!session) {
+			return;
+		}
+		// Cycle the total limit: none, 2 MB/s, 512 KB/s.
+		auto &bandwidth = session->downloader().bandwidth();
+		const auto now = bandwidth.totalLimit();
+		const auto next = !now
+			? int64(2 * 1024 * 1024)
+			: (now > 512 * 1024)
+			? int64(512 * 1024)
+			: int64(0);
+		bandwidth.setTotalLimit(next);
+
+		using Class = Storage::BandwidthClass;
+		const auto speed = [&](Class type) {
+			return QString::number(bandwidth.throughput(type) / 1024)
+				+ " KB/s";
+		};
+		Ui::show(Box<InformBox>(
+			"Total limit: " + (next
+				? (QString::number(next / 1024) + " KB/s")
+				: QString("none"))
+			+ "\n\nInteractive: " + speed(Class::Interactive)
+			+ "\nStreaming: " + speed(Class::Streaming)
+			+ "\nAuto-download: " + speed(Class::AutoDownload)
+			+ "\nUpload: " + speed(Class::Upload)));
+	});
+	codes.emplace(qsl("mtpstats"), [](::Main::Session *session) {
+		if (!session) {
+			return;
+		}
+		auto lines = QStringList();
+		for (const auto &stats : session->mtp()->sessionsStats()) {
+			lines.push_back(MTP::FormatSessionStats(stats));
+		}
+		const auto text = lines.join("\n\n");
+		LOG(("MTP Stats:\n%1").arg(text));
+		Ui::show(Box<InformBox>(text));
+	});
 	codes.emplace(qsl("sounds_reset"), [](::Main::Session *session) {
 		if (session) {
 			session->settings().clearSoundOverrides();
@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "storage/cache/storage_cache_database_object.h"
 #include "storage/cache/storage_cache_binlog_reader.h"
+#include "base/concurrent_timer.h"
 #include <unordered_set>
 
 namespace Storage {
@@ -41,6 +42,7 @@ private:
 	bool readHeader();
 	bool openCompact();
 	void parseChunk();
+	void scheduleChunk();
 	void fail();
 	void done(int64 till);
 	void finish();
@@ -76,6 +78,10 @@ private:
 	BinlogWrapper _wrapper;
 	size_type _partSize = 0;
 	std::unordered_set<Key> _written;
+	base::ConcurrentTimer _chunkTimer;
+	int64 _chunkStartRead = 0;
+	int64 _chunkStartWritten = 0;
+	crl::time _chunkStartTime = 0;
 	base::variant<
 		std::vector<MultiStore::Part>,
 		std::vector<MultiStoreWithTime::Part>> _list;
@@ -98,8 +104,10 @@ CompactorObject::CompactorObject(
 , _key(std::move(key))
 , _info(info)
 , _wrapper(_binlog, _settings, _info.till)
-, _partSize(_settings.maxBundledRecords) { // Perhaps a better estimate?
+, _partSize(_settings.maxBundledRecords) // Perhaps a better estimate?
+, _chunkTimer(_weak, [=] { parseChunk(); }) {
 	Expects(_settings.compactChunkSize > 0);
+	Expects(_settings.compactBytesPerSecond >= 0);
 
 	_written.reserve(_info.keysCount);
 	start();
@@ -297,6 +305,10 @@ bool CompactorObject::readBlock(std::vector<Key> &result) {
 }
 
 void CompactorObject::parseChunk() {
+	_chunkStartRead = _binlog.offset();
+	_chunkStartWritten = _compact.offset();
+	_chunkStartTime = crl::now();
+
 	auto keys = readChunk();
 	if (_wrapper.failed()) {
 		fail();
@@ -307,8 +319,10 @@ void CompactorObject::parseChunk() {
 	}
 	_database.with([
 		weak = _weak,
-		keys = std::move(keys)
+		keys = std::move(keys),
+		processed = _binlog.offset()
 	](DatabaseObject &database) {
+		database.compactorProgress(processed);
 		auto result = database.getManyRaw(keys);
 		weak.with([result = std::move(result)](CompactorObject &that) {
 			that.processValues(result);
@@ -328,7 +342,24 @@ void CompactorObject::processValues(
 			return;
 		}
 	}
-	parseChunk();
+	scheduleChunk();
+}
+
+void CompactorObject::scheduleChunk() {
+	const auto budget = _settings.compactBytesPerSecond;
+	if (!budget) {
+		parseChunk();
+		return;
+	}
+	const auto bytes = (_binlog.offset() - _chunkStartRead)
+		+ (_compact.offset() - _chunkStartWritten);
+	const auto required = crl::time(bytes * 1000 / budget);
+	const auto elapsed = crl::now() - _chunkStartTime;
+	if (required <= elapsed) {
+		parseChunk();
+	} else {
+		_chunkTimer.callOnce(required - elapsed);
+	}
 }
 
 auto CompactorObject::fillList(RawSpan values) -> RawSpan {
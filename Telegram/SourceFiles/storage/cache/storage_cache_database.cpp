@@ -8,48 +8,283 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "storage/cache/storage_cache_database.h"
 
 #include "storage/cache/storage_cache_database_object.h"
+#include <rpl/combine.h>
+#include <rpl/map.h>
+#include <QtCore/QMutex>
 
 namespace Storage {
 namespace Cache {
+namespace {
 
-Database::Database(const QString &path, const Settings &settings)
-: _wrapped(path, settings) {
+QString ComputeShardPath(const QString &path, int index) {
+	if (!index) {
+		return path;
+	}
+	auto result = path;
+	if (result.endsWith('/')) {
+		result.chop(1);
+	}
+	return result + '_' + QString::number(index);
+}
+
+details::Settings ComputeShardSettings(
+		const details::Settings &settings,
+		int count) {
+	auto result = settings;
+	result.totalSizeLimit /= count;
+	result.hotCacheSizeLimit /= count;
+	for (auto &[tag, limit] : result.hotCacheTagSizeLimits) {
+		limit /= count;
+	}
+	result.compactBytesPerSecond /= count;
+	return result;
+}
+
+details::SettingsUpdate ComputeShardSettingsUpdate(
+		const details::SettingsUpdate &update,
+		int count) {
+	auto result = update;
+	result.totalSizeLimit /= count;
+	return result;
+}
+
+details::Stats AccumulateStats(std::vector<details::Stats> &&list) {
+	auto result = details::Stats();
+	for (const auto &stats : list) {
+		result.full.count += stats.full.count;
+		result.full.totalSize += stats.full.totalSize;
+		result.full.hits += stats.full.hits;
+		for (const auto &[tag, summary] : stats.tagged) {
+			auto &accumulated = result.tagged[tag];
+			accumulated.count += summary.count;
+			accumulated.totalSize += summary.totalSize;
+			accumulated.hits += summary.hits;
+		}
+		result.misses += stats.misses;
+		result.latency.queue.accumulate(stats.latency.queue);
+		result.latency.get.accumulate(stats.latency.get);
+		result.latency.disk.accumulate(stats.latency.disk);
+		result.latency.decrypt.accumulate(stats.latency.decrypt);
+		result.latency.put.accumulate(stats.latency.put);
+		result.hot.count += stats.hot.count;
+		result.hot.totalSize += stats.hot.totalSize;
+		result.hot.hits += stats.hot.hits;
+		result.hot.misses += stats.hot.misses;
+		if (stats.compacting) {
+			if (!result.compacting) {
+				result.compacting = details::CompactSummary();
+			}
+			result.compacting->processed += stats.compacting->processed;
+			result.compacting->total += stats.compacting->total;
+		}
+		result.clearing = result.clearing || stats.clearing;
+	}
+	return result;
+}
+
+// Invokes the callback once with the first error after all shards are done.
+template <typename ...Args>
+class ShardsCollector {
+public:
+	ShardsCollector(int count, FnMut<void(Args...)> &&done)
+	: _left(count)
+	, _done(std::move(done)) {
+	}
+
+	void finish(Args ...args) {
+		auto done = FnMut<void(Args...)>();
+		{
+			QMutexLocker lock(&_mutex);
+			accumulate(args...);
+			if (--_left > 0) {
+				return;
+			}
+			done = std::move(_done);
+		}
+		if (done) {
+			finishWith(done);
+		}
+	}
+
+private:
+	void accumulate() {
+	}
+	void accumulate(Error error) {
+		if (_error.type == Error::Type::None) {
+			_error = error;
+		}
+	}
+	void finishWith(FnMut<void()> &done) {
+		done();
+	}
+	void finishWith(FnMut<void(Error)> &done) {
+		done(_error);
+	}
+
+	QMutex _mutex;
+	int _left = 0;
+	Error _error;
+	FnMut<void(Args...)> _done;
+
+};
+
+template <typename ...Args>
+std::vector<FnMut<void(Args...)>> SplitCallback(
+		int count,
+		FnMut<void(Args...)> &&done) {
+	auto result = std::vector<FnMut<void(Args...)>>();
+	result.reserve(count);
+	if (count == 1) {
+		result.push_back(std::move(done));
+		return result;
+	} else if (!done) {
+		result.resize(count);
+		return result;
+	}
+	const auto collector = std::make_shared<ShardsCollector<Args...>>(
+		count,
+		std::move(done));
+	for (auto i = 0; i != count; ++i) {
+		result.push_back([=](Args ...args) {
+			collector->finish(args...);
+		});
+	}
+	return result;
+}
+
+QString FormatLatency(
+		const QString &name,
+		const details::LatencySummary &summary) {
+	if (!summary.count) {
+		return name + ": none";
+	}
+	return name + QString(": count %1, average %2us, p50 <%3us, p99 <%4us"
+	).arg(summary.count
+	).arg(summary.total / summary.count
+	).arg(summary.percentile(50)
+	).arg(summary.percentile(99));
+}
+
+QString FormatTagged(
+		const QString &name,
+		const details::TaggedSummary &summary) {
+	return name + QString(": count %1, size %2, hits %3"
+	).arg(summary.count
+	).arg(summary.totalSize
+	).arg(summary.hits);
+}
+
+} // namespace
+
+QString FormatStats(const Database::Stats &stats) {
+	auto lines = QStringList();
+	lines.push_back(FormatTagged("Full", stats.full));
+	for (const auto &[tag, summary] : stats.tagged) {
+		const auto name = "Tag " + QString::number(tag);
+		lines.push_back(FormatTagged(name, summary));
+	}
+	const auto requests = stats.full.hits + stats.misses;
+	lines.push_back(QString("Misses: %1, hit ratio %2%"
+	).arg(stats.misses
+	).arg(requests ? (stats.full.hits * 100 / requests) : 0));
+	lines.push_back(QString("Hot: count %1, size %2, hits %3, misses %4"
+	).arg(stats.hot.count
+	).arg(stats.hot.totalSize
+	).arg(stats.hot.hits
+	).arg(stats.hot.misses));
+	lines.push_back(FormatLatency("Queue wait", stats.latency.queue));
+	lines.push_back(FormatLatency("Get", stats.latency.get));
+	lines.push_back(FormatLatency("Disk read", stats.latency.disk));
+	lines.push_back(FormatLatency("Decrypt", stats.latency.decrypt));
+	lines.push_back(FormatLatency("Put", stats.latency.put));
+	return lines.join('\n');
+}
+
+Database::Database(const QString &path, const Settings &settings) {
+	const auto count = std::max(settings.shardsCount, 1);
+	const auto shardSettings = ComputeShardSettings(settings, count);
+	_shards.reserve(count);
+	for (auto i = 0; i != count; ++i) {
+		_shards.push_back(std::make_unique<Shard>(
+			ComputeShardPath(path, i),
+			shardSettings));
+	}
+}
+
+auto Database::shard(const Key &key) -> Shard& {
+	const auto count = uint64(_shards.size());
+	if (count == 1) {
+		return *_shards.front();
+	}
+	const auto mixed = (key.high * 0x9E3779B97F4A7C15ULL) >> 32;
+	return *_shards[mixed % count];
+}
+
+template <typename Method>
+void Database::withEachShard(Method &&method) {
+	const auto count = int(_shards.size());
+	for (auto i = 0; i != count; ++i) {
+		method(*_shards[i], i);
+	}
 }
 
 void Database::reconfigure(const Settings &settings) {
-	_wrapped.with([settings](Implementation &unwrapped) mutable {
-		unwrapped.reconfigure(settings);
+	Expects(std::max(settings.shardsCount, 1) == int(_shards.size()));
+
+	const auto shardSettings = ComputeShardSettings(
+		settings,
+		int(_shards.size()));
+	withEachShard([&](Shard &shard, int index) {
+		shard.with([settings = shardSettings](
+				Implementation &unwrapped) mutable {
+			unwrapped.reconfigure(settings);
+		});
 	});
 }
 
 void Database::updateSettings(const SettingsUpdate &update) {
-	_wrapped.with([update](Implementation &unwrapped) mutable {
-		unwrapped.updateSettings(update);
+	const auto shardUpdate = ComputeShardSettingsUpdate(
+		update,
+		int(_shards.size()));
+	withEachShard([&](Shard &shard, int index) {
+		shard.with([update = shardUpdate](
+				Implementation &unwrapped) mutable {
+			unwrapped.updateSettings(update);
+		});
 	});
 }
 
 void Database::open(EncryptionKey &&key, FnMut<void(Error)> &&done) {
-	_wrapped.with([
-		key = std::move(key),
-		done = std::move(done)
-	](Implementation &unwrapped) mutable {
-		unwrapped.open(std::move(key), std::move(done));
+	auto callbacks = SplitCallback(int(_shards.size()), std::move(done));
+	withEachShard([&](Shard &shard, int index) {
+		shard.with([
+			key,
+			done = std::move(callbacks[index])
+		](Implementation &unwrapped) mutable {
+			unwrapped.open(std::move(key), std::move(done));
+		});
 	});
 }
 
 void Database::close(FnMut<void()> &&done) {
-	_wrapped.with([
-		done = std::move(done)
-	](Implementation &unwrapped) mutable {
-		unwrapped.close(std::move(done));
+	auto callbacks = SplitCallback(int(_shards.size()), std::move(done));
+	withEachShard([&](Shard &shard, int index) {
+		shard.with([
+			done = std::move(callbacks[index])
+		](Implementation &unwrapped) mutable {
+			unwrapped.close(std::move(done));
+		});
 	});
 }
 
 void Database::waitForCleaner(FnMut<void()> &&done) {
-	_wrapped.with([
-		done = std::move(done)
-	](Implementation &unwrapped) mutable {
-		unwrapped.waitForCleaner(std::move(done));
+	auto callbacks = SplitCallback(int(_shards.size()), std::move(done));
+	withEachShard([&](Shard &shard, int index) {
+		shard.with([
+			done = std::move(callbacks[index])
+		](Implementation &unwrapped) mutable {
+			unwrapped.waitForCleaner(std::move(done));
+		});
 	});
 }
 
@@ -72,7 +307,7 @@ void Database::get(const Key &key, FnMut<void(QByteArray&&)> &&done) {
 }
 
 void Database::remove(const Key &key, FnMut<void(Error)> &&done) {
-	_wrapped.with([
+	shard(key).with([
 		key,
 		done = std::move(done)
 	](Implementation &unwrapped) mutable {
@@ -94,12 +329,41 @@ void Database::copyIfEmpty(
 		const Key &from,
 		const Key &to,
 		FnMut<void(Error)> &&done) {
-	_wrapped.with([
+	auto &source = shard(from);
+	auto &destination = shard(to);
+	if (&source == &destination) {
+		source.with([
+			from,
+			to,
+			done = std::move(done)
+		](Implementation &unwrapped) mutable {
+			unwrapped.copyIfEmpty(from, to, std::move(done));
+		});
+		return;
+	}
+	source.with([
 		from,
 		to,
+		destination = destination.weak(),
 		done = std::move(done)
 	](Implementation &unwrapped) mutable {
-		unwrapped.copyIfEmpty(from, to, std::move(done));
+		auto found = TaggedValue();
+		unwrapped.get(from, [&](TaggedValue &&value) {
+			found = std::move(value);
+		});
+		if (found.bytes.isEmpty()) {
+			if (done) {
+				done(Error::NoError());
+			}
+			return;
+		}
+		destination.with([
+			to,
+			value = std::move(found),
+			done = std::move(done)
+		](Implementation &unwrapped) mutable {
+			unwrapped.putIfEmpty(to, std::move(value), std::move(done));
+		});
 	});
 }
 
@@ -107,12 +371,44 @@ void Database::moveIfEmpty(
 		const Key &from,
 		const Key &to,
 		FnMut<void(Error)> &&done) {
-	_wrapped.with([
+	auto &source = shard(from);
+	auto &destination = shard(to);
+	if (&source == &destination) {
+		source.with([
+			from,
+			to,
+			done = std::move(done)
+		](Implementation &unwrapped) mutable {
+			unwrapped.moveIfEmpty(from, to, std::move(done));
+		});
+		return;
+	}
+
+	// Between shards the value is copied and then removed from the source.
+	source.with([
 		from,
 		to,
+		destination = destination.weak(),
 		done = std::move(done)
 	](Implementation &unwrapped) mutable {
-		unwrapped.moveIfEmpty(from, to, std::move(done));
+		auto found = TaggedValue();
+		unwrapped.get(from, [&](TaggedValue &&value) {
+			found = std::move(value);
+		});
+		if (found.bytes.isEmpty()) {
+			if (done) {
+				done(Error::NoError());
+			}
+			return;
+		}
+		unwrapped.remove(from, nullptr);
+		destination.with([
+			to,
+			value = std::move(found),
+			done = std::move(done)
+		](Implementation &unwrapped) mutable {
+			unwrapped.putIfEmpty(to, std::move(value), std::move(done));
+		});
 	});
 }
 
@@ -120,11 +416,13 @@ void Database::put(
 		const Key &key,
 		TaggedValue &&value,
 		FnMut<void(Error)> &&done) {
-	_wrapped.with([
+	shard(key).with([
 		key,
 		value = std::move(value),
-		done = std::move(done)
+		done = std::move(done),
+		queued = crl::profile()
 	](Implementation &unwrapped) mutable {
+		unwrapped.recordQueueLatency(queued);
 		unwrapped.put(key, std::move(value), std::move(done));
 	});
 }
@@ -133,11 +431,13 @@ void Database::putIfEmpty(
 		const Key &key,
 		TaggedValue &&value,
 		FnMut<void(Error)> &&done) {
-	_wrapped.with([
+	shard(key).with([
 		key,
 		value = std::move(value),
-		done = std::move(done)
+		done = std::move(done),
+		queued = crl::profile()
 	](Implementation &unwrapped) mutable {
+		unwrapped.recordQueueLatency(queued);
 		unwrapped.putIfEmpty(key, std::move(value), std::move(done));
 	});
 }
@@ -145,19 +445,93 @@ void Database::putIfEmpty(
 void Database::getWithTag(
 		const Key &key,
 		FnMut<void(TaggedValue&&)> &&done) {
-	_wrapped.with([
+	shard(key).with([
 		key,
-		done = std::move(done)
+		done = std::move(done),
+		queued = crl::profile()
 	](Implementation &unwrapped) mutable {
+		unwrapped.recordQueueLatency(queued);
 		unwrapped.get(key, std::move(done));
 	});
 }
 
+void Database::getMany(
+		std::vector<Key> &&keys,
+		FnMut<void(std::vector<TaggedValue>&&)> &&done) {
+	if (_shards.size() == 1) {
+		_shards.front()->with([
+			keys = std::move(keys),
+			done = std::move(done),
+			queued = crl::profile()
+		](Implementation &unwrapped) mutable {
+			unwrapped.recordQueueLatency(queued);
+			unwrapped.getMany(std::move(keys), std::move(done));
+		});
+		return;
+	}
+
+	struct Collected {
+		QMutex mutex;
+		std::vector<TaggedValue> values;
+		int left = 0;
+		FnMut<void(std::vector<TaggedValue>&&)> done;
+	};
+	const auto collected = std::make_shared<Collected>();
+	collected->values.resize(keys.size());
+	collected->done = std::move(done);
+
+	auto parts = base::flat_map<Shard*, std::vector<size_type>>();
+	const auto count = size_type(keys.size());
+	for (auto index = size_type(); index != count; ++index) {
+		parts[&shard(keys[index])].push_back(index);
+	}
+	if (parts.empty()) {
+		if (collected->done) {
+			collected->done({});
+		}
+		return;
+	}
+	collected->left = int(parts.size());
+	for (auto &[shard, indices] : parts) {
+		auto list = std::vector<Key>();
+		list.reserve(indices.size());
+		for (const auto index : indices) {
+			list.push_back(keys[index]);
+		}
+		auto received = [=, indices = std::move(indices)](
+				std::vector<TaggedValue> &&values) mutable {
+			auto done = FnMut<void(std::vector<TaggedValue>&&)>();
+			{
+				QMutexLocker lock(&collected->mutex);
+				const auto count = int(indices.size());
+				for (auto i = 0; i != count; ++i) {
+					collected->values[indices[i]] = std::move(values[i]);
+				}
+				if (--collected->left > 0) {
+					return;
+				}
+				done = std::move(collected->done);
+			}
+			if (done) {
+				done(std::move(collected->values));
+			}
+		};
+		shard->with([
+			list = std::move(list),
+			done = std::move(received),
+			queued = crl::profile()
+		](Implementation &unwrapped) mutable {
+			unwrapped.recordQueueLatency(queued);
+			unwrapped.getMany(std::move(list), std::move(done));
+		});
+	}
+}
+
 void Database::getWithSizes(
 		const Key &key,
 		std::vector<Key> &&keys,
 		FnMut<void(QByteArray&&, std::vector<int>&&)> &&done) {
-	_wrapped.with([
+	shard(key).with([
 		key,
 		keys = std::move(keys),
 		done = std::move(done)
@@ -167,34 +541,55 @@ void Database::getWithSizes(
 }
 
 auto Database::statsOnMain() const -> rpl::producer<Stats> {
-	return _wrapped.producer_on_main([](const Implementation &unwrapped) {
-		return unwrapped.stats();
-	});
+	const auto producer = [](const Shard &shard) {
+		return shard.producer_on_main([](const Implementation &unwrapped) {
+			return unwrapped.stats();
+		});
+	};
+	if (_shards.size() == 1) {
+		return producer(*_shards.front());
+	}
+	auto list = std::vector<rpl::producer<Stats>>();
+	list.reserve(_shards.size());
+	for (const auto &shard : _shards) {
+		list.push_back(producer(*shard));
+	}
+	return rpl::combine(
+		std::move(list)
+	) | rpl::map(AccumulateStats);
 }
 
 void Database::clear(FnMut<void(Error)> &&done) {
-	_wrapped.with([
-		done = std::move(done)
-	](Implementation &unwrapped) mutable {
-		unwrapped.clear(std::move(done));
+	auto callbacks = SplitCallback(int(_shards.size()), std::move(done));
+	withEachShard([&](Shard &shard, int index) {
+		shard.with([
+			done = std::move(callbacks[index])
+		](Implementation &unwrapped) mutable {
+			unwrapped.clear(std::move(done));
+		});
 	});
 }
 
 void Database::clearByTag(uint8 tag, FnMut<void(Error)> &&done) {
-	_wrapped.with([
-		tag,
-		done = std::move(done)
-	](Implementation &unwrapped) mutable {
-		unwrapped.clearByTag(tag, std::move(done));
+	auto callbacks = SplitCallback(int(_shards.size()), std::move(done));
+	withEachShard([&](Shard &shard, int index) {
+		shard.with([
+			tag,
+			done = std::move(callbacks[index])
+		](Implementation &unwrapped) mutable {
+			unwrapped.clearByTag(tag, std::move(done));
+		});
 	});
 }
 
 void Database::sync() {
-	auto semaphore = crl::semaphore();
-	_wrapped.with([&](Implementation &) {
-		semaphore.release();
+	withEachShard([&](Shard &shard, int index) {
+		auto semaphore = crl::semaphore();
+		shard.with([&](Implementation &) {
+			semaphore.release();
+		});
+		semaphore.acquire();
 	});
-	semaphore.acquire();
 }
 
 Database::~Database() = default;
@@ -13,6 +13,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <crl/crl_time.h>
 #include <rpl/producer.h>
 #include <QtCore/QString>
+#include <memory>
+#include <vector>
 
 namespace Storage {
 class EncryptionKey;
@@ -64,6 +66,12 @@ public:
 		FnMut<void(Error)> &&done = nullptr);
 	void getWithTag(const Key &key, FnMut<void(TaggedValue&&)> &&done);
 
+	// Values are delivered in the order of keys, empty for missing ones.
+	void getMany(
+		std::vector<Key> &&keys,
+		FnMut<void(std::vector<TaggedValue>&&)> &&done);
+
+	// Sizes are found in the shard of key, so keys should share its high.
 	void getWithSizes(
 		const Key &key,
 		std::vector<Key> &&keys,
@@ -71,6 +79,10 @@ public:
 
 	using Stats = details::Stats;
 	using TaggedSummary = details::TaggedSummary;
+	using HotSummary = details::HotSummary;
+	using CompactSummary = details::CompactSummary;
+	using LatencySummary = details::LatencySummary;
+	using LatencyStats = details::LatencyStats;
 	rpl::producer<Stats> statsOnMain() const;
 
 	void clear(FnMut<void(Error)> &&done = nullptr);
@@ -83,9 +95,18 @@ public:
 
 private:
 	using Implementation = details::DatabaseObject;
-	crl::object_on_queue<Implementation> _wrapped;
+	using Shard = crl::object_on_queue<Implementation>;
+
+	[[nodiscard]] Shard &shard(const Key &key);
+	template <typename Method>
+	void withEachShard(Method &&method);
+
+	std::vector<std::unique_ptr<Shard>> _shards;
 
 };
 
+// Multiline text for the debug logs.
+[[nodiscard]] QString FormatStats(const Database::Stats &stats);
+
 } // namespace Cache
 } // namespace Storage
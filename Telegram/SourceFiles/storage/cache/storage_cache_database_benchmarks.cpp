@@ -0,0 +1,261 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "catch.hpp"
+
+#include "storage/cache/storage_cache_database.h"
+#include "storage/storage_encryption.h"
+#include "base/concurrent_timer.h"
+#include <crl/crl.h>
+#include <QtCore/QFile>
+#include <QtCore/QCoreApplication>
+#include <iostream>
+#include <thread>
+#include <atomic>
+
+// Every benchmark prints one JSON object per line, for example:
+// {"benchmark":"put","size":4096,"shards":1,"ops":4096,"us":12345}
+
+using namespace Storage::Cache;
+
+namespace {
+
+const auto key = Storage::EncryptionKey(bytes::make_vector(
+	bytes::make_span("\
+abcdefgh01234567abcdefgh01234567abcdefgh01234567abcdefgh01234567\
+abcdefgh01234567abcdefgh01234567abcdefgh01234567abcdefgh01234567\
+abcdefgh01234567abcdefgh01234567abcdefgh01234567abcdefgh01234567\
+abcdefgh01234567abcdefgh01234567abcdefgh01234567abcdefgh01234567\
+").subspan(0, Storage::EncryptionKey::kSize)));
+
+const auto name = QString("benchmark.db");
+
+constexpr auto kMixOperations = 4096;
+constexpr auto kOpenEntries = 1024 * 1024;
+constexpr auto kCompactEntries = 256 * 1024;
+constexpr auto kCompactTimeout = 60 * crl::time(1000);
+constexpr auto kReadersCount = 8;
+constexpr auto kReaderOperations = 4096;
+constexpr auto kReaderEntries = 16 * 1024;
+
+crl::semaphore Semaphore;
+
+Error Open(Database &db) {
+	auto result = Error();
+	db.open(base::duplicate(key), [&](Error error) {
+		result = error;
+		Semaphore.release();
+	});
+	Semaphore.acquire();
+	return result;
+}
+
+void Close(Database &db) {
+	db.close([] { Semaphore.release(); });
+	Semaphore.acquire();
+}
+
+void Clear(Database &db) {
+	db.clear([](Error) { Semaphore.release(); });
+	Semaphore.acquire();
+}
+
+QByteArray Value(int size, int index) {
+	auto result = QByteArray(size, Qt::Uninitialized);
+	for (auto i = 0; i != size; ++i) {
+		result[i] = char(index + i);
+	}
+	return result;
+}
+
+Key MakeKey(int index) {
+	return Key{ uint64(index) * 0x9E3779B9ULL, uint64(index) };
+}
+
+Database::Settings BenchmarkSettings(int shards = 1) {
+	auto result = Database::Settings();
+	result.trackEstimatedTime = false;
+	result.maxDataSize = 2 * 1024 * 1024;
+	result.maxPackedDataSize = 16 * 1024;
+	result.totalSizeLimit = 0;
+	result.totalTimeLimit = 0;
+	result.shardsCount = shards;
+	return result;
+}
+
+struct Result {
+	const char *benchmark = nullptr;
+	int size = 0;
+	int shards = 1;
+	int64 ops = 0;
+	crl::profile_time duration = 0;
+};
+
+void Print(const Result &result) {
+	std::cout
+		<< "{\"benchmark\":\"" << result.benchmark << "\""
+		<< ",\"size\":" << result.size
+		<< ",\"shards\":" << result.shards
+		<< ",\"ops\":" << result.ops
+		<< ",\"us\":" << result.duration
+		<< "}" << std::endl;
+}
+
+template <typename Method>
+crl::profile_time Measure(Method &&method) {
+	const auto started = crl::profile();
+	method();
+	return crl::profile() - started;
+}
+
+QString BinlogPath() {
+	const auto base = details::ComputeBasePath(name);
+	const auto version = details::ReadVersionValue(base);
+	return version
+		? (base + QString::number(*version) + "/binlog")
+		: QString();
+}
+
+} // namespace
+
+TEST_CASE("init benchmark timers", "[.benchmark]") {
+	static auto init = [] {
+		int argc = 0;
+		char **argv = nullptr;
+		static QCoreApplication application(argc, argv);
+		static base::ConcurrentTimerEnvironment environment;
+		return true;
+	}();
+}
+
+TEST_CASE("cache db operations mix", "[.benchmark]") {
+	for (const auto size : { 64, 4 * 1024, 64 * 1024, 1024 * 1024 }) {
+		Database db(name, BenchmarkSettings());
+		Clear(db);
+		REQUIRE(Open(db).type == Error::Type::None);
+
+		const auto count = std::max(kMixOperations * 64 / size, 64);
+		Print({ "put", size, 1, count, Measure([&] {
+			for (auto i = 0; i != count; ++i) {
+				db.put(MakeKey(i), Value(size, i));
+			}
+			db.sync();
+		}) });
+		Print({ "get", size, 1, count, Measure([&] {
+			for (auto i = 0; i != count; ++i) {
+				db.get(MakeKey(i), nullptr);
+			}
+			db.sync();
+		}) });
+		Print({ "mix", size, 1, count, Measure([&] {
+			for (auto i = 0; i != count; ++i) {
+				switch (i % 4) {
+				case 0: db.put(MakeKey(count + i), Value(size, i)); break;
+				case 1: db.remove(MakeKey(i)); break;
+				default: db.get(MakeKey(i), nullptr); break;
+				}
+			}
+			db.sync();
+		}) });
+		Close(db);
+	}
+}
+
+TEST_CASE("cache db open", "[.benchmark]") {
+	for (const auto snapshot : { false, true }) {
+		auto settings = BenchmarkSettings();
+		settings.snapshotAfterLength = snapshot ? 1 : 0;
+		{
+			Database db(name, settings);
+			Clear(db);
+			REQUIRE(Open(db).type == Error::Type::None);
+			for (auto i = 0; i != kOpenEntries; ++i) {
+				db.put(MakeKey(i), Value(16, i));
+			}
+			Close(db);
+		}
+		const auto benchmark = snapshot ? "open_snapshot" : "open";
+		for (auto attempt = 0; attempt != 2; ++attempt) {
+			// The first open reads the binlog cold, the second - warm.
+			Database db(name, settings);
+			Print({ benchmark, 16, 1, kOpenEntries, Measure([&] {
+				REQUIRE(Open(db).type == Error::Type::None);
+			}) });
+			Close(db);
+		}
+	}
+}
+
+TEST_CASE("cache db compaction", "[.benchmark]") {
+	auto settings = BenchmarkSettings();
+	settings.compactAfterExcess = 1024 * 1024;
+	settings.compactAfterFullSize = 0;
+	{
+		auto fill = settings;
+		fill.compactAfterExcess = 0;
+		Database db(name, fill);
+		Clear(db);
+		REQUIRE(Open(db).type == Error::Type::None);
+		for (auto i = 0; i != kCompactEntries * 4; ++i) {
+			db.put(MakeKey(i % kCompactEntries), Value(16, i));
+		}
+		Close(db);
+	}
+	const auto path = BinlogPath();
+	const auto before = QFile(path).size();
+	Database db(name, settings);
+	const auto started = crl::now();
+	Print({ "compact", 16, 1, kCompactEntries, Measure([&] {
+		REQUIRE(Open(db).type == Error::Type::None);
+		while (QFile(path).size() >= before) {
+			REQUIRE(crl::now() - started < kCompactTimeout);
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}) });
+	Close(db);
+}
+
+TEST_CASE("cache db concurrent readers", "[.benchmark]") {
+	for (const auto shards : { 1, 4 }) {
+		Database db(name, BenchmarkSettings(shards));
+		Clear(db);
+		REQUIRE(Open(db).type == Error::Type::None);
+		for (auto i = 0; i != kReaderEntries; ++i) {
+			db.put(MakeKey(i), Value(1024, i));
+		}
+		db.sync();
+
+		const auto duration = Measure([&] {
+			auto readers = std::vector<std::thread>();
+			for (auto i = 0; i != kReadersCount; ++i) {
+				readers.emplace_back([&db, i] {
+					auto finished = crl::semaphore();
+					auto left = std::atomic<int>(kReaderOperations);
+					for (auto j = 0; j != kReaderOperations; ++j) {
+						const auto index = (i * 7919 + j) % kReaderEntries;
+						db.get(MakeKey(index), [&](QByteArray&&) {
+							if (!--left) {
+								finished.release();
+							}
+						});
+					}
+					finished.acquire();
+				});
+			}
+			for (auto &reader : readers) {
+				reader.join();
+			}
+		});
+		Print({
+			"readers",
+			1024,
+			shards,
+			kReadersCount * kReaderOperations,
+			duration });
+		Close(db);
+	}
+}
@@ -14,10 +14,10 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "storage/storage_encrypted_file.h"
 #include "base/flat_map.h"
 #include "base/algorithm.h"
+#include "base/tracing.h"
 #include <crl/crl.h>
 #include <xxhash.h>
 #include <QtCore/QDir>
-#include <unordered_map>
 #include <set>
 
 namespace Storage {
@@ -27,6 +27,29 @@ namespace {
 
 constexpr auto kMaxDelayAfterFailure = 24 * 60 * 60 * crl::time(1000);
 
+// Relocate live values out of a segment when it becomes mostly empty.
+constexpr auto kRelocateSegmentDivider = 4;
+
+// Binlog bytes before the snapshot point that must stay the same.
+constexpr auto kSnapshotTailLength = int64(4096);
+
+// Each key in the removing and accessed sets is a node of a std::set.
+constexpr auto kSetNodeBytes = int64(sizeof(Key) + 4 * sizeof(void*));
+
+base::memory_usage::Counter IndexMemory("Storage::Cache index");
+base::memory_usage::Counter HotMemory("Storage::Cache hot values");
+
+void ApplyUsage(
+		base::memory_usage::Counter &counter,
+		base::memory_usage::Usage &was,
+		base::memory_usage::Usage now) {
+	counter.add(now.bytes - was.bytes, now.count - was.count);
+	was = now;
+}
+
+static_assert(kPackedBlockSize == CtrState::kBlockSize);
+static_assert(GoodForEncryption<SnapshotHeader>);
+
 uint32 CountChecksum(bytes::const_span data) {
 	const auto seed = uint32(0);
 	return XXH32(data.data(), data.size(), seed);
@@ -58,6 +81,16 @@ int32 GetUnixtime() {
 	return std::max(int32(time(nullptr)), 1);
 }
 
+// The values put from the loaders usually share the bytes with their
+// consumers, encrypting them in place would detach a full copy.
+bool WriteWithPadding(File &file, QByteArray &bytes) {
+	if (bytes.isDetached()) {
+		return file.writeWithPadding(bytes::make_detached_span(bytes));
+	}
+	auto writer = FileWriter(file, file.offset());
+	return writer.write(bytes::make_span(bytes)) && writer.finish();
+}
+
 } // namespace
 
 DatabaseObject::Entry::Entry(
@@ -67,8 +100,8 @@ DatabaseObject::Entry::Entry(
 	size_type size,
 	uint64 useTime)
 : useTime(useTime)
-, size(size)
 , checksum(checksum)
+, size(int32(size))
 , place(place)
 , tag(tag) {
 }
@@ -110,6 +143,15 @@ void DatabaseObject::checkSettings() {
 		|| _settings.totalTimeLimit > 0);
 	Expects(!_settings.totalSizeLimit
 		|| _settings.totalSizeLimit > _settings.maxDataSize);
+	Expects(!_settings.maxPackedDataSize
+		|| (_settings.maxPackedDataSize <= _settings.maxDataSize
+			&& _settings.packedSegmentSize > _settings.maxPackedDataSize
+			&& _settings.packedSegmentSize <= kPackedSegmentSizeLimit));
+	Expects(_settings.hotCacheSizeLimit >= 0);
+
+	_hot.setLimits(
+		_settings.hotCacheSizeLimit,
+		_settings.hotCacheTagSizeLimits);
 }
 
 template <typename Callback, typename ...Args>
@@ -175,6 +217,10 @@ QString DatabaseObject::CompactReadyFilename() {
 	return QStringLiteral("binlog-ready");
 }
 
+QString DatabaseObject::SnapshotFilename() {
+	return QStringLiteral("snapshot");
+}
+
 QString DatabaseObject::binlogPath(Version version) const {
 	return computePath(version) + BinlogFilename();
 }
@@ -197,8 +243,11 @@ File::Result DatabaseObject::openBinlog(
 		EncryptionKey &key) {
 	const auto ready = compactReadyPath(version);
 	const auto path = binlogPath(version);
-	if (QFile(ready).exists() && !File::Move(ready, path)) {
-		return File::Result::Failed;
+	if (QFile(ready).exists()) {
+		QFile(computePath(version) + SnapshotFilename()).remove();
+		if (!File::Move(ready, path)) {
+			return File::Result::Failed;
+		}
 	}
 	const auto result = _binlog.open(path, mode, key);
 	if (result != File::Result::Success) {
@@ -220,6 +269,7 @@ File::Result DatabaseObject::openBinlog(
 bool DatabaseObject::readHeader() {
 	if (const auto header = BinlogWrapper::ReadHeader(_binlog, _settings)) {
 		_time.setRelative((_time.system = header->systemTime));
+		_packedPlaces = (header->flags & header->kPackedPlaces) != 0;
 		return true;
 	}
 	return false;
@@ -232,6 +282,11 @@ bool DatabaseObject::writeHeader() {
 	if (_settings.trackEstimatedTime) {
 		header.flags |= header.kTrackEstimatedTime;
 	}
+
+	// New binlogs never use kPackedPlaceMarker for separate files.
+	header.flags |= header.kPackedPlaces;
+	_packedPlaces = true;
+
 	return _binlog.write(bytes::object_as_span(&header));
 }
 
@@ -249,6 +304,9 @@ void DatabaseObject::readBinlogHelper(
 }
 
 void DatabaseObject::readBinlog() {
+	if (!readSnapshot()) {
+		removeSnapshot();
+	}
 	BinlogWrapper wrapper(_binlog, _settings);
 	if (_settings.trackEstimatedTime) {
 		BinlogReader<
@@ -280,8 +338,139 @@ void DatabaseObject::readBinlog() {
 			return processRecordMultiRemove(header, element);
 		});
 	}
+	choosePackedWriteSegment();
+	removeEmptySegments();
 	adjustRelativeTime();
 	optimize();
+	updateMemoryUsage();
+}
+
+QString DatabaseObject::snapshotPath() const {
+	return _path + SnapshotFilename();
+}
+
+bool DatabaseObject::readSnapshot() {
+	if (!QFile(snapshotPath()).exists()) {
+		return false;
+	}
+	auto snapshot = File();
+	const auto result = snapshot.open(snapshotPath(), File::Mode::Read, _key);
+	if (result != File::Result::Success) {
+		return false;
+	}
+	auto header = SnapshotHeader();
+	if (snapshot.read(bytes::object_as_span(&header)) != sizeof(header)) {
+		return false;
+	} else if (header.format != SnapshotHeader::kFormat
+		|| header.till < int64(sizeof(BasicHeader))
+		|| header.till > _binlog.size()
+		|| header.till % CtrState::kBlockSize != 0
+		|| int64(header.count) * int64(sizeof(SnapshotEntry))
+			> snapshot.size() - int64(sizeof(header))) {
+		return false;
+	}
+	auto entries = std::vector<SnapshotEntry>(header.count);
+	const auto data = bytes::make_span(entries);
+	if (snapshot.readWithPadding(data) != data.size()
+		|| CountChecksum(data) != header.checksum) {
+		return false;
+	}
+	snapshot.close();
+
+	// The binlog could be compacted or rewritten without the snapshot.
+	if (countBinlogTailChecksum(header.till) != header.tailChecksum
+		|| !_binlog.seek(header.till)) {
+		_binlog.seek(sizeof(BasicHeader));
+		return false;
+	}
+	for (const auto &entry : entries) {
+		setMapEntry(entry.key, Entry(
+			entry.place,
+			entry.tag,
+			entry.checksum,
+			entry.getSize(),
+			entry.useTime));
+	}
+	_binlogExcessLength = header.excessLength;
+	if (_settings.trackEstimatedTime) {
+		applyTimePoint(header.time);
+	}
+	_snapshotTill = header.till;
+	return true;
+}
+
+std::optional<uint32> DatabaseObject::countBinlogTailChecksum(int64 till) {
+	const auto from = std::max(
+		till - kSnapshotTailLength,
+		int64(sizeof(BasicHeader)));
+	auto tail = bytes::vector(till - from);
+	if (!_binlog.seek(from) || _binlog.read(tail) != tail.size()) {
+		return std::nullopt;
+	}
+	return CountChecksum(tail);
+}
+
+void DatabaseObject::checkSnapshot() {
+	if (!_settings.snapshotAfterLength
+		|| !_binlog.isOpen()
+		|| _binlog.size() - _snapshotTill < _settings.snapshotAfterLength) {
+		return;
+	} else if (!writeSnapshot()) {
+		removeSnapshot();
+	}
+}
+
+bool DatabaseObject::writeSnapshot() {
+	const auto till = _binlog.size();
+	const auto tailChecksum = countBinlogTailChecksum(till);
+	if (!_binlog.seek(till) || !tailChecksum) {
+		return false;
+	}
+
+	auto header = SnapshotHeader();
+	header.count = uint32(_map.size());
+	header.till = till;
+	header.excessLength = _binlogExcessLength;
+	header.time = _time;
+	header.tailChecksum = *tailChecksum;
+
+	auto entries = std::vector<SnapshotEntry>(_map.size());
+	auto written = entries.begin();
+	for (const auto &[key, entry] : _map) {
+		written->key = key;
+		written->useTime = entry.useTime;
+		written->checksum = entry.checksum;
+		written->setSize(entry.size);
+		written->tag = entry.tag;
+		written->place = entry.place;
+		++written;
+	}
+	const auto data = bytes::make_span(entries);
+	header.checksum = CountChecksum(data);
+
+	const auto temp = snapshotPath() + QStringLiteral("-temp");
+	auto snapshot = File();
+	const auto result = snapshot.open(temp, File::Mode::Write, _key);
+	if (result != File::Result::Success) {
+		return false;
+	} else if (!snapshot.write(bytes::object_as_span(&header))
+		|| !snapshot.writeWithPadding(data)) {
+		snapshot.close();
+		QFile(temp).remove();
+		return false;
+	}
+	snapshot.close();
+	if (!File::Move(temp, snapshotPath())) {
+		QFile(temp).remove();
+		return false;
+	}
+	_snapshotTill = till;
+	return true;
+}
+
+void DatabaseObject::removeSnapshot() {
+	QFile(snapshotPath()).remove();
+	_snapshotTill = 0;
 }
 
 uint64 DatabaseObject::countRelativeTime() const {
@@ -300,6 +489,7 @@ uint64 DatabaseObject::pruneBeforeTime() const {
 void DatabaseObject::optimize() {
 	if (!startDelayedPruning()) {
 		checkCompactor();
+		checkPackedSegments();
 	}
 }
 
@@ -443,7 +633,7 @@ void DatabaseObject::collectSizeStale(
 		return;
 	}
 
-	using Bucket = std::pair<const Key, Entry>;
+	using Bucket = Map::value_type;
 	auto oldest = base::flat_multi_map<
 		int64,
 		const Bucket*,
@@ -581,6 +771,7 @@ bool DatabaseObject::processRecordMultiAccess(
 }
 
 void DatabaseObject::setMapEntry(const Key &key, Entry &&entry) {
+	_hot.remove(key);
 	auto &already = _map[key];
 	updateStats(already, entry);
 	if (already.size != 0) {
@@ -607,6 +798,7 @@ void DatabaseObject::setMapEntry(const Key &key, Entry &&entry) {
 }
 
 void DatabaseObject::updateStats(const Entry &was, const Entry &now) {
+	updateSegmentStats(was, now);
 	_totalSize += now.size - was.size;
 	if (now.tag == was.tag) {
 		if (now.tag) {
@@ -629,6 +821,25 @@ void DatabaseObject::updateStats(const Entry &was, const Entry &now) {
 	pushStatsDelayed();
 }
 
+void DatabaseObject::updateSegmentStats(const Entry &was, const Entry &now) {
+	if (was.size != 0 && isPackedPlace(was.place)) {
+		const auto segment = PackedPlaceFromId(was.place).segment;
+		const auto i = _segments.find(segment);
+		Assert(i != end(_segments));
+		Assert(i->second.count > 0);
+		i->second.totalSize -= was.size;
+		if (!--i->second.count) {
+			_segments.erase(i);
+			_emptySegments.emplace(segment);
+		}
+	}
+	if (now.size != 0 && isPackedPlace(now.place)) {
+		auto &summary = _segments[PackedPlaceFromId(now.place).segment];
+		++summary.count;
+		summary.totalSize += now.size;
+	}
+}
+
 void DatabaseObject::pushStatsDelayed() {
 	if (_pushingStats) {
 		return;
@@ -650,6 +861,7 @@ void DatabaseObject::pushStats() {
 void DatabaseObject::eraseMapEntry(const Map::const_iterator &i) {
 	if (i != end(_map)) {
 		const auto &entry = i->second;
+		_hot.remove(i->first);
 		updateStats(entry, Entry());
 		if (_minimalEntryTime != 0 && entry.useTime == _minimalEntryTime) {
 			Assert(_entriesWithMinimalTimeCount > 0);
@@ -696,6 +908,7 @@ void DatabaseObject::compactorDone(
 			return;
 		}
 	}
+	removeSnapshot();
 	if (!File::Move(path, ready)) {
 		compactorFail();
 		return;
@@ -719,11 +932,24 @@ void DatabaseObject::compactorDone(
 	}
 	_binlogExcessLength -= _compactor.excessLength;
 	Assert(_binlogExcessLength >= 0);
+	pushStatsDelayed();
+}
+
+void DatabaseObject::recordQueueLatency(crl::profile_time queued) {
+	_latency.queue.add(crl::profile() - queued);
+}
+
+void DatabaseObject::compactorProgress(int64 processed) {
+	if (_compactor.object) {
+		_compactor.progress.processed = processed;
+		pushStatsDelayed();
+	}
 }
 
 void DatabaseObject::compactorFail() {
 	const auto delay = _compactor.delayAfterFailure;
 	_compactor = CompactorWrap();
+	pushStatsDelayed();
 	_compactor.nextAttempt = crl::now() + delay;
 	_compactor.delayAfterFailure = std::min(
 		delay * 2,
@@ -749,79 +975,132 @@ void DatabaseObject::clearState() {
 	_stale = {};
 	_time = {};
 	_binlogExcessLength = 0;
+	_snapshotTill = 0;
 	_totalSize = 0;
 	_minimalEntryTime = 0;
 	_entriesWithMinimalTimeCount = 0;
 	_taggedStats = {};
+	_hot.clear();
+	_latency = LatencyStats();
+	_hits = 0;
+	_misses = 0;
 	_pushingStats = false;
+	_packedPlaces = false;
+	_writeSegment = 0;
+	_segments = {};
+	_segmentFiles = {};
+	_emptySegments = {};
+	_relocating = {};
+	_relocatingSegment = 0;
+	_relocatingPacked = false;
 	_writeBundlesTimer.cancel();
 	_pruneTimer.cancel();
 	_compactor = CompactorWrap();
+	updateMemoryUsage();
 }
 
 void DatabaseObject::put(
 		const Key &key,
 		TaggedValue &&value,
 		FnMut<void(Error)> &&done) {
+	TRACE_SCOPE("Storage::Cache::put");
+
 	if (value.bytes.isEmpty()) {
 		remove(key, std::move(done));
 		return;
 	}
+	const auto started = crl::profile();
+	const auto guard = gsl::finally([&] {
+		_latency.put.add(crl::profile() - started);
+	});
 	_removing.erase(key);
 	_stale.erase(ranges::remove(_stale, key), end(_stale));
 
 	const auto checksum = CountChecksum(bytes::make_span(value.bytes));
-	const auto maybepath = writeKeyPlace(key, value, checksum);
-	if (!maybepath) {
+	const auto written = writeKeyPlace(key, value, checksum);
+	if (!written) {
 		invokeCallback(done, ioError(binlogPath()));
 		return;
-	} else if (maybepath->isEmpty()) {
+	} else if (!written->changed) {
 		// Nothing changed.
 		invokeCallback(done, Error::NoError());
 		recordEntryAccess(key);
 		return;
 	}
-	const auto path = *maybepath;
-	File data;
-	const auto result = data.open(path, File::Mode::Write, _key);
-	switch (result) {
-	case File::Result::Failed:
+	const auto error = writeValueData(written->place, value.bytes);
+	if (error.type != Error::Type::None) {
 		remove(key, nullptr);
-		invokeCallback(done, ioError(path));
-		break;
+		invokeCallback(done, error);
+	} else {
+		invokeCallback(done, Error::NoError());
+		optimize();
+	}
+}
 
-	case File::Result::LockFailed:
-		remove(key, nullptr);
-		invokeCallback(done, Error{ Error::Type::LockFailed, path });
-		break;
+Error DatabaseObject::writeValueData(PlaceId place, QByteArray &bytes) {
+	return isPackedPlace(place)
+		? writePackedData(place, bytes)
+		: writeFileData(placePath(place), bytes);
+}
 
+Error DatabaseObject::writeFileData(const QString &path, QByteArray &bytes) {
+	File data;
+	const auto result = data.open(path, File::Mode::Write, _key);
+	switch (result) {
+	case File::Result::Failed: return ioError(path);
+	case File::Result::LockFailed: return { Error::Type::LockFailed, path };
 	case File::Result::Success: {
-		const auto success = data.writeWithPadding(
-			bytes::make_detached_span(value.bytes));
-		if (!success) {
-			data.close();
-			remove(key, nullptr);
-			invokeCallback(done, ioError(path));
-		} else {
-			data.flush();
-			invokeCallback(done, Error::NoError());
-			optimize();
+		if (!WriteWithPadding(data, bytes)) {
+			return ioError(path);
 		}
+		data.flush();
+		return Error::NoError();
 	} break;
+	}
+	Unexpected("Result in DatabaseObject::writeFileData.");
+}
 
-	default: Unexpected("Result in DatabaseObject::put.");
+Error DatabaseObject::writePackedData(PlaceId place, QByteArray &bytes) {
+	const auto packed = PackedPlaceFromId(place);
+	const auto file = segmentFile(packed.segment);
+	const auto offset = int64(packed.block) * kPackedBlockSize;
+	if (!file || !file->seek(offset)) {
+		return ioError(segmentPath(packed.segment));
+	} else if (!WriteWithPadding(*file, bytes)) {
+		return ioError(segmentPath(packed.segment));
 	}
+	file->flush();
+	return Error::NoError();
 }
 
 template <typename StoreRecord>
-std::optional<QString> DatabaseObject::writeKeyPlaceGeneric(
+bool DatabaseObject::writeStoreRecord(StoreRecord &&record) {
+	auto writeable = record;
+	const auto success = _binlog.write(bytes::object_as_span(&writeable));
+	if (!success) {
+		_binlog.close();
+		return false;
+	}
+	_binlog.flush();
+
+	const auto applied = processRecordStore(
+		&record,
+		std::is_class<std::decay_t<StoreRecord>>{});
+	Assert(applied);
+	return true;
+}
+
+template <typename StoreRecord>
+auto DatabaseObject::writeKeyPlaceGeneric(
 		StoreRecord &&record,
 		const Key &key,
 		const TaggedValue &value,
-		uint32 checksum) {
+		uint32 checksum) -> std::optional<WrittenPlace> {
 	Expects(value.bytes.size() <= _settings.maxDataSize);
 
 	const auto size = size_type(value.bytes.size());
+	const auto packed = isPackedSize(size);
+	auto removeFile = QString();
 	record.tag = value.tag;
 	record.key = key;
 	record.setSize(size);
@@ -832,34 +1111,43 @@ std::optional<QString> DatabaseObject::writeKeyPlaceGeneric(
 			&& already.size == size
 			&& already.checksum == checksum
 			&& readValueData(already.place, size) == value.bytes) {
-			return QString();
+			return WrittenPlace();
 		}
-		record.place = already.place;
-	} else {
-		do {
-			bytes::set_random(bytes::object_as_span(&record.place));
-		} while (!isFreePlace(record.place));
+		if (isPackedPlace(already.place)) {
+			// Packed values are never overwritten, only appended.
+			record.place = packed ? PlaceId() : generateFreePlace();
+		} else {
+			record.place = already.place;
+			if (packed) {
+				removeFile = placePath(already.place);
+			}
+		}
+	} else if (!packed) {
+		record.place = generateFreePlace();
 	}
-	const auto result = placePath(record.place);
-	auto writeable = record;
-	const auto success = _binlog.write(bytes::object_as_span(&writeable));
-	if (!success) {
-		_binlog.close();
-		return QString();
+	if (packed) {
+		const auto place = reservePackedPlace(size);
+		if (!place) {
+			return std::nullopt;
+		}
+		record.place = *place;
 	}
-	_binlog.flush();
-
-	const auto applied = processRecordStore(
-		&record,
-		std::is_class<StoreRecord>{});
-	Assert(applied);
+	if (!writeStoreRecord(std::move(record))) {
+		return std::nullopt;
+	}
+	if (!removeFile.isEmpty()) {
+		QFile(removeFile).remove();
+	}
+	auto result = WrittenPlace();
+	result.place = record.place;
+	result.changed = true;
 	return result;
 }
 
-std::optional<QString> DatabaseObject::writeKeyPlace(
+auto DatabaseObject::writeKeyPlace(
 		const Key &key,
 		const TaggedValue &data,
-		uint32 checksum) {
+		uint32 checksum) -> std::optional<WrittenPlace> {
 	if (!_settings.trackEstimatedTime) {
 		return writeKeyPlaceGeneric(Store(), key, data, checksum);
 	}
@@ -897,19 +1185,9 @@ Error DatabaseObject::writeExistingPlaceGeneric(
 		}
 	}
 	record.place = entry.place;
-	auto writeable = record;
-	const auto success = _binlog.write(bytes::object_as_span(&writeable));
-	if (!success) {
-		_binlog.close();
-		return ioError(binlogPath());
-	}
-	_binlog.flush();
-
-	const auto applied = processRecordStore(
-		&record,
-		std::is_class<StoreRecord>{});
-	Assert(applied);
-	return Error::NoError();
+	return writeStoreRecord(std::move(record))
+		? Error::NoError()
+		: ioError(binlogPath());
 }
 
 Error DatabaseObject::writeExistingPlace(
@@ -932,27 +1210,125 @@ Error DatabaseObject::writeExistingPlace(
 	return writeExistingPlaceGeneric(std::move(record), key, entry);
 }
 
+Error DatabaseObject::writeRelocatedPlace(
+		const Key &key,
+		const Entry &entry) {
+	const auto fill = [&](auto &record) {
+		record.key = key;
+		record.tag = entry.tag;
+		record.setSize(entry.size);
+		record.checksum = entry.checksum;
+		record.place = entry.place;
+	};
+	const auto written = [&] {
+		if (!_settings.trackEstimatedTime) {
+			auto record = Store();
+			fill(record);
+			return writeStoreRecord(std::move(record));
+		}
+		auto record = StoreWithTime();
+		fill(record);
+
+		// Relocation is not an access, keep the previous use time.
+		record.time.setRelative(entry.useTime);
+		record.time.system = _time.system;
+		return writeStoreRecord(std::move(record));
+	}();
+	return written ? Error::NoError() : ioError(binlogPath());
+}
+
 void DatabaseObject::get(
 		const Key &key,
 		FnMut<void(TaggedValue&&)> &&done) {
+	TRACE_SCOPE("Storage::Cache::get");
+
+	if (auto value = readEntryValue(key)) {
+		invokeCallback(done, std::move(*value));
+		recordEntryAccess(key);
+	} else {
+		invokeCallback(done, TaggedValue());
+	}
+}
+
+void DatabaseObject::getMany(
+		std::vector<Key> &&keys,
+		FnMut<void(std::vector<TaggedValue>&&)> &&done) {
+	TRACE_SCOPE("Storage::Cache::getMany");
+
+	// Read in the place order, so that packed values in one segment
+	// are read sequentially and files in one folder are read together.
+	using ReadOrder = std::tuple<uint64, PlaceId, size_type>;
+	auto order = std::vector<ReadOrder>();
+	order.reserve(keys.size());
+	const auto count = size_type(keys.size());
+	for (auto index = size_type(); index != count; ++index) {
+		const auto i = _map.find(keys[index]);
+		if (i == end(_map)) {
+			continue;
+		}
+		const auto place = i->second.place;
+		const auto packed = isPackedPlace(place)
+			? PackedPlaceFromId(place)
+			: PackedPlace();
+		const auto position = isPackedPlace(place)
+			? ((uint64(1) << 48)
+				| (uint64(packed.segment) << 32)
+				| uint64(packed.block))
+			: uint64(0);
+		order.emplace_back(position, place, index);
+	}
+	ranges::sort(order);
+
+	auto result = std::vector<TaggedValue>(keys.size());
+	auto accessed = std::vector<Key>();
+	accessed.reserve(order.size());
+	for (const auto &read : order) {
+		const auto index = std::get<2>(read);
+		if (auto value = readEntryValue(keys[index])) {
+			result[index] = std::move(*value);
+			accessed.push_back(keys[index]);
+		}
+	}
+	invokeCallback(done, std::move(result));
+	for (const auto &key : accessed) {
+		recordEntryAccess(key);
+	}
+}
+
+std::optional<TaggedValue> DatabaseObject::readEntryValue(const Key &key) {
+	const auto started = crl::profile();
 	const auto i = _map.find(key);
 	if (i == _map.end()) {
-		invokeCallback(done, TaggedValue());
-		return;
+		++_misses;
+		return std::nullopt;
+	}
+	const auto hit = [&](uint8 tag) {
+		++_hits;
+		if (tag) {
+			++_taggedStats[tag].hits;
+		}
+		_latency.get.add(crl::profile() - started);
+	};
+	if (auto hot = _hot.get(key)) {
+		hit(hot->tag);
+		return hot;
 	}
 	const auto &entry = i->second;
 
 	auto bytes = readValueData(entry.place, entry.size);
 	if (bytes.isEmpty()) {
+		++_misses;
 		remove(key, nullptr);
-		invokeCallback(done, TaggedValue());
+		return std::nullopt;
 	} else if (CountChecksum(bytes::make_span(bytes)) != entry.checksum) {
+		++_misses;
 		remove(key, nullptr);
-		invokeCallback(done, TaggedValue());
-	} else {
-		invokeCallback(done, TaggedValue(std::move(bytes), entry.tag));
-		recordEntryAccess(key);
+		return std::nullopt;
 	}
+	auto result = TaggedValue(std::move(bytes), entry.tag);
+	_hot.put(key, result);
+	hit(result.tag);
+	return result;
 }
 
 void DatabaseObject::getWithSizes(
@@ -974,9 +1350,21 @@ void DatabaseObject::getWithSizes(
 	});
 }
 
-QByteArray DatabaseObject::readValueData(
+QByteArray DatabaseObject::readValueData(PlaceId place, size_type size) {
+	const auto started = crl::profile();
+	auto decrypted = crl::profile_time(0);
+	auto result = isPackedPlace(place)
+		? readPackedData(place, size, decrypted)
+		: readFileData(place, size, decrypted);
+	_latency.disk.add(crl::profile() - started - decrypted);
+	_latency.decrypt.add(decrypted);
+	return result;
+}
+
+QByteArray DatabaseObject::readFileData(
 		PlaceId place,
-		size_type size) const {
+		size_type size,
+		crl::profile_time &decrypted) {
 	const auto path = placePath(place);
 	File data;
 	const auto result = data.open(path, File::Mode::Read, _key);
@@ -986,7 +1374,12 @@ QByteArray DatabaseObject::readValueData(
 	case File::Result::Success: {
 		auto result = QByteArray(size, Qt::Uninitialized);
 		const auto bytes = bytes::make_detached_span(result);
-		const auto read = data.readWithPadding(bytes);
+		const auto mapped = (_settings.minMappedReadSize > 0)
+			&& (size >= _settings.minMappedReadSize);
+		const auto read = mapped
+			? data.readWithPaddingMapped(bytes)
+			: data.readWithPadding(bytes);
+		decrypted = data.decryptDuration();
 		if (read != size) {
 			return QByteArray();
 		}
@@ -996,6 +1389,27 @@ QByteArray DatabaseObject::readValueData(
 	Unexpected("Result in DatabaseObject::get.");
 }
 
+QByteArray DatabaseObject::readPackedData(
+		PlaceId place,
+		size_type size,
+		crl::profile_time &decrypted) {
+	const auto packed = PackedPlaceFromId(place);
+	const auto file = segmentFile(packed.segment);
+	const auto offset = int64(packed.block) * kPackedBlockSize;
+	if (!file || !file->seek(offset)) {
+		return QByteArray();
+	}
+	auto result = QByteArray(size, Qt::Uninitialized);
+	const auto bytes = bytes::make_detached_span(result);
+	const auto decryptedBefore = file->decryptDuration();
+	const auto read = file->readWithPadding(bytes);
+	decrypted = file->decryptDuration() - decryptedBefore;
+	if (read != size) {
+		return QByteArray();
+	}
+	return result;
+}
+
 void DatabaseObject::recordEntryAccess(const Key &key) {
 	if (!_settings.trackEstimatedTime) {
 		return;
@@ -1006,11 +1420,19 @@ void DatabaseObject::recordEntryAccess(const Key &key) {
 }
 
 void DatabaseObject::remove(const Key &key, FnMut<void(Error)> &&done) {
+	TRACE_SCOPE("Storage::Cache::remove");
+
 	const auto i = _map.find(key);
 	if (i != _map.end()) {
 		_removing.emplace(key);
 		writeMultiRemoveLazy();
 
+		if (isPackedPlace(i->second.place)) {
+			// Segment space is reclaimed by checkPackedSegments().
+			eraseMapEntry(i);
+			invokeCallback(done, Error::NoError());
+			return;
+		}
 		const auto path = placePath(i->second.place);
 		eraseMapEntry(i);
 		if (QFile(path).remove() || !QFile(path).exists()) {
@@ -1082,8 +1504,15 @@ rpl::producer<Stats> DatabaseObject::stats() const {
 Stats DatabaseObject::collectStats() const {
 	auto result = Stats();
 	result.tagged = _taggedStats;
+	result.hot = _hot.summary();
+	if (_compactor.object) {
+		result.compacting = _compactor.progress;
+	}
 	result.full.count = _map.size();
 	result.full.totalSize = _totalSize;
+	result.full.hits = _hits;
+	result.misses = _misses;
+	result.latency = _latency;
 	result.clearing = (_cleaner.object != nullptr) || !_stale.empty();
 	return result;
 }
@@ -1174,10 +1603,26 @@ Error DatabaseObject::writeMultiAccessBlock() {
 }
 
 void DatabaseObject::writeBundles() {
+	TRACE_SCOPE("Storage::Cache::writeBundles");
+
 	writeMultiRemove();
 	if (_settings.trackEstimatedTime) {
 		writeMultiAccess();
 	}
+	checkSnapshot();
+	updateMemoryUsage();
+}
+
+void DatabaseObject::updateMemoryUsage() {
+	const auto sets = int64(_removing.size() + _accessed.size());
+	ApplyUsage(IndexMemory, _indexMemory, {
+		(int64(_map.size()) * int64(sizeof(Map::value_type))
+			+ sets * kSetNodeBytes
+			+ int64(_stale.size()) * int64(sizeof(Key))),
+		int64(_map.size())
+	});
+	const auto hot = _hot.summary();
+	ApplyUsage(HotMemory, _hotMemory, { hot.totalSize, hot.count });
 }
 
 void DatabaseObject::createCleaner() {
@@ -1222,7 +1667,9 @@ void DatabaseObject::checkCompactor() {
 		_settings,
 		base::duplicate(_key),
 		info);
+	_compactor.progress.total = info.till;
 	_compactor.excessLength = _binlogExcessLength;
+	pushStatsDelayed();
 }
 
 void DatabaseObject::clear(FnMut<void(Error)> &&done) {
@@ -1320,7 +1767,202 @@ QString DatabaseObject::placePath(PlaceId place) const {
 }
 
 bool DatabaseObject::isFreePlace(PlaceId place) const {
-	return !QFile(placePath(place)).exists();
+	return !isPackedPlace(place) && !QFile(placePath(place)).exists();
+}
+
+bool DatabaseObject::isPackedPlace(PlaceId place) const {
+	return _packedPlaces && (place[0] == kPackedPlaceMarker);
+}
+
+bool DatabaseObject::isPackedSize(size_type size) const {
+	return _packedPlaces && (size <= _settings.maxPackedDataSize);
+}
+
+PlaceId DatabaseObject::generateFreePlace() const {
+	auto result = PlaceId();
+	do {
+		bytes::set_random(bytes::object_as_span(&result));
+	} while (!isFreePlace(result));
+	return result;
+}
+
+QString DatabaseObject::segmentsPath() const {
+	return _path + QStringLiteral("packed/");
+}
+
+QString DatabaseObject::segmentPath(SegmentId segment) const {
+	return segmentsPath() + QString::number(segment);
+}
+
+File *DatabaseObject::segmentFile(SegmentId segment) {
+	if (const auto i = _segmentFiles.find(segment); i != end(_segmentFiles)) {
+		return i->second.get();
+	}
+	auto file = std::make_unique<File>();
+	const auto path = segmentPath(segment);
+	const auto result = file->open(path, File::Mode::ReadAppend, _key);
+	if (result != File::Result::Success) {
+		return nullptr;
+	}
+	return _segmentFiles.emplace(
+		segment,
+		std::move(file)
+	).first->second.get();
+}
+
+std::optional<PlaceId> DatabaseObject::reservePackedPlace(size_type size) {
+	const auto padded = ((size + kPackedBlockSize - 1) / kPackedBlockSize)
+		* kPackedBlockSize;
+	auto file = segmentFile(_writeSegment);
+	if (!file
+		|| (file->size() > 0
+			&& file->size() + padded > _settings.packedSegmentSize)) {
+		if (!startNextSegment()) {
+			return std::nullopt;
+		}
+		file = segmentFile(_writeSegment);
+		if (!file) {
+			return std::nullopt;
+		}
+	}
+	auto result = PackedPlace();
+	result.segment = _writeSegment;
+	result.block = uint32(file->size() / kPackedBlockSize);
+	return PackedPlaceToId(result);
+}
+
+bool DatabaseObject::startNextSegment() {
+	const auto sealed = _writeSegment;
+	for (auto next = SegmentId(sealed + 1); next != sealed; ++next) {
+		if (_segments.contains(next)) {
+			continue;
+		}
+		removeSegment(next);
+		_writeSegment = next;
+		if (!_segments.contains(sealed)) {
+			removeSegment(sealed);
+		}
+		return true;
+	}
+	return false;
+}
+
+void DatabaseObject::choosePackedWriteSegment() {
+	_writeSegment = _segments.empty() ? SegmentId(0) : _segments.back().first;
+}
+
+void DatabaseObject::removeEmptySegments() {
+	if (!_packedPlaces) {
+		return;
+	}
+	const auto entries = QDir(segmentsPath()).entryList(QDir::Files);
+	for (const auto &entry : entries) {
+		auto ok = false;
+		const auto segment = entry.toUShort(&ok);
+		if (!ok || _segments.contains(segment)) {
+			continue;
+		} else if (segment == _writeSegment) {
+			continue;
+		}
+		removeSegment(segment);
+	}
+	_emptySegments.clear();
+}
+
+void DatabaseObject::removeSegment(SegmentId segment) {
+	_segmentFiles.remove(segment);
+	_emptySegments.remove(segment);
+	QFile(segmentPath(segment)).remove();
+}
+
+void DatabaseObject::checkPackedSegments() {
+	if (!_packedPlaces) {
+		return;
+	}
+	while (!_emptySegments.empty()) {
+		const auto segment = _emptySegments.back();
+		if (segment == _writeSegment) {
+			_emptySegments.remove(segment);
+		} else if (_segments.contains(segment)) {
+			_emptySegments.remove(segment);
+		} else {
+			removeSegment(segment);
+		}
+	}
+	if (!_relocating.empty()) {
+		return;
+	}
+	const auto limit = _settings.packedSegmentSize / kRelocateSegmentDivider;
+	for (const auto &[segment, summary] : _segments) {
+		if (segment != _writeSegment && summary.totalSize < limit) {
+			startPackedRelocation(segment);
+			return;
+		}
+	}
+}
+
+void DatabaseObject::startPackedRelocation(SegmentId segment) {
+	for (const auto &[key, entry] : _map) {
+		if (isPackedPlace(entry.place)
+			&& PackedPlaceFromId(entry.place).segment == segment) {
+			_relocating.push_back(key);
+		}
+	}
+	_relocatingSegment = segment;
+	relocatePackedChunkDelayed();
+}
+
+void DatabaseObject::relocatePackedChunkDelayed() {
+	if (_relocatingPacked) {
+		return;
+	}
+	_relocatingPacked = true;
+	_weak.with([](DatabaseObject &that) {
+		if (base::take(that._relocatingPacked)) {
+			that.relocatePackedChunk();
+		}
+	});
+}
+
+void DatabaseObject::relocatePackedChunk() {
+	if (_relocating.empty()) {
+		return;
+	}
+	const auto relocating = gsl::make_span(_relocating);
+	const auto count = size_type(relocating.size());
+	const auto relocate = std::min(count, _settings.staleRemoveChunk);
+	for (const auto &key : relocating.subspan(count - relocate)) {
+		relocatePackedValue(key);
+	}
+	_relocating.resize(count - relocate);
+	if (_relocating.empty()) {
+		base::take(_relocating);
+		checkPackedSegments();
+	} else {
+		relocatePackedChunkDelayed();
+	}
+}
+
+void DatabaseObject::relocatePackedValue(const Key &key) {
+	const auto i = _map.find(key);
+	if (i == end(_map)
+		|| !isPackedPlace(i->second.place)
+		|| PackedPlaceFromId(i->second.place).segment != _relocatingSegment) {
+		return;
+	}
+	auto entry = i->second;
+	auto bytes = readValueData(entry.place, entry.size);
+	if (bytes.isEmpty()
+		|| CountChecksum(bytes::make_span(bytes)) != entry.checksum) {
+		remove(key, nullptr);
+		return;
+	}
+	const auto place = reservePackedPlace(entry.size);
+	if (!place || writePackedData(*place, bytes).type != Error::Type::None) {
+		return;
+	}
+	entry.place = *place;
+	writeRelocatedPlace(key, entry);
 }
 
 } // namespace details
@@ -8,11 +8,14 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #pragma once
 
 #include "storage/cache/storage_cache_database.h"
+#include "storage/cache/storage_cache_hot_cache.h"
 #include "storage/storage_encrypted_file.h"
 #include "base/binary_guard.h"
 #include "base/concurrent_timer.h"
 #include "base/bytes.h"
+#include "base/flat_hash_map.h"
 #include "base/flat_set.h"
+#include "base/memory_usage.h"
 #include <set>
 #include <rpl/event_stream.h>
 
@@ -60,6 +63,9 @@ public:
 		const Key &key,
 		std::vector<Key> &&keys,
 		FnMut<void(QByteArray&&, std::vector<int>&&)> &&done);
+	void getMany(
+		std::vector<Key> &&keys,
+		FnMut<void(std::vector<TaggedValue>&&)> &&done);
 
 	rpl::producer<Stats> stats() const;
 
@@ -69,7 +75,11 @@ public:
 
 	static QString BinlogFilename();
 	static QString CompactReadyFilename();
+	static QString SnapshotFilename();
+
+	void recordQueueLatency(crl::profile_time queued);
 
+	void compactorProgress(int64 processed);
 	void compactorDone(const QString &path, int64 originalReadTill);
 	void compactorFail();
 
@@ -83,8 +93,8 @@ public:
 			uint64 useTime);
 
 		uint64 useTime = 0;
-		size_type size = 0;
 		uint32 checksum = 0;
+		int32 size = 0; // Limited by EntrySize.
 		PlaceId place = { { 0 } };
 		uint8 tag = 0;
 	};
@@ -101,12 +111,21 @@ private:
 	};
 	struct CompactorWrap {
 		std::unique_ptr<Compactor> object;
+		CompactSummary progress;
 		int64 excessLength = 0;
 		crl::time nextAttempt = 0;
 		crl::time delayAfterFailure = 10 * crl::time(1000);
 		base::binary_guard guard;
 	};
-	using Map = std::unordered_map<Key, Entry>;
+	struct SegmentSummary {
+		size_type count = 0;
+		int64 totalSize = 0;
+	};
+	struct WrittenPlace {
+		PlaceId place = { { 0 } };
+		bool changed = false;
+	};
+	using Map = base::flat_hash_map<Key, Entry>;
 
 	template <typename Callback, typename ...Args>
 	void invokeCallback(Callback &&callback, Args &&...args) const;
@@ -129,6 +148,12 @@ private:
 	bool writeHeader();
 
 	void readBinlog();
+	bool readSnapshot();
+	std::optional<uint32> countBinlogTailChecksum(int64 till);
+	QString snapshotPath() const;
+	void checkSnapshot();
+	bool writeSnapshot();
+	void removeSnapshot();
 	template <typename Reader, typename ...Handlers>
 	void readBinlogHelper(Reader &reader, Handlers &&...handlers);
 	template <typename Record, typename Postprocess>
@@ -178,10 +203,20 @@ private:
 	void pushStatsDelayed();
 	void pushStats();
 
+	void updateSegmentStats(const Entry &was, const Entry &now);
 	void setMapEntry(const Key &key, Entry &&entry);
 	void eraseMapEntry(const Map::const_iterator &i);
 	void recordEntryAccess(const Key &key);
-	QByteArray readValueData(PlaceId place, size_type size) const;
+	std::optional<TaggedValue> readEntryValue(const Key &key);
+	QByteArray readValueData(PlaceId place, size_type size);
+	QByteArray readFileData(
+		PlaceId place,
+		size_type size,
+		crl::profile_time &decrypted);
+	QByteArray readPackedData(
+		PlaceId place,
+		size_type size,
+		crl::profile_time &decrypted);
 
 	Version findAvailableVersion() const;
 	QString versionPath() const;
@@ -190,14 +225,37 @@ private:
 
 	QString placePath(PlaceId place) const;
 	bool isFreePlace(PlaceId place) const;
+	bool isPackedPlace(PlaceId place) const;
+	bool isPackedSize(size_type size) const;
+	PlaceId generateFreePlace() const;
+
+	QString segmentsPath() const;
+	QString segmentPath(SegmentId segment) const;
+	File *segmentFile(SegmentId segment);
+	std::optional<PlaceId> reservePackedPlace(size_type size);
+	bool startNextSegment();
+	void choosePackedWriteSegment();
+	void removeEmptySegments();
+	void removeSegment(SegmentId segment);
+	void checkPackedSegments();
+	void startPackedRelocation(SegmentId segment);
+	void relocatePackedChunkDelayed();
+	void relocatePackedChunk();
+	void relocatePackedValue(const Key &key);
+
+	Error writeValueData(PlaceId place, QByteArray &bytes);
+	Error writeFileData(const QString &path, QByteArray &bytes);
+	Error writePackedData(PlaceId place, QByteArray &bytes);
 
 	template <typename StoreRecord>
-	std::optional<QString> writeKeyPlaceGeneric(
+	bool writeStoreRecord(StoreRecord &&record);
+	template <typename StoreRecord>
+	std::optional<WrittenPlace> writeKeyPlaceGeneric(
 		StoreRecord &&record,
 		const Key &key,
 		const TaggedValue &value,
 		uint32 checksum);
-	std::optional<QString> writeKeyPlace(
+	std::optional<WrittenPlace> writeKeyPlace(
 		const Key &key,
 		const TaggedValue &value,
 		uint32 checksum);
@@ -209,6 +267,9 @@ private:
 	Error writeExistingPlace(
 		const Key &key,
 		const Entry &entry);
+	Error writeRelocatedPlace(
+		const Key &key,
+		const Entry &entry);
 	void writeMultiRemoveLazy();
 	Error writeMultiRemove();
 	void writeMultiAccessLazy();
@@ -216,6 +277,7 @@ private:
 	Error writeMultiAccessBlock();
 	void writeBundlesLazy();
 	void writeBundles();
+	void updateMemoryUsage();
 
 	void createCleaner();
 	void cleanerDone(Error error);
@@ -234,14 +296,30 @@ private:
 	EstimatedTimePoint _time;
 
 	int64 _binlogExcessLength = 0;
+	int64 _snapshotTill = 0;
 	int64 _totalSize = 0;
 	uint64 _minimalEntryTime = 0;
 	size_type _entriesWithMinimalTimeCount = 0;
 
 	base::flat_map<uint8, TaggedSummary> _taggedStats;
+	HotCache _hot;
+	LatencyStats _latency;
+	int64 _hits = 0;
+	int64 _misses = 0;
 	rpl::event_stream<Stats> _stats;
 	bool _pushingStats = false;
 	bool _clearingStale = false;
+	base::memory_usage::Usage _indexMemory;
+	base::memory_usage::Usage _hotMemory;
+
+	bool _packedPlaces = false;
+	SegmentId _writeSegment = 0;
+	base::flat_map<SegmentId, SegmentSummary> _segments;
+	base::flat_map<SegmentId, std::unique_ptr<File>> _segmentFiles;
+	base::flat_set<SegmentId> _emptySegments;
+	std::vector<Key> _relocating;
+	SegmentId _relocatingSegment = 0;
+	bool _relocatingPacked = false;
 
 	base::ConcurrentTimer _writeBundlesTimer;
 	base::ConcurrentTimer _pruneTimer;
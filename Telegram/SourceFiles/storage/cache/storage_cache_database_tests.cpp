@@ -117,6 +117,20 @@ Database::TaggedValue GetWithTag(Database &db, const Key &key) {
 	return ValueWithTag;
 }
 
+auto Values = std::vector<Database::TaggedValue>();
+const auto GetValues = [](std::vector<Database::TaggedValue> values) {
+	Values = values;
+	Semaphore.release();
+};
+
+std::vector<Database::TaggedValue> GetMany(
+		Database &db,
+		std::vector<Key> &&keys) {
+	db.getMany(std::move(keys), GetValues);
+	Semaphore.acquire();
+	return Values;
+}
+
 Error Put(Database &db, const Key &key, QByteArray &&value) {
 	db.put(key, std::move(value), GetResult);
 	Semaphore.acquire();
@@ -538,6 +552,280 @@ TEST_CASE("cache db remove", "[storage_cache_database]") {
 	}
 }
 
+TEST_CASE("cache db get many", "[storage_cache_database]") {
+	if (!DisableLargeTest) {
+		return;
+	}
+	SECTION("db gets many values in keys order") {
+		auto settings = Settings;
+		settings.maxPackedDataSize = 16;
+		Database db(name, settings);
+
+		REQUIRE(Clear(db).type == Error::Type::None);
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		REQUIRE(Put(db, Key{ 0, 1 }, Test1()).type == Error::Type::None);
+		REQUIRE(Put(db, Key{ 1, 0 }, Database::TaggedValue(Test2(), 1)).type
+			== Error::Type::None);
+		REQUIRE(Put(db, Key{ 1, 1 }, Test2()).type == Error::Type::None);
+		const auto values = GetMany(db, {
+			Key{ 1, 0 },
+			Key{ 2, 2 },
+			Key{ 0, 1 },
+			Key{ 1, 1 },
+		});
+		REQUIRE(values.size() == 4);
+		REQUIRE(((values[0].bytes == Test2()) && (values[0].tag == 1)));
+		REQUIRE(values[1].bytes.isEmpty());
+		REQUIRE((values[2].bytes == Test1()));
+		REQUIRE((values[3].bytes == Test2()));
+		REQUIRE(GetMany(db, {}).empty());
+		Close(db);
+	}
+}
+
+TEST_CASE("hot cache db", "[storage_cache_database]") {
+	if (!DisableLargeTest) {
+		return;
+	}
+	auto settings = Settings;
+	settings.hotCacheSizeLimit = 40;
+	settings.hotCacheTagSizeLimits.emplace(uint8(1), 20);
+	SECTION("db keeps read values in memory") {
+		Database db(name, settings);
+
+		REQUIRE(Clear(db).type == Error::Type::None);
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		REQUIRE(Put(db, Key{ 0, 1 }, Test1()).type == Error::Type::None);
+		REQUIRE((Get(db, Key{ 0, 1 }) == Test1()));
+		REQUIRE((Get(db, Key{ 0, 1 }) == Test1()));
+		REQUIRE(Put(db, Key{ 0, 1 }, Test2()).type == Error::Type::None);
+		REQUIRE((Get(db, Key{ 0, 1 }) == Test2()));
+		Remove(db, Key{ 0, 1 });
+		REQUIRE(Get(db, Key{ 0, 1 }).isEmpty());
+		Close(db);
+	}
+	SECTION("db evicts values by tag limits") {
+		Database db(name, settings);
+
+		REQUIRE(Clear(db).type == Error::Type::None);
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		REQUIRE(Put(db, Key{ 0, 1 }, Database::TaggedValue(Test1(), 1)).type
+			== Error::Type::None);
+		REQUIRE(Put(db, Key{ 0, 2 }, Database::TaggedValue(Test1(), 1)).type
+			== Error::Type::None);
+		REQUIRE(Put(db, Key{ 0, 3 }, Test2()).type == Error::Type::None);
+		REQUIRE((Get(db, Key{ 0, 1 }) == Test1()));
+		REQUIRE((Get(db, Key{ 0, 2 }) == Test1()));
+		REQUIRE((Get(db, Key{ 0, 3 }) == Test2()));
+		REQUIRE((Get(db, Key{ 0, 2 }) == Test1()));
+		REQUIRE((Get(db, Key{ 0, 1 }) == Test1()));
+		Close(db);
+	}
+}
+
+TEST_CASE("packed cache db", "[storage_cache_database]") {
+	if (!DisableLargeTest) {
+		return;
+	}
+	const auto GetSegmentPath = [](int segment) {
+		auto result = GetBinlogPath();
+		result.chop(QString("binlog").size());
+		return result + "packed/" + QString::number(segment);
+	};
+	auto settings = Settings;
+	settings.maxPackedDataSize = 16;
+	settings.packedSegmentSize = 64;
+	SECTION("db packs small values") {
+		Database db(name, settings);
+
+		REQUIRE(Clear(db).type == Error::Type::None);
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		REQUIRE(Put(db, Key{ 0, 1 }, Test1()).type == Error::Type::None);
+		REQUIRE(Put(db, Key{ 1, 0 }, Test2()).type == Error::Type::None);
+		REQUIRE(Put(db, Key{ 1, 1 }, Database::TaggedValue(Test1(), 1)).type
+			== Error::Type::None);
+		REQUIRE(QFile(GetSegmentPath(0)).exists());
+		REQUIRE((Get(db, Key{ 0, 1 }) == Test1()));
+		REQUIRE((Get(db, Key{ 1, 0 }) == Test2()));
+		Close(db);
+
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		REQUIRE((Get(db, Key{ 0, 1 }) == Test1()));
+		REQUIRE((Get(db, Key{ 1, 0 }) == Test2()));
+		const auto withTag = GetWithTag(db, Key{ 1, 1 });
+		REQUIRE(((withTag.bytes == Test1()) && (withTag.tag == 1)));
+		Close(db);
+	}
+	SECTION("db overwrites packed values") {
+		Database db(name, settings);
+
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		REQUIRE(Put(db, Key{ 0, 1 }, Test2()).type == Error::Type::None);
+		REQUIRE(Put(db, Key{ 1, 0 }, Test1()).type == Error::Type::None);
+		REQUIRE((Get(db, Key{ 0, 1 }) == Test2()));
+		REQUIRE((Get(db, Key{ 1, 0 }) == Test1()));
+		Remove(db, Key{ 1, 1 });
+		REQUIRE(Get(db, Key{ 1, 1 }).isEmpty());
+		Close(db);
+
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		REQUIRE((Get(db, Key{ 0, 1 }) == Test2()));
+		REQUIRE((Get(db, Key{ 1, 0 }) == Test1()));
+		REQUIRE(Get(db, Key{ 1, 1 }).isEmpty());
+		Close(db);
+	}
+	SECTION("db relocates values from sparse segments") {
+		Database db(name, settings);
+
+		REQUIRE(Clear(db).type == Error::Type::None);
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		for (auto i = 0U; i != 8U; ++i) {
+			auto value = Test1();
+			value[0] = char('A') + i;
+			REQUIRE(Put(db, Key{ i, i }, std::move(value)).type
+				== Error::Type::None);
+		}
+		REQUIRE(QFile(GetSegmentPath(1)).exists());
+		Remove(db, Key{ 0, 0 });
+		Remove(db, Key{ 1, 1 });
+		Remove(db, Key{ 2, 2 });
+		REQUIRE(Put(db, Key{ 8, 8 }, Test1()).type == Error::Type::None);
+
+		// Relocation is scheduled after the put, wait for it.
+		REQUIRE((Get(db, Key{ 8, 8 }) == Test1()));
+		auto value = Test1();
+		value[0] = char('A') + 3;
+		REQUIRE((Get(db, Key{ 3, 3 }) == value));
+		REQUIRE(!QFile(GetSegmentPath(0)).exists());
+		Close(db);
+
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		REQUIRE((Get(db, Key{ 3, 3 }) == value));
+		REQUIRE(Get(db, Key{ 0, 0 }).isEmpty());
+		Close(db);
+	}
+}
+
+TEST_CASE("cache db snapshot", "[storage_cache_database]") {
+	if (!DisableLargeTest) {
+		return;
+	}
+	const auto GetSnapshotPath = [] {
+		auto result = GetBinlogPath();
+		result.chop(QString("binlog").size());
+		return result + "snapshot";
+	};
+	auto settings = Settings;
+	settings.snapshotAfterLength = 1;
+	SECTION("db writes snapshot on close") {
+		Database db(name, settings);
+
+		REQUIRE(Clear(db).type == Error::Type::None);
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		REQUIRE(Put(db, Key{ 0, 1 }, Test1()).type == Error::Type::None);
+		REQUIRE(Put(db, Key{ 1, 0 }, Database::TaggedValue(Test2(), 1)).type
+			== Error::Type::None);
+		Remove(db, Key{ 0, 1 });
+		Close(db);
+		REQUIRE(QFile(GetSnapshotPath()).exists());
+
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		REQUIRE(Get(db, Key{ 0, 1 }).isEmpty());
+		const auto withTag = GetWithTag(db, Key{ 1, 0 });
+		REQUIRE(((withTag.bytes == Test2()) && (withTag.tag == 1)));
+		Close(db);
+	}
+	SECTION("db replays binlog after snapshot") {
+		auto unsaved = settings;
+		unsaved.snapshotAfterLength = 0;
+		Database db(name, unsaved);
+
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		REQUIRE(Put(db, Key{ 0, 1 }, Test1()).type == Error::Type::None);
+		Remove(db, Key{ 1, 0 });
+		Close(db);
+
+		Database other(name, settings);
+		REQUIRE(Open(other, key).type == Error::Type::None);
+		REQUIRE((Get(other, Key{ 0, 1 }) == Test1()));
+		REQUIRE(Get(other, Key{ 1, 0 }).isEmpty());
+		Close(other);
+	}
+	SECTION("db ignores broken snapshot") {
+		{
+			QFile snapshot(GetSnapshotPath());
+			REQUIRE(snapshot.open(QIODevice::ReadWrite));
+			REQUIRE(snapshot.seek(snapshot.size() - 16));
+			REQUIRE(snapshot.write(QByteArray(16, char(0))) == 16);
+		}
+		Database db(name, settings);
+
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		REQUIRE((Get(db, Key{ 0, 1 }) == Test1()));
+		REQUIRE(Get(db, Key{ 1, 0 }).isEmpty());
+		Close(db);
+	}
+}
+
+TEST_CASE("sharded cache db", "[storage_cache_database]") {
+	if (!DisableLargeTest) {
+		return;
+	}
+	auto settings = Settings;
+	settings.shardsCount = 3;
+	SECTION("db spreads values over shards") {
+		Database db(name, settings);
+
+		REQUIRE(Clear(db).type == Error::Type::None);
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		for (auto i = 0U; i != 8U; ++i) {
+			auto value = Test1();
+			value[0] = char('A') + i;
+			REQUIRE(Put(db, Key{ i, 1 }, std::move(value)).type
+				== Error::Type::None);
+		}
+		const auto values = GetMany(db, {
+			Key{ 7, 1 },
+			Key{ 9, 1 },
+			Key{ 0, 1 },
+		});
+		REQUIRE(values.size() == 3);
+		REQUIRE(values[0].bytes[0] == char('A') + 7);
+		REQUIRE(values[1].bytes.isEmpty());
+		REQUIRE(values[2].bytes[0] == char('A'));
+		Close(db);
+
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		for (auto i = 0U; i != 8U; ++i) {
+			auto value = Test1();
+			value[0] = char('A') + i;
+			REQUIRE((Get(db, Key{ i, 1 }) == value));
+		}
+		Close(db);
+	}
+	SECTION("db copies and moves values between shards") {
+		Database db(name, settings);
+
+		REQUIRE(Open(db, key).type == Error::Type::None);
+		for (auto i = 0U; i != 8U; ++i) {
+			REQUIRE(CopyIfEmpty(db, Key{ 0, 1 }, Key{ i, 2 }).type
+				== Error::Type::None);
+		}
+		for (auto i = 0U; i != 8U; ++i) {
+			REQUIRE(Get(db, Key{ i, 2 })[0] == char('A'));
+		}
+		REQUIRE(MoveIfEmpty(db, Key{ 1, 1 }, Key{ 1, 3 }).type
+			== Error::Type::None);
+		REQUIRE(MoveIfEmpty(db, Key{ 2, 1 }, Key{ 5, 3 }).type
+			== Error::Type::None);
+		REQUIRE(Get(db, Key{ 1, 1 }).isEmpty());
+		REQUIRE(Get(db, Key{ 2, 1 }).isEmpty());
+		REQUIRE(Get(db, Key{ 1, 3 })[0] == char('A') + 1);
+		REQUIRE(Get(db, Key{ 5, 3 })[0] == char('A') + 2);
+		Close(db);
+	}
+}
+
 TEST_CASE("cache db bundled actions", "[storage_cache_database]") {
 	if (!DisableLargeTest) {
 		return;
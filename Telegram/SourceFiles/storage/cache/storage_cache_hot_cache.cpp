@@ -0,0 +1,146 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "storage/cache/storage_cache_hot_cache.h"
+
+namespace Storage {
+namespace Cache {
+namespace details {
+
+void HotCache::setLimits(
+		int64 totalSizeLimit,
+		const base::flat_map<uint8, int64> &tagSizeLimits) {
+	_totalSizeLimit = totalSizeLimit;
+	_tagSizeLimits = tagSizeLimits;
+	if (!_totalSizeLimit) {
+		clear();
+		return;
+	}
+	for (auto &[tag, tagged] : _tagged) {
+		const auto limit = tagSizeLimit(tag);
+		while (!tagged.order.empty() && tagged.totalSize > limit) {
+			evictLast(tagged);
+		}
+	}
+	while (_totalSize > _totalSizeLimit) {
+		evictLast(*findOldest());
+	}
+}
+
+std::optional<TaggedValue> HotCache::get(const Key &key) {
+	if (!_totalSizeLimit) {
+		return std::nullopt;
+	}
+	const auto i = _entries.find(key);
+	if (i == end(_entries)) {
+		++_misses;
+		return std::nullopt;
+	}
+	++_hits;
+	auto &entry = i->second;
+	auto &order = _tagged[entry.value.tag].order;
+	order.splice(begin(order), order, entry.position);
+	entry.stamp = ++_stamp;
+	return entry.value;
+}
+
+void HotCache::put(const Key &key, const TaggedValue &value) {
+	const auto size = int64(value.bytes.size());
+	if (!_totalSizeLimit
+		|| size > _totalSizeLimit
+		|| size > tagSizeLimit(value.tag)) {
+		remove(key);
+		return;
+	}
+	remove(key);
+
+	auto &tagged = _tagged[value.tag];
+	tagged.order.push_front(key);
+	tagged.totalSize += size;
+	_totalSize += size;
+
+	auto &entry = _entries[key];
+	entry.value = value;
+	entry.stamp = ++_stamp;
+	entry.position = begin(tagged.order);
+
+	evict(value.tag);
+}
+
+void HotCache::remove(const Key &key) {
+	const auto i = _entries.find(key);
+	if (i == end(_entries)) {
+		return;
+	}
+	const auto &entry = i->second;
+	const auto size = int64(entry.value.bytes.size());
+	auto &tagged = _tagged[entry.value.tag];
+	tagged.order.erase(entry.position);
+	tagged.totalSize -= size;
+	_totalSize -= size;
+	_entries.erase(i);
+}
+
+void HotCache::clear() {
+	_entries.clear();
+	_tagged.clear();
+	_totalSize = 0;
+}
+
+HotSummary HotCache::summary() const {
+	auto result = HotSummary();
+	result.count = _entries.size();
+	result.totalSize = _totalSize;
+	result.hits = _hits;
+	result.misses = _misses;
+	return result;
+}
+
+int64 HotCache::tagSizeLimit(uint8 tag) const {
+	const auto i = _tagSizeLimits.find(tag);
+	return (i != end(_tagSizeLimits)) ? i->second : _totalSizeLimit;
+}
+
+void HotCache::evict(uint8 tag) {
+	auto &tagged = _tagged[tag];
+	const auto limit = tagSizeLimit(tag);
+	while (tagged.totalSize > limit) {
+		evictLast(tagged);
+	}
+	while (_totalSize > _totalSizeLimit) {
+		evictLast(*findOldest());
+	}
+}
+
+void HotCache::evictLast(Tagged &tagged) {
+	Expects(!tagged.order.empty());
+
+	const auto key = tagged.order.back();
+	remove(key);
+}
+
+auto HotCache::findOldest() -> Tagged* {
+	auto result = (Tagged*)nullptr;
+	auto stamp = uint64();
+	for (auto &[tag, tagged] : _tagged) {
+		if (tagged.order.empty()) {
+			continue;
+		}
+		const auto i = _entries.find(tagged.order.back());
+		Assert(i != end(_entries));
+		if (!result || i->second.stamp < stamp) {
+			result = &tagged;
+			stamp = i->second.stamp;
+		}
+	}
+	Ensures(result != nullptr);
+	return result;
+}
+
+} // namespace details
+} // namespace Cache
+} // namespace Storage
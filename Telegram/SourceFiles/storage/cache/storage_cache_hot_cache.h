@@ -0,0 +1,63 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "storage/cache/storage_cache_types.h"
+#include <list>
+#include <unordered_map>
+
+namespace Storage {
+namespace Cache {
+namespace details {
+
+// Decrypted values kept in memory, evicted by least recent access.
+class HotCache {
+public:
+	void setLimits(
+		int64 totalSizeLimit,
+		const base::flat_map<uint8, int64> &tagSizeLimits);
+
+	std::optional<TaggedValue> get(const Key &key);
+	void put(const Key &key, const TaggedValue &value);
+	void remove(const Key &key);
+	void clear();
+
+	HotSummary summary() const;
+
+private:
+	struct Entry {
+		TaggedValue value;
+		uint64 stamp = 0;
+		std::list<Key>::iterator position;
+	};
+	struct Tagged {
+		std::list<Key> order;
+		int64 totalSize = 0;
+	};
+
+	int64 tagSizeLimit(uint8 tag) const;
+	void evict(uint8 tag);
+	void evictLast(Tagged &tagged);
+	Tagged *findOldest();
+
+	int64 _totalSizeLimit = 0;
+	base::flat_map<uint8, int64> _tagSizeLimits;
+
+	std::unordered_map<Key, Entry> _entries;
+	base::flat_map<uint8, Tagged> _tagged;
+	int64 _totalSize = 0;
+	uint64 _stamp = 0;
+
+	int64 _hits = 0;
+	int64 _misses = 0;
+
+};
+
+} // namespace details
+} // namespace Cache
+} // namespace Storage
@@ -44,10 +44,65 @@ inline size_type ValidateStrictCount(const Packed &count) {
 
 } // namespace
 
+PlaceId PackedPlaceToId(PackedPlace place) {
+	auto result = PlaceId();
+	result[0] = kPackedPlaceMarker;
+	result[1] = uint8(place.segment & 0xFF);
+	result[2] = uint8((place.segment >> 8) & 0xFF);
+	for (auto i = 0; i != 4; ++i) {
+		result[3 + i] = uint8((place.block >> (i * 8)) & 0xFF);
+	}
+	return result;
+}
+
+PackedPlace PackedPlaceFromId(PlaceId place) {
+	Expects(place[0] == kPackedPlaceMarker);
+
+	auto result = PackedPlace();
+	result.segment = SegmentId(place[1] | (place[2] << 8));
+	for (auto i = 0; i != 4; ++i) {
+		result.block |= (uint32(place[3 + i]) << (i * 8));
+	}
+	return result;
+}
+
 TaggedValue::TaggedValue(QByteArray &&bytes, uint8 tag)
 : bytes(std::move(bytes)), tag(tag) {
 }
 
+void LatencySummary::add(crl::profile_time duration) {
+	auto index = 0;
+	while (index + 1 < kBucketsCount
+		&& duration >= (crl::profile_time(1) << index)) {
+		++index;
+	}
+	++buckets[index];
+	++count;
+	total += duration;
+}
+
+void LatencySummary::accumulate(const LatencySummary &other) {
+	for (auto i = 0; i != kBucketsCount; ++i) {
+		buckets[i] += other.buckets[i];
+	}
+	count += other.count;
+	total += other.total;
+}
+
+crl::profile_time LatencySummary::percentile(int percent) const {
+	Expects(percent >= 0 && percent <= 100);
+
+	const auto required = (count * percent + 99) / 100;
+	auto counted = int64(0);
+	for (auto i = 0; i != kBucketsCount; ++i) {
+		counted += buckets[i];
+		if (counted >= required) {
+			return crl::profile_time(1) << i;
+		}
+	}
+	return crl::profile_time(1) << (kBucketsCount - 1);
+}
+
 QString ComputeBasePath(const QString &original) {
 	const auto result = QDir(original).absolutePath();
 	return result.endsWith('/') ? result : (result + '/');
@@ -100,6 +155,14 @@ size_type Store::getSize() const {
 	return ReadFrom(size);
 }
 
+void SnapshotEntry::setSize(size_type size) {
+	this->size = ReadTo<EntrySize>(size);
+}
+
+size_type SnapshotEntry::getSize() const {
+	return ReadFrom(size);
+}
+
 MultiStore::MultiStore(size_type count)
 : type(kType)
 , count(ReadTo<RecordsCount>(count)) {
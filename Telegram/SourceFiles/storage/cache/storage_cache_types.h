@@ -13,6 +13,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <crl/crl_time.h>
 #include <QtCore/QString>
 #include <QtCore/QByteArray>
+#include <array>
 
 namespace Storage {
 namespace Cache {
@@ -64,6 +65,21 @@ constexpr auto kBundledRecordsLimit
 	= size_type(1 << (RecordsCount().size() * 8));
 constexpr auto kDataSizeLimit = size_type(1 << (EntrySize().size() * 8));
 
+// Packed places keep (segment, offset in blocks) inside of a PlaceId.
+using SegmentId = uint16;
+constexpr auto kPackedPlaceMarker = uint8(0xFF);
+constexpr auto kPackedBlockSize = size_type(16);
+constexpr auto kPackedSegmentSizeLimit = int64(kPackedBlockSize)
+	* (int64(1) << 32);
+
+struct PackedPlace {
+	SegmentId segment = 0;
+	uint32 block = 0;
+};
+
+PlaceId PackedPlaceToId(PackedPlace place);
+PackedPlace PackedPlaceFromId(PlaceId place);
+
 struct Settings {
 	size_type maxBundledRecords = 16 * 1024;
 	size_type readBlockSize = 8 * 1024 * 1024;
@@ -71,10 +87,32 @@ struct Settings {
 	crl::time writeBundleDelay = 15 * 60 * crl::time(1000);
 	size_type staleRemoveChunk = 256;
 
+	// Values not larger than maxPackedDataSize are appended to shared
+	// segment files instead of getting a separate file each.
+	size_type maxPackedDataSize = 0;
+	int64 packedSegmentSize = 32 * 1024 * 1024;
+
+	// Values of at least this size are decrypted from a file mapping.
+	size_type minMappedReadSize = 256 * 1024;
+
+	// Recently read values are kept decrypted in memory up to this size.
+	int64 hotCacheSizeLimit = 0;
+	base::flat_map<uint8, int64> hotCacheTagSizeLimits;
+
 	int64 compactAfterExcess = 8 * 1024 * 1024;
 	int64 compactAfterFullSize = 0;
 	size_type compactChunkSize = 16 * 1024;
 
+	// Pause between compaction chunks to stay in this I/O rate, 0 - none.
+	int64 compactBytesPerSecond = 0;
+
+	// Save the whole map after the binlog grows by this length, 0 - never.
+	int64 snapshotAfterLength = 0;
+
+	// Keys are spread by Key::high over this many separate databases,
+	// each with its own binlog and queue. Must not change for a path.
+	int shardsCount = 1;
+
 	bool trackEstimatedTime = true;
 	int64 totalSizeLimit = 1024 * 1024 * 1024;
 	size_type totalTimeLimit = 31 * 24 * 60 * 60; // One month in seconds.
@@ -100,10 +138,44 @@ struct TaggedValue {
 struct TaggedSummary {
 	size_type count = 0;
 	int64 totalSize = 0;
+	int64 hits = 0;
+};
+struct HotSummary {
+	size_type count = 0;
+	int64 totalSize = 0;
+	int64 hits = 0;
+	int64 misses = 0;
+};
+struct CompactSummary {
+	int64 processed = 0;
+	int64 total = 0;
+};
+struct LatencySummary {
+	// Bucket N counts durations below 2^N microseconds, the last - the rest.
+	static constexpr auto kBucketsCount = 24;
+
+	void add(crl::profile_time duration);
+	void accumulate(const LatencySummary &other);
+	[[nodiscard]] crl::profile_time percentile(int percent) const;
+
+	std::array<int64, kBucketsCount> buckets = { { 0 } };
+	int64 count = 0;
+	crl::profile_time total = 0;
+};
+struct LatencyStats {
+	LatencySummary queue;
+	LatencySummary get;
+	LatencySummary disk;
+	LatencySummary decrypt;
+	LatencySummary put;
 };
 struct Stats {
 	TaggedSummary full;
 	base::flat_map<uint8, TaggedSummary> tagged;
+	HotSummary hot;
+	std::optional<CompactSummary> compacting;
+	LatencyStats latency;
+	int64 misses = 0;
 	bool clearing = false;
 };
 
@@ -125,6 +197,7 @@ struct BasicHeader {
 	BasicHeader();
 
 	static constexpr auto kTrackEstimatedTime = 0x01U;
+	static constexpr auto kPackedPlaces = 0x02U;
 
 	Format getFormat() const {
 		return static_cast<Format>(format);
@@ -223,6 +296,32 @@ struct MultiAccess {
 	size_type validateCount() const;
 };
 
+struct SnapshotHeader {
+	static constexpr auto kFormat = uint32(0x01);
+
+	uint32 format = kFormat;
+	uint32 count = 0;
+	int64 till = 0;
+	int64 excessLength = 0;
+	EstimatedTimePoint time;
+	uint32 checksum = 0;
+	uint32 tailChecksum = 0;
+	uint32 reserved = 0;
+};
+
+struct SnapshotEntry {
+	void setSize(size_type size);
+	size_type getSize() const;
+
+	Key key;
+	uint64 useTime = 0;
+	uint32 checksum = 0;
+	EntrySize size = { { 0 } };
+	uint8 tag = 0;
+	PlaceId place = { { 0 } };
+	uint8 reserved = 0;
+};
+
 } // namespace details
 } // namespace Cache
 } // namespace Storage
@@ -232,7 +331,9 @@ namespace std {
 template <>
 struct hash<Storage::Cache::Key> {
 	size_t operator()(const Storage::Cache::Key &key) const {
-		return (hash<uint64>()(key.high) ^ hash<uint64>()(key.low));
+		// Keys like { x, x } should not collide in open addressing maps.
+		return (hash<uint64>()(key.high)
+			^ (hash<uint64>()(key.low) * 0x9E3779B97F4A7C15ULL));
 	}
 };
 
@@ -14,6 +14,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "mainwindow.h"
 #include "core/application.h"
 #include "storage/localstorage.h"
+#include "storage/file_download_sink.h"
 #include "platform/platform_file_utilities.h"
 #include "mtproto/connection.h" // for MTP::kAckSendWaiting
 #include "main/main_session.h"
@@ -30,32 +31,139 @@ namespace {
 // How much time without download causes additional session kill.
 constexpr auto kKillSessionTimeout = crl::time(5000);
 
-// Max 16 file parts downloaded at the same time, 128 KB each.
-constexpr auto kMaxFileQueries = 16;
+// Prewarmed download sessions that get no requests are killed after this.
+constexpr auto kKillPrewarmedSessionTimeout = crl::time(30000);
+
+// Start with 16 file parts downloaded at the same time, 128 KB each,
+// the limit for each DC is adapted to the measured throughput.
+constexpr auto kStartFileQueries = 16;
+constexpr auto kMinFileQueries = 4;
+constexpr auto kMaxFileQueries = 64;
+constexpr auto kFileQueriesStep = 4;
+
+// Throughput is compared once a second while the queue is full,
+// the limit is increased if it grew by 10% and decreased if it fell by 30%.
+constexpr auto kThroughputInterval = crl::time(1000);
+constexpr auto kThroughputGrowPercent = 110;
+constexpr auto kThroughputFallPercent = 70;
+
+// Parts that take this long mean flood waits or timeouts.
+constexpr auto kSlowPartTimeout = crl::time(8000);
+
+// A DC link that gives less than that while the queue is full is slow,
+// auto-downloads outside of the viewport wait for a while after that.
+constexpr auto kSlowLinkBytesPerSecond = int64(64 * 1024);
+constexpr auto kSlowLinkPauseDuration = crl::time(30000);
+
+// One more session is opened when the bandwidth-delay product of a DC
+// means more than that many bytes in flight in each of its sessions.
+constexpr auto kSessionBytesInFlight = int64(1024 * 1024);
 
 // Max 8 http[s] files downloaded at the same time.
 constexpr auto kMaxWebFileQueries = 8;
 
-// Different part sizes are not supported for now :(
-// Because we start downloading with some part size
-// and then we get a cdn-redirect where we support only
-// fixed part size download for hash checking.
+// Small responses, like map tiles or inline bot thumbnails,
+// are kept in memory up to this total size for repeat hits.
+constexpr auto kMaxCachedWebResponses = 4 * 1024 * 1024;
+constexpr auto kMaxCachedWebResponseSize = 256 * 1024;
+
+// CDN downloads support only this part size because of hash checking,
+// so after a cdn-redirect bigger parts are requested again by 128 KB.
 constexpr auto kPartSize = 128 * 1024;
 
+// Big files after the first megabyte are downloaded by 1 MB parts
+// if the DC gives us 1 MB/s or more and by 512 KB parts otherwise.
+constexpr auto kBigPartsFileSize = 8 * 1024 * 1024;
+constexpr auto kSmallPartsTill = 1024 * 1024;
+constexpr auto kBigPartSize = 1024 * 1024;
+constexpr auto kMediumPartSize = 512 * 1024;
+constexpr auto kBigPartsBytesPerSecond = int64(1024 * 1024);
+
+void DecryptCdnPart(
+		bytes::span buffer,
+		bytes::const_span key,
+		bytes::const_span iv,
+		int offset) {
+	auto state = MTP::CTRState();
+	auto ivec = bytes::make_span(state.ivec);
+	std::copy(iv.begin(), iv.end(), ivec.begin());
+
+	auto counterOffset = static_cast<uint32>(offset) >> 4;
+	state.ivec[15] = static_cast<uchar>(counterOffset & 0xFF);
+	state.ivec[14] = static_cast<uchar>((counterOffset >> 8) & 0xFF);
+	state.ivec[13] = static_cast<uchar>((counterOffset >> 16) & 0xFF);
+	state.ivec[12] = static_cast<uchar>((counterOffset >> 24) & 0xFF);
+
+	MTP::aesCtrEncrypt(buffer, key.data(), &state);
+}
+
 } // namespace
 
 Downloader::Downloader(not_null<ApiWrap*> api)
 : _api(api)
 , _killDownloadSessionsTimer([=] { killDownloadSessions(); })
+, _resumeAutoDownloadsTimer([=] { resumeAutoDownloads(); })
 , _queueForWeb(kMaxWebFileQueries) {
+	_bandwidth.refilled(
+	) | rpl::start_with_next([=] {
+		resumeAutoDownloads();
+	}, _lifetime);
+}
+
+void Downloader::resumeAutoDownloads() {
+	for (auto &[dcId, queue] : _queuesForDc) {
+		FileLoader::LoadNextFromQueue(&queue);
+	}
 }
 
 void Downloader::clearPriorities() {
 	++_priority;
 }
 
+FileLoader *Downloader::sharedLoader(const Cache::Key &key) const {
+	const auto i = _sharedLoaders.find(key);
+	return (i != end(_sharedLoaders)) ? i->second.get() : nullptr;
+}
+
+void Downloader::registerSharedLoader(
+		const Cache::Key &key,
+		not_null<FileLoader*> loader) {
+	Expects(!_sharedLoaders.count(key));
+
+	_sharedLoaders.emplace(key, loader);
+}
+
+void Downloader::unregisterSharedLoader(
+		const Cache::Key &key,
+		not_null<FileLoader*> loader) {
+	const auto i = _sharedLoaders.find(key);
+	if (i != end(_sharedLoaders) && i->second == loader) {
+		_sharedLoaders.erase(i);
+	}
+}
+
+LoadPriority Downloader::startPriority() const {
+	return _startPriority;
+}
+
+void Downloader::setStartPriority(LoadPriority priority) {
+	_startPriority = priority;
+}
+
+LoadPriorityScope::LoadPriorityScope(
+	not_null<Downloader*> downloader,
+	LoadPriority priority)
+: _downloader(downloader)
+, _was(downloader->startPriority()) {
+	_downloader->setStartPriority(priority);
+}
+
+LoadPriorityScope::~LoadPriorityScope() {
+	_downloader->setStartPriority(_was);
+}
+
 void Downloader::requestedAmountIncrement(MTP::DcId dcId, int index, int amount) {
-	Expects(index >= 0 && index < MTP::kDownloadSessionsCount);
+	Expects(index >= 0 && index < MTP::kMaxDownloadSessionsCount);
 
 	using namespace rpl::mappers;
 
@@ -71,6 +179,27 @@ void Downloader::requestedAmountIncrement(MTP::DcId dcId, int index, int amount)
 	}
 }
 
+void Downloader::prewarmDc(MTP::DcId dcId) {
+	if (!dcId || _prewarmedDcs.contains(dcId)) {
+		return;
+	}
+	_prewarmedDcs.emplace(dcId);
+	if (_requestedBytesAmount.contains(dcId)) {
+		return;
+	}
+	DEBUG_LOG(("Downloader Info: prewarming download session to dc %1."
+		).arg(dcId));
+	MTP::sendAnything(MTP::downloadDcId(dcId, 0));
+	if (!_killDownloadSessionTimes.contains(dcId)) {
+		_killDownloadSessionTimes.emplace(
+			dcId,
+			crl::now() + kKillPrewarmedSessionTimeout);
+	}
+	if (!_killDownloadSessionsTimer.isActive()) {
+		_killDownloadSessionsTimer.callOnce(kKillPrewarmedSessionTimeout + 5);
+	}
+}
+
 void Downloader::killDownloadSessionsStart(MTP::DcId dcId) {
 	if (!_killDownloadSessionTimes.contains(dcId)) {
 		_killDownloadSessionTimes.emplace(
@@ -95,9 +224,10 @@ void Downloader::killDownloadSessions() {
 	auto ms = crl::now(), left = MTP::kAckSendWaiting + kKillSessionTimeout;
 	for (auto i = _killDownloadSessionTimes.begin(); i != _killDownloadSessionTimes.end(); ) {
 		if (i->second <= ms) {
-			for (int j = 0; j < MTP::kDownloadSessionsCount; ++j) {
+			for (int j = 0; j < MTP::kMaxDownloadSessionsCount; ++j) {
 				MTP::stopSession(MTP::downloadDcId(i->first, j));
 			}
+			_sessionsCountForDc.remove(i->first);
 			i = _killDownloadSessionTimes.erase(i);
 		} else {
 			if (i->second - ms < left) {
@@ -115,7 +245,7 @@ int Downloader::chooseDcIndexForRequest(MTP::DcId dcId) const {
 	auto result = 0;
 	auto it = _requestedBytesAmount.find(dcId);
 	if (it != _requestedBytesAmount.cend()) {
-		for (auto i = 1; i != MTP::kDownloadSessionsCount; ++i) {
+		for (auto i = 1, count = sessionsCount(dcId); i != count; ++i) {
 			if (it->second[i] < it->second[result]) {
 				result = i;
 			}
@@ -124,14 +254,144 @@ int Downloader::chooseDcIndexForRequest(MTP::DcId dcId) const {
 	return result;
 }
 
+int Downloader::sessionsCount(MTP::DcId dcId) const {
+	const auto i = _sessionsCountForDc.find(dcId);
+	return (i != end(_sessionsCountForDc))
+		? i->second
+		: MTP::kDownloadSessionsCount;
+}
+
+void Downloader::updateSessionsCount(
+		MTP::DcId dcId,
+		const Throughput &throughput) {
+	if (!throughput.saturated || !throughput.latency) {
+		return;
+	}
+	const auto count = sessionsCount(dcId);
+	const auto inFlight = throughput.bytesPerSecond
+		* throughput.latency
+		/ 1000;
+	if (inFlight > kSessionBytesInFlight * count
+		&& count < MTP::kMaxDownloadSessionsCount) {
+		DEBUG_LOG(("Downloader Info: %1 download sessions for dc %2, "
+			"%3 bytes in flight."
+			).arg(count + 1
+			).arg(dcId
+			).arg(inFlight));
+		_sessionsCountForDc[dcId] = count + 1;
+	}
+}
+
 not_null<Downloader::Queue*> Downloader::queueForDc(MTP::DcId dcId) {
 	const auto i = _queuesForDc.find(dcId);
 	const auto result = (i != end(_queuesForDc))
 		? i
-		: _queuesForDc.emplace(dcId, Queue(kMaxFileQueries)).first;
+		: _queuesForDc.emplace(dcId, Queue(kStartFileQueries)).first;
 	return &result->second;
 }
 
+auto Downloader::loadWindow(MTP::DcId dcId) const -> LoadWindow {
+	auto result = LoadWindow();
+	const auto i = _queuesForDc.find(dcId);
+	result.queriesLimit = (i != end(_queuesForDc))
+		? i->second.queriesLimit
+		: kStartFileQueries;
+	const auto j = _throughputForDc.find(dcId);
+	if (j != end(_throughputForDc)) {
+		result.bytesPerSecond = j->second.bytesPerSecond;
+	}
+	return result;
+}
+
+void Downloader::partLoaded(MTP::DcId dcId, int bytes, crl::time sent) {
+	const auto now = crl::now();
+	if (now - sent >= kSlowPartTimeout) {
+		shrinkQueue(dcId);
+		return;
+	}
+	const auto queue = queueForDc(dcId);
+	auto &throughput = _throughputForDc[dcId];
+	if (!throughput.measureStart) {
+		throughput.measureStart = now;
+	}
+	throughput.measuredBytes += bytes;
+	throughput.latency = throughput.latency
+		? (throughput.latency * 3 + (now - sent)) / 4
+		: (now - sent);
+	if (queue->queriesCount + 1 >= queue->queriesLimit) {
+		throughput.saturated = true;
+	}
+	const auto elapsed = now - throughput.measureStart;
+	if (elapsed < kThroughputInterval) {
+		return;
+	}
+	const auto was = throughput.bytesPerSecond;
+	const auto speed = throughput.measuredBytes * 1000 / elapsed;
+	throughput.bytesPerSecond = speed;
+	if (throughput.saturated && speed < kSlowLinkBytesPerSecond) {
+		throughput.slowTill = now + kSlowLinkPauseDuration;
+	}
+	if (throughput.saturated && was > 0) {
+		auto &limit = queue->queriesLimit;
+		if (speed * 100 > was * kThroughputGrowPercent) {
+			limit = std::min(limit + kFileQueriesStep, kMaxFileQueries);
+		} else if (speed * 100 < was * kThroughputFallPercent) {
+			limit = std::max(limit - kFileQueriesStep, kMinFileQueries);
+		}
+	}
+	updateSessionsCount(dcId, throughput);
+	throughput.measureStart = now;
+	throughput.measuredBytes = 0;
+	throughput.saturated = false;
+}
+
+void Downloader::partFailed(MTP::DcId dcId) {
+	shrinkQueue(dcId);
+}
+
+bool Downloader::autoDownloadPaused(MTP::DcId dcId, bool visible) {
+	if (_api->session().settings().autoDownloadBudgetSpent()) {
+		return true;
+	} else if (visible) {
+		return false;
+	}
+	const auto i = _throughputForDc.find(dcId);
+	const auto now = crl::now();
+	if (i == end(_throughputForDc) || i->second.slowTill <= now) {
+		return false;
+	}
+	if (!_resumeAutoDownloadsTimer.isActive()) {
+		_resumeAutoDownloadsTimer.callOnce(i->second.slowTill - now);
+	}
+	return true;
+}
+
+void Downloader::autoDownloaded(int64 bytes) {
+	auto &settings = _api->session().settings();
+	const auto spent = settings.autoDownloadBudgetSpent();
+	settings.autoDownloaded(bytes);
+	if (!spent && settings.autoDownloadBudgetSpent()) {
+		LOG(("Download Info: Daily auto-download budget of %1 bytes spent."
+			).arg(settings.autoDownloadDailyLimit()));
+		Local::writeUserSettings();
+	}
+}
+
+void Downloader::shrinkQueue(MTP::DcId dcId) {
+	auto &limit = queueForDc(dcId)->queriesLimit;
+	limit = std::max(limit / 2, kMinFileQueries);
+
+	const auto i = _sessionsCountForDc.find(dcId);
+	if (i != end(_sessionsCountForDc)
+		&& i->second > MTP::kDownloadSessionsCount) {
+		--i->second;
+	}
+
+	auto &throughput = _throughputForDc[dcId];
+	throughput = Throughput();
+	throughput.slowTill = crl::now() + kSlowLinkPauseDuration;
+}
+
 not_null<Downloader::Queue*> Downloader::queueForWeb() {
 	return &_queueForWeb;
 }
@@ -236,6 +496,7 @@ Data::FileOrigin FileLoader::fileOrigin() const {
 
 float64 FileLoader::currentProgress() const {
 	if (_finished) return 1.;
+	if (_sharedLeader) return _sharedLeader->currentProgress();
 	if (!fullSize()) return 0.;
 	return snap(float64(currentOffset()) / fullSize(), 0., 1.);
 }
@@ -259,7 +520,13 @@ void FileLoader::permitLoadFromCloud() {
 
 void FileLoader::notifyAboutProgress() {
 	const auto queue = _queue;
+	const auto followers = _sharedFollowers;
 	emit progress(this);
+	for (const auto &follower : followers) {
+		if (follower) {
+			emit follower->progress(follower);
+		}
+	}
 	LoadNextFromQueue(queue);
 }
 
@@ -268,7 +535,13 @@ void FileLoader::LoadNextFromQueue(not_null<Queue*> queue) {
 		return;
 	}
 	for (auto i = queue->start; i;) {
-		if (i->loadPart()) {
+		if (i->_sharedLeader) {
+			i = i->_next;
+		} else if (i->demoted()
+			&& queue->queriesCount >= queue->queriesLimit / 2) {
+			// Leave the rest of the window for the current viewport.
+			i = i->_next;
+		} else if (i->loadPart()) {
 			if (queue->queriesCount >= queue->queriesLimit) {
 				return;
 			}
@@ -298,6 +571,7 @@ void FileLoader::removeFromQueue() {
 
 FileLoader::~FileLoader() {
 	removeFromQueue();
+	leaveSharedLoad();
 }
 
 void FileLoader::localLoaded(
@@ -307,7 +581,7 @@ void FileLoader::localLoaded(
 	_localLoading = nullptr;
 	if (result.data.isEmpty()) {
 		_localStatus = LocalStatus::NotFound;
-		start();
+		enqueue();
 		return;
 	}
 	if (!imageData.isNull()) {
@@ -319,6 +593,11 @@ void FileLoader::localLoaded(
 }
 
 void FileLoader::start() {
+	_loadPriority = _downloader->startPriority();
+	enqueue();
+}
+
+void FileLoader::enqueue() {
 	if (_finished || tryLoadLocal()) {
 		return;
 	} else if (_fromCloud == LoadFromLocalOnly) {
@@ -326,77 +605,147 @@ void FileLoader::start() {
 		return;
 	}
 
-	if (!_filename.isEmpty() && _toCache == LoadToFileOnly && !_fileIsOpen) {
-		_fileIsOpen = _file.open(QIODevice::WriteOnly);
-		if (!_fileIsOpen) {
+	if (!_filename.isEmpty() && _toCache == LoadToFileOnly && !_sink) {
+		_sink = std::make_unique<Storage::DownloadSink>(
+			_filename,
+			_size,
+			cacheKey());
+		if (!_sink->open()) {
+			_sink = nullptr;
 			return cancel(true);
 		}
 	}
 
-	auto currentPriority = _downloader->currentPriority();
-	FileLoader *before = nullptr, *after = nullptr;
+	const auto currentPriority = _downloader->currentPriority();
 	if (_inQueue && _priority == currentPriority) {
-		if (!_next || _next->_priority < currentPriority) return startLoading();
-		after = _next;
-		while (after->_next && after->_next->_priority == currentPriority) {
-			after = after->_next;
+		const auto placed = (!_prev || !QueuedBefore(this, _prev))
+			&& (!_next || !QueuedBefore(_next, this));
+		if (placed) {
+			return startLoading();
+		}
+	}
+	_priority = currentPriority;
+
+	removeFromQueue();
+
+	// Keep the order of loaders with the same priority.
+	auto after = (FileLoader*)nullptr;
+	for (auto i = _queue->start; i && !QueuedBefore(this, i); i = i->_next) {
+		after = i;
+	}
+	_inQueue = true;
+	_prev = after;
+	_next = after ? after->_next : _queue->start;
+	if (_prev) {
+		_prev->_next = this;
+	} else {
+		_queue->start = this;
+	}
+	if (_next) {
+		_next->_prev = this;
+	} else {
+		_queue->end = this;
+	}
+	return startLoading();
+}
+
+void FileLoader::joinSharedLoad() {
+	if (_toCache != LoadToCacheAsWell) {
+		return;
+	} else if (const auto leader = _sharedLeader.data()) {
+		// The download is served in the order of its best waiting loader.
+		if (QueuedBefore(this, leader)
+			|| _loadPriority > leader->_loadPriority) {
+			leader->_loadPriority = std::max(
+				leader->_loadPriority,
+				_loadPriority);
+			leader->enqueue();
 		}
+		return;
+	} else if (_sharedRegistered) {
+		return;
+	}
+	const auto key = cacheKey();
+	if (const auto leader = _downloader->sharedLoader(key)) {
+		_sharedLeader = leader;
+		leader->_sharedFollowers.push_back(this);
+		joinSharedLoad();
 	} else {
-		_priority = currentPriority;
-		if (_inQueue) {
-			if (_next && _next->_priority == currentPriority) {
-				after = _next;
-			} else if (_prev && _prev->_priority < currentPriority) {
-				before = _prev;
-				while (before->_prev && before->_prev->_priority < currentPriority) {
-					before = before->_prev;
-				}
-			} else {
-				return startLoading();
-			}
+		_sharedKey = key;
+		_sharedRegistered = true;
+		_downloader->registerSharedLoader(key, this);
+	}
+}
+
+void FileLoader::leaveSharedLoad() {
+	_sharedLeader = nullptr;
+	if (!_sharedRegistered) {
+		return;
+	}
+	_sharedRegistered = false;
+	_downloader->unregisterSharedLoader(_sharedKey, this);
+
+	// The first loader still waiting continues the download itself.
+	auto leader = (FileLoader*)nullptr;
+	for (const auto &follower : base::take(_sharedFollowers)) {
+		if (!follower || follower->_finished) {
+			continue;
+		} else if (!leader) {
+			leader = follower;
+			leader->_sharedLeader = nullptr;
+			leader->_sharedKey = _sharedKey;
+			leader->_sharedRegistered = true;
+			_downloader->registerSharedLoader(_sharedKey, leader);
 		} else {
-			if (_queue->start && _queue->start->_priority == currentPriority) {
-				after = _queue->start;
-			} else {
-				before = _queue->start;
-			}
-		}
-		if (after) {
-			while (after->_next && after->_next->_priority == currentPriority) {
-				after = after->_next;
-			}
+			follower->_sharedLeader = leader;
+			leader->_sharedFollowers.push_back(follower);
 		}
 	}
+	if (leader) {
+		const auto queue = leader->_queue;
+		crl::on_main(&session(), [=] { LoadNextFromQueue(queue); });
+	}
+}
 
-	removeFromQueue();
+void FileLoader::finishSharedLoad() {
+	if (!_sharedRegistered) {
+		return;
+	}
+	_sharedRegistered = false;
+	_downloader->unregisterSharedLoader(_sharedKey, this);
 
-	_inQueue = true;
-	if (!_queue->start) {
-		_queue->start = _queue->end = this;
-	} else if (before) {
-		if (before != _next) {
-			_prev = before->_prev;
-			_next = before;
-			_next->_prev = this;
-			if (_prev) {
-				_prev->_next = this;
-			}
-			if (_queue->start->_prev) _queue->start = _queue->start->_prev;
+	auto finished = std::vector<QPointer<FileLoader>>();
+	for (const auto &follower : base::take(_sharedFollowers)) {
+		if (follower && !follower->_finished) {
+			follower->_sharedLeader = nullptr;
+			follower->removeFromQueue();
+			follower->finishWithBytes(_data);
+			finished.push_back(follower);
 		}
-	} else if (after) {
-		if (after != _prev) {
-			_next = after->_next;
-			_prev = after;
-			after->_next = this;
-			if (_next) {
-				_next->_prev = this;
+	}
+	if (!finished.empty()) {
+		crl::on_main(&session(), [=] {
+			for (const auto &follower : finished) {
+				if (follower) {
+					emit follower->progress(follower);
+				}
 			}
-			if (_queue->end->_next) _queue->end = _queue->end->_next;
-		}
-	} else {
-		LOG(("Queue Error: _start && !before && !after"));
+		});
 	}
-	return startLoading();
+}
+
+bool FileLoader::QueuedBefore(
+		not_null<const FileLoader*> a,
+		not_null<const FileLoader*> b) {
+	return (a->_priority > b->_priority)
+		|| (a->_priority == b->_priority
+			&& a->_loadPriority > b->_loadPriority);
+}
+
+bool FileLoader::demoted() const {
+	return _autoLoading
+		&& (_loadPriority != Storage::LoadPriority::Background)
+		&& (_priority < _downloader->currentPriority());
 }
 
 void FileLoader::loadLocal(const Storage::Cache::Key &key) {
@@ -473,14 +822,20 @@ void FileLoader::cancel() {
 void FileLoader::cancel(bool fail) {
 	const auto started = (currentOffset() > 0);
 	cancelRequests();
+	leaveSharedLoad();
 	_cancelled = true;
 	_finished = true;
+	if (const auto sink = base::take(_sink)) {
+		sink->discard();
+	}
 	if (_fileIsOpen) {
 		_file.close();
 		_fileIsOpen = false;
 		_file.remove();
 	}
 	_data = QByteArray();
+	_readyParts.clear();
+	_readyPrefix = 0;
 	removeFromQueue();
 
 	const auto queue = _queue;
@@ -501,22 +856,40 @@ void FileLoader::cancel(bool fail) {
 }
 
 void FileLoader::startLoading() {
-	if ((_queue->queriesCount >= _queue->queriesLimit) || _finished) {
+	if (_finished) {
+		return;
+	}
+	joinSharedLoad();
+	if ((_queue->queriesCount >= _queue->queriesLimit) || _sharedLeader) {
 		return;
 	}
 	loadPart();
 }
 
 int FileLoader::currentOffset() const {
+	if (_sink) {
+		return int(_sink->written());
+	}
 	return (_fileIsOpen ? _file.size() : _data.size()) - _skippedBytes;
 }
 
+bool FileLoader::hasResultPart(int offset, int size) const {
+	return _sink && _sink->has(offset, size);
+}
+
 bool FileLoader::writeResultPart(int offset, bytes::const_span buffer) {
 	Expects(!_finished);
 
 	if (buffer.empty()) {
 		return true;
 	}
+	if (_sink) {
+		if (!_sink->write(offset, buffer)) {
+			cancel(true);
+			return false;
+		}
+		return true;
+	}
 	if (_fileIsOpen) {
 		auto fsize = _file.size();
 		if (offset < fsize) {
@@ -548,12 +921,34 @@ bool FileLoader::writeResultPart(int offset, bytes::const_span buffer) {
 			buffer.size());
 		bytes::copy(dst, buffer);
 	}
+	markResultPartReady(offset, buffer.size());
 	return true;
 }
 
+void FileLoader::markResultPartReady(int offset, int size) {
+	if (offset > _readyPrefix) {
+		auto &till = _readyParts[offset];
+		accumulate_max(till, offset + size);
+		return;
+	}
+	accumulate_max(_readyPrefix, offset + size);
+	while (!_readyParts.empty()
+		&& _readyParts.begin()->first <= _readyPrefix) {
+		accumulate_max(_readyPrefix, _readyParts.begin()->second);
+		_readyParts.erase(_readyParts.begin());
+	}
+}
+
+QByteArray FileLoader::readyBytes() const {
+	return _finished ? _data : _data.left(_readyPrefix);
+}
+
 QByteArray FileLoader::readLoadedPartBack(int offset, int size) {
 	Expects(offset >= 0 && size > 0);
 
+	if (_sink) {
+		return _sink->read(offset, size);
+	}
 	if (_fileIsOpen) {
 		if (_file.openMode() == QIODevice::WriteOnly) {
 			_file.close();
@@ -588,6 +983,15 @@ bool FileLoader::finalizeResult() {
 		}
 	}
 
+	if (const auto sink = base::take(_sink)) {
+		if (!sink->finish()) {
+			cancel(true);
+			return false;
+		}
+		Platform::File::PostprocessDownloaded(
+			QFileInfo(_filename).absoluteFilePath());
+	}
+
 	_finished = true;
 	if (_fileIsOpen) {
 		_file.close();
@@ -612,6 +1016,7 @@ bool FileLoader::finalizeResult() {
 					_cacheTag));
 		}
 	}
+	finishSharedLoad();
 	_downloader->taskFinished().notify();
 	return true;
 }
@@ -700,8 +1105,8 @@ void mtpFileLoader::refreshFileReferenceFrom(
 		cancel(true);
 		return;
 	}
-	const auto offset = finishSentRequestGetOffset(requestId);
-	makeRequest(offset);
+	const auto requestData = finishSentRequest(requestId);
+	makeRequests(requestData.offset, requestData.limit);
 }
 
 bool mtpFileLoader::loadPart() {
@@ -711,11 +1116,77 @@ bool mtpFileLoader::loadPart() {
 		return false;
 	}
 
+	if (!_bigPartSize
+		&& !_cdnDcId
+		&& _size >= Storage::kBigPartsFileSize
+		&& _nextRequestOffset >= Storage::kSmallPartsTill
+		&& base::get_if<StorageFileLocation>(&_location)) {
+		const auto window = _downloader->loadWindow(dcId());
+		_bigPartSize = (window.bytesPerSecond >= Storage::kBigPartsBytesPerSecond)
+			? Storage::kBigPartSize
+			: Storage::kMediumPartSize;
+	}
+	if (skipLoadedParts()) {
+		return false;
+	}
+	if (bandwidthClass() == Storage::BandwidthClass::AutoDownload
+		&& _downloader->autoDownloadPaused(
+			dcId(),
+			!demoted() && _loadPriority == Storage::LoadPriority::Visible)) {
+		return false;
+	}
+	const auto limit = partSize(_nextRequestOffset);
+	if (!_downloader->bandwidth().acquire(bandwidthClass(), limit)) {
+		return false;
+	}
 	makeRequest(_nextRequestOffset);
-	_nextRequestOffset += Storage::kPartSize;
+	_nextRequestOffset += limit;
 	return true;
 }
 
+bool mtpFileLoader::skipLoadedParts() {
+	if (!_size) {
+		return false;
+	}
+	const auto left = [&] {
+		return std::min(
+			partSize(_nextRequestOffset),
+			_size - _nextRequestOffset);
+	};
+	while (_nextRequestOffset < _size
+		&& hasResultPart(_nextRequestOffset, left())) {
+		_nextRequestOffset += partSize(_nextRequestOffset);
+	}
+	if (_nextRequestOffset < _size) {
+		return false;
+	} else if (_sentRequests.empty()
+		&& _cdnUncheckedParts.empty()
+		&& !_cdnPartsVerifying) {
+		// Everything was loaded before, finish outside of the queue loop.
+		crl::on_main(this, [=] {
+			if (!_finished && finalizeResult()) {
+				notifyAboutProgress();
+			}
+		});
+	}
+	return true;
+}
+
+Storage::BandwidthClass mtpFileLoader::bandwidthClass() const {
+	return _autoLoading
+		? Storage::BandwidthClass::AutoDownload
+		: Storage::BandwidthClass::Interactive;
+}
+
+int mtpFileLoader::partSize(int offset) const {
+	return (_cdnDcId
+		|| !_bigPartSize
+		|| offset < Storage::kSmallPartsTill
+		|| (offset % _bigPartSize) != 0)
+		? Storage::kPartSize
+		: _bigPartSize;
+}
+
 MTP::DcId mtpFileLoader::dcId() const {
 	if (const auto storage = base::get_if<StorageFileLocation>(&_location)) {
 		return storage->dcId();
@@ -730,12 +1201,13 @@ mtpFileLoader::RequestData mtpFileLoader::prepareRequest(int offset) const {
 		? _downloader->chooseDcIndexForRequest(result.dcId)
 		: 0;
 	result.offset = offset;
+	result.limit = partSize(offset);
 	return result;
 }
 
 mtpRequestId mtpFileLoader::sendRequest(const RequestData &requestData) {
 	const auto offset = requestData.offset;
-	const auto limit = Storage::kPartSize;
+	const auto limit = requestData.limit;
 	const auto shiftedDcId = MTP::downloadDcId(
 		requestData.dcId,
 		requestData.dcIndex);
@@ -804,6 +1276,21 @@ void mtpFileLoader::makeRequest(int offset) {
 	placeSentRequest(sendRequest(requestData), requestData);
 }
 
+void mtpFileLoader::makeRequests(int offset, int limit) {
+	const auto till = offset + limit;
+	while (offset < till) {
+		if (_size && offset >= _size) {
+			break;
+		}
+		auto requestData = prepareRequest(offset);
+		if (offset + requestData.limit > till) {
+			requestData.limit = Storage::kPartSize;
+		}
+		placeSentRequest(sendRequest(requestData), requestData);
+		offset += requestData.limit;
+	}
+}
+
 void mtpFileLoader::requestMoreCdnFileHashes() {
 	Expects(!_finished);
 
@@ -816,6 +1303,7 @@ void mtpFileLoader::requestMoreCdnFileHashes() {
 	requestData.dcId = dcId();
 	requestData.dcIndex = 0;
 	requestData.offset = offset;
+	requestData.limit = Storage::kPartSize;
 	auto shiftedDcId = MTP::downloadDcId(
 		requestData.dcId,
 		requestData.dcIndex);
@@ -835,9 +1323,15 @@ void mtpFileLoader::normalPartLoaded(
 	Expects(!_finished);
 	Expects(result.type() == mtpc_upload_fileCdnRedirect || result.type() == mtpc_upload_file);
 
-	auto offset = finishSentRequestGetOffset(requestId);
+	if (result.type() == mtpc_upload_file) {
+		reportPartLoaded(
+			requestId,
+			result.c_upload_file().vbytes().v.size());
+	}
+	const auto requestData = finishSentRequest(requestId);
+	const auto offset = requestData.offset;
 	if (result.type() == mtpc_upload_fileCdnRedirect) {
-		return switchToCDN(offset, result.c_upload_fileCdnRedirect());
+		return switchToCDN(requestData, result.c_upload_fileCdnRedirect());
 	}
 	auto buffer = bytes::make_span(result.c_upload_file().vbytes().v);
 	return partLoaded(offset, buffer);
@@ -865,12 +1359,18 @@ void mtpFileLoader::webPartLoaded(
 void mtpFileLoader::cdnPartLoaded(const MTPupload_CdnFile &result, mtpRequestId requestId) {
 	Expects(!_finished);
 
+	if (result.type() == mtpc_upload_cdnFile) {
+		reportPartLoaded(
+			requestId,
+			result.c_upload_cdnFile().vbytes().v.size());
+	}
 	const auto offset = finishSentRequestGetOffset(requestId);
 	result.match([&](const MTPDupload_cdnFileReuploadNeeded &data) {
 		auto requestData = RequestData();
 		requestData.dcId = dcId();
 		requestData.dcIndex = 0;
 		requestData.offset = offset;
+		requestData.limit = Storage::kPartSize;
 		const auto shiftedDcId = MTP::downloadDcId(
 			requestData.dcId,
 			requestData.dcIndex);
@@ -883,42 +1383,78 @@ void mtpFileLoader::cdnPartLoaded(const MTPupload_CdnFile &result, mtpRequestId
 			shiftedDcId);
 		placeSentRequest(requestId, requestData);
 	}, [&](const MTPDupload_cdnFile &data) {
-		auto key = bytes::make_span(_cdnEncryptionKey);
-		auto iv = bytes::make_span(_cdnEncryptionIV);
-		Expects(key.size() == MTP::CTRState::KeySize);
-		Expects(iv.size() == MTP::CTRState::IvecSize);
-
-		auto state = MTP::CTRState();
-		auto ivec = bytes::make_span(state.ivec);
-		std::copy(iv.begin(), iv.end(), ivec.begin());
-
-		auto counterOffset = static_cast<uint32>(offset) >> 4;
-		state.ivec[15] = static_cast<uchar>(counterOffset & 0xFF);
-		state.ivec[14] = static_cast<uchar>((counterOffset >> 8) & 0xFF);
-		state.ivec[13] = static_cast<uchar>((counterOffset >> 16) & 0xFF);
-		state.ivec[12] = static_cast<uchar>((counterOffset >> 24) & 0xFF);
-
-		auto decryptInPlace = data.vbytes().v;
-		auto buffer = bytes::make_detached_span(decryptInPlace);
-		MTP::aesCtrEncrypt(buffer, key.data(), &state);
-
-		switch (checkCdnFileHash(offset, buffer)) {
-		case CheckCdnHashResult::NoHash: {
-			_cdnUncheckedParts.emplace(offset, decryptInPlace);
-			requestMoreCdnFileHashes();
-		} return;
+		Expects(_cdnEncryptionKey.size() == MTP::CTRState::KeySize);
+		Expects(_cdnEncryptionIV.size() == MTP::CTRState::IvecSize);
+
+		// Decryption and hash check are done on a worker thread.
+		const auto i = _cdnFileHashes.find(offset);
+		const auto hash = (i != end(_cdnFileHashes))
+			? i->second.hash
+			: QByteArray();
+		const auto weak = QPointer<mtpFileLoader>(this);
+		++_cdnPartsVerifying;
+		crl::async([
+			=,
+			key = _cdnEncryptionKey,
+			iv = _cdnEncryptionIV,
+			decryptInPlace = data.vbytes().v
+		]() mutable {
+			auto buffer = bytes::make_detached_span(decryptInPlace);
+			Storage::DecryptCdnPart(
+				buffer,
+				bytes::make_span(key),
+				bytes::make_span(iv),
+				offset);
+			const auto result = hash.isEmpty()
+				? CheckCdnHashResult::NoHash
+				: bytes::compare(
+					openssl::Sha256(buffer),
+					bytes::make_span(hash))
+				? CheckCdnHashResult::Invalid
+				: CheckCdnHashResult::Good;
+			crl::on_main([
+				=,
+				decrypted = std::move(decryptInPlace)
+			]() mutable {
+				if (const auto strong = weak.data()) {
+					strong->cdnPartVerified(
+						offset,
+						std::move(decrypted),
+						result);
+				}
+			});
+		});
+	});
+}
 
-		case CheckCdnHashResult::Invalid: {
-			LOG(("API Error: Wrong cdnFileHash for offset %1.").arg(offset));
-			cancel(true);
-		} return;
+void mtpFileLoader::cdnPartVerified(
+		int offset,
+		QByteArray decrypted,
+		CheckCdnHashResult result) {
+	--_cdnPartsVerifying;
+	if (_finished) {
+		return;
+	} else if (result == CheckCdnHashResult::NoHash
+		&& _cdnFileHashes.count(offset)) {
+		// The hashes arrived while the part was decrypted.
+		result = checkCdnFileHash(offset, bytes::make_span(decrypted));
+	}
+	switch (result) {
+	case CheckCdnHashResult::NoHash: {
+		_cdnUncheckedParts.emplace(offset, std::move(decrypted));
+		requestMoreCdnFileHashes();
+	} return;
+
+	case CheckCdnHashResult::Invalid: {
+		LOG(("API Error: Wrong cdnFileHash for offset %1.").arg(offset));
+		cancel(true);
+	} return;
 
-		case CheckCdnHashResult::Good: {
-			partLoaded(offset, buffer);
-		} return;
-		}
-		Unexpected("Result of checkCdnFileHash()");
-	});
+	case CheckCdnHashResult::Good: {
+		partLoaded(offset, bytes::make_span(decrypted));
+	} return;
+	}
+	Unexpected("Result of checkCdnFileHash()");
 }
 
 mtpFileLoader::CheckCdnHashResult mtpFileLoader::checkCdnFileHash(
@@ -939,9 +1475,9 @@ mtpFileLoader::CheckCdnHashResult mtpFileLoader::checkCdnFileHash(
 void mtpFileLoader::reuploadDone(
 		const MTPVector<MTPFileHash> &result,
 		mtpRequestId requestId) {
-	auto offset = finishSentRequestGetOffset(requestId);
+	const auto requestData = finishSentRequest(requestId);
 	addCdnHashes(result.v);
-	makeRequest(offset);
+	makeRequests(requestData.offset, requestData.limit);
 }
 
 void mtpFileLoader::getCdnFileHashesDone(
@@ -1011,12 +1547,26 @@ void mtpFileLoader::placeSentRequest(
 	_downloader->requestedAmountIncrement(
 		requestData.dcId,
 		requestData.dcIndex,
-		Storage::kPartSize);
+		requestData.limit);
 	++_queue->queriesCount;
-	_sentRequests.emplace(requestId, requestData);
+	_sentRequests.emplace(
+		requestId,
+		requestData
+	).first->second.sent = crl::now();
+}
+
+void mtpFileLoader::reportPartLoaded(mtpRequestId requestId, int bytes) {
+	const auto i = _sentRequests.find(requestId);
+	if (i != end(_sentRequests)) {
+		_downloader->partLoaded(dcId(), bytes, i->second.sent);
+		if (bandwidthClass() == Storage::BandwidthClass::AutoDownload) {
+			_downloader->autoDownloaded(bytes);
+		}
+	}
 }
 
-int mtpFileLoader::finishSentRequestGetOffset(mtpRequestId requestId) {
+auto mtpFileLoader::finishSentRequest(mtpRequestId requestId)
+-> RequestData {
 	auto it = _sentRequests.find(requestId);
 	Assert(it != _sentRequests.cend());
 
@@ -1024,12 +1574,16 @@ int mtpFileLoader::finishSentRequestGetOffset(mtpRequestId requestId) {
 	_downloader->requestedAmountIncrement(
 		requestData.dcId,
 		requestData.dcIndex,
-		-Storage::kPartSize);
+		-requestData.limit);
 
 	--_queue->queriesCount;
 	_sentRequests.erase(it);
 
-	return requestData.offset;
+	return requestData;
+}
+
+int mtpFileLoader::finishSentRequestGetOffset(mtpRequestId requestId) {
+	return finishSentRequest(requestId).offset;
 }
 
 bool mtpFileLoader::feedPart(int offset, bytes::const_span buffer) {
@@ -1041,6 +1595,7 @@ bool mtpFileLoader::feedPart(int offset, bytes::const_span buffer) {
 	}
 	const auto finished = _sentRequests.empty()
 		&& _cdnUncheckedParts.empty()
+		&& !_cdnPartsVerifying
 		&& (_lastComplete || (_size && _nextRequestOffset >= _size));
 	if (finished && !finalizeResult()) {
 		return false;
@@ -1080,6 +1635,7 @@ bool mtpFileLoader::partFailed(
 	if (MTP::isDefaultHandledError(error)) {
 		return false;
 	}
+	_downloader->partFailed(dcId());
 	cancel(true);
 	return true;
 }
@@ -1096,9 +1652,9 @@ bool mtpFileLoader::cdnPartFailed(
 	}
 	if (error.type() == qstr("FILE_TOKEN_INVALID")
 		|| error.type() == qstr("REQUEST_TOKEN_INVALID")) {
-		auto offset = finishSentRequestGetOffset(requestId);
+		const auto requestData = finishSentRequest(requestId);
 		changeCDNParams(
-			offset,
+			requestData,
 			0,
 			QByteArray(),
 			QByteArray(),
@@ -1118,10 +1674,10 @@ void mtpFileLoader::cancelRequests() {
 }
 
 void mtpFileLoader::switchToCDN(
-		int offset,
+		const RequestData &requestData,
 		const MTPDupload_fileCdnRedirect &redirect) {
 	changeCDNParams(
-		offset,
+		requestData,
 		redirect.vdc_id().v,
 		redirect.vfile_token().v,
 		redirect.vencryption_key().v,
@@ -1140,7 +1696,7 @@ void mtpFileLoader::addCdnHashes(const QVector<MTPFileHash> &hashes) {
 }
 
 void mtpFileLoader::changeCDNParams(
-		int offset,
+		const RequestData &requestData,
 		MTP::DcId dcId,
 		const QByteArray &token,
 		const QByteArray &encryptionKey,
@@ -1165,19 +1721,18 @@ void mtpFileLoader::changeCDNParams(
 	addCdnHashes(hashes);
 
 	if (resendAllRequests && !_sentRequests.empty()) {
-		auto resendOffsets = std::vector<int>();
-		resendOffsets.reserve(_sentRequests.size());
+		auto resendRequests = std::vector<RequestData>();
+		resendRequests.reserve(_sentRequests.size());
 		while (!_sentRequests.empty()) {
 			auto requestId = _sentRequests.begin()->first;
 			MTP::cancel(requestId);
-			auto resendOffset = finishSentRequestGetOffset(requestId);
-			resendOffsets.push_back(resendOffset);
+			resendRequests.push_back(finishSentRequest(requestId));
 		}
-		for (auto resendOffset : resendOffsets) {
-			makeRequest(resendOffset);
+		for (const auto &resend : resendRequests) {
+			makeRequests(resend.offset, resend.limit);
 		}
 	}
-	makeRequest(offset);
+	makeRequests(requestData.offset, requestData.limit);
 }
 
 Storage::Cache::Key mtpFileLoader::cacheKey() const {
@@ -1281,6 +1836,7 @@ class webFileLoaderPrivate {
 public:
 	webFileLoaderPrivate(webFileLoader *loader, const QString &url)
 		: _interface(loader)
+		, _originalUrl(url)
 		, _url(url)
 		, _redirectsLeft(kMaxHttpRedirects) {
 	}
@@ -1290,15 +1846,29 @@ public:
 	}
 
 	QNetworkReply *request(QNetworkAccessManager &manager, const QString &redirect) {
-		if (!redirect.isEmpty()) _url = redirect;
+		if (!redirect.isEmpty()) {
+			// Location may be relative to the current url.
+			_url = _url.resolved(QUrl(redirect));
+		}
 
 		QNetworkRequest req(_url);
 		QByteArray rangeHeaderValue = "bytes=" + QByteArray::number(_already) + "-";
 		req.setRawHeader("Range", rangeHeaderValue);
+
+		// The manager keeps a pool of connections for each host,
+		// keep them alive and multiplex over HTTP/2 where possible.
+		req.setRawHeader("Connection", "keep-alive");
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+		req.setAttribute(QNetworkRequest::HTTP2AllowedAttribute, true);
+#endif // Qt >= 5.8.0
 		_reply = manager.get(req);
 		return _reply;
 	}
 
+	const QString &originalUrl() const {
+		return _originalUrl;
+	}
+
 	bool oneMoreRedirect() {
 		if (_redirectsLeft) {
 			--_redirectsLeft;
@@ -1332,6 +1902,7 @@ private:
 	static constexpr auto kMaxHttpRedirects = 5;
 
 	webFileLoader *_interface = nullptr;
+	QString _originalUrl;
 	QUrl _url;
 	qint64 _already = 0;
 	qint64 _size = 0;
@@ -1418,10 +1989,51 @@ bool WebLoadManager::handleReplyResult(webFileLoaderPrivate *loader, WebReplyPro
 		emit progress(it.key(), loader->already(), loader->size());
 		return true;
 	}
+	rememberResponse(loader->originalUrl(), loader->data());
 	emit finished(it.key(), loader->data());
 	return false;
 }
 
+void WebLoadManager::rememberResponse(
+		const QString &url,
+		const QByteArray &data) {
+	const auto size = int64(data.size());
+	if (!size || size > kMaxCachedWebResponseSize) {
+		return;
+	}
+	const auto i = _responses.find(url);
+	if (i != end(_responses)) {
+		_responsesSize -= i->second.data.size();
+		_responses.erase(i);
+	}
+	while (!_responses.empty()
+		&& _responsesSize + size > kMaxCachedWebResponses) {
+		const auto oldest = ranges::min_element(
+			_responses,
+			std::less<>(),
+			[](const auto &pair) { return pair.second.used; });
+		_responsesSize -= oldest->second.data.size();
+		_responses.erase(oldest);
+	}
+	_responses.emplace(url, CachedResponse{ data, ++_responsesUsed });
+	_responsesSize += size;
+}
+
+bool WebLoadManager::finishFromCache(webFileLoaderPrivate *loader) {
+	const auto i = _responses.find(loader->originalUrl());
+	if (i == end(_responses)) {
+		return false;
+	}
+	i->second.used = ++_responsesUsed;
+
+	QMutexLocker lock(&_loaderPointersMutex);
+	const auto it = _loaderPointers.find(loader->_interface);
+	if (it != _loaderPointers.cend() && it.key()->_private == loader) {
+		emit finished(it.key(), i->second.data);
+	}
+	return true;
+}
+
 void WebLoadManager::onFailed(QNetworkReply::NetworkError error) {
 	onFailed(qobject_cast<QNetworkReply*>(QObject::sender()));
 }
@@ -1459,7 +2071,11 @@ void WebLoadManager::onProgress(qint64 already, qint64 size) {
 	const auto statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute);
 	const auto status = statusCode.isValid() ? statusCode.toInt() : 200;
 	if (status != 200 && status != 206 && status != 416) {
-		if (status == 301 || status == 302) {
+		if (status == 301
+			|| status == 302
+			|| status == 303
+			|| status == 307
+			|| status == 308) {
 			QString loc = reply->header(QNetworkRequest::LocationHeader).toString();
 			if (!loc.isEmpty()) {
 				if (loader->oneMoreRedirect()) {
@@ -1557,7 +2173,12 @@ void WebLoadManager::process() {
 		}
 	}
 	for_const (webFileLoaderPrivate *loader, newLoaders) {
-		if (_loaders.contains(loader)) {
+		if (!_loaders.contains(loader)) {
+			continue;
+		} else if (finishFromCache(loader)) {
+			_loaders.remove(loader);
+			delete loader;
+		} else {
 			sendRequest(loader);
 		}
 	}
@@ -11,19 +11,21 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/timer.h"
 #include "base/binary_guard.h"
 #include "data/data_file_origin.h"
+#include "storage/cache/storage_cache_types.h"
+#include "storage/storage_bandwidth.h"
 
 #include <QtNetwork/QNetworkReply>
 
 class ApiWrap;
+class FileLoader;
 
 namespace Main {
 class Session;
 } // namespace Main
 
 namespace Storage {
-namespace Cache {
-struct Key;
-} // namespace Cache
+
+class DownloadSink;
 
 // This value is used in local cache database settings!
 constexpr auto kMaxFileInMemory = 10 * 1024 * 1024; // 10 MB max file could be hold in memory
@@ -34,6 +36,15 @@ constexpr auto kMaxWallPaperInMemory = kMaxFileInMemory;
 constexpr auto kMaxAnimationInMemory = kMaxFileInMemory; // 10 MB gif and mp4 animations held in memory while playing
 constexpr auto kMaxWallPaperDimension = 4096; // 4096x4096 is max area.
 
+// Loaders are served by the priority generation, the newest first,
+// and by this value inside the same generation.
+enum class LoadPriority {
+	Background, // Downloads the user started, they are never demoted.
+	Prefetch,
+	NearViewport,
+	Visible,
+};
+
 class Downloader final {
 public:
 	struct Queue {
@@ -55,8 +66,13 @@ public:
 	int currentPriority() const {
 		return _priority;
 	}
+	// Called when the viewport changes, auto-loaders that are not
+	// started again after that get only a half of the parts window.
 	void clearPriorities();
 
+	[[nodiscard]] LoadPriority startPriority() const;
+	void setStartPriority(LoadPriority priority);
+
 	base::Observable<void> &taskFinished() {
 		return _taskFinishedObservable;
 	}
@@ -64,28 +80,103 @@ public:
 	void requestedAmountIncrement(MTP::DcId dcId, int index, int amount);
 	int chooseDcIndexForRequest(MTP::DcId dcId) const;
 
+	// How many download sessions are used for a DC right now, it grows
+	// while the bytes in flight don't fit in the current sessions.
+	[[nodiscard]] int sessionsCount(MTP::DcId dcId) const;
+
+	// Opens a download session to a DC media was seen from, once per DC,
+	// so that the first file from it doesn't wait for the connection.
+	void prewarmDc(MTP::DcId dcId);
+
 	not_null<Queue*> queueForDc(MTP::DcId dcId);
 	not_null<Queue*> queueForWeb();
 
+	[[nodiscard]] Bandwidth &bandwidth() {
+		return _bandwidth;
+	}
+
+	// The parts limit of a DC queue grows while the throughput grows
+	// and is halved on slow or failed parts.
+	struct LoadWindow {
+		int queriesLimit = 0;
+		int64 bytesPerSecond = 0;
+	};
+	[[nodiscard]] LoadWindow loadWindow(MTP::DcId dcId) const;
+	void partLoaded(MTP::DcId dcId, int bytes, crl::time sent);
+	void partFailed(MTP::DcId dcId);
+
+	// Auto-downloads wait while the daily budget is spent, and those not
+	// in the viewport wait while the link to the DC is slow.
+	[[nodiscard]] bool autoDownloadPaused(MTP::DcId dcId, bool visible);
+	void autoDownloaded(int64 bytes);
+
+	// Loaders of the same cache key wait for the one registered here.
+	[[nodiscard]] FileLoader *sharedLoader(const Cache::Key &key) const;
+	void registerSharedLoader(
+		const Cache::Key &key,
+		not_null<FileLoader*> loader);
+	void unregisterSharedLoader(
+		const Cache::Key &key,
+		not_null<FileLoader*> loader);
+
 private:
+	struct Throughput {
+		crl::time measureStart = 0;
+		int64 measuredBytes = 0;
+		int64 bytesPerSecond = 0;
+		crl::time latency = 0;
+		crl::time slowTill = 0;
+		bool saturated = false;
+	};
+
+	void shrinkQueue(MTP::DcId dcId);
+	void updateSessionsCount(MTP::DcId dcId, const Throughput &throughput);
 	void killDownloadSessionsStart(MTP::DcId dcId);
 	void killDownloadSessionsStop(MTP::DcId dcId);
 	void killDownloadSessions();
+	void resumeAutoDownloads();
 
 	not_null<ApiWrap*> _api;
 
 	base::Observable<void> _taskFinishedObservable;
 	int _priority = 1;
+	LoadPriority _startPriority = LoadPriority::Visible;
 
-	using RequestedInDc = std::array<int64, MTP::kDownloadSessionsCount>;
+	using RequestedInDc = std::array<int64, MTP::kMaxDownloadSessionsCount>;
 	std::map<MTP::DcId, RequestedInDc> _requestedBytesAmount;
+	base::flat_map<MTP::DcId, int> _sessionsCountForDc;
+	base::flat_set<MTP::DcId> _prewarmedDcs;
 
 	base::flat_map<MTP::DcId, crl::time> _killDownloadSessionTimes;
 	base::Timer _killDownloadSessionsTimer;
+	base::Timer _resumeAutoDownloadsTimer;
 
 	std::map<MTP::DcId, Queue> _queuesForDc;
+	std::map<MTP::DcId, Throughput> _throughputForDc;
 	Queue _queueForWeb;
 
+	std::map<Cache::Key, not_null<FileLoader*>> _sharedLoaders;
+
+	Bandwidth _bandwidth;
+
+	rpl::lifetime _lifetime;
+
+};
+
+// Loaders started while the scope is alive get the given priority.
+class LoadPriorityScope final {
+public:
+	LoadPriorityScope(
+		not_null<Downloader*> downloader,
+		LoadPriority priority);
+	LoadPriorityScope(const LoadPriorityScope &other) = delete;
+	LoadPriorityScope &operator=(const LoadPriorityScope &other) = delete;
+	~LoadPriorityScope();
+
+private:
+	const not_null<Downloader*> _downloader;
+	const LoadPriority _was;
+
 };
 
 } // namespace Storage
@@ -127,6 +218,7 @@ public:
 	const QByteArray &bytes() const {
 		return _data;
 	}
+	[[nodiscard]] QByteArray readyBytes() const;
 	virtual uint64 objId() const {
 		return 0;
 	}
@@ -168,6 +260,8 @@ public:
 		const QByteArray &imageFormat,
 		const QImage &imageData);
 
+	static void LoadNextFromQueue(not_null<Storage::Downloader::Queue*> queue);
+
 signals:
 	void progress(FileLoader *loader);
 	void failed(FileLoader *loader, bool started);
@@ -190,15 +284,24 @@ protected:
 	virtual std::optional<MediaKey> fileLocationKey() const = 0;
 	virtual void cancelRequests() = 0;
 
+	void enqueue();
+	void joinSharedLoad();
+	void leaveSharedLoad();
+	void finishSharedLoad();
 	void startLoading();
 	void removeFromQueue();
+	[[nodiscard]] bool demoted() const;
+	[[nodiscard]] static bool QueuedBefore(
+		not_null<const FileLoader*> a,
+		not_null<const FileLoader*> b);
 	void cancel(bool failed);
 
 	void notifyAboutProgress();
-	static void LoadNextFromQueue(not_null<Queue*> queue);
 	virtual bool loadPart() = 0;
 
+	[[nodiscard]] bool hasResultPart(int offset, int size) const;
 	bool writeResultPart(int offset, bytes::const_span buffer);
+	void markResultPartReady(int offset, int size);
 	bool finalizeResult();
 	[[nodiscard]] QByteArray readLoadedPartBack(int offset, int size);
 
@@ -206,8 +309,15 @@ protected:
 	FileLoader *_prev = nullptr;
 	FileLoader *_next = nullptr;
 	int _priority = 0;
+	Storage::LoadPriority _loadPriority = Storage::LoadPriority::Visible;
 	Queue *_queue = nullptr;
 
+	// Loaders to memory of the same file share one download.
+	QPointer<FileLoader> _sharedLeader;
+	std::vector<QPointer<FileLoader>> _sharedFollowers;
+	Storage::Cache::Key _sharedKey;
+	bool _sharedRegistered = false;
+
 	bool _autoLoading = false;
 	uint8 _cacheTag = 0;
 	bool _inQueue = false;
@@ -219,11 +329,19 @@ protected:
 	QFile _file;
 	bool _fileIsOpen = false;
 
+	// Downloads straight to a file go through the sink and are never
+	// buffered in memory, the part ranges loaded before are skipped.
+	std::unique_ptr<Storage::DownloadSink> _sink;
+
 	LoadToCacheSetting _toCache;
 	LoadFromCloudSetting _fromCloud;
 
 	QByteArray _data;
 
+	// Parts may come in any order, track how much is ready from the start.
+	base::flat_map<int, int> _readyParts;
+	int _readyPrefix = 0;
+
 	int _size = 0;
 	int _skippedBytes = 0;
 	LocationType _locationType = LocationType();
@@ -280,6 +398,8 @@ private:
 		MTP::DcId dcId = 0;
 		int dcIndex = 0;
 		int offset = 0;
+		int limit = 0;
+		crl::time sent = 0;
 	};
 	struct CdnFileHash {
 		CdnFileHash(int limit, QByteArray hash) : limit(limit), hash(hash) {
@@ -292,8 +412,12 @@ private:
 	void cancelRequests() override;
 
 	MTP::DcId dcId() const;
+	int partSize(int offset) const;
+	bool skipLoadedParts();
+	Storage::BandwidthClass bandwidthClass() const;
 	RequestData prepareRequest(int offset) const;
 	void makeRequest(int offset);
+	void makeRequests(int offset, int limit);
 
 	bool loadPart() override;
 	void normalPartLoaded(const MTPupload_File &result, mtpRequestId requestId);
@@ -312,10 +436,12 @@ private:
 
 	mtpRequestId sendRequest(const RequestData &requestData);
 	void placeSentRequest(mtpRequestId requestId, const RequestData &requestData);
+	void reportPartLoaded(mtpRequestId requestId, int bytes);
+	RequestData finishSentRequest(mtpRequestId requestId);
 	int finishSentRequestGetOffset(mtpRequestId requestId);
-	void switchToCDN(int offset, const MTPDupload_fileCdnRedirect &redirect);
+	void switchToCDN(const RequestData &requestData, const MTPDupload_fileCdnRedirect &redirect);
 	void addCdnHashes(const QVector<MTPFileHash> &hashes);
-	void changeCDNParams(int offset, MTP::DcId dcId, const QByteArray &token, const QByteArray &encryptionKey, const QByteArray &encryptionIV, const QVector<MTPFileHash> &hashes);
+	void changeCDNParams(const RequestData &requestData, MTP::DcId dcId, const QByteArray &token, const QByteArray &encryptionKey, const QByteArray &encryptionIV, const QVector<MTPFileHash> &hashes);
 
 	enum class CheckCdnHashResult {
 		NoHash,
@@ -323,11 +449,16 @@ private:
 		Good,
 	};
 	CheckCdnHashResult checkCdnFileHash(int offset, bytes::const_span buffer);
+	void cdnPartVerified(
+		int offset,
+		QByteArray decrypted,
+		CheckCdnHashResult result);
 
 	std::map<mtpRequestId, RequestData> _sentRequests;
 
 	bool _lastComplete = false;
 	int32 _nextRequestOffset = 0;
+	int _bigPartSize = 0;
 
 	base::variant<
 		StorageFileLocation,
@@ -342,6 +473,7 @@ private:
 	QByteArray _cdnEncryptionIV;
 	std::map<int, CdnFileHash> _cdnFileHashes;
 	std::map<int, QByteArray> _cdnUncheckedParts;
+	int _cdnPartsVerifying = 0;
 	mtpRequestId _cdnHashesRequestId = 0;
 
 };
@@ -420,9 +552,16 @@ public slots:
 	void finish();
 
 private:
+	struct CachedResponse {
+		QByteArray data;
+		uint64 used = 0;
+	};
+
 	void clear();
 	void sendRequest(webFileLoaderPrivate *loader, const QString &redirect = QString());
 	bool handleReplyResult(webFileLoaderPrivate *loader, WebReplyProcessResult result);
+	void rememberResponse(const QString &url, const QByteArray &data);
+	bool finishFromCache(webFileLoaderPrivate *loader);
 
 	QNetworkAccessManager _manager;
 	typedef QMap<webFileLoader*, webFileLoaderPrivate*> LoaderPointers;
@@ -435,6 +574,11 @@ private:
 	typedef QMap<QNetworkReply*, webFileLoaderPrivate*> Replies;
 	Replies _replies;
 
+	// Accessed only from the manager thread.
+	base::flat_map<QString, CachedResponse> _responses;
+	int64 _responsesSize = 0;
+	uint64 _responsesUsed = 0;
+
 };
 
 class WebLoadMainManager : public QObject {
@@ -0,0 +1,203 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "storage/file_download_sink.h"
+
+#include <QtCore/QDataStream>
+#include <QtCore/QFileInfo>
+
+namespace Storage {
+namespace {
+
+constexpr auto kRangesVersion = quint32(1);
+
+QString PartPath(const QString &path) {
+	return path + qstr(".part");
+}
+
+QString RangesPath(const QString &path) {
+	return path + qstr(".part.ranges");
+}
+
+} // namespace
+
+DownloadSink::DownloadSink(
+	const QString &path,
+	int64 size,
+	const Cache::Key &key)
+: _path(path)
+, _size(size)
+, _key(key)
+, _file(PartPath(path))
+, _ranges(RangesPath(path)) {
+}
+
+bool DownloadSink::open() {
+	if (!_ranges.open(QIODevice::ReadWrite)) {
+		return false;
+	}
+	const auto resume = (_size > 0)
+		&& (QFileInfo(_file).size() == _size)
+		&& readRanges();
+	if (!resume) {
+		_written.clear();
+		_writtenBytes = 0;
+	}
+	const auto mode = resume
+		? QIODevice::ReadWrite
+		: (QIODevice::ReadWrite | QIODevice::Truncate);
+	if (!_file.open(mode)) {
+		_ranges.close();
+		return false;
+	}
+
+	// Extending the file by resize() leaves a hole on file systems
+	// with sparse files support, so nothing is written here.
+	if (_size > 0 && _file.size() != _size && !_file.resize(_size)) {
+		discard();
+		return false;
+	}
+	return resume || writeRanges();
+}
+
+int64 DownloadSink::written() const {
+	return _writtenBytes;
+}
+
+bool DownloadSink::has(int64 offset, int64 size) const {
+	auto i = _written.upper_bound(offset);
+	if (i == begin(_written)) {
+		return false;
+	}
+	--i;
+	return (i->second >= offset + size);
+}
+
+bool DownloadSink::write(int64 offset, bytes::const_span buffer) {
+	Expects(offset >= 0);
+
+	if (buffer.empty()) {
+		return true;
+	}
+	const auto size = int64(buffer.size());
+	if (!_file.seek(offset)
+		|| _file.write(
+			reinterpret_cast<const char*>(buffer.data()),
+			size) != size
+		|| !_file.flush()) {
+		return false;
+	}
+
+	// The data is flushed before the sidecar, so that the sidecar
+	// never lists a range that was not written to the file.
+	addRange(offset, offset + size);
+	return writeRanges();
+}
+
+QByteArray DownloadSink::read(int64 offset, int size) {
+	Expects(offset >= 0 && size > 0);
+
+	if (!has(offset, size) || !_file.seek(offset)) {
+		return QByteArray();
+	}
+	auto result = _file.read(size);
+	return (result.size() == size) ? result : QByteArray();
+}
+
+bool DownloadSink::finish() {
+	_file.close();
+	_ranges.close();
+	if (QFile::exists(_path) && !QFile::remove(_path)) {
+		return false;
+	} else if (!QFile::rename(_file.fileName(), _path)) {
+		return false;
+	}
+	QFile::remove(_ranges.fileName());
+	return true;
+}
+
+void DownloadSink::discard() {
+	_file.close();
+	_ranges.close();
+	_file.remove();
+	_ranges.remove();
+	_written.clear();
+	_writtenBytes = 0;
+}
+
+bool DownloadSink::readRanges() {
+	const auto data = _ranges.readAll();
+	QDataStream stream(data);
+	stream.setVersion(QDataStream::Qt_5_1);
+
+	auto version = quint32();
+	auto high = quint64();
+	auto low = quint64();
+	auto size = qint64();
+	auto count = quint32();
+	stream >> version >> high >> low >> size >> count;
+	if (stream.status() != QDataStream::Ok
+		|| version != kRangesVersion
+		|| high != _key.high
+		|| low != _key.low
+		|| size != _size) {
+		return false;
+	}
+	auto till = int64(0);
+	for (auto i = quint32(0); i != count; ++i) {
+		auto from = qint64();
+		auto next = qint64();
+		stream >> from >> next;
+		if (stream.status() != QDataStream::Ok
+			|| from < till
+			|| next <= from
+			|| next > _size) {
+			return false;
+		}
+		addRange(from, next);
+		till = next;
+	}
+	return true;
+}
+
+bool DownloadSink::writeRanges() {
+	auto data = QByteArray();
+	{
+		QDataStream stream(&data, QIODevice::WriteOnly);
+		stream.setVersion(QDataStream::Qt_5_1);
+		stream
+			<< kRangesVersion
+			<< quint64(_key.high)
+			<< quint64(_key.low)
+			<< qint64(_size)
+			<< quint32(_written.size());
+		for (const auto &[from, till] : _written) {
+			stream << qint64(from) << qint64(till);
+		}
+	}
+	return _ranges.seek(0)
+		&& (_ranges.write(data) == data.size())
+		&& _ranges.resize(data.size())
+		&& _ranges.flush();
+}
+
+void DownloadSink::addRange(int64 from, int64 till) {
+	auto i = _written.upper_bound(from);
+	if (i != begin(_written) && std::prev(i)->second >= from) {
+		--i;
+	}
+	while (i != end(_written) && i->first <= till) {
+		from = std::min(from, i->first);
+		till = std::max(till, i->second);
+		_writtenBytes -= (i->second - i->first);
+		i = _written.erase(i);
+	}
+	_written.emplace(from, till);
+	_writtenBytes += (till - from);
+}
+
+} // namespace Storage
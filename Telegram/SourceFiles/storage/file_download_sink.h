@@ -0,0 +1,56 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "storage/cache/storage_cache_types.h"
+#include "base/bytes.h"
+
+#include <QtCore/QFile>
+
+namespace Storage {
+
+// Writes parts of a download at their offsets to "<path>.part" and keeps
+// the written ranges in a "<path>.part.ranges" sidecar file, so that the
+// download can be continued after a restart. The file is preallocated
+// (sparse where the file system supports it) and renamed to the target
+// path when the download is finished.
+class DownloadSink final {
+public:
+	DownloadSink(const QString &path, int64 size, const Cache::Key &key);
+	DownloadSink(const DownloadSink &other) = delete;
+	DownloadSink &operator=(const DownloadSink &other) = delete;
+
+	// Continues a previous download of the same file if there is one.
+	[[nodiscard]] bool open();
+
+	[[nodiscard]] int64 written() const;
+	[[nodiscard]] bool has(int64 offset, int64 size) const;
+
+	[[nodiscard]] bool write(int64 offset, bytes::const_span buffer);
+	[[nodiscard]] QByteArray read(int64 offset, int size);
+
+	[[nodiscard]] bool finish();
+	void discard();
+
+private:
+	bool readRanges();
+	bool writeRanges();
+	void addRange(int64 from, int64 till);
+
+	QString _path;
+	int64 _size = 0;
+	Cache::Key _key;
+
+	QFile _file;
+	QFile _ranges;
+	std::map<int64, int64> _written; // from -> till
+	int64 _writtenBytes = 0;
+
+};
+
+} // namespace Storage
@@ -8,18 +8,41 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "storage/file_upload.h"
 
 #include "storage/localimageloader.h"
+#include "storage/localstorage.h"
 #include "storage/file_download.h"
 #include "mtproto/connection.h" // for MTP::kAckSendWaiting
 #include "data/data_document.h"
 #include "data/data_photo.h"
 #include "data/data_session.h"
 #include "main/main_session.h"
+#include "base/unixtime.h"
+
+#include <QtCore/QMutex>
+#include <QtCore/QFileInfo>
 
 namespace Storage {
 namespace {
 
-// max 512kb uploaded at the same time in each session
-constexpr auto kMaxUploadFileParallelSize = MTP::kUploadSessionsCount * 512 * 1024;
+// Bytes uploaded at the same time in each session, the window starts
+// with 512kb and grows up to 4mb while the parts are acknowledged fast.
+constexpr auto kUploadSessionWindowMin = uint32(512 * 1024);
+constexpr auto kUploadSessionWindowMax = uint32(4 * 1024 * 1024);
+constexpr auto kUploadAckLatencyGood = crl::time(1000);
+constexpr auto kUploadAckLatencyBad = crl::time(3000);
+
+// Document parts are read from disk this much ahead of sending.
+constexpr auto kUploadReadAheadSize = 4 * 1024 * 1024;
+
+// Upload speed is measured over periods of that length and documents
+// are sent in the largest parts when the link is at least that fast.
+constexpr auto kUploadSpeedPeriod = crl::time(1000);
+constexpr auto kUploadFastSpeed = int64(1024 * 1024);
+
+// Big file parts are kept on the server for a limited time, so the upload
+// is continued after a restart only if it was started not long ago.
+constexpr auto kResumableUploadTimeout = TimeId(6 * 3600);
+constexpr auto kResumableUploadsLimit = 8;
+constexpr auto kSaveResumableUploadsDelay = crl::time(5000);
 
 constexpr auto kDocumentMaxPartsCount = 3000;
 
@@ -52,6 +75,12 @@ struct Uploader::File {
 
 	void setDocSize(int32 size);
 	bool setPartSize(uint32 partSize);
+	void setLargestPartSize();
+
+	const QString &filepath() const;
+	bool resumable() const;
+	bool partAcknowledged(int32 part) const;
+	void setPartAcknowledged(int32 part);
 
 	std::shared_ptr<FileLoadResult> file;
 	SendMediaReady media;
@@ -65,12 +94,28 @@ struct Uploader::File {
 
 	HashMd5 md5Hash;
 
-	std::unique_ptr<QFile> docFile;
+	std::shared_ptr<PartsReader> docReader;
+	base::flat_map<int32, QByteArray> docReadParts;
+	int32 docReadRequested = 0;
+	bool docReadFailed = false;
 	int32 docSentParts = 0;
 	int32 docSize = 0;
 	int32 docPartSize = 0;
 	int32 docPartsCount = 0;
 
+	uint64 docFileId = 0;
+	int64 docModified = 0;
+	TimeId docStartedAt = 0;
+	QByteArray docAcknowledged;
+	bool docPrepared = false;
+	bool docHashed = false;
+
+};
+
+struct Uploader::Preupload {
+	QByteArray data;
+	int32 sentParts = 0;
+	base::flat_set<int32> acknowledged;
 };
 
 Uploader::File::File(const SendMediaReady &media) : media(media) {
@@ -84,6 +129,7 @@ Uploader::File::File(const SendMediaReady &media) : media(media) {
 	} else {
 		docSize = docPartSize = docPartsCount = 0;
 	}
+	docFileId = id();
 }
 Uploader::File::File(const std::shared_ptr<FileLoadResult> &file)
 : file(file) {
@@ -98,6 +144,7 @@ Uploader::File::File(const std::shared_ptr<FileLoadResult> &file)
 	} else {
 		docSize = docPartSize = docPartsCount = 0;
 	}
+	docFileId = id();
 }
 
 void Uploader::File::setDocSize(int32 size) {
@@ -124,6 +171,86 @@ bool Uploader::File::setPartSize(uint32 partSize) {
 	return (docPartsCount <= kDocumentMaxPartsCount);
 }
 
+void Uploader::File::setLargestPartSize() {
+	constexpr auto limit0 = 1024 * 1024;
+	if (docSize >= limit0 && docPartSize < kDocumentUploadPartSize4) {
+		setPartSize(kDocumentUploadPartSize4);
+	}
+}
+
+const QString &Uploader::File::filepath() const {
+	return file ? file->filepath : media.file;
+}
+
+bool Uploader::File::resumable() const {
+	const auto &content = file ? file->content : media.data;
+	return (docSize > kUseBigFilesFrom)
+		&& content.isEmpty()
+		&& !filepath().isEmpty();
+}
+
+bool Uploader::File::partAcknowledged(int32 part) const {
+	const auto index = part / 8;
+	return (index < docAcknowledged.size())
+		&& (uchar(docAcknowledged[index]) & (1 << (part % 8)));
+}
+
+void Uploader::File::setPartAcknowledged(int32 part) {
+	const auto index = part / 8;
+	if (index < docAcknowledged.size()) {
+		docAcknowledged[index] = char(
+			uchar(docAcknowledged[index]) | (1 << (part % 8)));
+	}
+}
+
+// Reads document parts on worker threads, mapping the file if possible.
+class Uploader::PartsReader final {
+public:
+	explicit PartsReader(const QString &path);
+
+	[[nodiscard]] bool open();
+	[[nodiscard]] QByteArray read(int64 offset, int size);
+
+private:
+	QMutex _mutex;
+	QFile _file;
+	int64 _size = 0;
+	uchar *_mapped = nullptr;
+	bool _mapTried = false;
+
+};
+
+Uploader::PartsReader::PartsReader(const QString &path) : _file(path) {
+}
+
+bool Uploader::PartsReader::open() {
+	QMutexLocker lock(&_mutex);
+	if (!_file.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+	_size = _file.size();
+	return true;
+}
+
+QByteArray Uploader::PartsReader::read(int64 offset, int size) {
+	QMutexLocker lock(&_mutex);
+	if (!_mapTried) {
+		_mapTried = true;
+		_mapped = _size ? _file.map(0, _size) : nullptr;
+	}
+	if (offset < 0 || offset >= _size) {
+		return QByteArray();
+	} else if (_mapped) {
+		const auto available = int(std::min(int64(size), _size - offset));
+		return QByteArray(
+			reinterpret_cast<const char*>(_mapped + offset),
+			available);
+	} else if (!_file.seek(offset)) {
+		return QByteArray();
+	}
+	return _file.read(size);
+}
+
 uint64 Uploader::File::id() const {
 	return file ? file->id : media.id;
 }
@@ -141,11 +268,20 @@ const QString &Uploader::File::filename() const {
 }
 
 Uploader::Uploader(not_null<ApiWrap*> api)
-: _api(api) {
+: _api(api)
+, _saveResumableUploadsTimer([=] { saveResumableUploads(); }) {
 	nextTimer.setSingleShot(true);
 	connect(&nextTimer, SIGNAL(timeout()), this, SLOT(sendNext()));
 	stopSessionsTimer.setSingleShot(true);
 	connect(&stopSessionsTimer, SIGNAL(timeout()), this, SLOT(stopSessions()));
+	for (auto &window : _sessionWindows) {
+		window = kUploadSessionWindowMin;
+	}
+
+	_api->session().downloader().bandwidth().refilled(
+	) | rpl::start_with_next([=] {
+		sendNext();
+	}, _lifetime);
 }
 
 void Uploader::uploadMedia(
@@ -211,6 +347,123 @@ void Uploader::upload(
 	sendNext();
 }
 
+uint64 Uploader::startPreupload() {
+	auto id = rand_value<uint64>();
+	while (_preuploads.find(id) != end(_preuploads)) {
+		id = rand_value<uint64>();
+	}
+	_preuploads.emplace(id, Preupload());
+	return id;
+}
+
+void Uploader::preuploadBytes(uint64 id, const QByteArray &bytes) {
+	const auto i = _preuploads.find(id);
+	if (i == end(_preuploads)) {
+		return;
+	}
+	i->second.data.append(bytes);
+	sendPreuploadParts(id, i->second);
+}
+
+void Uploader::cancelPreupload(uint64 id) {
+	_preuploads.erase(id);
+	for (auto i = begin(_preuploadRequests); i != end(_preuploadRequests);) {
+		if (i->second.first == id) {
+			MTP::cancel(i->first);
+			i = _preuploadRequests.erase(i);
+		} else {
+			++i;
+		}
+	}
+}
+
+void Uploader::sendPreuploadParts(uint64 id, Preupload &preupload) {
+	// Only complete parts are sent, the last one is known on sending.
+	constexpr auto size = kDocumentUploadPartSize0;
+	while ((preupload.sentParts + 1) * size <= preupload.data.size()
+		&& (preupload.sentParts + 1) * size <= kUseBigFilesFrom) {
+		const auto part = preupload.sentParts++;
+		const auto requestId = MTP::send(
+			MTPupload_SaveFilePart(
+				MTP_long(id),
+				MTP_int(part),
+				MTP_bytes(preupload.data.mid(part * size, size))),
+			rpcDone(&Uploader::preuploadPartLoaded),
+			rpcFail(&Uploader::preuploadPartFailed),
+			MTP::uploadDcId(0));
+		_preuploadRequests.emplace(requestId, std::make_pair(id, part));
+	}
+	if (!_preuploadRequests.empty()) {
+		stopSessionsTimer.stop();
+	}
+}
+
+void Uploader::preuploadPartLoaded(
+		const MTPBool &result,
+		mtpRequestId requestId) {
+	const auto request = _preuploadRequests.take(requestId);
+	if (!request || !mtpIsTrue(result)) {
+		return;
+	}
+	const auto &[id, part] = *request;
+	const auto i = _preuploads.find(id);
+	if (i != end(_preuploads)) {
+		i->second.acknowledged.emplace(part);
+	}
+	if (_preuploadRequests.empty() && queue.empty()) {
+		sendNext();
+	}
+}
+
+bool Uploader::preuploadPartFailed(
+		const RPCError &error,
+		mtpRequestId requestId) {
+	if (MTP::isDefaultHandledError(error)) return false;
+
+	// The part will be sent again with the rest of the file.
+	_preuploadRequests.remove(requestId);
+	if (_preuploadRequests.empty() && queue.empty()) {
+		sendNext();
+	}
+	return true;
+}
+
+bool Uploader::usePreupload(File &file) {
+	const auto i = _preuploads.find(file.id());
+	if (i == end(_preuploads)) {
+		return false;
+	}
+	// Parts still in flight are sent again, the answers are ignored.
+	const auto preupload = std::move(i->second);
+	_preuploads.erase(i);
+
+	const auto &content = file.file ? file.file->content : file.media.data;
+	if (content.isEmpty() || file.docSize > kUseBigFilesFrom) {
+		return false;
+	}
+	constexpr auto size = kDocumentUploadPartSize0;
+	file.setPartSize(size);
+	file.docAcknowledged = QByteArray((file.docPartsCount + 7) / 8, 0);
+	for (const auto part : preupload.acknowledged) {
+		// If the writer went back and changed the part, send it again.
+		const auto offset = part * size;
+		const auto same = (part < file.docPartsCount)
+			&& (offset + size <= content.size())
+			&& !memcmp(
+				content.constData() + offset,
+				preupload.data.constData() + offset,
+				size);
+		if (same) {
+			file.setPartAcknowledged(part);
+		}
+	}
+
+	// Skipped parts are not passed to the hash while sending.
+	file.md5Hash.feed(content.constData(), content.size());
+	file.docHashed = true;
+	return true;
+}
+
 void Uploader::currentFailed() {
 	auto j = queue.find(uploadingId);
 	if (j != queue.end()) {
@@ -229,15 +482,17 @@ void Uploader::currentFailed() {
 		} else {
 			Unexpected("Type in Uploader::currentFailed.");
 		}
+		forgetUpload(j->second);
 		queue.erase(j);
 	}
 
 	requestsSent.clear();
 	docRequestsSent.clear();
 	dcMap.clear();
+	_sentAt.clear();
 	uploadingId = FullMsgId();
 	sentSize = 0;
-	for (int i = 0; i < MTP::kUploadSessionsCount; ++i) {
+	for (int i = 0; i < MTP::kMaxUploadSessionsCount; ++i) {
 		sentSizes[i] = 0;
 	}
 
@@ -245,17 +500,219 @@ void Uploader::currentFailed() {
 }
 
 void Uploader::stopSessions() {
-	for (int i = 0; i < MTP::kUploadSessionsCount; ++i) {
+	for (int i = 0; i < MTP::kMaxUploadSessionsCount; ++i) {
 		MTP::stopSession(MTP::uploadDcId(i));
 	}
+	_sessionsCount = MTP::kUploadSessionsCount;
+}
+
+int Uploader::chooseSession() const {
+	auto result = -1;
+	auto room = uint32(0);
+	for (auto dc = 0; dc != _sessionsCount; ++dc) {
+		if (sentSizes[dc] < _sessionWindows[dc]
+			&& _sessionWindows[dc] - sentSizes[dc] > room) {
+			room = _sessionWindows[dc] - sentSizes[dc];
+			result = dc;
+		}
+	}
+	return result;
+}
+
+void Uploader::updateSessionWindow(
+		int dc,
+		crl::time latency,
+		int32 partSize) {
+	auto &window = _sessionWindows[dc];
+	if (latency < kUploadAckLatencyGood) {
+		window = std::min(window + uint32(partSize), kUploadSessionWindowMax);
+		const auto full = [](uint32 value) {
+			return (value == kUploadSessionWindowMax);
+		};
+		if (_sessionsCount < MTP::kMaxUploadSessionsCount
+			&& std::all_of(
+				_sessionWindows,
+				_sessionWindows + _sessionsCount,
+				full)) {
+			_sessionWindows[_sessionsCount++] = kUploadSessionWindowMin;
+		}
+	} else if (latency > kUploadAckLatencyBad) {
+		window = std::max(window / 2, kUploadSessionWindowMin);
+		if (_sessionsCount > MTP::kUploadSessionsCount) {
+			--_sessionsCount;
+		}
+	}
+}
+
+void Uploader::updateSpeed(int32 sentPartSize) {
+	const auto now = crl::now();
+	if (!_speedFrom) {
+		_speedFrom = now;
+		_speedBytes = 0;
+		return;
+	}
+	_speedBytes += sentPartSize;
+	if (now - _speedFrom >= kUploadSpeedPeriod) {
+		_uploadSpeed = _speedBytes * 1000 / (now - _speedFrom);
+		_speedFrom = now;
+		_speedBytes = 0;
+	}
+}
+
+void Uploader::resumeUpload(File &file) {
+	if (!file.resumable()) {
+		return;
+	}
+	file.docModified = QFileInfo(
+		file.filepath()).lastModified().toMSecsSinceEpoch();
+	file.docStartedAt = base::unixtime::now();
+	file.docAcknowledged = QByteArray((file.docPartsCount + 7) / 8, 0);
+
+	if (!_resumableUploadsRead) {
+		_resumableUploadsRead = true;
+		_resumableUploads = Local::ReadResumableUploads();
+	}
+	const auto i = ranges::find_if(_resumableUploads, [&](
+			const ResumableUpload &upload) {
+		return (upload.path == file.filepath())
+			&& (upload.size == file.docSize)
+			&& (upload.modified == file.docModified);
+	});
+	if (i == end(_resumableUploads)) {
+		return;
+	}
+	const auto partSize = i->partSize;
+	const auto partsCount = (partSize > 0 && !(partSize % 1024))
+		? ((file.docSize + partSize - 1) / partSize)
+		: 0;
+	const auto good = partsCount
+		&& (partSize <= kDocumentUploadPartSize4)
+		&& !(kDocumentUploadPartSize4 % partSize)
+		&& (partsCount == i->partsCount)
+		&& (partsCount <= kDocumentMaxPartsCount)
+		&& (i->acknowledged.size() == (partsCount + 7) / 8)
+		&& (file.docStartedAt - i->startedAt < kResumableUploadTimeout);
+	if (!good) {
+		_resumableUploads.erase(i);
+		saveResumableUploadsDelayed();
+		return;
+	}
+	file.setPartSize(partSize);
+	file.docFileId = i->fileId;
+	file.docStartedAt = i->startedAt;
+	file.docAcknowledged = i->acknowledged;
+	DEBUG_LOG(("Upload Info: resuming upload of '%1'.").arg(file.filepath()));
+}
+
+void Uploader::rememberUpload(const File &file) {
+	if (!file.resumable() || !file.docStartedAt) {
+		return;
+	}
+	const auto i = ranges::find(
+		_resumableUploads,
+		file.filepath(),
+		&ResumableUpload::path);
+	auto &upload = (i != end(_resumableUploads))
+		? *i
+		: _resumableUploads.emplace_back();
+	upload.path = file.filepath();
+	upload.size = file.docSize;
+	upload.modified = file.docModified;
+	upload.fileId = file.docFileId;
+	upload.partSize = file.docPartSize;
+	upload.partsCount = file.docPartsCount;
+	upload.startedAt = file.docStartedAt;
+	upload.acknowledged = file.docAcknowledged;
+	while (_resumableUploads.size() > kResumableUploadsLimit) {
+		_resumableUploads.erase(ranges::min_element(
+			_resumableUploads,
+			std::less<>(),
+			&ResumableUpload::startedAt));
+	}
+	saveResumableUploadsDelayed();
+}
+
+void Uploader::forgetUpload(const File &file) {
+	if (!file.resumable()) {
+		return;
+	}
+	const auto i = ranges::find(
+		_resumableUploads,
+		file.filepath(),
+		&ResumableUpload::path);
+	if (i != end(_resumableUploads)) {
+		_resumableUploads.erase(i);
+		saveResumableUploadsDelayed();
+	}
+}
+
+void Uploader::saveResumableUploadsDelayed() {
+	if (!_saveResumableUploadsTimer.isActive()) {
+		_saveResumableUploadsTimer.callOnce(kSaveResumableUploadsDelay);
+	}
+}
+
+void Uploader::saveResumableUploads() {
+	_saveResumableUploadsTimer.cancel();
+
+	const auto now = base::unixtime::now();
+	_resumableUploads.erase(ranges::remove_if(_resumableUploads, [&](
+			const ResumableUpload &upload) {
+		return (now - upload.startedAt >= kResumableUploadTimeout);
+	}), end(_resumableUploads));
+	Local::WriteResumableUploads(_resumableUploads);
+}
+
+void Uploader::readDocParts(const FullMsgId &msgId, File &file) {
+	const auto ahead = std::max(kUploadReadAheadSize / file.docPartSize, 2);
+	const auto till = std::min(file.docPartsCount, file.docSentParts + ahead);
+	const auto weak = QPointer<Uploader>(this);
+	while (file.docReadRequested < till) {
+		const auto part = file.docReadRequested++;
+		if (file.partAcknowledged(part)) {
+			continue;
+		}
+		const auto offset = int64(part) * file.docPartSize;
+		const auto size = file.docPartSize;
+		crl::async([=, reader = file.docReader] {
+			auto bytes = reader->read(offset, size);
+			crl::on_main(weak, [=, bytes = std::move(bytes)]() mutable {
+				weak->docPartRead(msgId, reader, part, std::move(bytes));
+			});
+		});
+	}
+}
+
+void Uploader::docPartRead(
+		const FullMsgId &msgId,
+		const std::shared_ptr<PartsReader> &reader,
+		int32 part,
+		QByteArray bytes) {
+	const auto i = queue.find(msgId);
+	if (i == end(queue) || i->second.docReader != reader) {
+		return;
+	}
+	auto &file = i->second;
+	const auto offset = part * file.docPartSize;
+	const auto expected = std::min(file.docPartSize, file.docSize - offset);
+	if (bytes.size() != expected) {
+		file.docReadFailed = true;
+	} else {
+		file.docReadParts.emplace(part, std::move(bytes));
+	}
+	if (uploadingId == msgId) {
+		sendNext();
+	}
 }
 
 void Uploader::sendNext() {
-	if (sentSize >= kMaxUploadFileParallelSize || _pausedId.msg) return;
+	const auto todc = chooseSession();
+	if (todc < 0 || _pausedId.msg) return;
 
 	bool stopping = stopSessionsTimer.isActive();
 	if (queue.empty()) {
-		if (!stopping) {
+		_speedFrom = 0;
+		if (!stopping && _preuploadRequests.empty()) {
 			stopSessionsTimer.start(
 				MTP::kAckSendWaiting + kKillSessionTimeout);
 		}
@@ -273,11 +730,13 @@ void Uploader::sendNext() {
 		uploadingId = i->first;
 	}
 	auto &uploadingData = i->second;
-
-	auto todc = 0;
-	for (auto dc = 1; dc != MTP::kUploadSessionsCount; ++dc) {
-		if (sentSizes[dc] < sentSizes[todc]) {
-			todc = dc;
+	if (!uploadingData.docPrepared) {
+		uploadingData.docPrepared = true;
+		if (!usePreupload(uploadingData)) {
+			if (_uploadSpeed >= kUploadFastSpeed) {
+				uploadingData.setLargestPartSize();
+			}
+			resumeUpload(uploadingData);
 		}
 	}
 
@@ -294,6 +753,10 @@ void Uploader::sendNext() {
 			: uploadingData.file->thumbId)
 		: uploadingData.media.thumbId;
 	if (parts.isEmpty()) {
+		while (uploadingData.docSentParts < uploadingData.docPartsCount
+			&& uploadingData.partAcknowledged(uploadingData.docSentParts)) {
+			++uploadingData.docSentParts;
+		}
 		if (uploadingData.docSentParts >= uploadingData.docPartsCount) {
 			if (requestsSent.empty() && docRequestsSent.empty()) {
 				const auto options = uploadingData.file
@@ -326,7 +789,7 @@ void Uploader::sendNext() {
 
 					const auto file = (uploadingData.docSize > kUseBigFilesFrom)
 						? MTP_inputFileBig(
-							MTP_long(uploadingData.id()),
+							MTP_long(uploadingData.docFileId),
 							MTP_int(uploadingData.docPartsCount),
 							MTP_string(uploadingData.filename()))
 						: MTP_inputFile(
@@ -365,30 +828,52 @@ void Uploader::sendNext() {
 						uploadingData.id(),
 						uploadingData.partsCount });
 				}
+				forgetUpload(uploadingData);
 				queue.erase(uploadingId);
 				uploadingId = FullMsgId();
 				sendNext();
 			}
 			return;
 		}
-
 		auto &content = uploadingData.file
 			? uploadingData.file->content
 			: uploadingData.media.data;
-		QByteArray toSend;
 		if (content.isEmpty()) {
-			if (!uploadingData.docFile) {
+			if (!uploadingData.docReader) {
 				const auto filepath = uploadingData.file
 					? uploadingData.file->filepath
 					: uploadingData.media.file;
-				uploadingData.docFile = std::make_unique<QFile>(filepath);
-				if (!uploadingData.docFile->open(QIODevice::ReadOnly)) {
+				uploadingData.docReader = std::make_shared<PartsReader>(
+					filepath);
+				if (!uploadingData.docReader->open()) {
 					currentFailed();
 					return;
 				}
 			}
-			toSend = uploadingData.docFile->read(uploadingData.docPartSize);
-			if (uploadingData.docSize <= kUseBigFilesFrom) {
+			readDocParts(uploadingId, uploadingData);
+			if (uploadingData.docReadFailed) {
+				currentFailed();
+				return;
+			} else if (!uploadingData.docReadParts.contains(
+					uploadingData.docSentParts)) {
+				// We'll get here again when the part is read.
+				return;
+			}
+		}
+		if (!_api->session().downloader().bandwidth().acquire(
+				Storage::BandwidthClass::Upload,
+				uploadingData.docPartSize)) {
+			return;
+		}
+
+		QByteArray toSend;
+		if (content.isEmpty()) {
+			const auto ready = uploadingData.docReadParts.find(
+				uploadingData.docSentParts);
+			toSend = std::move(ready->second);
+			uploadingData.docReadParts.erase(ready);
+			if (uploadingData.docSize <= kUseBigFilesFrom
+				&& !uploadingData.docHashed) {
 				uploadingData.md5Hash.feed(toSend.constData(), toSend.size());
 			}
 		} else {
@@ -398,7 +883,8 @@ void Uploader::sendNext() {
 			if ((uploadingData.type() == SendMediaType::File
 				|| uploadingData.type() == SendMediaType::ThemeFile
 				|| uploadingData.type() == SendMediaType::Audio)
-				&& uploadingData.docSentParts <= kUseBigFilesFrom) {
+				&& uploadingData.docSentParts <= kUseBigFilesFrom
+				&& !uploadingData.docHashed) {
 				uploadingData.md5Hash.feed(toSend.constData(), toSend.size());
 			}
 		}
@@ -412,7 +898,7 @@ void Uploader::sendNext() {
 		if (uploadingData.docSize > kUseBigFilesFrom) {
 			requestId = MTP::send(
 				MTPupload_SaveBigFilePart(
-					MTP_long(uploadingData.id()),
+					MTP_long(uploadingData.docFileId),
 					MTP_int(uploadingData.docSentParts),
 					MTP_int(uploadingData.docPartsCount),
 					MTP_bytes(toSend)),
@@ -431,12 +917,18 @@ void Uploader::sendNext() {
 		}
 		docRequestsSent.emplace(requestId, uploadingData.docSentParts);
 		dcMap.emplace(requestId, todc);
+		_sentAt.emplace(requestId, crl::now());
 		sentSize += uploadingData.docPartSize;
 		sentSizes[todc] += uploadingData.docPartSize;
 
 		uploadingData.docSentParts++;
 	} else {
 		auto part = parts.begin();
+		if (!_api->session().downloader().bandwidth().acquire(
+				Storage::BandwidthClass::Upload,
+				part.value().size())) {
+			return;
+		}
 
 		const auto requestId = MTP::send(
 			MTPupload_SaveFilePart(
@@ -448,20 +940,24 @@ void Uploader::sendNext() {
 			MTP::uploadDcId(todc));
 		requestsSent.emplace(requestId, part.value());
 		dcMap.emplace(requestId, todc);
+		_sentAt.emplace(requestId, crl::now());
 		sentSize += part.value().size();
 		sentSizes[todc] += part.value().size();
 
 		parts.erase(part);
 	}
-	nextTimer.start(kUploadRequestInterval);
+
+	// Keep the sessions busy while they have room for more parts.
+	nextTimer.start((chooseSession() >= 0) ? 0 : kUploadRequestInterval);
 }
 
 void Uploader::cancel(const FullMsgId &msgId) {
 	uploaded.erase(msgId);
 	if (uploadingId == msgId) {
 		currentFailed();
-	} else {
-		queue.erase(msgId);
+	} else if (const auto i = queue.find(msgId); i != end(queue)) {
+		forgetUpload(i->second);
+		queue.erase(i);
 	}
 }
 
@@ -480,6 +976,11 @@ void Uploader::confirm(const FullMsgId &msgId) {
 void Uploader::clear() {
 	uploaded.clear();
 	queue.clear();
+	_preuploads.clear();
+	for (const auto &requestData : _preuploadRequests) {
+		MTP::cancel(requestData.first);
+	}
+	_preuploadRequests.clear();
 	for (const auto &requestData : requestsSent) {
 		MTP::cancel(requestData.first);
 	}
@@ -489,11 +990,14 @@ void Uploader::clear() {
 	}
 	docRequestsSent.clear();
 	dcMap.clear();
+	_sentAt.clear();
 	sentSize = 0;
-	for (int i = 0; i < MTP::kUploadSessionsCount; ++i) {
+	for (int i = 0; i < MTP::kMaxUploadSessionsCount; ++i) {
 		MTP::stopSession(MTP::uploadDcId(i));
 		sentSizes[i] = 0;
+		_sessionWindows[i] = kUploadSessionWindowMin;
 	}
+	_sessionsCount = MTP::kUploadSessionsCount;
 	stopSessionsTimer.stop();
 }
 
@@ -525,10 +1029,16 @@ void Uploader::partLoaded(const MTPBool &result, mtpRequestId requestId) {
 				requestsSent.erase(i);
 			} else {
 				sentPartSize = file.docPartSize;
+				file.setPartAcknowledged(j->second);
 				docRequestsSent.erase(j);
+				rememberUpload(file);
 			}
 			sentSize -= sentPartSize;
 			sentSizes[dc] -= sentPartSize;
+			if (const auto sentAt = _sentAt.take(requestId)) {
+				updateSessionWindow(dc, crl::now() - *sentAt, sentPartSize);
+			}
+			updateSpeed(sentPartSize);
 			if (file.type() == SendMediaType::Photo) {
 				file.fileSentSize += sentPartSize;
 				const auto photo = Auth().data().photo(file.id());
@@ -575,6 +1085,9 @@ bool Uploader::partFailed(const RPCError &error, mtpRequestId requestId) {
 }
 
 Uploader::~Uploader() {
+	if (_saveResumableUploadsTimer.isActive()) {
+		saveResumableUploads();
+	}
 	clear();
 }
 
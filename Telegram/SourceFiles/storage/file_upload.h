@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #pragma once
 
 #include "api/api_common.h"
+#include "base/timer.h"
 
 #include <QtCore/QTimer>
 
@@ -54,6 +55,19 @@ struct UploadSecureDone {
 	int partsCount = 0;
 };
 
+// Progress of a big file upload saved to the local storage, so that
+// the same file sent again after a restart continues where it stopped.
+struct ResumableUpload {
+	QString path;
+	int64 size = 0;
+	int64 modified = 0;
+	uint64 fileId = 0;
+	int32 partSize = 0;
+	int32 partsCount = 0;
+	TimeId startedAt = 0;
+	QByteArray acknowledged; // One bit for each part.
+};
+
 class Uploader : public QObject, public RPCSender {
 	Q_OBJECT
 
@@ -66,6 +80,14 @@ public:
 		const FullMsgId &msgId,
 		const std::shared_ptr<FileLoadResult> &file);
 
+	// Parts of a file that is still being written, like a voice message
+	// that is recorded, are uploaded as soon as they are complete. When
+	// the file is sent with the same id only the parts that match the
+	// final content are skipped.
+	[[nodiscard]] uint64 startPreupload();
+	void preuploadBytes(uint64 id, const QByteArray &bytes);
+	void cancelPreupload(uint64 id);
+
 	void cancel(const FullMsgId &msgId);
 	void pause(const FullMsgId &msgId);
 	void confirm(const FullMsgId &msgId);
@@ -110,18 +132,61 @@ public slots:
 
 private:
 	struct File;
+	struct Preupload;
+	class PartsReader;
 
 	void partLoaded(const MTPBool &result, mtpRequestId requestId);
 	bool partFailed(const RPCError &err, mtpRequestId requestId);
 
+	void sendPreuploadParts(uint64 id, Preupload &preupload);
+	void preuploadPartLoaded(const MTPBool &result, mtpRequestId requestId);
+	bool preuploadPartFailed(const RPCError &error, mtpRequestId requestId);
+	[[nodiscard]] bool usePreupload(File &file);
+
+	void readDocParts(const FullMsgId &msgId, File &file);
+	void docPartRead(
+		const FullMsgId &msgId,
+		const std::shared_ptr<PartsReader> &reader,
+		int32 part,
+		QByteArray bytes);
+	[[nodiscard]] int chooseSession() const;
+	void updateSessionWindow(int dc, crl::time latency, int32 partSize);
+	void updateSpeed(int32 sentPartSize);
+
+	void resumeUpload(File &file);
+	void rememberUpload(const File &file);
+	void forgetUpload(const File &file);
+	void saveResumableUploadsDelayed();
+	void saveResumableUploads();
+
 	void currentFailed();
 
 	not_null<ApiWrap*> _api;
 	base::flat_map<mtpRequestId, QByteArray> requestsSent;
 	base::flat_map<mtpRequestId, int32> docRequestsSent;
 	base::flat_map<mtpRequestId, int32> dcMap;
+	base::flat_map<mtpRequestId, crl::time> _sentAt;
 	uint32 sentSize = 0;
-	uint32 sentSizes[MTP::kUploadSessionsCount] = { 0 };
+	uint32 sentSizes[MTP::kMaxUploadSessionsCount] = { 0 };
+
+	// How many bytes may be in flight in each session, adjusted
+	// by the measured latency of the part acknowledgements.
+	uint32 _sessionWindows[MTP::kMaxUploadSessionsCount] = { 0 };
+
+	// One more session is used while all windows are full and the
+	// acknowledgements are still fast, back to the default when idle.
+	int _sessionsCount = MTP::kUploadSessionsCount;
+
+	int64 _speedBytes = 0;
+	crl::time _speedFrom = 0;
+	int64 _uploadSpeed = 0;
+
+	std::map<uint64, Preupload> _preuploads;
+	base::flat_map<mtpRequestId, std::pair<uint64, int32>> _preuploadRequests;
+
+	std::vector<ResumableUpload> _resumableUploads;
+	bool _resumableUploadsRead = false;
+	base::Timer _saveResumableUploadsTimer;
 
 	FullMsgId uploadingId;
 	FullMsgId _pausedId;
@@ -140,6 +205,8 @@ private:
 	rpl::event_stream<FullMsgId> _documentFailed;
 	rpl::event_stream<FullMsgId> _secureFailed;
 
+	rpl::lifetime _lifetime;
+
 };
 
 } // namespace Storage
@@ -36,6 +36,12 @@ constexpr auto kThumbnailQuality = 87;
 constexpr auto kThumbnailSize = 320;
 constexpr auto kPhotoUploadPartSize = 32 * 1024;
 
+// The biggest photo size we send, images are decoded only that big.
+constexpr auto kPhotoFullSize = 1280;
+
+// Files are prepared in parallel by up to that many threads.
+constexpr auto kMaxTaskQueueWorkers = 4;
+
 using Storage::ValidateThumbDimensions;
 
 struct PreparedFileThumbnail {
@@ -46,6 +52,12 @@ struct PreparedFileThumbnail {
 	MTPPhotoSize mtpSize = MTP_photoSizeEmpty(MTP_string());
 };
 
+QImage ScaledToFit(const QImage &image, int size) {
+	return (image.width() > size || image.height() > size)
+		? image.scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation)
+		: image;
+}
+
 PreparedFileThumbnail PrepareFileThumbnail(QImage &&original) {
 	const auto width = original.width();
 	const auto height = original.height();
@@ -191,7 +203,7 @@ SendMediaReady PreparePeerPhoto(PeerId peerId, QImage &&image) {
 	QBuffer jpegBuffer(&jpeg);
 	image.save(&jpegBuffer, "JPG", 87);
 
-	const auto scaled = [&](int size) {
+	const auto scaled = [&](const QImage &image, int size) {
 		return image.scaled(
 			size,
 			size,
@@ -206,8 +218,9 @@ SendMediaReady PreparePeerPhoto(PeerId peerId, QImage &&image) {
 			MTP_int(image.height()), MTP_int(0)));
 		photoThumbs.emplace(type[0], std::move(image));
 	};
-	push("a", scaled(160));
-	push("b", scaled(320));
+	auto medium = scaled(image, 320);
+	push("a", scaled(medium, 160));
+	push("b", std::move(medium));
 	push("c", std::move(image));
 
 	const auto id = rand_value<PhotoId>();
@@ -242,6 +255,10 @@ SendMediaReady PreparePeerPhoto(PeerId peerId, QImage &&image) {
 }
 
 TaskQueue::TaskQueue(crl::time stopTimeoutMs) {
+	_workers.resize(std::clamp(
+		QThread::idealThreadCount() - 1,
+		1,
+		kMaxTaskQueueWorkers));
 	if (stopTimeoutMs > 0) {
 		_stopTimer = new QTimer(this);
 		connect(_stopTimer, SIGNAL(timeout()), this, SLOT(stop()));
@@ -252,12 +269,13 @@ TaskQueue::TaskQueue(crl::time stopTimeoutMs) {
 
 TaskId TaskQueue::addTask(std::unique_ptr<Task> &&task) {
 	const auto result = task->id();
+	_finishOrder.push_back(result);
 	{
 		QMutexLocker lock(&_tasksToProcessMutex);
 		_tasksToProcess.push_back(std::move(task));
 	}
 
-	wakeThread();
+	wakeThreads();
 
 	return result;
 }
@@ -266,24 +284,28 @@ void TaskQueue::addTasks(std::vector<std::unique_ptr<Task>> &&tasks) {
 	{
 		QMutexLocker lock(&_tasksToProcessMutex);
 		for (auto &task : tasks) {
+			_finishOrder.push_back(task->id());
 			_tasksToProcess.push_back(std::move(task));
 		}
 	}
 
-	wakeThread();
+	wakeThreads();
 }
 
-void TaskQueue::wakeThread() {
-	if (!_thread) {
-		_thread = new QThread();
+void TaskQueue::wakeThreads() {
+	for (auto &[thread, worker] : _workers) {
+		if (thread) {
+			continue;
+		}
+		thread = new QThread();
 
-		_worker = new TaskQueueWorker(this);
-		_worker->moveToThread(_thread);
+		worker = new TaskQueueWorker(this);
+		worker->moveToThread(thread);
 
-		connect(this, SIGNAL(taskAdded()), _worker, SLOT(onTaskAdded()));
-		connect(_worker, SIGNAL(taskProcessed()), this, SLOT(onTaskProcessed()));
+		connect(this, SIGNAL(taskAdded()), worker, SLOT(onTaskAdded()));
+		connect(worker, SIGNAL(taskProcessed()), this, SLOT(onTaskProcessed()));
 
-		_thread->start();
+		thread->start();
 	}
 	if (_stopTimer) _stopTimer->stop();
 	emit taskAdded();
@@ -299,49 +321,70 @@ void TaskQueue::cancelTask(TaskId id) {
 			queue.erase(i);
 		}
 	};
+	_finishOrder.erase(
+		ranges::remove(_finishOrder, id),
+		end(_finishOrder));
 	{
 		QMutexLocker lock(&_tasksToProcessMutex);
 		removeFrom(_tasksToProcess);
-		if (_taskInProcessId == id) {
-			_taskInProcessId = TaskId();
-		}
+		_tasksInProcess.erase(
+			ranges::remove(_tasksInProcess, id),
+			end(_tasksInProcess));
 	}
 	QMutexLocker lock(&_tasksToFinishMutex);
 	removeFrom(_tasksToFinish);
 }
 
 void TaskQueue::onTaskProcessed() {
-	do {
+	const auto proj = [](const std::unique_ptr<Task> &task) {
+		return task->id();
+	};
+	while (!_finishOrder.empty()) {
 		auto task = std::unique_ptr<Task>();
 		{
 			QMutexLocker lock(&_tasksToFinishMutex);
-			if (_tasksToFinish.empty()) break;
-			task = std::move(_tasksToFinish.front());
-			_tasksToFinish.pop_front();
+			const auto i = ranges::find(
+				_tasksToFinish,
+				_finishOrder.front(),
+				proj);
+			if (i == end(_tasksToFinish)) {
+				// Wait for the earlier tasks to keep the results order.
+				break;
+			}
+			task = std::move(*i);
+			_tasksToFinish.erase(i);
 		}
+		_finishOrder.pop_front();
 		task->finish();
-	} while (true);
+	}
 
 	if (_stopTimer) {
 		QMutexLocker lock(&_tasksToProcessMutex);
-		if (_tasksToProcess.empty() && !_taskInProcessId) {
+		if (_tasksToProcess.empty() && _tasksInProcess.empty()) {
 			_stopTimer->start();
 		}
 	}
 }
 
 void TaskQueue::stop() {
-	if (_thread) {
-		_thread->requestInterruption();
-		_thread->quit();
-		DEBUG_LOG(("Waiting for taskThread to finish"));
-		_thread->wait();
-		delete base::take(_worker);
-		delete base::take(_thread);
+	for (const auto &[thread, worker] : _workers) {
+		if (thread) {
+			thread->requestInterruption();
+			thread->quit();
+		}
+	}
+	for (auto &[thread, worker] : _workers) {
+		if (thread) {
+			DEBUG_LOG(("Waiting for taskThread to finish"));
+			thread->wait();
+			delete base::take(worker);
+			delete base::take(thread);
+		}
 	}
 	_tasksToProcess.clear();
 	_tasksToFinish.clear();
-	_taskInProcessId = TaskId();
+	_tasksInProcess.clear();
+	_finishOrder.clear();
 }
 
 TaskQueue::~TaskQueue() {
@@ -361,7 +404,7 @@ void TaskQueueWorker::onTaskAdded() {
 			if (!_queue->_tasksToProcess.empty()) {
 				task = std::move(_queue->_tasksToProcess.front());
 				_queue->_tasksToProcess.pop_front();
-				_queue->_taskInProcessId = task->id();
+				_queue->_tasksInProcess.push_back(task->id());
 			}
 		}
 
@@ -370,12 +413,16 @@ void TaskQueueWorker::onTaskAdded() {
 			bool emitTaskProcessed = false;
 			{
 				QMutexLocker lockToProcess(&_queue->_tasksToProcessMutex);
-				if (_queue->_taskInProcessId == task->id()) {
-					_queue->_taskInProcessId = TaskId();
+				auto &inProcess = _queue->_tasksInProcess;
+				const auto i = ranges::find(inProcess, task->id());
+				if (i != end(inProcess)) {
+					inProcess.erase(i);
 					someTasksLeft = !_queue->_tasksToProcess.empty();
 
+					// Finished tasks may wait for the earlier ones,
+					// so the main thread is notified about each of them.
 					QMutexLocker lockToFinish(&_queue->_tasksToFinishMutex);
-					emitTaskProcessed = _queue->_tasksToFinish.empty();
+					emitTaskProcessed = true;
 					_queue->_tasksToFinish.push_back(std::move(task));
 				}
 			}
@@ -498,8 +545,9 @@ FileLoadTask::FileLoadTask(
 	int32 duration,
 	const VoiceWaveform &waveform,
 	const FileLoadTo &to,
-	const TextWithTags &caption)
-: _id(rand_value<uint64>())
+	const TextWithTags &caption,
+	uint64 preuploadId)
+: _id(preuploadId ? preuploadId : rand_value<uint64>())
 , _to(to)
 , _content(voice)
 , _duration(duration)
@@ -619,6 +667,7 @@ bool FileLoadTask::CheckForImage(
 		const QByteArray &content,
 		std::unique_ptr<FileMediaInformation> &result) {
 	auto animated = false;
+	auto original = QSize();
 	auto image = [&] {
 		if (filepath.endsWith(qstr(".tgs"), Qt::CaseInsensitive)) {
 			auto image = Lottie::ReadThumbnail(
@@ -630,13 +679,29 @@ bool FileLoadTask::CheckForImage(
 			return image;
 		}
 		if (!content.isEmpty()) {
-			return App::readImage(content, nullptr, false, &animated);
+			return App::readImageForSize(
+				content,
+				kPhotoFullSize,
+				&original,
+				false,
+				&animated);
 		} else if (!filepath.isEmpty()) {
-			return App::readImage(filepath, nullptr, false, &animated);
+			return App::readImageForSize(
+				filepath,
+				kPhotoFullSize,
+				&original,
+				false,
+				&animated);
 		}
 		return QImage();
 	}();
-	return FillImageInformation(std::move(image), animated, result);
+	if (!FillImageInformation(std::move(image), animated, result)) {
+		return false;
+	} else if (const auto filled = base::get_if<FileMediaInformation::Image>(
+			&result->media)) {
+		filled->original = original;
+	}
+	return true;
 }
 
 bool FileLoadTask::FillImageInformation(
@@ -679,6 +744,7 @@ void FileLoadTask::process() {
 	auto isSticker = false;
 
 	auto fullimage = QImage();
+	auto fullsize = QSize();
 	auto info = _filepath.isEmpty() ? QFileInfo() : QFileInfo(_filepath);
 	if (info.exists()) {
 		if (info.isDir()) {
@@ -700,6 +766,7 @@ void FileLoadTask::process() {
 		if (auto image = base::get_if<FileMediaInformation::Image>(
 				&_information->media)) {
 			fullimage = base::take(image->data);
+			fullsize = image->original;
 			if (filemime != stickerMime && filemime != animatedStickerMime) {
 				fullimage = Images::prepareOpaque(std::move(fullimage));
 			}
@@ -715,6 +782,7 @@ void FileLoadTask::process() {
 				if (auto image = base::get_if<FileMediaInformation::Image>(
 						&_information->media)) {
 					fullimage = base::take(image->data);
+					fullsize = image->original;
 				}
 			}
 			const auto mimeType = Core::MimeTypeForData(_content);
@@ -740,6 +808,7 @@ void FileLoadTask::process() {
 			if (auto image = base::get_if<FileMediaInformation::Image>(
 					&_information->media)) {
 				fullimage = base::take(image->data);
+				fullsize = image->original;
 			}
 		}
 		if (!fullimage.isNull() && fullimage.width() > 0) {
@@ -828,7 +897,10 @@ void FileLoadTask::process() {
 
 	if (!fullimage.isNull() && fullimage.width() > 0 && !isSong && !isVideo && !isVoice) {
 		auto w = fullimage.width(), h = fullimage.height();
-		attributes.push_back(MTP_documentAttributeImageSize(MTP_int(w), MTP_int(h)));
+		if (fullsize.isEmpty()) {
+			fullsize = fullimage.size();
+		}
+		attributes.push_back(MTP_documentAttributeImageSize(MTP_int(fullsize.width()), MTP_int(fullsize.height())));
 
 		if (ValidateThumbDimensions(w, h)) {
 			isSticker = (filemime == stickerMime
@@ -854,15 +926,18 @@ void FileLoadTask::process() {
 			} else if (isAnimation) {
 				attributes.push_back(MTP_documentAttributeAnimated());
 			} else if (_type != SendMediaType::File) {
-				auto thumb = (w > 100 || h > 100) ? fullimage.scaled(100, 100, Qt::KeepAspectRatio, Qt::SmoothTransformation) : fullimage;
+				// Scale the big camera photo only once, smaller sizes
+				// are made from the previous ones.
+				auto full = ScaledToFit(fullimage, kPhotoFullSize);
+				auto medium = ScaledToFit(full, 320);
+				auto thumb = ScaledToFit(medium, 100);
+
 				photoThumbs.emplace('s', thumb);
 				photoSizes.push_back(MTP_photoSize(MTP_string("s"), MTP_fileLocationToBeDeprecated(MTP_long(0), MTP_int(0)), MTP_int(thumb.width()), MTP_int(thumb.height()), MTP_int(0)));
 
-				auto medium = (w > 320 || h > 320) ? fullimage.scaled(320, 320, Qt::KeepAspectRatio, Qt::SmoothTransformation) : fullimage;
 				photoThumbs.emplace('m', medium);
 				photoSizes.push_back(MTP_photoSize(MTP_string("m"), MTP_fileLocationToBeDeprecated(MTP_long(0), MTP_int(0)), MTP_int(medium.width()), MTP_int(medium.height()), MTP_int(0)));
 
-				auto full = (w > 1280 || h > 1280) ? fullimage.scaled(1280, 1280, Qt::KeepAspectRatio, Qt::SmoothTransformation) : fullimage;
 				photoThumbs.emplace('y', full);
 				photoSizes.push_back(MTP_photoSize(MTP_string("y"), MTP_fileLocationToBeDeprecated(MTP_long(0), MTP_int(0)), MTP_int(full.width()), MTP_int(full.height()), MTP_int(0)));
 
@@ -883,6 +958,9 @@ void FileLoadTask::process() {
 				if (filesize < 0) {
 					filesize = _result->filesize = filedata.size();
 				}
+
+				// The document thumbnail fits in the 'y' size as well.
+				fullimage = full;
 			}
 			thumbnail = PrepareFileThumbnail(std::move(fullimage));
 		}
@@ -100,6 +100,9 @@ public:
 
 };
 
+// Tasks are processed by a small pool of worker threads, each of them
+// takes the next task from the shared queue when it becomes free.
+// finish() is still called on the main thread in the order of addTask().
 class TaskQueueWorker;
 class TaskQueue : public QObject {
 	Q_OBJECT
@@ -123,14 +126,22 @@ public slots:
 private:
 	friend class TaskQueueWorker;
 
-	void wakeThread();
+	struct Worker {
+		QThread *thread = nullptr;
+		TaskQueueWorker *worker = nullptr;
+	};
+
+	void wakeThreads();
 
 	std::deque<std::unique_ptr<Task>> _tasksToProcess;
-	std::deque<std::unique_ptr<Task>> _tasksToFinish;
-	TaskId _taskInProcessId = TaskId();
+	std::vector<std::unique_ptr<Task>> _tasksToFinish;
+	std::vector<TaskId> _tasksInProcess;
 	QMutex _tasksToProcessMutex, _tasksToFinishMutex;
-	QThread *_thread = nullptr;
-	TaskQueueWorker *_worker = nullptr;
+
+	// Accessed only from the main thread.
+	std::deque<TaskId> _finishOrder;
+
+	std::vector<Worker> _workers;
 	QTimer *_stopTimer = nullptr;
 
 };
@@ -239,6 +250,7 @@ struct FileLoadResult {
 struct FileMediaInformation {
 	struct Image {
 		QImage data;
+		QSize original; // Before the reduced size decoding, if any.
 		bool animated = false;
 	};
 	struct Song {
@@ -283,7 +295,8 @@ public:
 		int32 duration,
 		const VoiceWaveform &waveform,
 		const FileLoadTo &to,
-		const TextWithTags &caption);
+		const TextWithTags &caption,
+		uint64 preuploadId = 0);
 
 	uint64 fileid() const {
 		return _id;
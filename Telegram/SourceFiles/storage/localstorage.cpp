@@ -18,8 +18,10 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "ui/widgets/input_fields.h"
 #include "ui/emoji_config.h"
 #include "export/export_settings.h"
+#include "storage/file_upload.h"
 #include "api/api_hash.h"
 #include "core/crash_reports.h"
+#include "core/core_startup_timeline.h"
 #include "core/update_checker.h"
 #include "observer_peer.h"
 #include "mainwidget.h"
@@ -35,6 +37,9 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "window/themes/window_theme.h"
 #include "window/window_session_controller.h"
 #include "base/flags.h"
+#include "base/flat_map.h"
+#include "base/timer.h"
+#include "base/crc32hash.h"
 #include "data/data_session.h"
 #include "history/history.h"
 #include "facades.h"
@@ -55,6 +60,7 @@ constexpr auto kFileLoaderQueueStopTimeout = crl::time(5000);
 constexpr auto kDefaultStickerInstallDate = TimeId(1);
 constexpr auto kProxyTypeShift = 1024;
 constexpr auto kWriteMapTimeout = crl::time(1000);
+constexpr auto kWriteFilesTimeout = crl::time(500);
 constexpr auto kSavedBackgroundFormat = QImage::Format_ARGB32_Premultiplied;
 
 constexpr auto kWallPaperLegacySerializeTagId = int32(-111);
@@ -68,8 +74,13 @@ constexpr auto kSinglePeerTypeSelf = qint32(4);
 constexpr auto kSinglePeerTypeEmpty = qint32(0);
 
 constexpr auto kStickersVersionTag = quint32(-1);
-constexpr auto kStickersSerializeVersion = 1;
+constexpr auto kStickersBlobSerializeVersion = 1;
+constexpr auto kStickersSerializeVersion = 2;
 constexpr auto kMaxSavedStickerSetsCount = 1000;
+constexpr auto kCacheMaxPackedDataSize = 128 * 1024;
+constexpr auto kCacheHotSizeLimit = 16 * 1024 * 1024;
+constexpr auto kCacheCompactBytesPerSecond = 4 * 1024 * 1024;
+constexpr auto kCacheSnapshotAfterLength = 4 * 1024 * 1024;
 
 const auto kThemeNewPathRelativeTag = qstr("special://new_tag");
 
@@ -96,6 +107,9 @@ bool _started = false;
 internal::Manager *_manager = nullptr;
 TaskQueue *_localLoader = nullptr;
 
+// Waveforms requested while painting are sent to the workers together.
+std::vector<std::unique_ptr<Task>> _waveformTasks;
+
 bool _working() {
 	return _manager && !_basePath.isEmpty();
 }
@@ -111,7 +125,50 @@ enum class FileOption {
 using FileOptions = base::flags<FileOption>;
 inline constexpr auto is_flag_type(FileOption) { return true; };
 
+// Encrypts and writes files on a background queue.
+//
+// A file scheduled for writing again before the timeout is written once,
+// with the latest contents. Paths here don't have the '0' / '1' suffix.
+class AsyncWriter {
+public:
+	struct Part {
+		QByteArray data;
+		MTP::AuthKeyPtr key; // Written as is if nullptr.
+	};
+	struct Task {
+		QString path;
+		bool safe = false;
+		std::vector<Part> parts;
+	};
+
+	AsyncWriter();
+	~AsyncWriter();
+
+	void schedule(Task &&task);
+	bool pending(const QString &path) const;
+
+	// Both wait until the file is not being written in the background.
+	void flush(const QString &path);
+	void cancel(const QString &path);
+
+	void flushAll();
+
+private:
+	static void Perform(Task &&task);
+	void process();
+
+	mutable QMutex _mutex;
+	QMutex _writeMutex;
+	base::flat_map<QString, Task> _pending;
+	base::Timer _timer;
+	crl::queue _queue;
+
+};
+
+std::unique_ptr<AsyncWriter> _writer;
+
 bool keyAlreadyUsed(QString &name, FileOptions options = FileOption::User | FileOption::Safe) {
+	if (_writer && _writer->pending(name)) return true;
 	name += '0';
 	if (QFileInfo(name).exists()) return true;
 	if (options & (FileOption::Safe)) {
@@ -150,7 +207,9 @@ void clearKey(const FileKey &key, FileOptions options = FileOption::User | FileO
 
 	QString base = (options & FileOption::User) ? _userBasePath : _basePath, name;
 	name.reserve(base.size() + 0x11);
-	name.append(base).append(toFilePart(key)).append('0');
+	name.append(base).append(toFilePart(key));
+	_writer->cancel(name);
+	name.append('0');
 	QFile::remove(name);
 	if (options & FileOption::Safe) {
 		name[name.size() - 1] = '1';
@@ -234,55 +293,147 @@ struct EncryptedDescriptor {
 	}
 };
 
-struct FileWriteDescriptor {
-	FileWriteDescriptor(const FileKey &key, FileOptions options = FileOption::User | FileOption::Safe) {
-		init(toFilePart(key), options);
+QByteArray EncryptLocalData(QByteArray toEncrypt, const MTP::AuthKeyPtr &key) {
+	// prepare for encryption
+	uint32 size = toEncrypt.size(), fullSize = size;
+	if (fullSize & 0x0F) {
+		fullSize += 0x10 - (fullSize & 0x0F);
+		toEncrypt.resize(fullSize);
+		memset_rand(toEncrypt.data() + size, fullSize - size);
 	}
-	FileWriteDescriptor(const QString &name, FileOptions options = FileOption::User | FileOption::Safe) {
-		init(name, options);
+	*(uint32*)toEncrypt.data() = size;
+	QByteArray encrypted(0x10 + fullSize, Qt::Uninitialized); // 128bit of sha1 - key128, sizeof(data), data
+	hashSha1(toEncrypt.constData(), toEncrypt.size(), encrypted.data());
+	MTP::aesEncryptLocal(toEncrypt.constData(), encrypted.data() + 0x10, fullSize, key, encrypted.constData());
+
+	return encrypted;
+}
+
+AsyncWriter::AsyncWriter() : _timer([=] {
+	_queue.async([=] { process(); });
+}) {
+}
+
+AsyncWriter::~AsyncWriter() {
+	_timer.cancel();
+	flushAll();
+
+	// Wait for the process() calls already posted to the queue.
+	crl::semaphore semaphore;
+	_queue.async([&] { semaphore.release(); });
+	semaphore.acquire();
+}
+
+void AsyncWriter::schedule(Task &&task) {
+	{
+		QMutexLocker lock(&_mutex);
+		auto path = task.path;
+		_pending[std::move(path)] = std::move(task);
 	}
-	void init(const QString &name, FileOptions options) {
-		if (options & FileOption::User) {
-			if (!_userWorking()) return;
-		} else {
-			if (!_working()) return;
+	if (!_timer.isActive()) {
+		_timer.callOnce(kWriteFilesTimeout);
+	}
+}
+
+bool AsyncWriter::pending(const QString &path) const {
+	QMutexLocker lock(&_mutex);
+	return _pending.contains(path);
+}
+
+void AsyncWriter::flush(const QString &path) {
+	QMutexLocker write(&_writeMutex);
+	auto task = [&] {
+		QMutexLocker lock(&_mutex);
+		const auto i = _pending.find(path);
+		if (i == end(_pending)) {
+			return std::optional<Task>();
 		}
+		auto result = std::make_optional(std::move(i->second));
+		_pending.erase(i);
+		return result;
+	}();
+	if (task) {
+		Perform(std::move(*task));
+	}
+}
 
-		// detect order of read attempts and file version
-		QString toTry[2];
-		toTry[0] = ((options & FileOption::User) ? _userBasePath : _basePath) + name + '0';
-		if (options & FileOption::Safe) {
-			toTry[1] = ((options & FileOption::User) ? _userBasePath : _basePath) + name + '1';
-			QFileInfo toTry0(toTry[0]);
-			QFileInfo toTry1(toTry[1]);
-			if (toTry0.exists()) {
-				if (toTry1.exists()) {
-					QDateTime mod0 = toTry0.lastModified(), mod1 = toTry1.lastModified();
-					if (mod0 > mod1) {
-						qSwap(toTry[0], toTry[1]);
-					}
-				} else {
+void AsyncWriter::cancel(const QString &path) {
+	QMutexLocker write(&_writeMutex);
+	QMutexLocker lock(&_mutex);
+	_pending.remove(path);
+}
+
+void AsyncWriter::flushAll() {
+	QMutexLocker write(&_writeMutex);
+	auto tasks = [&] {
+		QMutexLocker lock(&_mutex);
+		return base::take(_pending);
+	}();
+	for (auto &[path, task] : tasks) {
+		Perform(std::move(task));
+	}
+}
+
+void AsyncWriter::process() {
+	while (true) {
+		QMutexLocker write(&_writeMutex);
+		auto task = [&] {
+			QMutexLocker lock(&_mutex);
+			if (_pending.empty()) {
+				return std::optional<Task>();
+			}
+			const auto i = begin(_pending);
+			auto result = std::make_optional(std::move(i->second));
+			_pending.erase(i);
+			return result;
+		}();
+		if (!task) {
+			return;
+		}
+		Perform(std::move(*task));
+	}
+}
+
+void AsyncWriter::Perform(Task &&task) {
+	// detect order of read attempts and file version
+	QString toTry[2], toDelete;
+	toTry[0] = task.path + '0';
+	if (task.safe) {
+		toTry[1] = task.path + '1';
+		QFileInfo toTry0(toTry[0]);
+		QFileInfo toTry1(toTry[1]);
+		if (toTry0.exists()) {
+			if (toTry1.exists()) {
+				QDateTime mod0 = toTry0.lastModified(), mod1 = toTry1.lastModified();
+				if (mod0 > mod1) {
 					qSwap(toTry[0], toTry[1]);
 				}
-				toDelete = toTry[1];
-			} else if (toTry1.exists()) {
-				toDelete = toTry[1];
+			} else {
+				qSwap(toTry[0], toTry[1]);
 			}
+			toDelete = toTry[1];
+		} else if (toTry1.exists()) {
+			toDelete = toTry[1];
 		}
+	}
 
-		file.setFileName(toTry[0]);
-		if (file.open(QIODevice::WriteOnly)) {
-			file.write(tdfMagic, tdfMagicLen);
-			qint32 version = AppVersion;
-			file.write((const char*)&version, sizeof(version));
-
-			stream.setDevice(&file);
-			stream.setVersion(QDataStream::Qt_5_1);
-		}
+	QFile file(toTry[0]);
+	if (!file.open(QIODevice::WriteOnly)) {
+		return;
 	}
-	bool writeData(const QByteArray &data) {
-		if (!file.isOpen()) return false;
+	file.write(tdfMagic, tdfMagicLen);
+	qint32 version = AppVersion;
+	file.write((const char*)&version, sizeof(version));
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_5_1);
 
+	HashMd5 md5;
+	int32 dataSize = 0;
+	for (auto &part : task.parts) {
+		const auto data = part.key
+			? EncryptLocalData(std::move(part.data), part.key)
+			: std::move(part.data);
 		stream << data;
 		quint32 len = data.isNull() ? 0xffffffff : data.size();
 		if (QSysInfo::ByteOrder != QSysInfo::BigEndian) {
@@ -291,53 +442,63 @@ struct FileWriteDescriptor {
 		md5.feed(&len, sizeof(len));
 		md5.feed(data.constData(), data.size());
 		dataSize += sizeof(len) + data.size();
+	}
+	stream.setDevice(nullptr);
 
-		return true;
+	md5.feed(&dataSize, sizeof(dataSize));
+	md5.feed(&version, sizeof(version));
+	md5.feed(tdfMagic, tdfMagicLen);
+	file.write((const char*)md5.result(), 0x10);
+	file.close();
+
+	if (!toDelete.isEmpty()) {
+		QFile::remove(toDelete);
 	}
-	static QByteArray prepareEncrypted(EncryptedDescriptor &data, const MTP::AuthKeyPtr &key = LocalKey) {
-		data.finish();
-		QByteArray &toEncrypt(data.data);
+}
 
-		// prepare for encryption
-		uint32 size = toEncrypt.size(), fullSize = size;
-		if (fullSize & 0x0F) {
-			fullSize += 0x10 - (fullSize & 0x0F);
-			toEncrypt.resize(fullSize);
-			memset_rand(toEncrypt.data() + size, fullSize - size);
+struct FileWriteDescriptor {
+	FileWriteDescriptor(const FileKey &key, FileOptions options = FileOption::User | FileOption::Safe) {
+		init(toFilePart(key), options);
+	}
+	FileWriteDescriptor(const QString &name, FileOptions options = FileOption::User | FileOption::Safe) {
+		init(name, options);
+	}
+	void init(const QString &name, FileOptions options) {
+		if (options & FileOption::User) {
+			if (!_userWorking()) return;
+		} else {
+			if (!_working()) return;
 		}
-		*(uint32*)toEncrypt.data() = size;
-		QByteArray encrypted(0x10 + fullSize, Qt::Uninitialized); // 128bit of sha1 - key128, sizeof(data), data
-		hashSha1(toEncrypt.constData(), toEncrypt.size(), encrypted.data());
-		MTP::aesEncryptLocal(toEncrypt.constData(), encrypted.data() + 0x10, fullSize, key, encrypted.constData());
+		path = ((options & FileOption::User) ? _userBasePath : _basePath) + name;
+		safe = (options & FileOption::Safe);
+	}
+	bool writeData(const QByteArray &data) {
+		if (path.isEmpty()) return false;
 
-		return encrypted;
+		parts.push_back({ data, nullptr });
+		return true;
+	}
+	static QByteArray prepareEncrypted(EncryptedDescriptor &data, const MTP::AuthKeyPtr &key = LocalKey) {
+		data.finish();
+		return EncryptLocalData(data.data, key);
 	}
 	bool writeEncrypted(EncryptedDescriptor &data, const MTP::AuthKeyPtr &key = LocalKey) {
-		return writeData(prepareEncrypted(data, key));
+		if (path.isEmpty()) return false;
+
+		// Encryption is done by the writer in the background.
+		data.finish();
+		parts.push_back({ base::take(data.data), key });
+		return true;
 	}
 	void finish() {
-		if (!file.isOpen()) return;
-
-		stream.setDevice(nullptr);
+		if (path.isEmpty()) return;
 
-		md5.feed(&dataSize, sizeof(dataSize));
-		qint32 version = AppVersion;
-		md5.feed(&version, sizeof(version));
-		md5.feed(tdfMagic, tdfMagicLen);
-		file.write((const char*)md5.result(), 0x10);
-		file.close();
-
-		if (!toDelete.isEmpty()) {
-			QFile::remove(toDelete);
-		}
+		Expects(_writer != nullptr);
+		_writer->schedule({ base::take(path), safe, base::take(parts) });
 	}
-	QFile file;
-	QDataStream stream;
-
-	QString toDelete;
-
-	HashMd5 md5;
-	int32 dataSize = 0;
+	QString path;
+	bool safe = false;
+	std::vector<AsyncWriter::Part> parts;
 
 	~FileWriteDescriptor() {
 		finish();
@@ -353,7 +514,9 @@ bool readFile(FileReadDescriptor &result, const QString &name, FileOptions optio
 
 	// detect order of read attempts
 	QString toTry[2];
-	toTry[0] = ((options & FileOption::User) ? _userBasePath : _basePath) + name + '0';
+	toTry[0] = ((options & FileOption::User) ? _userBasePath : _basePath) + name;
+	_writer->flush(toTry[0]);
+	toTry[0] += '0';
 	if (options & FileOption::Safe) {
 		QFileInfo toTry0(toTry[0]);
 		if (toTry0.exists()) {
@@ -536,6 +699,9 @@ enum { // Local Storage Keys
 	lskExportSettings = 0x13, // no data
 	lskBackground = 0x14, // no data
 	lskSelfSerialized = 0x15, // serialized self
+	lskStickersHashes = 0x16, // no data
+	lskResumableUploads = 0x17, // no data
+	lskStickerSetRecords = 0x18, // data: uint64 setId, checksum, lists
 };
 
 enum {
@@ -647,6 +813,9 @@ DraftsMap _draftsMap, _draftCursorsMap;
 typedef QMap<PeerId, bool> DraftsNotReadMap;
 DraftsNotReadMap _draftsNotReadMap;
 
+// Checksums of the draft files written in this session.
+base::flat_map<PeerId, int32> _draftChecksums, _draftCursorChecksums;
+
 typedef QPair<FileKey, qint32> FileDesc; // file, size
 
 typedef QMultiMap<MediaKey, FileLocation> FileLocations;
@@ -666,6 +835,33 @@ FileKey _recentStickersKeyOld = 0;
 FileKey _installedStickersKey = 0, _featuredStickersKey = 0, _recentStickersKey = 0, _favedStickersKey = 0, _archivedStickersKey = 0;
 FileKey _savedGifsKey = 0;
 
+// Each sticker set is kept in its own file, so that a change in one set
+// doesn't rewrite all of them. The set lists keep only the set ids.
+constexpr auto kInstalledStickerSets = qint32(0x01);
+constexpr auto kFeaturedStickerSets = qint32(0x02);
+constexpr auto kRecentStickerSets = qint32(0x04);
+constexpr auto kFavedStickerSets = qint32(0x08);
+constexpr auto kArchivedStickerSets = qint32(0x10);
+struct StickerSetRecord {
+	FileKey key = 0;
+	qint32 checksum = 0;
+	qint32 lists = 0;
+};
+base::flat_map<uint64, StickerSetRecord> _stickerSetRecords;
+
+// Read at start, so that the cloud sync doesn't require all the sets.
+struct StickersHashes {
+	qint32 installed = 0;
+	qint32 installedOutdated = 0;
+	qint32 featured = 0;
+	qint32 featuredUnreadCount = 0;
+	qint32 recent = 0;
+	qint32 faved = 0;
+	qint32 savedGifs = 0;
+};
+FileKey _stickersHashesKey = 0;
+std::optional<StickersHashes> _stickersHashes;
+
 FileKey _backgroundKeyDay = 0;
 FileKey _backgroundKeyNight = 0;
 bool _backgroundCanWrite = true;
@@ -696,6 +892,7 @@ bool NoTimeLimit(qint32 storedLimitValue) {
 }
 
 FileKey _exportSettingsKey = 0;
+FileKey _resumableUploadsKey = 0;
 
 FileKey _langPackKey = 0;
 FileKey _languagesKey = 0;
@@ -2266,8 +2463,11 @@ ReadMapState _readMap(const QByteArray &pass) {
 	quint64 recentStickersKeyOld = 0;
 	quint64 installedStickersKey = 0, featuredStickersKey = 0, recentStickersKey = 0, favedStickersKey = 0, archivedStickersKey = 0;
 	quint64 savedGifsKey = 0;
+	quint64 stickersHashesKey = 0;
 	quint64 backgroundKeyDay = 0, backgroundKeyNight = 0;
 	quint64 userSettingsKey = 0, recentHashtagsAndBotsKey = 0, exportSettingsKey = 0;
+	quint64 resumableUploadsKey = 0;
+	auto stickerSetRecords = base::flat_map<uint64, StickerSetRecord>();
 	while (!map.stream.atEnd()) {
 		quint32 keyType;
 		map.stream >> keyType;
@@ -2352,6 +2552,9 @@ ReadMapState _readMap(const QByteArray &pass) {
 		case lskSavedGifs: {
 			map.stream >> savedGifsKey;
 		} break;
+		case lskStickersHashes: {
+			map.stream >> stickersHashesKey;
+		} break;
 		case lskSavedPeersOld: {
 			quint64 key;
 			map.stream >> key;
@@ -2359,6 +2562,23 @@ ReadMapState _readMap(const QByteArray &pass) {
 		case lskExportSettings: {
 			map.stream >> exportSettingsKey;
 		} break;
+		case lskResumableUploads: {
+			map.stream >> resumableUploadsKey;
+		} break;
+		case lskStickerSetRecords: {
+			quint32 count = 0;
+			map.stream >> count;
+			for (quint32 i = 0; i < count; ++i) {
+				auto record = StickerSetRecord();
+				quint64 setId = 0;
+				map.stream
+					>> record.key
+					>> setId
+					>> record.checksum
+					>> record.lists;
+				stickerSetRecords.emplace(setId, record);
+			}
+		} break;
 		default:
 		LOG(("App Error: unknown key type in encrypted map: %1").arg(keyType));
 		return ReadMapFailed;
@@ -2381,11 +2601,14 @@ ReadMapState _readMap(const QByteArray &pass) {
 	_favedStickersKey = favedStickersKey;
 	_archivedStickersKey = archivedStickersKey;
 	_savedGifsKey = savedGifsKey;
+	_stickersHashesKey = stickersHashesKey;
 	_backgroundKeyDay = backgroundKeyDay;
 	_backgroundKeyNight = backgroundKeyNight;
 	_userSettingsKey = userSettingsKey;
 	_recentHashtagsAndBotsKey = recentHashtagsAndBotsKey;
 	_exportSettingsKey = exportSettingsKey;
+	_resumableUploadsKey = resumableUploadsKey;
+	_stickerSetRecords = std::move(stickerSetRecords);
 	_oldMapVersion = mapData.version;
 	if (_oldMapVersion < AppVersion) {
 		_mapChanged = true;
@@ -2395,11 +2618,18 @@ ReadMapState _readMap(const QByteArray &pass) {
 	}
 
 	if (_locationsKey) {
+		const auto phase = Core::StartupPhase("readLocations");
 		_readLocations();
 	}
 
-	_readUserSettings();
-	_readMtpData();
+	{
+		const auto phase = Core::StartupPhase("readUserSettings");
+		_readUserSettings();
+	}
+	{
+		const auto phase = Core::StartupPhase("readMtpData");
+		_readMtpData();
+	}
 
 	DEBUG_LOG(("selfSerialized set: %1").arg(selfSerialized.size()));
 	Core::App().activeAccount().setSessionFromStorage(
@@ -2482,10 +2712,15 @@ void _writeMap(WriteMapWhen when) {
 	}
 	if (_favedStickersKey) mapSize += sizeof(quint32) + sizeof(quint64);
 	if (_savedGifsKey) mapSize += sizeof(quint32) + sizeof(quint64);
+	if (_stickersHashesKey) mapSize += sizeof(quint32) + sizeof(quint64);
 	if (_backgroundKeyDay || _backgroundKeyNight) mapSize += sizeof(quint32) + sizeof(quint64) + sizeof(quint64);
 	if (_userSettingsKey) mapSize += sizeof(quint32) + sizeof(quint64);
 	if (_recentHashtagsAndBotsKey) mapSize += sizeof(quint32) + sizeof(quint64);
 	if (_exportSettingsKey) mapSize += sizeof(quint32) + sizeof(quint64);
+	if (_resumableUploadsKey) mapSize += sizeof(quint32) + sizeof(quint64);
+	if (!_stickerSetRecords.empty()) {
+		mapSize += sizeof(quint32) * 2 + _stickerSetRecords.size() * (sizeof(quint64) * 2 + sizeof(qint32) * 2);
+	}
 
 	EncryptedDescriptor mapData(mapSize);
 	if (!self.isEmpty()) {
@@ -2522,6 +2757,9 @@ void _writeMap(WriteMapWhen when) {
 	if (_savedGifsKey) {
 		mapData.stream << quint32(lskSavedGifs) << quint64(_savedGifsKey);
 	}
+	if (_stickersHashesKey) {
+		mapData.stream << quint32(lskStickersHashes) << quint64(_stickersHashesKey);
+	}
 	if (_backgroundKeyDay || _backgroundKeyNight) {
 		mapData.stream
 			<< quint32(lskBackground)
@@ -2537,6 +2775,19 @@ void _writeMap(WriteMapWhen when) {
 	if (_exportSettingsKey) {
 		mapData.stream << quint32(lskExportSettings) << quint64(_exportSettingsKey);
 	}
+	if (_resumableUploadsKey) {
+		mapData.stream << quint32(lskResumableUploads) << quint64(_resumableUploadsKey);
+	}
+	if (!_stickerSetRecords.empty()) {
+		mapData.stream << quint32(lskStickerSetRecords) << quint32(_stickerSetRecords.size());
+		for (const auto &[setId, record] : _stickerSetRecords) {
+			mapData.stream
+				<< quint64(record.key)
+				<< quint64(setId)
+				<< qint32(record.checksum)
+				<< qint32(record.lists);
+		}
+	}
 	map.writeEncrypted(mapData);
 
 	_mapChanged = false;
@@ -2550,7 +2801,9 @@ void finish() {
 		_manager->finish();
 		_manager->deleteLater();
 		_manager = nullptr;
+		_writer = nullptr;
 		delete base::take(_localLoader);
+		_waveformTasks.clear();
 	}
 }
 
@@ -2561,6 +2814,7 @@ void start() {
 	Expects(!_manager);
 
 	_manager = new internal::Manager();
+	_writer = std::make_unique<AsyncWriter>();
 	_localLoader = new TaskQueue(kFileLoaderQueueStopTimeout);
 
 	_basePath = cWorkingDir() + qsl("tdata/");
@@ -2612,8 +2866,14 @@ void start() {
 	_oldSettingsVersion = settingsData.version;
 	_settingsSalt = salt;
 
-	InitialLoadTheme();
-	readLangPack();
+	{
+		const auto phase = Core::StartupPhase("theme load");
+		InitialLoadTheme();
+	}
+	{
+		const auto phase = Core::StartupPhase("lang pack load");
+		readLangPack();
+	}
 
 	applyReadContext(std::move(context));
 }
@@ -2787,10 +3047,15 @@ void reset() {
 	if (_localLoader) {
 		_localLoader->stop();
 	}
+	if (_writer) {
+		_writer->flushAll();
+	}
 
 	_passKeySalt.clear(); // reset passcode, local key
 	_draftsMap.clear();
 	_draftCursorsMap.clear();
+	_draftChecksums.clear();
+	_draftCursorChecksums.clear();
 	_fileLocations.clear();
 	_fileLocationPairs.clear();
 	_fileLocationAliases.clear();
@@ -2798,10 +3063,14 @@ void reset() {
 	_locationsKey = _trustedBotsKey = 0;
 	_recentStickersKeyOld = 0;
 	_installedStickersKey = _featuredStickersKey = _recentStickersKey = _favedStickersKey = _archivedStickersKey = 0;
+	_stickerSetRecords.clear();
 	_savedGifsKey = 0;
+	_stickersHashesKey = 0;
+	_stickersHashes = std::nullopt;
 	_backgroundKeyDay = _backgroundKeyNight = 0;
 	Window::Theme::Background()->reset();
 	_userSettingsKey = _recentHashtagsAndBotsKey = _exportSettingsKey = 0;
+	_resumableUploadsKey = 0;
 	_oldMapVersion = _oldSettingsVersion = 0;
 	_cacheTotalSizeLimit = Database::Settings().totalSizeLimit;
 	_cacheTotalTimeLimit = Database::Settings().totalTimeLimit;
@@ -2845,10 +3114,12 @@ base::flat_set<QString> CollectGoodNames() {
 		_archivedStickersKey,
 		_recentStickersKeyOld,
 		_savedGifsKey,
+		_stickersHashesKey,
 		_backgroundKeyNight,
 		_backgroundKeyDay,
 		_recentHashtagsAndBotsKey,
 		_exportSettingsKey,
+		_resumableUploadsKey,
 		_trustedBotsKey
 	};
 	auto result = base::flat_set<QString>{ "map0", "map1" };
@@ -2870,6 +3141,9 @@ base::flat_set<QString> CollectGoodNames() {
 	for (const auto &value : keys) {
 		push(value);
 	}
+	for (const auto &[setId, record] : _stickerSetRecords) {
+		push(record.key);
+	}
 	return result;
 }
 
@@ -2880,6 +3154,7 @@ void FilterLegacyFiles(FnMut<void(base::flat_set<QString>&&)> then) {
 }
 
 ReadMapState readMap(const QByteArray &pass) {
+	const auto phase = Core::StartupPhase("readMap");
 	ReadMapState result = _readMap(pass);
 	if (result == ReadMapFailed) {
 		_mapChanged = true;
@@ -2899,6 +3174,20 @@ int32 oldSettingsVersion() {
 	return _oldSettingsVersion;
 }
 
+// Drafts are saved each second while typing, often without changes.
+bool _draftFileChanged(
+		base::flat_map<PeerId, int32> &checksums,
+		const PeerId &peer,
+		const EncryptedDescriptor &data) {
+	const auto checksum = base::crc32(data.data.constData(), data.data.size());
+	const auto i = checksums.find(peer);
+	if (i != end(checksums) && i->second == checksum) {
+		return false;
+	}
+	checksums[peer] = checksum;
+	return true;
+}
+
 void writeDrafts(const PeerId &peer, const MessageDraft &localDraft, const MessageDraft &editDraft) {
 	if (!_working()) return;
 
@@ -2910,6 +3199,7 @@ void writeDrafts(const PeerId &peer, const MessageDraft &localDraft, const Messa
 			_mapChanged = true;
 			_writeMap();
 		}
+		_draftChecksums.remove(peer);
 
 		_draftsNotReadMap.remove(peer);
 	} else {
@@ -2936,14 +3226,17 @@ void writeDrafts(const PeerId &peer, const MessageDraft &localDraft, const Messa
 		data.stream << editDraft.textWithTags.text << editTags;
 		data.stream << qint32(editDraft.msgId) << qint32(editDraft.previewCancelled ? 1 : 0);
 
-		FileWriteDescriptor file(i.value());
-		file.writeEncrypted(data);
+		if (_draftFileChanged(_draftChecksums, peer, data)) {
+			FileWriteDescriptor file(i.value());
+			file.writeEncrypted(data);
+		}
 
 		_draftsNotReadMap.remove(peer);
 	}
 }
 
 void clearDraftCursors(const PeerId &peer) {
+	_draftCursorChecksums.remove(peer);
 	DraftsMap::iterator i = _draftCursorsMap.find(peer);
 	if (i != _draftCursorsMap.cend()) {
 		clearKey(i.value());
@@ -2997,6 +3290,7 @@ void readDraftsWithCursors(History *h) {
 	if (!readEncryptedFile(draft, j.value())) {
 		clearKey(j.value());
 		_draftsMap.erase(j);
+		_draftChecksums.remove(peer);
 		clearDraftCursors(peer);
 		return;
 	}
@@ -3025,6 +3319,7 @@ void readDraftsWithCursors(History *h) {
 	if (draftPeer != peer) {
 		clearKey(j.value());
 		_draftsMap.erase(j);
+		_draftChecksums.remove(peer);
 		clearDraftCursors(peer);
 		return;
 	}
@@ -3078,8 +3373,10 @@ void writeDraftCursors(const PeerId &peer, const MessageCursor &msgCursor, const
 		data.stream << quint64(peer) << qint32(msgCursor.position) << qint32(msgCursor.anchor) << qint32(msgCursor.scroll);
 		data.stream << qint32(editCursor.position) << qint32(editCursor.anchor) << qint32(editCursor.scroll);
 
-		FileWriteDescriptor file(i.value());
-		file.writeEncrypted(data);
+		if (_draftFileChanged(_draftCursorChecksums, peer, data)) {
+			FileWriteDescriptor file(i.value());
+			file.writeEncrypted(data);
+		}
 	}
 }
 
@@ -3184,6 +3481,10 @@ Storage::Cache::Database::Settings cacheSettings() {
 	result.totalSizeLimit = _cacheTotalSizeLimit;
 	result.totalTimeLimit = _cacheTotalTimeLimit;
 	result.maxDataSize = Storage::kMaxFileInMemory;
+	result.compactBytesPerSecond = kCacheCompactBytesPerSecond;
+	result.snapshotAfterLength = kCacheSnapshotAfterLength;
+	result.maxPackedDataSize = kCacheMaxPackedDataSize;
+	result.hotCacheSizeLimit = kCacheHotSizeLimit;
 	return result;
 }
 
@@ -3220,9 +3521,21 @@ Storage::Cache::Database::Settings cacheBigFileSettings() {
 	result.totalSizeLimit = _cacheBigFileTotalSizeLimit;
 	result.totalTimeLimit = _cacheBigFileTotalTimeLimit;
 	result.maxDataSize = Storage::kMaxFileInMemory;
+	result.compactBytesPerSecond = kCacheCompactBytesPerSecond;
+	result.snapshotAfterLength = kCacheSnapshotAfterLength;
 	return result;
 }
 
+QString cacheSharedPath() {
+	Expects(!_basePath.isEmpty());
+
+	return _basePath + "shared_cache";
+}
+
+Storage::Cache::Database::Settings cacheSharedSettings() {
+	return cacheBigFileSettings();
+}
+
 class CountWaveformTask : public Task {
 public:
 	CountWaveformTask(DocumentData *doc)
@@ -3277,16 +3590,33 @@ protected:
 void countVoiceWaveform(DocumentData *document) {
 	if (const auto voice = document->voice()) {
 		if (_localLoader) {
+			auto task = std::make_unique<CountWaveformTask>(document);
+			const auto taskId = task->id();
 			voice->waveform.resize(1 + sizeof(TaskId));
 			voice->waveform[0] = -1; // counting
-			TaskId taskId = _localLoader->addTask(
-				std::make_unique<CountWaveformTask>(document));
 			memcpy(voice->waveform.data() + 1, &taskId, sizeof(taskId));
+
+			_waveformTasks.push_back(std::move(task));
+			if (_waveformTasks.size() == 1) {
+				crl::on_main([] {
+					if (_localLoader) {
+						_localLoader->addTasks(base::take(_waveformTasks));
+					}
+				});
+			}
 		}
 	}
 }
 
 void cancelTask(TaskId id) {
+	const auto i = ranges::find(
+		_waveformTasks,
+		id,
+		[](const std::unique_ptr<Task> &task) { return task->id(); });
+	if (i != end(_waveformTasks)) {
+		_waveformTasks.erase(i);
+		return;
+	}
 	if (_localLoader) {
 		_localLoader->cancelTask(id);
 	}
@@ -3334,6 +3664,70 @@ void _writeStickerSet(QDataStream &stream, const Stickers::Set &set) {
 	}
 }
 
+QByteArray _serializeStickerSet(const Stickers::Set &set) {
+	auto result = QByteArray();
+	{
+		QBuffer buffer(&result);
+		buffer.open(QIODevice::WriteOnly);
+		QDataStream stream(&buffer);
+		stream.setVersion(QDataStream::Qt_5_1);
+		_writeStickerSet(stream, set);
+	}
+	return result;
+}
+
+// Writes the set file only if the set changed since it was written last.
+bool _writeStickerSetRecord(const Stickers::Set &set, qint32 list) {
+	for (const auto sticker : set.stickers) {
+		sticker->refreshStickerThumbFileReference();
+	}
+	const auto serialized = _serializeStickerSet(set);
+	if (serialized.isEmpty()) {
+		return false;
+	}
+	const auto checksum = base::crc32(
+		serialized.constData(),
+		serialized.size());
+	auto &record = _stickerSetRecords[set.id];
+	if (!(record.lists & list)) {
+		record.lists |= list;
+		_mapChanged = true;
+	}
+	if (record.key && record.checksum == checksum) {
+		return true;
+	} else if (!record.key) {
+		record.key = genKey();
+	}
+	record.checksum = checksum;
+	_mapChanged = true;
+
+	EncryptedDescriptor data(serialized.size());
+	data.stream.writeRawData(serialized.constData(), serialized.size());
+	FileWriteDescriptor file(record.key);
+	file.writeEncrypted(data);
+	return true;
+}
+
+// Removes the list from the sets not in it, clears sets not in any list.
+void _releaseStickerSetRecords(
+		qint32 list,
+		const base::flat_set<uint64> &kept) {
+	for (auto i = begin(_stickerSetRecords); i != end(_stickerSetRecords);) {
+		auto &record = i->second;
+		if ((record.lists & list) && !kept.contains(i->first)) {
+			record.lists &= ~list;
+			_mapChanged = true;
+		}
+		if (!record.lists) {
+			clearKey(record.key);
+			i = _stickerSetRecords.erase(i);
+			_mapChanged = true;
+		} else {
+			++i;
+		}
+	}
+}
+
 // In generic method _writeStickerSets() we look through all the sets and call a
 // callback on each set to see, if we write it, skip it or abort the whole write.
 enum class StickerSetCheckResult {
@@ -3344,96 +3738,232 @@ enum class StickerSetCheckResult {
 
 // CheckSet is a functor on Stickers::Set, which returns a StickerSetCheckResult.
 template <typename CheckSet>
-void _writeStickerSets(FileKey &stickersKey, CheckSet checkSet, const Stickers::Order &order) {
+void _writeStickerSets(
+		FileKey &stickersKey,
+		qint32 list,
+		CheckSet checkSet,
+		const Stickers::Order &order) {
 	if (!_working()) return;
 
 	const auto &sets = Auth().data().stickerSets();
-	if (sets.isEmpty()) {
-		if (stickersKey) {
-			clearKey(stickersKey);
-			stickersKey = 0;
-			_mapChanged = true;
-		}
-		_writeMap();
-		return;
-	}
-
-	// versionTag + version + count
-	quint32 size = sizeof(quint32) + sizeof(qint32) + sizeof(qint32);
-
-	int32 setsCount = 0;
+	auto checked = std::vector<not_null<const Stickers::Set*>>();
 	for (const auto &set : sets) {
 		auto result = checkSet(set);
 		if (result == StickerSetCheckResult::Abort) {
 			return;
-		} else if (result == StickerSetCheckResult::Skip) {
-			continue;
-		}
-
-		// id + access + title + shortName + stickersCount + hash + flags + installDate
-		size += sizeof(quint64) * 2
-			+ Serialize::stringSize(set.title)
-			+ Serialize::stringSize(set.shortName)
-			+ sizeof(qint32) * 4
-			+ Serialize::storageImageLocationSize(set.thumbnail
-				? set.thumbnail->location()
-				: StorageImageLocation());
-		if (set.flags & MTPDstickerSet_ClientFlag::f_not_loaded) {
-			continue;
-		}
-
-		for (const auto sticker : set.stickers) {
-			sticker->refreshStickerThumbFileReference();
-			size += Serialize::Document::sizeInStream(sticker);
-		}
-
-		size += sizeof(qint32); // datesCount
-		if (!set.dates.empty()) {
-			Assert(set.stickers.size() == set.dates.size());
-			size += set.dates.size() * sizeof(qint32);
+		} else if (result == StickerSetCheckResult::Write) {
+			checked.push_back(&set);
 		}
+	}
 
-		size += sizeof(qint32); // emojiCount
-		for (auto j = set.emoji.cbegin(), e = set.emoji.cend(); j != e; ++j) {
-			size += Serialize::stringSize(j.key()->id()) + sizeof(qint32) + (j->size() * sizeof(quint64));
+	auto written = std::vector<uint64>();
+	written.reserve(checked.size());
+	for (const auto set : checked) {
+		if (_writeStickerSetRecord(*set, list)) {
+			written.push_back(set->id);
 		}
-
-		++setsCount;
 	}
-	if (!setsCount && order.isEmpty()) {
+	_releaseStickerSetRecords(
+		list,
+		base::flat_set<uint64>(written.begin(), written.end()));
+
+	if (written.empty() && order.isEmpty()) {
 		if (stickersKey) {
 			clearKey(stickersKey);
 			stickersKey = 0;
 			_mapChanged = true;
 		}
 		_writeMap();
+		writeStickersHashes();
 		return;
 	}
-	size += sizeof(qint32) + (order.size() * sizeof(quint64));
+
+	// versionTag + version + count + ids + order
+	const auto size = sizeof(quint32)
+		+ sizeof(qint32) * 2
+		+ (written.size() * sizeof(quint64))
+		+ sizeof(qint32)
+		+ (order.size() * sizeof(quint64));
 
 	if (!stickersKey) {
 		stickersKey = genKey();
 		_mapChanged = true;
 		_writeMap(WriteMapWhen::Fast);
+	} else {
+		_writeMap();
 	}
 	EncryptedDescriptor data(size);
 	data.stream
 		<< quint32(kStickersVersionTag)
 		<< qint32(kStickersSerializeVersion)
-		<< qint32(setsCount);
-	for (const auto &set : sets) {
-		auto result = checkSet(set);
-		if (result == StickerSetCheckResult::Abort) {
-			return;
-		} else if (result == StickerSetCheckResult::Skip) {
-			continue;
-		}
-		_writeStickerSet(data.stream, set);
+		<< qint32(written.size());
+	for (const auto setId : written) {
+		data.stream << quint64(setId);
 	}
 	data.stream << order;
 
 	FileWriteDescriptor file(stickersKey);
 	file.writeEncrypted(data);
+
+	writeStickersHashes();
+}
+
+bool _readStickerSet(QDataStream &stream, int32 version) {
+	auto &sets = Auth().data().stickerSetsRef();
+	using LocationType = StorageFileLocation::Type;
+
+	quint64 setId = 0, setAccess = 0;
+	QString setTitle, setShortName;
+	qint32 scnt = 0;
+	qint32 setInstallDate = 0;
+	qint32 setHash = 0;
+	MTPDstickerSet::Flags setFlags = 0;
+	qint32 setFlagsValue = 0;
+	StorageImageLocation setThumbnail;
+
+	stream
+		>> setId
+		>> setAccess
+		>> setTitle
+		>> setShortName
+		>> scnt
+		>> setHash
+		>> setFlagsValue
+		>> setInstallDate;
+	const auto thumbnail = Serialize::readStorageImageLocation(
+		version,
+		stream);
+	if (!thumbnail || !_checkStreamStatus(stream)) {
+		return false;
+	} else if (thumbnail->valid()
+		&& thumbnail->type() == LocationType::Legacy) {
+		setThumbnail = thumbnail->convertToModern(
+			LocationType::StickerSetThumb,
+			setId,
+			setAccess);
+	} else {
+		setThumbnail = *thumbnail;
+	}
+
+	setFlags = MTPDstickerSet::Flags::from_raw(setFlagsValue);
+	if (setId == Stickers::DefaultSetId) {
+		setTitle = tr::lng_stickers_default_set(tr::now);
+		setFlags |= MTPDstickerSet::Flag::f_official | MTPDstickerSet_ClientFlag::f_special;
+	} else if (setId == Stickers::CustomSetId) {
+		setTitle = qsl("Custom stickers");
+		setFlags |= MTPDstickerSet_ClientFlag::f_special;
+	} else if (setId == Stickers::CloudRecentSetId) {
+		setTitle = tr::lng_recent_stickers(tr::now);
+		setFlags |= MTPDstickerSet_ClientFlag::f_special;
+	} else if (setId == Stickers::FavedSetId) {
+		setTitle = Lang::Hard::FavedSetTitle();
+		setFlags |= MTPDstickerSet_ClientFlag::f_special;
+	} else if (!setId) {
+		return true;
+	}
+
+	auto it = sets.find(setId);
+	if (it == sets.cend()) {
+		// We will set this flags from order lists when reading those stickers.
+		setFlags &= ~(MTPDstickerSet::Flag::f_installed_date | MTPDstickerSet_ClientFlag::f_featured);
+		it = sets.insert(setId, Stickers::Set(
+			setId,
+			setAccess,
+			setTitle,
+			setShortName,
+			0,
+			setHash,
+			MTPDstickerSet::Flags(setFlags),
+			setInstallDate,
+			Images::CreateStickerSetThumbnail(setThumbnail)));
+	}
+	auto &set = it.value();
+	auto inputSet = MTP_inputStickerSetID(MTP_long(set.id), MTP_long(set.access));
+	const auto fillStickers = set.stickers.isEmpty();
+
+	if (scnt < 0) { // disabled not loaded set
+		if (!set.count || fillStickers) {
+			set.count = -scnt;
+		}
+		return true;
+	}
+
+	if (fillStickers) {
+		set.stickers.reserve(scnt);
+		set.count = 0;
+	}
+
+	Serialize::Document::StickerSetInfo info(setId, setAccess, setShortName);
+	base::flat_set<DocumentId> read;
+	for (int32 j = 0; j < scnt; ++j) {
+		auto document = Serialize::Document::readStickerFromStream(version, stream, info);
+		if (!_checkStreamStatus(stream)) {
+			return false;
+		} else if (!document
+			|| !document->sticker()
+			|| read.contains(document->id)) {
+			continue;
+		}
+		read.emplace(document->id);
+		if (fillStickers) {
+			set.stickers.push_back(document);
+			if (!(set.flags & MTPDstickerSet_ClientFlag::f_special)) {
+				if (document->sticker()->set.type() != mtpc_inputStickerSetID) {
+					document->sticker()->set = inputSet;
+				}
+			}
+			++set.count;
+		}
+	}
+
+	qint32 datesCount = 0;
+	stream >> datesCount;
+	if (datesCount > 0) {
+		if (datesCount != scnt) {
+			return false;
+		}
+		const auto fillDates = (set.id == Stickers::CloudRecentSetId)
+			&& (set.stickers.size() == datesCount);
+		if (fillDates) {
+			set.dates.clear();
+			set.dates.reserve(datesCount);
+		}
+		for (auto i = 0; i != datesCount; ++i) {
+			qint32 date = 0;
+			stream >> date;
+			if (fillDates) {
+				set.dates.push_back(TimeId(date));
+			}
+		}
+	}
+
+	qint32 emojiCount = 0;
+	stream >> emojiCount;
+	if (!_checkStreamStatus(stream) || emojiCount < 0) {
+		return false;
+	}
+	for (int32 j = 0; j < emojiCount; ++j) {
+		QString emojiString;
+		qint32 stickersCount;
+		stream >> emojiString >> stickersCount;
+		Stickers::Pack pack;
+		pack.reserve(stickersCount);
+		for (int32 k = 0; k < stickersCount; ++k) {
+			quint64 id;
+			stream >> id;
+			const auto doc = Auth().data().document(id);
+			if (!doc->sticker()) continue;
+
+			pack.push_back(doc);
+		}
+		if (fillStickers) {
+			if (auto emoji = Ui::Emoji::Find(emojiString)) {
+				emoji = emoji->original();
+				set.emoji.insert(emoji, pack);
+			}
+		}
+	}
+	return true;
 }
 
 void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr, MTPDstickerSet::Flags readingFlags = 0) {
@@ -3457,7 +3987,8 @@ void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr,
 	qint32 version = 0;
 	stickers.stream >> versionTag >> version;
 	if (versionTag != kStickersVersionTag
-		|| version != kStickersSerializeVersion) {
+		|| (version != kStickersSerializeVersion
+			&& version != kStickersBlobSerializeVersion)) {
 		// Old data, without sticker set thumbnails.
 		return failed();
 	}
@@ -3469,158 +4000,25 @@ void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr,
 		return failed();
 	}
 	for (auto i = 0; i != count; ++i) {
-		using LocationType = StorageFileLocation::Type;
-
-		quint64 setId = 0, setAccess = 0;
-		QString setTitle, setShortName;
-		qint32 scnt = 0;
-		qint32 setInstallDate = 0;
-		qint32 setHash = 0;
-		MTPDstickerSet::Flags setFlags = 0;
-		qint32 setFlagsValue = 0;
-		StorageImageLocation setThumbnail;
-
-		stickers.stream
-			>> setId
-			>> setAccess
-			>> setTitle
-			>> setShortName
-			>> scnt
-			>> setHash
-			>> setFlagsValue
-			>> setInstallDate;
-		const auto thumbnail = Serialize::readStorageImageLocation(
-			stickers.version,
-			stickers.stream);
-		if (!thumbnail || !_checkStreamStatus(stickers.stream)) {
-			return failed();
-		} else if (thumbnail->valid()
-			&& thumbnail->type() == LocationType::Legacy) {
-			setThumbnail = thumbnail->convertToModern(
-				LocationType::StickerSetThumb,
-				setId,
-				setAccess);
-		} else {
-			setThumbnail = *thumbnail;
-		}
-
-		setFlags = MTPDstickerSet::Flags::from_raw(setFlagsValue);
-		if (setId == Stickers::DefaultSetId) {
-			setTitle = tr::lng_stickers_default_set(tr::now);
-			setFlags |= MTPDstickerSet::Flag::f_official | MTPDstickerSet_ClientFlag::f_special;
-		} else if (setId == Stickers::CustomSetId) {
-			setTitle = qsl("Custom stickers");
-			setFlags |= MTPDstickerSet_ClientFlag::f_special;
-		} else if (setId == Stickers::CloudRecentSetId) {
-			setTitle = tr::lng_recent_stickers(tr::now);
-			setFlags |= MTPDstickerSet_ClientFlag::f_special;
-		} else if (setId == Stickers::FavedSetId) {
-			setTitle = Lang::Hard::FavedSetTitle();
-			setFlags |= MTPDstickerSet_ClientFlag::f_special;
-		} else if (!setId) {
-			continue;
-		}
-
-		auto it = sets.find(setId);
-		if (it == sets.cend()) {
-			// We will set this flags from order lists when reading those stickers.
-			setFlags &= ~(MTPDstickerSet::Flag::f_installed_date | MTPDstickerSet_ClientFlag::f_featured);
-			it = sets.insert(setId, Stickers::Set(
-				setId,
-				setAccess,
-				setTitle,
-				setShortName,
-				0,
-				setHash,
-				MTPDstickerSet::Flags(setFlags),
-				setInstallDate,
-				Images::CreateStickerSetThumbnail(setThumbnail)));
-		}
-		auto &set = it.value();
-		auto inputSet = MTP_inputStickerSetID(MTP_long(set.id), MTP_long(set.access));
-		const auto fillStickers = set.stickers.isEmpty();
-
-		if (scnt < 0) { // disabled not loaded set
-			if (!set.count || fillStickers) {
-				set.count = -scnt;
-			}
-			continue;
-		}
-
-		if (fillStickers) {
-			set.stickers.reserve(scnt);
-			set.count = 0;
-		}
-
-		Serialize::Document::StickerSetInfo info(setId, setAccess, setShortName);
-		base::flat_set<DocumentId> read;
-		for (int32 j = 0; j < scnt; ++j) {
-			auto document = Serialize::Document::readStickerFromStream(stickers.version, stickers.stream, info);
-			if (!_checkStreamStatus(stickers.stream)) {
+		if (version == kStickersBlobSerializeVersion) {
+			if (!_readStickerSet(stickers.stream, stickers.version)) {
 				return failed();
-			} else if (!document
-				|| !document->sticker()
-				|| read.contains(document->id)) {
-				continue;
-			}
-			read.emplace(document->id);
-			if (fillStickers) {
-				set.stickers.push_back(document);
-				if (!(set.flags & MTPDstickerSet_ClientFlag::f_special)) {
-					if (document->sticker()->set.type() != mtpc_inputStickerSetID) {
-						document->sticker()->set = inputSet;
-					}
-				}
-				++set.count;
 			}
+			continue;
 		}
-
-		qint32 datesCount = 0;
-		stickers.stream >> datesCount;
-		if (datesCount > 0) {
-			if (datesCount != scnt) {
-				return failed();
-			}
-			const auto fillDates = (set.id == Stickers::CloudRecentSetId)
-				&& (set.stickers.size() == datesCount);
-			if (fillDates) {
-				set.dates.clear();
-				set.dates.reserve(datesCount);
-			}
-			for (auto i = 0; i != datesCount; ++i) {
-				qint32 date = 0;
-				stickers.stream >> date;
-				if (fillDates) {
-					set.dates.push_back(TimeId(date));
-				}
-			}
+		quint64 setId = 0;
+		stickers.stream >> setId;
+		if (!_checkStreamStatus(stickers.stream)) {
+			return failed();
 		}
-
-		qint32 emojiCount = 0;
-		stickers.stream >> emojiCount;
-		if (!_checkStreamStatus(stickers.stream) || emojiCount < 0) {
+		const auto record = _stickerSetRecords.find(setId);
+		if (record == end(_stickerSetRecords)) {
 			return failed();
 		}
-		for (int32 j = 0; j < emojiCount; ++j) {
-			QString emojiString;
-			qint32 stickersCount;
-			stickers.stream >> emojiString >> stickersCount;
-			Stickers::Pack pack;
-			pack.reserve(stickersCount);
-			for (int32 k = 0; k < stickersCount; ++k) {
-				quint64 id;
-				stickers.stream >> id;
-				const auto doc = Auth().data().document(id);
-				if (!doc->sticker()) continue;
-
-				pack.push_back(doc);
-			}
-			if (fillStickers) {
-				if (auto emoji = Ui::Emoji::Find(emojiString)) {
-					emoji = emoji->original();
-					set.emoji.insert(emoji, pack);
-				}
-			}
+		FileReadDescriptor data;
+		if (!readEncryptedFile(data, record->second.key)
+			|| !_readStickerSet(data.stream, data.version)) {
+			return failed();
 		}
 	}
 
@@ -3650,7 +4048,7 @@ void _readStickerSets(FileKey &stickersKey, Stickers::Order *outOrder = nullptr,
 void writeInstalledStickers() {
 	if (!Global::started()) return;
 
-	_writeStickerSets(_installedStickersKey, [](const Stickers::Set &set) {
+	_writeStickerSets(_installedStickersKey, kInstalledStickerSets, [](const Stickers::Set &set) {
 		if (set.id == Stickers::CloudRecentSetId || set.id == Stickers::FavedSetId) { // separate files for them
 			return StickerSetCheckResult::Skip;
 		} else if (set.flags & MTPDstickerSet_ClientFlag::f_special) {
@@ -3671,7 +4069,7 @@ void writeInstalledStickers() {
 void writeFeaturedStickers() {
 	if (!Global::started()) return;
 
-	_writeStickerSets(_featuredStickersKey, [](const Stickers::Set &set) {
+	_writeStickerSets(_featuredStickersKey, kFeaturedStickerSets, [](const Stickers::Set &set) {
 		if (set.id == Stickers::CloudRecentSetId || set.id == Stickers::FavedSetId) { // separate files for them
 			return StickerSetCheckResult::Skip;
 		} else if (set.flags & MTPDstickerSet_ClientFlag::f_special) {
@@ -3690,7 +4088,7 @@ void writeFeaturedStickers() {
 void writeRecentStickers() {
 	if (!Global::started()) return;
 
-	_writeStickerSets(_recentStickersKey, [](const Stickers::Set &set) {
+	_writeStickerSets(_recentStickersKey, kRecentStickerSets, [](const Stickers::Set &set) {
 		if (set.id != Stickers::CloudRecentSetId || set.stickers.isEmpty()) {
 			return StickerSetCheckResult::Skip;
 		}
@@ -3701,7 +4099,7 @@ void writeRecentStickers() {
 void writeFavedStickers() {
 	if (!Global::started()) return;
 
-	_writeStickerSets(_favedStickersKey, [](const Stickers::Set &set) {
+	_writeStickerSets(_favedStickersKey, kFavedStickerSets, [](const Stickers::Set &set) {
 		if (set.id != Stickers::FavedSetId || set.stickers.isEmpty()) {
 			return StickerSetCheckResult::Skip;
 		}
@@ -3712,7 +4110,7 @@ void writeFavedStickers() {
 void writeArchivedStickers() {
 	if (!Global::started()) return;
 
-	_writeStickerSets(_archivedStickersKey, [](const Stickers::Set &set) {
+	_writeStickerSets(_archivedStickersKey, kArchivedStickerSets, [](const Stickers::Set &set) {
 		if (!(set.flags & MTPDstickerSet::Flag::f_archived) || set.stickers.isEmpty()) {
 			return StickerSetCheckResult::Skip;
 		}
@@ -3891,6 +4289,11 @@ int32 countSpecialStickerSetHash(uint64 setId) {
 }
 
 int32 countStickersHash(bool checkOutdatedInfo) {
+	if (_stickersHashes && !Auth().data().stickersLoaded()) {
+		return (checkOutdatedInfo && _stickersHashes->installedOutdated)
+			? 0
+			: _stickersHashes->installed;
+	}
 	auto result = Api::HashInit();
 	bool foundOutdated = false;
 	auto &sets = Auth().data().stickerSets();
@@ -3912,14 +4315,23 @@ int32 countStickersHash(bool checkOutdatedInfo) {
 }
 
 int32 countRecentStickersHash() {
+	if (_stickersHashes && !Auth().data().stickersLoaded()) {
+		return _stickersHashes->recent;
+	}
 	return countSpecialStickerSetHash(Stickers::CloudRecentSetId);
 }
 
 int32 countFavedStickersHash() {
+	if (_stickersHashes && !Auth().data().stickersLoaded()) {
+		return _stickersHashes->faved;
+	}
 	return countSpecialStickerSetHash(Stickers::FavedSetId);
 }
 
 int32 countFeaturedStickersHash() {
+	if (_stickersHashes && !Auth().data().stickersLoaded()) {
+		return _stickersHashes->featured;
+	}
 	auto result = Api::HashInit();
 	const auto &sets = Auth().data().stickerSets();
 	const auto &featured = Auth().data().featuredStickerSetsOrder();
@@ -3935,9 +4347,99 @@ int32 countFeaturedStickersHash() {
 }
 
 int32 countSavedGifsHash() {
+	if (_stickersHashes && !Auth().data().savedGifsLoaded()) {
+		return _stickersHashes->savedGifs;
+	}
 	return countDocumentVectorHash(Auth().data().savedGifs());
 }
 
+void readStickersHashes() {
+	if (!_stickersHashesKey) return;
+
+	FileReadDescriptor file;
+	if (!readEncryptedFile(file, _stickersHashesKey)) {
+		clearKey(_stickersHashesKey);
+		_stickersHashesKey = 0;
+		_writeMap();
+		return;
+	}
+
+	auto hashes = StickersHashes();
+	file.stream
+		>> hashes.installed
+		>> hashes.installedOutdated
+		>> hashes.featured
+		>> hashes.featuredUnreadCount
+		>> hashes.recent
+		>> hashes.faved
+		>> hashes.savedGifs;
+	if (!_checkStreamStatus(file.stream)) {
+		return;
+	}
+	_stickersHashes = hashes;
+	if (!Auth().data().stickersLoaded()) {
+		Auth().data().setFeaturedStickerSetsUnreadCount(
+			hashes.featuredUnreadCount);
+	}
+}
+
+void writeStickersHashes() {
+	if (!_working()) return;
+
+	// Until both parts are read we don't know all the hashes.
+	const auto &session = Auth().data();
+	const auto stickersKnown = _stickersHashes || session.stickersLoaded();
+	const auto savedGifsKnown = _stickersHashes || session.savedGifsLoaded();
+	if (!stickersKnown || !savedGifsKnown) {
+		return;
+	}
+	auto hashes = _stickersHashes.value_or(StickersHashes());
+	if (session.stickersLoaded()) {
+		hashes.installed = countStickersHash();
+		hashes.installedOutdated = (countStickersHash(true) != hashes.installed) ? 1 : 0;
+		hashes.featured = countFeaturedStickersHash();
+		hashes.featuredUnreadCount = session.featuredStickerSetsUnreadCount();
+		hashes.recent = countRecentStickersHash();
+		hashes.faved = countFavedStickersHash();
+	}
+	if (session.savedGifsLoaded()) {
+		hashes.savedGifs = countSavedGifsHash();
+	}
+	const auto tie = [](const StickersHashes &value) {
+		return std::tie(
+			value.installed,
+			value.installedOutdated,
+			value.featured,
+			value.featuredUnreadCount,
+			value.recent,
+			value.faved,
+			value.savedGifs);
+	};
+	if (_stickersHashesKey
+		&& _stickersHashes
+		&& tie(*_stickersHashes) == tie(hashes)) {
+		return;
+	}
+	_stickersHashes = hashes;
+
+	if (!_stickersHashesKey) {
+		_stickersHashesKey = genKey();
+		_mapChanged = true;
+		_writeMap(WriteMapWhen::Fast);
+	}
+	EncryptedDescriptor data(sizeof(qint32) * 7);
+	data.stream
+		<< hashes.installed
+		<< hashes.installedOutdated
+		<< hashes.featured
+		<< hashes.featuredUnreadCount
+		<< hashes.recent
+		<< hashes.faved
+		<< hashes.savedGifs;
+	FileWriteDescriptor file(_stickersHashesKey);
+	file.writeEncrypted(data);
+}
+
 void writeSavedGifs() {
 	if (!_working()) return;
 
@@ -3968,6 +4470,7 @@ void writeSavedGifs() {
 		FileWriteDescriptor file(_savedGifsKey);
 		file.writeEncrypted(data);
 	}
+	writeStickersHashes();
 }
 
 void readSavedGifs() {
@@ -4717,6 +5220,7 @@ void WriteExportSettings(const Export::Settings &settings) {
 		&& settings.media.sizeLimit == check.media.sizeLimit
 		&& settings.path == check.path
 		&& settings.format == check.format
+		&& settings.archive == check.archive
 		&& settings.availableAt == check.availableAt
 		&& !settings.onlySinglePeer()) {
 		if (_exportSettingsKey) {
@@ -4733,7 +5237,7 @@ void WriteExportSettings(const Export::Settings &settings) {
 		}
 		quint32 size = sizeof(quint32) * 6
 			+ Serialize::stringSize(settings.path)
-			+ sizeof(qint32) * 2 + sizeof(quint64);
+			+ sizeof(qint32) * 3 + sizeof(quint64);
 		EncryptedDescriptor data(size);
 		data.stream
 			<< quint32(settings.types)
@@ -4766,6 +5270,7 @@ void WriteExportSettings(const Export::Settings &settings) {
 		});
 		data.stream << qint32(settings.singlePeerFrom);
 		data.stream << qint32(settings.singlePeerTill);
+		data.stream << qint32(settings.archive ? 1 : 0);
 
 		FileWriteDescriptor file(_exportSettingsKey);
 		file.writeEncrypted(data);
@@ -4788,6 +5293,7 @@ Export::Settings ReadExportSettings() {
 	qint32 singlePeerType = 0, singlePeerBareId = 0;
 	quint64 singlePeerAccessHash = 0;
 	qint32 singlePeerFrom = 0, singlePeerTill = 0;
+	qint32 archive = 0;
 	file.stream
 		>> types
 		>> fullChats
@@ -4812,6 +5318,9 @@ Export::Settings ReadExportSettings() {
 	if (!file.stream.atEnd()) {
 		file.stream >> singlePeerFrom >> singlePeerTill;
 	}
+	if (!file.stream.atEnd()) {
+		file.stream >> archive;
+	}
 	auto result = Export::Settings();
 	result.types = Export::Settings::Types::from_raw(types);
 	result.fullChats = Export::Settings::Types::from_raw(fullChats);
@@ -4841,11 +5350,97 @@ Export::Settings ReadExportSettings() {
 	}();
 	result.singlePeerFrom = singlePeerFrom;
 	result.singlePeerTill = singlePeerTill;
+	result.archive = (archive == 1);
 	return (file.stream.status() == QDataStream::Ok && result.validate())
 		? result
 		: Export::Settings();
 }
 
+void WriteResumableUploads(
+		const std::vector<Storage::ResumableUpload> &uploads) {
+	if (!_working()) return;
+
+	if (uploads.empty()) {
+		if (_resumableUploadsKey) {
+			clearKey(_resumableUploadsKey);
+			_resumableUploadsKey = 0;
+			_mapChanged = true;
+		}
+		_writeMap();
+	} else {
+		if (!_resumableUploadsKey) {
+			_resumableUploadsKey = genKey();
+			_mapChanged = true;
+			_writeMap(WriteMapWhen::Fast);
+		}
+		quint32 size = sizeof(quint32);
+		for (const auto &upload : uploads) {
+			size += Serialize::stringSize(upload.path)
+				+ sizeof(quint64) * 3
+				+ sizeof(qint32) * 3
+				+ Serialize::bytearraySize(upload.acknowledged);
+		}
+		EncryptedDescriptor data(size);
+		data.stream << quint32(uploads.size());
+		for (const auto &upload : uploads) {
+			data.stream
+				<< upload.path
+				<< quint64(upload.size)
+				<< quint64(upload.modified)
+				<< quint64(upload.fileId)
+				<< qint32(upload.partSize)
+				<< qint32(upload.partsCount)
+				<< qint32(upload.startedAt)
+				<< upload.acknowledged;
+		}
+
+		FileWriteDescriptor file(_resumableUploadsKey);
+		file.writeEncrypted(data);
+	}
+}
+
+std::vector<Storage::ResumableUpload> ReadResumableUploads() {
+	if (!_resumableUploadsKey) {
+		return {};
+	}
+	FileReadDescriptor file;
+	if (!readEncryptedFile(file, _resumableUploadsKey)) {
+		clearKey(_resumableUploadsKey);
+		_resumableUploadsKey = 0;
+		_writeMap();
+		return {};
+	}
+
+	quint32 count = 0;
+	file.stream >> count;
+	auto result = std::vector<Storage::ResumableUpload>();
+	for (auto i = quint32(0); i != count; ++i) {
+		quint64 size = 0, modified = 0, fileId = 0;
+		qint32 partSize = 0, partsCount = 0, startedAt = 0;
+		auto upload = Storage::ResumableUpload();
+		file.stream
+			>> upload.path
+			>> size
+			>> modified
+			>> fileId
+			>> partSize
+			>> partsCount
+			>> startedAt
+			>> upload.acknowledged;
+		if (!_checkStreamStatus(file.stream)) {
+			return {};
+		}
+		upload.size = size;
+		upload.modified = modified;
+		upload.fileId = fileId;
+		upload.partSize = partSize;
+		upload.partsCount = partsCount;
+		upload.startedAt = startedAt;
+		result.push_back(std::move(upload));
+	}
+	return result;
+}
+
 void writeSelf() {
 	_mapChanged = true;
 	_writeMap();
@@ -4976,6 +5571,8 @@ bool ClearManager::addTask(int task) {
 			_draftCursorsMap.clear();
 			_mapChanged = true;
 		}
+		_draftChecksums.clear();
+		_draftCursorChecksums.clear();
 		if (_locationsKey) {
 			_locationsKey = 0;
 			_mapChanged = true;
@@ -4992,6 +5589,10 @@ bool ClearManager::addTask(int task) {
 			_installedStickersKey = _featuredStickersKey = _recentStickersKey = _archivedStickersKey = 0;
 			_mapChanged = true;
 		}
+		if (!_stickerSetRecords.empty()) {
+			_stickerSetRecords.clear();
+			_mapChanged = true;
+		}
 		if (_recentHashtagsAndBotsKey) {
 			_recentHashtagsAndBotsKey = 0;
 			_mapChanged = true;
@@ -5017,6 +5618,9 @@ bool ClearManager::hasTask(ClearManagerTask task) {
 }
 
 void ClearManager::start() {
+	if (_writer) {
+		_writer->flushAll();
+	}
 	moveToThread(data->thread);
 	connect(data->thread, SIGNAL(started()), this, SLOT(onStart()));
 	connect(data->thread, SIGNAL(finished()), data->thread, SLOT(deleteLater()));
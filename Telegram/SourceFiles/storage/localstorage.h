@@ -26,6 +26,7 @@ struct Language;
 
 namespace Storage {
 class EncryptionKey;
+struct ResumableUpload;
 } // namespace Storage
 
 namespace Window {
@@ -129,6 +130,9 @@ Storage::EncryptionKey cacheBigFileKey();
 QString cacheBigFilePath();
 Storage::Cache::Database::Settings cacheBigFileSettings();
 
+QString cacheSharedPath();
+Storage::Cache::Database::Settings cacheSharedSettings();
+
 void countVoiceWaveform(DocumentData *document);
 
 void cancelTask(TaskId id);
@@ -152,6 +156,10 @@ void writeSavedGifs();
 void readSavedGifs();
 int32 countSavedGifsHash();
 
+// Hashes of all the sets and saved gifs, read before the sets themselves.
+void readStickersHashes();
+void writeStickersHashes();
+
 void writeBackground(const Data::WallPaper &paper, const QImage &image);
 bool readBackground();
 
@@ -175,6 +183,10 @@ void saveRecentSearchHashtags(const QString &text);
 void WriteExportSettings(const Export::Settings &settings);
 Export::Settings ReadExportSettings();
 
+void WriteResumableUploads(
+	const std::vector<Storage::ResumableUpload> &uploads);
+std::vector<Storage::ResumableUpload> ReadResumableUploads();
+
 void writeSelf();
 void readSelf(const QByteArray &serialized, int32 streamVersion);
 
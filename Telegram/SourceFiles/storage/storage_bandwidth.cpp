@@ -0,0 +1,135 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#include "storage/storage_bandwidth.h"
+
+namespace Storage {
+namespace {
+
+// Blocked transfers are retried this often.
+constexpr auto kRefillTimeout = crl::time(100);
+
+// Auto-downloads get only this part of the total limit
+// for this long after the last interactive request.
+constexpr auto kBackgroundPercent = 25;
+constexpr auto kInteractiveTimeout = crl::time(1000);
+
+constexpr auto kMeasureInterval = crl::time(1000);
+
+[[nodiscard]] int Index(BandwidthClass type) {
+	const auto result = static_cast<int>(type);
+	Assert(result >= 0 && result < kBandwidthClassCount);
+	return result;
+}
+
+} // namespace
+
+Bandwidth::Bandwidth() : _refillTimer([=] { _refilled.fire({}); }) {
+}
+
+void Bandwidth::setTotalLimit(int64 bytesPerSecond) {
+	SetLimit(_total, bytesPerSecond);
+	_refilled.fire({});
+}
+
+void Bandwidth::setLimit(BandwidthClass type, int64 bytesPerSecond) {
+	SetLimit(_buckets[Index(type)], bytesPerSecond);
+	_refilled.fire({});
+}
+
+int64 Bandwidth::totalLimit() const {
+	return _total.limit;
+}
+
+int64 Bandwidth::limit(BandwidthClass type) const {
+	return _buckets[Index(type)].limit;
+}
+
+bool Bandwidth::acquire(BandwidthClass type, int64 bytes) {
+	Expects(bytes >= 0);
+
+	const auto now = crl::now();
+	auto &bucket = _buckets[Index(type)];
+	Refill(bucket, now);
+	Refill(_total, now);
+
+	const auto preempted = (type == BandwidthClass::AutoDownload)
+		&& (_interactiveUsed > 0)
+		&& (now - _interactiveUsed < kInteractiveTimeout);
+	const auto reserve = preempted
+		? (_total.limit * (100 - kBackgroundPercent) / 100)
+		: 0;
+
+	// The buckets may go below zero, so a request bigger
+	// than the limit per second still can be sent.
+	if (!Available(bucket, 0) || !Available(_total, reserve)) {
+		if (!_refillTimer.isActive()) {
+			_refillTimer.callOnce(kRefillTimeout);
+		}
+		return false;
+	}
+	if (bucket.limit) {
+		bucket.tokens -= bytes;
+	}
+	if (_total.limit) {
+		_total.tokens -= bytes;
+	}
+	if (type == BandwidthClass::Interactive) {
+		_interactiveUsed = now;
+	}
+	count(type, bytes, now);
+	return true;
+}
+
+int64 Bandwidth::throughput(BandwidthClass type) const {
+	const auto &counter = _counters[Index(type)];
+	return (crl::now() - counter.measureStart < 2 * kMeasureInterval)
+		? counter.bytesPerSecond
+		: 0;
+}
+
+rpl::producer<> Bandwidth::refilled() const {
+	return _refilled.events();
+}
+
+void Bandwidth::Refill(Bucket &bucket, crl::time now) {
+	if (!bucket.limit) {
+		return;
+	}
+	const auto elapsed = now - bucket.refilled;
+	bucket.tokens = std::min(
+		bucket.limit,
+		bucket.tokens + bucket.limit * elapsed / 1000);
+	bucket.refilled = now;
+}
+
+void Bandwidth::SetLimit(Bucket &bucket, int64 bytesPerSecond) {
+	Expects(bytesPerSecond >= 0);
+
+	bucket.limit = bytesPerSecond;
+	bucket.tokens = bytesPerSecond;
+	bucket.refilled = crl::now();
+}
+
+bool Bandwidth::Available(const Bucket &bucket, int64 reserve) {
+	return !bucket.limit || (bucket.tokens > reserve);
+}
+
+void Bandwidth::count(BandwidthClass type, int64 bytes, crl::time now) {
+	auto &counter = _counters[Index(type)];
+	if (now - counter.measureStart >= kMeasureInterval) {
+		const auto elapsed = now - counter.measureStart;
+		counter.bytesPerSecond = (elapsed < 2 * kMeasureInterval)
+			? (counter.measuredBytes * 1000 / elapsed)
+			: 0;
+		counter.measureStart = now;
+		counter.measuredBytes = 0;
+	}
+	counter.measuredBytes += bytes;
+}
+
+} // namespace Storage
@@ -0,0 +1,71 @@
+/*
+This file is part of Telegram Desktop,
+the official desktop application for the Telegram messaging service.
+
+For license and copyright information please follow this link:
+https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
+*/
+#pragma once
+
+#include "base/timer.h"
+
+namespace Storage {
+
+enum class BandwidthClass {
+	Interactive,
+	Streaming,
+	AutoDownload,
+	Upload,
+};
+
+constexpr auto kBandwidthClassCount = 4;
+
+// Token buckets for file transfers, one for every class and a total one.
+// A zero limit means no limit. While interactive loads are active the
+// auto-downloads may use only a quarter of the total limit.
+class Bandwidth final {
+public:
+	Bandwidth();
+
+	void setTotalLimit(int64 bytesPerSecond);
+	void setLimit(BandwidthClass type, int64 bytesPerSecond);
+	[[nodiscard]] int64 totalLimit() const;
+	[[nodiscard]] int64 limit(BandwidthClass type) const;
+
+	// Takes tokens for a request of this size if the buckets allow it.
+	[[nodiscard]] bool acquire(BandwidthClass type, int64 bytes);
+
+	// Bytes per second requested by the class during the last second.
+	[[nodiscard]] int64 throughput(BandwidthClass type) const;
+
+	// Fired when the buckets are refilled after a failed acquire().
+	[[nodiscard]] rpl::producer<> refilled() const;
+
+private:
+	struct Bucket {
+		int64 limit = 0;
+		int64 tokens = 0;
+		crl::time refilled = 0;
+	};
+	struct Counter {
+		crl::time measureStart = 0;
+		int64 measuredBytes = 0;
+		int64 bytesPerSecond = 0;
+	};
+
+	static void Refill(Bucket &bucket, crl::time now);
+	static void SetLimit(Bucket &bucket, int64 bytesPerSecond);
+	[[nodiscard]] static bool Available(const Bucket &bucket, int64 reserve);
+	void count(BandwidthClass type, int64 bytes, crl::time now);
+
+	std::array<Bucket, kBandwidthClassCount> _buckets;
+	std::array<Counter, kBandwidthClassCount> _counters;
+	Bucket _total;
+	crl::time _interactiveUsed = 0;
+
+	base::Timer _refillTimer;
+	rpl::event_stream<> _refilled;
+
+};
+
+} // namespace Storage
@@ -13,6 +13,7 @@ namespace Storage {
 namespace {
 
 constexpr auto kBlockSize = CtrState::kBlockSize;
+constexpr auto kWriterBufferSize = size_type(64 * 1024);
 
 enum class Format : uint32 {
 	Format_0,
@@ -183,8 +184,10 @@ size_type File::writePlain(bytes::const_span bytes) {
 void File::decrypt(bytes::span bytes) {
 	Expects(_state.has_value());
 
+	const auto started = crl::profile();
 	_state->decrypt(bytes, _encryptionOffset);
 	_encryptionOffset += bytes.size();
+	_decryptDuration += crl::profile() - started;
 }
 
 void File::encrypt(bytes::span bytes) {
@@ -262,6 +265,47 @@ size_type File::readWithPadding(bytes::span bytes) {
 	return size;
 }
 
+size_type File::readWithPaddingMapped(bytes::span bytes) {
+	Expects(_state.has_value());
+
+	const auto size = bytes.size();
+	const auto part = size % kBlockSize;
+	const auto good = size - part;
+	const auto padded = good + (part ? kBlockSize : 0);
+	if (offset() + padded > _dataSize) {
+		return readWithPadding(bytes);
+	}
+	const auto position = _data.pos();
+	const auto mapped = _data.map(position, padded);
+	if (!mapped) {
+		return readWithPadding(bytes);
+	}
+	const auto guard = gsl::finally([&] { _data.unmap(mapped); });
+	const auto source = bytes::make_span(mapped, padded);
+	const auto started = crl::profile();
+	if (good) {
+		_state->decrypt(
+			source.subspan(0, good),
+			bytes.subspan(0, good),
+			_encryptionOffset);
+	}
+	if (part) {
+		auto storage = bytes::array<kBlockSize>();
+		const auto block = bytes::make_span(storage);
+		_state->decrypt(
+			source.subspan(good),
+			block,
+			_encryptionOffset + good);
+		bytes::copy(bytes.subspan(good), block.subspan(0, part));
+	}
+	_decryptDuration += crl::profile() - started;
+	if (!_data.seek(position + padded)) {
+		return 0;
+	}
+	_encryptionOffset += padded;
+	return size;
+}
+
 bool File::writeWithPadding(bytes::span bytes) {
 	const auto size = bytes.size();
 	const auto part = size % kBlockSize;
@@ -298,6 +342,10 @@ void File::close() {
 	_state = std::nullopt;
 }
 
+crl::profile_time File::decryptDuration() const {
+	return _decryptDuration;
+}
+
 bool File::isOpen() const {
 	return _data.isOpen();
 }
@@ -344,5 +392,131 @@ bool File::Move(const QString &from, const QString &to) {
 	return source.rename(to);
 }
 
+FileReader::FileReader(File &file, int64 offset, int64 size)
+: _file(file)
+, _offset(offset)
+, _size(size) {
+	Expects(_offset >= 0 && (_offset % kBlockSize) == 0);
+	Expects(_size >= 0);
+}
+
+int64 FileReader::size() const {
+	return _size;
+}
+
+int64 FileReader::left() const {
+	return _size - _position;
+}
+
+bool FileReader::readBlock() {
+	const auto block = bytes::make_span(_block);
+	const auto position = _position - (_position % kBlockSize);
+	return _file.seek(_offset + position)
+		&& (_file.read(block) == block.size());
+}
+
+size_type FileReader::read(bytes::span bytes) {
+	const auto wanted = size_type(std::min(int64(bytes.size()), left()));
+	auto result = size_type(0);
+	if (const auto skip = size_type(_position % kBlockSize)) {
+		const auto count = std::min(kBlockSize - skip, wanted);
+		bytes::copy(
+			bytes.subspan(0, count),
+			bytes::make_span(_block).subspan(skip, count));
+		_position += count;
+		result += count;
+	}
+	const auto whole = wanted - result;
+	const auto aligned = whole - (whole % kBlockSize);
+	if (aligned) {
+		if (!_file.seek(_offset + _position)) {
+			return result;
+		}
+		const auto read = _file.read(bytes.subspan(result, aligned));
+		_position += read;
+		result += read;
+		if (read != aligned) {
+			return result;
+		}
+	}
+	if (const auto rest = wanted - result) {
+		if (!readBlock()) {
+			return result;
+		}
+		bytes::copy(
+			bytes.subspan(result, rest),
+			bytes::make_span(_block).subspan(0, rest));
+		_position += rest;
+		result += rest;
+	}
+	return result;
+}
+
+FileWriter::FileWriter(File &file, int64 offset)
+: _file(file)
+, _offset(offset) {
+	Expects(_offset >= 0 && (_offset % kBlockSize) == 0);
+}
+
+int64 FileWriter::written() const {
+	return _written;
+}
+
+bool FileWriter::writeAt(int64 position, bytes::span bytes) {
+	if (!_file.seek(_offset + position) || !_file.write(bytes)) {
+		_failed = true;
+	}
+	return !_failed;
+}
+
+bool FileWriter::write(bytes::const_span bytes) {
+	if (_failed) {
+		return false;
+	}
+	const auto block = bytes::make_span(_block);
+	if (const auto filled = size_type(_written % kBlockSize)) {
+		const auto count = std::min(
+			kBlockSize - filled,
+			size_type(bytes.size()));
+		bytes::copy(block.subspan(filled), bytes.subspan(0, count));
+		_written += count;
+		bytes = bytes.subspan(count);
+		if (filled + count == kBlockSize
+			&& !writeAt(_written - kBlockSize, block)) {
+			return false;
+		}
+	}
+	while (bytes.size() >= kBlockSize) {
+		// File::write() encrypts in place, so copy through a buffer.
+		const auto count = std::min(
+			size_type(bytes.size()) - (bytes.size() % kBlockSize),
+			kWriterBufferSize);
+		_buffer.resize(count);
+		bytes::copy(_buffer, bytes.subspan(0, count));
+		if (!writeAt(_written, _buffer)) {
+			return false;
+		}
+		_written += count;
+		bytes = bytes.subspan(count);
+	}
+	if (!bytes.empty()) {
+		bytes::copy(block, bytes);
+		_written += bytes.size();
+	}
+	return true;
+}
+
+bool FileWriter::finish() {
+	if (_failed) {
+		return false;
+	}
+	const auto filled = size_type(_written % kBlockSize);
+	if (!filled) {
+		return true;
+	}
+	const auto block = bytes::make_span(_block);
+	bytes::set_random(block.subspan(filled));
+	return writeAt(_written - filled, block);
+}
 
 } // namespace Storage
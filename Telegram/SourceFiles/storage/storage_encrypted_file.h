@@ -11,6 +11,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "storage/storage_encryption.h"
 #include "base/bytes.h"
 #include "base/optional.h"
+#include <crl/crl_time.h>
 
 namespace Storage {
 
@@ -35,6 +36,9 @@ public:
 	size_type readWithPadding(bytes::span bytes);
 	bool writeWithPadding(bytes::span bytes);
 
+	// Decrypts straight from a file mapping, without an intermediate read.
+	size_type readWithPaddingMapped(bytes::span bytes);
+
 	bool flush();
 
 	bool isOpen() const;
@@ -42,6 +46,9 @@ public:
 	int64 offset() const;
 	bool seek(int64 offset);
 
+	// Total time spent in decryption, for mapped reads page faults too.
+	crl::profile_time decryptDuration() const;
+
 	void close();
 
 	static bool Move(const QString &from, const QString &to);
@@ -65,9 +72,64 @@ private:
 	FileLock _lock;
 	int64 _encryptionOffset = 0;
 	int64 _dataSize = 0;
+	crl::profile_time _decryptDuration = 0;
 
 	std::optional<CtrState> _state;
 
 };
 
+// Reads a region of an opened file in windows of any size.
+//
+// Each read seeks to its own position, so several readers may share
+// one file. The region must start at a block boundary, its end may be
+// padded, like the values written by File::writeWithPadding().
+class FileReader {
+public:
+	FileReader(File &file, int64 offset, int64 size);
+
+	int64 size() const;
+	int64 left() const;
+
+	// Returns the count of bytes read, less than requested on failure.
+	size_type read(bytes::span bytes);
+
+private:
+	static constexpr auto kBlockSize = CtrState::kBlockSize;
+
+	bool readBlock();
+
+	File &_file;
+	int64 _offset = 0;
+	int64 _size = 0;
+	int64 _position = 0;
+	bytes::array<kBlockSize> _block = { { bytes::type() } };
+
+};
+
+// Writes a padded region of an opened file from windows of any size.
+class FileWriter {
+public:
+	FileWriter(File &file, int64 offset);
+
+	int64 written() const;
+
+	bool write(bytes::const_span bytes);
+
+	// Pads and writes the last incomplete block, if there is one.
+	bool finish();
+
+private:
+	static constexpr auto kBlockSize = CtrState::kBlockSize;
+
+	bool writeAt(int64 position, bytes::span bytes);
+
+	File &_file;
+	int64 _offset = 0;
+	int64 _written = 0;
+	bytes::array<kBlockSize> _block = { { bytes::type() } };
+	bytes::vector _buffer;
+	bool _failed = false;
+
+};
+
 } // namespace Storage
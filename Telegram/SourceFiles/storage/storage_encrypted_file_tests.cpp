@@ -166,6 +166,139 @@ TEST_CASE("simple encrypted file", "[storage_encrypted_file]") {
 	}
 }
 
+TEST_CASE("mapped encrypted file", "[storage_encrypted_file]") {
+	const auto Test3 = bytes::concatenate(
+		Test1,
+		Test2,
+		bytes::make_span("testbyte").subspan(0, 8));
+
+	SECTION("writing file with padding") {
+		Storage::File file;
+		const auto result = file.open(
+			Name,
+			Storage::File::Mode::Write,
+			Key);
+		REQUIRE(result == Storage::File::Result::Success);
+
+		auto data = Test3;
+		const auto success = file.writeWithPadding(data);
+		REQUIRE(success);
+		REQUIRE(file.size() == 48);
+	}
+	SECTION("reading file through mapping") {
+		Storage::File file;
+		const auto result = file.open(
+			Name,
+			Storage::File::Mode::Read,
+			Key);
+		REQUIRE(result == Storage::File::Result::Success);
+
+		auto data = bytes::vector(Test3.size());
+		const auto read = file.readWithPaddingMapped(data);
+		REQUIRE(read == data.size());
+		REQUIRE(data == Test3);
+		REQUIRE(file.offset() == 48);
+
+		REQUIRE(file.seek(Test1.size()));
+		auto part = bytes::vector(Test2.size());
+		REQUIRE(file.readWithPaddingMapped(part) == part.size());
+		REQUIRE(part == bytes::make_vector(Test2));
+	}
+	SECTION("reading past end through mapping") {
+		Storage::File file;
+		const auto result = file.open(
+			Name,
+			Storage::File::Mode::Read,
+			Key);
+		REQUIRE(result == Storage::File::Result::Success);
+		REQUIRE(file.seek(Test1.size() * 2));
+
+		auto data = bytes::vector(Test3.size());
+		const auto read = file.readWithPaddingMapped(data);
+		REQUIRE(read < data.size());
+	}
+}
+
+TEST_CASE("streaming encrypted file", "[storage_encrypted_file]") {
+	const auto size = size_type(100003);
+	auto original = bytes::vector(size);
+	for (auto i = size_type(0); i != size; ++i) {
+		original[i] = bytes::type(i * 13 + (i >> 8));
+	}
+	const auto all = bytes::make_span(original);
+
+	SECTION("writing file in windows") {
+		Storage::File file;
+		const auto result = file.open(
+			Name,
+			Storage::File::Mode::Write,
+			Key);
+		REQUIRE(result == Storage::File::Result::Success);
+
+		auto prefix = bytes::make_vector(Test1);
+		REQUIRE(file.writeWithPadding(prefix));
+		auto writer = Storage::FileWriter(file, Test1.size());
+		for (auto skip = size_type(0); skip < size; skip += 1000) {
+			const auto window = std::min(size_type(1000), size - skip);
+			REQUIRE(writer.write(all.subspan(skip, window)));
+		}
+		REQUIRE(writer.finish());
+		REQUIRE(writer.written() == size);
+		REQUIRE(file.size() == Test1.size() + size + 16 - (size % 16));
+	}
+	SECTION("reading file in windows") {
+		Storage::File file;
+		const auto result = file.open(
+			Name,
+			Storage::File::Mode::Read,
+			Key);
+		REQUIRE(result == Storage::File::Result::Success);
+
+		auto first = Storage::FileReader(file, Test1.size(), size);
+		auto second = Storage::FileReader(file, Test1.size(), size);
+		auto window = bytes::vector(777);
+		for (auto skip = size_type(0); skip < size; skip += 777) {
+			const auto count = std::min(size_type(777), size - skip);
+			const auto part = all.subspan(skip, count);
+			const auto read = bytes::make_span(window).subspan(0, count);
+			REQUIRE(first.read(window) == count);
+			REQUIRE(bytes::compare(read, part) == 0);
+			REQUIRE(second.read(window) == count);
+			REQUIRE(bytes::compare(read, part) == 0);
+		}
+		REQUIRE(first.left() == 0);
+		REQUIRE(first.read(window) == 0);
+	}
+}
+
+TEST_CASE("large buffer encryption", "[storage_encrypted_file]") {
+	const auto salt = bytes::make_span(Key.data()).subspan(0, 64);
+	const auto size = size_type(8 * 1024 * 1024 + 48);
+	auto original = bytes::vector(size);
+	for (auto i = size_type(0); i != size; ++i) {
+		original[i] = bytes::type(i * 7 + (i >> 10));
+	}
+	const auto part = size_type(1024 * 1024 + 16);
+
+	auto whole = original;
+	auto state = Key.prepareCtrState(salt);
+	state.encrypt(whole, 32);
+
+	auto pieces = original;
+	auto other = Key.prepareCtrState(salt);
+	for (auto skip = size_type(0); skip < size; skip += part) {
+		const auto length = std::min(part, size - skip);
+		const auto piece = bytes::make_span(pieces).subspan(skip, length);
+		other.encrypt(piece, 32 + skip);
+	}
+	REQUIRE(whole == pieces);
+	REQUIRE(whole != original);
+
+	auto decrypted = bytes::vector(size);
+	state.decrypt(whole, decrypted, 32);
+	REQUIRE(decrypted == original);
+}
+
 TEST_CASE("two process encrypted file", "[storage_encrypted_file]") {
 	SECTION("writing file") {
 		Storage::File file;
@@ -8,8 +8,19 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "storage/storage_encryption.h"
 
 #include "base/openssl_help.h"
+#include <crl/crl_async.h>
+#include <crl/crl_semaphore.h>
+#include <atomic>
+#include <thread>
 
 namespace Storage {
+namespace {
+
+// Buffers from this size are encrypted by several threads at once.
+constexpr auto kParallelMinSize = size_type(2 * 1024 * 1024);
+constexpr auto kParallelChunkSize = size_type(512 * 1024);
+
+} // namespace
 
 CtrState::CtrState(bytes::const_span key, bytes::const_span iv) {
 	Expects(key.size() == _key.size());
@@ -19,34 +30,102 @@ CtrState::CtrState(bytes::const_span key, bytes::const_span iv) {
 	bytes::copy(_iv, iv);
 }
 
-template <typename Method>
-void CtrState::process(bytes::span data, int64 offset, Method method) {
-	Expects((data.size() % kBlockSize) == 0);
+void CtrState::process(
+		bytes::const_span from,
+		bytes::span to,
+		int64 offset) {
+	Expects((from.size() % kBlockSize) == 0);
+	Expects(to.size() >= from.size());
 	Expects((offset % kBlockSize) == 0);
 
-	AES_KEY aes;
-	AES_set_encrypt_key(
+	if (from.size() >= kParallelMinSize) {
+		processParallel(from, to, offset);
+	} else if (!from.empty()) {
+		processChunk(from, to, offset);
+	}
+}
+
+void CtrState::processParallel(
+		bytes::const_span from,
+		bytes::span to,
+		int64 offset) {
+	struct State {
+		bytes::const_span from;
+		bytes::span to;
+		int64 offset = 0;
+		int count = 0;
+		std::atomic<int> next = 0;
+		std::atomic<int> left = 0;
+		crl::semaphore finished;
+	};
+	const auto state = std::make_shared<State>();
+	state->from = from;
+	state->to = to;
+	state->offset = offset;
+	state->count = int((from.size() + kParallelChunkSize - 1)
+		/ kParallelChunkSize);
+	state->left = state->count;
+
+	// Chunks are taken by whoever comes first, so the calling thread
+	// never waits for a worker that didn't start yet.
+	const auto work = [=] {
+		while (true) {
+			const auto index = state->next++;
+			if (index >= state->count) {
+				return;
+			}
+			const auto skip = index * kParallelChunkSize;
+			const auto size = std::min(
+				kParallelChunkSize,
+				state->from.size() - skip);
+			processChunk(
+				state->from.subspan(skip, size),
+				state->to.subspan(skip, size),
+				state->offset + skip);
+			if (!--state->left) {
+				state->finished.release();
+			}
+		}
+	};
+	const auto hardware = int(std::thread::hardware_concurrency());
+	const auto workers = std::min(state->count, std::max(hardware, 2)) - 1;
+	for (auto i = 0; i != workers; ++i) {
+		crl::async(work);
+	}
+	work();
+	state->finished.acquire();
+}
+
+void CtrState::processChunk(
+		bytes::const_span from,
+		bytes::span to,
+		int64 offset) const {
+	Expects(from.size() <= std::numeric_limits<int>::max());
+
+	const auto iv = incrementedIv(offset / kBlockSize);
+
+	// EVP uses AES-NI or ARMv8 instructions when available
+	// and encrypts several counter blocks in one pass.
+	const auto context = EVP_CIPHER_CTX_new();
+	Assert(context != nullptr);
+	const auto guard = gsl::finally([&] { EVP_CIPHER_CTX_free(context); });
+	EVP_EncryptInit_ex(
+		context,
+		EVP_aes_256_ctr(),
+		nullptr,
 		reinterpret_cast<const uchar*>(_key.data()),
-		_key.size() * CHAR_BIT,
-		&aes);
-
-	unsigned char ecountBuf[kBlockSize] = { 0 };
-	unsigned int offsetInBlock = 0;
-	const auto blockIndex = offset / kBlockSize;
-	auto iv = incrementedIv(blockIndex);
-
-	CRYPTO_ctr128_encrypt(
-		reinterpret_cast<const uchar*>(data.data()),
-		reinterpret_cast<uchar*>(data.data()),
-		data.size(),
-		&aes,
-		reinterpret_cast<unsigned char*>(iv.data()),
-		ecountBuf,
-		&offsetInBlock,
-		(block128_f)method);
+		reinterpret_cast<const uchar*>(iv.data()));
+	auto written = 0;
+	EVP_EncryptUpdate(
+		context,
+		reinterpret_cast<uchar*>(to.data()),
+		&written,
+		reinterpret_cast<const uchar*>(from.data()),
+		int(from.size()));
+	Ensures(written == from.size());
 }
 
-auto CtrState::incrementedIv(int64 blockIndex)
+auto CtrState::incrementedIv(int64 blockIndex) const
 -> bytes::array<kIvSize> {
 	Expects(blockIndex >= 0);
 
@@ -66,11 +145,18 @@ auto CtrState::incrementedIv(int64 blockIndex)
 }
 
 void CtrState::encrypt(bytes::span data, int64 offset) {
-	return process(data, offset, AES_encrypt);
+	return process(data, data, offset);
 }
 
 void CtrState::decrypt(bytes::span data, int64 offset) {
-	return process(data, offset, AES_encrypt);
+	return process(data, data, offset);
+}
+
+void CtrState::decrypt(
+		bytes::const_span from,
+		bytes::span to,
+		int64 offset) {
+	return process(from, to, offset);
 }
 
 EncryptionKey::EncryptionKey(bytes::vector &&data)
@@ -21,16 +21,23 @@ public:
 
 	CtrState(bytes::const_span key, bytes::const_span iv);
 
+	// Large buffers are split into chunks processed on crl::async workers.
 	void encrypt(bytes::span data, int64 offset);
 	void decrypt(bytes::span data, int64 offset);
+	void decrypt(bytes::const_span from, bytes::span to, int64 offset);
 
 private:
-	template <typename Method>
-	void process(bytes::span data, int64 offset, Method method);
-
-	bytes::array<kIvSize> incrementedIv(int64 blockIndex);
-
-	static constexpr auto EcountSize = kBlockSize;
+	void process(bytes::const_span from, bytes::span to, int64 offset);
+	void processParallel(
+		bytes::const_span from,
+		bytes::span to,
+		int64 offset);
+	void processChunk(
+		bytes::const_span from,
+		bytes::span to,
+		int64 offset) const;
+
+	bytes::array<kIvSize> incrementedIv(int64 blockIndex) const;
 
 	bytes::array<kKeySize> _key;
 	bytes::array<kIvSize> _iv;
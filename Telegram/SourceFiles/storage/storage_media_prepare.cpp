@@ -60,58 +60,64 @@ QSize PrepareShownDimensions(const QImage &preview) {
 		: result;
 }
 
-bool PrepareAlbumMediaIsWaiting(
-		QSemaphore &semaphore,
-		PreparedFile &file,
-		int previewWidth) {
-	// TODO: Use some special thread queue, like a separate QThreadPool.
-	crl::async([=, &semaphore, &file] {
-		const auto guard = gsl::finally([&] { semaphore.release(); });
-		if (!file.path.isEmpty()) {
-			file.mime = Core::MimeTypeForFile(QFileInfo(file.path)).name();
-			file.information = FileLoadTask::ReadMediaInformation(
-				file.path,
-				QByteArray(),
-				file.mime);
-		} else if (!file.content.isEmpty()) {
-			file.mime = Core::MimeTypeForData(file.content).name();
-			file.information = FileLoadTask::ReadMediaInformation(
-				QString(),
-				file.content,
-				file.mime);
-		} else {
-			Assert(file.information != nullptr);
-		}
+// Smooth scaling goes through all the source pixels, so a big photo is
+// first reduced cheaply to twice the preview size.
+QImage PrepareScaledPreview(const QImage &image, int width) {
+	constexpr auto kFastScaleFactor = 2;
+
+	const auto large = (image.width() > width * kFastScaleFactor);
+	const auto reduced = large
+		? image.scaledToWidth(
+			width * kFastScaleFactor,
+			Qt::FastTransformation)
+		: image;
+	return reduced.scaledToWidth(width, Qt::SmoothTransformation);
+}
 
-		using Image = FileMediaInformation::Image;
-		using Video = FileMediaInformation::Video;
-		if (const auto image = base::get_if<Image>(
-				&file.information->media)) {
-			if (ValidPhotoForAlbum(*image, file.mime)) {
-				file.shownDimensions = PrepareShownDimensions(image->data);
-				file.preview = Images::prepareOpaque(image->data.scaledToWidth(
-					std::min(previewWidth, style::ConvertScale(image->data.width()))
-						* cIntRetinaFactor(),
-					Qt::SmoothTransformation));
-				Assert(!file.preview.isNull());
-				file.preview.setDevicePixelRatio(cRetinaFactor());
-				file.type = PreparedFile::AlbumType::Photo;
-			}
-		} else if (const auto video = base::get_if<Video>(
-				&file.information->media)) {
-			if (ValidVideoForAlbum(*video)) {
-				auto blurred = Images::prepareBlur(Images::prepareOpaque(video->thumbnail));
-				file.shownDimensions = PrepareShownDimensions(video->thumbnail);
-				file.preview = std::move(blurred).scaledToWidth(
-					previewWidth * cIntRetinaFactor(),
-					Qt::SmoothTransformation);
-				Assert(!file.preview.isNull());
-				file.preview.setDevicePixelRatio(cRetinaFactor());
-				file.type = PreparedFile::AlbumType::Video;
-			}
+void PrepareDetails(PreparedFile &file, int previewWidth) {
+	if (!file.path.isEmpty()) {
+		file.mime = Core::MimeTypeForFile(QFileInfo(file.path)).name();
+		file.information = FileLoadTask::ReadMediaInformation(
+			file.path,
+			QByteArray(),
+			file.mime);
+	} else if (!file.content.isEmpty()) {
+		file.mime = Core::MimeTypeForData(file.content).name();
+		file.information = FileLoadTask::ReadMediaInformation(
+			QString(),
+			file.content,
+			file.mime);
+	} else {
+		Assert(file.information != nullptr);
+	}
+
+	using Image = FileMediaInformation::Image;
+	using Video = FileMediaInformation::Video;
+	if (const auto image = base::get_if<Image>(
+			&file.information->media)) {
+		if (ValidPhotoForAlbum(*image, file.mime)) {
+			file.shownDimensions = PrepareShownDimensions(image->data);
+			file.preview = Images::prepareOpaque(PrepareScaledPreview(
+				image->data,
+				std::min(previewWidth, style::ConvertScale(image->data.width()))
+					* cIntRetinaFactor()));
+			Assert(!file.preview.isNull());
+			file.preview.setDevicePixelRatio(cRetinaFactor());
+			file.type = PreparedFile::AlbumType::Photo;
+		}
+	} else if (const auto video = base::get_if<Video>(
+			&file.information->media)) {
+		if (ValidVideoForAlbum(*video)) {
+			auto blurred = Images::prepareBlur(Images::prepareOpaque(video->thumbnail));
+			file.shownDimensions = PrepareShownDimensions(video->thumbnail);
+			file.preview = std::move(blurred).scaledToWidth(
+				previewWidth * cIntRetinaFactor(),
+				Qt::SmoothTransformation);
+			Assert(!file.preview.isNull());
+			file.preview.setDevicePixelRatio(cRetinaFactor());
+			file.type = PreparedFile::AlbumType::Video;
 		}
-	});
-	return true;
+	}
 }
 
 void PrepareAlbum(PreparedList &result, int previewWidth) {
@@ -121,22 +127,31 @@ void PrepareAlbum(PreparedList &result, int previewWidth) {
 	}
 
 	result.albumIsPossible = (count > 1);
+
+	// The calling thread prepares the last file instead of just waiting.
 	auto waiting = 0;
 	QSemaphore semaphore;
-	for (auto &file : result.files) {
-		if (PrepareAlbumMediaIsWaiting(semaphore, file, previewWidth)) {
-			++waiting;
-		}
+	for (auto i = 0; i + 1 < count; ++i) {
+		// TODO: Use some special thread queue, like a separate QThreadPool.
+		auto &file = result.files[i];
+		crl::async([=, &semaphore, &file] {
+			const auto guard = gsl::finally([&] { semaphore.release(); });
+			PrepareDetails(file, previewWidth);
+		});
+		++waiting;
+	}
+	if (count > 0) {
+		PrepareDetails(result.files.back(), previewWidth);
 	}
 	if (waiting > 0) {
 		semaphore.acquire(waiting);
-		if (result.albumIsPossible) {
-			const auto badIt = ranges::find(
-				result.files,
-				PreparedFile::AlbumType::None,
-				[](const PreparedFile &file) { return file.type; });
-			result.albumIsPossible = (badIt == result.files.end());
-		}
+	}
+	if (result.albumIsPossible) {
+		const auto badIt = ranges::find(
+			result.files,
+			PreparedFile::AlbumType::None,
+			[](const PreparedFile &file) { return file.type; });
+		result.albumIsPossible = (badIt == result.files.end());
 	}
 }
 
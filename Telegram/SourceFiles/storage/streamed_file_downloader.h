@@ -19,6 +19,9 @@ struct LoadedPart;
 
 namespace Storage {
 
+// Saves a file through a streaming Reader. The parts are taken from the
+// slices in memory first, then from the slices the Reader has put to the
+// big file cache, and only the rest is requested from the cloud.
 class StreamedFileDownloader final : public FileLoader {
 public:
 	StreamedFileDownloader(
@@ -271,19 +271,16 @@ FilesResult ReadFiles(const QString &folder) {
 }
 
 TemplatesIndex ComputeIndex(const TemplatesData &data) {
-	using Id = TemplatesIndex::Id;
-	using Term = TemplatesIndex::Term;
+	using Posting = TemplatesIndex::Posting;
 
-	auto uniqueFirst = std::map<QChar, base::flat_set<Id>>();
-	auto uniqueFull = std::map<Id, base::flat_set<Term>>();
+	auto unique = std::map<QString, base::flat_set<Posting>>();
 	const auto pushString = [&](
-			const Id &id,
+			const TemplatesIndex::Id &id,
 			const QString &string,
 			int weight) {
 		const auto list = TextUtilities::PrepareSearchWords(string);
 		for (const auto &word : list) {
-			uniqueFirst[word[0]].emplace(id);
-			uniqueFull[id].emplace(std::make_pair(word, weight));
+			unique[word].emplace(id, weight);
 		}
 	};
 	for (const auto &[path, file] : data.files) {
@@ -298,11 +295,8 @@ TemplatesIndex ComputeIndex(const TemplatesData &data) {
 	}
 
 	auto result = TemplatesIndex();
-	for (const auto &[ch, unique] : uniqueFirst) {
-		result.first.emplace(ch, unique | ranges::to_vector);
-	}
-	for (const auto &[id, unique] : uniqueFull) {
-		result.full.emplace(id, unique | ranges::to_vector);
+	for (const auto &[term, list] : unique) {
+		result.postings.emplace(term, list | ranges::to_vector);
 	}
 	return result;
 }
@@ -311,37 +305,63 @@ void ReplaceFileIndex(
 		TemplatesIndex &result,
 		TemplatesIndex &&source,
 		const QString &path) {
-	for (auto i = begin(result.full); i != end(result.full);) {
-		if (i->first.first == path) {
-			i = result.full.erase(i);
-		} else {
-			++i;
-		}
-	}
-	for (auto &[id, list] : source.full) {
-		result.full.emplace(id, std::move(list));
-	}
+	using Posting = TemplatesIndex::Posting;
 
-	using Id = TemplatesIndex::Id;
-	for (auto &[ch, list] : result.first) {
-		auto i = ranges::lower_bound(
+	// Postings are sorted by question, so those of one file are together.
+	const auto fileBegin = [&](std::vector<Posting> &list) {
+		return ranges::lower_bound(
 			list,
-			std::make_pair(path, QString()));
-		auto j = std::find_if(i, end(list), [&](const Id &id) {
-			return id.first != path;
+			path,
+			std::less<>(),
+			[](const Posting &posting) { return posting.first.first; });
+	};
+	for (auto i = begin(result.postings); i != end(result.postings);) {
+		auto &list = i->second;
+		const auto from = fileBegin(list);
+		const auto till = std::find_if(from, end(list), [&](
+				const Posting &posting) {
+			return (posting.first.first != path);
 		});
-		list.erase(i, j);
+		list.erase(from, till);
+		if (list.empty()) {
+			i = result.postings.erase(i);
+		} else {
+			++i;
+		}
 	}
-	for (auto &[ch, list] : source.first) {
-		auto &to = result.first[ch];
+	for (auto &[term, list] : source.postings) {
+		auto &to = result.postings[term];
 		to.insert(
-			end(to),
+			fileBegin(to),
 			std::make_move_iterator(begin(list)),
 			std::make_move_iterator(end(list)));
-		ranges::sort(to);
 	}
 }
 
+// Best weight of each question for a word that can be a prefix of terms,
+// doubled if the term is the word itself. Sorted by question descending.
+std::vector<TemplatesIndex::Posting> CollectWeights(
+		const TemplatesIndex &index,
+		const QString &word) {
+	auto result = std::vector<TemplatesIndex::Posting>();
+	const auto &postings = index.postings;
+	for (auto i = postings.lower_bound(word); i != end(postings); ++i) {
+		if (!i->first.startsWith(word)) {
+			break;
+		}
+		const auto multiplier = (i->first == word) ? 2 : 1;
+		for (const auto &[id, weight] : i->second) {
+			result.emplace_back(id, weight * multiplier);
+		}
+	}
+	ranges::sort(result, std::greater<>());
+	const auto sameId = [](const auto &a, const auto &b) {
+		return (a.first == b.first);
+	};
+	result.erase(ranges::unique(result, sameId), end(result));
+	return result;
+}
+
 void MoveKeys(TemplatesFile &to, const TemplatesFile &from) {
 	const auto &existing = from.questions;
 	for (auto &[normalized, question] : to.questions) {
@@ -570,12 +590,10 @@ void Templates::updateRequestFinished(QNetworkReply *reply) {
 		auto result = ReadFromBlob(content);
 		auto one = TemplatesData();
 		one.files.emplace(path, std::move(result.result));
-		auto index = ComputeIndex(one);
 		crl::on_main(weak,[
 			=,
 			one = std::move(one),
-			errors = std::move(result.errors),
-			index = std::move(index)
+			errors = std::move(result.errors)
 		]() mutable {
 			auto &existing = _data.files.at(path);
 			auto &parsed = one.files.at(path);
@@ -665,58 +683,45 @@ auto Templates::matchFromEnd(QString query) const
 Templates::~Templates() = default;
 
 auto Templates::query(const QString &text) const -> std::vector<Question> {
-	const auto words = TextUtilities::PrepareSearchWords(text);
-	const auto questions = [&](const QString &word) {
-		const auto i = _index.first.find(word[0]);
-		return (i == end(_index.first)) ? 0 : i->second.size();
-	};
-	const auto best = ranges::min_element(words, std::less<>(), questions);
-	if (best == std::end(words)) {
-		return {};
-	}
-	const auto narrowed = _index.first.find((*best)[0]);
-	if (narrowed == end(_index.first)) {
+	const auto list = TextUtilities::PrepareSearchWords(text);
+	if (list.isEmpty()) {
 		return {};
 	}
-	using Id = TemplatesIndex::Id;
-	using Term = TemplatesIndex::Term;
-	const auto questionById = [&](const Id &id) {
-		return _data.files.at(id.first).questions.at(id.second);
-	};
 
-	const auto computeWeight = [&](const Id &id) {
-		auto result = 0;
-		const auto full = _index.full.find(id);
-		for (const auto &word : words) {
-			const auto from = ranges::lower_bound(
-				full->second,
-				word,
-				std::less<>(),
-				[](const Term &term) { return term.first; });
-			const auto till = std::find_if(
-				from,
-				end(full->second),
-				[&](const Term &term) {
-					return !term.first.startsWith(word);
-				});
-			const auto weight = std::max_element(
-				from,
-				till,
-				[](const Term &a, const Term &b) {
-					return a.second < b.second;
-				});
-			if (weight == till) {
-				return 0;
+	// Longer words have shorter postings lists, start intersecting them.
+	auto words = std::vector<QString>(list.begin(), list.end());
+	ranges::sort(words, std::greater<>(), [](const QString &word) {
+		return word.size();
+	});
+
+	using Posting = TemplatesIndex::Posting;
+	auto good = CollectWeights(_index, words.front());
+	words.erase(begin(words));
+	for (const auto &word : words) {
+		if (good.empty()) {
+			return {};
+		}
+		const auto weights = CollectWeights(_index, word);
+		auto intersected = std::vector<Posting>();
+		auto i = begin(good);
+		auto j = begin(weights);
+		while (i != end(good) && j != end(weights)) {
+			if (i->first > j->first) {
+				++i;
+			} else if (j->first > i->first) {
+				++j;
+			} else {
+				intersected.emplace_back(
+					std::move(i->first),
+					i->second + j->second);
+				++i;
+				++j;
 			}
-			result += weight->second * (weight->first == word ? 2 : 1);
 		}
-		return result;
-	};
-	using Pair = std::pair<Id, int>;
-	const auto pairById = [&](const Id &id) {
-		return std::make_pair(id, computeWeight(id));
-	};
-	const auto sorter = [](const Pair &a, const Pair &b) {
+		good = std::move(intersected);
+	}
+
+	const auto sorter = [](const Posting &a, const Posting &b) {
 		// weight DESC filename DESC question ASC
 		if (a.second > b.second) {
 			return true;
@@ -730,14 +735,14 @@ auto Templates::query(const QString &text) const -> std::vector<Question> {
 			return (a.first.second < b.first.second);
 		}
 	};
-	const auto good = narrowed->second | ranges::view::transform(
-		pairById
-	) | ranges::view::filter([](const Pair &pair) {
-		return pair.second > 0;
-	}) | ranges::to_vector | ranges::action::stable_sort(sorter);
-	return good | ranges::view::transform([&](const Pair &pair) {
-		return questionById(pair.first);
-	}) | ranges::view::take(kQueryLimit) | ranges::to_vector;
+	const auto count = std::min(int(good.size()), kQueryLimit);
+	std::partial_sort(begin(good), begin(good) + count, end(good), sorter);
+	const auto questionById = [&](const TemplatesIndex::Id &id) {
+		return _data.files.at(id.first).questions.at(id.second);
+	};
+	return good | ranges::view::take(count) | ranges::view::transform(
+		[&](const Posting &pair) { return questionById(pair.first); }
+	) | ranges::to_vector;
 }
 
 } // namespace Support
@@ -36,10 +36,10 @@ struct TemplatesData {
 
 struct TemplatesIndex {
 	using Id = std::pair<QString, QString>; // filename, normalized question
-	using Term = std::pair<QString, int>; // search term, weight
+	using Posting = std::pair<Id, int>; // question, weight
 
-	std::map<QChar, std::vector<Id>> first;
-	std::map<Id, std::vector<Term>> full;
+	// Postings of each search term, sorted by question.
+	std::map<QString, std::vector<Posting>> postings;
 };
 
 } // namespace details
@@ -11,6 +11,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/invoke_queued.h"
 
 #include <QtCore/QPointer>
+#include <QtGui/QGuiApplication>
+#include <QtGui/QScreen>
 
 #include <crl/crl_on_main.h>
 #include <crl/crl.h>
@@ -23,7 +25,6 @@ namespace Ui {
 namespace Animations {
 namespace {
 
-constexpr auto kAnimationTick = crl::time(1000) / 120;
 constexpr auto kIgnoreUpdatesTimeout = crl::time(4);
 
 Manager *ManagerInstance = nullptr;
@@ -75,6 +76,16 @@ Manager::Manager() {
 
 	ManagerInstance = this;
 
+	if (const auto screen = QGuiApplication::primaryScreen()) {
+		_frameClock.setRefreshRate(int(std::round(screen->refreshRate())));
+	}
+	_frameClock.ticks(
+	) | rpl::filter([=] {
+		return base::take(_frameRequested);
+	}) | rpl::start_with_next([=] {
+		update();
+	}, _lifetime);
+
 	crl::on_main_update_requests(
 	) | rpl::filter([=] {
 		return (_lastUpdateTime + kIgnoreUpdatesTimeout < crl::now());
@@ -116,7 +127,7 @@ void Manager::stop(not_null<Basic*> animation) {
 			*i = nullptr;
 		}
 	} else if (empty(_active)) {
-		stopTimer();
+		cancelFrameRequest();
 	}
 }
 
@@ -149,22 +160,22 @@ void Manager::update() {
 }
 
 void Manager::updateQueued() {
-	Expects(_timerId == 0);
+	Expects(!_updateQueued);
 
-	_timerId = -1;
+	_updateQueued = true;
 	InvokeQueued(delayedCallGuard(), [=] {
-		Expects(_timerId < 0);
+		Expects(_updateQueued);
 
-		_timerId = 0;
+		_updateQueued = false;
 		update();
 	});
 }
 
 void Manager::schedule() {
-	if (_scheduled || _timerId < 0) {
+	if (_scheduled || _updateQueued) {
 		return;
 	}
-	stopTimer();
+	cancelFrameRequest();
 
 	_scheduled = true;
 	PostponeCall(delayedCallGuard(), [=] {
@@ -173,10 +184,11 @@ void Manager::schedule() {
 			_forceImmediateUpdate = false;
 			updateQueued();
 		} else {
-			const auto next = _lastUpdateTime + kAnimationTick;
-			const auto now = crl::now();
-			if (now < next) {
-				_timerId = startTimer(next - now, Qt::PreciseTimer);
+			// Lottie and video players show their frames on the same ticks.
+			const auto next = _frameClock.tick(_lastUpdateTime + 1);
+			if (crl::now() < next) {
+				_frameRequested = true;
+				_frameClock.request(next);
 			} else {
 				updateQueued();
 			}
@@ -188,14 +200,8 @@ not_null<const QObject*> Manager::delayedCallGuard() const {
 	return static_cast<const QObject*>(this);
 }
 
-void Manager::stopTimer() {
-	if (_timerId > 0) {
-		killTimer(base::take(_timerId));
-	}
-}
-
-void Manager::timerEvent(QTimerEvent *e) {
-	update();
+void Manager::cancelFrameRequest() {
+	_frameRequested = false;
 }
 
 } // namespace Animations
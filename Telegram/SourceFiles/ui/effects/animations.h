@@ -8,6 +8,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #pragma once
 
 #include "ui/effects/animation_value.h"
+#include "base/frame_clock.h"
 
 #include <crl/crl_time.h>
 #include <rpl/lifetime.h>
@@ -186,18 +187,18 @@ private:
 
 	friend class Basic;
 
-	void timerEvent(QTimerEvent *e) override;
-
 	void start(not_null<Basic*> animation);
 	void stop(not_null<Basic*> animation);
 
 	void schedule();
 	void updateQueued();
-	void stopTimer();
+	void cancelFrameRequest();
 	not_null<const QObject*> delayedCallGuard() const;
 
+	base::FrameClock _frameClock;
 	crl::time _lastUpdateTime = 0;
-	int _timerId = 0;
+	bool _frameRequested = false;
+	bool _updateQueued = false;
 	bool _updating = false;
 	bool _scheduled = false;
 	bool _forceImmediateUpdate = false;
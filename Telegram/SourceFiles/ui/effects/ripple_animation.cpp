@@ -12,6 +12,57 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "ui/ui_utility.h"
 
 namespace Ui {
+namespace {
+
+constexpr auto kMaxCachedMasks = 32;
+constexpr auto kRectMaskRadius = -1;
+constexpr auto kEllipseMaskRadius = -2;
+
+// Widgets create a ripple with the same mask on each press, the prepared
+// masks are shared by the size and the radius of the shape.
+struct CachedMask {
+	QImage image;
+	QPixmap pixmap;
+};
+using CachedMasksMap = base::flat_map<std::tuple<int, int, int>, CachedMask>;
+
+CachedMasksMap &CachedMasks() {
+	// Never destroyed, pixmaps must not outlive the QGuiApplication.
+	static const auto result = new CachedMasksMap();
+	return *result;
+}
+
+QImage CachedMaskImage(
+		QSize size,
+		int radius,
+		FnMut<QImage()> prepare) {
+	auto &masks = CachedMasks();
+	const auto key = std::make_tuple(size.width(), size.height(), radius);
+	const auto i = masks.find(key);
+	if (i != end(masks)) {
+		return i->second.image;
+	} else if (int(masks.size()) >= kMaxCachedMasks) {
+		masks.clear();
+	}
+	auto image = prepare();
+	auto pixmap = PixmapFromImage(QImage(image));
+	return masks.emplace(
+		key,
+		CachedMask{ std::move(image), std::move(pixmap) }
+	).first->second.image;
+}
+
+QPixmap MaskPixmap(QImage &&mask) {
+	const auto cacheKey = mask.cacheKey();
+	for (const auto &[key, cached] : CachedMasks()) {
+		if (cached.image.cacheKey() == cacheKey) {
+			return cached.pixmap;
+		}
+	}
+	return PixmapFromImage(std::move(mask));
+}
+
+} // namespace
 
 class RippleAnimation::Ripple {
 public:
@@ -146,7 +197,7 @@ void RippleAnimation::Ripple::clearCache() {
 
 RippleAnimation::RippleAnimation(const style::RippleAnimation &st, QImage mask, Fn<void()> callback)
 : _st(st)
-, _mask(PixmapFromImage(std::move(mask)))
+, _mask(MaskPixmap(std::move(mask)))
 , _update(callback) {
 }
 
@@ -220,18 +271,24 @@ QImage RippleAnimation::maskByDrawer(QSize size, bool filled, Fn<void(QPainter &
 }
 
 QImage RippleAnimation::rectMask(QSize size) {
-	return maskByDrawer(size, true, Fn<void(QPainter&)>());
+	return CachedMaskImage(size, kRectMaskRadius, [&] {
+		return maskByDrawer(size, true, Fn<void(QPainter&)>());
+	});
 }
 
 QImage RippleAnimation::roundRectMask(QSize size, int radius) {
-	return maskByDrawer(size, false, [size, radius](QPainter &p) {
-		p.drawRoundedRect(0, 0, size.width(), size.height(), radius, radius);
+	return CachedMaskImage(size, radius, [&] {
+		return maskByDrawer(size, false, [size, radius](QPainter &p) {
+			p.drawRoundedRect(0, 0, size.width(), size.height(), radius, radius);
+		});
 	});
 }
 
 QImage RippleAnimation::ellipseMask(QSize size) {
-	return maskByDrawer(size, false, [size](QPainter &p) {
-		p.drawEllipse(0, 0, size.width(), size.height());
+	return CachedMaskImage(size, kEllipseMaskRadius, [&] {
+		return maskByDrawer(size, false, [size](QPainter &p) {
+			p.drawEllipse(0, 0, size.width(), size.height());
+		});
 	});
 }
 
@@ -14,6 +14,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/bytes.h"
 #include "base/openssl_help.h"
 #include "base/parse_helper.h"
+#include "base/memory_usage.h"
 #include "ui/style/style_core.h"
 #include "ui/painter.h"
 #include "ui/ui_utility.h"
@@ -58,6 +59,8 @@ public:
 	bool cached() const;
 	void draw(QPainter &p, EmojiPtr emoji, int x, int y);
 
+	[[nodiscard]] base::memory_usage::Usage memoryUsage() const;
+
 private:
 	void readCache();
 	void generateCache();
@@ -66,7 +69,7 @@ private:
 
 	int _id = 0;
 	int _size = 0;
-	std::vector<QPixmap> _sprites;
+	std::vector<QImage> _sprites;
 	base::binary_guard _generating;
 
 };
@@ -90,6 +93,40 @@ auto TouchbarEmoji = (Instance*)nullptr;
 auto MainEmojiMap = std::map<int, QPixmap>();
 auto OtherEmojiMap = base::flat_map<int, std::map<int, QPixmap>>();
 
+base::memory_usage::Usage ComputeMemoryUsage() {
+	auto result = base::memory_usage::Usage();
+	const auto add = [&](const base::memory_usage::Usage &usage) {
+		result.bytes += usage.bytes;
+		result.count += usage.count;
+	};
+	const auto addPixmap = [&](const QPixmap &pixmap) {
+		add({ int64(pixmap.width()) * pixmap.height() * 4, 1 });
+	};
+	for (const auto instance : { InstanceNormal.get(), InstanceLarge.get() }) {
+		if (instance) {
+			add(instance->memoryUsage());
+		}
+	}
+#if defined Q_OS_MAC && !defined OS_MAC_OLD
+	if (TouchbarInstance) {
+		add(TouchbarInstance->memoryUsage());
+	}
+#endif
+	for (const auto &[index, pixmap] : MainEmojiMap) {
+		addPixmap(pixmap);
+	}
+	for (const auto &[size, map] : OtherEmojiMap) {
+		for (const auto &[index, pixmap] : map) {
+			addPixmap(pixmap);
+		}
+	}
+	return result;
+}
+
+const auto SpritesMemory = base::memory_usage::Provider(
+	"Emoji sprites",
+	ComputeMemoryUsage);
+
 int RowsCount(int index) {
 	if (index + 1 < SpritesCount) {
 		return kImageRowsPerSprite;
@@ -218,61 +255,88 @@ void SaveToFile(int id, const QImage &image, int size, int index) {
 	}
 }
 
-QImage LoadFromFile(int id, int size, int index) {
+// Cache files are mapped, so only the emoji that are painted get loaded.
+QImage MapFromFile(int id, int size, int index) {
 	const auto rows = RowsCount(index);
 	const auto width = kImagesPerRow * size;
 	const auto height = rows * size;
-	const auto fileSize = 4 * sizeof(uint32)
+	const auto headerSize = 4 * sizeof(uint32);
+	const auto fileSize = headerSize
 		+ (width * height * 4)
 		+ openssl::kSha256Size;
-	QFile f(CacheFilePath(size, index));
-	if (!f.exists()
-		|| f.size() != fileSize
-		|| !f.open(QIODevice::ReadOnly)) {
+	auto file = std::make_unique<QFile>(CacheFilePath(size, index));
+	if (!file->exists()
+		|| file->size() != fileSize
+		|| !file->open(QIODevice::ReadOnly)) {
+		return QImage();
+	}
+	const auto mapped = file->map(0, fileSize);
+	if (!mapped) {
 		return QImage();
 	}
-	const auto read = [&](bytes::span data) {
-		return f.read(
-			reinterpret_cast<char*>(data.data()),
-			data.size()
-		) == data.size();
-	};
 	uint32 header[4] = { 0 };
-	if (!read(bytes::make_span(header))
-		|| header[0] != ComputeVersion(id)
+	memcpy(header, mapped, sizeof(header));
+	if (header[0] != ComputeVersion(id)
 		|| header[1] != size
 		|| header[2] != width
 		|| header[3] != height) {
 		return QImage();
 	}
-	auto result = QImage(
+
+	// The image is read-only, changing it (even its device pixel ratio)
+	// would make a full copy.
+	const auto data = static_cast<const uchar*>(mapped + headerSize);
+	return QImage(
+		data,
 		width,
 		height,
-		QImage::Format_ARGB32_Premultiplied);
-	Assert(result.bytesPerLine() == width * 4);
-	const auto data = bytes::make_span(
-		reinterpret_cast<bytes::type*>(result.bits()),
-		width * height * 4);
+		width * 4,
+		QImage::Format_ARGB32_Premultiplied,
+		[](void *file) { delete static_cast<QFile*>(file); },
+		file.release());
+}
+
+// Reads the file by chunks so that the check doesn't map it all.
+bool CheckFileSignature(const QString &path) {
+	auto file = QFile(path);
+	if (!file.open(QIODevice::ReadOnly)
+		|| file.size() <= openssl::kSha256Size) {
+		return false;
+	}
+	constexpr auto kChunkSize = 64 * 1024;
+	auto context = SHA256_CTX();
+	SHA256_Init(&context);
+	auto buffer = bytes::vector(kChunkSize);
+	auto left = file.size() - openssl::kSha256Size;
+	while (left > 0) {
+		const auto chunk = int(std::min(left, qint64(kChunkSize)));
+		const auto read = bytes::make_span(buffer).subspan(0, chunk);
+		if (file.read(reinterpret_cast<char*>(read.data()), chunk)
+			!= chunk) {
+			return false;
+		}
+		SHA256_Update(&context, read.data(), chunk);
+		left -= chunk;
+	}
+	auto computed = bytes::vector(openssl::kSha256Size);
+	SHA256_Final(reinterpret_cast<unsigned char*>(computed.data()), &context);
 	auto signature = bytes::vector(openssl::kSha256Size);
-	if (!read(data)
-		|| !read(signature)
-		//|| (bytes::compare(
-		//	signature,
-		//	openssl::Sha256(bytes::make_span(header), data)) != 0)
-		|| false) {
-		return QImage();
+	return (file.read(
+		reinterpret_cast<char*>(signature.data()),
+		signature.size()) == signature.size())
+		&& !bytes::compare(signature, computed);
+}
+
+QImage LoadFromFile(int id, int size, int index) {
+	auto result = MapFromFile(id, size, index);
+	if (result.isNull()) {
+		return result;
 	}
-	crl::async([=, signature = std::move(signature)] {
+	crl::async([path = CacheFilePath(size, index)] {
 		// This should not happen (invalid signature),
 		// so we delay this check and fix only the next launch.
-		const auto data = bytes::make_span(
-			reinterpret_cast<const bytes::type*>(result.bits()),
-			width * height * 4);
-		const auto result = bytes::compare(
-			signature,
-			openssl::Sha256(bytes::make_span(header), data));
-		if (result != 0) {
-			QFile(CacheFilePath(size, index)).remove();
+		if (!CheckFileSignature(path)) {
+			QFile(path).remove();
 		}
 	});
 	return result;
@@ -769,6 +833,15 @@ Instance::Instance(int size) : _id(Universal->id()), _size(size) {
 	}
 }
 
+base::memory_usage::Usage Instance::memoryUsage() const {
+	auto result = base::memory_usage::Usage();
+	for (const auto &sprite : _sprites) {
+		result.bytes += sprite.byteCount();
+		++result.count;
+	}
+	return result;
+}
+
 bool Instance::cached() const {
 	Expects(Universal != nullptr);
 
@@ -785,10 +858,15 @@ void Instance::draw(QPainter &p, EmojiPtr emoji, int x, int y) {
 		Universal->draw(p, emoji, _size, x, y);
 		return;
 	}
-	p.drawPixmap(
-		QPoint(x, y),
+	const auto size = _size / float64(style::DevicePixelRatio());
+	p.drawImage(
+		QRectF(x, y, size, size),
 		_sprites[sprite],
-		QRect(emoji->column() * _size, emoji->row() * _size, _size, _size));
+		QRectF(
+			emoji->column() * _size,
+			emoji->row() * _size,
+			_size,
+			_size));
 }
 
 void Instance::readCache() {
@@ -821,6 +899,7 @@ void Instance::generateCache() {
 	if (cachePath.isEmpty()) {
 		return;
 	}
+	const auto id = _id;
 	const auto size = _size;
 	const auto index = _sprites.size();
 	crl::async([
@@ -828,9 +907,13 @@ void Instance::generateCache() {
 		universal = Universal,
 		guard = _generating.make_guard()
 	]() mutable {
+		auto image = universal->generate(size, index);
+		if (auto mapped = MapFromFile(id, size, index); !mapped.isNull()) {
+			image = std::move(mapped);
+		}
 		crl::on_main(std::move(guard), [
 			=,
-			image = universal->generate(size, index)
+			image = std::move(image)
 		]() mutable {
 			if (universal != Universal) {
 				return;
@@ -846,8 +929,7 @@ void Instance::generateCache() {
 }
 
 void Instance::pushSprite(QImage &&data) {
-	_sprites.push_back(PixmapFromImage(std::move(data)));
-	_sprites.back().setDevicePixelRatio(style::DevicePixelRatio());
+	_sprites.push_back(std::move(data));
 }
 
 const std::shared_ptr<UniversalImages> &SourceImages() {
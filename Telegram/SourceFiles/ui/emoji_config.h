@@ -139,6 +139,16 @@ inline EmojiPtr Find(const QString &text, int *outLength = nullptr) {
 	return Find(text.constBegin(), text.constEnd(), outLength);
 }
 
+// Finds the first emoji in [start, end), chars that can't start any
+// emoji are skipped by a table lookup without entering the matcher.
+inline EmojiPtr FindNext(
+		const QChar *start,
+		const QChar *end,
+		const QChar **outStart,
+		int *outLength = nullptr) {
+	return internal::FindNext(start, end, outStart, outLength);
+}
+
 QString IdFromOldKey(uint64 oldKey);
 
 inline EmojiPtr FromOldKey(uint64 oldKey) {
@@ -14,15 +14,23 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "data/data_file_origin.h"
 #include "chat_helpers/stickers.h"
 #include "main/main_session.h"
+#include "base/memory_usage.h"
 #include "app.h"
 
+#include <crl/crl_async.h>
+#include <crl/crl_on_main.h>
+
 using namespace Images;
 
 namespace Images {
 namespace {
 
-// After 128 MB of unpacked images we try to clear some memory.
-constexpr auto kMemoryForCache = 128 * 1024 * 1024;
+// Scaled variants of all the images share a separate budget.
+constexpr auto kMemoryForSizesCache = 96 * 1024 * 1024;
+
+// Smooth scaling of large images is done on a worker thread, a fast
+// scaled variant is painted meanwhile.
+constexpr auto kPrepareInBackgroundPixels = 640 * 640;
 
 std::map<QString, std::unique_ptr<Image>> LocalFileImages;
 std::map<QString, std::unique_ptr<Image>> WebUrlImages;
@@ -42,13 +50,223 @@ int64 ComputeUsage(const QImage &image) {
 	return ComputeUsage(image.size());
 }
 
+base::memory_usage::Counter OriginalsMemory("Image originals");
+
 [[nodiscard]] Core::MediaActiveCache<const Image> &ActiveCache() {
 	static auto Instance = Core::MediaActiveCache<const Image>(
-		kMemoryForCache,
+		Core::MediaMemoryPriority::Normal,
 		[](const Image *image) { image->unload(); });
 	return Instance;
 }
 
+// The least recently painted variants of any image are dropped first.
+// Dropping is delayed till the event loop, because the references to
+// the pixmaps returned from Image::pix*() are used while painting.
+class SizesCacheType final {
+public:
+	explicit SizesCacheType(int64 limit);
+
+	[[nodiscard]] const QPixmap *find(
+		not_null<const Image*> image,
+		uint64 key);
+	const QPixmap &insert(
+		not_null<const Image*> image,
+		uint64 key,
+		QPixmap &&pixmap);
+	void remove(not_null<const Image*> image);
+
+	// Replaces the cached variant when the generator finishes.
+	void prepare(
+		not_null<const Image*> image,
+		uint64 key,
+		FnMut<QImage()> generator);
+	[[nodiscard]] bool preparing(
+		not_null<const Image*> image,
+		uint64 key) const;
+
+	[[nodiscard]] const PixmapCacheStats &stats() const;
+
+private:
+	struct Key {
+		const Image *image = nullptr;
+		uint64 key = 0;
+
+		friend inline bool operator==(const Key &a, const Key &b) {
+			return (a.image == b.image) && (a.key == b.key);
+		}
+	};
+	struct KeyHash {
+		size_t operator()(const Key &value) const {
+			return std::hash<const Image*>()(value.image)
+				^ std::hash<uint64>()(value.key);
+		}
+	};
+	struct Entry {
+		QPixmap pixmap;
+		std::list<Key>::iterator position;
+		uint64 preparing = 0;
+	};
+
+	void erase(const Key &key);
+	void check();
+	void prepared(const Key &key, uint64 preparing, QImage &&image);
+
+	std::unordered_map<Key, Entry, KeyHash> _entries;
+	std::unordered_map<const Image*, base::flat_set<uint64>> _keys;
+	std::list<Key> _queue;
+	SingleQueuedInvokation _delayed;
+	int64 _limit = 0;
+	uint64 _preparingId = 0;
+	PixmapCacheStats _stats;
+
+};
+
+SizesCacheType::SizesCacheType(int64 limit)
+: _delayed([=] { check(); })
+, _limit(limit) {
+}
+
+const QPixmap *SizesCacheType::find(
+		not_null<const Image*> image,
+		uint64 key) {
+	const auto i = _entries.find({ image, key });
+	if (i == end(_entries)
+		|| (i->second.preparing && i->second.pixmap.isNull())) {
+		++_stats.misses;
+		return nullptr;
+	}
+	++_stats.hits;
+	_queue.splice(end(_queue), _queue, i->second.position);
+	return &i->second.pixmap;
+}
+
+const QPixmap &SizesCacheType::insert(
+		not_null<const Image*> image,
+		uint64 key,
+		QPixmap &&pixmap) {
+	const auto full = Key{ image, key };
+	erase(full);
+
+	_stats.usage += ComputeUsage(pixmap);
+	++_stats.count;
+	_keys[image].emplace(key);
+	const auto position = _queue.insert(end(_queue), full);
+	auto &result = _entries.emplace(
+		full,
+		Entry{ std::move(pixmap), position }).first->second.pixmap;
+	if (_stats.usage > _limit) {
+		_delayed.call();
+	}
+	return result;
+}
+
+void SizesCacheType::remove(not_null<const Image*> image) {
+	const auto i = _keys.find(image);
+	if (i == end(_keys)) {
+		return;
+	}
+	const auto keys = std::move(i->second);
+	_keys.erase(i);
+	for (const auto key : keys) {
+		erase({ image, key });
+	}
+}
+
+void SizesCacheType::prepare(
+		not_null<const Image*> image,
+		uint64 key,
+		FnMut<QImage()> generator) {
+	const auto full = Key{ image, key };
+	const auto i = _entries.find(full);
+	Assert(i != end(_entries));
+
+	const auto preparing = i->second.preparing = ++_preparingId;
+	++_stats.prepared;
+	crl::async([=, generator = std::move(generator)]() mutable {
+		auto result = generator();
+		crl::on_main([=, result = std::move(result)]() mutable {
+			SizesCache().prepared(full, preparing, std::move(result));
+		});
+	});
+}
+
+bool SizesCacheType::preparing(
+		not_null<const Image*> image,
+		uint64 key) const {
+	const auto i = _entries.find({ image, key });
+	return (i != end(_entries)) && (i->second.preparing != 0);
+}
+
+void SizesCacheType::prepared(
+		const Key &key,
+		uint64 preparing,
+		QImage &&image) {
+	const auto i = _entries.find(key);
+	if (i == end(_entries) || i->second.preparing != preparing) {
+		return;
+	}
+	auto &entry = i->second;
+	_stats.usage -= ComputeUsage(entry.pixmap);
+	entry.pixmap = App::pixmapFromImageInPlace(std::move(image));
+	entry.pixmap.setDevicePixelRatio(cRetinaFactor());
+	entry.preparing = 0;
+	_stats.usage += ComputeUsage(entry.pixmap);
+	if (_stats.usage > _limit) {
+		_delayed.call();
+	}
+	if (Main::Session::Exists()) {
+		Auth().downloaderTaskFinished().notify();
+	}
+}
+
+const PixmapCacheStats &SizesCacheType::stats() const {
+	return _stats;
+}
+
+void SizesCacheType::erase(const Key &key) {
+	const auto i = _entries.find(key);
+	if (i == end(_entries)) {
+		return;
+	}
+	_stats.usage -= ComputeUsage(i->second.pixmap);
+	--_stats.count;
+	_queue.erase(i->second.position);
+	_entries.erase(i);
+
+	const auto j = _keys.find(key.image);
+	if (j != end(_keys)) {
+		j->second.remove(key.key);
+		if (j->second.empty()) {
+			_keys.erase(j);
+		}
+	}
+}
+
+void SizesCacheType::check() {
+	const auto was = _stats.usage;
+	while (_stats.usage > _limit && !_queue.empty()) {
+		erase(_queue.front());
+		++_stats.evicted;
+	}
+	DEBUG_LOG(("Image Info: Dropped %1 bytes of scaled images, "
+		"%2 bytes in %3 pixmaps left, hits: %4, misses: %5."
+		).arg(was - _stats.usage
+		).arg(_stats.usage
+		).arg(_stats.count
+		).arg(_stats.hits
+		).arg(_stats.misses));
+}
+
+[[nodiscard]] SizesCacheType &SizesCache() {
+	static auto Instance = SizesCacheType(kMemoryForSizesCache);
+	return Instance;
+}
+
+const auto SizesMemory = base::memory_usage::Provider("Image pixmaps", [] {
+	const auto &stats = SizesCache().stats();
+	return base::memory_usage::Usage{ stats.usage, stats.count };
+});
+
 uint64 PixKey(int width, int height, Options options) {
 	return static_cast<uint64>(width)
 		| (static_cast<uint64>(height) << 24)
@@ -61,6 +279,10 @@ uint64 SinglePixKey(Options options) {
 
 } // namespace
 
+PixmapCacheStats GetPixmapCacheStats() {
+	return SizesCache().stats();
+}
+
 void ClearRemote() {
 	base::take(StorageImages);
 	base::take(WebUrlImages);
@@ -555,15 +777,43 @@ const QPixmap &Image::pix(
 		h *= cIntRetinaFactor();
 	}
 	auto options = Option::Smooth | Option::None;
-	auto k = PixKey(w, h, options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend()) {
-		auto p = pixNoCache(origin, w, h, options);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	const auto k = PixKey(w, h, options);
+	if (const auto cached = SizesCache().find(this, k)) {
+		return *cached;
+	}
+	return pixPrepared(origin, k, w, h, options);
+}
+
+const QPixmap &Image::pixPrepared(
+		Data::FileOrigin origin,
+		uint64 key,
+		int w,
+		int h,
+		Options options,
+		int outerw,
+		int outerh) const {
+	const auto background = !_data.isNull()
+		&& !isNull()
+		&& (options & Option::Smooth)
+		&& !(options & (Option::Blurred | Option::Colored))
+		&& (_data.width() * _data.height() >= kPrepareInBackgroundPixels);
+	auto p = pixNoCache(
+		origin,
+		w,
+		h,
+		background ? (options & ~Option::Smooth) : options,
+		outerw,
+		outerh);
+	p.setDevicePixelRatio(cRetinaFactor());
+	const auto &result = SizesCache().insert(this, key, std::move(p));
+	if (background) {
+		// Rounding and circles in prepare() use the masks safely, though
+		// colorizing uses caches of the main thread.
+		SizesCache().prepare(this, key, [=, data = _data] {
+			return prepare(data, w, h, options, outerw, outerh);
+		});
 	}
-	return i.value();
+	return result;
 }
 
 const QPixmap &Image::pixRounded(
@@ -594,15 +844,11 @@ const QPixmap &Image::pixRounded(
 	} else if (radius == ImageRoundRadius::Ellipse) {
 		options |= Option::Circled | cornerOptions(corners);
 	}
-	auto k = PixKey(w, h, options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend()) {
-		auto p = pixNoCache(origin, w, h, options);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	const auto k = PixKey(w, h, options);
+	if (const auto cached = SizesCache().find(this, k)) {
+		return *cached;
 	}
-	return i.value();
+	return pixPrepared(origin, k, w, h, options);
 }
 
 const QPixmap &Image::pixCircled(
@@ -618,15 +864,41 @@ const QPixmap &Image::pixCircled(
 		h *= cIntRetinaFactor();
 	}
 	auto options = Option::Smooth | Option::Circled;
-	auto k = PixKey(w, h, options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend()) {
-		auto p = pixNoCache(origin, w, h, options);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	const auto k = PixKey(w, h, options);
+	if (const auto cached = SizesCache().find(this, k)) {
+		return *cached;
 	}
-	return i.value();
+	auto p = pixNoCache(origin, w, h, options);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return SizesCache().insert(this, k, std::move(p));
+}
+
+const QPixmap *Image::pixCircledAsync(
+		Data::FileOrigin origin,
+		int32 w,
+		int32 h) const {
+	checkSource();
+
+	if (_data.isNull() || isNull()) {
+		return &pixCircled(origin, w, h);
+	} else if (w <= 0 || !width() || !height()) {
+		w = width();
+	} else {
+		w *= cIntRetinaFactor();
+		h *= cIntRetinaFactor();
+	}
+	auto options = Option::Smooth | Option::Circled;
+	const auto k = PixKey(w, h, options);
+	if (const auto cached = SizesCache().find(this, k)) {
+		return cached;
+	} else if (SizesCache().preparing(this, k)) {
+		return nullptr;
+	}
+	SizesCache().insert(this, k, QPixmap());
+	SizesCache().prepare(this, k, [=, data = _data] {
+		return prepare(data, w, h, options, -1, -1);
+	});
+	return nullptr;
 }
 
 const QPixmap &Image::pixBlurredCircled(
@@ -642,15 +914,13 @@ const QPixmap &Image::pixBlurredCircled(
 		h *= cIntRetinaFactor();
 	}
 	auto options = Option::Smooth | Option::Circled | Option::Blurred;
-	auto k = PixKey(w, h, options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend()) {
-		auto p = pixNoCache(origin, w, h, options);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	const auto k = PixKey(w, h, options);
+	if (const auto cached = SizesCache().find(this, k)) {
+		return *cached;
 	}
-	return i.value();
+	auto p = pixNoCache(origin, w, h, options);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return SizesCache().insert(this, k, std::move(p));
 }
 
 const QPixmap &Image::pixBlurred(
@@ -666,15 +936,13 @@ const QPixmap &Image::pixBlurred(
 		h *= cIntRetinaFactor();
 	}
 	auto options = Option::Smooth | Option::Blurred;
-	auto k = PixKey(w, h, options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend()) {
-		auto p = pixNoCache(origin, w, h, options);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	const auto k = PixKey(w, h, options);
+	if (const auto cached = SizesCache().find(this, k)) {
+		return *cached;
 	}
-	return i.value();
+	auto p = pixNoCache(origin, w, h, options);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return SizesCache().insert(this, k, std::move(p));
 }
 
 const QPixmap &Image::pixColored(
@@ -691,15 +959,13 @@ const QPixmap &Image::pixColored(
 		h *= cIntRetinaFactor();
 	}
 	auto options = Option::Smooth | Option::Colored;
-	auto k = PixKey(w, h, options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend()) {
-		auto p = pixColoredNoCache(origin, add, w, h, true);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	const auto k = PixKey(w, h, options);
+	if (const auto cached = SizesCache().find(this, k)) {
+		return *cached;
 	}
-	return i.value();
+	auto p = pixColoredNoCache(origin, add, w, h, true);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return SizesCache().insert(this, k, std::move(p));
 }
 
 const QPixmap &Image::pixBlurredColored(
@@ -716,15 +982,13 @@ const QPixmap &Image::pixBlurredColored(
 		h *= cIntRetinaFactor();
 	}
 	auto options = Option::Blurred | Option::Smooth | Option::Colored;
-	auto k = PixKey(w, h, options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend()) {
-		auto p = pixBlurredColoredNoCache(origin, add, w, h);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	const auto k = PixKey(w, h, options);
+	if (const auto cached = SizesCache().find(this, k)) {
+		return *cached;
 	}
-	return i.value();
+	auto p = pixBlurredColoredNoCache(origin, add, w, h);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return SizesCache().insert(this, k, std::move(p));
 }
 
 const QPixmap &Image::pixSingle(
@@ -763,18 +1027,19 @@ const QPixmap &Image::pixSingle(
 		options |= Option::Colored;
 	}
 
-	auto k = SinglePixKey(options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend() || i->width() != (outerw * cIntRetinaFactor()) || i->height() != (outerh * cIntRetinaFactor())) {
-		if (i != _sizesCache.cend()) {
-			ActiveCache().decrement(ComputeUsage(*i));
-		}
-		auto p = pixNoCache(origin, w, h, options, outerw, outerh, colored);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	const auto k = SinglePixKey(options);
+	const auto cached = SizesCache().find(this, k);
+	if (cached
+		&& cached->width() == (outerw * cIntRetinaFactor())
+		&& cached->height() == (outerh * cIntRetinaFactor())) {
+		return *cached;
+	}
+	if (!colored) {
+		return pixPrepared(origin, k, w, h, options, outerw, outerh);
 	}
-	return i.value();
+	auto p = pixNoCache(origin, w, h, options, outerw, outerh, colored);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return SizesCache().insert(this, k, std::move(p));
 }
 
 const QPixmap &Image::pixBlurredSingle(
@@ -809,18 +1074,16 @@ const QPixmap &Image::pixBlurredSingle(
 		options |= Option::Circled | cornerOptions(corners);
 	}
 
-	auto k = SinglePixKey(options);
-	auto i = _sizesCache.constFind(k);
-	if (i == _sizesCache.cend() || i->width() != (outerw * cIntRetinaFactor()) || i->height() != (outerh * cIntRetinaFactor())) {
-		if (i != _sizesCache.cend()) {
-			ActiveCache().decrement(ComputeUsage(*i));
-		}
-		auto p = pixNoCache(origin, w, h, options, outerw, outerh);
-		p.setDevicePixelRatio(cRetinaFactor());
-		i = _sizesCache.insert(k, p);
-		ActiveCache().increment(ComputeUsage(*i));
+	const auto k = SinglePixKey(options);
+	const auto cached = SizesCache().find(this, k);
+	if (cached
+		&& cached->width() == (outerw * cIntRetinaFactor())
+		&& cached->height() == (outerh * cIntRetinaFactor())) {
+		return *cached;
 	}
-	return i.value();
+	auto p = pixNoCache(origin, w, h, options, outerw, outerh);
+	p.setDevicePixelRatio(cRetinaFactor());
+	return SizesCache().insert(this, k, std::move(p));
 }
 
 QPixmap Image::pixNoCache(
@@ -975,6 +1238,7 @@ void Image::checkSource() const {
 		invalidateSizeCache();
 		_data = std::move(data);
 		ActiveCache().increment(ComputeUsage(_data));
+		OriginalsMemory.add(ComputeUsage(_data));
 	}
 
 	ActiveCache().up(this);
@@ -983,7 +1247,10 @@ void Image::checkSource() const {
 void Image::unload() const {
 	_source->unload();
 	invalidateSizeCache();
-	ActiveCache().decrement(ComputeUsage(_data));
+	if (!_data.isNull()) {
+		ActiveCache().decrement(ComputeUsage(_data));
+		OriginalsMemory.remove(ComputeUsage(_data));
+	}
 	_data = QImage();
 }
 
@@ -1002,11 +1269,7 @@ void Image::setImageBytes(const QByteArray &bytes) {
 }
 
 void Image::invalidateSizeCache() const {
-	auto &cache = ActiveCache();
-	for (const auto &image : std::as_const(_sizesCache)) {
-		cache.decrement(ComputeUsage(image));
-	}
-	_sizesCache.clear();
+	SizesCache().remove(this);
 }
 
 Image::~Image() {
@@ -13,9 +13,21 @@ class HistoryItem;
 
 namespace Images {
 
+struct PixmapCacheStats {
+	int64 hits = 0;
+	int64 misses = 0;
+	int64 evicted = 0;
+	int64 prepared = 0;
+	int64 usage = 0;
+	int count = 0;
+};
+
 void ClearRemote();
 void ClearAll();
 
+// Scaled, rounded and blurred variants of all the images.
+[[nodiscard]] PixmapCacheStats GetPixmapCacheStats();
+
 ImagePtr Create(const QString &file, QByteArray format);
 ImagePtr Create(const QString &url, QSize box);
 ImagePtr Create(const QString &url, int width, int height);
@@ -72,6 +84,9 @@ public:
 	virtual float64 progress() = 0;
 	virtual int loadOffset() = 0;
 
+	// Bytes received so far without gaps from the start of the file.
+	virtual QByteArray loadedBytes() = 0;
+
 	virtual const StorageImageLocation &location() = 0;
 	virtual void refreshFileReference(const QByteArray &data) = 0;
 	virtual std::optional<Storage::Cache::Key> cacheKey() = 0;
@@ -148,6 +163,11 @@ public:
 		Data::FileOrigin origin,
 		int32 w = 0,
 		int32 h = 0) const;
+	// Smoothly scales and masks on a worker thread, nullptr until ready.
+	const QPixmap *pixCircledAsync(
+		Data::FileOrigin origin,
+		int32 w,
+		int32 h) const;
 	const QPixmap &pixBlurredCircled(
 		Data::FileOrigin origin,
 		int32 w = 0,
@@ -191,6 +211,9 @@ public:
 	int loadOffset() const {
 		return _source->loadOffset();
 	}
+	QByteArray loadedBytes() const {
+		return _source->loadedBytes();
+	}
 	int width() const {
 		return _source->width();
 	}
@@ -236,8 +259,17 @@ private:
 	void checkSource() const;
 	void invalidateSizeCache() const;
 
+	// Large images are smoothly scaled in the background.
+	const QPixmap &pixPrepared(
+		Data::FileOrigin origin,
+		uint64 key,
+		int w,
+		int h,
+		Images::Options options,
+		int outerw = -1,
+		int outerh = -1) const;
+
 	std::unique_ptr<Images::Source> _source;
-	mutable QMap<uint64, QPixmap> _sizesCache;
 	mutable QImage _data;
 
 };
@@ -11,9 +11,19 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "ui/style/style_core.h"
 #include "ui/painter.h"
 #include "base/flat_map.h"
+#include "base/build_config.h"
 #include "styles/palette.h"
 #include "styles/style_basic.h"
 
+#include <QtGui/QImageReader>
+#include <QtCore/QMutex>
+#include <crl/crl_async.h>
+#include <crl/crl_on_main.h>
+
+#ifdef ARCH_CPU_X86_FAMILY
+#include <emmintrin.h>
+#endif // ARCH_CPU_X86_FAMILY
+
 namespace Images {
 namespace {
 
@@ -21,11 +31,160 @@ TG_FORCE_INLINE uint64 blurGetColors(const uchar *p) {
 	return (uint64)p[0] + ((uint64)p[1] << 16) + ((uint64)p[2] << 32) + ((uint64)p[3] << 48);
 }
 
-const QImage &circleMask(QSize size) {
+// Each pass of prepareBlur() is a triangle filter with kBlurRadius,
+// the weights sum up to 16. The four channels of a pixel are summed as
+// 16-bit fields of an uint64, the horizontal pass result is stored in
+// the same layout, so the vector versions give the exact same result.
+constexpr auto kBlurRadius = 3;
+constexpr auto kBlurR1 = kBlurRadius + 1;
+constexpr auto kBlurCenterWeight = (kBlurR1 * (kBlurR1 + 1)) >> 1;
+
+void BlurRow(const uchar *pix, uint64 *rgb, int w, int y) {
+	const auto row = pix + y * w * 4;
+	const auto out = rgb + y * w;
+	const auto get = [&](int x) {
+		return blurGetColors(row + x * 4);
+	};
+	auto cur = get(0);
+	auto rgballsum = uint64(-kBlurRadius) * cur;
+	auto rgbsum = cur * kBlurCenterWeight;
+	for (auto i = 1; i <= kBlurRadius; ++i) {
+		cur = get(i);
+		rgbsum += cur * (kBlurR1 - i);
+		rgballsum += cur;
+	}
+	for (auto x = 0; x != w; ++x) {
+		out[x] = (rgbsum >> 4) & 0x00FF00FF00FF00FFLL;
+		rgballsum += get(std::max(x - kBlurR1, 0))
+			- 2 * get(x)
+			+ get(std::min(x + kBlurR1, w - 1));
+		rgbsum += rgballsum;
+	}
+}
+
+void BlurColumn(uchar *pix, const uint64 *rgb, int w, int h, int x) {
+	const auto get = [&](int y) {
+		return rgb[y * w + x];
+	};
+	auto rgballsum = uint64(-kBlurRadius) * get(0);
+	auto rgbsum = get(0) * kBlurCenterWeight;
+	for (auto i = 1; i <= kBlurRadius; ++i) {
+		rgbsum += get(i) * (kBlurR1 - i);
+		rgballsum += get(i);
+	}
+	for (auto y = 0; y != h; ++y) {
+		const auto res = rgbsum >> 4;
+		const auto to = pix + (y * w + x) * 4;
+		to[0] = res & 0xFF;
+		to[1] = (res >> 16) & 0xFF;
+		to[2] = (res >> 32) & 0xFF;
+		to[3] = (res >> 48) & 0xFF;
+		rgballsum += get(std::max(y - kBlurR1, 0))
+			- 2 * get(y)
+			+ get(std::min(y + kBlurR1, h - 1));
+		rgbsum += rgballsum;
+	}
+}
+
+#ifdef ARCH_CPU_X86_FAMILY
+
+// Sums of two pixels in eight 16-bit lanes, wrapping the same way.
+TG_FORCE_INLINE __m128i BlurStep(
+		__m128i &rgballsum,
+		__m128i &rgbsum,
+		__m128i start,
+		__m128i middle,
+		__m128i end) {
+	const auto result = _mm_srli_epi16(rgbsum, 4);
+	rgballsum = _mm_add_epi16(
+		rgballsum,
+		_mm_sub_epi16(
+			_mm_add_epi16(start, end),
+			_mm_slli_epi16(middle, 1)));
+	rgbsum = _mm_add_epi16(rgbsum, rgballsum);
+	return result;
+}
+
+template <typename Get>
+TG_FORCE_INLINE void BlurStart(
+		__m128i &rgballsum,
+		__m128i &rgbsum,
+		Get &&get) {
+	const auto first = get(0);
+	rgballsum = _mm_mullo_epi16(first, _mm_set1_epi16(-kBlurRadius));
+	rgbsum = _mm_mullo_epi16(first, _mm_set1_epi16(kBlurCenterWeight));
+	for (auto i = 1; i <= kBlurRadius; ++i) {
+		const auto cur = get(i);
+		rgbsum = _mm_add_epi16(
+			rgbsum,
+			_mm_mullo_epi16(cur, _mm_set1_epi16(kBlurR1 - i)));
+		rgballsum = _mm_add_epi16(rgballsum, cur);
+	}
+}
+
+// Rows y and y + 1 at once, one in each half of the register.
+void BlurRowPair(const uchar *pix, uint64 *rgb, int w, int y) {
+	const auto row0 = reinterpret_cast<const int*>(pix + y * w * 4);
+	const auto row1 = row0 + w;
+	const auto out0 = rgb + y * w;
+	const auto out1 = out0 + w;
+	const auto zero = _mm_setzero_si128();
+	const auto get = [&](int x) {
+		return _mm_unpacklo_epi8(
+			_mm_unpacklo_epi32(
+				_mm_cvtsi32_si128(row0[x]),
+				_mm_cvtsi32_si128(row1[x])),
+			zero);
+	};
+	auto rgballsum = __m128i();
+	auto rgbsum = __m128i();
+	BlurStart(rgballsum, rgbsum, get);
+	for (auto x = 0; x != w; ++x) {
+		const auto result = BlurStep(
+			rgballsum,
+			rgbsum,
+			get(std::max(x - kBlurR1, 0)),
+			get(x),
+			get(std::min(x + kBlurR1, w - 1)));
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(out0 + x), result);
+		_mm_storel_epi64(
+			reinterpret_cast<__m128i*>(out1 + x),
+			_mm_unpackhi_epi64(result, result));
+	}
+}
+
+// Columns x and x + 1 at once, they're stored next to each other.
+void BlurColumnPair(uchar *pix, const uint64 *rgb, int w, int h, int x) {
+	const auto get = [&](int y) {
+		return _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(rgb + y * w + x));
+	};
+	auto rgballsum = __m128i();
+	auto rgbsum = __m128i();
+	BlurStart(rgballsum, rgbsum, get);
+	for (auto y = 0; y != h; ++y) {
+		const auto result = BlurStep(
+			rgballsum,
+			rgbsum,
+			get(std::max(y - kBlurR1, 0)),
+			get(y),
+			get(std::min(y + kBlurR1, h - 1)));
+		_mm_storel_epi64(
+			reinterpret_cast<__m128i*>(pix + (y * w + x) * 4),
+			_mm_packus_epi16(result, result));
+	}
+}
+
+#endif // ARCH_CPU_X86_FAMILY
+
+// Circles are prepared on worker threads as well, the masks are shared.
+QImage circleMask(QSize size) {
 	uint64 key = (uint64(uint32(size.width())) << 32)
 		| uint64(uint32(size.height()));
 
+	static QMutex mutex;
 	static auto masks = base::flat_map<uint64, QImage>();
+	QMutexLocker lock(&mutex);
 	const auto i = masks.find(key);
 	if (i != end(masks)) {
 		return i->second;
@@ -111,12 +270,10 @@ QImage prepareBlur(QImage img) {
 
 	uchar *pix = img.bits();
 	if (pix) {
-		int w = img.width(), h = img.height(), wold = w, hold = h;
-		const int radius = 3;
-		const int r1 = radius + 1;
+		int w = img.width(), h = img.height();
+		const int radius = kBlurRadius;
 		const int div = radius * 2 + 1;
-		const int stride = w * 4;
-		if (radius < 16 && div < w && div < h && stride <= w * 4) {
+		if (div < w && div < h && img.bytesPerLine() == w * 4) {
 			bool withalpha = img.hasAlphaChannel();
 			if (withalpha) {
 				QImage imgsmall(w, h, img.format());
@@ -137,88 +294,41 @@ QImage prepareBlur(QImage img) {
 				pix = img.bits();
 				if (!pix) return was;
 			}
-			uint64 *rgb = new uint64[w * h];
-
-			int x, y, i;
+			auto rgb = std::vector<uint64>(w * h);
 
-			int yw = 0;
-			const int we = w - r1;
-			for (y = 0; y < h; y++) {
-				uint64 cur = blurGetColors(&pix[yw]);
-				uint64 rgballsum = -radius * cur;
-				uint64 rgbsum = cur * ((r1 * (r1 + 1)) >> 1);
-
-				for (i = 1; i <= radius; i++) {
-					uint64 cur = blurGetColors(&pix[yw + i * 4]);
-					rgbsum += cur * (r1 - i);
-					rgballsum += cur;
-				}
-
-				x = 0;
-
-#define update(start, middle, end) \
-rgb[y * w + x] = (rgbsum >> 4) & 0x00FF00FF00FF00FFLL; \
-rgballsum += blurGetColors(&pix[yw + (start) * 4]) - 2 * blurGetColors(&pix[yw + (middle) * 4]) + blurGetColors(&pix[yw + (end) * 4]); \
-rgbsum += rgballsum; \
-x++;
-
-				while (x < r1) {
-					update(0, x, x + r1);
-				}
-				while (x < we) {
-					update(x - r1, x, x + r1);
-				}
-				while (x < w) {
-					update(x - r1, x, w - 1);
-				}
-
-#undef update
-
-				yw += stride;
+			auto y = 0;
+#ifdef ARCH_CPU_X86_FAMILY
+			for (; y + 1 < h; y += 2) {
+				BlurRowPair(pix, rgb.data(), w, y);
 			}
-
-			const int he = h - r1;
-			for (x = 0; x < w; x++) {
-				uint64 rgballsum = -radius * rgb[x];
-				uint64 rgbsum = rgb[x] * ((r1 * (r1 + 1)) >> 1);
-				for (i = 1; i <= radius; i++) {
-					rgbsum += rgb[i * w + x] * (r1 - i);
-					rgballsum += rgb[i * w + x];
-				}
-
-				y = 0;
-				int yi = x * 4;
-
-#define update(start, middle, end) \
-uint64 res = rgbsum >> 4; \
-pix[yi] = res & 0xFF; \
-pix[yi + 1] = (res >> 16) & 0xFF; \
-pix[yi + 2] = (res >> 32) & 0xFF; \
-pix[yi + 3] = (res >> 48) & 0xFF; \
-rgballsum += rgb[x + (start) * w] - 2 * rgb[x + (middle) * w] + rgb[x + (end) * w]; \
-rgbsum += rgballsum; \
-y++; \
-yi += stride;
-
-				while (y < r1) {
-					update(0, y, y + r1);
-				}
-				while (y < he) {
-					update(y - r1, y, y + r1);
-				}
-				while (y < h) {
-					update(y - r1, y, h - 1);
-				}
-
-#undef update
+#endif // ARCH_CPU_X86_FAMILY
+			for (; y < h; ++y) {
+				BlurRow(pix, rgb.data(), w, y);
 			}
 
-			delete[] rgb;
+			auto x = 0;
+#ifdef ARCH_CPU_X86_FAMILY
+			for (; x + 1 < w; x += 2) {
+				BlurColumnPair(pix, rgb.data(), w, h, x);
+			}
+#endif // ARCH_CPU_X86_FAMILY
+			for (; x < w; ++x) {
+				BlurColumn(pix, rgb.data(), w, h, x);
+			}
 		}
 	}
 	return img;
 }
 
+void PrepareBlurAsync(QImage image, Fn<void(QImage)> done) {
+	crl::async([image = std::move(image), done = std::move(done)]() mutable {
+		auto result = prepareBlur(std::move(image));
+		crl::on_main([done, result = std::move(result)]() mutable {
+			done(std::move(result));
+		});
+	});
+}
+
 QImage BlurLargeImage(QImage image, int radius) {
 	const auto width = image.width();
 	const auto height = image.height();
@@ -434,6 +544,34 @@ QImage BlurLargeImage(QImage image, int radius) {
 	return image;
 }
 
+QSize PrepareReaderForSize(QImageReader &reader, int size) {
+	const auto full = reader.size();
+	if (!full.isValid() || size <= 0) {
+		return full;
+	}
+	const auto format = reader.format().toLower();
+	if (format == "jpeg" || format == "jpg") {
+		// libjpeg rounds the reduced dimensions up.
+		const auto larger = std::max(full.width(), full.height());
+		auto factor = 1;
+		while (factor < 8 && larger / (factor * 2) >= size) {
+			factor *= 2;
+		}
+		if (factor > 1) {
+			reader.setScaledSize(QSize(
+				(full.width() + factor - 1) / factor,
+				(full.height() + factor - 1) / factor));
+		}
+	}
+#ifndef OS_MAC_OLD
+	if (reader.autoTransform()
+		&& (reader.transformation() & QImageIOHandler::TransformationRotate90)) {
+		return full.transposed();
+	}
+#endif // OS_MAC_OLD
+	return full;
+}
+
 void prepareCircle(QImage &img) {
 	Assert(!img.isNull());
 
@@ -11,6 +11,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "ui/rect_part.h"
 #include "ui/style/style_core.h"
 
+class QImageReader;
+
 namespace Storage {
 namespace Cache {
 struct Key;
@@ -28,6 +30,11 @@ namespace Images {
 
 [[nodiscard]] QPixmap PixmapFast(QImage &&image);
 [[nodiscard]] QImage BlurLargeImage(QImage image, int radius);
+
+// Lets the JPEG decoder reduce the image 2, 4 or 8 times with DCT scaling
+// while it still covers a square of the given size. Returns the full
+// image size (with the orientation from the metadata applied).
+QSize PrepareReaderForSize(QImageReader &reader, int size);
 [[nodiscard]] const std::array<QImage, 4> &CornersMask(
 	ImageRoundRadius radius);
 [[nodiscard]] std::array<QImage, 4> PrepareCorners(
@@ -35,6 +42,9 @@ namespace Images {
 	const style::color &color);
 
 QImage prepareBlur(QImage image);
+
+// Blurs on a background thread, done() is called on the main thread.
+void PrepareBlurAsync(QImage image, Fn<void(QImage)> done);
 void prepareRound(
 	QImage &image,
 	ImageRoundRadius radius,
@@ -83,6 +83,10 @@ int ImageSource::loadOffset() {
 	return 0;
 }
 
+QByteArray ImageSource::loadedBytes() {
+	return QByteArray();
+}
+
 const StorageImageLocation &ImageSource::location() {
 	return StorageImageLocation::Invalid();
 }
@@ -212,6 +216,10 @@ int LocalFileSource::loadOffset() {
 	return 0;
 }
 
+QByteArray LocalFileSource::loadedBytes() {
+	return QByteArray();
+}
+
 const StorageImageLocation &LocalFileSource::location() {
 	return StorageImageLocation::Invalid();
 }
@@ -416,6 +424,10 @@ int RemoteSource::loadOffset() {
 	return _loader ? _loader->currentOffset() : 0;
 }
 
+QByteArray RemoteSource::loadedBytes() {
+	return _loader ? _loader->readyBytes() : QByteArray();
+}
+
 RemoteSource::~RemoteSource() {
 	unload();
 }
@@ -30,6 +30,7 @@ public:
 	void cancel() override;
 	float64 progress() override;
 	int loadOffset() override;
+	QByteArray loadedBytes() override;
 
 	const StorageImageLocation &location() override;
 	void refreshFileReference(const QByteArray &data) override;
@@ -79,6 +80,7 @@ public:
 	void cancel() override;
 	float64 progress() override;
 	int loadOffset() override;
+	QByteArray loadedBytes() override;
 
 	const StorageImageLocation &location() override;
 	void refreshFileReference(const QByteArray &data) override;
@@ -125,6 +127,7 @@ public:
 	void cancel() override;
 	float64 progress() override;
 	int loadOffset() override;
+	QByteArray loadedBytes() override;
 
 	const StorageImageLocation &location() override;
 	void refreshFileReference(const QByteArray &data) override;
@@ -178,6 +178,27 @@ FontData::FontData(int size, uint32 flags, int family, Font *other)
 	elidew = width("...");
 }
 
+int32 FontData::width(const QStringRef &str) const {
+	// QFontMetrics accepts only a QString, so wrap the characters of the
+	// source string instead of copying them.
+	return m.width(QString::fromRawData(str.unicode(), str.size()));
+}
+
+int32 FontData::width(QChar ch) const {
+	const auto code = ch.unicode();
+	if (code >= kCachedAdvances) {
+		return m.width(ch);
+	} else if (!_advances) {
+		_advances = std::make_unique<std::array<int16, kCachedAdvances>>();
+		_advances->fill(-1);
+	}
+	auto &result = (*_advances)[code];
+	if (result < 0) {
+		result = m.width(ch);
+	}
+	return result;
+}
+
 Font FontData::bold(bool set) const {
 	return otherFlagsFont(FontBold, set);
 }
@@ -12,6 +12,9 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <QtGui/QFont>
 #include <QtGui/QFontMetrics>
 
+#include <array>
+#include <memory>
+
 namespace style {
 namespace internal {
 
@@ -76,11 +79,10 @@ public:
 		return m.width(str);
 	}
 	int32 width(const QString &str, int32 from, int32 to) const {
-		return width(str.mid(from, to));
-	}
-	int32 width(QChar ch) const {
-		return m.width(ch);
+		return width(str.midRef(from, to));
 	}
+	int32 width(const QStringRef &str) const;
+	int32 width(QChar ch) const;
 	QString elided(const QString &str, int32 width, Qt::TextElideMode mode = Qt::ElideRight) const {
 		return m.elidedText(str, mode, width);
 	}
@@ -99,7 +101,11 @@ public:
 	int32 height, ascent, descent, spacew, elidew;
 
 private:
+	// Latin, Greek and Cyrillic.
+	static constexpr auto kCachedAdvances = 0x0500;
+
 	mutable Font modified[FontDifferentFlags];
+	mutable std::unique_ptr<std::array<int16, kCachedAdvances>> _advances;
 
 	Font otherFlagsFont(uint32 flag, bool set) const;
 	FontData(int size, uint32 flags, int family, Font *other);
@@ -16,13 +16,23 @@ namespace style {
 namespace internal {
 namespace {
 
+// Pixmaps colorized in the last palettes are kept until the palette
+// changes that many times, so that switching back is instant.
+constexpr auto kKeepPalettesCount = 2;
+
+struct CachedPixmap {
+	QPixmap pixmap;
+	int generation = 0;
+};
+
 uint32 colorKey(QColor c) {
 	return (((((uint32(c.red()) << 8) | uint32(c.green())) << 8) | uint32(c.blue())) << 8) | uint32(c.alpha());
 }
 
 QMap<const IconMask*, QImage> iconMasks;
-QMap<QPair<const IconMask*, uint32>, QPixmap> iconPixmaps;
+QMap<QPair<const IconMask*, uint32>, CachedPixmap> iconPixmaps;
 OrderedSet<IconData*> iconData;
+int paletteGeneration = 0;
 
 QImage createIconMask(const IconMask *mask, int scale) {
 	auto maskImage = QImage::fromData(mask->data(), mask->size(), "PNG");
@@ -85,6 +95,28 @@ QSize readGeneratedSize(const IconMask *mask, int scale) {
 	return QSize();
 }
 
+const QImage &cachedIconMask(const IconMask *mask) {
+	auto i = iconMasks.constFind(mask);
+	if (i == iconMasks.cend()) {
+		i = iconMasks.insert(mask, createIconMask(mask, Scale()));
+	}
+	return i.value();
+}
+
+const QPixmap &cachedIconPixmap(
+		const IconMask *mask,
+		const QImage &maskImage,
+		QColor color) {
+	const auto key = qMakePair(mask, colorKey(color));
+	auto i = iconPixmaps.find(key);
+	if (i == iconPixmaps.end()) {
+		auto image = colorizeImage(maskImage, color);
+		i = iconPixmaps.insert(key, { QPixmap::fromImage(std::move(image)) });
+	}
+	i->generation = paletteGeneration;
+	return i->pixmap;
+}
+
 } // namespace
 
 MonoIcon::MonoIcon(const IconMask *mask, Color color, QPoint offset)
@@ -173,7 +205,7 @@ void MonoIcon::paint(
 	auto size = readGeneratedSize(_mask, Scale());
 	auto maskImage = QImage();
 	if (size.isEmpty()) {
-		maskImage = createIconMask(_mask, Scale());
+		maskImage = cachedIconMask(_mask);
 		size = maskImage.size() / DevicePixelRatio();
 	}
 
@@ -184,11 +216,10 @@ void MonoIcon::paint(
 	const auto partPosY = fullOffset.y();
 
 	if (!maskImage.isNull()) {
-		auto colorizedImage = QImage(
-			maskImage.size(),
-			QImage::Format_ARGB32_Premultiplied);
-		colorizeImage(maskImage, _color[paletteOverride]->c, &colorizedImage);
-		p.drawImage(partPosX, partPosY, colorizedImage);
+		p.drawPixmap(partPosX, partPosY, cachedIconPixmap(
+			_mask,
+			maskImage,
+			_color[paletteOverride]->c));
 	} else {
 		p.fillRect(partPosX, partPosY, w, h, _color[paletteOverride]);
 	}
@@ -201,15 +232,15 @@ void MonoIcon::fill(
 	auto size = readGeneratedSize(_mask, Scale());
 	auto maskImage = QImage();
 	if (size.isEmpty()) {
-		maskImage = createIconMask(_mask, Scale());
+		maskImage = cachedIconMask(_mask);
 		size = maskImage.size() / DevicePixelRatio();
 	}
 	if (!maskImage.isNull()) {
-		auto colorizedImage = QImage(
-			maskImage.size(),
-			QImage::Format_ARGB32_Premultiplied);
-		colorizeImage(maskImage, _color[paletteOverride]->c, &colorizedImage);
-		p.drawImage(rect, colorizedImage, colorizedImage.rect());
+		const auto &pixmap = cachedIconPixmap(
+			_mask,
+			maskImage,
+			_color[paletteOverride]->c);
+		p.drawPixmap(rect, pixmap, pixmap.rect());
 	} else {
 		p.fillRect(rect, _color[paletteOverride]);
 	}
@@ -234,7 +265,9 @@ QImage MonoIcon::instance(QColor colorOverride, int scale) const {
 		result.fill(colorOverride);
 		return result;
 	}
-	auto mask = createIconMask(_mask, scale);
+	auto mask = (scale == Scale())
+		? cachedIconMask(_mask)
+		: createIconMask(_mask, scale);
 	auto result = QImage(mask.size(), QImage::Format_ARGB32_Premultiplied);
 	result.setDevicePixelRatio(DevicePixelRatio());
 	colorizeImage(mask, colorOverride, &result);
@@ -252,11 +285,7 @@ void MonoIcon::ensureLoaded() const {
 
 	_size = readGeneratedSize(_mask, Scale());
 	if (_size.isEmpty()) {
-		auto i = iconMasks.constFind(_mask);
-		if (i == iconMasks.cend()) {
-			i = iconMasks.insert(_mask, createIconMask(_mask, Scale()));
-		}
-		_maskImage = i.value();
+		_maskImage = cachedIconMask(_mask);
 
 		createCachedPixmap();
 	}
@@ -268,13 +297,7 @@ void MonoIcon::ensureColorizedImage(QColor color) const {
 }
 
 void MonoIcon::createCachedPixmap() const {
-	auto key = qMakePair(_mask, colorKey(_color->c));
-	auto j = iconPixmaps.constFind(key);
-	if (j == iconPixmaps.cend()) {
-		auto image = colorizeImage(_maskImage, _color);
-		j = iconPixmaps.insert(key, QPixmap::fromImage(std::move(image)));
-	}
-	_pixmap = j.value();
+	_pixmap = cachedIconPixmap(_mask, _maskImage, _color->c);
 	_size = _pixmap.size() / DevicePixelRatio();
 }
 
@@ -332,7 +355,15 @@ int IconData::height() const {
 }
 
 void resetIcons() {
-	iconPixmaps.clear();
+	// Icons with colors that didn't change get the same pixmaps back.
+	const auto keepFrom = ++paletteGeneration - kKeepPalettesCount;
+	for (auto i = iconPixmaps.begin(); i != iconPixmaps.end();) {
+		if (i->generation < keepFrom) {
+			i = iconPixmaps.erase(i);
+		} else {
+			++i;
+		}
+	}
 	for (const auto data : iconData) {
 		data->reset();
 	}
@@ -22,6 +22,101 @@ namespace Text {
 namespace {
 
 constexpr auto kStringLinkIndexShift = uint16(0x8000);
+constexpr auto kShapedLinesBudget = 8 * 1024 * 1024;
+
+// Rough memory taken by the glyphs, clusters and item analysis per char.
+constexpr auto kShapedLineCharBytes = 64;
+
+struct ShapedLineKey {
+	uint64 text = 0;
+	const style::TextStyle *st = nullptr;
+	int from = 0;
+	int till = 0;
+	int lineStart = 0;
+	int lineLength = 0;
+	Qt::LayoutDirection direction = Qt::LayoutDirectionAuto;
+
+	inline bool operator<(const ShapedLineKey &other) const {
+		return std::tie(text, st, from, till, lineStart, lineLength, direction)
+			< std::tie(
+				other.text,
+				other.st,
+				other.from,
+				other.till,
+				other.lineStart,
+				other.lineLength,
+				other.direction);
+	}
+};
+
+// Itemized and shaped lines of the painted texts, so that repainting
+// a text that didn't change doesn't run the shaper for it again.
+class ShapedLines final {
+public:
+	[[nodiscard]] QTextEngine *find(const ShapedLineKey &key) {
+		const auto i = _entries.find(key);
+		if (i == end(_entries)) {
+			return nullptr;
+		}
+		i->second.used = ++_used;
+		return i->second.engine.get();
+	}
+	void insert(
+			const ShapedLineKey &key,
+			std::unique_ptr<QTextEngine> engine,
+			int bytes) {
+		auto &entry = _entries[key];
+		_bytes += bytes - entry.bytes;
+		entry = Entry{ std::move(engine), bytes, ++_used };
+		shrinkToBudget();
+	}
+
+private:
+	struct Entry {
+		std::unique_ptr<QTextEngine> engine;
+		int bytes = 0;
+		uint64 used = 0;
+	};
+
+	void shrinkToBudget() {
+		if (_bytes <= kShapedLinesBudget) {
+			return;
+		}
+		// Drop the older half at once, sorting on every insert is too slow.
+		auto used = std::vector<uint64>();
+		used.reserve(_entries.size());
+		for (const auto &[key, entry] : _entries) {
+			used.push_back(entry.used);
+		}
+		const auto middle = begin(used) + used.size() / 2;
+		std::nth_element(begin(used), middle, end(used));
+		const auto border = *middle;
+		for (auto i = begin(_entries); i != end(_entries);) {
+			if (i->second.used < border) {
+				_bytes -= i->second.bytes;
+				i = _entries.erase(i);
+			} else {
+				++i;
+			}
+		}
+	}
+
+	base::flat_map<ShapedLineKey, Entry> _entries;
+	int64 _bytes = 0;
+	uint64 _used = 0;
+
+};
+
+ShapedLines &ShapedLinesCache() {
+	// Never destroyed: the engines reference fonts that are gone at exit.
+	static const auto result = new ShapedLines();
+	return *result;
+}
+
+uint64 NextShapingKey() {
+	static auto result = uint64(0);
+	return ++result;
+}
 
 Qt::LayoutDirection StringDirection(const QString &str, int32 from, int32 to) {
 	const ushort *p = reinterpret_cast<const ushort*>(str.unicode()) + from;
@@ -1507,16 +1602,55 @@ private:
 		if (!elidedLine) initParagraphBidi(); // if was not inited
 
 		_f = _t->_st->font;
-		QStackTextEngine engine(lineText, _f->f);
-		engine.option.setTextDirection(_parDirection);
-		_e = &engine;
-
-		eItemize();
 
 		QScriptLine line;
 		line.from = lineStart;
 		line.length = lineLength;
-		eShapeLine(line);
+
+		// Elided lines are built from temporarily replaced blocks and
+		// the hovered links use another font, so they are shaped each time.
+		const auto cacheable = !elidedLine
+			&& !lineHasActiveLink(extendedLineEnd);
+		if (cacheable && !_t->_shapingKey) {
+			_t->_shapingKey = NextShapingKey();
+		}
+		const auto key = ShapedLineKey{
+			cacheable ? _t->_shapingKey : 0,
+			_t->_st,
+			_localFrom,
+			extendedLineEnd,
+			lineStart,
+			lineLength,
+			_parDirection,
+		};
+		auto stackEngine = std::optional<QStackTextEngine>();
+		if (const auto cached = cacheable
+				? ShapedLinesCache().find(key)
+				: nullptr) {
+			_e = cached;
+			_e->fnt = _f->f;
+			_e->resetFontEngineCache();
+		} else {
+			auto shaped = cacheable
+				? std::make_unique<QTextEngine>(lineText, _f->f)
+				: nullptr;
+			if (shaped) {
+				_e = shaped.get();
+			} else {
+				_e = &stackEngine.emplace(lineText, _f->f);
+			}
+			_e->option.setTextDirection(_parDirection);
+
+			eItemize();
+			eShapeLine(line);
+
+			if (shaped) {
+				const auto bytes = int(sizeof(QTextEngine))
+					+ lineText.size() * kShapedLineCharBytes;
+				ShapedLinesCache().insert(key, std::move(shaped), bytes);
+			}
+		}
+		auto &engine = *_e;
 
 		int firstItem = engine.findItem(line.from), lastItem = engine.findItem(line.from + line.length - 1);
 	    int nItems = (firstItem >= 0 && lastItem >= firstItem) ? (lastItem - firstItem + 1) : 0;
@@ -2018,6 +2152,20 @@ private:
 		return result;
 	}
 
+	[[nodiscard]] bool lineHasActiveLink(uint16 lineEnd) const {
+		for (auto i = _lineStartBlock; i < _blocksSize; ++i) {
+			const auto block = _t->_blocks[i].get();
+			if (block->from() >= lineEnd) {
+				break;
+			} else if (const auto index = block->lnkIndex()) {
+				if (ClickHandler::showAsActive(_t->_links.at(index - 1))) {
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
 	void eSetFont(AbstractBlock *block) {
 		const auto flags = block->flags();
 		const auto usedFont = [&] {
@@ -2706,6 +2854,7 @@ String &String::operator=(const String &other) {
 	_blocks = TextBlocks(other._blocks.size());
 	_links = other._links;
 	_startDir = other._startDir;
+	_shapingKey = 0;
 	for (int32 i = 0, l = _blocks.size(); i < l; ++i) {
 		_blocks[i] = other._blocks.at(i)->clone();
 	}
@@ -2721,6 +2870,7 @@ String &String::operator=(String &&other) {
 	_blocks = std::move(other._blocks);
 	_links = other._links;
 	_startDir = other._startDir;
+	_shapingKey = 0;
 	other.clearFields();
 	return *this;
 }
@@ -2737,6 +2887,8 @@ void String::setText(const style::TextStyle &st, const QString &text, const Text
 void String::recountNaturalSize(bool initial, Qt::LayoutDirection optionsDir) {
 	NewlineBlock *lastNewline = 0;
 
+	_shapingKey = 0;
+
 	_maxWidth = _minHeight = 0;
 	int32 lineHeight = 0;
 	int32 result = 0, lastNewlineStart = 0;
@@ -3317,6 +3469,7 @@ void String::clearFields() {
 	_links.clear();
 	_maxWidth = _minHeight = 0;
 	_startDir = Qt::LayoutDirectionAuto;
+	_shapingKey = 0;
 }
 
 String::~String() = default;
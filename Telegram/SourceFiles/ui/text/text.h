@@ -234,6 +234,10 @@ private:
 
 	Qt::LayoutDirection _startDir = Qt::LayoutDirectionAuto;
 
+	// Identifies the shaped lines of this text in the painting cache,
+	// assigned on the first paint and dropped on every change.
+	mutable uint64 _shapingKey = 0;
+
 	friend class Parser;
 	friend class Renderer;
 
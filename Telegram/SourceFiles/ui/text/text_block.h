@@ -9,6 +9,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "ui/style/style_core.h"
 #include "ui/emoji_config.h"
+#include "base/small_pool.h"
 
 #include <private/qfixed_p.h>
 
@@ -35,6 +36,8 @@ enum TextBlockFlags {
 
 class AbstractBlock {
 public:
+	BASE_SMALL_POOL_ALLOCATED
+
 	AbstractBlock(const style::font &font, const QString &str, uint16 from, uint16 length, uchar flags, uint16 lnkIndex) : _from(from), _flags((flags & 0xFF) | ((lnkIndex & 0xFFFF) << 12)) {
 	}
 
@@ -10,6 +10,7 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "base/qthelp_url.h"
 #include "base/qthelp_regex.h"
 #include "base/crc32hash.h"
+#include "base/build_config.h"
 #include "ui/text/text.h"
 #include "ui/widgets/input_fields.h"
 #include "ui/emoji_config.h"
@@ -19,6 +20,10 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include <QtGui/QGuiApplication>
 #include <QtGui/QClipboard>
 
+#ifdef ARCH_CPU_X86_FAMILY
+#include <emmintrin.h>
+#endif // ARCH_CPU_X86_FAMILY
+
 namespace TextUtilities {
 namespace {
 
@@ -82,6 +87,73 @@ QString ExpressionBotCommand() {
 	return QString::fromUtf8("(^|[") + ExpressionSeparators(QString::fromUtf8("`\\*")) + QString::fromUtf8("])/[A-Za-z_0-9]{1,64}(@[A-Za-z_0-9]{5,32})?([\\W]|$)");
 }
 
+// Every entity found by ParseEntities() contains one of these chars,
+// so the expressions that can't match are not run at all.
+struct EntityTriggers {
+	bool dot = false;
+	bool colon = false;
+	bool hash = false;
+	bool at = false;
+	bool slash = false;
+
+	[[nodiscard]] bool all() const {
+		return dot && colon && hash && at && slash;
+	}
+	[[nodiscard]] bool any() const {
+		return dot || colon || hash || at || slash;
+	}
+};
+
+void AccumulateTrigger(EntityTriggers &result, ushort ch) {
+	switch (ch) {
+	case '.': result.dot = true; break;
+	case ':': result.colon = true; break;
+	case '#': result.hash = true; break;
+	case '@': result.at = true; break;
+	case '/': result.slash = true; break;
+	}
+}
+
+EntityTriggers FindEntityTriggers(const QString &text) {
+	auto result = EntityTriggers();
+	auto from = reinterpret_cast<const ushort*>(text.constData());
+	const auto till = from + text.size();
+#ifdef ARCH_CPU_X86_FAMILY
+	// Skip blocks of 8 chars without any of the triggers at once.
+	const auto dot = _mm_set1_epi16('.');
+	const auto colon = _mm_set1_epi16(':');
+	const auto hash = _mm_set1_epi16('#');
+	const auto at = _mm_set1_epi16('@');
+	const auto slash = _mm_set1_epi16('/');
+	for (; till - from >= 8; from += 8) {
+		const auto chars = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(from));
+		const auto found = _mm_or_si128(
+			_mm_or_si128(
+				_mm_or_si128(
+					_mm_cmpeq_epi16(chars, dot),
+					_mm_cmpeq_epi16(chars, colon)),
+				_mm_or_si128(
+					_mm_cmpeq_epi16(chars, hash),
+					_mm_cmpeq_epi16(chars, at))),
+			_mm_cmpeq_epi16(chars, slash));
+		if (!_mm_movemask_epi8(found)) {
+			continue;
+		}
+		for (auto i = 0; i != 8; ++i) {
+			AccumulateTrigger(result, from[i]);
+		}
+		if (result.all()) {
+			return result;
+		}
+	}
+#endif // ARCH_CPU_X86_FAMILY
+	for (; from != till; ++from) {
+		AccumulateTrigger(result, *from);
+	}
+	return result;
+}
+
 QRegularExpression CreateRegExp(const QString &expression) {
 	auto result = QRegularExpression(
 		expression,
@@ -1134,11 +1206,6 @@ inline QChar RemoveOneAccent(uint32 code) {
 	return QChar(0);
 }
 
-const QRegularExpression &RegExpWordSplit() {
-	static const auto result = QRegularExpression(QString::fromLatin1("[\\@\\s\\-\\+\\(\\)\\[\\]\\{\\}\\<\\>\\,\\.\\:\\!\\_\\;\\\"\\'\\x0]"));
-	return result;
-}
-
 [[nodiscard]] QString ExpandCustomLinks(const TextWithTags &text) {
 	const auto entities = ConvertTextTagsToEntities(text.tags);
 	auto &&urls = ranges::subrange(
@@ -1362,15 +1429,14 @@ QString RemoveEmoji(const QString &text) {
 	auto result = QString();
 	result.reserve(text.size());
 
-	auto begin = text.data();
+	auto begin = text.constData();
 	const auto end = begin + text.size();
 	while (begin != end) {
+		auto found = end;
 		auto length = 0;
-		if (Ui::Emoji::Find(begin, end, &length)) {
-			begin += length;
-		} else {
-			result.append(*begin++);
-		}
+		Ui::Emoji::FindNext(begin, end, &found, &length);
+		result.append(begin, found - begin);
+		begin = (found != end) ? (found + length) : end;
 	}
 	return result;
 }
@@ -1380,20 +1446,51 @@ QStringList PrepareSearchWords(
 		const QRegularExpression *SplitterOverride) {
 	auto clean = RemoveAccents(query.trimmed().toLower());
 	auto result = QStringList();
-	if (!clean.isEmpty()) {
-		auto list = clean.split(SplitterOverride
-			? *SplitterOverride
-			: RegExpWordSplit(),
+	if (clean.isEmpty()) {
+		return result;
+	}
+	const auto push = [&](QStringRef word) {
+		auto trimmed = word.trimmed();
+		if (!trimmed.isEmpty()) {
+			result.push_back(trimmed.toString());
+		}
+	};
+	if (SplitterOverride) {
+		const auto list = clean.splitRef(
+			*SplitterOverride,
 			QString::SkipEmptyParts);
-		auto size = list.size();
 		result.reserve(list.size());
-		for (const auto &word : std::as_const(list)) {
-			auto trimmed = word.trimmed();
-			if (!trimmed.isEmpty()) {
-				result.push_back(trimmed);
+		for (const auto &word : list) {
+			push(word);
+		}
+		return result;
+	}
+
+	// Punctuation and ASCII whitespace, splitting without an expression.
+	const auto separator = [](QChar ch) {
+		switch (ch.unicode()) {
+		case '@': case '-': case '+': case '(': case ')': case '[':
+		case ']': case '{': case '}': case '<': case '>': case ',':
+		case '.': case ':': case '!': case '_': case ';': case '"':
+		case '\'': case ' ': case '\t': case '\n': case '\v': case '\f':
+		case '\r': case 0:
+			return true;
+		}
+		return false;
+	};
+	const auto till = int(clean.size());
+	auto from = 0;
+	for (auto i = 0; i != till; ++i) {
+		if (separator(clean[i])) {
+			if (i > from) {
+				push(clean.midRef(from, i - from));
 			}
+			from = i + 1;
 		}
 	}
+	if (till > from) {
+		push(clean.midRef(from, till - from));
+	}
 	return result;
 }
 
@@ -1558,10 +1655,41 @@ TextWithEntities ParseEntities(const QString &text, int32 flags) {
 void ParseEntities(TextWithEntities &result, int32 flags, bool rich) {
 	constexpr auto kNotFound = std::numeric_limits<int>::max();
 
+	const auto triggers = FindEntityTriggers(result.text);
+	if (!triggers.any()) {
+		return;
+	}
+
 	auto newEntities = EntitiesInText();
-	bool withHashtags = (flags & TextParseHashtags);
-	bool withMentions = (flags & TextParseMentions);
-	bool withBotCommands = (flags & TextParseBotCommands);
+	const auto withDomains = triggers.dot;
+	const auto withExplicitDomains = triggers.colon;
+	const auto withHashtags = triggers.hash
+		&& (flags & TextParseHashtags);
+	const auto withMentions = triggers.at
+		&& (flags & TextParseMentions);
+	const auto withBotCommands = triggers.slash
+		&& (flags & TextParseBotCommands);
+
+	// A match found from an earlier offset is still the first match
+	// from any later offset that doesn't pass its start, so each
+	// expression is run again only after its match was passed.
+	auto mDomain = QRegularExpressionMatch();
+	auto mExplicitDomain = QRegularExpressionMatch();
+	auto mHashtag = QRegularExpressionMatch();
+	auto mMention = QRegularExpressionMatch();
+	auto mBotCommand = QRegularExpressionMatch();
+	auto searched = false;
+	const auto refresh = [&](
+			QRegularExpressionMatch &match,
+			const QRegularExpression &expression,
+			bool enabled,
+			int offset) {
+		if (enabled
+			&& (!searched
+				|| (match.hasMatch() && match.capturedStart() < offset))) {
+			match = expression.match(result.text, offset);
+		}
+	};
 
 	int existingEntityIndex = 0, existingEntitiesCount = result.entities.size();
 	int existingEntityEnd = 0;
@@ -1579,11 +1707,24 @@ void ParseEntities(TextWithEntities &result, int32 flags, bool rich) {
 				}
 			}
 		}
-		auto mDomain = qthelp::RegExpDomain().match(result.text, matchOffset);
-		auto mExplicitDomain = qthelp::RegExpDomainExplicit().match(result.text, matchOffset);
-		auto mHashtag = withHashtags ? RegExpHashtag().match(result.text, matchOffset) : QRegularExpressionMatch();
-		auto mMention = withMentions ? RegExpMention().match(result.text, qMax(mentionSkip, matchOffset)) : QRegularExpressionMatch();
-		auto mBotCommand = withBotCommands ? RegExpBotCommand().match(result.text, matchOffset) : QRegularExpressionMatch();
+		refresh(mDomain, qthelp::RegExpDomain(), withDomains, matchOffset);
+		refresh(
+			mExplicitDomain,
+			qthelp::RegExpDomainExplicit(),
+			withExplicitDomains,
+			matchOffset);
+		refresh(mHashtag, RegExpHashtag(), withHashtags, matchOffset);
+		refresh(
+			mMention,
+			RegExpMention(),
+			withMentions,
+			qMax(mentionSkip, matchOffset));
+		refresh(
+			mBotCommand,
+			RegExpBotCommand(),
+			withBotCommands,
+			matchOffset);
+		searched = true;
 
 		auto lnkType = EntityType::Url;
 		int32 lnkStart = 0, lnkLength = 0;
@@ -1650,11 +1791,12 @@ void ParseEntities(TextWithEntities &result, int32 flags, bool rich) {
 			break;
 		}
 
-		if (explicitDomainStart < domainStart) {
+		const auto explicitDomain = (explicitDomainStart < domainStart);
+		if (explicitDomain) {
 			domainStart = explicitDomainStart;
 			domainEnd = explicitDomainEnd;
-			mDomain = mExplicitDomain;
 		}
+		const auto &mLink = explicitDomain ? mExplicitDomain : mDomain;
 		if (mentionStart < hashtagStart
 			&& mentionStart < domainStart
 			&& mentionStart < botCommandStart) {
@@ -1727,8 +1869,8 @@ void ParseEntities(TextWithEntities &result, int32 flags, bool rich) {
 				continue;
 			}
 
-			auto protocol = mDomain.captured(1).toLower();
-			auto topDomain = mDomain.captured(3).toLower();
+			auto protocol = mLink.captured(1).toLower();
+			auto topDomain = mLink.captured(3).toLower();
 			auto isProtocolValid = protocol.isEmpty() || IsValidProtocol(protocol);
 			auto isTopDomainValid = !protocol.isEmpty() || IsValidTopDomain(topDomain);
 
@@ -1753,7 +1895,7 @@ void ParseEntities(TextWithEntities &result, int32 flags, bool rich) {
 				lnkStart = domainStart;
 
 				QStack<const QChar*> parenth;
-				const QChar *domainEnd = start + mDomain.capturedEnd(), *p = domainEnd;
+				const QChar *domainEnd = start + mLink.capturedEnd(), *p = domainEnd;
 				for (; p < end; ++p) {
 					QChar ch(*p);
 					if (chIsLinkEnd(ch)) break; // link finished
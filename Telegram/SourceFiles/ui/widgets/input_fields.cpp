@@ -1994,6 +1994,11 @@ void InputField::processFormatting(int insertPosition, int insertEnd) {
 	while (true) {
 		FormattingAction action;
 
+		// Emoji found before any other action are replaced in one pass,
+		// so that a long pasted text isn't rescanned after each of them.
+		auto emoji = std::vector<FormattingAction>();
+		auto stopAfterEmoji = false;
+
 		auto fromBlock = document->findBlock(insertPosition);
 		auto tillBlock = document->findBlock(insertEnd);
 		if (tillBlock.isValid()) tillBlock = tillBlock.next();
@@ -2068,13 +2073,16 @@ void InputField::processFormatting(int insertPosition, int insertEnd) {
 					}
 
 					auto emojiLength = 0;
-					if (const auto emoji = Emoji::Find(ch, textEnd, &emojiLength)) {
+					if (const auto found = Emoji::Find(ch, textEnd, &emojiLength)) {
 						// Replace emoji if no current action is prepared.
 						if (action.type == ActionType::Invalid) {
-							action.type = ActionType::InsertEmoji;
-							action.emoji = emoji;
-							action.intervalStart = fragmentPosition + (ch - textStart);
-							action.intervalEnd = action.intervalStart + emojiLength;
+							auto &insert = emoji.emplace_back();
+							insert.type = ActionType::InsertEmoji;
+							insert.emoji = found;
+							insert.intervalStart = fragmentPosition + (ch - textStart);
+							insert.intervalEnd = insert.intervalStart + emojiLength;
+							ch += emojiLength - 1;
+							continue;
 						}
 						break;
 					}
@@ -2083,6 +2091,9 @@ void InputField::processFormatting(int insertPosition, int insertEnd) {
 						// Remove tag name till the end if no current action is prepared.
 						if (action.type != ActionType::Invalid) {
 							break;
+						} else if (!emoji.empty()) {
+							stopAfterEmoji = true;
+							break;
 						}
 						breakTagOnNotLetter = false;
 						if (fragmentPosition + (ch - textStart) < breakTagOnNotLetterTill) {
@@ -2113,11 +2124,11 @@ void InputField::processFormatting(int insertPosition, int insertEnd) {
 						++ch;
 					}
 				}
-				if (action.type != ActionType::Invalid) {
+				if (action.type != ActionType::Invalid || stopAfterEmoji) {
 					break;
 				}
 			}
-			if (action.type != ActionType::Invalid) {
+			if (action.type != ActionType::Invalid || stopAfterEmoji) {
 				break;
 			} else if (_mode != Mode::MultiLine
 				&& block.next() != document->end()) {
@@ -2127,22 +2138,39 @@ void InputField::processFormatting(int insertPosition, int insertEnd) {
 				break;
 			}
 		}
-		if (action.type != ActionType::Invalid) {
+		if (!emoji.empty()) {
+			// Any other prepared action is found again in the next pass.
+			PrepareFormattingOptimization(document);
+
+			// From the end, so that the found positions stay correct.
+			for (auto i = emoji.rbegin(); i != emoji.rend(); ++i) {
+				auto cursor = QTextCursor(
+					document->docHandle(),
+					i->intervalStart);
+				cursor.setPosition(i->intervalEnd, QTextCursor::KeepAnchor);
+				InsertEmojiAtCursor(cursor, i->emoji);
+			}
+			auto shift = 0;
+			auto removedTillEnd = 0;
+			for (const auto &insert : emoji) {
+				insertPosition = insert.intervalStart - shift + 1;
+				const auto removed = insert.intervalEnd
+					- insert.intervalStart
+					- 1;
+				shift += removed;
+				if (insertEnd >= insert.intervalEnd) {
+					removedTillEnd += removed;
+				}
+			}
+			insertEnd -= removedTillEnd;
+		} else if (action.type != ActionType::Invalid) {
 			PrepareFormattingOptimization(document);
 
 			auto cursor = QTextCursor(
 				document->docHandle(),
 				action.intervalStart);
 			cursor.setPosition(action.intervalEnd, QTextCursor::KeepAnchor);
-			if (action.type == ActionType::InsertEmoji) {
-				InsertEmojiAtCursor(cursor, action.emoji);
-				insertPosition = action.intervalStart + 1;
-				if (insertEnd >= action.intervalEnd) {
-					insertEnd -= action.intervalEnd
-						- action.intervalStart
-						- 1;
-				}
-			} else if (action.type == ActionType::RemoveTag) {
+			if (action.type == ActionType::RemoveTag) {
 				RemoveDocumentTags(
 					_st,
 					document,
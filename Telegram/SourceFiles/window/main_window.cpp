@@ -44,6 +44,7 @@ namespace Window {
 namespace {
 
 constexpr auto kSaveWindowPositionTimeout = crl::time(1000);
+constexpr auto kUnreadCounterHookDelay = crl::time(200);
 
 } // namespace
 
@@ -126,7 +127,8 @@ MainWindow::MainWindow(not_null<Controller*> controller)
 , _positionUpdatedTimer([=] { savePosition(); })
 , _outdated(CreateOutdatedBar(this))
 , _body(this)
-, _titleText(qsl("Telegram")) {
+, _titleText(qsl("Telegram"))
+, _unreadCounterHookTimer([=] { callUnreadCounterHook(); }) {
 	subscribe(Theme::Background(), [=](
 			const Theme::BackgroundUpdate &data) {
 		if (data.paletteChanged()) {
@@ -504,6 +506,20 @@ void MainWindow::updateUnreadCounter() {
 		: 0;
 	_titleText = (counter > 0) ? qsl("Telegram (%1)").arg(counter) : qsl("Telegram");
 
+	// Taskbar badges, dock tiles and tray icons are expensive to update,
+	// so when many chats change at once they are updated once a period.
+	const auto now = crl::now();
+	const auto next = _unreadCounterHookLast + kUnreadCounterHookDelay;
+	if (now >= next) {
+		callUnreadCounterHook();
+	} else if (!_unreadCounterHookTimer.isActive()) {
+		_unreadCounterHookTimer.callOnce(next - now);
+	}
+}
+
+void MainWindow::callUnreadCounterHook() {
+	_unreadCounterHookTimer.cancel();
+	_unreadCounterHookLast = crl::now();
 	unreadCounterChangedHook();
 }
 
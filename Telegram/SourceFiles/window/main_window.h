@@ -157,6 +157,7 @@ protected:
 private:
 	void updatePalette();
 	void updateUnreadCounter();
+	void callUnreadCounterHook();
 	void initSize();
 
 	bool computeIsActive() const;
@@ -180,6 +181,8 @@ private:
 	QIcon _icon;
 	bool _usingSupportIcon = false;
 	QString _titleText;
+	base::Timer _unreadCounterHookTimer;
+	crl::time _unreadCounterHookLast = 0;
 
 	bool _isActive = false;
 	base::Timer _isActiveTimer;
@@ -305,10 +305,48 @@ void Manager::removeWidget(internal::Widget *remove) {
 void Manager::doShowNotification(
 		not_null<HistoryItem*> item,
 		int forwardedCount) {
+	// In a burst the messages of a history update the notification
+	// of it instead of creating a window for each of them.
+	if (appendToShown(item, forwardedCount)
+		|| appendToQueued(item, forwardedCount)) {
+		return;
+	}
 	_queuedNotifications.emplace_back(item, forwardedCount);
 	showNextFromQueue();
 }
 
+bool Manager::appendToShown(
+		not_null<HistoryItem*> item,
+		int forwardedCount) {
+	const auto queued = QueuedNotification(item, forwardedCount);
+	for (const auto &notification : _notifications) {
+		if (notification->canAppend(queued.history, queued.fromScheduled)) {
+			notification->append(
+				queued.author,
+				queued.item,
+				queued.forwardedCount);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool Manager::appendToQueued(
+		not_null<HistoryItem*> item,
+		int forwardedCount) {
+	auto queued = QueuedNotification(item, forwardedCount);
+	const auto i = ranges::find_if(_queuedNotifications, [&](
+			const QueuedNotification &already) {
+		return (already.history == queued.history)
+			&& (already.fromScheduled == queued.fromScheduled);
+	});
+	if (i == end(_queuedNotifications)) {
+		return false;
+	}
+	*i = std::move(queued);
+	return true;
+}
+
 void Manager::doClearAll() {
 	_queuedNotifications.clear();
 	for (const auto &notification : _notifications) {
@@ -547,7 +585,7 @@ Notification::Notification(
 	updateGeometry(position.x(), position.y(), st::notifyWidth, st::notifyMinHeight);
 
 	_userpicLoaded = _peer ? _peer->userpicLoaded() : true;
-	updateNotifyDisplay();
+	refreshNotifyDisplay();
 
 	_hideTimer.setSingleShot(true);
 	connect(&_hideTimer, &QTimer::timeout, [=] { startHiding(); });
@@ -670,6 +708,19 @@ void Notification::actionsOpacityCallback() {
 }
 
 void Notification::updateNotifyDisplay() {
+	if (_cacheUpdateQueued) {
+		return;
+	}
+	_cacheUpdateQueued = true;
+	crl::on_main(this, [=] {
+		if (_cacheUpdateQueued) {
+			refreshNotifyDisplay();
+		}
+	});
+}
+
+void Notification::refreshNotifyDisplay() {
+	_cacheUpdateQueued = false;
 	if (!_history || !_peer || (!_item && _forwardedCount < 2)) return;
 
 	const auto options = Manager::getNotificationOptions(_item);
@@ -802,6 +853,34 @@ void Notification::updatePeerPhoto() {
 	update();
 }
 
+bool Notification::canAppend(
+		not_null<History*> history,
+		bool fromScheduled) const {
+	return (_history == history)
+		&& (_fromScheduled == fromScheduled)
+		&& !_replyArea;
+}
+
+void Notification::append(
+		const QString &author,
+		HistoryItem *item,
+		int forwardedCount) {
+	Expects(_history != nullptr);
+
+	_author = author;
+	_item = item;
+	_forwardedCount = forwardedCount;
+	_started = crl::now();
+	updateNotifyDisplay();
+
+	stopHiding();
+	if (_waitingForInput) {
+		manager()->checkLastInput();
+	} else {
+		_hideTimer.start(st::notifyWaitLongHide);
+	}
+}
+
 bool Notification::unlinkItem(HistoryItem *deleted) {
 	auto unlink = (_item && _item == deleted);
 	if (unlink) {
@@ -66,6 +66,8 @@ private:
 	void doClearFromItem(not_null<HistoryItem*> item) override;
 
 	void showNextFromQueue();
+	bool appendToShown(not_null<HistoryItem*> item, int forwardedCount);
+	bool appendToQueued(not_null<HistoryItem*> item, int forwardedCount);
 	void unlinkFromShown(Notification *remove);
 	void startAllHiding();
 	void stopAllHiding();
@@ -194,6 +196,16 @@ public:
 	void startHiding();
 	void stopHiding();
 
+	// Shows the newer message from the same history in this notification.
+	[[nodiscard]] bool canAppend(
+		not_null<History*> history,
+		bool fromScheduled) const;
+	void append(
+		const QString &author,
+		HistoryItem *item,
+		int forwardedCount);
+
+	// Repaints the cache once in the next event loop iteration.
 	void updateNotifyDisplay();
 	void updatePeerPhoto();
 
@@ -218,6 +230,7 @@ protected:
 
 private:
 	void refreshLang();
+	void refreshNotifyDisplay();
 	void updateReplyGeometry();
 	bool canReply() const;
 	void replyResized();
@@ -233,6 +246,7 @@ private:
 	void actionsOpacityCallback();
 
 	QPixmap _cache;
+	bool _cacheUpdateQueued = false;
 
 	bool _hideReplyButton = false;
 	bool _actionsVisible = false;
@@ -30,6 +30,8 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 #include "styles/style_history.h"
 
 #include <QtCore/QBuffer>
+#include <range/v3/algorithm/find.hpp>
+#include <range/v3/algorithm/remove.hpp>
 
 namespace Window {
 namespace Theme {
@@ -39,6 +41,7 @@ constexpr auto kThemeFileSizeLimit = 5 * 1024 * 1024;
 constexpr auto kBackgroundSizeLimit = 25 * 1024 * 1024;
 constexpr auto kNightThemeFile = str_const(":/gui/night.tdesktop-theme");
 constexpr auto kMinimumTiledSize = 512;
+constexpr auto kRecentCachesCount = std::size_t(3);
 
 struct Applying {
 	Saved data;
@@ -49,6 +52,9 @@ struct Applying {
 NeverFreedPointer<ChatBackground> GlobalBackground;
 Applying GlobalApplying;
 
+// Binary forms of the themes loaded without colorizing, recent first.
+std::vector<Cached> GlobalRecentCaches;
+
 inline bool AreTestingTheme() {
 	return !GlobalApplying.paletteForRevert.isEmpty();
 }
@@ -359,26 +365,37 @@ bool LoadTheme(
 	return true;
 }
 
-bool InitializeFromCache(
+[[nodiscard]] bool CacheFitsContent(
 		const QByteArray &content,
 		const Cached &cache) {
-	if (cache.paletteChecksum != style::palette::Checksum()) {
-		return false;
+	return (cache.paletteChecksum == style::palette::Checksum())
+		&& (cache.contentChecksum
+			== base::crc32(content.constData(), content.size()));
+}
+
+bool ReadCachedBackground(const Cached &cache, QImage *outBackground) {
+	if (cache.background.isEmpty()) {
+		*outBackground = QImage();
+		return true;
 	}
-	if (cache.contentChecksum != base::crc32(content.constData(), content.size())) {
+	QDataStream stream(cache.background);
+	QImageReader reader(stream.device());
+#ifndef OS_MAC_OLD
+	reader.setAutoTransform(true);
+#endif // OS_MAC_OLD
+	return reader.read(outBackground) && !outBackground->isNull();
+}
+
+bool InitializeFromCache(
+		const QByteArray &content,
+		const Cached &cache) {
+	if (!CacheFitsContent(content, cache)) {
 		return false;
 	}
 
 	QImage background;
-	if (!cache.background.isEmpty()) {
-		QDataStream stream(cache.background);
-		QImageReader reader(stream.device());
-#ifndef OS_MAC_OLD
-		reader.setAutoTransform(true);
-#endif // OS_MAC_OLD
-		if (!reader.read(&background) || background.isNull()) {
-			return false;
-		}
+	if (!ReadCachedBackground(cache, &background)) {
+		return false;
 	}
 
 	if (!style::main_palette::load(cache.colors)) {
@@ -392,6 +409,78 @@ bool InitializeFromCache(
 	return true;
 }
 
+// The cached palette is resolved and the background is a BMP already,
+// so this skips parsing the theme and decoding its background.
+bool LoadFromCache(
+		const QByteArray &content,
+		not_null<Instance*> out,
+		const Cached &cache) {
+	if (!CacheFitsContent(content, cache)) {
+		return false;
+	}
+	auto background = QImage();
+	if (!ReadCachedBackground(cache, &background)
+		|| !out->palette.load(cache.colors)) {
+		return false;
+	}
+	out->palette.finalize();
+	if (!background.isNull()) {
+		applyBackground(std::move(background), cache.tiled, out);
+	}
+	return true;
+}
+
+bool LoadFromRecentCache(
+		const QByteArray &content,
+		not_null<Instance*> out,
+		Cached *outCache) {
+	const auto checksum = base::crc32(content.constData(), content.size());
+	const auto i = ranges::find(
+		GlobalRecentCaches,
+		checksum,
+		&Cached::contentChecksum);
+	if (i == end(GlobalRecentCaches) || !LoadFromCache(content, out, *i)) {
+		return false;
+	}
+	if (outCache) {
+		*outCache = *i;
+	}
+	return true;
+}
+
+void RememberRecentCache(const Cached &cache) {
+	auto &list = GlobalRecentCaches;
+	list.erase(ranges::remove(
+		list,
+		cache.contentChecksum,
+		&Cached::contentChecksum), end(list));
+	list.insert(begin(list), cache);
+	if (list.size() > kRecentCachesCount) {
+		list.resize(kRecentCachesCount);
+	}
+}
+
+bool LoadAndRemember(
+		const QByteArray &content,
+		const Colorizer &colorizer,
+		not_null<Instance*> out,
+		Cached *outCache) {
+	if (colorizer) {
+		return LoadTheme(content, colorizer, std::nullopt, outCache, out);
+	} else if (LoadFromRecentCache(content, out, outCache)) {
+		return true;
+	}
+	auto cache = Cached();
+	if (!LoadTheme(content, colorizer, std::nullopt, &cache, out)) {
+		return false;
+	}
+	RememberRecentCache(cache);
+	if (outCache) {
+		*outCache = std::move(cache);
+	}
+	return true;
+}
+
 [[nodiscard]] std::optional<QByteArray> ReadEditingPalette() {
 	auto file = QFile(EditingPalettePath());
 	return file.open(QIODevice::ReadOnly)
@@ -787,7 +876,22 @@ void ChatBackground::clearEditingTheme(ClearEditing clear) {
 }
 
 void ChatBackground::adjustPaletteUsingBackground(const QImage &image) {
-	adjustPaletteUsingColor(CountAverageColor(image));
+	adjustPaletteUsingColor(averageColor(image));
+}
+
+QColor ChatBackground::averageColor(const QImage &image) {
+	// Only cloud images without a pattern are the same for the same id.
+	if (!Data::IsCloudWallPaper(_paper) || _paper.isPattern()) {
+		return CountAverageColor(image);
+	}
+	const auto key = std::make_pair(_paper.id(), _paper.isBlurred());
+	const auto i = _averageColors.find(key);
+	if (i != end(_averageColors)) {
+		return i->second;
+	}
+	return _averageColors.emplace(
+		key,
+		CountAverageColor(image)).first->second;
 }
 
 void ChatBackground::adjustPaletteUsingColor(QColor color) {
@@ -1070,7 +1174,11 @@ void ChatBackground::reapplyWithNightMode(
 		auto preview = std::make_unique<Preview>();
 		preview->object = std::move(read.object);
 		preview->instance.cached = std::move(read.cache);
-		const auto loaded = LoadTheme(
+		const auto loaded = LoadFromCache(
+			preview->object.content,
+			&preview->instance,
+			preview->instance.cached
+		) || LoadTheme(
 			preview->object.content,
 			ColorizerForTheme(path),
 			std::nullopt,
@@ -1289,14 +1397,14 @@ bool LoadFromFile(
 		not_null<QByteArray*> outContent) {
 	*outContent = readThemeContent(path);
 	const auto colorizer = ColorizerForTheme(path);
-	return LoadTheme(*outContent, colorizer, std::nullopt, outCache, out);
+	return LoadAndRemember(*outContent, colorizer, out, outCache);
 }
 
 bool LoadFromContent(
 		const QByteArray &content,
 		not_null<Instance*> out,
 		Cached *outCache) {
-	return LoadTheme(content, Colorizer(), std::nullopt, outCache, out);
+	return LoadAndRemember(content, Colorizer(), out, outCache);
 }
 
 QString EditingPalettePath() {
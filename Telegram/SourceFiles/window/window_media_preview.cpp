@@ -9,12 +9,15 @@ https://github.com/telegramdesktop/tdesktop/blob/master/LEGAL
 
 #include "data/data_photo.h"
 #include "data/data_document.h"
+#include "data/data_session.h"
+#include "data/data_animation_posters.h"
 #include "ui/image/image.h"
 #include "ui/emoji_config.h"
 #include "lottie/lottie_single_player.h"
 #include "main/main_session.h"
 #include "chat_helpers/stickers.h"
 #include "window/window_session_controller.h"
+#include "app.h"
 #include "styles/style_boxes.h"
 #include "styles/style_chat_helpers.h"
 #include "styles/style_history.h"
@@ -54,7 +57,11 @@ void MediaPreviewWidget::paintEvent(QPaintEvent *e) {
 			return QImage();
 		}
 		_lottie->markFrameShown();
-		return _lottie->frame();
+		auto result = _lottie->frame();
+		if (!_posterRemembered) {
+			rememberPoster(App::pixmapFromImageInPlace(QImage(result)));
+		}
+		return result;
 	}();
 	const auto pixmap = image.isNull() ? currentImage() : QPixmap();
 	const auto size = image.isNull() ? pixmap.size() : image.size();
@@ -177,6 +184,7 @@ void MediaPreviewWidget::resetGifAndCache() {
 	_gif.reset();
 	_cacheStatus = CacheNotLoaded;
 	_cachedSize = QSize();
+	_posterRemembered = false;
 }
 
 QSize MediaPreviewWidget::currentDimensions() const {
@@ -245,7 +253,12 @@ QPixmap MediaPreviewWidget::currentImage() const {
 				}
 				if (_lottie && _lottie->ready()) {
 					return QPixmap();
-				} else if (const auto image = _document->getStickerLarge()) {
+				} else if (sticker->animated) {
+					if (auto poster = lookupPoster(); !poster.isNull()) {
+						return poster;
+					}
+				}
+				if (const auto image = _document->getStickerLarge()) {
 					QSize s = currentDimensions();
 					_cache = image->pix(_origin, s.width(), s.height());
 					_cacheStatus = CacheLoaded;
@@ -271,7 +284,13 @@ QPixmap MediaPreviewWidget::currentImage() const {
 			if (_gif && _gif->started()) {
 				auto s = currentDimensions();
 				auto paused = _controller->isGifPausedAtLeastFor(Window::GifPauseReason::MediaPreview);
-				return _gif->current(s.width(), s.height(), s.width(), s.height(), ImageRoundRadius::None, RectPart::None, paused ? 0 : crl::now());
+				auto result = _gif->current(s.width(), s.height(), s.width(), s.height(), ImageRoundRadius::None, RectPart::None, paused ? 0 : crl::now());
+				if (!_posterRemembered) {
+					rememberPoster(result);
+				}
+				return result;
+			} else if (auto poster = lookupPoster(); !poster.isNull()) {
+				return poster;
 			}
 			if (_cacheStatus != CacheThumbLoaded
 				&& _document->hasThumbnail()) {
@@ -317,6 +336,33 @@ QPixmap MediaPreviewWidget::currentImage() const {
 	return _cache;
 }
 
+// The first frame is shown right away when the same sticker or GIF
+// is previewed again, while a new player decodes its first frame.
+QPixmap MediaPreviewWidget::lookupPoster() const {
+	Expects(_document != nullptr);
+
+	return _document->owner().animationPosters().lookup(
+		_document,
+		currentDimensions(),
+		ImageRoundRadius::None,
+		RectPart::None);
+}
+
+void MediaPreviewWidget::rememberPoster(QPixmap frame) const {
+	Expects(_document != nullptr);
+
+	if (frame.isNull()) {
+		return;
+	}
+	_posterRemembered = true;
+	frame.setDevicePixelRatio(cRetinaFactor());
+	_document->owner().animationPosters().remember(
+		_document,
+		ImageRoundRadius::None,
+		RectPart::None,
+		frame);
+}
+
 void MediaPreviewWidget::clipCallback(Media::Clip::Notification notification) {
 	using namespace Media::Clip;
 	switch (notification) {
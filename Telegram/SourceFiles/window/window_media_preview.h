@@ -43,6 +43,8 @@ protected:
 private:
 	QSize currentDimensions() const;
 	QPixmap currentImage() const;
+	QPixmap lookupPoster() const;
+	void rememberPoster(QPixmap frame) const;
 	void setupLottie();
 	void startShow();
 	void fillEmojiString();
@@ -72,6 +74,7 @@ private:
 	mutable CacheStatus _cacheStatus = CacheNotLoaded;
 	mutable QPixmap _cache;
 	mutable QSize _cachedSize;
+	mutable bool _posterRemembered = false;
 
 };
 
@@ -308,6 +308,17 @@ bool SessionController::isGifPausedAtLeastFor(GifPauseReason reason) const {
 	return (static_cast<int>(_gifPauseReasons) >= 2 * static_cast<int>(reason)) || !widget()->isActive();
 }
 
+// An inactive window pauses every animation, like the strongest reason.
+// Without this notification the paused ones would resume only on the
+// next unrelated repaint after the window is activated again.
+void SessionController::checkWindowActive() {
+	const auto active = widget()->isActive();
+	if (_gifPauseWindowActive != active) {
+		_gifPauseWindowActive = active;
+		_gifPauseLevelChanged.notify();
+	}
+}
+
 int SessionController::dialogsSmallColumnWidth() const {
 	return st::dialogsPadding.x() + st::dialogsPhotoSize + st::dialogsPadding.x();
 }
@@ -195,6 +195,7 @@ public:
 		return _gifPauseLevelChanged;
 	}
 	bool isGifPausedAtLeastFor(GifPauseReason reason) const;
+	void checkWindowActive();
 	base::Observable<void> &floatPlayerAreaUpdated() {
 		return _floatPlayerAreaUpdated;
 	}
@@ -315,6 +316,7 @@ private:
 	std::unique_ptr<Passport::FormController> _passportForm;
 
 	GifPauseReasons _gifPauseReasons = 0;
+	bool _gifPauseWindowActive = false;
 	base::Observable<void> _gifPauseLevelChanged;
 	base::Observable<void> _floatPlayerAreaUpdated;
 
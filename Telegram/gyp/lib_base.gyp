@@ -53,13 +53,19 @@
       '<(src_loc)/base/concurrent_timer.h',
       '<(src_loc)/base/flags.h',
       '<(src_loc)/base/enum_mask.h',
+      '<(src_loc)/base/flat_hash_map.h',
       '<(src_loc)/base/flat_map.h',
       '<(src_loc)/base/flat_set.h',
+      '<(src_loc)/base/frame_clock.cpp',
+      '<(src_loc)/base/frame_clock.h',
       '<(src_loc)/base/functors.h',
       '<(src_loc)/base/index_based_iterator.h',
       '<(src_loc)/base/invoke_queued.h',
       '<(src_loc)/base/last_used_cache.h',
+      '<(src_loc)/base/lazy_service.h',
       '<(src_loc)/base/match_method.h',
+      '<(src_loc)/base/memory_usage.cpp',
+      '<(src_loc)/base/memory_usage.h',
       '<(src_loc)/base/object_ptr.h',
       '<(src_loc)/base/observer.cpp',
       '<(src_loc)/base/observer.h',
@@ -76,9 +82,15 @@
       '<(src_loc)/base/qt_signal_producer.h',
       '<(src_loc)/base/runtime_composer.cpp',
       '<(src_loc)/base/runtime_composer.h',
+      '<(src_loc)/base/small_pool.cpp',
+      '<(src_loc)/base/small_pool.h',
       '<(src_loc)/base/thread_safe_wrap.h',
       '<(src_loc)/base/timer.cpp',
       '<(src_loc)/base/timer.h',
+      '<(src_loc)/base/timer_wheel.cpp',
+      '<(src_loc)/base/timer_wheel.h',
+      '<(src_loc)/base/tracing.cpp',
+      '<(src_loc)/base/tracing.h',
       '<(src_loc)/base/type_traits.h',
       '<(src_loc)/base/unique_any.h',
       '<(src_loc)/base/unique_function.h',
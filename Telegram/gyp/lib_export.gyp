@@ -21,6 +21,7 @@
       'res_loc': '../Resources',
       'official_build_target%': '',
       'submodules_loc': '../ThirdParty',
+      'minizip_loc': '<(submodules_loc)/minizip',
       'pch_source': '<(src_loc)/export/export_pch.cpp',
       'pch_header': '<(src_loc)/export/export_pch.h',
     },
@@ -48,6 +49,8 @@
       '<(submodules_loc)/GSL/include',
       '<(submodules_loc)/variant/include',
       '<(submodules_loc)/crl/src',
+      '<(libs_loc)/zlib',
+      '<(minizip_loc)',
     ],
     'sources': [
       '<(src_loc)/export/export_api_wrap.cpp',
@@ -60,12 +63,16 @@
       '<(src_loc)/export/data/export_data_types.h',
       '<(src_loc)/export/output/export_output_abstract.cpp',
       '<(src_loc)/export/output/export_output_abstract.h',
+      '<(src_loc)/export/output/export_output_archive.cpp',
+      '<(src_loc)/export/output/export_output_archive.h',
       '<(src_loc)/export/output/export_output_file.cpp',
       '<(src_loc)/export/output/export_output_file.h',
       '<(src_loc)/export/output/export_output_html.cpp',
       '<(src_loc)/export/output/export_output_html.h',
       '<(src_loc)/export/output/export_output_json.cpp',
       '<(src_loc)/export/output/export_output_json.h',
+      '<(src_loc)/export/output/export_output_manifest.cpp',
+      '<(src_loc)/export/output/export_output_manifest.h',
       '<(src_loc)/export/output/export_output_result.h',
       '<(src_loc)/export/output/export_output_stats.cpp',
       '<(src_loc)/export/output/export_output_stats.h',
@@ -68,6 +68,8 @@
       '<(src_loc)/storage/cache/storage_cache_database.h',
       '<(src_loc)/storage/cache/storage_cache_database_object.cpp',
       '<(src_loc)/storage/cache/storage_cache_database_object.h',
+      '<(src_loc)/storage/cache/storage_cache_hot_cache.cpp',
+      '<(src_loc)/storage/cache/storage_cache_hot_cache.h',
       '<(src_loc)/storage/cache/storage_cache_types.cpp',
       '<(src_loc)/storage/cache/storage_cache_types.h',
     ],
@@ -51,6 +51,16 @@
       '<(src_loc)/base/algorithm.h',
       '<(src_loc)/base/algorithm_tests.cpp',
     ],
+  }, {
+    'target_name': 'tests_crc32hash',
+    'includes': [
+      'common_test.gypi',
+    ],
+    'sources': [
+      '<(src_loc)/base/crc32hash.cpp',
+      '<(src_loc)/base/crc32hash.h',
+      '<(src_loc)/base/crc32hash_tests.cpp',
+    ],
   }, {
     'target_name': 'tests_flags',
     'includes': [
@@ -60,6 +70,15 @@
       '<(src_loc)/base/flags.h',
       '<(src_loc)/base/flags_tests.cpp',
     ],
+  }, {
+    'target_name': 'tests_flat_hash_map',
+    'includes': [
+      'common_test.gypi',
+    ],
+    'sources': [
+      '<(src_loc)/base/flat_hash_map.h',
+      '<(src_loc)/base/flat_hash_map_tests.cpp',
+    ],
   }, {
     'target_name': 'tests_flat_map',
     'includes': [
@@ -85,6 +104,7 @@
     ],
     'sources': [
       '<(src_loc)/rpl/details/callable.h',
+      '<(src_loc)/rpl/details/small_function.h',
       '<(src_loc)/rpl/details/superset_type.h',
       '<(src_loc)/rpl/details/type_list.h',
       '<(src_loc)/rpl/after_next.h',
@@ -117,6 +137,26 @@
       '<(src_loc)/rpl/variable.h',
       '<(src_loc)/rpl/variable_tests.cpp',
     ],
+  }, {
+    'target_name': 'tests_timer_wheel',
+    'includes': [
+      'common_test.gypi',
+    ],
+    'sources': [
+      '<(src_loc)/base/timer_wheel.cpp',
+      '<(src_loc)/base/timer_wheel.h',
+      '<(src_loc)/base/timer_wheel_tests.cpp',
+    ],
+  }, {
+    'target_name': 'tests_tracing',
+    'includes': [
+      'common_test.gypi',
+    ],
+    'sources': [
+      '<(src_loc)/base/tracing.cpp',
+      '<(src_loc)/base/tracing.h',
+      '<(src_loc)/base/tracing_tests.cpp',
+    ],
   }, {
     'target_name': 'tests_storage',
     'includes': [
@@ -138,5 +178,90 @@
         '<(src_loc)/platform/win/windows_dlls.h',
       ],
     }]],
+  }, {
+    # Not a part of 'tests', run manually with '[.benchmark]' argument.
+    'target_name': 'benchmarks_storage',
+    'includes': [
+      'common_test.gypi',
+      '../modules/openssl.gypi',
+    ],
+    'dependencies': [
+      '../lib_storage.gyp:lib_storage',
+    ],
+    'sources': [
+      '<(src_loc)/storage/cache/storage_cache_database_benchmarks.cpp',
+      '<(src_loc)/platform/win/windows_dlls.cpp',
+      '<(src_loc)/platform/win/windows_dlls.h',
+    ],
+    'conditions': [[ 'not build_win', {
+      'sources!': [
+        '<(src_loc)/platform/win/windows_dlls.cpp',
+        '<(src_loc)/platform/win/windows_dlls.h',
+      ],
+    }]],
+  }, {
+    # Not a part of 'tests', run manually with '[.benchmark]' argument.
+    'target_name': 'benchmarks_mtproto',
+    'includes': [
+      'common_test.gypi',
+      '../modules/openssl.gypi',
+    ],
+    'sources': [
+      '<(src_loc)/mtproto/mtp_aes_ige.cpp',
+      '<(src_loc)/mtproto/mtp_aes_ige.h',
+      '<(src_loc)/mtproto/mtp_aes_ige_benchmarks.cpp',
+      '<(src_loc)/platform/win/windows_dlls.cpp',
+      '<(src_loc)/platform/win/windows_dlls.h',
+    ],
+    'conditions': [[ 'not build_win', {
+      'sources!': [
+        '<(src_loc)/platform/win/windows_dlls.cpp',
+        '<(src_loc)/platform/win/windows_dlls.h',
+      ],
+    }]],
+  }, {
+    # Not a part of 'tests', run manually with '[.benchmark]' argument.
+    'target_name': 'benchmarks_lottie',
+    'includes': [
+      'common_test.gypi',
+    ],
+    'dependencies': [
+      '../lib_lottie.gyp:lib_lottie',
+    ],
+    'include_dirs': [
+      '<(libs_loc)/ffmpeg',
+      '<(submodules_loc)/rlottie/inc',
+    ],
+    'sources': [
+      '<(src_loc)/lottie/lottie_benchmarks.cpp',
+      '<(src_loc)/platform/win/windows_dlls.cpp',
+      '<(src_loc)/platform/win/windows_dlls.h',
+    ],
+    'conditions': [[ 'not build_win', {
+      'sources!': [
+        '<(src_loc)/platform/win/windows_dlls.cpp',
+        '<(src_loc)/platform/win/windows_dlls.h',
+      ],
+    }]],
+  }, {
+    # Not a part of 'tests', run manually with '[.benchmark]' argument.
+    'target_name': 'benchmarks_base',
+    'includes': [
+      'common_test.gypi',
+    ],
+    'dependencies': [
+      '../lib_base.gyp:lib_base',
+    ],
+    'sources': [
+      '<(src_loc)/base/base_benchmarks.cpp',
+      '<(src_loc)/platform/win/windows_dlls.cpp',
+      '<(src_loc)/platform/win/windows_dlls.h',
+    ],
+    'conditions': [[ 'not build_win', {
+      'sources!': [
+        '<(src_loc)/platform/win/windows_dlls.cpp',
+        '<(src_loc)/platform/win/windows_dlls.h',
+      ],
+    }]],
   }],
 }